@@ -22,9 +22,14 @@
  * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* syscall, copy_file_range */
+#endif
+
 #include "fossil/io/archive.h"
 #include "fossil/io/cstring.h"
 #include "fossil/io/output.h"
+#include "workers.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -32,93 +37,3035 @@
 #include <string.h>
 #include <stdbool.h>
 
+#include <errno.h>
+#include <stdatomic.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <sys/stat.h>
+#ifndef S_ISDIR
+#define S_ISDIR(m) (((m) & _S_IFMT) == _S_IFDIR)
+#endif
+#ifndef S_ISREG
+#define S_ISREG(m) (((m) & _S_IFMT) == _S_IFREG)
+#endif
+typedef struct _stat64 archive_stat_t;
+typedef __int64 archive_off_t;
+#define archive_stat _stat64
+#define archive_seek _fseeki64
+#define archive_tell _ftelli64
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <utime.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#ifndef AT_FDCWD
+#define AT_FDCWD -100
+#endif
+typedef struct stat archive_stat_t;
+typedef off_t archive_off_t;
+#define archive_stat stat
+#define archive_seek fseeko
+#define archive_tell ftello
+#endif
+
+// ======================================================
+// Opaque archive handle definition
+// ======================================================
+
+// Where an entry lives inside an on-disk archive
+typedef struct fossil_io_archive_pos
+{
+    uint64_t header_offset; // first header byte (TAR: including pax/long-name headers)
+    uint64_t data_offset;   // first byte of file data; 0 while a ZIP local header is unread
+    uint64_t end_offset;    // one past the entry's last byte; 0 when unknown
+    char type;              // '0' file, '5' directory, other ustar types as read
+    uint16_t method;        // ZIP compression method
+    uint16_t flags;         // ZIP general purpose flags
+} fossil_io_archive_pos_t;
+
+// A TAR record superseded by a later one of the same name; tar(1) keeps the
+// last, but the older bytes stay in the file until the name is removed
+typedef struct fossil_io_archive_shadow
+{
+    const char *name; // interned
+    uint64_t start;
+    uint64_t end;
+} fossil_io_archive_shadow_t;
+
+// Append-only storage for entry names
+typedef struct fossil_io_archive_name_block
+{
+    struct fossil_io_archive_name_block *next;
+    size_t used;
+    size_t capacity;
+    char data[];
+} fossil_io_archive_name_block_t;
+
+struct fossil_io_archive
+{
+    char *path;
+    fossil_io_archive_type_t type;
+    fossil_io_archive_mode_t mode;
+    fossil_io_archive_compression_t compression;
+    // Internal storage for entries
+    fossil_io_archive_entry_t *entries;
+    size_t entry_count;
+    size_t entry_capacity;
+    // Open-addressing index over entry names; names live in the block arena
+    size_t *index;
+    size_t index_capacity;
+    fossil_io_archive_name_block_t *names;
+    // On-disk backend state (TAR, ZIP); stream is NULL for in-memory formats
+    // and for read-only ZIPs, which are served entirely from the mapping
+    FILE *stream;
+    uint64_t write_offset;
+    fossil_io_archive_pos_t *positions;
+    fossil_io_archive_shadow_t *shadows;
+    size_t shadow_count;
+    size_t shadow_capacity;
+    unsigned char *buffer;
+    bool dirty;
+    const unsigned char *map;
+    size_t map_size;
+#ifdef _WIN32
+    HANDLE map_handle;
+#endif
+};
+
+// ======================================================
+// Helper: Create directory recursively
+// ======================================================
+static bool fossil_io_create_directories(const char *path)
+{
+    if (!path)
+        return false;
+
+    char *path_copy = fossil_io_cstring_dup(path);
+    if (!path_copy)
+        return false;
+
+    char *p = path_copy;
+
+    // Skip root slash on Unix or drive letter on Windows
+    if (*p == '/')
+        p++;
+#ifdef _WIN32
+    else if (strlen(p) >= 2 && p[1] == ':')
+        p += 2;
+    if (*p == '/' || *p == '\\')
+        p++;
+#endif
+
+    while (*p)
+    {
+        while (*p && *p != '/' && *p != '\\')
+            p++;
+        if (*p)
+        {
+            char sep = *p;
+            *p = '\0';
+
+#ifdef _WIN32
+            CreateDirectoryA(path_copy, NULL);
+#else
+            mkdir(path_copy, 0755);
+#endif
+
+            *p = sep;
+            p++;
+        }
+    }
+
+    // Create the final directory if it doesn't end with a separator
+    if (strlen(path_copy) > 0)
+    {
+#ifdef _WIN32
+        CreateDirectoryA(path_copy, NULL);
+#else
+        mkdir(path_copy, 0755);
+#endif
+    }
+
+    fossil_io_cstring_free(path_copy);
+    return true;
+}
+
+// ======================================================
+// Entry table: name arena and hash index
+// ======================================================
+
+#define ARCHIVE_NAME_BLOCK 65536
+#define ARCHIVE_INDEX_EMPTY ((size_t)0)
+#define ARCHIVE_NOT_FOUND ((size_t)-1)
+
+// Copy a name into the arena; blocks never move, so entry pointers stay valid.
+static char *archive_intern(fossil_io_archive_t *archive, const char *name)
+{
+    size_t len = strlen(name) + 1;
+    fossil_io_archive_name_block_t *block = archive->names;
+    if (!block || block->capacity - block->used < len)
+    {
+        size_t capacity = len > ARCHIVE_NAME_BLOCK ? len : ARCHIVE_NAME_BLOCK;
+        block = malloc(sizeof(*block) + capacity);
+        if (!block)
+            return NULL;
+        block->next = archive->names;
+        block->used = 0;
+        block->capacity = capacity;
+        archive->names = block;
+    }
+    char *out = block->data + block->used;
+    memcpy(out, name, len);
+    block->used += len;
+    return out;
+}
+
+static uint64_t archive_name_hash(const char *name)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Slots hold entry index + 1 so that zero marks an empty slot.
+static void archive_index_place(fossil_io_archive_t *archive, size_t entry)
+{
+    size_t mask = archive->index_capacity - 1;
+    size_t slot = (size_t)archive_name_hash(archive->entries[entry].name) & mask;
+    while (archive->index[slot] != ARCHIVE_INDEX_EMPTY)
+        slot = (slot + 1) & mask;
+    archive->index[slot] = entry + 1;
+}
+
+static void archive_index_rebuild(fossil_io_archive_t *archive)
+{
+    if (!archive->index)
+        return;
+    memset(archive->index, 0, archive->index_capacity * sizeof(size_t));
+    for (size_t i = 0; i < archive->entry_count; i++)
+        archive_index_place(archive, i);
+}
+
+// Keep the table at most half full so probe chains stay short.
+static bool archive_index_reserve(fossil_io_archive_t *archive, size_t count)
+{
+    if (count * 2 <= archive->index_capacity)
+        return true;
+
+    size_t capacity = archive->index_capacity ? archive->index_capacity : 16;
+    while (count * 2 > capacity)
+        capacity *= 2;
+
+    size_t *index = calloc(capacity, sizeof(size_t));
+    if (!index)
+        return false;
+    free(archive->index);
+    archive->index = index;
+    archive->index_capacity = capacity;
+    archive_index_rebuild(archive);
+    return true;
+}
+
+static size_t archive_find(const fossil_io_archive_t *archive, const char *name)
+{
+    if (!archive->index)
+        return ARCHIVE_NOT_FOUND;
+
+    size_t mask = archive->index_capacity - 1;
+    size_t slot = (size_t)archive_name_hash(name) & mask;
+    while (archive->index[slot] != ARCHIVE_INDEX_EMPTY)
+    {
+        size_t entry = archive->index[slot] - 1;
+        if (strcmp(archive->entries[entry].name, name) == 0)
+            return entry;
+        slot = (slot + 1) & mask;
+    }
+    return ARCHIVE_NOT_FOUND;
+}
+
+// Reserve a zeroed slot at entry_count; it becomes visible on archive_commit_entry().
+static bool archive_push_entry(fossil_io_archive_t *archive, fossil_io_archive_entry_t **out)
+{
+    if (archive->entry_count >= archive->entry_capacity)
+    {
+        size_t old_capacity = archive->entry_capacity;
+        size_t new_capacity = archive->entry_capacity == 0 ? 8 : archive->entry_capacity * 2;
+        fossil_io_archive_entry_t *new_entries = realloc(archive->entries,
+                                                         sizeof(fossil_io_archive_entry_t) * new_capacity);
+        if (!new_entries)
+            return false;
+        archive->entries = new_entries;
+
+        fossil_io_archive_pos_t *new_positions = realloc(archive->positions,
+                                                             sizeof(fossil_io_archive_pos_t) * new_capacity);
+        if (!new_positions)
+            return false;
+        archive->positions = new_positions;
+
+        // Zero-initialize new memory
+        memset(new_entries + old_capacity, 0,
+               (new_capacity - old_capacity) * sizeof(fossil_io_archive_entry_t));
+        memset(new_positions + old_capacity, 0,
+               (new_capacity - old_capacity) * sizeof(fossil_io_archive_pos_t));
+
+        archive->entry_capacity = new_capacity;
+    }
+
+    if (!archive_index_reserve(archive, archive->entry_count + 1))
+        return false;
+
+    *out = &archive->entries[archive->entry_count];
+    memset(*out, 0, sizeof(**out));
+    memset(&archive->positions[archive->entry_count], 0, sizeof(fossil_io_archive_pos_t));
+    return true;
+}
+
+// Remember the byte range of a TAR record about to be superseded.
+static bool archive_push_shadow(fossil_io_archive_t *archive, const char *name, const fossil_io_archive_pos_t *pos)
+{
+    if (archive->shadow_count == archive->shadow_capacity)
+    {
+        size_t capacity = archive->shadow_capacity ? archive->shadow_capacity * 2 : 4;
+        fossil_io_archive_shadow_t *grown = realloc(archive->shadows, capacity * sizeof(*grown));
+        if (!grown)
+            return false;
+        archive->shadows = grown;
+        archive->shadow_capacity = capacity;
+    }
+    fossil_io_archive_shadow_t *shadow = &archive->shadows[archive->shadow_count++];
+    shadow->name = name;
+    shadow->start = pos->header_offset;
+    shadow->end = pos->end_offset;
+    return true;
+}
+
+// Publish the slot reserved by archive_push_entry(); its name must already be set.
+static void archive_commit_entry(fossil_io_archive_t *archive)
+{
+    archive_index_place(archive, archive->entry_count);
+    archive->entry_count++;
+}
+
+// Empty entry i's slot by backward-shift deletion: later members of the probe
+// chain move up into the hole, so lookups need no tombstones.
+static void archive_index_erase(fossil_io_archive_t *archive, size_t i)
+{
+    size_t mask = archive->index_capacity - 1;
+    size_t hole = (size_t)archive_name_hash(archive->entries[i].name) & mask;
+    while (archive->index[hole] != i + 1)
+        hole = (hole + 1) & mask;
+
+    for (size_t slot = (hole + 1) & mask; archive->index[slot] != ARCHIVE_INDEX_EMPTY; slot = (slot + 1) & mask)
+    {
+        size_t home = (size_t)archive_name_hash(archive->entries[archive->index[slot] - 1].name) & mask;
+        // Move only if the hole lies on the way from home to slot
+        if (((slot - home) & mask) >= ((slot - hole) & mask))
+        {
+            archive->index[hole] = archive->index[slot];
+            hole = slot;
+        }
+    }
+    archive->index[hole] = ARCHIVE_INDEX_EMPTY;
+}
+
+// Drop entry i from the table, preserving the order of the rest.
+static void archive_drop_entry(fossil_io_archive_t *archive, size_t i)
+{
+    archive_index_erase(archive, i);
+    if (i + 1 < archive->entry_count)
+    {
+        // Later entries move down one place; renumber their slots to match
+        for (size_t slot = 0; slot < archive->index_capacity; slot++)
+            if (archive->index[slot] > i + 1)
+                archive->index[slot]--;
+    }
+
+    size_t tail = archive->entry_count - i - 1;
+    memmove(&archive->entries[i], &archive->entries[i + 1], tail * sizeof(fossil_io_archive_entry_t));
+    memmove(&archive->positions[i], &archive->positions[i + 1], tail * sizeof(fossil_io_archive_pos_t));
+    archive->entry_count--;
+}
+
+// Return the entry named name, creating and publishing it if it is new.
+static fossil_io_archive_entry_t *archive_upsert_entry(fossil_io_archive_t *archive, const char *name)
+{
+    size_t index = archive_find(archive, name);
+    if (index != ARCHIVE_NOT_FOUND)
+        return &archive->entries[index];
+
+    fossil_io_archive_entry_t *entry = NULL;
+    if (!archive_push_entry(archive, &entry))
+        return NULL;
+    entry->name = archive_intern(archive, name);
+    if (!entry->name)
+        return NULL;
+    archive_commit_entry(archive);
+    return entry;
+}
+
+// ======================================================
+// On-disk stream helpers
+// ======================================================
+
+#define ARCHIVE_COPY_BUFFER (1024 * 1024)
+
+static bool archive_read_at(fossil_io_archive_t *archive, uint64_t offset, void *buf, size_t len)
+{
+    if (archive_seek(archive->stream, (archive_off_t)offset, SEEK_SET) != 0)
+        return false;
+    return fread(buf, 1, len, archive->stream) == len;
+}
+
+static bool archive_write_at(fossil_io_archive_t *archive, uint64_t offset, const void *buf, size_t len)
+{
+    if (archive_seek(archive->stream, (archive_off_t)offset, SEEK_SET) != 0)
+        return false;
+    return fwrite(buf, 1, len, archive->stream) == len;
+}
+
+static unsigned char *archive_buffer(fossil_io_archive_t *archive)
+{
+    if (!archive->buffer)
+        archive->buffer = malloc(ARCHIVE_COPY_BUFFER);
+    return archive->buffer;
+}
+
+// Reserve an output file's extent up front; unsupported filesystems just skip it.
+static void archive_preallocate(FILE *out, uint64_t size)
+{
+#ifdef __linux__
+    if (size > 0)
+        (void)fallocate(fileno(out), 0, 0, (off_t)size);
+#else
+    (void)out;
+    (void)size;
+#endif
+}
+
+// Restore an extracted file's permissions and modification time.
+static void archive_apply_metadata(const char *path, const fossil_io_archive_entry_t *entry)
+{
+#ifndef _WIN32
+    chmod(path, (mode_t)(entry->permissions ? entry->permissions : 0644));
+    struct utimbuf times;
+    times.actime = (time_t)entry->modified_time;
+    times.modtime = (time_t)entry->modified_time;
+    utime(path, &times);
+#else
+    (void)path;
+    (void)entry;
+#endif
+}
+
+#if defined(__linux__) && defined(__NR_copy_file_range)
+static ssize_t archive_copy_file_range(int in, uint64_t *in_off, int out, uint64_t *out_off, size_t len)
+{
+    int64_t ioff = in_off ? (int64_t)*in_off : 0;
+    int64_t ooff = out_off ? (int64_t)*out_off : 0;
+    ssize_t n = (ssize_t)syscall(__NR_copy_file_range, in, in_off ? &ioff : NULL, out, out_off ? &ooff : NULL, len, 0u);
+    if (n > 0)
+    {
+        if (in_off)
+            *in_off = (uint64_t)ioff;
+        if (out_off)
+            *out_off = (uint64_t)ooff;
+    }
+    return n;
+}
+#endif
+
+/*
+ * Stream `size` bytes from src (at src_off) to dst (at dst_off). The kernel
+ * copies directly where it can; otherwise buf (ARCHIVE_COPY_BUFFER bytes, or
+ * NULL for kernel-only) is used. Returns the number of bytes copied, which is
+ * short only if src ran dry.
+ */
+static uint64_t archive_copy_stream(unsigned char *buf, FILE *src, uint64_t src_off,
+                                    FILE *dst, uint64_t dst_off, uint64_t size, bool *failed)
+{
+    uint64_t copied = 0;
+    *failed = false;
+
+    fflush(src);
+    fflush(dst);
+
+#if defined(__linux__) && defined(__NR_copy_file_range)
+    while (copied < size)
+    {
+        size_t chunk = (size - copied) > (1u << 30) ? (1u << 30) : (size_t)(size - copied);
+        uint64_t in_off = src_off + copied, out_off = dst_off + copied;
+        ssize_t n = archive_copy_file_range(fileno(src), &in_off, fileno(dst), &out_off, chunk);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break; // unsupported here or source exhausted: finish in userspace
+        copied += (uint64_t)n;
+    }
+#endif
+
+    if (!buf)
+    {
+        *failed = copied < size;
+        return copied;
+    }
+
+    while (copied < size)
+    {
+        size_t chunk = (size - copied) > ARCHIVE_COPY_BUFFER ? ARCHIVE_COPY_BUFFER : (size_t)(size - copied);
+        if (archive_seek(src, (archive_off_t)(src_off + copied), SEEK_SET) != 0)
+            break;
+        size_t n = fread(buf, 1, chunk, src);
+        if (n == 0)
+            break;
+        if (archive_seek(dst, (archive_off_t)(dst_off + copied), SEEK_SET) != 0 ||
+            fwrite(buf, 1, n, dst) != n)
+        {
+            *failed = true;
+            break;
+        }
+        copied += n;
+    }
+
+    return copied;
+}
+
+// One past an entry's last byte. ZIP records may trail a data descriptor, so
+// without a recorded end the entry runs up to the next record.
+static uint64_t archive_entry_end(const fossil_io_archive_t *archive, size_t index)
+{
+    const fossil_io_archive_pos_t *pos = &archive->positions[index];
+    if (pos->end_offset)
+        return pos->end_offset;
+
+    uint64_t end = archive->write_offset;
+    for (size_t j = 0; j < archive->entry_count; j++)
+    {
+        uint64_t other = archive->positions[j].header_offset;
+        if (other > pos->header_offset && other < end)
+            end = other;
+    }
+    return end;
+}
+
+// Cut the bytes [start, end) from the archive by sliding later records down.
+static bool archive_cut(fossil_io_archive_t *archive, uint64_t start, uint64_t end)
+{
+    uint64_t delta = end - start;
+
+    unsigned char *buf = archive_buffer(archive);
+    if (!buf)
+        return false;
+
+    fflush(archive->stream);
+    for (uint64_t from = end; from < archive->write_offset;)
+    {
+        size_t chunk = (archive->write_offset - from) > ARCHIVE_COPY_BUFFER ? ARCHIVE_COPY_BUFFER
+                                                                              : (size_t)(archive->write_offset - from);
+        if (!archive_read_at(archive, from, buf, chunk) || !archive_write_at(archive, from - delta, buf, chunk))
+            return false;
+        from += chunk;
+    }
+
+    for (size_t j = 0; j < archive->entry_count; j++)
+    {
+        fossil_io_archive_pos_t *pos = &archive->positions[j];
+        if (pos->header_offset <= start)
+            continue;
+        pos->header_offset -= delta;
+        if (pos->data_offset)
+            pos->data_offset -= delta;
+        if (pos->end_offset)
+            pos->end_offset -= delta;
+    }
+    for (size_t j = 0; j < archive->shadow_count; j++)
+    {
+        fossil_io_archive_shadow_t *shadow = &archive->shadows[j];
+        if (shadow->start <= start)
+            continue;
+        shadow->start -= delta;
+        shadow->end -= delta;
+    }
+    archive->write_offset -= delta;
+    archive->dirty = true;
+    return true;
+}
+
+// Drop an entry's bytes from the archive, along with every older record of
+// the same name that would otherwise reappear once it is gone.
+static bool archive_remove_entry(fossil_io_archive_t *archive, size_t index)
+{
+    const char *name = archive->entries[index].name;
+    for (size_t j = archive->shadow_count; j-- > 0;)
+    {
+        fossil_io_archive_shadow_t shadow = archive->shadows[j];
+        if (strcmp(shadow.name, name) != 0)
+            continue;
+        archive->shadows[j] = archive->shadows[--archive->shadow_count];
+        if (!archive_cut(archive, shadow.start, shadow.end))
+            return false;
+    }
+
+    if (!archive_cut(archive, archive->positions[index].header_offset, archive_entry_end(archive, index)))
+        return false;
+    archive_drop_entry(archive, index);
+    return true;
+}
+
+// Re-adding a name replaces the existing record instead of shadowing it.
+static bool archive_replace_existing(fossil_io_archive_t *archive, const char *name)
+{
+    size_t existing = archive_find(archive, name);
+    return existing == ARCHIVE_NOT_FOUND || archive_remove_entry(archive, existing);
+}
+
+// ======================================================
+// TAR backend (ustar + pax)
+// ======================================================
+
+#define TAR_BLOCK 512
+#define TAR_PAX_MAX (1024 * 1024)
+#define TAR_OCTAL_SIZE_MAX 077777777777ULL
+
+static uint64_t tar_round_up(uint64_t size)
+{
+    return (size + TAR_BLOCK - 1) & ~(uint64_t)(TAR_BLOCK - 1);
+}
+
+static bool tar_write_zeros(fossil_io_archive_t *archive, uint64_t offset, uint64_t len)
+{
+    static const unsigned char zeros[TAR_BLOCK] = {0};
+
+    while (len > 0)
+    {
+        size_t n = len < sizeof(zeros) ? (size_t)len : sizeof(zeros);
+        if (!archive_write_at(archive, offset, zeros, n))
+            return false;
+        offset += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Numeric fields are NUL-terminated octal, or GNU base-256 when too large.
+static uint64_t tar_get_number(const char *field, size_t width)
+{
+    const unsigned char *p = (const unsigned char *)field;
+    uint64_t value = 0;
+
+    if (p[0] & 0x80)
+    {
+        for (size_t i = 1; i < width; i++)
+            value = (value << 8) | p[i];
+        return value;
+    }
+
+    size_t i = 0;
+    while (i < width && (p[i] == ' ' || p[i] == '\0'))
+        i++;
+    for (; i < width && p[i] >= '0' && p[i] <= '7'; i++)
+        value = (value << 3) | (uint64_t)(p[i] - '0');
+    return value;
+}
+
+static void tar_put_number(char *field, size_t width, uint64_t value)
+{
+    uint64_t limit = (uint64_t)1 << (3 * (width - 1));
+
+    if (value < limit)
+    {
+        field[width - 1] = '\0';
+        for (size_t i = width - 1; i-- > 0;)
+        {
+            field[i] = (char)('0' + (value & 7));
+            value >>= 3;
+        }
+        return;
+    }
+
+    memset(field, 0, width);
+    field[0] = (char)0x80;
+    for (size_t i = width; i-- > 1 && value;)
+    {
+        field[i] = (char)(value & 0xff);
+        value >>= 8;
+    }
+}
+
+static unsigned int tar_checksum(const unsigned char *hdr)
+{
+    unsigned int sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK; i++)
+        sum += (i >= 148 && i < 156) ? ' ' : hdr[i];
+    return sum;
+}
+
+static bool tar_block_is_zero(const unsigned char *hdr)
+{
+    for (size_t i = 0; i < TAR_BLOCK; i++)
+        if (hdr[i])
+            return false;
+    return true;
+}
+
+static char *tar_field_dup(const char *field, size_t width)
+{
+    size_t len = 0;
+    while (len < width && field[len])
+        len++;
+
+    char *out = malloc(len + 1);
+    if (!out)
+        return NULL;
+    memcpy(out, field, len);
+    out[len] = '\0';
+    return out;
+}
+
+// Parse pax "len key=value\n" records, keeping the ones this backend uses.
+static void tar_parse_pax(const char *data, size_t len, char **path, uint64_t *size, bool *has_size, uint64_t *mtime, bool *has_mtime)
+{
+    size_t pos = 0;
+
+    while (pos < len)
+    {
+        size_t rec_len = 0;
+        size_t p = pos;
+        while (p < len && data[p] >= '0' && data[p] <= '9')
+            rec_len = rec_len * 10 + (size_t)(data[p++] - '0');
+        if (rec_len == 0 || pos + rec_len > len || p >= len || data[p] != ' ')
+            return;
+
+        const char *key = data + p + 1;
+        const char *end = data + pos + rec_len - 1; // trailing '\n'
+        const char *eq = memchr(key, '=', (size_t)(end - key));
+        if (eq)
+        {
+            size_t key_len = (size_t)(eq - key);
+            const char *value = eq + 1;
+            size_t value_len = (size_t)(end - value);
+
+            if (key_len == 4 && memcmp(key, "path", 4) == 0)
+            {
+                char *copy = malloc(value_len + 1);
+                if (copy)
+                {
+                    memcpy(copy, value, value_len);
+                    copy[value_len] = '\0';
+                    free(*path);
+                    *path = copy;
+                }
+            }
+            else if (key_len == 4 && memcmp(key, "size", 4) == 0)
+            {
+                *size = strtoull(value, NULL, 10);
+                *has_size = true;
+            }
+            else if (key_len == 5 && memcmp(key, "mtime", 5) == 0)
+            {
+                *mtime = strtoull(value, NULL, 10);
+                *has_mtime = true;
+            }
+        }
+        pos += rec_len;
+    }
+}
+
+// Build the entry index by walking headers and seeking over file bodies.
+static bool tar_scan(fossil_io_archive_t *archive)
+{
+    unsigned char hdr[TAR_BLOCK];
+    uint64_t offset = 0;
+    uint64_t entry_start = 0;
+    bool pending = false;
+
+    char *long_name = NULL;
+    char *pax_path = NULL;
+    uint64_t pax_size = 0, pax_mtime = 0;
+    bool has_pax_size = false, has_pax_mtime = false;
+    bool ok = true;
+
+    while (archive_read_at(archive, offset, hdr, sizeof(hdr)) && !tar_block_is_zero(hdr))
+    {
+        if ((unsigned int)tar_get_number((const char *)hdr + 148, 8) != tar_checksum(hdr))
+        {
+            ok = false;
+            break;
+        }
+
+        if (!pending)
+            entry_start = offset;
+
+        char type = (char)hdr[156];
+        uint64_t size = tar_get_number((const char *)hdr + 124, 12);
+        uint64_t body = offset + TAR_BLOCK;
+
+        if (type == 'x' || type == 'L')
+        {
+            // Per-entry metadata: small, so the body is read into memory
+            if (size > TAR_PAX_MAX)
+            {
+                ok = false;
+                break;
+            }
+            char *data = malloc((size_t)size + 1);
+            if (!data || !archive_read_at(archive, body, data, (size_t)size))
+            {
+                free(data);
+                ok = false;
+                break;
+            }
+            data[size] = '\0';
+
+            if (type == 'x')
+            {
+                tar_parse_pax(data, (size_t)size, &pax_path, &pax_size, &has_pax_size, &pax_mtime, &has_pax_mtime);
+                free(data);
+            }
+            else
+            {
+                free(long_name);
+                long_name = data;
+            }
+            pending = true;
+            offset = body + tar_round_up(size);
+            continue;
+        }
+
+        if (type == 'g' || type == 'K')
+        {
+            pending = true;
+            offset = body + tar_round_up(size);
+            continue;
+        }
+
+        if (has_pax_size)
+            size = pax_size;
+
+        char *name = NULL;
+        if (pax_path)
+        {
+            name = pax_path;
+            pax_path = NULL;
+        }
+        else if (long_name)
+        {
+            name = long_name;
+            long_name = NULL;
+        }
+        else
+        {
+            char *base = tar_field_dup((const char *)hdr, 100);
+            char *prefix = (memcmp(hdr + 257, "ustar", 5) == 0) ? tar_field_dup((const char *)hdr + 345, 155) : NULL;
+            if (base && prefix && prefix[0])
+            {
+                size_t len = strlen(prefix) + strlen(base) + 2;
+                name = malloc(len);
+                if (name)
+                    snprintf(name, len, "%s/%s", prefix, base);
+                free(base);
+            }
+            else
+            {
+                name = base;
+            }
+            free(prefix);
+        }
+
+        if (!name)
+        {
+            ok = false;
+            break;
+        }
+
+        size_t name_len = strlen(name);
+        bool is_dir = (type == '5');
+        while (name_len > 1 && name[name_len - 1] == '/')
+        {
+            name[--name_len] = '\0';
+            is_dir = true;
+        }
+
+        // A later record for the same name supersedes the earlier one, as with tar(1)
+        size_t slot = archive_find(archive, name);
+        fossil_io_archive_entry_t *entry = NULL;
+        if (slot != ARCHIVE_NOT_FOUND)
+        {
+            entry = &archive->entries[slot];
+            if (!archive_push_shadow(archive, entry->name, &archive->positions[slot]))
+                entry = NULL;
+        }
+        else if (archive_push_entry(archive, &entry))
+        {
+            slot = archive->entry_count;
+            entry->name = archive_intern(archive, name);
+        }
+        free(name);
+        if (!entry || !entry->name)
+        {
+            ok = false;
+            break;
+        }
+
+        uint64_t mtime = has_pax_mtime ? pax_mtime : tar_get_number((const char *)hdr + 136, 12);
+        bool has_body = (type == '0' || type == '\0' || type == '7');
+
+        entry->size = has_body ? (size_t)size : 0;
+        entry->compressed_size = entry->size;
+        entry->is_directory = is_dir;
+        entry->is_encrypted = false;
+        entry->modified_time = mtime;
+        entry->created_time = mtime;
+        entry->crc32 = 0;
+        entry->permissions = (uint32_t)(tar_get_number((const char *)hdr + 100, 8) & 07777);
+
+        archive->positions[slot].header_offset = entry_start;
+        archive->positions[slot].data_offset = body;
+        archive->positions[slot].end_offset = body + tar_round_up(size);
+        archive->positions[slot].type = has_body ? '0' : (is_dir ? '5' : type);
+        if (slot == archive->entry_count)
+            archive_commit_entry(archive);
+
+        pending = false;
+        has_pax_size = has_pax_mtime = false;
+        offset = body + tar_round_up(size);
+    }
+
+    free(long_name);
+    free(pax_path);
+
+    archive->write_offset = pending ? entry_start : offset;
+    return ok;
+}
+
+static size_t tar_pax_record(char *out, size_t cap, const char *key, const char *value)
+{
+    // The length prefix counts its own digits.
+    size_t body = strlen(key) + strlen(value) + 3;
+    size_t len = body + 1;
+    while (len < body + (size_t)snprintf(NULL, 0, "%zu", len))
+        len++;
+
+    if (out && len <= cap)
+        snprintf(out, cap, "%zu %s=%s\n", len, key, value);
+    return len;
+}
+
+// ustar name/prefix split; false when the name needs a pax path record.
+static bool tar_split_name(const char *name, char *hdr)
+{
+    size_t len = strlen(name);
+
+    if (len <= 100)
+    {
+        memcpy(hdr, name, len);
+        return true;
+    }
+
+    for (size_t i = 0; i < len && i <= 155; i++)
+    {
+        if (name[i] == '/' && len - i - 1 <= 100 && len - i - 1 > 0)
+        {
+            memcpy(hdr + 345, name, i);
+            memcpy(hdr, name + i + 1, len - i - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void tar_fill_header(unsigned char *hdr, const char *name, uint64_t size, uint32_t mode,
+                            uint64_t mtime, uint64_t uid, uint64_t gid, char type)
+{
+    memset(hdr, 0, TAR_BLOCK);
+
+    if (name)
+        tar_split_name(name, (char *)hdr);
+
+    tar_put_number((char *)hdr + 100, 8, mode & 07777);
+    tar_put_number((char *)hdr + 108, 8, uid <= 07777777 ? uid : 0);
+    tar_put_number((char *)hdr + 116, 8, gid <= 07777777 ? gid : 0);
+    tar_put_number((char *)hdr + 124, 12, size);
+    tar_put_number((char *)hdr + 136, 12, mtime);
+    hdr[156] = (unsigned char)type;
+    memcpy(hdr + 257, "ustar", 6);
+    memcpy(hdr + 263, "00", 2);
+
+    snprintf((char *)hdr + 148, 8, "%06o", tar_checksum(hdr));
+    hdr[155] = ' ';
+}
+
+// Write the (pax +) ustar header for an entry at the current write offset.
+static bool tar_write_header(fossil_io_archive_t *archive, const char *name, uint64_t size,
+                             uint32_t mode, uint64_t mtime, uint64_t uid, uint64_t gid, char type)
+{
+    unsigned char hdr[TAR_BLOCK];
+    char probe[TAR_BLOCK];
+    memset(probe, 0, sizeof(probe));
+
+    bool need_path = !tar_split_name(name, probe);
+    bool need_size = size > TAR_OCTAL_SIZE_MAX;
+
+    if (need_path || need_size)
+    {
+        char size_str[24];
+        snprintf(size_str, sizeof(size_str), "%llu", (unsigned long long)size);
+
+        size_t pax_len = (need_path ? tar_pax_record(NULL, 0, "path", name) : 0) +
+                         (need_size ? tar_pax_record(NULL, 0, "size", size_str) : 0);
+        char *pax = malloc(pax_len + 1);
+        if (!pax)
+            return false;
+
+        size_t used = 0;
+        if (need_path)
+            used += tar_pax_record(pax + used, pax_len + 1 - used, "path", name);
+        if (need_size)
+            used += tar_pax_record(pax + used, pax_len + 1 - used, "size", size_str);
+
+        tar_fill_header(hdr, "PaxHeader", used, 0644, mtime, 0, 0, 'x');
+        bool ok = archive_write_at(archive, archive->write_offset, hdr, TAR_BLOCK) &&
+                  archive_write_at(archive, archive->write_offset + TAR_BLOCK, pax, used) &&
+                  tar_write_zeros(archive, archive->write_offset + TAR_BLOCK + used, tar_round_up(used) - used);
+        free(pax);
+        if (!ok)
+            return false;
+        archive->write_offset += TAR_BLOCK + tar_round_up(used);
+    }
+
+    // With a pax path record the ustar name is only a truncated fallback.
+    char fallback[101];
+    const char *hdr_name = name;
+    if (need_path)
+    {
+        snprintf(fallback, sizeof(fallback), "%s", name + strlen(name) - (strlen(name) > 100 ? 100 : strlen(name)));
+        hdr_name = fallback;
+    }
+
+    tar_fill_header(hdr, hdr_name, size, mode, mtime, uid, gid, type);
+    if (!archive_write_at(archive, archive->write_offset, hdr, TAR_BLOCK))
+        return false;
+    archive->write_offset += TAR_BLOCK;
+    return true;
+}
+
+static bool tar_add_file(fossil_io_archive_t *archive, const char *src_path, const char *archive_path)
+{
+    archive_stat_t st;
+    if (archive_stat(src_path, &st) != 0)
+        return false;
+
+    FILE *src = fopen(src_path, "rb");
+    if (!src)
+        return false;
+    if (!archive_replace_existing(archive, archive_path))
+    {
+        fclose(src);
+        return false;
+    }
+
+    uint64_t size = (uint64_t)st.st_size;
+    uint64_t mtime = st.st_mtime > 0 ? (uint64_t)st.st_mtime : 0;
+    uint64_t header_offset = archive->write_offset;
+
+#ifdef _WIN32
+    uint64_t uid = 0, gid = 0;
+#else
+    uint64_t uid = (uint64_t)st.st_uid, gid = (uint64_t)st.st_gid;
+#endif
+
+    fossil_io_archive_entry_t *entry = NULL;
+    if (!archive_push_entry(archive, &entry) ||
+        !tar_write_header(archive, archive_path, size, (uint32_t)st.st_mode, mtime, uid, gid, '0'))
+    {
+        fclose(src);
+        archive->write_offset = header_offset;
+        return false;
+    }
+
+    uint64_t data_offset = archive->write_offset;
+    bool failed = false;
+    uint64_t copied = archive_copy_stream(archive_buffer(archive), src, 0, archive->stream, data_offset, size, &failed);
+    fclose(src);
+
+    // A file that shrank underneath us is zero-filled to its declared size.
+    if (failed || !tar_write_zeros(archive, data_offset + copied, tar_round_up(size) - copied))
+    {
+        archive->write_offset = header_offset;
+        return false;
+    }
+
+    entry->name = archive_intern(archive, archive_path);
+    if (!entry->name)
+    {
+        archive->write_offset = header_offset;
+        return false;
+    }
+
+    entry->size = (size_t)size;
+    entry->compressed_size = (size_t)size;
+    entry->is_directory = false;
+    entry->is_encrypted = false;
+    entry->modified_time = mtime;
+    entry->created_time = mtime;
+    entry->crc32 = 0;
+    entry->permissions = (uint32_t)st.st_mode & 07777;
+
+    archive->positions[archive->entry_count].header_offset = header_offset;
+    archive->positions[archive->entry_count].data_offset = data_offset;
+    archive->positions[archive->entry_count].end_offset = data_offset + tar_round_up(size);
+    archive->positions[archive->entry_count].type = '0';
+    archive_commit_entry(archive);
+    archive->write_offset = data_offset + tar_round_up(size);
+    return copied == size;
+}
+
+static bool tar_add_dir_entry(fossil_io_archive_t *archive, const char *archive_dir, uint32_t mode, uint64_t mtime)
+{
+    if (!archive_replace_existing(archive, archive_dir))
+        return false;
+
+    size_t len = strlen(archive_dir);
+    char *name = malloc(len + 2);
+    if (!name)
+        return false;
+    memcpy(name, archive_dir, len);
+    name[len] = '/';
+    name[len + 1] = '\0';
+    if (len > 0 && archive_dir[len - 1] == '/')
+        name[len] = '\0';
+
+    uint64_t header_offset = archive->write_offset;
+    fossil_io_archive_entry_t *entry = NULL;
+    bool ok = archive_push_entry(archive, &entry) &&
+              tar_write_header(archive, name, 0, mode, mtime, 0, 0, '5');
+    free(name);
+
+    if (ok)
+    {
+        entry->name = archive_intern(archive, archive_dir);
+        ok = entry->name != NULL;
+    }
+    if (!ok)
+    {
+        archive->write_offset = header_offset;
+        return false;
+    }
+
+    entry->is_directory = true;
+    entry->modified_time = mtime;
+    entry->created_time = mtime;
+    entry->permissions = mode & 07777;
+
+    archive->positions[archive->entry_count].header_offset = header_offset;
+    archive->positions[archive->entry_count].data_offset = archive->write_offset;
+    archive->positions[archive->entry_count].end_offset = archive->write_offset;
+    archive->positions[archive->entry_count].type = '5';
+    archive_commit_entry(archive);
+    return true;
+}
+
+// Reject absolute paths and ".." components so extraction stays under dest.
+static bool archive_entry_name_is_safe(const char *name)
+{
+    if (!name || !name[0] || name[0] == '/' || name[0] == '\\')
+        return false;
+    if (strlen(name) >= 2 && name[1] == ':')
+        return false;
+
+    const char *p = name;
+    while (*p)
+    {
+        const char *end = p;
+        while (*end && *end != '/' && *end != '\\')
+            end++;
+        if (end - p == 2 && p[0] == '.' && p[1] == '.')
+            return false;
+        p = *end ? end + 1 : end;
+    }
+    return true;
+}
+
+// Write one regular-file entry from src (positioned by offset) to dest_path.
+static bool tar_extract_from(const fossil_io_archive_entry_t *entry, const fossil_io_archive_pos_t *pos,
+                             FILE *src, unsigned char *buf, const char *dest_path)
+{
+    FILE *out = fopen(dest_path, "wb");
+    if (!out)
+        return false;
+    archive_preallocate(out, entry->size);
+
+    bool failed = false;
+    uint64_t copied = archive_copy_stream(buf, src, pos->data_offset, out, 0, entry->size, &failed);
+    bool ok = (fclose(out) == 0) && !failed && copied == entry->size;
+    if (ok)
+        archive_apply_metadata(dest_path, entry);
+    return ok;
+}
+
+static bool tar_extract_entry(fossil_io_archive_t *archive, size_t index, const char *dest_path)
+{
+    const fossil_io_archive_pos_t *pos = &archive->positions[index];
+
+    if (pos->type == '5')
+        return fossil_io_create_directories(dest_path);
+    if (pos->type != '0')
+        return false; // links and special files are listed but not materialised
+
+    return tar_extract_from(&archive->entries[index], pos, archive->stream, archive_buffer(archive), dest_path);
+}
+
+static bool tar_open_stream(fossil_io_archive_t *archive)
+{
+    if (archive->mode & FOSSIL_IO_ARCHIVE_APPEND)
+    {
+        archive->stream = fopen(archive->path, "r+b");
+        if (archive->stream)
+            return tar_scan(archive);
+        archive->stream = fopen(archive->path, "w+b");
+    }
+    else if (archive->mode & FOSSIL_IO_ARCHIVE_WRITE)
+    {
+        archive->stream = fopen(archive->path, "w+b");
+    }
+    else
+    {
+        archive->stream = fopen(archive->path, "rb");
+        if (archive->stream)
+            return tar_scan(archive);
+    }
+
+    return archive->stream != NULL;
+}
+
+// Terminate a writable archive with the two zero blocks and trim leftovers.
+static bool tar_finish(fossil_io_archive_t *archive)
+{
+    if (!(archive->mode & (FOSSIL_IO_ARCHIVE_WRITE | FOSSIL_IO_ARCHIVE_APPEND)))
+        return true;
+
+    uint64_t end = archive->write_offset + 2 * TAR_BLOCK;
+    bool ok = tar_write_zeros(archive, archive->write_offset, 2 * TAR_BLOCK) && fflush(archive->stream) == 0;
+
+#ifdef _WIN32
+    ok = ok && _chsize_s(_fileno(archive->stream), (__int64)end) == 0;
+#else
+    ok = ok && ftruncate(fileno(archive->stream), (off_t)end) == 0;
+#endif
+    return ok;
+}
+
+// ======================================================
+// DEFLATE codec (RFC 1951) and CRC-32
+// ======================================================
+
+static uint32_t archive_crc_table[8][256];
+
+static void archive_crc_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        archive_crc_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        for (int k = 1; k < 8; k++)
+        {
+            uint32_t prev = archive_crc_table[k - 1][i];
+            archive_crc_table[k][i] = (prev >> 8) ^ archive_crc_table[0][prev & 0xFF];
+        }
+    }
+}
+
+#ifdef _WIN32
+static INIT_ONCE archive_crc_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK archive_crc_init_once(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    (void)once;
+    (void)param;
+    (void)context;
+    archive_crc_init();
+    return TRUE;
+}
+#else
+static pthread_once_t archive_crc_once = PTHREAD_ONCE_INIT;
+#endif
+
+// Update a running CRC-32 (start from 0); slice-by-8 over the aligned middle.
+static uint32_t archive_crc32(uint32_t crc, const unsigned char *p, size_t len)
+{
+#ifdef _WIN32
+    InitOnceExecuteOnce(&archive_crc_once, archive_crc_init_once, NULL, NULL);
+#else
+    pthread_once(&archive_crc_once, archive_crc_init);
+#endif
+
+    uint32_t c = ~crc;
+    while (len >= 8)
+    {
+        uint32_t one = c ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        uint32_t two = (uint32_t)p[4] | (uint32_t)p[5] << 8 | (uint32_t)p[6] << 16 | (uint32_t)p[7] << 24;
+        c = archive_crc_table[7][one & 0xFF] ^ archive_crc_table[6][(one >> 8) & 0xFF] ^
+            archive_crc_table[5][(one >> 16) & 0xFF] ^ archive_crc_table[4][one >> 24] ^
+            archive_crc_table[3][two & 0xFF] ^ archive_crc_table[2][(two >> 8) & 0xFF] ^
+            archive_crc_table[1][(two >> 16) & 0xFF] ^ archive_crc_table[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        c = archive_crc_table[0][(c ^ *p++) & 0xFF] ^ (c >> 8);
+    return ~c;
+}
+
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_MAX_BITS 15
+#define DEFLATE_FAST_BITS 10
+
+static const uint16_t deflate_len_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                              31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t deflate_len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                              2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t deflate_dist_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                               193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                               6145, 8193, 12289, 16385, 24577};
+static const uint8_t deflate_dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                               6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static uint32_t deflate_reverse(uint32_t code, unsigned len)
+{
+    uint32_t out = 0;
+    while (len--)
+    {
+        out = (out << 1) | (code & 1);
+        code >>= 1;
+    }
+    return out;
+}
+
+// Canonical Huffman decoder: a direct table for short codes, counts for the rest.
+typedef struct
+{
+    uint16_t count[DEFLATE_MAX_BITS + 1];
+    uint16_t symbol[320];
+    uint16_t fast[1 << DEFLATE_FAST_BITS]; // (symbol << 4) | length, 0 if longer
+} inflate_huffman_t;
+
+static bool inflate_build(inflate_huffman_t *h, const uint8_t *lengths, size_t n)
+{
+    uint16_t offs[DEFLATE_MAX_BITS + 1];
+
+    memset(h->count, 0, sizeof(h->count));
+    memset(h->fast, 0, sizeof(h->fast));
+    for (size_t i = 0; i < n; i++)
+        h->count[lengths[i]]++;
+    h->count[0] = 0;
+
+    int left = 1;
+    for (int len = 1; len <= DEFLATE_MAX_BITS; len++)
+    {
+        left = (left << 1) - h->count[len];
+        if (left < 0)
+            return false; // over-subscribed
+    }
+
+    offs[1] = 0;
+    for (int len = 1; len < DEFLATE_MAX_BITS; len++)
+        offs[len + 1] = (uint16_t)(offs[len] + h->count[len]);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (lengths[i])
+            h->symbol[offs[lengths[i]]++] = (uint16_t)i;
+    }
+
+    uint32_t code = 0;
+    size_t index = 0;
+    for (unsigned len = 1; len <= DEFLATE_FAST_BITS; len++)
+    {
+        for (unsigned k = 0; k < h->count[len]; k++, code++, index++)
+        {
+            uint32_t rev = deflate_reverse(code, len);
+            for (uint32_t fill = rev; fill < (1u << DEFLATE_FAST_BITS); fill += 1u << len)
+                h->fast[fill] = (uint16_t)((h->symbol[index] << 4) | len);
+        }
+        code <<= 1;
+    }
+    return true;
+}
+
+typedef struct
+{
+    const unsigned char *in;
+    size_t in_len;
+    size_t in_pos;
+    uint64_t bits;
+    unsigned count;
+    unsigned char *out; // window + pending output
+    size_t out_len;
+    size_t out_flushed;
+    size_t out_cap;
+    FILE *sink;
+    uint32_t crc;
+    uint64_t total;
+    bool failed;
+} inflate_state_t;
+
+static void inflate_refill(inflate_state_t *s)
+{
+    while (s->count <= 56 && s->in_pos < s->in_len)
+    {
+        s->bits |= (uint64_t)s->in[s->in_pos++] << s->count;
+        s->count += 8;
+    }
+}
+
+static uint32_t inflate_bits(inflate_state_t *s, unsigned n)
+{
+    if (s->count < n)
+    {
+        inflate_refill(s);
+        if (s->count < n)
+        {
+            s->failed = true;
+            return 0;
+        }
+    }
+    uint32_t v = (uint32_t)(s->bits & ((1u << n) - 1));
+    s->bits >>= n;
+    s->count -= n;
+    return v;
+}
+
+static int inflate_decode(inflate_state_t *s, const inflate_huffman_t *h)
+{
+    if (s->count < DEFLATE_MAX_BITS)
+        inflate_refill(s);
+
+    uint16_t e = h->fast[s->bits & ((1u << DEFLATE_FAST_BITS) - 1)];
+    if (e && (unsigned)(e & 15) <= s->count)
+    {
+        s->bits >>= (e & 15);
+        s->count -= (e & 15);
+        return e >> 4;
+    }
+
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= DEFLATE_MAX_BITS; len++)
+    {
+        code |= (int)inflate_bits(s, 1);
+        if (s->failed)
+            return -1;
+        int count = h->count[len];
+        if (code - count < first)
+            return h->symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+// Hand finished output to the sink, keeping the last 32 KiB as match history.
+static void inflate_flush(inflate_state_t *s)
+{
+    size_t pending = s->out_len - s->out_flushed;
+    if (pending)
+    {
+        s->crc = archive_crc32(s->crc, s->out + s->out_flushed, pending);
+        if (fwrite(s->out + s->out_flushed, 1, pending, s->sink) != pending)
+            s->failed = true;
+        s->total += pending;
+    }
+    if (s->out_len > DEFLATE_WINDOW)
+    {
+        memmove(s->out, s->out + s->out_len - DEFLATE_WINDOW, DEFLATE_WINDOW);
+        s->out_len = DEFLATE_WINDOW;
+    }
+    s->out_flushed = s->out_len;
+}
+
+static bool inflate_codes(inflate_state_t *s, const inflate_huffman_t *lit, const inflate_huffman_t *dist)
+{
+    for (;;)
+    {
+        if (s->out_len + DEFLATE_MAX_MATCH > s->out_cap)
+            inflate_flush(s);
+
+        int sym = inflate_decode(s, lit);
+        if (sym < 0 || s->failed)
+            return false;
+        if (sym < 256)
+        {
+            s->out[s->out_len++] = (unsigned char)sym;
+            continue;
+        }
+        if (sym == 256)
+            return true;
+
+        sym -= 257;
+        if (sym >= 29)
+            return false;
+        size_t len = deflate_len_base[sym] + inflate_bits(s, deflate_len_extra[sym]);
+
+        int dsym = inflate_decode(s, dist);
+        if (dsym < 0 || dsym >= 30)
+            return false;
+        size_t d = deflate_dist_base[dsym] + inflate_bits(s, deflate_dist_extra[dsym]);
+        if (s->failed || d > s->out_len)
+            return false;
+
+        unsigned char *dst = s->out + s->out_len;
+        const unsigned char *src = dst - d;
+        if (d >= len)
+        {
+            memcpy(dst, src, len);
+        }
+        else
+        {
+            for (size_t i = 0; i < len; i++)
+                dst[i] = src[i];
+        }
+        s->out_len += len;
+    }
+}
+
+static bool inflate_stored(inflate_state_t *s)
+{
+    // Return whole bytes still held in the bit buffer to the input.
+    s->bits >>= s->count & 7;
+    s->count -= s->count & 7;
+    s->in_pos -= s->count / 8;
+    s->bits = 0;
+    s->count = 0;
+
+    if (s->in_pos + 4 > s->in_len)
+        return false;
+    size_t len = (size_t)s->in[s->in_pos] | (size_t)s->in[s->in_pos + 1] << 8;
+    size_t nlen = (size_t)s->in[s->in_pos + 2] | (size_t)s->in[s->in_pos + 3] << 8;
+    s->in_pos += 4;
+    if (len != (~nlen & 0xFFFF) || s->in_pos + len > s->in_len)
+        return false;
+
+    while (len > 0)
+    {
+        if (s->out_len == s->out_cap)
+            inflate_flush(s);
+        size_t n = s->out_cap - s->out_len;
+        if (n > len)
+            n = len;
+        memcpy(s->out + s->out_len, s->in + s->in_pos, n);
+        s->out_len += n;
+        s->in_pos += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool inflate_dynamic(inflate_state_t *s, inflate_huffman_t *lit, inflate_huffman_t *dist)
+{
+    static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    uint8_t lengths[320];
+
+    size_t nlen = inflate_bits(s, 5) + 257;
+    size_t ndist = inflate_bits(s, 5) + 1;
+    size_t ncode = inflate_bits(s, 4) + 4;
+    if (s->failed || nlen > 286 || ndist > 30)
+        return false;
+
+    memset(lengths, 0, 19);
+    for (size_t i = 0; i < ncode; i++)
+        lengths[order[i]] = (uint8_t)inflate_bits(s, 3);
+    if (s->failed || !inflate_build(lit, lengths, 19))
+        return false;
+
+    size_t i = 0;
+    while (i < nlen + ndist)
+    {
+        int sym = inflate_decode(s, lit);
+        if (sym < 0)
+            return false;
+        if (sym < 16)
+        {
+            lengths[i++] = (uint8_t)sym;
+            continue;
+        }
+
+        uint8_t value = 0;
+        size_t repeat;
+        if (sym == 16)
+        {
+            if (i == 0)
+                return false;
+            value = lengths[i - 1];
+            repeat = 3 + inflate_bits(s, 2);
+        }
+        else if (sym == 17)
+        {
+            repeat = 3 + inflate_bits(s, 3);
+        }
+        else
+        {
+            repeat = 11 + inflate_bits(s, 7);
+        }
+        if (s->failed || i + repeat > nlen + ndist)
+            return false;
+        while (repeat--)
+            lengths[i++] = value;
+    }
+
+    if (lengths[256] == 0)
+        return false;
+    return inflate_build(lit, lengths, nlen) && inflate_build(dist, lengths + nlen, ndist);
+}
+
+/*
+ * Inflate a complete raw DEFLATE stream held in memory into sink. The
+ * output goes through a bounded window, so memory use does not depend on
+ * the entry size. Returns false on malformed input or a write error.
+ */
+static bool archive_inflate(const unsigned char *in, size_t in_len, FILE *sink, uint32_t *crc, uint64_t *total)
+{
+    inflate_state_t s;
+    memset(&s, 0, sizeof(s));
+    s.in = in;
+    s.in_len = in_len;
+    s.sink = sink;
+    s.out_cap = 4 * DEFLATE_WINDOW;
+    s.out = malloc(s.out_cap);
+
+    inflate_huffman_t *tables = malloc(2 * sizeof(inflate_huffman_t));
+    bool ok = s.out && tables;
+
+    bool last = false;
+    while (ok && !last)
+    {
+        last = inflate_bits(&s, 1) != 0;
+        uint32_t type = inflate_bits(&s, 2);
+        if (s.failed)
+            ok = false;
+        else if (type == 0)
+            ok = inflate_stored(&s);
+        else if (type == 1)
+        {
+            uint8_t lengths[320];
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            memset(lengths + 288, 5, 30);
+            ok = inflate_build(&tables[0], lengths, 288) && inflate_build(&tables[1], lengths + 288, 30) &&
+                 inflate_codes(&s, &tables[0], &tables[1]);
+        }
+        else if (type == 2)
+            ok = inflate_dynamic(&s, &tables[0], &tables[1]) && inflate_codes(&s, &tables[0], &tables[1]);
+        else
+            ok = false;
+    }
+    if (ok)
+        inflate_flush(&s);
+
+    *crc = s.crc;
+    *total = s.total;
+    free(s.out);
+    free(tables);
+    return ok && !s.failed;
+}
+
+typedef struct
+{
+    FILE *out;
+    unsigned char *buf;
+    size_t len;
+    size_t cap;
+    uint64_t bits;
+    unsigned count;
+    uint64_t total;
+    bool failed;
+} deflate_writer_t;
+
+static void deflate_flush(deflate_writer_t *w)
+{
+    if (w->len && fwrite(w->buf, 1, w->len, w->out) != w->len)
+        w->failed = true;
+    w->total += w->len;
+    w->len = 0;
+}
+
+static void deflate_put(deflate_writer_t *w, uint32_t value, unsigned n)
+{
+    w->bits |= (uint64_t)value << w->count;
+    w->count += n;
+    while (w->count >= 8)
+    {
+        w->buf[w->len++] = (unsigned char)w->bits;
+        w->bits >>= 8;
+        w->count -= 8;
+        if (w->len == w->cap)
+            deflate_flush(w);
+    }
+}
+
+typedef struct
+{
+    uint16_t lit_code[288]; // bit-reversed fixed codes
+    uint8_t lit_bits[288];
+    uint8_t len_sym[DEFLATE_MAX_MATCH + 1];
+    uint8_t dist_small[513]; // distance code for d <= 512
+    uint8_t dist_large[256]; // distance code for (d - 1) >> 8
+} deflate_tables_t;
+
+static void deflate_init_tables(deflate_tables_t *t)
+{
+    for (uint32_t v = 0; v < 288; v++)
+    {
+        uint32_t code;
+        unsigned bits;
+        if (v < 144)
+            code = 0x30 + v, bits = 8;
+        else if (v < 256)
+            code = 0x190 + (v - 144), bits = 9;
+        else if (v < 280)
+            code = v - 256, bits = 7;
+        else
+            code = 0xC0 + (v - 280), bits = 8;
+        t->lit_code[v] = (uint16_t)deflate_reverse(code, bits);
+        t->lit_bits[v] = (uint8_t)bits;
+    }
+    for (uint8_t sym = 0; sym < 29; sym++)
+    {
+        uint32_t top = sym == 28 ? DEFLATE_MAX_MATCH : deflate_len_base[sym + 1] - 1u;
+        if (sym == 27)
+            top = 257; // 258 has its own code
+        for (uint32_t len = deflate_len_base[sym]; len <= top; len++)
+            t->len_sym[len] = sym;
+    }
+    for (uint8_t sym = 0; sym < 30; sym++)
+    {
+        uint32_t top = sym == 29 ? 32768u : deflate_dist_base[sym + 1] - 1u;
+        for (uint32_t d = deflate_dist_base[sym]; d <= top; d++)
+        {
+            if (d <= 512)
+                t->dist_small[d] = sym;
+            else
+                t->dist_large[(d - 1) >> 8] = sym;
+        }
+    }
+}
+
+// Tokens: literal byte when the distance field is 0, else (dist << 9) | length.
+static void deflate_emit_block(deflate_writer_t *w, const deflate_tables_t *t, const uint32_t *tokens, size_t ntokens,
+                               const unsigned char *raw, size_t raw_len, bool final)
+{
+    uint64_t fixed_bits = 3 + 7;
+    for (size_t i = 0; i < ntokens; i++)
+    {
+        uint32_t dist = tokens[i] >> 9, value = tokens[i] & 0x1FF;
+        if (!dist)
+        {
+            fixed_bits += t->lit_bits[value];
+            continue;
+        }
+        uint8_t ls = t->len_sym[value];
+        uint8_t ds = dist <= 512 ? t->dist_small[dist] : t->dist_large[(dist - 1) >> 8];
+        fixed_bits += t->lit_bits[257 + ls] + deflate_len_extra[ls] + 5 + deflate_dist_extra[ds];
+    }
+    uint64_t stored_bits = (uint64_t)raw_len * 8 + ((raw_len / 65535) + 1) * (3 + 7 + 32);
+
+    if (stored_bits < fixed_bits)
+    {
+        do
+        {
+            size_t n = raw_len > 65535 ? 65535 : raw_len;
+            deflate_put(w, (final && n == raw_len) ? 1 : 0, 1);
+            deflate_put(w, 0, 2);
+            if (w->count)
+                deflate_put(w, 0, 8 - w->count);
+            deflate_put(w, (uint32_t)n, 16);
+            deflate_put(w, (uint32_t)(~n & 0xFFFF), 16);
+            for (size_t i = 0; i < n; i++)
+            {
+                w->buf[w->len++] = raw[i];
+                if (w->len == w->cap)
+                    deflate_flush(w);
+            }
+            raw += n;
+            raw_len -= n;
+        } while (raw_len > 0);
+        return;
+    }
+
+    deflate_put(w, final ? 1 : 0, 1);
+    deflate_put(w, 1, 2);
+    for (size_t i = 0; i < ntokens; i++)
+    {
+        uint32_t dist = tokens[i] >> 9, value = tokens[i] & 0x1FF;
+        if (!dist)
+        {
+            deflate_put(w, t->lit_code[value], t->lit_bits[value]);
+            continue;
+        }
+        uint8_t ls = t->len_sym[value];
+        uint8_t ds = dist <= 512 ? t->dist_small[dist] : t->dist_large[(dist - 1) >> 8];
+        deflate_put(w, t->lit_code[257 + ls], t->lit_bits[257 + ls]);
+        deflate_put(w, value - deflate_len_base[ls], deflate_len_extra[ls]);
+        deflate_put(w, deflate_reverse(ds, 5), 5);
+        deflate_put(w, dist - deflate_dist_base[ds], deflate_dist_extra[ds]);
+    }
+    deflate_put(w, t->lit_code[256], t->lit_bits[256]);
+}
+
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_CHUNK (256 * 1024)
+#define DEFLATE_CAPACITY (2 * DEFLATE_WINDOW + DEFLATE_CHUNK)
+
+typedef struct
+{
+    unsigned char *win;
+    int32_t *head;
+    int32_t *prev;
+    size_t fill;
+    size_t inserted; // positions below this are in the hash chains
+    unsigned max_chain;
+    size_t nice;
+} deflate_matcher_t;
+
+static uint32_t deflate_hash(const unsigned char *p)
+{
+    return (((uint32_t)p[0] << 10) ^ ((uint32_t)p[1] << 5) ^ p[2]) & ((1u << DEFLATE_HASH_BITS) - 1);
+}
+
+static void deflate_insert_upto(deflate_matcher_t *m, size_t pos)
+{
+    while (m->inserted <= pos && m->inserted + DEFLATE_MIN_MATCH <= m->fill)
+    {
+        uint32_t h = deflate_hash(m->win + m->inserted);
+        m->prev[m->inserted] = m->head[h];
+        m->head[h] = (int32_t)m->inserted;
+        m->inserted++;
+    }
+}
+
+static size_t deflate_longest_match(const deflate_matcher_t *m, size_t pos, size_t *dist)
+{
+    size_t max_len = m->fill - pos;
+    if (max_len > DEFLATE_MAX_MATCH)
+        max_len = DEFLATE_MAX_MATCH;
+    if (max_len < DEFLATE_MIN_MATCH)
+        return 0;
+
+    const unsigned char *cur = m->win + pos;
+    size_t best = 0;
+    unsigned chain = m->max_chain;
+    for (int32_t cand = m->prev[pos]; cand >= 0 && pos - (size_t)cand <= DEFLATE_WINDOW && chain--;
+         cand = m->prev[cand])
+    {
+        const unsigned char *c = m->win + cand;
+        if (c[best] != cur[best] || c[0] != cur[0] || c[1] != cur[1])
+            continue;
+        size_t len = 2;
+        while (len < max_len && c[len] == cur[len])
+            len++;
+        if (len > best)
+        {
+            best = len;
+            *dist = pos - (size_t)cand;
+            if (len >= m->nice || len == max_len)
+                break;
+        }
+    }
+    return best >= DEFLATE_MIN_MATCH ? best : 0;
+}
+
+/*
+ * Deflate everything remaining in src into out (positioned by the caller).
+ * Works through a sliding window, so memory stays bounded for any input
+ * size. Each window-sized block uses fixed Huffman codes, or stored blocks
+ * when those would be smaller, so incompressible data never grows by more
+ * than a few bytes per 64 KiB.
+ */
+static bool archive_deflate(FILE *src, FILE *out, int level, uint32_t *crc, uint64_t *in_total, uint64_t *out_total)
+{
+    deflate_matcher_t m;
+    memset(&m, 0, sizeof(m));
+    m.max_chain = level <= 1 ? 4 : level <= 3 ? 16 : level <= 6 ? 64 : 512;
+    m.nice = level <= 1 ? 16 : level <= 3 ? 32 : level <= 6 ? 128 : DEFLATE_MAX_MATCH;
+    bool lazy = level >= 6;
+
+    deflate_writer_t w;
+    memset(&w, 0, sizeof(w));
+    w.out = out;
+    w.cap = 64 * 1024;
+
+    m.win = malloc(DEFLATE_CAPACITY);
+    m.head = malloc(sizeof(int32_t) << DEFLATE_HASH_BITS);
+    m.prev = malloc(sizeof(int32_t) * DEFLATE_CAPACITY);
+    uint32_t *tokens = malloc(sizeof(uint32_t) * DEFLATE_CAPACITY);
+    deflate_tables_t *tables = malloc(sizeof(deflate_tables_t));
+    w.buf = malloc(w.cap);
+
+    bool ok = m.win && m.head && m.prev && tokens && tables && w.buf;
+    if (ok)
+    {
+        deflate_init_tables(tables);
+        for (size_t i = 0; i < ((size_t)1 << DEFLATE_HASH_BITS); i++)
+            m.head[i] = -1;
+    }
+
+    *crc = 0;
+    *in_total = 0;
+    size_t pos = 0;
+    bool eof = false;
+    while (ok)
+    {
+        while (!eof && m.fill < DEFLATE_CAPACITY)
+        {
+            size_t n = fread(m.win + m.fill, 1, DEFLATE_CAPACITY - m.fill, src);
+            if (n == 0)
+            {
+                ok = !ferror(src);
+                eof = true;
+                break;
+            }
+            *crc = archive_crc32(*crc, m.win + m.fill, n);
+            *in_total += n;
+            m.fill += n;
+        }
+        if (!ok)
+            break;
+
+        size_t limit = eof ? m.fill : m.fill - DEFLATE_MAX_MATCH;
+        size_t start = pos, ntokens = 0;
+        while (pos < limit)
+        {
+            size_t dist = 0, len = 0;
+            deflate_insert_upto(&m, pos);
+            if (m.inserted > pos)
+                len = deflate_longest_match(&m, pos, &dist);
+
+            // Lazy evaluation: defer a match while the next byte starts a longer one.
+            while (lazy && len && len < m.nice && pos + 1 < limit)
+            {
+                size_t next_dist = 0;
+                deflate_insert_upto(&m, pos + 1);
+                size_t next = m.inserted > pos + 1 ? deflate_longest_match(&m, pos + 1, &next_dist) : 0;
+                if (next <= len)
+                    break;
+                tokens[ntokens++] = m.win[pos++];
+                len = next;
+                dist = next_dist;
+            }
+
+            if (len)
+            {
+                tokens[ntokens++] = ((uint32_t)dist << 9) | (uint32_t)len;
+                pos += len;
+            }
+            else
+            {
+                tokens[ntokens++] = m.win[pos++];
+            }
+        }
+
+        bool final = eof && pos >= m.fill;
+        deflate_emit_block(&w, tables, tokens, ntokens, m.win + start, pos - start, final);
+        if (final || w.failed)
+            break;
+
+        // Slide: keep one window of history behind pos and rebase the chains.
+        if (pos > DEFLATE_WINDOW)
+        {
+            size_t shift = pos - DEFLATE_WINDOW;
+            memmove(m.win, m.win + shift, m.fill - shift);
+            for (size_t i = 0; i < ((size_t)1 << DEFLATE_HASH_BITS); i++)
+                m.head[i] = m.head[i] >= (int32_t)shift ? m.head[i] - (int32_t)shift : -1;
+            for (size_t i = shift; i < m.inserted; i++)
+                m.prev[i - shift] = m.prev[i] >= (int32_t)shift ? m.prev[i] - (int32_t)shift : -1;
+            m.fill -= shift;
+            m.inserted -= shift;
+            pos -= shift;
+        }
+    }
+
+    if (ok)
+    {
+        if (w.count)
+            deflate_put(&w, 0, 8 - w.count);
+        deflate_flush(&w);
+    }
+    *out_total = w.total;
+    ok = ok && !w.failed;
+
+    free(m.win);
+    free(m.head);
+    free(m.prev);
+    free(tokens);
+    free(tables);
+    free(w.buf);
+    return ok;
+}
+
+// ======================================================
+// ZIP backend (central directory + stored/deflate)
+// ======================================================
+
+#define ZIP_LOCAL_SIG 0x04034b50u
+#define ZIP_CENTRAL_SIG 0x02014b50u
+#define ZIP_EOCD_SIG 0x06054b50u
+#define ZIP64_EOCD_SIG 0x06064b50u
+#define ZIP64_LOCATOR_SIG 0x07064b50u
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_EOCD_SIZE 22
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATE 8
+#define ZIP_FLAG_ENCRYPTED 0x0001
+#define ZIP_FLAG_UTF8 0x0800
+#define ZIP_EXTRA_ZIP64 0x0001
+#define ZIP_EXTRA_TIME 0x5455
+// Entries this close to 4 GiB get ZIP64 sizes, leaving room for stored-block overhead
+#define ZIP64_THRESHOLD 0xFF000000u
+
+static uint16_t zip_get16(const unsigned char *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t zip_get32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t zip_get64(const unsigned char *p)
+{
+    return (uint64_t)zip_get32(p) | (uint64_t)zip_get32(p + 4) << 32;
+}
+
+static unsigned char *zip_put16(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    return p + 2;
+}
+
+static unsigned char *zip_put32(unsigned char *p, uint32_t v)
+{
+    p = zip_put16(p, v & 0xFFFF);
+    return zip_put16(p, v >> 16);
+}
+
+static unsigned char *zip_put64(unsigned char *p, uint64_t v)
+{
+    p = zip_put32(p, (uint32_t)v);
+    return zip_put32(p, (uint32_t)(v >> 32));
+}
+
+static void zip_dos_time(uint64_t t, uint16_t *dos_time, uint16_t *dos_date)
+{
+    time_t tt = (time_t)t;
+    struct tm tm;
+#ifdef _WIN32
+    bool ok = localtime_s(&tm, &tt) == 0;
+#else
+    bool ok = localtime_r(&tt, &tm) != NULL;
+#endif
+    if (!ok || tm.tm_year < 80)
+    {
+        *dos_time = 0;
+        *dos_date = (1 << 5) | 1; // 1980-01-01
+        return;
+    }
+    *dos_time = (uint16_t)((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+    *dos_date = (uint16_t)(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+}
+
+static uint64_t zip_from_dos_time(uint16_t dos_time, uint16_t dos_date)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_sec = (dos_time & 0x1F) * 2;
+    tm.tm_min = (dos_time >> 5) & 0x3F;
+    tm.tm_hour = dos_time >> 11;
+    tm.tm_mday = dos_date & 0x1F;
+    tm.tm_mon = ((dos_date >> 5) & 0x0F) - 1;
+    tm.tm_year = (dos_date >> 9) + 80;
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+    return t > 0 ? (uint64_t)t : 0;
+}
+
+static bool zip_name_is_utf8(const char *name)
+{
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+    {
+        if (*p >= 0x80)
+            return true;
+    }
+    return false;
+}
+
+static void zip_unmap(fossil_io_archive_t *archive)
+{
+    if (!archive->map)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile((LPCVOID)archive->map);
+    CloseHandle(archive->map_handle);
+    archive->map_handle = NULL;
+#else
+    munmap((void *)archive->map, archive->map_size);
+#endif
+    archive->map = NULL;
+    archive->map_size = 0;
+}
+
+// Map the whole archive read-only. An empty file maps to nothing and succeeds.
+static bool zip_map(fossil_io_archive_t *archive)
+{
+    zip_unmap(archive);
+    if (archive->stream)
+        fflush(archive->stream);
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(archive->path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    if (size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+    archive->map_handle = mapping;
+    archive->map = (const unsigned char *)view;
+    archive->map_size = (size_t)size.QuadPart;
+#else
+    int fd = open(archive->path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size > SIZE_MAX)
+    {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return true;
+    }
+    void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+        return false;
+    archive->map = (const unsigned char *)view;
+    archive->map_size = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+// Apply the ZIP64 extended-information extra field to any saturated value.
+static void zip_read_extra(const unsigned char *extra, size_t len, uint64_t *usize, uint64_t *csize,
+                           uint64_t *offset, uint64_t *mtime, bool *has_mtime)
+{
+    while (len >= 4)
+    {
+        uint16_t id = zip_get16(extra);
+        size_t size = zip_get16(extra + 2);
+        if (size > len - 4)
+            break;
+        const unsigned char *p = extra + 4, *end = p + size;
+
+        if (id == ZIP_EXTRA_ZIP64)
+        {
+            if (*usize == 0xFFFFFFFFu && p + 8 <= end)
+                *usize = zip_get64(p), p += 8;
+            if (*csize == 0xFFFFFFFFu && p + 8 <= end)
+                *csize = zip_get64(p), p += 8;
+            if (offset && *offset == 0xFFFFFFFFu && p + 8 <= end)
+                *offset = zip_get64(p);
+        }
+        else if (id == ZIP_EXTRA_TIME && size >= 5 && (p[0] & 1))
+        {
+            *mtime = zip_get32(p + 1);
+            *has_mtime = true;
+        }
+        extra += 4 + size;
+        len -= 4 + size;
+    }
+}
+
+// Index the archive from its central directory; local headers are not read.
+static bool zip_parse(fossil_io_archive_t *archive)
+{
+    const unsigned char *map = archive->map;
+    size_t size = archive->map_size;
+    if (!map || size < ZIP_EOCD_SIZE)
+        return false;
+
+    size_t eocd = size - ZIP_EOCD_SIZE;
+    size_t stop = size > ZIP_EOCD_SIZE + 0xFFFF ? size - ZIP_EOCD_SIZE - 0xFFFF : 0;
+    while (zip_get32(map + eocd) != ZIP_EOCD_SIG)
+    {
+        if (eocd == stop)
+            return false;
+        eocd--;
+    }
+
+    uint64_t count = zip_get16(map + eocd + 10);
+    uint64_t cd_size = zip_get32(map + eocd + 12);
+    uint64_t cd_offset = zip_get32(map + eocd + 16);
+    uint64_t cd_end = eocd;
+    if (zip_get16(map + eocd + 4) != 0 || zip_get16(map + eocd + 6) != 0)
+        return false; // multi-volume archives are not supported
+
+    if (eocd >= 20 && zip_get32(map + eocd - 20) == ZIP64_LOCATOR_SIG)
+    {
+        uint64_t z64 = zip_get64(map + eocd - 20 + 8);
+        if (size < 56 || z64 > size - 56 || zip_get32(map + z64) != ZIP64_EOCD_SIG)
+            return false;
+        count = zip_get64(map + z64 + 32);
+        cd_size = zip_get64(map + z64 + 40);
+        cd_offset = zip_get64(map + z64 + 48);
+        cd_end = z64;
+    }
+
+    // Data prepended to the archive (self-extractors) shifts every offset.
+    if (cd_size > cd_end || cd_offset > cd_end - cd_size)
+        return false;
+    uint64_t base = cd_end - cd_size - cd_offset;
+
+    char *name = malloc(0x10000);
+    if (!name)
+        return false;
+
+    bool ok = true;
+    const unsigned char *p = map + base + cd_offset, *end = map + cd_end;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if ((size_t)(end - p) < ZIP_CENTRAL_SIZE || zip_get32(p) != ZIP_CENTRAL_SIG)
+        {
+            ok = false;
+            break;
+        }
+        uint16_t made_by = zip_get16(p + 4);
+        uint16_t flags = zip_get16(p + 8);
+        uint16_t method = zip_get16(p + 10);
+        uint64_t mtime = zip_from_dos_time(zip_get16(p + 12), zip_get16(p + 14));
+        uint32_t crc = zip_get32(p + 16);
+        uint64_t csize = zip_get32(p + 20);
+        uint64_t usize = zip_get32(p + 24);
+        size_t name_len = zip_get16(p + 28);
+        size_t extra_len = zip_get16(p + 30);
+        size_t comment_len = zip_get16(p + 32);
+        uint32_t external = zip_get32(p + 38);
+        uint64_t local = zip_get32(p + 42);
+        size_t record = ZIP_CENTRAL_SIZE + name_len + extra_len + comment_len;
+        if ((size_t)(end - p) < record)
+        {
+            ok = false;
+            break;
+        }
+
+        bool has_mtime = false;
+        zip_read_extra(p + ZIP_CENTRAL_SIZE + name_len, extra_len, &usize, &csize, &local, &mtime, &has_mtime);
+
+        memcpy(name, p + ZIP_CENTRAL_SIZE, name_len);
+        name[name_len] = '\0';
+        p += record;
+
+        bool is_dir = false;
+        while (name_len > 1 && name[name_len - 1] == '/')
+        {
+            name[--name_len] = '\0';
+            is_dir = true;
+        }
+        if (name_len == 0 || local >= size - base)
+            continue;
+
+        uint32_t mode = (made_by >> 8) == 3 ? external >> 16 : 0;
+        if ((mode & 0170000) == 0040000 || (external & 0x10))
+            is_dir = true;
+
+        // As with TAR, a later record for the same name supersedes the earlier one.
+        size_t slot = archive_find(archive, name);
+        fossil_io_archive_entry_t *entry = NULL;
+        if (slot != ARCHIVE_NOT_FOUND)
+        {
+            entry = &archive->entries[slot];
+        }
+        else if (archive_push_entry(archive, &entry))
+        {
+            slot = archive->entry_count;
+            entry->name = archive_intern(archive, name);
+        }
+        if (!entry || !entry->name)
+        {
+            ok = false;
+            break;
+        }
+
+        entry->size = (size_t)usize;
+        entry->compressed_size = (size_t)csize;
+        entry->is_directory = is_dir;
+        entry->is_encrypted = (flags & ZIP_FLAG_ENCRYPTED) != 0;
+        entry->modified_time = mtime;
+        entry->created_time = mtime;
+        entry->crc32 = crc;
+        entry->permissions = (mode & 07777) ? (mode & 07777) : (is_dir ? 0755 : 0644);
+
+        fossil_io_archive_pos_t *pos = &archive->positions[slot];
+        pos->header_offset = base + local;
+        pos->data_offset = 0;
+        pos->end_offset = 0;
+        pos->type = is_dir ? '5' : ((mode & 0170000) == 0120000 ? '2' : '0');
+        pos->method = method;
+        pos->flags = flags;
+        if (slot == archive->entry_count)
+            archive_commit_entry(archive);
+    }
+
+    free(name);
+    archive->write_offset = base + cd_offset;
+    return ok;
+}
+
+static bool zip_open_stream(fossil_io_archive_t *archive)
+{
+    if (!(archive->mode & (FOSSIL_IO_ARCHIVE_WRITE | FOSSIL_IO_ARCHIVE_APPEND)))
+        return zip_map(archive) && zip_parse(archive);
+
+    if (archive->mode & FOSSIL_IO_ARCHIVE_APPEND)
+    {
+        // New entries overwrite the old central directory; it is rewritten on close.
+        if (zip_map(archive) && archive->map)
+        {
+            bool ok = zip_parse(archive);
+            zip_unmap(archive);
+            archive->stream = ok ? fopen(archive->path, "r+b") : NULL;
+            return archive->stream != NULL;
+        }
+    }
+
+    archive->stream = fopen(archive->path, "w+b");
+    archive->dirty = true;
+    return archive->stream != NULL;
+}
+
+// Write a local header for name at the current write offset.
+static bool zip_write_local(fossil_io_archive_t *archive, const char *name, uint16_t method, uint16_t flags,
+                            uint64_t mtime, bool zip64, size_t *header_len)
+{
+    unsigned char hdr[ZIP_LOCAL_SIZE + 9 + 20];
+    size_t name_len = strlen(name);
+    size_t extra_len = 9 + (zip64 ? 20 : 0);
+    uint16_t dos_time, dos_date;
+    zip_dos_time(mtime, &dos_time, &dos_date);
+    if (name_len > 0xFFFF)
+        return false;
+
+    unsigned char *p = zip_put32(hdr, ZIP_LOCAL_SIG);
+    p = zip_put16(p, zip64 ? 45 : 20);
+    p = zip_put16(p, flags);
+    p = zip_put16(p, method);
+    p = zip_put16(p, dos_time);
+    p = zip_put16(p, dos_date);
+    p = zip_put32(p, 0);                          // crc, patched after the data
+    p = zip_put32(p, zip64 ? 0xFFFFFFFFu : 0);    // compressed size
+    p = zip_put32(p, zip64 ? 0xFFFFFFFFu : 0);    // uncompressed size
+    p = zip_put16(p, (uint32_t)name_len);
+    p = zip_put16(p, (uint32_t)extra_len);
+
+    unsigned char *extra = hdr + ZIP_LOCAL_SIZE;
+    p = zip_put16(extra, ZIP_EXTRA_TIME);
+    p = zip_put16(p, 5);
+    *p++ = 1;
+    p = zip_put32(p, (uint32_t)mtime);
+    if (zip64)
+    {
+        p = zip_put16(p, ZIP_EXTRA_ZIP64);
+        p = zip_put16(p, 16);
+        p = zip_put64(p, 0);
+        p = zip_put64(p, 0);
+    }
+
+    uint64_t at = archive->write_offset;
+    if (!archive_write_at(archive, at, hdr, ZIP_LOCAL_SIZE) ||
+        fwrite(name, 1, name_len, archive->stream) != name_len ||
+        fwrite(extra, 1, extra_len, archive->stream) != extra_len)
+        return false;
+
+    *header_len = ZIP_LOCAL_SIZE + name_len + extra_len;
+    return true;
+}
+
+// Fill in crc and sizes once the entry data has been written.
+static bool zip_patch_local(fossil_io_archive_t *archive, uint64_t header_offset, size_t name_len, bool zip64,
+                            uint32_t crc, uint64_t csize, uint64_t usize)
+{
+    unsigned char buf[16];
+    zip_put32(buf, crc);
+    if (!zip64)
+    {
+        zip_put32(buf + 4, (uint32_t)csize);
+        zip_put32(buf + 8, (uint32_t)usize);
+        return archive_write_at(archive, header_offset + 14, buf, 12);
+    }
+
+    zip_put64(buf, usize);
+    zip_put64(buf + 8, csize);
+    unsigned char crc_buf[4];
+    zip_put32(crc_buf, crc);
+    return archive_write_at(archive, header_offset + 14, crc_buf, 4) &&
+           archive_write_at(archive, header_offset + ZIP_LOCAL_SIZE + name_len + 9 + 4, buf, 16);
+}
+
+static bool zip_add_file(fossil_io_archive_t *archive, const char *src_path, const char *archive_path)
+{
+    archive_stat_t st;
+    if (archive_stat(src_path, &st) != 0)
+        return false;
+
+    FILE *src = fopen(src_path, "rb");
+    if (!src)
+        return false;
+    if (!archive_replace_existing(archive, archive_path))
+    {
+        fclose(src);
+        return false;
+    }
+    zip_unmap(archive);
+
+    uint64_t size = (uint64_t)st.st_size;
+    uint64_t mtime = st.st_mtime > 0 ? (uint64_t)st.st_mtime : 0;
+    uint16_t method = (archive->compression == FOSSIL_IO_COMPRESSION_NONE || size == 0) ? ZIP_METHOD_STORED
+                                                                                         : ZIP_METHOD_DEFLATE;
+    uint16_t flags = zip_name_is_utf8(archive_path) ? ZIP_FLAG_UTF8 : 0;
+    bool zip64 = size >= ZIP64_THRESHOLD;
+    uint64_t header_offset = archive->write_offset;
+    size_t header_len = 0;
+
+    fossil_io_archive_entry_t *entry = NULL;
+    if (!archive_push_entry(archive, &entry) ||
+        !zip_write_local(archive, archive_path, method, flags, mtime, zip64, &header_len))
+    {
+        fclose(src);
+        return false;
+    }
+
+    uint64_t data_offset = header_offset + header_len;
+    uint32_t crc = 0;
+    uint64_t usize = 0, csize = 0;
+    bool ok;
+    if (method == ZIP_METHOD_DEFLATE)
+    {
+        ok = archive_deflate(src, archive->stream, (int)archive->compression, &crc, &usize, &csize);
+    }
+    else
+    {
+        // Stored data still has to pass through userspace for its CRC.
+        unsigned char *buf = archive_buffer(archive);
+        ok = buf != NULL;
+        size_t n;
+        while (ok && (n = fread(buf, 1, ARCHIVE_COPY_BUFFER, src)) > 0)
+        {
+            crc = archive_crc32(crc, buf, n);
+            ok = fwrite(buf, 1, n, archive->stream) == n;
+            usize += n;
+        }
+        ok = ok && !ferror(src);
+        csize = usize;
+    }
+    fclose(src);
+
+    // The file may have grown past what a 32-bit header can describe.
+    if (!zip64 && (usize >= 0xFFFFFFFFu || csize >= 0xFFFFFFFFu))
+        ok = false;
+    if (!ok || !zip_patch_local(archive, header_offset, strlen(archive_path), zip64, crc, csize, usize))
+        return false;
+
+    entry->name = archive_intern(archive, archive_path);
+    if (!entry->name)
+        return false;
+
+    entry->size = (size_t)usize;
+    entry->compressed_size = (size_t)csize;
+    entry->is_directory = false;
+    entry->is_encrypted = false;
+    entry->modified_time = mtime;
+    entry->created_time = mtime;
+    entry->crc32 = crc;
+    entry->permissions = (uint32_t)st.st_mode & 07777;
+
+    fossil_io_archive_pos_t *pos = &archive->positions[archive->entry_count];
+    pos->header_offset = header_offset;
+    pos->data_offset = data_offset;
+    pos->end_offset = data_offset + csize;
+    pos->type = '0';
+    pos->method = method;
+    pos->flags = flags;
+    archive_commit_entry(archive);
+    archive->write_offset = data_offset + csize;
+    archive->dirty = true;
+    return true;
+}
+
+static bool zip_add_dir_entry(fossil_io_archive_t *archive, const char *archive_dir, uint32_t mode, uint64_t mtime)
+{
+    if (!archive_replace_existing(archive, archive_dir))
+        return false;
+    zip_unmap(archive);
+
+    size_t len = strlen(archive_dir);
+    char *name = malloc(len + 2);
+    if (!name)
+        return false;
+    memcpy(name, archive_dir, len);
+    name[len] = '/';
+    name[len + 1] = '\0';
+    if (len > 0 && archive_dir[len - 1] == '/')
+        name[len] = '\0';
+
+    uint16_t flags = zip_name_is_utf8(name) ? ZIP_FLAG_UTF8 : 0;
+    uint64_t header_offset = archive->write_offset;
+    size_t header_len = 0;
+    fossil_io_archive_entry_t *entry = NULL;
+    bool ok = archive_push_entry(archive, &entry) &&
+              zip_write_local(archive, name, ZIP_METHOD_STORED, flags, mtime, false, &header_len);
+    free(name);
+    if (ok)
+    {
+        entry->name = archive_intern(archive, archive_dir);
+        ok = entry->name != NULL;
+    }
+    if (!ok)
+        return false;
+
+    entry->is_directory = true;
+    entry->modified_time = mtime;
+    entry->created_time = mtime;
+    entry->permissions = mode & 07777;
+
+    fossil_io_archive_pos_t *pos = &archive->positions[archive->entry_count];
+    pos->header_offset = header_offset;
+    pos->data_offset = header_offset + header_len;
+    pos->end_offset = pos->data_offset;
+    pos->type = '5';
+    pos->method = ZIP_METHOD_STORED;
+    pos->flags = flags;
+    archive_commit_entry(archive);
+    archive->write_offset = pos->end_offset;
+    archive->dirty = true;
+    return true;
+}
+
+// Write the central directory and end records after the last entry.
+static bool zip_finish(fossil_io_archive_t *archive)
+{
+    if (!archive->dirty)
+        return true;
+
+    FILE *out = archive->stream;
+    uint64_t cd_offset = archive->write_offset;
+    if (archive_seek(out, (archive_off_t)cd_offset, SEEK_SET) != 0)
+        return false;
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < archive->entry_count; i++)
+    {
+        const fossil_io_archive_entry_t *entry = &archive->entries[i];
+        const fossil_io_archive_pos_t *pos = &archive->positions[i];
+        bool is_dir = entry->is_directory;
+        size_t name_len = strlen(entry->name);
+        bool slash = is_dir && (name_len == 0 || entry->name[name_len - 1] != '/');
+
+        uint64_t usize = entry->size, csize = entry->compressed_size, local = pos->header_offset;
+        unsigned char zip64[28], *z = zip64 + 4;
+        if (usize >= 0xFFFFFFFFu)
+            z = zip_put64(z, usize);
+        if (csize >= 0xFFFFFFFFu)
+            z = zip_put64(z, csize);
+        if (local >= 0xFFFFFFFFu)
+            z = zip_put64(z, local);
+        size_t zip64_len = (size_t)(z - zip64);
+        if (zip64_len == 4)
+            zip64_len = 0;
+        zip_put16(zip64, ZIP_EXTRA_ZIP64);
+        zip_put16(zip64 + 2, (uint32_t)(zip64_len ? zip64_len - 4 : 0));
+
+        uint16_t dos_time, dos_date;
+        zip_dos_time(entry->modified_time, &dos_time, &dos_date);
+        uint32_t perms = entry->permissions & 07777;
+        uint32_t kind = is_dir ? 0040000u : (pos->type == '2' ? 0120000u : 0100000u);
+        uint32_t external = (kind | perms) << 16 | (is_dir ? 0x10u : 0u);
+        uint16_t version = zip64_len ? 45 : 20;
+
+        unsigned char hdr[ZIP_CENTRAL_SIZE], *p = hdr;
+        p = zip_put32(p, ZIP_CENTRAL_SIG);
+        p = zip_put16(p, (3u << 8) | version);
+        p = zip_put16(p, version);
+        p = zip_put16(p, pos->flags);
+        p = zip_put16(p, pos->method);
+        p = zip_put16(p, dos_time);
+        p = zip_put16(p, dos_date);
+        p = zip_put32(p, entry->crc32);
+        p = zip_put32(p, csize >= 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)csize);
+        p = zip_put32(p, usize >= 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)usize);
+        p = zip_put16(p, (uint32_t)(name_len + (slash ? 1 : 0)));
+        p = zip_put16(p, (uint32_t)(9 + zip64_len));
+        p = zip_put16(p, 0); // comment
+        p = zip_put16(p, 0); // disk
+        p = zip_put16(p, 0); // internal attributes
+        p = zip_put32(p, external);
+        zip_put32(p, local >= 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)local);
+
+        unsigned char ut[9];
+        zip_put16(ut, ZIP_EXTRA_TIME);
+        zip_put16(ut + 2, 5);
+        ut[4] = 1;
+        zip_put32(ut + 5, (uint32_t)entry->modified_time);
+
+        ok = fwrite(hdr, 1, sizeof(hdr), out) == sizeof(hdr) &&
+             fwrite(entry->name, 1, name_len, out) == name_len &&
+             (!slash || fputc('/', out) != EOF) &&
+             fwrite(ut, 1, sizeof(ut), out) == sizeof(ut) &&
+             fwrite(zip64, 1, zip64_len, out) == zip64_len;
+    }
+
+    uint64_t cd_end = (uint64_t)archive_tell(out);
+    uint64_t cd_size = cd_end - cd_offset;
+    uint64_t count = archive->entry_count;
+    bool need64 = count >= 0xFFFF || cd_size >= 0xFFFFFFFFu || cd_offset >= 0xFFFFFFFFu;
+
+    unsigned char tail[56 + 20 + ZIP_EOCD_SIZE], *p = tail;
+    if (need64)
+    {
+        p = zip_put32(p, ZIP64_EOCD_SIG);
+        p = zip_put64(p, 44);
+        p = zip_put16(p, (3u << 8) | 45);
+        p = zip_put16(p, 45);
+        p = zip_put32(p, 0);
+        p = zip_put32(p, 0);
+        p = zip_put64(p, count);
+        p = zip_put64(p, count);
+        p = zip_put64(p, cd_size);
+        p = zip_put64(p, cd_offset);
+
+        p = zip_put32(p, ZIP64_LOCATOR_SIG);
+        p = zip_put32(p, 0);
+        p = zip_put64(p, cd_end);
+        p = zip_put32(p, 1);
+    }
+    p = zip_put32(p, ZIP_EOCD_SIG);
+    p = zip_put16(p, 0);
+    p = zip_put16(p, 0);
+    p = zip_put16(p, count >= 0xFFFF ? 0xFFFFu : (uint32_t)count);
+    p = zip_put16(p, count >= 0xFFFF ? 0xFFFFu : (uint32_t)count);
+    p = zip_put32(p, cd_size >= 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)cd_size);
+    p = zip_put32(p, cd_offset >= 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)cd_offset);
+    p = zip_put16(p, 0);
+
+    size_t tail_len = (size_t)(p - tail);
+    ok = ok && fwrite(tail, 1, tail_len, out) == tail_len && fflush(out) == 0;
+
+    uint64_t end = cd_end + tail_len;
+#ifdef _WIN32
+    ok = ok && _chsize_s(_fileno(out), (__int64)end) == 0;
+#else
+    ok = ok && ftruncate(fileno(out), (off_t)end) == 0;
+#endif
+    return ok;
+}
+
+// Extract one entry straight out of the mapping; safe to call from several threads.
+static bool zip_extract_to(const fossil_io_archive_t *archive, size_t index, const char *dest_path)
+{
+    const fossil_io_archive_entry_t *entry = &archive->entries[index];
+    const fossil_io_archive_pos_t *pos = &archive->positions[index];
+    const unsigned char *map = archive->map;
+    uint64_t at = pos->header_offset;
+
+    if (pos->type == '5')
+        return fossil_io_create_directories(dest_path);
+    if (pos->type != '0' || entry->is_encrypted)
+        return false;
+    if (pos->method != ZIP_METHOD_STORED && pos->method != ZIP_METHOD_DEFLATE)
+        return false;
+
+    if (!map || archive->map_size < ZIP_LOCAL_SIZE || at > archive->map_size - ZIP_LOCAL_SIZE ||
+        zip_get32(map + at) != ZIP_LOCAL_SIG)
+        return false;
+    uint64_t data = at + ZIP_LOCAL_SIZE + zip_get16(map + at + 26) + zip_get16(map + at + 28);
+    if (data > archive->map_size || entry->compressed_size > archive->map_size - data)
+        return false;
+
+    FILE *out = fopen(dest_path, "wb");
+    if (!out)
+        return false;
+    archive_preallocate(out, entry->size);
+
+    uint32_t crc = 0;
+    uint64_t total = 0;
+    bool ok;
+    if (pos->method == ZIP_METHOD_STORED)
+    {
+        crc = archive_crc32(0, map + data, entry->compressed_size);
+        total = entry->compressed_size;
+        ok = fwrite(map + data, 1, entry->compressed_size, out) == entry->compressed_size;
+    }
+    else
+    {
+        ok = archive_inflate(map + data, entry->compressed_size, out, &crc, &total);
+    }
+
+    ok = (fclose(out) == 0) && ok && total == entry->size && crc == entry->crc32;
+    if (ok)
+        archive_apply_metadata(dest_path, entry);
+    return ok;
+}
+
+// The stream writes ZIP data; reads always go through a mapping of the current file.
+static bool zip_ensure_map(fossil_io_archive_t *archive)
+{
+    return archive->map || (zip_map(archive) && archive->map);
+}
+
+// ======================================================
+// Backend dispatch
+// ======================================================
+
+static bool archive_backend_add_file(fossil_io_archive_t *archive, const char *src_path, const char *archive_path)
+{
+    if (archive->type == FOSSIL_IO_ARCHIVE_ZIP)
+        return zip_add_file(archive, src_path, archive_path);
+    return tar_add_file(archive, src_path, archive_path);
+}
+
+static bool archive_backend_add_dir(fossil_io_archive_t *archive, const char *archive_dir, uint32_t mode, uint64_t mtime)
+{
+    if (archive->type == FOSSIL_IO_ARCHIVE_ZIP)
+        return zip_add_dir_entry(archive, archive_dir, mode, mtime);
+    return tar_add_dir_entry(archive, archive_dir, mode, mtime);
+}
+
+static int archive_name_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Add src_dir's contents under archive_dir in sorted order, so output is reproducible.
+static bool archive_add_tree(fossil_io_archive_t *archive, const char *src_dir, const char *archive_dir)
+{
+    char **names = NULL;
+    size_t count = 0, capacity = 0;
+    bool ok = true;
+
+#ifdef _WIN32
+    size_t pattern_len = strlen(src_dir) + 3;
+    char *pattern = malloc(pattern_len);
+    if (!pattern)
+        return false;
+    snprintf(pattern, pattern_len, "%s\\*", src_dir);
+
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(pattern, &fd);
+    free(pattern);
+    if (h == INVALID_HANDLE_VALUE)
+        return false;
+
+    do
+    {
+        const char *d_name = fd.cFileName;
+#else
+    DIR *dir = opendir(src_dir);
+    if (!dir)
+        return false;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        const char *d_name = ent->d_name;
+#endif
+        if (strcmp(d_name, ".") == 0 || strcmp(d_name, "..") == 0)
+            continue;
+
+        if (count == capacity)
+        {
+            size_t new_capacity = capacity ? capacity * 2 : 32;
+            char **grown = realloc(names, new_capacity * sizeof(*grown));
+            if (!grown)
+            {
+                ok = false;
+                break;
+            }
+            names = grown;
+            capacity = new_capacity;
+        }
+
+        names[count] = fossil_io_cstring_dup(d_name);
+        if (!names[count])
+        {
+            ok = false;
+            break;
+        }
+        count++;
 #ifdef _WIN32
-#include <windows.h>
-#include <io.h>
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
 #else
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <dirent.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <utime.h>
-#ifndef AT_FDCWD
-#define AT_FDCWD -100
-#endif
+    }
+    closedir(dir);
 #endif
 
+    if (ok && count > 1)
+        qsort(names, count, sizeof(*names), archive_name_cmp);
+
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        size_t src_len = strlen(src_dir) + strlen(names[i]) + 2;
+        size_t dst_len = strlen(archive_dir) + strlen(names[i]) + 2;
+        char *src = malloc(src_len);
+        char *dst = malloc(dst_len);
+
+        if (!src || !dst)
+        {
+            ok = false;
+        }
+        else
+        {
+            snprintf(src, src_len, "%s/%s", src_dir, names[i]);
+            snprintf(dst, dst_len, "%s/%s", archive_dir, names[i]);
+
+            archive_stat_t st;
+            if (archive_stat(src, &st) != 0)
+                ok = false;
+            else if (S_ISDIR(st.st_mode))
+                ok = archive_backend_add_dir(archive, dst, (uint32_t)st.st_mode, st.st_mtime > 0 ? (uint64_t)st.st_mtime : 0) &&
+                     archive_add_tree(archive, src, dst);
+            else if (S_ISREG(st.st_mode))
+                ok = archive_backend_add_file(archive, src, dst);
+            // sockets, fifos and devices are not archived
+        }
+
+        free(src);
+        free(dst);
+    }
+
+    for (size_t i = 0; i < count; i++)
+        fossil_io_cstring_free(names[i]);
+    free(names);
+    return ok;
+}
+
 // ======================================================
-// Opaque archive handle definition
+// Parallel extraction
 // ======================================================
 
-struct fossil_io_archive
+// Set of directories already created during one extraction.
+typedef struct
 {
-    char *path;
-    fossil_io_archive_type_t type;
-    fossil_io_archive_mode_t mode;
-    fossil_io_archive_compression_t compression;
-    // Internal storage for entries
-    fossil_io_archive_entry_t *entries;
-    size_t entry_count;
-    size_t entry_capacity;
-};
+    char **slots;
+    size_t capacity;
+    size_t count;
+} archive_dir_cache_t;
 
-// ======================================================
-// Helper: Create directory recursively
-// ======================================================
-static bool fossil_io_create_directories(const char *path)
+static bool archive_dir_cache_has(const archive_dir_cache_t *cache, const char *path)
 {
-    if (!path)
+    if (!cache->slots)
         return false;
+    size_t mask = cache->capacity - 1;
+    for (size_t slot = (size_t)archive_name_hash(path) & mask; cache->slots[slot]; slot = (slot + 1) & mask)
+    {
+        if (strcmp(cache->slots[slot], path) == 0)
+            return true;
+    }
+    return false;
+}
 
-    char *path_copy = fossil_io_cstring_dup(path);
-    if (!path_copy)
+static bool archive_dir_cache_add(archive_dir_cache_t *cache, const char *path)
+{
+    if ((cache->count + 1) * 2 > cache->capacity)
+    {
+        size_t capacity = cache->capacity ? cache->capacity * 2 : 64;
+        char **slots = calloc(capacity, sizeof(char *));
+        if (!slots)
+            return false;
+        for (size_t i = 0; i < cache->capacity; i++)
+        {
+            if (!cache->slots[i])
+                continue;
+            size_t slot = (size_t)archive_name_hash(cache->slots[i]) & (capacity - 1);
+            while (slots[slot])
+                slot = (slot + 1) & (capacity - 1);
+            slots[slot] = cache->slots[i];
+        }
+        free(cache->slots);
+        cache->slots = slots;
+        cache->capacity = capacity;
+    }
+
+    char *copy = fossil_io_cstring_dup(path);
+    if (!copy)
         return false;
+    size_t mask = cache->capacity - 1;
+    size_t slot = (size_t)archive_name_hash(path) & mask;
+    while (cache->slots[slot])
+        slot = (slot + 1) & mask;
+    cache->slots[slot] = copy;
+    cache->count++;
+    return true;
+}
 
-    char *p = path_copy;
+static void archive_dir_cache_free(archive_dir_cache_t *cache)
+{
+    for (size_t i = 0; i < cache->capacity; i++)
+        fossil_io_cstring_free(cache->slots[i]);
+    free(cache->slots);
+}
 
-    // Skip root slash on Unix or drive letter on Windows
-    if (*p == '/')
-        p++;
+static bool archive_mkdir(const char *path)
+{
 #ifdef _WIN32
-    else if (strlen(p) >= 2 && p[1] == ':')
-        p += 2;
-    if (*p == '/' || *p == '\\')
-        p++;
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
 #endif
+}
 
-    while (*p)
-    {
-        while (*p && *p != '/' && *p != '\\')
-            p++;
-        if (*p)
-        {
-            char sep = *p;
-            *p = '\0';
+// mkdir every component of path below its first `root` bytes, once per extraction.
+static bool archive_make_dirs(archive_dir_cache_t *cache, char *path, size_t root)
+{
+    if (archive_dir_cache_has(cache, path))
+        return true;
 
-#ifdef _WIN32
-            CreateDirectoryA(path_copy, NULL);
-#else
-            mkdir(path_copy, 0755);
-#endif
+    for (char *p = path + root + 1; *p; p++)
+    {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        bool ok = archive_dir_cache_has(cache, path) ||
+                  (archive_mkdir(path) && archive_dir_cache_add(cache, path));
+        *p = '/';
+        if (!ok)
+            return false;
+    }
+    return archive_mkdir(path) && archive_dir_cache_add(cache, path);
+}
 
-            *p = sep;
-            p++;
+typedef struct
+{
+    fossil_io_archive_t *archive;
+    const char *dest;
+    size_t dest_len;
+    const size_t *files; // entry indices of regular files to write
+    size_t file_count;
+    atomic_size_t next;
+    atomic_bool failed;
+} archive_extract_job_t;
+
+// TAR workers read through their own handle and one bounded copy buffer;
+// ZIP workers read straight from the shared read-only mapping.
+static void archive_extract_worker(void *arg, size_t index)
+{
+    (void)index;
+    archive_extract_job_t *job = (archive_extract_job_t *)arg;
+    fossil_io_archive_t *archive = job->archive;
+    FILE *src = NULL;
+    unsigned char *buf = NULL;
+    char *path = NULL;
+    size_t path_cap = 0;
+
+    bool tar = archive->stream && archive->type == FOSSIL_IO_ARCHIVE_TAR;
+    if (tar)
+    {
+        src = fopen(archive->path, "rb");
+        buf = malloc(ARCHIVE_COPY_BUFFER);
+        if (!src)
+        {
+            atomic_store(&job->failed, true);
+            free(buf);
+            return;
         }
     }
 
-    // Create the final directory if it doesn't end with a separator
-    if (strlen(path_copy) > 0)
+    while (!atomic_load(&job->failed))
     {
-#ifdef _WIN32
-        CreateDirectoryA(path_copy, NULL);
-#else
-        mkdir(path_copy, 0755);
-#endif
+        size_t n = atomic_fetch_add(&job->next, 1);
+        if (n >= job->file_count)
+            break;
+
+        size_t index = job->files[n];
+        const fossil_io_archive_entry_t *entry = &archive->entries[index];
+        size_t need = job->dest_len + strlen(entry->name) + 2;
+        if (need > path_cap)
+        {
+            char *grown = realloc(path, need);
+            if (!grown)
+            {
+                atomic_store(&job->failed, true);
+                break;
+            }
+            path = grown;
+            path_cap = need;
+        }
+        snprintf(path, need, "%s/%s", job->dest, entry->name);
+
+        bool ok;
+        if (tar)
+        {
+            ok = tar_extract_from(entry, &archive->positions[index], src, buf, path);
+        }
+        else if (archive->map)
+        {
+            ok = zip_extract_to(archive, index, path);
+        }
+        else
+        {
+            // In-memory formats carry no data: create empty file
+            FILE *file = fopen(path, "wb");
+            ok = file && fclose(file) == 0;
+        }
+        if (!ok)
+            atomic_store(&job->failed, true);
     }
 
-    fossil_io_cstring_free(path_copy);
-    return true;
+    free(path);
+    free(buf);
+    if (src)
+        fclose(src);
 }
 
 // ======================================================
@@ -171,6 +3118,22 @@ fossil_io_archive_t *fossil_io_archive_open(const char *path, fossil_io_archive_
     archive->entries = NULL;
     archive->entry_count = 0;
     archive->entry_capacity = 0;
+    archive->index = NULL;
+    archive->index_capacity = 0;
+    archive->names = NULL;
+    archive->stream = NULL;
+    archive->write_offset = 0;
+    archive->positions = NULL;
+    archive->shadows = NULL;
+    archive->shadow_count = 0;
+    archive->shadow_capacity = 0;
+    archive->buffer = NULL;
+    archive->dirty = false;
+    archive->map = NULL;
+    archive->map_size = 0;
+#ifdef _WIN32
+    archive->map_handle = NULL;
+#endif
 
     if (!archive->path)
     {
@@ -178,6 +3141,19 @@ fossil_io_archive_t *fossil_io_archive_open(const char *path, fossil_io_archive_
         return NULL;
     }
 
+    // TAR archives are streamed to and indexed from disk; ZIP archives are
+    // indexed from their central directory and read through a mapping
+    bool ok = true;
+    if (archive->path[0] && archive->type == FOSSIL_IO_ARCHIVE_TAR)
+        ok = tar_open_stream(archive);
+    else if (archive->path[0] && archive->type == FOSSIL_IO_ARCHIVE_ZIP)
+        ok = zip_open_stream(archive);
+    if (!ok)
+    {
+        fossil_io_archive_close(archive);
+        return NULL;
+    }
+
     return archive;
 }
 
@@ -186,15 +3162,28 @@ void fossil_io_archive_close(fossil_io_archive_t *archive)
     if (!archive)
         return;
 
+    if (archive->stream)
+    {
+        if (archive->type == FOSSIL_IO_ARCHIVE_ZIP)
+            zip_finish(archive);
+        else
+            tar_finish(archive);
+        fclose(archive->stream);
+    }
+    zip_unmap(archive);
+
     fossil_io_cstring_free(archive->path);
+    free(archive->positions);
+    free(archive->shadows);
+    free(archive->buffer);
 
-    if (archive->entries)
+    free(archive->entries);
+    free(archive->index);
+    while (archive->names)
     {
-        for (size_t i = 0; i < archive->entry_count; i++)
-        {
-            fossil_io_cstring_free(archive->entries[i].name);
-        }
-        free(archive->entries);
+        fossil_io_archive_name_block_t *next = archive->names->next;
+        free(archive->names);
+        archive->names = next;
     }
 
     free(archive);
@@ -251,87 +3240,42 @@ bool fossil_io_archive_get_stats(fossil_io_archive_t *archive, fossil_io_archive
 // Entry Management
 // ======================================================
 
-ssize_t fossil_io_archive_list(fossil_io_archive_t *archive, fossil_io_archive_entry_t **entries)
+ssize_t fossil_io_archive_entries(fossil_io_archive_t *archive, const fossil_io_archive_entry_t **entries)
 {
     if (!archive || !entries)
         return -1;
 
-    if (archive->entry_count == 0)
-    {
-        *entries = NULL;
-        return 0;
-    }
+    // Names are unique by construction, so the table itself is the listing.
+    *entries = archive->entry_count ? archive->entries : NULL;
+    return (ssize_t)archive->entry_count;
+}
 
-    // Count unique entries first
-    size_t unique_count = 0;
-    for (size_t i = 0; i < archive->entry_count; i++)
-    {
-        bool is_duplicate = false;
-        for (size_t j = 0; j < i; j++)
-        {
-            if (archive->entries[i].name && archive->entries[j].name &&
-                fossil_io_cstring_equals(archive->entries[i].name, archive->entries[j].name))
-            {
-                is_duplicate = true;
-                break;
-            }
-        }
-        if (!is_duplicate)
-        {
-            unique_count++;
-        }
-    }
+ssize_t fossil_io_archive_list(fossil_io_archive_t *archive, fossil_io_archive_entry_t **entries)
+{
+    if (!archive || !entries)
+        return -1;
 
-    if (unique_count == 0)
-    {
-        *entries = NULL;
+    *entries = NULL;
+    if (archive->entry_count == 0)
         return 0;
-    }
 
-    fossil_io_archive_entry_t *entry_copy = malloc(sizeof(fossil_io_archive_entry_t) * unique_count);
+    fossil_io_archive_entry_t *entry_copy = malloc(sizeof(fossil_io_archive_entry_t) * archive->entry_count);
     if (!entry_copy)
         return -1;
 
-    // Zero-initialize new allocation
-    memset(entry_copy, 0, sizeof(fossil_io_archive_entry_t) * unique_count);
-
-    size_t copy_index = 0;
     for (size_t i = 0; i < archive->entry_count; i++)
     {
-        bool is_duplicate = false;
-        for (size_t j = 0; j < i; j++)
-        {
-            if (archive->entries[i].name && archive->entries[j].name &&
-                fossil_io_cstring_equals(archive->entries[i].name, archive->entries[j].name))
-            {
-                is_duplicate = true;
-                break;
-            }
-        }
-
-        if (!is_duplicate)
+        entry_copy[i] = archive->entries[i];
+        entry_copy[i].name = fossil_io_cstring_dup(archive->entries[i].name);
+        if (!entry_copy[i].name)
         {
-            fossil_io_archive_entry_t *dst = &entry_copy[copy_index];
-            fossil_io_archive_entry_t *src = &archive->entries[i];
-
-            memcpy(dst, src, sizeof(*dst));
-            dst->name = fossil_io_cstring_dup(src->name);
-            if (!dst->name)
-            {
-                // Cleanup on failure
-                for (size_t k = 0; k < copy_index; k++)
-                {
-                    fossil_io_cstring_free(entry_copy[k].name);
-                }
-                free(entry_copy);
-                return -1;
-            }
-            copy_index++;
+            fossil_io_archive_free_entries(entry_copy, i);
+            return -1;
         }
     }
 
     *entries = entry_copy;
-    return (ssize_t)unique_count;
+    return (ssize_t)archive->entry_count;
 }
 
 void fossil_io_archive_free_entries(fossil_io_archive_entry_t *entries, size_t count)
@@ -355,14 +3299,7 @@ bool fossil_io_archive_exists(fossil_io_archive_t *archive, const char *entry_na
     if (!archive || !entry_name)
         return false;
 
-    for (size_t i = 0; i < archive->entry_count; i++)
-    {
-        if (archive->entries[i].name && fossil_io_cstring_equals(archive->entries[i].name, entry_name))
-        {
-            return true;
-        }
-    }
-    return false;
+    return archive_find(archive, entry_name) != ARCHIVE_NOT_FOUND;
 }
 
 ssize_t fossil_io_archive_entry_size(fossil_io_archive_t *archive, const char *entry_name)
@@ -370,14 +3307,8 @@ ssize_t fossil_io_archive_entry_size(fossil_io_archive_t *archive, const char *e
     if (!archive || !entry_name)
         return -1;
 
-    for (size_t i = 0; i < archive->entry_count; i++)
-    {
-        if (archive->entries[i].name && fossil_io_cstring_equals(archive->entries[i].name, entry_name))
-        {
-            return (ssize_t)archive->entries[i].size;
-        }
-    }
-    return -1;
+    size_t index = archive_find(archive, entry_name);
+    return index == ARCHIVE_NOT_FOUND ? -1 : (ssize_t)archive->entries[index].size;
 }
 
 // ======================================================
@@ -391,46 +3322,22 @@ bool fossil_io_archive_add_file(fossil_io_archive_t *archive, const char *src_pa
     if (!(archive->mode & (FOSSIL_IO_ARCHIVE_WRITE | FOSSIL_IO_ARCHIVE_APPEND)))
         return false;
 
-    FILE *file = fopen(src_path, "rb");
-    if (!file)
-        return false;
+    if (archive->stream)
+        return archive_backend_add_file(archive, src_path, archive_path);
 
-    if (fseek(file, 0, SEEK_END) != 0)
-    {
-        fclose(file);
+    archive_stat_t st;
+    if (archive_stat(src_path, &st) != 0)
         return false;
-    }
-
-    long file_size = ftell(file);
-    fclose(file);
 
-    if (file_size < 0)
+    uint64_t file_size = (uint64_t)st.st_size;
+#if SIZE_MAX < UINT64_MAX
+    if (file_size > SIZE_MAX)
         return false;
+#endif
 
-    // Resize entries array if needed
-    if (archive->entry_count >= archive->entry_capacity)
-    {
-        size_t old_capacity = archive->entry_capacity;
-        size_t new_capacity = archive->entry_capacity == 0 ? 8 : archive->entry_capacity * 2;
-        fossil_io_archive_entry_t *new_entries = realloc(archive->entries,
-                                                         sizeof(fossil_io_archive_entry_t) * new_capacity);
-        if (!new_entries)
-            return false;
-
-        // Zero-initialize new memory
-        memset(new_entries + old_capacity, 0,
-               (new_capacity - old_capacity) * sizeof(fossil_io_archive_entry_t));
-
-        archive->entries = new_entries;
-        archive->entry_capacity = new_capacity;
-    }
-
-    // Add entry
-    fossil_io_archive_entry_t *entry = &archive->entries[archive->entry_count];
-    memset(entry, 0, sizeof(fossil_io_archive_entry_t));
-
-    entry->name = fossil_io_cstring_dup(archive_path);
-    if (!entry->name)
+    // Add entry, or refresh the existing one with the same name
+    fossil_io_archive_entry_t *entry = archive_upsert_entry(archive, archive_path);
+    if (!entry)
         return false;
 
     time_t now = time(NULL);
@@ -443,7 +3350,6 @@ bool fossil_io_archive_add_file(fossil_io_archive_t *archive, const char *src_pa
     entry->crc32 = 0;
     entry->permissions = 0644;
 
-    archive->entry_count++;
     return true;
 }
 
@@ -452,30 +3358,25 @@ bool fossil_io_archive_add_directory(fossil_io_archive_t *archive, const char *s
     if (!archive || !src_dir || !archive_dir)
         return false;
 
-    // Resize entries array if needed
-    if (archive->entry_count >= archive->entry_capacity)
+    if (archive->stream)
     {
-        size_t old_capacity = archive->entry_capacity;
-        size_t new_capacity = archive->entry_capacity == 0 ? 8 : archive->entry_capacity * 2;
-        fossil_io_archive_entry_t *new_entries = realloc(archive->entries,
-                                                         sizeof(fossil_io_archive_entry_t) * new_capacity);
-        if (!new_entries)
+        if (!(archive->mode & (FOSSIL_IO_ARCHIVE_WRITE | FOSSIL_IO_ARCHIVE_APPEND)))
             return false;
 
-        // Zero-initialize new memory
-        memset(new_entries + old_capacity, 0,
-               (new_capacity - old_capacity) * sizeof(fossil_io_archive_entry_t));
+        // A missing source still records the directory entry itself.
+        archive_stat_t st;
+        bool have_src = archive_stat(src_dir, &st) == 0 && S_ISDIR(st.st_mode);
+        uint32_t mode = have_src ? (uint32_t)st.st_mode : 0755;
+        uint64_t mtime = (have_src && st.st_mtime > 0) ? (uint64_t)st.st_mtime : (uint64_t)time(NULL);
 
-        archive->entries = new_entries;
-        archive->entry_capacity = new_capacity;
+        if (!archive_backend_add_dir(archive, archive_dir, mode, mtime))
+            return false;
+        return have_src ? archive_add_tree(archive, src_dir, archive_dir) : true;
     }
 
     // Add directory entry
-    fossil_io_archive_entry_t *entry = &archive->entries[archive->entry_count];
-    memset(entry, 0, sizeof(fossil_io_archive_entry_t));
-
-    entry->name = fossil_io_cstring_dup(archive_dir);
-    if (!entry->name)
+    fossil_io_archive_entry_t *entry = archive_upsert_entry(archive, archive_dir);
+    if (!entry)
         return false;
 
     time_t now = time(NULL);
@@ -487,8 +3388,6 @@ bool fossil_io_archive_add_directory(fossil_io_archive_t *archive, const char *s
     entry->created_time = now;
     entry->crc32 = 0;
     entry->permissions = 0755;
-
-    archive->entry_count++;
     return true;
 }
 
@@ -499,7 +3398,8 @@ bool fossil_io_archive_extract_file(fossil_io_archive_t *archive, const char *en
     if (!(archive->mode & FOSSIL_IO_ARCHIVE_READ))
         return false;
 
-    if (!fossil_io_archive_exists(archive, entry_name))
+    size_t index = archive_find(archive, entry_name);
+    if (index == ARCHIVE_NOT_FOUND)
         return false;
 
     // Create destination directory
@@ -517,7 +3417,12 @@ bool fossil_io_archive_extract_file(fossil_io_archive_t *archive, const char *en
         fossil_io_cstring_free(dest_copy);
     }
 
-    // Simplified: create empty file
+    if (archive->type == FOSSIL_IO_ARCHIVE_ZIP && (archive->stream || archive->map))
+        return zip_ensure_map(archive) && zip_extract_to(archive, index, dest_path);
+    if (archive->stream)
+        return tar_extract_entry(archive, index, dest_path);
+
+    // In-memory formats carry no data: create empty file
     FILE *file = fopen(dest_path, "wb");
     if (!file)
         return false;
@@ -527,38 +3432,99 @@ bool fossil_io_archive_extract_file(fossil_io_archive_t *archive, const char *en
 }
 
 bool fossil_io_archive_extract_all(fossil_io_archive_t *archive, const char *dest_dir)
+{
+    return fossil_io_archive_extract_all_parallel(archive, dest_dir, 1);
+}
+
+bool fossil_io_archive_extract_all_parallel(fossil_io_archive_t *archive, const char *dest_dir, size_t threads)
 {
     if (!archive || !dest_dir)
         return false;
 
-    fossil_io_create_directories(dest_dir);
+    bool on_disk = archive->stream || archive->map;
+    if (on_disk && !(archive->mode & FOSSIL_IO_ARCHIVE_READ))
+        return false;
 
     for (size_t i = 0; i < archive->entry_count; i++)
     {
-        size_t path_len = strlen(dest_dir) + strlen(archive->entries[i].name) + 2;
-        char *full_path = malloc(path_len);
-        if (!full_path)
+        if (!archive_entry_name_is_safe(archive->entries[i].name))
             return false;
+    }
 
-        snprintf(full_path, path_len, "%s/%s", dest_dir, archive->entries[i].name);
+    fossil_io_create_directories(dest_dir);
+
+    size_t dest_len = strlen(dest_dir);
+    size_t *files = archive->entry_count ? malloc(archive->entry_count * sizeof(size_t)) : NULL;
+    char *path = NULL;
+    size_t path_cap = 0;
+    size_t file_count = 0;
+    archive_dir_cache_t cache = {NULL, 0, 0};
+    bool ok = archive->entry_count == 0 || files != NULL;
+
+    // Create the directory tree up front, touching each directory once.
+    for (size_t i = 0; ok && i < archive->entry_count; i++)
+    {
+        const fossil_io_archive_entry_t *entry = &archive->entries[i];
+        bool is_file = !entry->is_directory;
+        if (on_disk && is_file && archive->positions[i].type != '0')
+            continue; // links and special files are listed but not materialised
 
-        bool success = true;
-        if (archive->entries[i].is_directory)
+        size_t need = dest_len + strlen(entry->name) + 2;
+        if (need > path_cap)
         {
-            success = fossil_io_create_directories(full_path);
+            char *grown = realloc(path, need);
+            if (!grown)
+            {
+                ok = false;
+                break;
+            }
+            path = grown;
+            path_cap = need;
         }
-        else
+        snprintf(path, need, "%s/%s", dest_dir, entry->name);
+
+        if (is_file)
         {
-            success = fossil_io_archive_extract_file(archive, archive->entries[i].name, full_path);
+            files[file_count++] = i;
+            char *slash = strrchr(path + dest_len + 1, '/');
+            if (!slash)
+                continue;
+            *slash = '\0';
         }
+        ok = archive_make_dirs(&cache, path, dest_len);
+    }
+    free(path);
+    archive_dir_cache_free(&cache);
 
-        free(full_path);
-
-        if (!success)
-            return false;
+    if (ok && file_count > 0)
+    {
+        if (threads == 0)
+            threads = fossil_cpu_count();
+        if (threads > file_count)
+            threads = file_count;
+
+        archive_extract_job_t job;
+        job.archive = archive;
+        job.dest = dest_dir;
+        job.dest_len = dest_len;
+        job.files = files;
+        job.file_count = file_count;
+        atomic_init(&job.next, 0);
+        atomic_init(&job.failed, false);
+
+        if (archive->type == FOSSIL_IO_ARCHIVE_ZIP && on_disk)
+            ok = zip_ensure_map(archive);
+        else if (archive->stream)
+            fflush(archive->stream);
+        if (ok)
+        {
+            fossil_run_workers(threads, archive_extract_worker, &job);
+            ok = !atomic_load(&job.failed);
+        }
     }
 
-    return true;
+    free(files);
+    return ok;
 }
 
 bool fossil_io_archive_remove(fossil_io_archive_t *archive, const char *entry_name)
@@ -568,22 +3534,19 @@ bool fossil_io_archive_remove(fossil_io_archive_t *archive, const char *entry_na
     if (!(archive->mode & (FOSSIL_IO_ARCHIVE_WRITE | FOSSIL_IO_ARCHIVE_APPEND)))
         return false;
 
-    for (size_t i = 0; i < archive->entry_count; i++)
-    {
-        if (archive->entries[i].name && fossil_io_cstring_equals(archive->entries[i].name, entry_name))
-        {
-            fossil_io_cstring_free(archive->entries[i].name);
+    size_t index = archive_find(archive, entry_name);
+    if (index == ARCHIVE_NOT_FOUND)
+        return false;
 
-            // Shift remaining entries
-            for (size_t j = i; j < archive->entry_count - 1; j++)
-            {
-                archive->entries[j] = archive->entries[j + 1];
-            }
-            archive->entry_count--;
-            return true;
-        }
+    if (archive->stream)
+    {
+        bool ok = archive_remove_entry(archive, index);
+        zip_unmap(archive); // any mapping no longer matches the file
+        return ok;
     }
-    return false;
+
+    archive_drop_entry(archive, index);
+    return true;
 }
 
 // ======================================================
@@ -22,9 +22,16 @@
  * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* copy_file_range, sendfile, FICLONE */
+#endif
+
 #include "fossil/io/filesys.h"
+#include "workers.h"
 
+#ifndef _DEFAULT_SOURCE
 #define _DEFAULT_SOURCE
+#endif
 #define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
@@ -39,9 +46,17 @@
 #include <sys/types.h> // sometimes needed for mode_t
 #include <errno.h>     // optional, if checking errors
 #include <fcntl.h>     // open, O_* flags
+#include <stdatomic.h>
+
+#if defined(FOSSIL_IO_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(FOSSIL_IO_HAVE_ZSTD)
+#include <zstd.h>
+#endif
 
 /* Ensure realpath is available on all POSIX systems */
-#ifndef _WIN32
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
 #define _DEFAULT_SOURCE
 #endif
 
@@ -52,6 +67,7 @@
 #ifdef _WIN32
 #include <windows.h>
 #include <fileapi.h>
+#include <io.h>
 #include <sys/stat.h>
 #else
 #include <sys/stat.h>
@@ -62,6 +78,17 @@
 #include <utime.h>
 #include <pwd.h>
 #include <grp.h>
+#include <sys/mman.h>
+#include <sys/uio.h> /* preadv, pwritev */
+#include <sys/file.h> /* flock */
+#endif
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h> /* FICLONE */
+#include <linux/stat.h> /* struct statx, STATX_* */
 #endif
 
 #ifdef _WIN32
@@ -71,91 +98,17 @@
 #include <dirent.h>
 #endif
 
-fossil_io_filesys_file_t *_FOSSIL_STDIN;
-fossil_io_filesys_file_t *_FOSSIL_STDOUT;
-fossil_io_filesys_file_t *_FOSSIL_STDERR;
-
 #if defined(_WIN32)
 #define PATH_SEP '\\'
+#define fossil_ftell64 _ftelli64
 #else
 #define PATH_SEP '/'
+#define fossil_ftell64 ftello
 #endif
 
 #define FOSSIL_MERGE_CONCAT 1
 #define FOSSIL_MERGE_INTERLEAVE 2
 
-/* ------------------------------------------------------------
- * Internal hash algorithms
- * ------------------------------------------------------------ */
-
-static inline uint64_t rotl64(uint64_t x, unsigned int r)
-{
-    return (x << r) | (x >> (64 - r));
-}
-
-static uint64_t fossil_hash_file(const char *path)
-{
-    FILE *f = fopen(path, "rb");
-    if (!f)
-        return 0;
-
-    uint64_t hash = 14695981039346656037ULL; // FNV offset basis
-    const uint64_t prime = 1099511628211ULL;
-
-    unsigned char buf[8192];
-    size_t n;
-
-    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
-    {
-        for (size_t i = 0; i < n; ++i)
-        {
-            hash ^= buf[i];
-            hash *= prime;
-            hash ^= (hash >> 33);
-            hash = rotl64(hash, 27);
-        }
-    }
-
-    fclose(f);
-
-    // final avalanche
-    hash ^= hash >> 33;
-    hash *= 0xff51afd7ed558ccdULL;
-    hash ^= hash >> 33;
-
-    return hash;
-}
-
-static uint64_t hash_fnv1a(FILE *f)
-{
-    if (!f)
-        return 0;
-
-    uint64_t hash = 14695981039346656037ULL; // FNV offset basis
-    const uint64_t prime = 1099511628211ULL;
-
-    unsigned char buf[8192];
-    size_t n;
-
-    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
-    {
-        for (size_t i = 0; i < n; i++)
-        {
-            hash ^= buf[i];
-            hash *= prime;
-            hash ^= (hash >> 33);
-            hash = rotl64(hash, 27);
-        }
-    }
-
-    // final avalanche
-    hash ^= hash >> 33;
-    hash *= 0xff51afd7ed558ccdULL;
-    hash ^= hash >> 33;
-
-    return hash;
-}
-
 /* ------------------------------------------------------------
  * Internal utilites and platform abstractions
  * ------------------------------------------------------------ */
@@ -182,477 +135,461 @@ int32_t fossil_path_resolve(const char *path, char *out, size_t max_len)
     return 0;
 }
 
-static int copy_file_stream(const char *src, const char *dest)
-{
-    FILE *in = fopen(src, "rb");
-    if (!in)
-        return -1;
-
-    FILE *out = fopen(dest, "wb");
-    if (!out)
-    {
-        fclose(in);
-        return -1;
-    }
-
-    unsigned char buf[8192];
-    size_t n;
+/* ------------------------------------------------------------
+ * Copy engine
+ * ------------------------------------------------------------ */
 
-    while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
-    {
-        if (fwrite(buf, 1, n, out) != n)
-        {
-            fclose(in);
-            fclose(out);
-            return -1;
-        }
-    }
+#define FOSSIL_COPY_BUFFER_SIZE (1024 * 1024)
 
-    fclose(in);
-    fclose(out);
-    return 0;
-}
+#if !defined(_WIN32)
 
-static int file_needs_update(const char *src, const char *dest)
+/* errors that mean "this data path is not available here", not "copy failed" */
+static bool copy_errno_is_unsupported(int err)
 {
-#if defined(_WIN32)
-
-    WIN32_FILE_ATTRIBUTE_DATA s, d;
-
-    if (!GetFileAttributesExA(src, GetFileExInfoStandard, &s))
-        return 1;
-
-    if (!GetFileAttributesExA(dest, GetFileExInfoStandard, &d))
-        return 1;
-
-    uint64_t ssize = ((uint64_t)s.nFileSizeHigh << 32) | s.nFileSizeLow;
-    uint64_t dsize = ((uint64_t)d.nFileSizeHigh << 32) | d.nFileSizeLow;
-
-    if (ssize != dsize)
-        return 1;
-
-    return (CompareFileTime(&s.ftLastWriteTime, &d.ftLastWriteTime) != 0);
-
-#else
-
-    struct stat s, d;
-
-    if (stat(src, &s) != 0)
-        return 1;
-
-    if (stat(dest, &d) != 0)
-        return 1;
-
-    if (s.st_size != d.st_size)
-        return 1;
-
-    return (s.st_mtime != d.st_mtime);
-
-#endif
+    return err == ENOSYS || err == EXDEV || err == EINVAL ||
+           err == EOPNOTSUPP || err == ENOTTY || err == EBADF ||
+           err == ETXTBSY || err == EPERM;
 }
 
-static int remove_path(const char *path)
+static int copy_fd_buffered(int in, int out, uint64_t *copied)
 {
-#if defined(_WIN32)
-    WIN32_FILE_ATTRIBUTE_DATA attr;
-    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attr))
+    unsigned char *buf = malloc(FOSSIL_COPY_BUFFER_SIZE);
+    if (!buf)
         return -1;
 
-    if (attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+    for (;;)
     {
-        char search[FOSSIL_FILESYS_MAX_PATH];
-        snprintf(search, sizeof(search), "%s\\*", path);
-
-        WIN32_FIND_DATAA fd;
-        HANDLE h = FindFirstFileA(search, &fd);
+        ssize_t n = read(in, buf, FOSSIL_COPY_BUFFER_SIZE);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            free(buf);
+            return -1;
+        }
+        if (n == 0)
+            break;
 
-        if (h != INVALID_HANDLE_VALUE)
+        ssize_t off = 0;
+        while (off < n)
         {
-            do
+            ssize_t w = write(out, buf + off, (size_t)(n - off));
+            if (w < 0)
             {
-                if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
+                if (errno == EINTR)
                     continue;
-
-                char full[FOSSIL_FILESYS_MAX_PATH];
-                snprintf(full, sizeof(full), "%s\\%s", path, fd.cFileName);
-                remove_path(full);
-
-            } while (FindNextFileA(h, &fd));
-
-            FindClose(h);
+                free(buf);
+                return -1;
+            }
+            off += w;
         }
-
-        return RemoveDirectoryA(path);
-    }
-    else
-    {
-        return DeleteFileA(path);
+        *copied += (uint64_t)n;
     }
 
-#else
+    free(buf);
+    return 0;
+}
 
-    struct stat st;
-    if (lstat(path, &st) != 0)
-        return -1;
+#if defined(__linux__)
 
-    if (S_ISDIR(st.st_mode))
+/* raw syscall so older libcs without the wrapper still build */
+static ssize_t fossil_copy_file_range(int in, int out, size_t len)
+{
+#if defined(__NR_copy_file_range)
+    return (ssize_t)syscall(__NR_copy_file_range, in, NULL, out, NULL, len, 0u);
+#else
+    (void)in;
+    (void)out;
+    (void)len;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/*
+ * Drive an in-kernel copy primitive until EOF. Returns 0 when done, 1 when
+ * the primitive cannot carry on (unsupported here, or the source came up
+ * short) so the caller falls through, -1 on a real error. File offsets of
+ * both fds advance, so a fallback after a partial copy resumes where this
+ * one stopped.
+ */
+static int copy_fd_kernel(int in, int out, uint64_t remaining, bool use_sendfile, uint64_t *copied)
+{
+    while (remaining > 0)
     {
-        DIR *dir = opendir(path);
-        if (!dir)
-            return -1;
+        size_t chunk = (remaining > (uint64_t)0x40000000) ? (size_t)0x40000000 : (size_t)remaining;
+        ssize_t n;
 
-        struct dirent *entry;
-        char full[512];
+        if (use_sendfile)
+            n = sendfile(out, in, NULL, chunk);
+        else
+            n = fossil_copy_file_range(in, out, chunk);
 
-        while ((entry = readdir(dir)))
+        if (n < 0)
         {
-            if (!strcmp(entry->d_name, ".") ||
-                !strcmp(entry->d_name, ".."))
+            if (errno == EINTR)
                 continue;
-
-            snprintf(full, sizeof(full), "%s/%s", path, entry->d_name);
-            remove_path(full);
+            if (copy_errno_is_unsupported(errno))
+                return 1;
+            return -1;
         }
+        if (n == 0)
+            return 1; /* short source (pseudo file, truncated) → finish in userspace */
 
-        closedir(dir);
-        return rmdir(path);
-    }
-    else
-    {
-        return unlink(path);
+        remaining -= (uint64_t)n;
+        *copied += (uint64_t)n;
     }
+    return 0;
+}
 
 #endif
-}
 
-static int mirror_recursive(
-    const char *src,
-    const char *dest,
-    bool delete_extras)
+#endif
+
+/*
+ * Copy src to dest (created/truncated) and report the data path used.
+ * Metadata is left to the caller.
+ */
+static int fossil_copy_engine(const char *src, const char *dest, fossil_io_filesys_copy_stats_t *stats)
 {
-    /* ensure destination exists */
-    fossil_io_filesys_dir_create(dest, true);
+    fossil_io_filesys_copy_stats_t local = {FOSSIL_FILESYS_COPY_NONE, 0};
+    if (!stats)
+        stats = &local;
 
-#if defined(_WIN32)
+    stats->strategy = FOSSIL_FILESYS_COPY_NONE;
+    stats->bytes_copied = 0;
 
-    WIN32_FIND_DATAA fd;
-    char search[FOSSIL_FILESYS_MAX_PATH];
-    snprintf(search, sizeof(search), "%s\\*", src);
+#if defined(_WIN32)
 
-    HANDLE h = FindFirstFileA(search, &fd);
-    if (h == INVALID_HANDLE_VALUE)
+    FILE *in = fopen(src, "rb");
+    if (!in)
         return -1;
 
-    do
+    FILE *out = fopen(dest, "wb");
+    if (!out)
     {
-        if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
-            continue;
+        fclose(in);
+        return -1;
+    }
 
-        char sfull[FOSSIL_FILESYS_MAX_PATH], dfull[FOSSIL_FILESYS_MAX_PATH];
-        snprintf(sfull, sizeof(sfull), "%s\\%s", src, fd.cFileName);
-        snprintf(dfull, sizeof(dfull), "%s\\%s", dest, fd.cFileName);
+    unsigned char *buf = malloc(FOSSIL_COPY_BUFFER_SIZE);
+    int rc = buf ? 0 : -1;
+    size_t n;
 
-        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-        {
-            mirror_recursive(sfull, dfull, delete_extras);
-        }
+    while (rc == 0 && (n = fread(buf, 1, FOSSIL_COPY_BUFFER_SIZE, in)) > 0)
+    {
+        if (fwrite(buf, 1, n, out) != n)
+            rc = -1;
         else
-        {
-            if (file_needs_update(sfull, dfull))
-                copy_file_stream(sfull, dfull);
-        }
+            stats->bytes_copied += n;
+    }
 
-    } while (FindNextFileA(h, &fd));
+    free(buf);
+    fclose(in);
+    if (fclose(out) != 0)
+        rc = -1;
 
-    FindClose(h);
+    stats->strategy = FOSSIL_FILESYS_COPY_BUFFERED;
+    return rc;
 
 #else
 
-    DIR *dir = opendir(src);
-    if (!dir)
+    int in = open(src, O_RDONLY);
+    if (in < 0)
         return -1;
 
-    struct dirent *entry;
-    char sfull[512], dfull[512];
-
-    while ((entry = readdir(dir)))
+    struct stat st;
+    if (fstat(in, &st) != 0 || S_ISDIR(st.st_mode))
     {
-        if (!strcmp(entry->d_name, ".") ||
-            !strcmp(entry->d_name, ".."))
-            continue;
+        close(in);
+        return -1;
+    }
 
-        snprintf(sfull, sizeof(sfull), "%s/%s", src, entry->d_name);
-        snprintf(dfull, sizeof(dfull), "%s/%s", dest, entry->d_name);
+    int out = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0)
+    {
+        close(in);
+        return -1;
+    }
 
-        struct stat st;
-        if (lstat(sfull, &st) != 0)
-            continue;
+    int rc = 1;
 
-        if (S_ISDIR(st.st_mode))
+#if defined(__linux__)
+    /* st_size == 0 may be a pseudo file; only the read loop handles those */
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+#if defined(FICLONE)
+        if (ioctl(out, FICLONE, in) == 0)
         {
-            mirror_recursive(sfull, dfull, delete_extras);
+            stats->strategy = FOSSIL_FILESYS_COPY_REFLINK;
+            stats->bytes_copied = (uint64_t)st.st_size;
+            rc = 0;
         }
-        else if (S_ISREG(st.st_mode))
+#endif
+        if (rc == 1)
+        {
+            rc = copy_fd_kernel(in, out, (uint64_t)st.st_size, false, &stats->bytes_copied);
+            if (rc == 0)
+                stats->strategy = FOSSIL_FILESYS_COPY_RANGE;
+        }
+        if (rc == 1)
         {
-            if (file_needs_update(sfull, dfull))
-                copy_file_stream(sfull, dfull);
+            uint64_t done = stats->bytes_copied;
+            rc = copy_fd_kernel(in, out, (uint64_t)st.st_size - done, true, &stats->bytes_copied);
+            if (rc == 0)
+                stats->strategy = FOSSIL_FILESYS_COPY_SENDFILE;
         }
     }
-
-    closedir(dir);
-
 #endif
 
-    /* delete extras */
-    if (delete_extras)
+    if (rc == 1)
     {
-#if defined(_WIN32)
-
-        char search[FOSSIL_FILESYS_MAX_PATH];
-        snprintf(search, sizeof(search), "%s\\*", dest);
-
-        WIN32_FIND_DATAA fd;
-        HANDLE h = FindFirstFileA(search, &fd);
-
-        if (h != INVALID_HANDLE_VALUE)
-        {
-            do
-            {
-                if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
-                    continue;
+        rc = copy_fd_buffered(in, out, &stats->bytes_copied);
+        if (rc == 0)
+            stats->strategy = FOSSIL_FILESYS_COPY_BUFFERED;
+    }
 
-                char dfull[FOSSIL_FILESYS_MAX_PATH], sfull[FOSSIL_FILESYS_MAX_PATH];
-                snprintf(dfull, sizeof(dfull), "%s\\%s", dest, fd.cFileName);
-                snprintf(sfull, sizeof(sfull), "%s\\%s", src, fd.cFileName);
+    close(in);
+    if (close(out) != 0)
+        rc = -1;
 
-                if (GetFileAttributesA(sfull) == INVALID_FILE_ATTRIBUTES)
-                    remove_path(dfull);
+    return (rc == 0) ? 0 : -1;
 
-            } while (FindNextFileA(h, &fd));
+#endif
+}
 
-            FindClose(h);
-        }
+/* ------------------------------------------------------------
+ * Positional I/O (64-bit offsets, file offset never moves)
+ * ------------------------------------------------------------ */
 
+#if defined(_WIN32)
+typedef HANDLE fossil_native_t;
+#define FOSSIL_NATIVE_INVALID INVALID_HANDLE_VALUE
 #else
-
-        DIR *dir2 = opendir(dest);
-        if (dir2)
-        {
-            struct dirent *entry;
-            char dfull[512], sfull[512];
-
-            while ((entry = readdir(dir2)))
-            {
-                if (!strcmp(entry->d_name, ".") ||
-                    !strcmp(entry->d_name, ".."))
-                    continue;
-
-                snprintf(dfull, sizeof(dfull), "%s/%s", dest, entry->d_name);
-                snprintf(sfull, sizeof(sfull), "%s/%s", src, entry->d_name);
-
-                if (access(sfull, F_OK) != 0)
-                    remove_path(dfull);
-            }
-
-            closedir(dir2);
-        }
-
+typedef int fossil_native_t;
+#define FOSSIL_NATIVE_INVALID (-1)
 #endif
-    }
 
-    return 0;
+static fossil_native_t fossil_native_open(const char *path, bool write)
+{
+#if defined(_WIN32)
+    return CreateFileA(path, write ? GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, NULL,
+                       write ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+    int flags = write ? (O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY;
+    return open(path, flags | O_CLOEXEC, 0644);
+#endif
 }
 
-typedef struct dedup_entry
+static void fossil_native_close(fossil_native_t h)
 {
-    uint64_t hash;
-    size_t size;
-    char path[FOSSIL_FILESYS_MAX_PATH];
-} dedup_entry_t;
-
-#define DEDUP_MAX 8192
+#if defined(_WIN32)
+    CloseHandle(h);
+#else
+    close(h);
+#endif
+}
 
-static int dedup_walk(
-    const char *path,
-    bool recursive,
-    dedup_entry_t *table,
-    size_t *count)
+static int64_t fossil_native_size(fossil_native_t h)
 {
 #if defined(_WIN32)
+    LARGE_INTEGER li;
+    return GetFileSizeEx(h, &li) ? (int64_t)li.QuadPart : -1;
+#else
+    struct stat st;
+    return (fstat(h, &st) == 0) ? (int64_t)st.st_size : -1;
+#endif
+}
 
-    WIN32_FIND_DATAA fd;
-    char search[FOSSIL_FILESYS_MAX_PATH];
-    snprintf(search, sizeof(search), "%s\\*", path);
-
-    HANDLE h = FindFirstFileA(search, &fd);
-    if (h == INVALID_HANDLE_VALUE)
-        return -1;
-
+/* Set the length without writing; the extension is a hole where supported. */
+static int fossil_native_resize(fossil_native_t h, uint64_t size)
+{
+#if defined(_WIN32)
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = (LONGLONG)size;
+    return SetFileInformationByHandle(h, FileEndOfFileInfo, &info, sizeof(info)) ? 0 : -1;
+#else
+    int rc;
     do
-    {
-        if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
-            continue;
-
-        char full[FOSSIL_FILESYS_MAX_PATH];
-        snprintf(full, sizeof(full), "%s\\%s", path, fd.cFileName);
-
-        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-        {
-            if (recursive)
-                dedup_walk(full, true, table, count);
-            continue;
-        }
-
-        size_t size =
-            ((size_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+        rc = ftruncate(h, (off_t)size);
+    while (rc != 0 && errno == EINTR);
+    return rc;
+#endif
+}
 
+/* One read at offset; returns bytes read, 0 at end of file, -1 on error. */
+static int64_t fossil_native_pread(fossil_native_t h, void *buf, size_t len, uint64_t offset)
+{
+#if defined(_WIN32)
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD)offset;
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD got = 0;
+    DWORD want = (len > 0x40000000u) ? 0x40000000u : (DWORD)len;
+    if (!ReadFile(h, buf, want, &got, &ov))
+        return (GetLastError() == ERROR_HANDLE_EOF) ? 0 : -1;
+    return (int64_t)got;
 #else
-
-    DIR *dir = opendir(path);
-    if (!dir)
-        return -1;
-
-    struct dirent *entry;
-    char full[512];
-
-    while ((entry = readdir(dir)))
+    for (;;)
     {
-        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
-            continue;
-
-        snprintf(full, sizeof(full), "%s/%s", path, entry->d_name);
-
-        struct stat st;
-        if (lstat(full, &st) != 0)
+        ssize_t n = pread(h, buf, len, (off_t)offset);
+        if (n < 0 && errno == EINTR)
             continue;
+        return (int64_t)n;
+    }
+#endif
+}
 
-        if (S_ISDIR(st.st_mode))
-        {
-            if (recursive)
-                dedup_walk(full, true, table, count);
+/* One write at offset; returns bytes written or -1 on error. */
+static int64_t fossil_native_pwrite(fossil_native_t h, const void *buf, size_t len, uint64_t offset)
+{
+#if defined(_WIN32)
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD)offset;
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD put = 0;
+    DWORD want = (len > 0x40000000u) ? 0x40000000u : (DWORD)len;
+    if (!WriteFile(h, buf, want, &put, &ov))
+        return -1;
+    return (int64_t)put;
+#else
+    for (;;)
+    {
+        ssize_t n = pwrite(h, buf, len, (off_t)offset);
+        if (n < 0 && errno == EINTR)
             continue;
-        }
+        return (int64_t)n;
+    }
+#endif
+}
 
-        if (!S_ISREG(st.st_mode))
-            continue;
+/*
+ * Find the next stretch of data in [pos, end) of a possibly sparse file.
+ * Returns false when only a hole remains; otherwise [*data, *data_end) is
+ * data. Without SEEK_DATA support the whole range counts as data.
+ */
+static bool fossil_native_next_data(fossil_native_t h, uint64_t pos, uint64_t end, uint64_t *data, uint64_t *data_end)
+{
+    *data = pos;
+    *data_end = end;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    off_t d = lseek(h, (off_t)pos, SEEK_DATA);
+    if (d < 0)
+        return errno != ENXIO; /* ENXIO: nothing but hole past pos */
+    if ((uint64_t)d >= end)
+        return false;
+    off_t hole = lseek(h, d, SEEK_HOLE);
+    *data = (uint64_t)d;
+    if (hole >= 0 && (uint64_t)hole < end)
+        *data_end = (uint64_t)hole;
+#else
+    (void)h;
+#endif
+    return pos < end;
+}
 
-        size_t size = st.st_size;
+/*
+ * Copy len bytes from in@in_off to out@out_off with positional I/O, skipping
+ * holes so sparse inputs stay sparse (the caller sizes `out` up front).
+ */
+static int fossil_native_copy_range(fossil_native_t in, uint64_t in_off, fossil_native_t out, uint64_t out_off,
+                                    uint64_t len, unsigned char *buf, size_t buf_size)
+{
+    uint64_t end = in_off + len, data, data_end;
+    uint64_t pos = in_off;
 
+#if defined(__linux__) && defined(__NR_copy_file_range)
+    bool kernel = true;
 #endif
 
-        /* compute hash */
-        uint64_t hash = fossil_hash_file(full);
-
-        /* check duplicates */
-        for (size_t i = 0; i < *count; ++i)
+    while (pos < end && fossil_native_next_data(in, pos, end, &data, &data_end))
+    {
+        pos = data;
+#if defined(__linux__) && defined(__NR_copy_file_range)
+        /* in-kernel first; drop to the buffer once this pair of files can't */
+        while (kernel && pos < data_end)
         {
-            if (table[i].hash == hash && table[i].size == size)
+            int64_t ioff = (int64_t)pos, ooff = (int64_t)(out_off + (pos - in_off));
+            size_t want = (data_end - pos > 0x40000000u) ? 0x40000000u : (size_t)(data_end - pos);
+            ssize_t n = (ssize_t)syscall(__NR_copy_file_range, in, &ioff, out, &ooff, want, 0u);
+            if (n > 0)
             {
-                /* duplicate → remove */
-#if defined(_WIN32)
-                DeleteFileA(full);
-#else
-                unlink(full);
-#endif
-                return 1; /* one removed */
+                pos += (uint64_t)n;
+                continue;
             }
+            if (n == 0)
+                return -1; /* the source shrank underneath us */
+            if (errno == EINTR)
+                continue;
+            if (!copy_errno_is_unsupported(errno))
+                return -1;
+            kernel = false;
         }
-
-        /* insert */
-        if (*count < DEDUP_MAX)
+#endif
+        while (pos < data_end)
         {
-            table[*count].hash = hash;
-            table[*count].size = size;
-            snprintf(table[*count].path, sizeof(table[*count].path), "%s", full);
-            (*count)++;
-        }
-
-#if defined(_WIN32)
-    } while (FindNextFileA(h, &fd));
+            size_t want = (data_end - pos > buf_size) ? buf_size : (size_t)(data_end - pos);
+            int64_t n = fossil_native_pread(in, buf, want, pos);
+            if (n <= 0)
+                return -1; /* error, or the source shrank underneath us */
 
-    FindClose(h);
-
-#else
+            for (int64_t done = 0; done < n;)
+            {
+                int64_t w = fossil_native_pwrite(out, buf + done, (size_t)(n - done), out_off + (pos - in_off) + (uint64_t)done);
+                if (w <= 0)
+                    return -1;
+                done += w;
+            }
+            pos += (uint64_t)n;
+        }
     }
-
-    closedir(dir);
-
-#endif
-
     return 0;
 }
 
-static int remove_recursive(const char *path)
+static int file_needs_update(const char *src, const char *dest)
 {
 #if defined(_WIN32)
-    WIN32_FIND_DATAA fd;
-    char search[FOSSIL_FILESYS_MAX_PATH];
-    snprintf(search, sizeof(search), "%s\\*", path);
 
-    HANDLE h = FindFirstFileA(search, &fd);
-    if (h == INVALID_HANDLE_VALUE)
-        return -1;
+    WIN32_FILE_ATTRIBUTE_DATA s, d;
 
-    do
-    {
-        if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
-            continue;
+    if (!GetFileAttributesExA(src, GetFileExInfoStandard, &s))
+        return 1;
 
-        char full[FOSSIL_FILESYS_MAX_PATH];
-        snprintf(full, sizeof(full), "%s\\%s", path, fd.cFileName);
+    if (!GetFileAttributesExA(dest, GetFileExInfoStandard, &d))
+        return 1;
 
-        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-        {
-            remove_recursive(full);
-            RemoveDirectoryA(full);
-        }
-        else
-        {
-            DeleteFileA(full);
-        }
+    uint64_t ssize = ((uint64_t)s.nFileSizeHigh << 32) | s.nFileSizeLow;
+    uint64_t dsize = ((uint64_t)d.nFileSizeHigh << 32) | d.nFileSizeLow;
 
-    } while (FindNextFileA(h, &fd));
+    if (ssize != dsize)
+        return 1;
 
-    FindClose(h);
-    return RemoveDirectoryA(path) ? 0 : -1;
+    return (CompareFileTime(&s.ftLastWriteTime, &d.ftLastWriteTime) != 0);
 
 #else
 
-    DIR *dir = opendir(path);
-    if (!dir)
-        return -1;
-
-    struct dirent *entry;
-    char full[512];
-
-    while ((entry = readdir(dir)))
-    {
-        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
-            continue;
+    struct stat s, d;
 
-        snprintf(full, sizeof(full), "%s/%s", path, entry->d_name);
+    if (stat(src, &s) != 0)
+        return 1;
 
-        struct stat st;
-        if (lstat(full, &st) != 0)
-            continue;
+    if (stat(dest, &d) != 0)
+        return 1;
 
-        if (S_ISDIR(st.st_mode))
-        {
-            remove_recursive(full);
-            rmdir(full);
-        }
-        else
-        {
-            unlink(full);
-        }
-    }
+    if (s.st_size != d.st_size)
+        return 1;
 
-    closedir(dir);
-    return rmdir(path);
+    return (s.st_mtime != d.st_mtime);
 
 #endif
 }
 
+/* Defined with the directory handles, which they are built on. */
+static int remove_path(const char *path, size_t threads);
+static int remove_recursive(const char *path, size_t threads);
+
 /* ------------------------------------------------------------
  * Thread / Mutex Abstraction
  * ------------------------------------------------------------ */
@@ -688,6 +625,8 @@ static int fossil_mutex_init(fossil_io_filesys_lock_t *lock)
 
 static int fossil_mutex_lock(fossil_io_filesys_lock_t *lock)
 {
+    if (!lock->handle) /* objects produced by listings carry no mutex */
+        return 0;
 #if defined(_WIN32)
     WaitForSingleObject(lock->handle, INFINITE);
 #else
@@ -699,6 +638,8 @@ static int fossil_mutex_lock(fossil_io_filesys_lock_t *lock)
 
 static int fossil_mutex_unlock(fossil_io_filesys_lock_t *lock)
 {
+    if (!lock->handle)
+        return 0;
 #if defined(_WIN32)
     ReleaseMutex(lock->handle);
 #else
@@ -709,1342 +650,2075 @@ static int fossil_mutex_unlock(fossil_io_filesys_lock_t *lock)
 }
 
 /* ------------------------------------------------------------
- * General Filesystem Operations
+ * Standard Streams
  * ------------------------------------------------------------ */
 
-static void fossil_generate_id(const char *path, char *out, size_t len)
-{
-    /* simple stable hash (FNV-1a) */
-    uint32_t hash = 2166136261u;
+/*
+ * The standard stream objects are static so FOSSIL_STDOUT and friends are
+ * usable without setup; their FILE handles are bound on first use since
+ * stdin/stdout/stderr are not constant expressions.
+ */
+#if defined(_WIN32)
+#define FOSSIL_STD_LOCK(mutex) {NULL, false}
+#else
+static pthread_mutex_t fossil_stdin_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t fossil_stdout_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t fossil_stderr_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define FOSSIL_STD_LOCK(mutex) {&mutex, false}
+#endif
 
-    for (const char *p = path; *p; ++p)
-    {
-        hash ^= (unsigned char)(*p);
-        hash *= 16777619;
+#define FOSSIL_STD_FILE(name, fdno, mutex)                                            \
+    {                                                                                 \
+        .base = {.path = name, .type = FOSSIL_FILESYS_TYPE_FILE, .lock = FOSSIL_STD_LOCK(mutex)}, \
+        .fd = fdno,                                                                   \
+        .is_open = true,                                                              \
+        .flush_level = FOSSIL_FILESYS_FLUSH_BUFFER                                    \
     }
 
-    snprintf(out, len, "%08x", hash);
-}
-
-int32_t fossil_io_filesys_init(fossil_io_filesys_obj_t *obj, const char *path)
-{
-    if (!obj || !path)
-        return -1;
-
-    memset(obj, 0, sizeof(*obj));
+static fossil_io_filesys_file_t fossil_stdin_file = FOSSIL_STD_FILE("<stdin>", 0, fossil_stdin_mutex);
+static fossil_io_filesys_file_t fossil_stdout_file = FOSSIL_STD_FILE("<stdout>", 1, fossil_stdout_mutex);
+static fossil_io_filesys_file_t fossil_stderr_file = FOSSIL_STD_FILE("<stderr>", 2, fossil_stderr_mutex);
 
-    /* copy path safely */
-    strncpy(obj->path, path, FOSSIL_FILESYS_MAX_PATH - 1);
-    obj->path[FOSSIL_FILESYS_MAX_PATH - 1] = '\0';
+fossil_io_filesys_file_t *_FOSSIL_STDIN = &fossil_stdin_file;
+fossil_io_filesys_file_t *_FOSSIL_STDOUT = &fossil_stdout_file;
+fossil_io_filesys_file_t *_FOSSIL_STDERR = &fossil_stderr_file;
 
-    /* init lock */
-    if (fossil_mutex_init(&obj->lock) != 0)
-        return -1;
+static void fossil_std_bind_once(void)
+{
+    fossil_stdin_file.handle = stdin;
+    fossil_stdout_file.handle = stdout;
+    fossil_stderr_file.handle = stderr;
+}
 
-    /* generate stable ID */
-    fossil_generate_id(path, obj->id, sizeof(obj->id));
+#if defined(_WIN32)
+static BOOL CALLBACK fossil_std_bind_cb(PINIT_ONCE once, PVOID param, PVOID *ctx)
+{
+    (void)once;
+    (void)param;
+    (void)ctx;
+    fossil_std_bind_once();
+    return TRUE;
+}
+#endif
 
-    /* initialize default values */
-    obj->type = FOSSIL_FILESYS_TYPE_UNKNOWN;
-    obj->size = 0;
-    obj->mode = 0;
-    obj->flags = 0;
-    obj->created_at = 0;
-    obj->modified_at = 0;
-    obj->accessed_at = 0;
+/* True if f is open and has a usable stream, binding the std objects lazily. */
+static bool file_ready(fossil_io_filesys_file_t *f)
+{
+    if (!f || !f->is_open)
+        return false;
 
-    /* infer type from path hints */
-    size_t len = strlen(path);
-    if (len > 0 && (path[len - 1] == '/' || path[len - 1] == '\\'))
-    {
-        obj->type = FOSSIL_FILESYS_TYPE_DIR;
-    }
-    else if (len > 0)
+    if (!f->handle)
     {
-        const char *dot = strrchr(path, '.');
-        if (dot)
-        {
-            /* Enhanced link detection */
-            if (strcmp(dot, ".lnk") == 0 || strcmp(dot, ".link") == 0 ||
-                strcmp(dot, ".symlink") == 0)
-            {
-                obj->type = FOSSIL_FILESYS_TYPE_LINK;
-            }
-            /* Detect common archive types */
-            else if (strcmp(dot, ".zip") == 0 || strcmp(dot, ".tar") == 0 ||
-                     strcmp(dot, ".gz") == 0 || strcmp(dot, ".bz2") == 0 ||
-                     strcmp(dot, ".7z") == 0 || strcmp(dot, ".rar") == 0)
-            {
-                obj->type = FOSSIL_FILESYS_TYPE_ARCHIVE;
-            }
-            else
-            {
-                obj->type = FOSSIL_FILESYS_TYPE_FILE;
-            }
-        }
-        else
-        {
-            obj->type = FOSSIL_FILESYS_TYPE_FILE;
-        }
+#if defined(_WIN32)
+        static INIT_ONCE once = INIT_ONCE_STATIC_INIT;
+        InitOnceExecuteOnce(&once, fossil_std_bind_cb, NULL, NULL);
+#else
+        static pthread_once_t once = PTHREAD_ONCE_INIT;
+        pthread_once(&once, fossil_std_bind_once);
+#endif
     }
 
-    /* initial metadata load (don't fail if path doesn't exist) */
-    fossil_io_filesys_refresh(obj);
+    return f->handle != NULL;
+}
 
-    /* If the path exists and is a directory, force type to DIR */
-    int32_t exists = fossil_io_filesys_dir_exists(obj->path);
-    if (exists == 1)
-        obj->type = FOSSIL_FILESYS_TYPE_DIR;
+/* ------------------------------------------------------------
+ * Worker Threads
+ * ------------------------------------------------------------ */
 
-    return 0;
+size_t fossil_cpu_count(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors ? (size_t)si.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (size_t)n : 1;
+#endif
 }
 
-int32_t fossil_io_filesys_refresh(fossil_io_filesys_obj_t *obj)
+typedef struct
 {
-    if (!obj || !obj->path[0])
-        return -1;
-
-    fossil_mutex_lock(&obj->lock);
+    void (*fn)(void *arg, size_t index);
+    void *arg;
+    size_t index;
+} fossil_worker_t;
 
 #if defined(_WIN32)
+static DWORD WINAPI fossil_worker_entry(LPVOID p)
+{
+    fossil_worker_t *w = (fossil_worker_t *)p;
+    w->fn(w->arg, w->index);
+    return 0;
+}
+#else
+static void *fossil_worker_entry(void *p)
+{
+    fossil_worker_t *w = (fossil_worker_t *)p;
+    w->fn(w->arg, w->index);
+    return NULL;
+}
+#endif
 
-    WIN32_FILE_ATTRIBUTE_DATA data;
-    if (!GetFileAttributesExA(obj->path, GetFileExInfoStandard, &data))
-    {
-        fossil_mutex_unlock(&obj->lock);
-        return -1;
-    }
-
-    obj->size =
-        ((size_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
-
-    obj->created_at = data.ftCreationTime.dwLowDateTime;
-    obj->modified_at = data.ftLastWriteTime.dwLowDateTime;
-    obj->accessed_at = data.ftLastAccessTime.dwLowDateTime;
-
-    if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-        obj->type = FOSSIL_FILESYS_TYPE_DIR;
-    else
+/* Declared in workers.h, which archive.c shares. */
+void fossil_run_workers(size_t count, void (*fn)(void *arg, size_t index), void *arg)
+{
+    if (count <= 1)
     {
-        /* Check if file is an archive based on extension */
-        const char *dot = strrchr(obj->path, '.');
-        if (dot && (strcmp(dot, ".zip") == 0 || strcmp(dot, ".tar") == 0 ||
-                    strcmp(dot, ".gz") == 0 || strcmp(dot, ".bz2") == 0 ||
-                    strcmp(dot, ".7z") == 0 || strcmp(dot, ".rar") == 0))
-        {
-            obj->type = FOSSIL_FILESYS_TYPE_ARCHIVE;
-        }
-        else
-        {
-            obj->type = FOSSIL_FILESYS_TYPE_FILE;
-        }
+        fn(arg, 0);
+        return;
     }
 
+    fossil_worker_t *workers = malloc(count * sizeof(*workers));
+#if defined(_WIN32)
+    HANDLE *threads = malloc(count * sizeof(*threads));
 #else
+    pthread_t *threads = malloc(count * sizeof(*threads));
+#endif
+    bool *started = calloc(count, sizeof(*started));
 
-    struct stat st;
-    if (lstat(obj->path, &st) != 0)
+    if (!workers || !threads || !started)
     {
-        fossil_mutex_unlock(&obj->lock);
-        return -1;
+        free(workers);
+        free(threads);
+        free(started);
+        fn(arg, 0);
+        return;
     }
 
-    obj->size = st.st_size;
-    obj->mode = st.st_mode;
-
-    obj->created_at = st.st_ctime;
-    obj->modified_at = st.st_mtime;
-    obj->accessed_at = st.st_atime;
-
-    if (S_ISREG(st.st_mode))
+    for (size_t i = 1; i < count; ++i)
     {
-        /* Check if file is an archive based on extension */
-        const char *dot = strrchr(obj->path, '.');
-        if (dot && (strcmp(dot, ".zip") == 0 || strcmp(dot, ".tar") == 0 ||
-                    strcmp(dot, ".gz") == 0 || strcmp(dot, ".bz2") == 0 ||
-                    strcmp(dot, ".7z") == 0 || strcmp(dot, ".rar") == 0))
-        {
-            obj->type = FOSSIL_FILESYS_TYPE_ARCHIVE;
-        }
-        else
-        {
-            obj->type = FOSSIL_FILESYS_TYPE_FILE;
-        }
+        workers[i].fn = fn;
+        workers[i].arg = arg;
+        workers[i].index = i;
+#if defined(_WIN32)
+        threads[i] = CreateThread(NULL, 0, fossil_worker_entry, &workers[i], 0, NULL);
+        started[i] = (threads[i] != NULL);
+#else
+        started[i] = (pthread_create(&threads[i], NULL, fossil_worker_entry, &workers[i]) == 0);
+#endif
     }
-    else if (S_ISDIR(st.st_mode))
-        obj->type = FOSSIL_FILESYS_TYPE_DIR;
-    else if (S_ISLNK(st.st_mode))
-        obj->type = FOSSIL_FILESYS_TYPE_LINK;
-    else
-        obj->type = FOSSIL_FILESYS_TYPE_UNKNOWN;
 
-    obj->perms.read = (st.st_mode & S_IRUSR) != 0;
-    obj->perms.write = (st.st_mode & S_IWUSR) != 0;
-    obj->perms.execute = (st.st_mode & S_IXUSR) != 0;
+    fn(arg, 0);
 
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (!started[i])
+            continue;
+#if defined(_WIN32)
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
 #endif
+    }
 
-    fossil_mutex_unlock(&obj->lock);
-    return 0;
+    free(workers);
+    free(threads);
+    free(started);
 }
 
-int32_t fossil_io_filesys_exists(const char *path)
-{
-    if (!path)
-        return -1;
+/* ------------------------------------------------------------
+ * Hash Registry
+ * ------------------------------------------------------------ */
 
-#if defined(_WIN32)
-    DWORD attr = GetFileAttributesA(path);
-    if (attr == INVALID_FILE_ATTRIBUTES)
-    {
-        if (GetLastError() == ERROR_FILE_NOT_FOUND ||
-            GetLastError() == ERROR_PATH_NOT_FOUND)
-            return 0;
-        return -1;
-    }
-    return 1;
-#else
-    struct stat st;
-    if (lstat(path, &st) == 0)
-        return 1;
+/*
+ * Every algorithm is a streaming init/update/final triple, so the same file
+ * reader, tree mode and internal callers (dedup, mirror) work with any of
+ * them. Hardware paths (SSE4.2 / ARMv8 CRC, SHA-NI) are picked at run time.
+ */
 
-    if (errno == ENOENT)
-        return 0;
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define FOSSIL_HASH_X86 1
+#define FOSSIL_TARGET(features) __attribute__((target(features)))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define FOSSIL_HASH_X86 1
+#define FOSSIL_TARGET(features)
+#endif
 
-    return -1;
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define FOSSIL_HASH_ARM_CRC 1
 #endif
+
+#define FOSSIL_HASH_WINDOW ((size_t)64 * 1024 * 1024)
+#define FOSSIL_HASH_LEAF ((uint64_t)64 * 1024 * 1024)
+
+static size_t fossil_map_granularity(void);
+
+static inline uint64_t rotl64(uint64_t x, unsigned int r)
+{
+    return (x << r) | (x >> (64 - r));
 }
 
-int32_t fossil_io_filesys_remove(const char *path, bool recursive)
+static inline uint32_t hash_read32le(const unsigned char *p)
 {
-    if (!path)
-        return -1;
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
 
-#if defined(_WIN32)
+static inline uint64_t hash_read64le(const unsigned char *p)
+{
+    return (uint64_t)hash_read32le(p) | (uint64_t)hash_read32le(p + 4) << 32;
+}
 
-    DWORD attr = GetFileAttributesA(path);
-    if (attr == INVALID_FILE_ATTRIBUTES)
-        return -1;
+static void hash_put_be(unsigned char *out, uint64_t v, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+        out[i] = (unsigned char)(v >> (8 * (bytes - 1 - i)));
+}
 
-    if (attr & FILE_ATTRIBUTE_DIRECTORY)
-    {
-        if (!recursive)
-            return RemoveDirectoryA(path) ? 0 : -1;
+/* CPU features, probed once. */
+enum
+{
+    HASH_CPU_PROBED = 1,
+    HASH_CPU_CRC32 = 2,
+    HASH_CPU_SHA = 4
+};
 
-        return remove_recursive(path);
-    }
-    else
+static atomic_int hash_cpu_flags;
+
+static int hash_cpu(void)
+{
+    int flags = atomic_load_explicit(&hash_cpu_flags, memory_order_relaxed);
+    if (flags)
+        return flags;
+
+    flags = HASH_CPU_PROBED;
+#if defined(FOSSIL_HASH_X86)
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 1);
+    c = (unsigned int)r[2];
+    __cpuidex(r, 7, 0);
+    b = (unsigned int)r[1];
+#else
+    if (__get_cpuid(1, &a, &b, &c, &d))
     {
-        return DeleteFileA(path) ? 0 : -1;
+        unsigned int c1 = c;
+        b = 0;
+        __get_cpuid_count(7, 0, &a, &b, &c, &d);
+        c = c1;
     }
+#endif
+    if (c & (1u << 20)) /* SSE4.2 */
+        flags |= HASH_CPU_CRC32;
+    if ((b & (1u << 29)) && (c & (1u << 19)) && (c & (1u << 9))) /* SHA, SSE4.1, SSSE3 */
+        flags |= HASH_CPU_SHA;
+#elif defined(FOSSIL_HASH_ARM_CRC)
+    flags |= HASH_CPU_CRC32;
+#endif
+    atomic_store_explicit(&hash_cpu_flags, flags, memory_order_relaxed);
+    return flags;
+}
 
-#else
+/* -- fnv1a: the library's original 64-bit byte-wise hash, kept bit-for-bit -- */
 
-    struct stat st;
-    if (lstat(path, &st) != 0)
-        return -1;
+typedef struct
+{
+    uint64_t h;
+} hash_fnv_t;
 
-    if (S_ISDIR(st.st_mode))
-    {
-        if (!recursive)
-            return rmdir(path);
+static void hash_fnv_init(void *state)
+{
+    ((hash_fnv_t *)state)->h = 14695981039346656037ULL;
+}
 
-        return remove_recursive(path);
-    }
-    else
+static void hash_fnv_update(void *state, const unsigned char *p, size_t len)
+{
+    uint64_t h = ((hash_fnv_t *)state)->h;
+    for (size_t i = 0; i < len; ++i)
     {
-        return unlink(path);
+        h ^= p[i];
+        h *= 1099511628211ULL;
+        h ^= (h >> 33);
+        h = rotl64(h, 27);
     }
+    ((hash_fnv_t *)state)->h = h;
+}
 
-#endif
+static void hash_fnv_final(void *state, unsigned char *out)
+{
+    uint64_t h = ((hash_fnv_t *)state)->h;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    memcpy(out, &h, sizeof(h)); /* native byte order, as before */
 }
 
-int32_t fossil_io_filesys_move(const char *src, const char *dest)
+/* -- xxh64 -- */
+
+#define XXH_P1 11400714785074694791ULL
+#define XXH_P2 14029467366897019727ULL
+#define XXH_P3 1609587929392839161ULL
+#define XXH_P4 9650029242287828579ULL
+#define XXH_P5 2870177450012600261ULL
+
+typedef struct
 {
-    if (!src || !dest)
-        return -1;
+    uint64_t v[4];
+    uint64_t total;
+    unsigned char mem[32];
+    size_t mem_len;
+} hash_xxh64_t;
 
-#if defined(_WIN32)
-    if (MoveFileExA(src, dest, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
-        return 0;
-    return -1;
-#else
-    if (rename(src, dest) == 0)
-        return 0;
-    return -1;
-#endif
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_P2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_P1;
 }
 
-int32_t fossil_io_filesys_copy(const char *src, const char *dest, bool preserve_meta)
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t v)
 {
-    FILE *in = fopen(src, "rb");
-    if (!in)
-        return -1;
+    acc ^= xxh64_round(0, v);
+    return acc * XXH_P1 + XXH_P4;
+}
 
-    FILE *out = fopen(dest, "wb");
-    if (!out)
+static void hash_xxh64_init(void *state)
+{
+    hash_xxh64_t *s = (hash_xxh64_t *)state;
+    memset(s, 0, sizeof(*s));
+    s->v[0] = XXH_P1 + XXH_P2;
+    s->v[1] = XXH_P2;
+    s->v[2] = 0;
+    s->v[3] = (uint64_t)0 - XXH_P1;
+}
+
+/* Four independent lanes keep the multipliers busy; this is the hot loop. */
+static const unsigned char *xxh64_stripes(uint64_t v[4], const unsigned char *p, const unsigned char *end)
+{
+    uint64_t v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+    while (p + 32 <= end)
     {
-        fclose(in);
-        return -1;
+        v0 = xxh64_round(v0, hash_read64le(p));
+        v1 = xxh64_round(v1, hash_read64le(p + 8));
+        v2 = xxh64_round(v2, hash_read64le(p + 16));
+        v3 = xxh64_round(v3, hash_read64le(p + 24));
+        p += 32;
     }
+    v[0] = v0;
+    v[1] = v1;
+    v[2] = v2;
+    v[3] = v3;
+    return p;
+}
 
-    char buffer[8192];
-    size_t n;
+static void hash_xxh64_update(void *state, const unsigned char *p, size_t len)
+{
+    hash_xxh64_t *s = (hash_xxh64_t *)state;
+    const unsigned char *end = p + len;
+    s->total += len;
 
-    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    if (s->mem_len + len < 32)
     {
-        if (fwrite(buffer, 1, n, out) != n)
-        {
-            fclose(in);
-            fclose(out);
-            return -1;
-        }
+        memcpy(s->mem + s->mem_len, p, len);
+        s->mem_len += len;
+        return;
+    }
+    if (s->mem_len)
+    {
+        size_t fill = 32 - s->mem_len;
+        memcpy(s->mem + s->mem_len, p, fill);
+        xxh64_stripes(s->v, s->mem, s->mem + 32);
+        p += fill;
+        s->mem_len = 0;
     }
+    p = xxh64_stripes(s->v, p, end);
+    s->mem_len = (size_t)(end - p);
+    memcpy(s->mem, p, s->mem_len);
+}
 
-    fclose(in);
-    fclose(out);
+static uint64_t hash_xxh64_digest(const hash_xxh64_t *s)
+{
+    uint64_t h;
+    if (s->total >= 32)
+    {
+        h = rotl64(s->v[0], 1) + rotl64(s->v[1], 7) + rotl64(s->v[2], 12) + rotl64(s->v[3], 18);
+        for (int i = 0; i < 4; ++i)
+            h = xxh64_merge(h, s->v[i]);
+    }
+    else
+    {
+        h = XXH_P5;
+    }
+    h += s->total;
 
-    /* Optional metadata copy */
-    if (preserve_meta)
+    const unsigned char *p = s->mem, *end = s->mem + s->mem_len;
+    for (; p + 8 <= end; p += 8)
     {
-        struct stat st;
-        if (stat(src, &st) == 0)
-        {
-            chmod(dest, st.st_mode);
-        }
+        h ^= xxh64_round(0, hash_read64le(p));
+        h = rotl64(h, 27) * XXH_P1 + XXH_P4;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= (uint64_t)hash_read32le(p) * XXH_P1;
+        h = rotl64(h, 23) * XXH_P2 + XXH_P3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        h ^= (uint64_t)*p * XXH_P5;
+        h = rotl64(h, 11) * XXH_P1;
     }
 
-    return 0;
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
 }
 
-int32_t fossil_io_filesys_swap(const char *path1, const char *path2)
+static void hash_xxh64_final(void *state, unsigned char *out)
 {
-    if (!path1 || !path2)
-        return -1;
+    hash_put_be(out, hash_xxh64_digest((const hash_xxh64_t *)state), 8);
+}
 
-    char tmp[FOSSIL_FILESYS_MAX_PATH];
-    snprintf(tmp, sizeof(tmp), "%s.swap.tmp", path1);
+static uint64_t fossil_hash64_buffer(const void *data, size_t len)
+{
+    hash_xxh64_t s;
+    hash_xxh64_init(&s);
+    hash_xxh64_update(&s, (const unsigned char *)data, len);
+    return hash_xxh64_digest(&s);
+}
 
-    /* Step 1: path1 -> tmp */
-    if (rename(path1, tmp) != 0)
-        return -1;
+/* -- crc32c (Castagnoli) -- */
 
-    /* Step 2: path2 -> path1 */
-    if (rename(path2, path1) != 0)
+#define CRC32C_POLY 0x82F63B78u
+#define CRC32C_LANE 8192 /* bytes per lane in the 3-way hardware loop */
+
+static uint32_t crc32c_table[8][256];
+static uint32_t crc32c_lane_shift; /* x^(8 * CRC32C_LANE) mod P */
+
+/* Multiply a and b modulo P, in reflected bit order. */
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31, p = 0;
+    for (;;)
     {
-        rename(tmp, path1); /* rollback */
-        return -1;
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
     }
+    return p;
+}
 
-    /* Step 3: tmp -> path2 */
-    if (rename(tmp, path2) != 0)
+/* x^(8n) mod P: the operator that shifts a CRC register past n zero bytes. */
+static uint32_t crc32c_x8nmodp(size_t n)
+{
+    uint32_t x2n = 1u << 30; /* x^1 */
+    uint32_t xp = 1u << 31;  /* x^0 */
+    for (int k = 0; k < 3; ++k)
+        x2n = crc32c_multmodp(x2n, x2n); /* x^8 */
+    while (n)
     {
-        /* catastrophic but recoverable */
-        rename(path1, path2);
-        rename(tmp, path1);
-        return -1;
+        if (n & 1)
+            xp = crc32c_multmodp(x2n, xp);
+        x2n = crc32c_multmodp(x2n, x2n);
+        n >>= 1;
     }
-
-    return 0;
+    return xp;
 }
 
-int32_t fossil_io_filesys_deduplicate(const char *path, bool recursive)
+static void crc32c_init_tables(void)
 {
-    if (!path)
-        return -1;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? CRC32C_POLY ^ (c >> 1) : c >> 1;
+        crc32c_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+        for (int k = 1; k < 8; k++)
+            crc32c_table[k][i] = (crc32c_table[k - 1][i] >> 8) ^ crc32c_table[0][crc32c_table[k - 1][i] & 0xFF];
+    crc32c_lane_shift = crc32c_x8nmodp(CRC32C_LANE);
+}
 
-    dedup_entry_t table[DEDUP_MAX];
-    size_t count = 0;
-    int removed = 0;
+#ifdef _WIN32
+static INIT_ONCE crc32c_once = INIT_ONCE_STATIC_INIT;
 
-#if defined(_WIN32)
-    removed += dedup_walk(path, recursive, table, &count);
+static BOOL CALLBACK crc32c_init_once(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    (void)once;
+    (void)param;
+    (void)context;
+    crc32c_init_tables();
+    return TRUE;
+}
 #else
-    removed += dedup_walk(path, recursive, table, &count);
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
 #endif
 
-    return removed;
+/* Raw register update (no pre/post inversion), slice-by-8. */
+static uint32_t crc32c_sw(uint32_t c, const unsigned char *p, size_t len)
+{
+    while (len >= 8)
+    {
+        uint32_t one = c ^ hash_read32le(p);
+        uint32_t two = hash_read32le(p + 4);
+        c = crc32c_table[7][one & 0xFF] ^ crc32c_table[6][(one >> 8) & 0xFF] ^
+            crc32c_table[5][(one >> 16) & 0xFF] ^ crc32c_table[4][one >> 24] ^
+            crc32c_table[3][two & 0xFF] ^ crc32c_table[2][(two >> 8) & 0xFF] ^
+            crc32c_table[1][(two >> 16) & 0xFF] ^ crc32c_table[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        c = crc32c_table[0][(c ^ *p++) & 0xFF] ^ (c >> 8);
+    return c;
 }
 
-int32_t fossil_io_filesys_stat(const char *path, fossil_io_filesys_obj_t *obj)
+#if defined(FOSSIL_HASH_X86) && (defined(__x86_64__) || defined(_M_X64))
+#define crc32c_hw_word(c, p) ((uint32_t)_mm_crc32_u64((c), hash_read64le(p)))
+#define crc32c_hw_byte(c, b) _mm_crc32_u8((c), (b))
+#define FOSSIL_CRC32C_HW FOSSIL_TARGET("sse4.2")
+#elif defined(FOSSIL_HASH_ARM_CRC)
+#define crc32c_hw_word(c, p) __crc32cd((c), hash_read64le(p))
+#define crc32c_hw_byte(c, b) __crc32cb((c), (b))
+#define FOSSIL_CRC32C_HW
+#endif
+
+#if defined(crc32c_hw_word)
+/*
+ * The CRC instruction has a latency of three cycles but issues every cycle,
+ * so three lanes run side by side and are stitched together by shifting the
+ * earlier lanes' registers past the later lanes' bytes.
+ */
+FOSSIL_CRC32C_HW
+static uint32_t crc32c_hw(uint32_t c, const unsigned char *p, size_t len)
 {
-    if (!path || !obj)
-        return -1;
+    while (len >= 3 * CRC32C_LANE)
+    {
+        uint32_t c1 = 0, c2 = 0;
+        for (size_t i = 0; i < CRC32C_LANE; i += 8)
+        {
+            c = crc32c_hw_word(c, p + i);
+            c1 = crc32c_hw_word(c1, p + CRC32C_LANE + i);
+            c2 = crc32c_hw_word(c2, p + 2 * CRC32C_LANE + i);
+        }
+        c = crc32c_multmodp(crc32c_lane_shift, c) ^ c1;
+        c = crc32c_multmodp(crc32c_lane_shift, c) ^ c2;
+        p += 3 * CRC32C_LANE;
+        len -= 3 * CRC32C_LANE;
+    }
+    for (; len >= 8; len -= 8, p += 8)
+        c = crc32c_hw_word(c, p);
+    while (len--)
+        c = crc32c_hw_byte(c, *p++);
+    return c;
+}
+#endif
 
-    // Always initialize with the given path, then refresh metadata.
-    if (fossil_io_filesys_init(obj, path) != 0)
-        return -1;
+typedef struct
+{
+    uint32_t crc;
+} hash_crc32c_t;
 
-    // Refresh to get up-to-date type and metadata.
-    if (fossil_io_filesys_refresh(obj) != 0)
-        return -1;
+static void hash_crc32c_init(void *state)
+{
+#ifdef _WIN32
+    InitOnceExecuteOnce(&crc32c_once, crc32c_init_once, NULL, NULL);
+#else
+    pthread_once(&crc32c_once, crc32c_init_tables);
+#endif
+    ((hash_crc32c_t *)state)->crc = 0xFFFFFFFFu;
+}
 
-    return 0;
+static void hash_crc32c_update(void *state, const unsigned char *p, size_t len)
+{
+    hash_crc32c_t *s = (hash_crc32c_t *)state;
+#if defined(crc32c_hw_word)
+    if (hash_cpu() & HASH_CPU_CRC32)
+    {
+        s->crc = crc32c_hw(s->crc, p, len);
+        return;
+    }
+#endif
+    s->crc = crc32c_sw(s->crc, p, len);
 }
 
-int32_t fossil_io_filesys_file_format(const char *path, char *format_out, size_t max_len)
+static void hash_crc32c_final(void *state, unsigned char *out)
 {
-    if (!path || !format_out || max_len == 0)
-        return -1;
+    hash_put_be(out, ~((hash_crc32c_t *)state)->crc, 4);
+}
 
-    FILE *f = fopen(path, "rb");
-    if (!f)
-        return -1;
+/* -- sha256 -- */
 
-    unsigned char magic[16];
-    size_t n = fread(magic, 1, sizeof(magic), f);
-    fclose(f);
+typedef struct
+{
+    uint32_t h[8];
+    uint64_t total;
+    unsigned char block[64];
+    size_t block_len;
+} hash_sha256_t;
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t rotr32(uint32_t x, unsigned int r)
+{
+    return (x >> r) | (x << (32 - r));
+}
 
-    if (n == 0)
+static void sha256_blocks_sw(uint32_t h[8], const unsigned char *p, size_t blocks)
+{
+    uint32_t w[64];
+    while (blocks--)
     {
-        strncpy(format_out, "empty", max_len - 1);
-        format_out[max_len - 1] = '\0';
-        return 0;
-    }
+        for (int i = 0; i < 16; ++i)
+            w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+        for (int i = 16; i < 64; ++i)
+        {
+            uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
 
-    /* Check magic bytes */
-    if (n >= 4 && magic[0] == 0x50 && magic[1] == 0x4B && magic[2] == 0x03 && magic[3] == 0x04)
-    {
-        strncpy(format_out, "zip", max_len - 1);
-    }
-    else if (n >= 4 && magic[0] == 0x50 && magic[1] == 0x4B && magic[2] == 0x05 && magic[3] == 0x06)
-    {
-        strncpy(format_out, "zip", max_len - 1);
-    }
-    else if (n >= 4 && magic[0] == 0x50 && magic[1] == 0x4B && magic[2] == 0x07 && magic[3] == 0x08)
-    {
-        strncpy(format_out, "zip", max_len - 1);
-    }
-    else if (n >= 3 && magic[0] == 0x1F && magic[1] == 0x8B && magic[2] == 0x08)
-    {
-        strncpy(format_out, "gzip", max_len - 1);
-    }
-    else if (n >= 6 && magic[0] == 0x37 && magic[1] == 0x7A && magic[2] == 0x58 && magic[3] == 0x5A && magic[4] == 0x00)
-    {
-        strncpy(format_out, "xz", max_len - 1);
-    }
-    else if (n >= 2 && magic[0] == 0x42 && magic[1] == 0x5A)
-    {
-        strncpy(format_out, "bzip2", max_len - 1);
-    }
-    else if (n >= 4 && magic[0] == 0x89 && magic[1] == 0x50 && magic[2] == 0x4E && magic[3] == 0x47)
-    {
-        strncpy(format_out, "png", max_len - 1);
-    }
-    else if (n >= 3 && magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF)
-    {
-        strncpy(format_out, "jpeg", max_len - 1);
-    }
-    else if (n >= 4 && magic[0] == 0x47 && magic[1] == 0x49 && magic[2] == 0x46)
-    {
-        strncpy(format_out, "gif", max_len - 1);
-    }
-    else if (n >= 4 && magic[0] == 0x25 && magic[1] == 0x50 && magic[2] == 0x44 && magic[3] == 0x46)
-    {
-        strncpy(format_out, "pdf", max_len - 1);
-    }
-    else if (n >= 4 && magic[0] == 0x7F && magic[1] == 0x45 && magic[2] == 0x4C && magic[3] == 0x46)
-    {
-        strncpy(format_out, "elf", max_len - 1);
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; ++i)
+        {
+            uint32_t t1 = hh + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+            uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += hh;
+        p += 64;
     }
-    else if (n >= 2 && magic[0] == 0x4D && magic[1] == 0x5A)
+}
+
+#if defined(FOSSIL_HASH_X86)
+/*
+ * SHA-NI: each sha256rnds2 performs two rounds on state held as ABEF/CDGH,
+ * and msg1/msg2 extend the schedule four words at a time.
+ */
+FOSSIL_TARGET("sha,sse4.1,ssse3")
+static void sha256_blocks_ni(uint32_t h[8], const unsigned char *p, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+    __m128i tmp = _mm_loadu_si128((const __m128i *)&h[0]);
+    __m128i state1 = _mm_loadu_si128((const __m128i *)&h[4]);
+
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);          /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1B);    /* EFGH */
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0); /* CDGH */
+
+    while (blocks--)
     {
-        strncpy(format_out, "pe", max_len - 1);
+        __m128i abef = state0, cdgh = state1;
+        __m128i w[4];
+
+        for (int i = 0; i < 16; ++i)
+        {
+            if (i < 4)
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 16 * i)), mask);
+
+            __m128i msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&sha256_k[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (i >= 3 && i <= 14)
+            {
+                __m128i t = _mm_alignr_epi8(w[i & 3], w[(i - 1) & 3], 4);
+                w[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(i + 1) & 3], t), w[i & 3]);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (i >= 1 && i <= 12)
+                w[(i - 1) & 3] = _mm_sha256msg1_epu32(w[(i - 1) & 3], w[i & 3]);
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+        p += 64;
     }
-    else if (n >= 2 && magic[0] == 0xFF && magic[1] == 0xFE)
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);       /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xB1);    /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);    /* ABEF */
+    _mm_storeu_si128((__m128i *)&h[0], state0);
+    _mm_storeu_si128((__m128i *)&h[4], state1);
+}
+#endif
+
+static void sha256_blocks(uint32_t h[8], const unsigned char *p, size_t blocks)
+{
+#if defined(FOSSIL_HASH_X86)
+    if (hash_cpu() & HASH_CPU_SHA)
     {
-        strncpy(format_out, "utf16le", max_len - 1);
+        sha256_blocks_ni(h, p, blocks);
+        return;
     }
-    else if (n >= 2 && magic[0] == 0xFE && magic[1] == 0xFF)
+#endif
+    sha256_blocks_sw(h, p, blocks);
+}
+
+static void hash_sha256_init(void *state)
+{
+    static const uint32_t iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    hash_sha256_t *s = (hash_sha256_t *)state;
+    memcpy(s->h, iv, sizeof(iv));
+    s->total = 0;
+    s->block_len = 0;
+}
+
+static void hash_sha256_update(void *state, const unsigned char *p, size_t len)
+{
+    hash_sha256_t *s = (hash_sha256_t *)state;
+    s->total += len;
+
+    if (s->block_len)
     {
-        strncpy(format_out, "utf16be", max_len - 1);
+        size_t fill = 64 - s->block_len;
+        if (len < fill)
+        {
+            memcpy(s->block + s->block_len, p, len);
+            s->block_len += len;
+            return;
+        }
+        memcpy(s->block + s->block_len, p, fill);
+        sha256_blocks(s->h, s->block, 1);
+        p += fill;
+        len -= fill;
+        s->block_len = 0;
     }
-    else if (n >= 3 && magic[0] == 0xEF && magic[1] == 0xBB && magic[2] == 0xBF)
+    if (len >= 64)
     {
-        strncpy(format_out, "utf8", max_len - 1);
+        sha256_blocks(s->h, p, len / 64);
+        p += len & ~(size_t)63;
+        len &= 63;
     }
-    else if (n >= 4 && magic[0] == 0xCA && magic[1] == 0xFE && magic[2] == 0xBA && magic[3] == 0xBE)
+    memcpy(s->block, p, len);
+    s->block_len = len;
+}
+
+static void hash_sha256_final(void *state, unsigned char *out)
+{
+    hash_sha256_t *s = (hash_sha256_t *)state;
+    uint64_t bits = s->total * 8;
+
+    s->block[s->block_len++] = 0x80;
+    if (s->block_len > 56)
     {
-        strncpy(format_out, "class", max_len - 1);
+        memset(s->block + s->block_len, 0, 64 - s->block_len);
+        sha256_blocks(s->h, s->block, 1);
+        s->block_len = 0;
     }
-    else
+    memset(s->block + s->block_len, 0, 56 - s->block_len);
+    hash_put_be(s->block + 56, bits, 8);
+    sha256_blocks(s->h, s->block, 1);
+
+    for (int i = 0; i < 8; ++i)
+        hash_put_be(out + 4 * i, s->h[i], 4);
+}
+
+/* -- registry -- */
+
+typedef union
+{
+    hash_fnv_t fnv;
+    hash_xxh64_t xxh64;
+    hash_crc32c_t crc32c;
+    hash_sha256_t sha256;
+} hash_state_t;
+
+typedef struct
+{
+    const char *name;
+    size_t digest_size;
+    void (*init)(void *state);
+    void (*update)(void *state, const unsigned char *p, size_t len);
+    void (*final)(void *state, unsigned char *out);
+} hash_algo_t;
+
+static const hash_algo_t hash_algos[] = {
+    {"fnv1a", 8, hash_fnv_init, hash_fnv_update, hash_fnv_final},
+    {"xxh64", 8, hash_xxh64_init, hash_xxh64_update, hash_xxh64_final},
+    {"crc32c", 4, hash_crc32c_init, hash_crc32c_update, hash_crc32c_final},
+    {"sha256", 32, hash_sha256_init, hash_sha256_update, hash_sha256_final},
+};
+
+static const hash_algo_t *hash_find(const char *name)
+{
+    if (!name)
+        return NULL;
+    for (size_t i = 0; i < sizeof(hash_algos) / sizeof(hash_algos[0]); ++i)
+        if (strcmp(hash_algos[i].name, name) == 0)
+            return &hash_algos[i];
+    return NULL;
+}
+
+size_t fossil_io_filesys_hash_digest_size(const char *algorithm)
+{
+    const hash_algo_t *algo = hash_find(algorithm);
+    return algo ? algo->digest_size : 0;
+}
+
+int32_t fossil_io_filesys_hash_buffer(const char *algorithm, const void *data, size_t len, unsigned char *hash_out, size_t hash_size)
+{
+    const hash_algo_t *algo = hash_find(algorithm);
+    if (!algo || !hash_out || hash_size < algo->digest_size || (!data && len > 0))
+        return -1;
+
+    hash_state_t state;
+    algo->init(&state);
+    algo->update(&state, (const unsigned char *)data, len);
+    algo->final(&state, hash_out);
+    return 0;
+}
+
+/*
+ * Feed [offset, offset + len) of an open file to a hash, through mapped
+ * windows where possible and a large read buffer otherwise.
+ */
+static int hash_native_range(fossil_native_t h, uint64_t offset, uint64_t len, const hash_algo_t *algo, void *state)
+{
+    size_t gran = fossil_map_granularity();
+    uint64_t end = offset + len;
+    unsigned char *buf = NULL;
+    int rc = 0;
+
+#if defined(_WIN32)
+    HANDLE mapping = (len > 0) ? CreateFileMappingA(h, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+#endif
+
+    for (uint64_t pos = offset; rc == 0 && pos < end;)
     {
-        /* Fallback to extension */
-        const char *dot = strrchr(path, '.');
-        if (dot && *(dot + 1) != '\0')
+        uint64_t aligned = pos - (pos % gran);
+        size_t delta = (size_t)(pos - aligned);
+        size_t want = (end - pos < FOSSIL_HASH_WINDOW) ? (size_t)(end - pos) : FOSSIL_HASH_WINDOW;
+
+#if defined(_WIN32)
+        void *base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(aligned >> 32),
+                                             (DWORD)(aligned & 0xFFFFFFFFu), want + delta)
+                             : NULL;
+        if (base)
         {
-            strncpy(format_out, dot + 1, max_len - 1);
+            algo->update(state, (const unsigned char *)base + delta, want);
+            UnmapViewOfFile(base);
+            pos += want;
+            continue;
         }
-        else
+#else
+        void *base = mmap(NULL, want + delta, PROT_READ, MAP_SHARED, h, (off_t)aligned);
+        if (base != MAP_FAILED)
         {
-            strncpy(format_out, "unknown", max_len - 1);
+            posix_madvise(base, want + delta, POSIX_MADV_SEQUENTIAL);
+            algo->update(state, (const unsigned char *)base + delta, want);
+            munmap(base, want + delta);
+            pos += want;
+            continue;
+        }
+#endif
+
+        if (!buf && !(buf = malloc(FOSSIL_COPY_BUFFER_SIZE)))
+        {
+            rc = -1;
+            break;
+        }
+        size_t chunk = (want < FOSSIL_COPY_BUFFER_SIZE) ? want : FOSSIL_COPY_BUFFER_SIZE;
+        int64_t n = fossil_native_pread(h, buf, chunk, pos);
+        if (n <= 0)
+        {
+            rc = -1;
+            break;
         }
+        algo->update(state, buf, (size_t)n);
+        pos += (uint64_t)n;
     }
 
-    format_out[max_len - 1] = '\0';
-    return 0;
+#if defined(_WIN32)
+    if (mapping)
+        CloseHandle(mapping);
+#endif
+    free(buf);
+    return rc;
 }
 
-int32_t fossil_io_filesys_file_rewrite(const char *path, int (*transform)(void *buf, size_t *size, void *user_data), void *user_data)
+/* Tree mode: leaves are hashed on a worker pool, then their digests are hashed. */
+typedef struct
 {
-    if (!path || !transform)
-        return -1;
-
-    char tmp_path[PATH_MAX];
-    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.rewrite", path);
-
-    /* Read original file */
-    FILE *in = fopen(path, "rb");
-    if (!in)
-        return -1;
-
-    fseek(in, 0, SEEK_END);
-    size_t file_size = ftell(in);
-    fseek(in, 0, SEEK_SET);
+    fossil_native_t h;
+    const hash_algo_t *algo;
+    uint64_t size;
+    uint64_t leaf_size;
+    size_t leaves;
+    unsigned char *digests;
+    atomic_size_t cursor;
+    atomic_int failed;
+} hash_tree_job_t;
+
+static void hash_tree_worker(void *arg, size_t index)
+{
+    hash_tree_job_t *job = (hash_tree_job_t *)arg;
+    (void)index;
 
-    unsigned char *buffer = malloc(file_size);
-    if (!buffer)
+    for (;;)
     {
-        fclose(in);
-        return -1;
+        size_t i = atomic_fetch_add(&job->cursor, 1);
+        if (i >= job->leaves || atomic_load(&job->failed))
+            break;
+
+        uint64_t off = (uint64_t)i * job->leaf_size;
+        uint64_t len = (job->size - off < job->leaf_size) ? job->size - off : job->leaf_size;
+        hash_state_t state;
+        job->algo->init(&state);
+        if (hash_native_range(job->h, off, len, job->algo, &state) != 0)
+        {
+            atomic_store(&job->failed, 1);
+            break;
+        }
+        job->algo->final(&state, job->digests + i * job->algo->digest_size);
     }
+}
 
-    if (fread(buffer, 1, file_size, in) != file_size)
-    {
-        free(buffer);
-        fclose(in);
+int32_t fossil_io_filesys_file_hash_ex(
+    const char *path,
+    const char *algorithm,
+    unsigned char *hash_out,
+    size_t hash_size,
+    const fossil_io_filesys_hash_opts_t *opts)
+{
+    const hash_algo_t *algo = hash_find(algorithm);
+    if (!path || !algo || !hash_out || hash_size < algo->digest_size)
         return -1;
-    }
 
-    fclose(in);
+    fossil_native_t h = fossil_native_open(path, false);
+    if (h == FOSSIL_NATIVE_INVALID)
+        return -1;
 
-    /* Apply transformation */
-    size_t new_size = file_size;
-    int rc = transform(buffer, &new_size, user_data);
-    if (rc != 0)
+    int64_t size = fossil_native_size(h);
+    if (size < 0)
     {
-        free(buffer);
+        fossil_native_close(h);
         return -1;
     }
 
-    /* Write to temporary file */
-    FILE *out = fopen(tmp_path, "wb");
-    if (!out)
+    hash_state_t state;
+    int rc = 0;
+
+    if (!(opts && opts->tree))
     {
-        free(buffer);
-        return -1;
+        algo->init(&state);
+        rc = hash_native_range(h, 0, (uint64_t)size, algo, &state);
+        if (rc == 0)
+            algo->final(&state, hash_out);
+        fossil_native_close(h);
+        return rc;
     }
 
-    if (fwrite(buffer, 1, new_size, out) != new_size)
+    hash_tree_job_t job;
+    job.h = h;
+    job.algo = algo;
+    job.size = (uint64_t)size;
+    job.leaf_size = opts->leaf_size ? opts->leaf_size : FOSSIL_HASH_LEAF;
+    job.leaves = (size_t)((job.size + job.leaf_size - 1) / job.leaf_size);
+    if (job.leaves == 0)
+        job.leaves = 1; /* an empty file is one empty leaf */
+    job.digests = malloc(job.leaves * algo->digest_size);
+    atomic_init(&job.cursor, 0);
+    atomic_init(&job.failed, 0);
+    if (!job.digests)
     {
-        fclose(out);
-        free(buffer);
-        remove(tmp_path);
+        fossil_native_close(h);
         return -1;
     }
 
-    fclose(out);
-    free(buffer);
+    size_t threads = opts->threads ? opts->threads : fossil_cpu_count();
+    fossil_run_workers(threads > job.leaves ? job.leaves : threads, hash_tree_worker, &job);
+    fossil_native_close(h);
 
-    /* Atomic swap */
-    if (fossil_io_filesys_move(tmp_path, path) != 0)
+    if (atomic_load(&job.failed))
+        rc = -1;
+    else
     {
-        remove(tmp_path);
-        return -1;
+        /* root = H(leaf digests || file size as 8 little-endian bytes) */
+        unsigned char tail[8];
+        for (int i = 0; i < 8; ++i)
+            tail[i] = (unsigned char)(job.size >> (8 * i));
+        algo->init(&state);
+        algo->update(&state, job.digests, job.leaves * algo->digest_size);
+        algo->update(&state, tail, sizeof(tail));
+        algo->final(&state, hash_out);
     }
 
-    return 0;
+    free(job.digests);
+    return rc;
 }
 
-/* File Operations */
+/* Fast 64-bit content hash for internal comparisons (dedup, mirror); 0 on error. */
+static uint64_t fossil_hash_file(const char *path)
+{
+    unsigned char digest[8];
+    if (fossil_io_filesys_file_hash_ex(path, "xxh64", digest, sizeof(digest), NULL) != 0)
+        return 0;
+    uint64_t h = 0;
+    for (int i = 0; i < 8; ++i)
+        h = (h << 8) | digest[i];
+    return h;
+}
 
-// feature from file stream preservide for filesys
-typedef struct
+/* ------------------------------------------------------------
+ * Metadata Cache
+ * ------------------------------------------------------------ */
+
+/*
+ * Opt-in cache of exists / dir_exists / file_is_readable / file_size answers,
+ * keyed by the lexically normalized path. Entries are spread over
+ * FOSSIL_CACHE_SHARDS independently locked shards; each is a chained hash
+ * table over a fixed pool with its own LRU list, so the capacity bound is
+ * enforced per shard without a global lock. Entries expire after the TTL.
+ *
+ * With a change watcher, the parent directory of each absolute path that
+ * misses is watched before it is probed, and lookups drain the watcher's
+ * events into invalidations. A probe that overlaps any invalidation is not
+ * stored (the epoch check), so a change is never masked by an older answer.
+ * Errors other than "not found" are never cached.
+ */
+
+#define FOSSIL_CACHE_SHARDS 16
+#define FOSSIL_CACHE_DEFAULT_TTL_MS 1000
+#define FOSSIL_CACHE_DEFAULT_CAPACITY 4096
+#define FOSSIL_CACHE_NONE UINT32_MAX
+
+enum
 {
-    const char *keyword;
-    const char *mode;
-} fossil_io_file_mode_entry_t;
+    CACHE_EXISTS,
+    CACHE_DIR,
+    CACHE_READABLE,
+    CACHE_SIZE,
+    CACHE_FIELDS
+};
 
-static const fossil_io_file_mode_entry_t fossil_io_file_mode_table[] = {
-    // Classic C modes (standard fopen strings)
-    {"r", "r"},
-    {"rb", "rb"},
-    {"w", "w"},
-    {"wb", "wb"},
-    {"a", "a"},
-    {"ab", "ab"},
-    {"r+", "r+"},
-    {"rb+", "r+b"},
-    {"r+b", "r+b"},
-    {"w+", "w+"},
-    {"wb+", "w+b"},
-    {"w+b", "w+b"},
-    {"a+", "a+"},
-    {"ab+", "a+b"},
-    {"a+b", "a+b"},
-
-    // Extended readable modes
-    {"read", "r"},
-    {"readb", "rb"},
-    {"write", "w"},
-    {"writeb", "wb"},
-    {"append", "a"},
-    {"appendb", "ab"},
-    {"read+write", "r+"},
-    {"read+writeb", "r+b"},
-    {"write+read", "w+"},
-    {"write+readb", "w+b"},
-    {"append+read", "a+"},
-    {"append+readb", "a+b"},
-    {"read+t", "rt"},
-    {"write+t", "wt"},
-    {"read+write+t", "r+t"},
+typedef struct
+{
+    char *key;
+    uint64_t hash;
+    uint64_t expires;
+    uint32_t known; /* bit per field */
+    int64_t value[CACHE_FIELDS];
+    uint32_t chain; /* next in bucket, or in the free list */
+    uint32_t prev;  /* LRU neighbours, most recent at head */
+    uint32_t next;
+} cache_entry_t;
 
-    {NULL, NULL}};
+#if defined(_WIN32)
+typedef SRWLOCK cache_mutex_t;
+typedef SRWLOCK cache_rwlock_t;
+#define CACHE_RWLOCK_INIT SRWLOCK_INIT
+#define cache_mutex_setup(l) InitializeSRWLock(l)
+#define cache_lock(l) AcquireSRWLockExclusive(l)
+#define cache_unlock(l) ReleaseSRWLockExclusive(l)
+#define cache_trylock(l) (TryAcquireSRWLockExclusive(l) != 0)
+#define cache_read_lock(l) AcquireSRWLockShared(l)
+#define cache_read_unlock(l) ReleaseSRWLockShared(l)
+#define cache_write_lock(l) AcquireSRWLockExclusive(l)
+#define cache_write_unlock(l) ReleaseSRWLockExclusive(l)
+#else
+typedef pthread_mutex_t cache_mutex_t;
+typedef pthread_rwlock_t cache_rwlock_t;
+#define CACHE_RWLOCK_INIT PTHREAD_RWLOCK_INITIALIZER
+#define cache_mutex_setup(l) pthread_mutex_init((l), NULL)
+#define cache_lock(l) pthread_mutex_lock(l)
+#define cache_unlock(l) pthread_mutex_unlock(l)
+#define cache_trylock(l) (pthread_mutex_trylock(l) == 0)
+#define cache_read_lock(l) pthread_rwlock_rdlock(l)
+#define cache_read_unlock(l) pthread_rwlock_unlock(l)
+#define cache_write_lock(l) pthread_rwlock_wrlock(l)
+#define cache_write_unlock(l) pthread_rwlock_unlock(l)
+#endif
 
-int32_t fossil_io_filesys_file_open(
-    fossil_io_filesys_file_t *f,
-    const char *path,
-    const char *mode)
+typedef struct
 {
-    if (!f || !path || !mode)
-        return -1;
-
-    memset(f, 0, sizeof(*f));
+    cache_mutex_t lock;
+    cache_entry_t *pool; /* NULL while the cache is off */
+    uint32_t *buckets;
+    uint32_t bucket_mask;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t free_list;
+    uint32_t head;
+    uint32_t tail;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+} cache_shard_t;
+
+static struct
+{
+    atomic_int enabled;
+    atomic_int watching;
+    atomic_uint ttl_ms;
+    atomic_uint epoch; /* bumped before every watcher-driven invalidation */
+    bool ready;        /* shard locks initialised */
+    cache_shard_t shards[FOSSIL_CACHE_SHARDS];
+    cache_mutex_t drain; /* one lookup at a time drains the watcher */
+    fossil_io_filesys_watch_t *watch;
+} fossil_cache;
+
+/* Held shared while the watcher is used, exclusively to reconfigure. */
+static cache_rwlock_t fossil_cache_config = CACHE_RWLOCK_INIT;
+
+static bool watch_has_events(const fossil_io_filesys_watch_t *w);
+
+static uint64_t fossil_now_ms(void)
+{
+#if defined(_WIN32)
+    return (uint64_t)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+#endif
+}
 
-    /* Translate mode keyword to standard fopen mode */
-    const char *actual_mode = mode;
-    for (size_t i = 0; fossil_io_file_mode_table[i].keyword != NULL; ++i)
+/*
+ * Lexical key for a path: separators unified and collapsed, "." components
+ * dropped. ".." is kept, since resolving it would mean following links.
+ */
+static bool cache_key(const char *path, char out[FOSSIL_FILESYS_MAX_PATH], size_t *len_out)
+{
+    size_t n = 0;
+    for (const char *s = path; *s;)
     {
-        if (strcmp(fossil_io_file_mode_table[i].keyword, mode) == 0)
+        char c = *s;
+#if defined(_WIN32)
+        if (c == '\\')
+            c = '/';
+#endif
+        bool at_start = (n == 0 || out[n - 1] == '/');
+        if (c == '/' && n > 0 && out[n - 1] == '/')
         {
-            actual_mode = fossil_io_file_mode_table[i].mode;
-            break;
+            ++s;
+            continue;
+        }
+        if (c == '.' && at_start && (s[1] == '/' || s[1] == PATH_SEP))
+        {
+            for (++s; *s == '/' || *s == PATH_SEP; ++s)
+                ;
+            continue;
         }
+        if (n + 1 >= FOSSIL_FILESYS_MAX_PATH)
+            return false;
+        out[n++] = c;
+        ++s;
     }
+    if (n == 0)
+        return false;
+    out[n] = '\0';
+    *len_out = n;
+    return true;
+}
 
-    /* init base object */
-    if (fossil_io_filesys_init(&f->base, path) != 0)
-        return -1;
+static bool cache_missing_error(void)
+{
+#if defined(_WIN32)
+    DWORD err = GetLastError();
+    return err == ERROR_FILE_NOT_FOUND || err == ERROR_PATH_NOT_FOUND;
+#else
+    return errno == ENOENT || errno == ENOTDIR;
+#endif
+}
 
-    fossil_mutex_lock(&f->base.lock);
+static cache_shard_t *cache_shard(uint64_t hash)
+{
+    return &fossil_cache.shards[hash >> 60];
+}
 
-    FILE *fp = fopen(path, actual_mode);
-    if (!fp)
+static uint32_t cache_find(const cache_shard_t *sh, const char *key, uint64_t hash)
+{
+    for (uint32_t i = sh->buckets[hash & sh->bucket_mask]; i != FOSSIL_CACHE_NONE; i = sh->pool[i].chain)
     {
-        fossil_mutex_unlock(&f->base.lock);
-        return -1;
+        if (sh->pool[i].hash == hash && strcmp(sh->pool[i].key, key) == 0)
+            return i;
     }
-
-    f->handle = fp;
-    f->fd = fileno(fp);
-    f->is_open = true;
-    f->append_mode = (strchr(actual_mode, 'a') != NULL);
-    f->position = 0;
-
-    fossil_mutex_unlock(&f->base.lock);
-    return 0;
+    return FOSSIL_CACHE_NONE;
 }
 
-int32_t fossil_io_filesys_file_close(fossil_io_filesys_file_t *f)
+static void cache_lru_unlink(cache_shard_t *sh, uint32_t i)
 {
-    if (!f || !f->is_open)
-        return -1;
-
-    fossil_mutex_lock(&f->base.lock);
-
-    FILE *fp = (FILE *)f->handle;
-    int rc = fclose(fp);
-
-    f->handle = NULL;
-    f->is_open = false;
+    cache_entry_t *e = &sh->pool[i];
+    if (e->prev != FOSSIL_CACHE_NONE)
+        sh->pool[e->prev].next = e->next;
+    else
+        sh->head = e->next;
+    if (e->next != FOSSIL_CACHE_NONE)
+        sh->pool[e->next].prev = e->prev;
+    else
+        sh->tail = e->prev;
+}
 
-    fossil_mutex_unlock(&f->base.lock);
-    return (rc == 0) ? 0 : -1;
+static void cache_lru_push(cache_shard_t *sh, uint32_t i)
+{
+    cache_entry_t *e = &sh->pool[i];
+    e->prev = FOSSIL_CACHE_NONE;
+    e->next = sh->head;
+    if (sh->head != FOSSIL_CACHE_NONE)
+        sh->pool[sh->head].prev = i;
+    else
+        sh->tail = i;
+    sh->head = i;
 }
 
-size_t fossil_io_filesys_file_read(
-    fossil_io_filesys_file_t *f,
-    void *buf,
-    size_t size,
-    size_t count)
+static void cache_drop(cache_shard_t *sh, uint32_t i)
 {
-    if (!f || !f->is_open || !buf)
-        return 0;
+    cache_entry_t *e = &sh->pool[i];
+    uint32_t *link = &sh->buckets[e->hash & sh->bucket_mask];
+    while (*link != i)
+        link = &sh->pool[*link].chain;
+    *link = e->chain;
+
+    cache_lru_unlink(sh, i);
+    free(e->key);
+    e->key = NULL;
+    e->chain = sh->free_list;
+    sh->free_list = i;
+    --sh->count;
+}
 
-    fossil_mutex_lock(&f->base.lock);
+/* Free a shard's table; caller holds its lock. */
+static void cache_shard_release(cache_shard_t *sh)
+{
+    if (sh->pool)
+    {
+        for (uint32_t i = 0; i < sh->capacity; ++i)
+            free(sh->pool[i].key);
+    }
+    free(sh->pool);
+    free(sh->buckets);
+    sh->pool = NULL;
+    sh->buckets = NULL;
+    sh->count = 0;
+}
 
-    FILE *fp = (FILE *)f->handle;
-    size_t n = fread(buf, size, count, fp);
+static int cache_shard_setup(cache_shard_t *sh, uint32_t capacity)
+{
+    uint32_t buckets = 16;
+    while (buckets < capacity)
+        buckets <<= 1;
 
-    f->position = ftell(fp);
+    sh->pool = calloc(capacity, sizeof(*sh->pool));
+    sh->buckets = malloc(buckets * sizeof(*sh->buckets));
+    if (!sh->pool || !sh->buckets)
+    {
+        cache_shard_release(sh);
+        return -1;
+    }
 
-    fossil_mutex_unlock(&f->base.lock);
-    return n;
+    memset(sh->buckets, 0xff, buckets * sizeof(*sh->buckets));
+    for (uint32_t i = 0; i < capacity; ++i)
+        sh->pool[i].chain = (i + 1 < capacity) ? i + 1 : FOSSIL_CACHE_NONE;
+    sh->bucket_mask = buckets - 1;
+    sh->capacity = capacity;
+    sh->count = 0;
+    sh->free_list = 0;
+    sh->head = FOSSIL_CACHE_NONE;
+    sh->tail = FOSSIL_CACHE_NONE;
+    sh->hits = sh->misses = sh->evictions = sh->invalidations = 0;
+    return 0;
 }
 
-size_t fossil_io_filesys_file_write(
-    fossil_io_filesys_file_t *f,
-    const void *buf,
-    size_t size,
-    size_t count)
+/* Drop key, and with tree also everything below it; returns entries dropped. */
+static size_t cache_forget_key(const char *key, size_t len, bool tree)
 {
-    if (!f || !f->is_open || !buf)
-        return 0;
-
-    fossil_mutex_lock(&f->base.lock);
+    size_t dropped = 0;
 
-    FILE *fp = (FILE *)f->handle;
-
-    if (f->append_mode)
-        fseek(fp, 0, SEEK_END);
+    if (!tree)
+    {
+        uint64_t hash = fossil_hash64_buffer(key, len);
+        cache_shard_t *sh = cache_shard(hash);
+        cache_lock(&sh->lock);
+        uint32_t i = sh->pool ? cache_find(sh, key, hash) : FOSSIL_CACHE_NONE;
+        if (i != FOSSIL_CACHE_NONE)
+        {
+            cache_drop(sh, i);
+            ++sh->invalidations;
+            dropped = 1;
+        }
+        cache_unlock(&sh->lock);
+        return dropped;
+    }
 
-    size_t n = fwrite(buf, size, count, fp);
+    for (size_t s = 0; s < FOSSIL_CACHE_SHARDS; ++s)
+    {
+        cache_shard_t *sh = &fossil_cache.shards[s];
+        cache_lock(&sh->lock);
+        for (uint32_t i = sh->pool ? sh->head : FOSSIL_CACHE_NONE; i != FOSSIL_CACHE_NONE;)
+        {
+            uint32_t next = sh->pool[i].next;
+            const char *k = sh->pool[i].key;
+            if (!key || (strncmp(k, key, len) == 0 && (k[len] == '\0' || k[len] == '/' || key[len - 1] == '/')))
+            {
+                cache_drop(sh, i);
+                ++sh->invalidations;
+                ++dropped;
+            }
+            i = next;
+        }
+        cache_unlock(&sh->lock);
+    }
+    return dropped;
+}
 
-    f->position = ftell(fp);
+/* Invalidate after a change made through this library (no-op when off). */
+static void fossil_cache_forget(const char *path, bool tree)
+{
+    char key[FOSSIL_FILESYS_MAX_PATH];
+    size_t len;
 
-    fossil_mutex_unlock(&f->base.lock);
-    return n;
+    if (!atomic_load_explicit(&fossil_cache.enabled, memory_order_acquire))
+        return;
+    atomic_fetch_add(&fossil_cache.epoch, 1);
+    if (!path)
+        cache_forget_key(NULL, 0, true);
+    else if (cache_key(path, key, &len))
+        cache_forget_key(key, len, tree);
 }
 
-int32_t fossil_io_filesys_file_seek(
-    fossil_io_filesys_file_t *f,
-    int64_t offset,
-    int32_t origin)
+/* Turn any waiting watcher events into invalidations. */
+static void cache_pump(void)
 {
-    if (!f || !f->is_open)
-        return -1;
-
-    fossil_mutex_lock(&f->base.lock);
+    if (!atomic_load_explicit(&fossil_cache.watching, memory_order_relaxed))
+        return;
 
-    FILE *fp = (FILE *)f->handle;
+    cache_read_lock(&fossil_cache_config);
+    fossil_io_filesys_watch_t *w = fossil_cache.watch;
+    if (w && watch_has_events(w) && cache_trylock(&fossil_cache.drain))
+    {
+        fossil_io_filesys_watch_event_t events[16];
+        int32_t n;
+        while ((n = fossil_io_filesys_watch_read(w, events, 16)) > 0)
+        {
+            atomic_fetch_add(&fossil_cache.epoch, 1);
+            for (int32_t i = 0; i < n; ++i)
+            {
+                char key[FOSSIL_FILESYS_MAX_PATH];
+                size_t len;
+                if (events[i].mask & FOSSIL_FILESYS_WATCH_OVERFLOW)
+                    cache_forget_key(NULL, 0, true);
+                else if (cache_key(events[i].path, key, &len))
+                    cache_forget_key(key, len, (events[i].mask & FOSSIL_FILESYS_WATCH_IS_DIR) != 0);
+            }
+        }
+        cache_unlock(&fossil_cache.drain);
+    }
+    cache_read_unlock(&fossil_cache_config);
+}
 
+/* Watch the directory holding an absolute key so changes to it are seen. */
+static void cache_watch_parent(const char *key, size_t len)
+{
+    bool absolute = (key[0] == '/');
 #if defined(_WIN32)
-    int rc = _fseeki64(fp, offset, origin);
-#else
-    int rc = fseeko(fp, offset, origin);
+    absolute = absolute || (len > 2 && key[1] == ':' && key[2] == '/');
 #endif
-
-    if (rc == 0)
-        f->position = ftell(fp);
-
-    fossil_mutex_unlock(&f->base.lock);
-    return (rc == 0) ? 0 : -1;
+    if (!absolute || !atomic_load_explicit(&fossil_cache.watching, memory_order_relaxed))
+        return;
+
+    char parent[FOSSIL_FILESYS_MAX_PATH];
+    size_t cut = len;
+    while (cut > 1 && key[cut - 1] == '/')
+        --cut;
+    while (cut > 0 && key[cut - 1] != '/')
+        --cut;
+    if (cut == 0)
+        return;
+    if (cut > 1 && !(cut == 3 && key[1] == ':'))
+        --cut; /* keep the separator only for a root */
+    memcpy(parent, key, cut);
+    parent[cut] = '\0';
+
+    cache_read_lock(&fossil_cache_config);
+    if (fossil_cache.watch)
+        fossil_io_filesys_watch_add(fossil_cache.watch, parent, false);
+    cache_read_unlock(&fossil_cache_config);
 }
 
-int64_t fossil_io_filesys_file_tell(fossil_io_filesys_file_t *f)
+/*
+ * Answer one query field for path from the cache, probing and storing it on
+ * a miss. With the cache off this is just the probe.
+ */
+static int64_t fossil_cache_query(const char *path, int field, int64_t (*probe)(const char *path))
 {
-    if (!f || !f->is_open)
-        return -1;
-
-    fossil_mutex_lock(&f->base.lock);
+    char key[FOSSIL_FILESYS_MAX_PATH];
+    size_t len;
 
-    FILE *fp = (FILE *)f->handle;
+    if (!atomic_load_explicit(&fossil_cache.enabled, memory_order_acquire) || !cache_key(path, key, &len))
+        return probe(path);
 
-#if defined(_WIN32)
-    int64_t pos = _ftelli64(fp);
-#else
-    int64_t pos = ftello(fp);
-#endif
+    cache_pump();
 
-    f->position = pos;
+    uint64_t hash = fossil_hash64_buffer(key, len);
+    cache_shard_t *sh = cache_shard(hash);
+    uint64_t now = fossil_now_ms();
 
-    fossil_mutex_unlock(&f->base.lock);
-    return pos;
+    cache_lock(&sh->lock);
+    if (!sh->pool)
+    {
+        cache_unlock(&sh->lock);
+        return probe(path);
+    }
+    uint32_t i = cache_find(sh, key, hash);
+    if (i != FOSSIL_CACHE_NONE && sh->pool[i].expires <= now)
+    {
+        cache_drop(sh, i);
+        i = FOSSIL_CACHE_NONE;
+    }
+    if (i != FOSSIL_CACHE_NONE && (sh->pool[i].known & (1u << field)))
+    {
+        int64_t value = sh->pool[i].value[field];
+        ++sh->hits;
+        cache_lru_unlink(sh, i);
+        cache_lru_push(sh, i);
+        cache_unlock(&sh->lock);
+        return value;
+    }
+    ++sh->misses;
+    cache_unlock(&sh->lock);
+
+    unsigned epoch = atomic_load(&fossil_cache.epoch);
+    cache_watch_parent(key, len);
+    int64_t value = probe(path);
+    if (value < 0 && !cache_missing_error())
+        return value;
+
+    char *copy = malloc(len + 1);
+    if (!copy)
+        return value;
+    memcpy(copy, key, len + 1);
+
+    cache_lock(&sh->lock);
+    if (sh->pool && atomic_load(&fossil_cache.epoch) == epoch)
+    {
+        i = cache_find(sh, key, hash);
+        if (i == FOSSIL_CACHE_NONE)
+        {
+            if (sh->free_list == FOSSIL_CACHE_NONE)
+            {
+                cache_drop(sh, sh->tail);
+                ++sh->evictions;
+            }
+            i = sh->free_list;
+            cache_entry_t *e = &sh->pool[i];
+            sh->free_list = e->chain;
+            e->key = copy;
+            copy = NULL;
+            e->hash = hash;
+            e->expires = now + atomic_load_explicit(&fossil_cache.ttl_ms, memory_order_relaxed);
+            e->known = 0;
+            uint32_t *bucket = &sh->buckets[hash & sh->bucket_mask];
+            e->chain = *bucket;
+            *bucket = i;
+            cache_lru_push(sh, i);
+            ++sh->count;
+        }
+        sh->pool[i].value[field] = value;
+        sh->pool[i].known |= 1u << field;
+    }
+    cache_unlock(&sh->lock);
+    free(copy);
+    return value;
 }
 
-int32_t fossil_io_filesys_file_flush(fossil_io_filesys_file_t *f)
+/* Tear down tables and watcher; caller holds fossil_cache_config exclusively. */
+static void cache_shutdown(void)
 {
-    if (!f || !f->is_open)
-        return -1;
-
-    fossil_mutex_lock(&f->base.lock);
+    atomic_store(&fossil_cache.enabled, 0);
+    atomic_store(&fossil_cache.watching, 0);
+    for (size_t s = 0; s < FOSSIL_CACHE_SHARDS; ++s)
+    {
+        cache_lock(&fossil_cache.shards[s].lock);
+        cache_shard_release(&fossil_cache.shards[s]);
+        cache_unlock(&fossil_cache.shards[s].lock);
+    }
+    fossil_io_filesys_watch_close(fossil_cache.watch);
+    fossil_cache.watch = NULL;
+}
 
-    FILE *fp = (FILE *)f->handle;
-    int rc = fflush(fp);
+int32_t fossil_io_filesys_cache_enable(const fossil_io_filesys_cache_opts_t *opts)
+{
+    size_t capacity = (opts && opts->capacity) ? opts->capacity : FOSSIL_CACHE_DEFAULT_CAPACITY;
+    uint32_t ttl = (opts && opts->ttl_ms) ? opts->ttl_ms : FOSSIL_CACHE_DEFAULT_TTL_MS;
+    size_t per_shard = (capacity + FOSSIL_CACHE_SHARDS - 1) / FOSSIL_CACHE_SHARDS;
+    if (per_shard > (1u << 24))
+        per_shard = 1u << 24;
+
+    cache_write_lock(&fossil_cache_config);
+    if (!fossil_cache.ready)
+    {
+        for (size_t s = 0; s < FOSSIL_CACHE_SHARDS; ++s)
+            cache_mutex_setup(&fossil_cache.shards[s].lock);
+        cache_mutex_setup(&fossil_cache.drain);
+        fossil_cache.ready = true;
+    }
+    cache_shutdown();
 
-#if defined(_WIN32)
-    _commit(_fileno(fp));
-#else
-    fsync(fileno(fp));
-#endif
+    int32_t rc = 0;
+    for (size_t s = 0; s < FOSSIL_CACHE_SHARDS && rc == 0; ++s)
+    {
+        cache_lock(&fossil_cache.shards[s].lock);
+        rc = cache_shard_setup(&fossil_cache.shards[s], (uint32_t)per_shard);
+        cache_unlock(&fossil_cache.shards[s].lock);
+    }
+    if (rc != 0)
+    {
+        cache_shutdown();
+        cache_write_unlock(&fossil_cache_config);
+        return -1;
+    }
 
-    fossil_mutex_unlock(&f->base.lock);
-    return (rc == 0) ? 0 : -1;
+    atomic_store(&fossil_cache.ttl_ms, ttl);
+    if (opts && opts->watch)
+    {
+        fossil_cache.watch = fossil_io_filesys_watch_open(NULL);
+        atomic_store(&fossil_cache.watching, fossil_cache.watch != NULL);
+    }
+    atomic_store_explicit(&fossil_cache.enabled, 1, memory_order_release);
+    cache_write_unlock(&fossil_cache_config);
+    return 0;
 }
 
-int32_t fossil_io_filesys_file_size(const char *path)
+void fossil_io_filesys_cache_disable(void)
 {
-    if (!path)
-        return -1;
+    cache_write_lock(&fossil_cache_config);
+    if (fossil_cache.ready)
+        cache_shutdown();
+    cache_write_unlock(&fossil_cache_config);
+}
 
-#if defined(_WIN32)
-    WIN32_FILE_ATTRIBUTE_DATA data;
-    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
-        return -1;
+int32_t fossil_io_filesys_cache_invalidate(const char *path)
+{
+    char key[FOSSIL_FILESYS_MAX_PATH];
+    size_t len = 0;
 
-    return (int32_t)(((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow);
-#else
-    struct stat st;
-    if (stat(path, &st) != 0)
+    if (!atomic_load_explicit(&fossil_cache.enabled, memory_order_acquire))
+        return 0;
+    if (path && !cache_key(path, key, &len))
         return -1;
-
-    return (int32_t)st.st_size;
-#endif
+    atomic_fetch_add(&fossil_cache.epoch, 1);
+    size_t dropped = cache_forget_key(path ? key : NULL, len, true);
+    return (dropped > INT32_MAX) ? INT32_MAX : (int32_t)dropped;
 }
 
-int32_t fossil_io_filesys_file_truncate(const char *path, size_t size)
+int32_t fossil_io_filesys_cache_stats(fossil_io_filesys_cache_stats_t *out)
 {
-    if (!path)
+    if (!out)
         return -1;
 
-#if defined(_WIN32)
-    HANDLE h = CreateFileA(path, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
-    if (h == INVALID_HANDLE_VALUE)
-        return -1;
-
-    LARGE_INTEGER li;
-    li.QuadPart = size;
-
-    if (!SetFilePointerEx(h, li, NULL, FILE_BEGIN) ||
-        !SetEndOfFile(h))
+    memset(out, 0, sizeof(*out));
+    cache_read_lock(&fossil_cache_config);
+    if (fossil_cache.ready)
     {
-        CloseHandle(h);
-        return -1;
+        for (size_t s = 0; s < FOSSIL_CACHE_SHARDS; ++s)
+        {
+            cache_shard_t *sh = &fossil_cache.shards[s];
+            cache_lock(&sh->lock);
+            out->hits += sh->hits;
+            out->misses += sh->misses;
+            out->evictions += sh->evictions;
+            out->invalidations += sh->invalidations;
+            out->entries += sh->count;
+            cache_unlock(&sh->lock);
+        }
     }
-
-    CloseHandle(h);
+    out->watching = atomic_load(&fossil_cache.watching) != 0;
+    cache_read_unlock(&fossil_cache_config);
     return 0;
-#else
-    return truncate(path, size);
-#endif
 }
 
-int32_t fossil_io_filesys_file_hash(
-    const char *path,
-    unsigned char *hash_out,
-    size_t hash_size,
-    const char *algorithm)
-{
-    if (!path || !hash_out || !algorithm)
-        return -1;
-
-    FILE *f = fopen(path, "rb");
-    if (!f)
-        return -1;
-
-    if (strcmp(algorithm, "fnv1a") == 0)
-    {
-        uint64_t h = hash_fnv1a(f);
+/* ------------------------------------------------------------
+ * General Filesystem Operations
+ * ------------------------------------------------------------ */
 
-        if (hash_size < sizeof(uint64_t))
-        {
-            fclose(f);
-            return -1;
-        }
+static void fossil_generate_id(const char *path, char *out, size_t len)
+{
+    /* simple stable hash (FNV-1a) */
+    uint32_t hash = 2166136261u;
 
-        memcpy(hash_out, &h, sizeof(uint64_t));
-    }
-    else
+    for (const char *p = path; *p; ++p)
     {
-        fclose(f);
-        return -1; /* unsupported */
+        hash ^= (unsigned char)(*p);
+        hash *= 16777619;
     }
 
-    fclose(f);
-    return 0;
+    snprintf(out, len, "%08x", hash);
 }
 
-int32_t fossil_io_filesys_file_merge(
-    const char *src1,
-    const char *src2,
-    const char *dest,
-    uint32_t strategy)
+int32_t fossil_io_filesys_init(fossil_io_filesys_obj_t *obj, const char *path)
 {
-    FILE *a = fopen(src1, "rb");
-    FILE *b = fopen(src2, "rb");
-    FILE *out = fopen(dest, "wb");
+    if (!obj || !path)
+        return -1;
 
-    if (!a || !b || !out)
+    memset(obj, 0, sizeof(*obj));
+
+    /* copy path safely */
+    strncpy(obj->path, path, FOSSIL_FILESYS_MAX_PATH - 1);
+    obj->path[FOSSIL_FILESYS_MAX_PATH - 1] = '\0';
+
+    /* init lock */
+    if (fossil_mutex_init(&obj->lock) != 0)
         return -1;
 
-    char buf1[4096], buf2[4096];
+    /* generate stable ID */
+    fossil_generate_id(path, obj->id, sizeof(obj->id));
 
-    if (strategy == FOSSIL_MERGE_CONCAT)
-    {
-        size_t n;
-        while ((n = fread(buf1, 1, sizeof(buf1), a)) > 0)
-            fwrite(buf1, 1, n, out);
+    /* initialize default values */
+    obj->type = FOSSIL_FILESYS_TYPE_UNKNOWN;
+    obj->size = 0;
+    obj->mode = 0;
+    obj->flags = 0;
+    obj->created_at = 0;
+    obj->modified_at = 0;
+    obj->accessed_at = 0;
 
-        while ((n = fread(buf2, 1, sizeof(buf2), b)) > 0)
-            fwrite(buf2, 1, n, out);
+    /* infer type from path hints */
+    size_t len = strlen(path);
+    if (len > 0 && (path[len - 1] == '/' || path[len - 1] == '\\'))
+    {
+        obj->type = FOSSIL_FILESYS_TYPE_DIR;
     }
-    else if (strategy == FOSSIL_MERGE_INTERLEAVE)
+    else if (len > 0)
     {
-        size_t n1, n2;
-        do
+        const char *dot = strrchr(path, '.');
+        if (dot)
         {
-            n1 = fread(buf1, 1, sizeof(buf1), a);
-            if (n1)
-                fwrite(buf1, 1, n1, out);
+            /* Enhanced link detection */
+            if (strcmp(dot, ".lnk") == 0 || strcmp(dot, ".link") == 0 ||
+                strcmp(dot, ".symlink") == 0)
+            {
+                obj->type = FOSSIL_FILESYS_TYPE_LINK;
+            }
+            /* Detect common archive types */
+            else if (strcmp(dot, ".zip") == 0 || strcmp(dot, ".tar") == 0 ||
+                     strcmp(dot, ".gz") == 0 || strcmp(dot, ".bz2") == 0 ||
+                     strcmp(dot, ".7z") == 0 || strcmp(dot, ".rar") == 0)
+            {
+                obj->type = FOSSIL_FILESYS_TYPE_ARCHIVE;
+            }
+            else
+            {
+                obj->type = FOSSIL_FILESYS_TYPE_FILE;
+            }
+        }
+        else
+        {
+            obj->type = FOSSIL_FILESYS_TYPE_FILE;
+        }
+    }
 
-            n2 = fread(buf2, 1, sizeof(buf2), b);
-            if (n2)
-                fwrite(buf2, 1, n2, out);
+    /* initial metadata load (don't fail if path doesn't exist) */
+    fossil_io_filesys_refresh(obj);
 
-        } while (n1 || n2);
-    }
+    /* If the path exists and is a directory, force type to DIR */
+    int32_t exists = fossil_io_filesys_dir_exists(obj->path);
+    if (exists == 1)
+        obj->type = FOSSIL_FILESYS_TYPE_DIR;
 
-    fclose(a);
-    fclose(b);
-    fclose(out);
     return 0;
 }
 
-int32_t fossil_io_filesys_file_split(
-    const char *path,
-    size_t part_size,
-    const char *prefix)
+static bool fossil_has_archive_ext(const char *path)
 {
-    if (!path || !prefix || part_size == 0)
-        return -1;
+    const char *dot = strrchr(path, '.');
+    return dot && (strcmp(dot, ".zip") == 0 || strcmp(dot, ".tar") == 0 ||
+                   strcmp(dot, ".gz") == 0 || strcmp(dot, ".bz2") == 0 ||
+                   strcmp(dot, ".7z") == 0 || strcmp(dot, ".rar") == 0);
+}
 
-    FILE *in = fopen(path, "rb");
-    if (!in)
+int32_t fossil_io_filesys_refresh(fossil_io_filesys_obj_t *obj)
+{
+    if (!obj || !obj->path[0])
         return -1;
 
-    unsigned char *buffer = malloc(part_size);
-    if (!buffer)
-    {
-        fclose(in);
-        return -1;
-    }
+    fossil_mutex_lock(&obj->lock);
 
-    size_t part = 0;
-    size_t read_bytes;
+#if defined(_WIN32)
 
-    while ((read_bytes = fread(buffer, 1, part_size, in)) > 0)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(obj->path, GetFileExInfoStandard, &data))
     {
-        char out_path[512];
-        snprintf(out_path, sizeof(out_path),
-                 "%s.part%03zu", prefix, part++);
-
-        FILE *out = fopen(out_path, "wb");
-        if (!out)
-        {
-            free(buffer);
-            fclose(in);
-            return -1;
-        }
-
-        fwrite(buffer, 1, read_bytes, out);
-        fclose(out);
-    }
-
-    free(buffer);
-    fclose(in);
-    return (int32_t)part;
-}
-
-int32_t fossil_io_filesys_file_join(
-    const char **parts,
-    size_t count,
-    const char *dest)
-{
-    if (!parts || count == 0 || !dest)
+        fossil_mutex_unlock(&obj->lock);
         return -1;
+    }
 
-    FILE *out = fopen(dest, "wb");
-    if (!out)
-        return -1;
+    obj->size =
+        ((size_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
 
-    unsigned char buffer[8192];
+    obj->created_at = data.ftCreationTime.dwLowDateTime;
+    obj->modified_at = data.ftLastWriteTime.dwLowDateTime;
+    obj->accessed_at = data.ftLastAccessTime.dwLowDateTime;
 
-    for (size_t i = 0; i < count; ++i)
+    if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        obj->type = FOSSIL_FILESYS_TYPE_DIR;
+    else
     {
-        FILE *in = fopen(parts[i], "rb");
-        if (!in)
+        /* Check if file is an archive based on extension */
+        if (fossil_has_archive_ext(obj->path))
         {
-            fclose(out);
-            return -1;
+            obj->type = FOSSIL_FILESYS_TYPE_ARCHIVE;
         }
-
-        size_t n;
-        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        else
         {
-            fwrite(buffer, 1, n, out);
+            obj->type = FOSSIL_FILESYS_TYPE_FILE;
         }
-
-        fclose(in);
     }
 
-    fclose(out);
-    return 0;
-}
-
-int32_t fossil_io_filesys_file_compress(
-    const char *src,
-    const char *dest,
-    const char *algorithm)
-{
-    if (!src || !dest)
-        return -1;
-
-    FILE *in = fopen(src, "rb");
-    FILE *out = fopen(dest, "wb");
-
-    if (!in || !out)
-    {
-        if (in)
-            fclose(in);
-        if (out)
-            fclose(out);
-        return -1;
-    }
+#else
 
-    /* Only RLE for now */
-    if (algorithm && strcmp(algorithm, "rle") != 0)
+    struct stat st;
+    if (lstat(obj->path, &st) != 0)
     {
-        fclose(in);
-        fclose(out);
+        fossil_mutex_unlock(&obj->lock);
         return -1;
     }
 
-    int prev = fgetc(in);
-    if (prev == EOF)
-    {
-        fclose(in);
-        fclose(out);
-        return 0;
-    }
+    obj->size = st.st_size;
+    obj->mode = st.st_mode;
 
-    uint8_t count = 1;
-    int c;
+    obj->created_at = st.st_ctime;
+    obj->modified_at = st.st_mtime;
+    obj->accessed_at = st.st_atime;
 
-    while ((c = fgetc(in)) != EOF)
+    if (S_ISREG(st.st_mode))
     {
-        if (c == prev && count < 255)
+        /* Check if file is an archive based on extension */
+        if (fossil_has_archive_ext(obj->path))
         {
-            count++;
+            obj->type = FOSSIL_FILESYS_TYPE_ARCHIVE;
         }
         else
         {
-            fputc(count, out);
-            fputc(prev, out);
-
-            prev = c;
-            count = 1;
+            obj->type = FOSSIL_FILESYS_TYPE_FILE;
         }
     }
+    else if (S_ISDIR(st.st_mode))
+        obj->type = FOSSIL_FILESYS_TYPE_DIR;
+    else if (S_ISLNK(st.st_mode))
+        obj->type = FOSSIL_FILESYS_TYPE_LINK;
+    else
+        obj->type = FOSSIL_FILESYS_TYPE_UNKNOWN;
 
-    /* flush last */
-    fputc(count, out);
-    fputc(prev, out);
+    obj->perms.read = (st.st_mode & S_IRUSR) != 0;
+    obj->perms.write = (st.st_mode & S_IWUSR) != 0;
+    obj->perms.execute = (st.st_mode & S_IXUSR) != 0;
 
-    fclose(in);
-    fclose(out);
-    return 0;
-}
-
-int32_t fossil_io_filesys_file_decompress(
-    const char *src,
-    const char *dest)
-{
-    if (!src || !dest)
-        return -1;
-
-    FILE *in = fopen(src, "rb");
-    FILE *out = fopen(dest, "wb");
-
-    if (!in || !out)
-    {
-        if (in)
-            fclose(in);
-        if (out)
-            fclose(out);
-        return -1;
-    }
-
-    int count, value;
-
-    while ((count = fgetc(in)) != EOF)
-    {
-        value = fgetc(in);
-        if (value == EOF)
-            break;
-
-        for (int i = 0; i < count; ++i)
-            fputc(value, out);
-    }
+#endif
 
-    fclose(in);
-    fclose(out);
+    fossil_mutex_unlock(&obj->lock);
     return 0;
 }
 
-int32_t fossil_io_filesys_file_is_readable(const char *path)
+static int64_t exists_uncached(const char *path)
 {
-    if (!path)
-        return -1;
 #if defined(_WIN32)
     DWORD attr = GetFileAttributesA(path);
-    if (attr == INVALID_FILE_ATTRIBUTES || (attr & FILE_ATTRIBUTE_DIRECTORY))
-        return 0;
-    HANDLE h = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (h == INVALID_HANDLE_VALUE)
-        return 0;
-    CloseHandle(h);
-    return 1;
-#else
-    if (access(path, R_OK) == 0)
+    if (attr == INVALID_FILE_ATTRIBUTES)
     {
-        struct stat st;
-        if (stat(path, &st) == 0 && S_ISREG(st.st_mode))
-            return 1;
-        return 0;
-    }
-    if (errno == ENOENT)
-        return 0;
-    return -1;
-#endif
-}
-
-int32_t fossil_io_filesys_file_is_writable(const char *path)
-{
-    if (!path)
+        if (GetLastError() == ERROR_FILE_NOT_FOUND ||
+            GetLastError() == ERROR_PATH_NOT_FOUND)
+            return 0;
         return -1;
-#if defined(_WIN32)
-    DWORD attr = GetFileAttributesA(path);
-    if (attr == INVALID_FILE_ATTRIBUTES || (attr & FILE_ATTRIBUTE_DIRECTORY))
-        return 0;
-    HANDLE h = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (h == INVALID_HANDLE_VALUE)
-        return 0;
-    CloseHandle(h);
+    }
     return 1;
 #else
-    if (access(path, W_OK) == 0)
-    {
-        struct stat st;
-        if (stat(path, &st) == 0 && S_ISREG(st.st_mode))
-            return 1;
-        return 0;
-    }
+    struct stat st;
+    if (lstat(path, &st) == 0)
+        return 1;
+
     if (errno == ENOENT)
         return 0;
+
     return -1;
 #endif
 }
 
-int32_t fossil_io_filesys_file_set_perms(const char *path, fossil_io_filesys_perms_t perms)
+int32_t fossil_io_filesys_exists(const char *path)
 {
     if (!path)
         return -1;
-#if defined(_WIN32)
-    // Windows does not support POSIX permissions; no-op
-    (void)perms;
-    return 0;
-#else
-    mode_t mode = 0;
-    if (perms.read)
-        mode |= S_IRUSR | S_IRGRP | S_IROTH;
-    if (perms.write)
-        mode |= S_IWUSR | S_IWGRP | S_IWOTH;
-    if (perms.execute)
-        mode |= S_IXUSR | S_IXGRP | S_IXOTH;
-    return chmod(path, mode);
-#endif
+
+    return (int32_t)fossil_cache_query(path, CACHE_EXISTS, exists_uncached);
 }
 
-int32_t fossil_io_filesys_file_set_owner(const char *path, const char *owner, const char *group)
+int32_t fossil_io_filesys_remove(const char *path, bool recursive)
 {
     if (!path)
         return -1;
+
+    int32_t rc;
+
 #if defined(_WIN32)
-    // Not supported on Windows
-    (void)owner;
-    (void)group;
-    return 0;
-#else
-    uid_t uid = (uid_t)-1;
-    gid_t gid = (gid_t)-1;
-    if (owner)
+
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES)
+        return -1;
+
+    if (attr & FILE_ATTRIBUTE_DIRECTORY)
     {
-        struct passwd *pw = getpwnam(owner);
-        if (pw)
-            uid = pw->pw_uid;
+        /* a directory link is removed, never descended into */
+        if (!recursive || (attr & FILE_ATTRIBUTE_REPARSE_POINT))
+            rc = RemoveDirectoryA(path) ? 0 : -1;
         else
-        {
-            char *endptr;
-            uid = (uid_t)strtol(owner, &endptr, 10);
-            if (*endptr != '\0')
-                uid = (uid_t)-1;
-        }
+            rc = remove_recursive(path, 0);
     }
-    if (group)
+    else
     {
-        struct group *gr = getgrnam(group);
-        if (gr)
-            gid = gr->gr_gid;
-        else
-        {
-            char *endptr;
-            gid = (gid_t)strtol(group, &endptr, 10);
-            if (*endptr != '\0')
-                gid = (gid_t)-1;
-        }
+        rc = DeleteFileA(path) ? 0 : -1;
     }
-    if (uid == (uid_t)-1 && gid == (gid_t)-1)
+
+#else
+
+    struct stat st;
+    if (lstat(path, &st) != 0)
         return -1;
-    return chown(path, uid, gid);
+
+    if (S_ISDIR(st.st_mode))
+    {
+        if (!recursive)
+            rc = rmdir(path);
+        else
+            rc = remove_recursive(path, 0);
+    }
+    else
+    {
+        rc = unlink(path);
+    }
+
 #endif
-}
 
-/* Directory Operations */
+    fossil_cache_forget(path, true);
+    return rc;
+}
 
-int32_t fossil_io_filesys_dir_create(const char *path, bool recursive)
+int32_t fossil_io_filesys_move(const char *src, const char *dest)
 {
-    if (!path || !*path)
+    if (!src || !dest)
         return -1;
 
-    if (!recursive)
-    {
 #if defined(_WIN32)
-        return (_mkdir(path) == 0) ? 0 : -1;
+    if (!MoveFileExA(src, dest, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        return -1;
 #else
-        return (mkdir(path, 0755) == 0) ? 0 : -1;
+    if (rename(src, dest) != 0)
+        return -1;
 #endif
-    }
 
-    char tmp[PATH_MAX];
-    strncpy(tmp, path, sizeof(tmp) - 1);
-    tmp[sizeof(tmp) - 1] = '\0';
+    fossil_cache_forget(src, true);
+    fossil_cache_forget(dest, true);
+    return 0;
+}
 
-    size_t len = strlen(tmp);
-    if (len == 0)
+int32_t fossil_io_filesys_copy(const char *src, const char *dest, bool preserve_meta)
+{
+    return fossil_io_filesys_copy_ex(src, dest, preserve_meta, NULL);
+}
+
+int32_t fossil_io_filesys_copy_ex(
+    const char *src,
+    const char *dest,
+    bool preserve_meta,
+    fossil_io_filesys_copy_stats_t *stats)
+{
+    if (!src || !dest)
         return -1;
 
-    /* strip trailing slash */
-    if (tmp[len - 1] == '/' || tmp[len - 1] == '\\')
-        tmp[len - 1] = '\0';
+    if (fossil_copy_engine(src, dest, stats) != 0)
+        return -1;
 
-    for (char *p = tmp + 1; *p; ++p)
+    /* Optional metadata copy */
+    if (preserve_meta)
     {
-        if (*p == '/' || *p == '\\')
+        struct stat st;
+        if (stat(src, &st) == 0)
         {
-            *p = '\0';
-#if defined(_WIN32)
-            _mkdir(tmp);
-#else
-            mkdir(tmp, 0755);
-#endif
-            *p = PATH_SEP;
+            chmod(dest, st.st_mode);
         }
     }
 
-#if defined(_WIN32)
-    if (_mkdir(tmp) == 0)
-        return 0;
-    return (GetLastError() == ERROR_ALREADY_EXISTS) ? 0 : -1;
-#else
-    if (mkdir(tmp, 0755) == 0)
-        return 0;
-    return (errno == EEXIST) ? 0 : -1;
-#endif
+    fossil_cache_forget(dest, true);
+    return 0;
 }
 
-int32_t fossil_io_filesys_dir_list(
-    const char *path,
-    fossil_io_filesys_obj_t *entries,
-    size_t max_entries,
-    size_t *out_count)
+const char *fossil_io_filesys_copy_strategy_string(fossil_io_filesys_copy_strategy_t strategy)
 {
-    if (!path || !entries || !out_count)
-        return -1;
-
-    *out_count = 0;
+    switch (strategy)
+    {
+    case FOSSIL_FILESYS_COPY_REFLINK:
+        return "reflink";
+    case FOSSIL_FILESYS_COPY_RANGE:
+        return "copy_file_range";
+    case FOSSIL_FILESYS_COPY_SENDFILE:
+        return "sendfile";
+    case FOSSIL_FILESYS_COPY_BUFFERED:
+        return "buffered";
+    default:
+        return "none";
+    }
+}
 
-#if defined(_WIN32)
+int32_t fossil_io_filesys_swap(const char *path1, const char *path2)
+{
+    if (!path1 || !path2)
+        return -1;
 
-    WIN32_FIND_DATAA fd;
-    char search[FOSSIL_FILESYS_MAX_PATH];
-    snprintf(search, sizeof(search), "%s\\*", path);
+    char tmp[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(tmp, sizeof(tmp), "%s.swap.tmp", path1);
 
-    HANDLE h = FindFirstFileA(search, &fd);
-    if (h == INVALID_HANDLE_VALUE)
+    /* Step 1: path1 -> tmp */
+    if (rename(path1, tmp) != 0)
         return -1;
 
-    do
+    /* Step 2: path2 -> path1 */
+    if (rename(path2, path1) != 0)
     {
-        if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
-            continue;
+        rename(tmp, path1); /* rollback */
+        return -1;
+    }
 
-        if (*out_count >= max_entries)
-            break;
+    /* Step 3: tmp -> path2 */
+    if (rename(tmp, path2) != 0)
+    {
+        /* catastrophic but recoverable */
+        rename(path1, path2);
+        rename(tmp, path1);
+        return -1;
+    }
 
-        char full[FOSSIL_FILESYS_MAX_PATH];
-        snprintf(full, sizeof(full), "%s\\%s", path, fd.cFileName);
+    fossil_cache_forget(path1, true);
+    fossil_cache_forget(path2, true);
+    return 0;
+}
 
-        fossil_io_filesys_stat(full, &entries[*out_count]);
-        (*out_count)++;
+/* ------------------------------------------------------------
+ * Deduplication
+ * ------------------------------------------------------------ */
 
-    } while (FindNextFileA(h, &fd));
+/* Bytes hashed from each end of a file in the partial-hash stage. */
+#define DEDUP_PARTIAL_WINDOW 4096
 
-    FindClose(h);
+typedef struct
+{
+    char *path;
+    uint64_t size;
+    uint32_t mode;
+    uint64_t partial;
+    uint64_t full;
+    size_t next;     /* next file in the same group, or DEDUP_NONE */
+    bool failed;     /* could not be read; never acted on */
+    bool duplicate;  /* byte-identical to its group leader */
+} dedup_file_t;
+
+#define DEDUP_NONE ((size_t)-1)
 
-#else
+typedef struct
+{
+    dedup_file_t *files;
+    size_t count;
+    size_t capacity;
+} dedup_list_t;
 
-    DIR *dir = opendir(path);
-    if (!dir)
-        return -1;
+/* Open-addressing map from a stage key to the head of a file chain. */
+typedef struct
+{
+    size_t *slots; /* file index of each group head, or DEDUP_NONE */
+    size_t capacity;
+    size_t used;
+} dedup_map_t;
 
-    struct dirent *entry;
+typedef enum
+{
+    DEDUP_STAGE_SIZE,
+    DEDUP_STAGE_PARTIAL,
+    DEDUP_STAGE_FULL,
+    DEDUP_STAGE_COMPARE
+} dedup_stage_t;
 
-    while ((entry = readdir(dir)))
+static int dedup_list_add(dedup_list_t *list, const char *path, uint64_t size, uint32_t mode)
+{
+    if (list->count == list->capacity)
     {
-        if (!strcmp(entry->d_name, ".") ||
-            !strcmp(entry->d_name, ".."))
-            continue;
-
-        if (*out_count >= max_entries)
-            break;
-
-        char full[512];
-        snprintf(full, sizeof(full), "%s/%s", path, entry->d_name);
-
-        fossil_io_filesys_stat(full, &entries[*out_count]);
-        (*out_count)++;
+        size_t cap = list->capacity ? list->capacity * 2 : 256;
+        dedup_file_t *grown = realloc(list->files, cap * sizeof(*grown));
+        if (!grown)
+            return -1;
+        list->files = grown;
+        list->capacity = cap;
     }
 
-    closedir(dir);
-
-#endif
+    size_t len = strlen(path) + 1;
+    char *copy = malloc(len);
+    if (!copy)
+        return -1;
+    memcpy(copy, path, len);
 
+    dedup_file_t *f = &list->files[list->count++];
+    memset(f, 0, sizeof(*f));
+    f->path = copy;
+    f->size = size;
+    f->mode = mode;
+    f->next = DEDUP_NONE;
     return 0;
 }
 
-static int dir_walk_internal(
-    const char *path,
-    int (*callback)(const fossil_io_filesys_obj_t *, void *),
-    void *user_data)
+static void dedup_list_free(dedup_list_t *list)
 {
-    fossil_io_filesys_obj_t obj;
-    memset(&obj, 0, sizeof(obj));
+    for (size_t i = 0; i < list->count; ++i)
+        free(list->files[i].path);
+    free(list->files);
+}
 
-    if (fossil_io_filesys_stat(path, &obj) != 0)
-        return -1;
+static int walk_regular_files(const char *path, size_t threads,
+                              int (*fn)(const char *, uint64_t, uint32_t, void *), void *user_data);
 
-    /* invoke callback */
-    int rc = callback(&obj, user_data);
-    if (rc != 0)
-        return rc;
+static int dedup_collect_file(const char *path, uint64_t size, uint32_t mode, void *user_data)
+{
+    /* Empty files have nothing to reclaim. */
+    if (size == 0)
+        return 0;
 
-#if defined(_WIN32)
+    return dedup_list_add((dedup_list_t *)user_data, path, size, mode) == 0 ? 0 : -1;
+}
 
-    if (obj.type != FOSSIL_FILESYS_TYPE_DIR)
-        return 0;
+static int dedup_collect(const char *path, bool recursive, dedup_list_t *list, size_t threads)
+{
+    /* calls are serialised, so the list needs no lock */
+    if (recursive)
+        return walk_regular_files(path, threads, dedup_collect_file, list);
+
+#if defined(_WIN32)
 
     WIN32_FIND_DATAA fd;
     char search[FOSSIL_FILESYS_MAX_PATH];
@@ -2056,17 +2730,20 @@ static int dir_walk_internal(
 
     do
     {
-        if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
+        if (fd.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_REPARSE_POINT))
+            continue;
+
+        uint64_t size = ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+        if (size == 0)
             continue;
 
         char full[FOSSIL_FILESYS_MAX_PATH];
         snprintf(full, sizeof(full), "%s\\%s", path, fd.cFileName);
 
-        rc = dir_walk_internal(full, callback, user_data);
-        if (rc != 0)
+        if (dedup_list_add(list, full, size, 0) != 0)
         {
             FindClose(h);
-            return rc;
+            return -1;
         }
 
     } while (FindNextFileA(h, &fd));
@@ -2075,32 +2752,50 @@ static int dir_walk_internal(
 
 #else
 
-    if (!S_ISDIR(obj.mode))
-        return 0;
-
-    DIR *dir = opendir(path);
+    int dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = (dfd >= 0) ? fdopendir(dfd) : NULL;
     if (!dir)
+    {
+        if (dfd >= 0)
+            close(dfd);
         return -1;
+    }
 
+    size_t base_len = strlen(path);
+    char *full = NULL;
+    size_t full_cap = 0;
     struct dirent *entry;
 
     while ((entry = readdir(dir)))
     {
-        if (!strcmp(entry->d_name, ".") ||
-            !strcmp(entry->d_name, ".."))
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
             continue;
 
-        char full[512];
-        snprintf(full, sizeof(full), "%s/%s", path, entry->d_name);
+        struct stat st;
+        if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 ||
+            !S_ISREG(st.st_mode) || st.st_size == 0)
+            continue;
 
-        rc = dir_walk_internal(full, callback, user_data);
-        if (rc != 0)
+        size_t need = base_len + strlen(entry->d_name) + 2;
+        if (need > full_cap)
+        {
+            char *grown = realloc(full, need);
+            if (!grown)
+                break;
+            full = grown;
+            full_cap = need;
+        }
+        snprintf(full, full_cap, "%s/%s", path, entry->d_name);
+
+        if (dedup_list_add(list, full, (uint64_t)st.st_size, (uint32_t)st.st_mode) != 0)
         {
+            free(full);
             closedir(dir);
-            return rc;
+            return -1;
         }
     }
 
+    free(full);
     closedir(dir);
 
 #endif
@@ -2108,602 +2803,9323 @@ static int dir_walk_internal(
     return 0;
 }
 
-int32_t fossil_io_filesys_dir_walk(
-    const char *path,
-    int (*callback)(const fossil_io_filesys_obj_t *, void *),
-    void *user_data)
+static uint64_t dedup_mix(uint64_t h, uint64_t v)
 {
-    if (!path || !callback)
-        return -1;
-
-    return dir_walk_internal(path, callback, user_data);
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
 }
 
-int32_t fossil_io_filesys_dir_merge(
-    const char *src,
-    const char *dest,
-    bool overwrite,
-    bool recursive)
+static uint64_t dedup_key(const dedup_file_t *f, dedup_stage_t stage)
 {
-#if defined(_WIN32)
+    uint64_t h = dedup_mix(0, f->size);
+    if (stage >= DEDUP_STAGE_PARTIAL)
+        h = dedup_mix(h, f->partial);
+    if (stage >= DEDUP_STAGE_FULL)
+        h = dedup_mix(h, f->full);
+    return h;
+}
 
-    WIN32_FIND_DATAA fd;
-    char search[FOSSIL_FILESYS_MAX_PATH];
-    snprintf(search, sizeof(search), "%s\\*", src);
+static bool dedup_same_key(const dedup_file_t *a, const dedup_file_t *b, dedup_stage_t stage)
+{
+    if (a->size != b->size)
+        return false;
+    if (stage >= DEDUP_STAGE_PARTIAL && a->partial != b->partial)
+        return false;
+    if (stage >= DEDUP_STAGE_FULL && a->full != b->full)
+        return false;
+    return true;
+}
 
-    HANDLE h = FindFirstFileA(search, &fd);
-    if (h == INVALID_HANDLE_VALUE)
+/*
+ * Regroup the candidate files by the given stage's key. Each map slot holds
+ * the head of a chain threaded through dedup_file_t.next; the chain heads are
+ * returned in `heads` so callers can visit every group once.
+ */
+static int dedup_group(dedup_list_t *list, const size_t *candidates, size_t count,
+                       dedup_stage_t stage, size_t **heads, size_t *head_count)
+{
+    dedup_map_t map;
+    map.capacity = 16;
+    while (map.capacity < count * 2)
+        map.capacity *= 2;
+    map.used = 0;
+    map.slots = malloc(map.capacity * sizeof(*map.slots));
+    *heads = malloc((count ? count : 1) * sizeof(**heads));
+    *head_count = 0;
+
+    if (!map.slots || !*heads)
+    {
+        free(map.slots);
+        free(*heads);
+        *heads = NULL;
         return -1;
+    }
 
-    char src_path[FOSSIL_FILESYS_MAX_PATH], dest_path[FOSSIL_FILESYS_MAX_PATH];
+    for (size_t i = 0; i < map.capacity; ++i)
+        map.slots[i] = DEDUP_NONE;
 
-    do
+    for (size_t c = 0; c < count; ++c)
     {
-        if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
+        size_t idx = candidates[c];
+        dedup_file_t *f = &list->files[idx];
+        if (f->failed)
             continue;
 
-        snprintf(src_path, sizeof(src_path), "%s\\%s", src, fd.cFileName);
-        snprintf(dest_path, sizeof(dest_path), "%s\\%s", dest, fd.cFileName);
+        size_t slot = (size_t)(dedup_key(f, stage) & (map.capacity - 1));
+        while (map.slots[slot] != DEDUP_NONE &&
+               !dedup_same_key(&list->files[map.slots[slot]], f, stage))
+            slot = (slot + 1) & (map.capacity - 1);
 
-        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        if (map.slots[slot] == DEDUP_NONE)
         {
-            if (recursive)
-            {
-                CreateDirectoryA(dest_path, NULL);
-                fossil_io_filesys_dir_merge(src_path, dest_path, overwrite, true);
-            }
+            map.slots[slot] = idx;
+            map.used++;
+            (*heads)[(*head_count)++] = idx;
+            f->next = DEDUP_NONE;
         }
         else
         {
-            if (!overwrite && GetFileAttributesA(dest_path) != INVALID_FILE_ATTRIBUTES)
-                continue;
-
-            fossil_io_filesys_copy(src_path, dest_path, true);
+            /* append behind the head so the first-seen file stays leader */
+            dedup_file_t *head = &list->files[map.slots[slot]];
+            f->next = head->next;
+            head->next = idx;
         }
-    } while (FindNextFileA(h, &fd));
+    }
 
-    FindClose(h);
+    free(map.slots);
     return 0;
+}
+
+/* Flatten every chain with two or more members into a new candidate list. */
+static size_t dedup_multi_members(dedup_list_t *list, const size_t *heads, size_t head_count,
+                                  size_t *out)
+{
+    size_t n = 0;
+
+    for (size_t h = 0; h < head_count; ++h)
+    {
+        size_t idx = heads[h];
+        if (list->files[idx].next == DEDUP_NONE)
+            continue;
 
+        for (; idx != DEDUP_NONE; idx = list->files[idx].next)
+            out[n++] = idx;
+    }
+
+    return n;
+}
+
+static int dedup_seek(FILE *fp, uint64_t offset)
+{
+#if defined(_WIN32)
+    return _fseeki64(fp, (__int64)offset, SEEK_SET);
 #else
+    return fseeko(fp, (off_t)offset, SEEK_SET);
+#endif
+}
 
-    DIR *dir = opendir(src);
-    if (!dir)
+static int dedup_partial_hash(const dedup_file_t *f, uint64_t *out)
+{
+    FILE *fp = fopen(f->path, "rb");
+    if (!fp)
         return -1;
 
-    struct dirent *entry;
-    char src_path[512], dest_path[512];
+    unsigned char buf[DEDUP_PARTIAL_WINDOW * 2];
+    size_t n = fread(buf, 1, DEDUP_PARTIAL_WINDOW, fp);
 
-    while ((entry = readdir(dir)) != NULL)
+    if (f->size > DEDUP_PARTIAL_WINDOW)
     {
-        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
-            continue;
+        uint64_t tail = f->size - DEDUP_PARTIAL_WINDOW;
+        if (tail < DEDUP_PARTIAL_WINDOW)
+            tail = DEDUP_PARTIAL_WINDOW;
+        if (dedup_seek(fp, tail) == 0)
+            n += fread(buf + n, 1, DEDUP_PARTIAL_WINDOW, fp);
+    }
 
-        snprintf(src_path, sizeof(src_path), "%s/%s", src, entry->d_name);
-        snprintf(dest_path, sizeof(dest_path), "%s/%s", dest, entry->d_name);
+    fclose(fp);
 
-        struct stat st;
-        stat(src_path, &st);
+    *out = fossil_hash64_buffer(buf, n);
+    return 0;
+}
+
+static bool dedup_same_content(const char *a, const char *b)
+{
+#if !defined(_WIN32)
+    /* hard links to the same inode already share storage */
+    struct stat sa, sb;
+    if (stat(a, &sa) == 0 && stat(b, &sb) == 0 &&
+        sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino)
+        return false;
+#endif
+
+    FILE *fa = fopen(a, "rb");
+    FILE *fb = fopen(b, "rb");
+    bool same = (fa && fb);
+
+    unsigned char ba[65536], bb[65536];
+    while (same)
+    {
+        size_t na = fread(ba, 1, sizeof(ba), fa);
+        size_t nb = fread(bb, 1, sizeof(bb), fb);
+        if (na != nb || memcmp(ba, bb, na) != 0)
+            same = false;
+        else if (na == 0)
+            break;
+    }
+
+    if (fa)
+        fclose(fa);
+    if (fb)
+        fclose(fb);
+    return same;
+}
+
+/* Hash stages and the final compare fan out across workers. */
+typedef struct
+{
+    dedup_list_t *list;
+    const size_t *items;
+    size_t count;
+    dedup_stage_t stage;
+    atomic_size_t cursor;
+} dedup_job_t;
+
+static void dedup_worker(void *arg, size_t index)
+{
+    dedup_job_t *job = (dedup_job_t *)arg;
+    (void)index;
+
+    for (;;)
+    {
+        size_t i = atomic_fetch_add(&job->cursor, 1);
+        if (i >= job->count)
+            break;
 
-        if (S_ISDIR(st.st_mode) && recursive)
+        dedup_file_t *f = &job->list->files[job->items[i]];
+
+        if (job->stage == DEDUP_STAGE_PARTIAL)
+        {
+            if (dedup_partial_hash(f, &f->partial) != 0)
+                f->failed = true;
+        }
+        else if (job->stage == DEDUP_STAGE_FULL)
         {
-            mkdir(dest_path, 0755);
-            fossil_io_filesys_dir_merge(src_path, dest_path, overwrite, true);
+            /* the partial hash already covered small files end to end */
+            f->full = (f->size <= 2 * DEDUP_PARTIAL_WINDOW) ? f->partial
+                                                             : fossil_hash_file(f->path);
         }
         else
         {
-            if (!overwrite && access(dest_path, F_OK) == 0)
-                continue;
-
-            fossil_io_filesys_copy(src_path, dest_path, true);
+            /* items[] holds leader/member pairs for the byte compare */
+            const dedup_file_t *leader = &job->list->files[f->next];
+            f->duplicate = dedup_same_content(leader->path, f->path);
         }
     }
-
-    closedir(dir);
-    return 0;
-
-#endif
 }
 
-int32_t fossil_io_filesys_dir_mirror(
-    const char *src,
-    const char *dest,
-    bool delete_extras)
+static void dedup_run(dedup_list_t *list, const size_t *items, size_t count,
+                      dedup_stage_t stage, size_t threads)
 {
-    if (!src || !dest)
-        return -1;
-
-    return mirror_recursive(src, dest, delete_extras);
+    dedup_job_t job;
+    job.list = list;
+    job.items = items;
+    job.count = count;
+    job.stage = stage;
+    atomic_init(&job.cursor, 0);
+
+    if (threads > count)
+        threads = count;
+    fossil_run_workers(threads ? threads : 1, dedup_worker, &job);
 }
 
-int32_t fossil_io_filesys_dir_exists(const char *path)
+static int dedup_replace(const dedup_file_t *leader, const dedup_file_t *dup,
+                         fossil_io_filesys_dedup_action_t action)
 {
-    if (!path)
-        return -1;
-#if defined(_WIN32)
-    DWORD attr = GetFileAttributesA(path);
-    if (attr == INVALID_FILE_ATTRIBUTES)
+    if (action == FOSSIL_FILESYS_DEDUP_DELETE)
     {
-        if (GetLastError() == ERROR_FILE_NOT_FOUND ||
-            GetLastError() == ERROR_PATH_NOT_FOUND)
-            return 0;
-        return -1;
+        int removed = remove(dup->path);
+        fossil_cache_forget(dup->path, false);
+        return removed;
     }
-    return (attr & FILE_ATTRIBUTE_DIRECTORY) ? 1 : 0;
-#else
-    struct stat st;
-    if (stat(path, &st) == 0)
-        return S_ISDIR(st.st_mode) ? 1 : 0;
-    if (errno == ENOENT)
-        return 0;
-    return -1;
-#endif
-}
 
-int32_t fossil_io_filesys_dir_is_readable(const char *path)
-{
-    if (!path)
+    size_t len = strlen(dup->path) + sizeof(".fossil-dedup");
+    char *tmp = malloc(len);
+    if (!tmp)
         return -1;
+    snprintf(tmp, len, "%s.fossil-dedup", dup->path);
+
+    int rc = -1;
+
 #if defined(_WIN32)
-    DWORD attr = GetFileAttributesA(path);
-    if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY))
-        return 0;
-    HANDLE h = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                           NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
-    if (h == INVALID_HANDLE_VALUE)
-        return 0;
-    CloseHandle(h);
-    return 1;
+
+    if (action == FOSSIL_FILESYS_DEDUP_HARDLINK &&
+        CreateHardLinkA(tmp, leader->path, NULL))
+    {
+        rc = MoveFileExA(tmp, dup->path, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+        if (rc != 0)
+            DeleteFileA(tmp);
+    }
+
 #else
-    if (access(path, R_OK | X_OK) == 0)
+
+    if (action == FOSSIL_FILESYS_DEDUP_HARDLINK)
     {
-        struct stat st;
-        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
-            return 1;
-        return 0;
+        rc = link(leader->path, tmp);
     }
-    if (errno == ENOENT)
-        return 0;
-    return -1;
+    else
+    {
+#if defined(FICLONE)
+        int in = open(leader->path, O_RDONLY | O_CLOEXEC);
+        int out = (in >= 0) ? open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                                   (mode_t)(dup->mode & 07777))
+                            : -1;
+        if (out >= 0 && ioctl(out, FICLONE, in) == 0)
+            rc = 0;
+        if (out >= 0)
+        {
+            close(out);
+            if (rc != 0)
+                unlink(tmp);
+        }
+        if (in >= 0)
+            close(in);
 #endif
-}
+    }
 
-int32_t fossil_io_filesys_dir_is_writable(const char *path)
-{
-    if (!path)
-        return -1;
-#if defined(_WIN32)
-    DWORD attr = GetFileAttributesA(path);
-    if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY))
-        return 0;
-    HANDLE h = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                           NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
-    if (h == INVALID_HANDLE_VALUE)
-        return 0;
-    CloseHandle(h);
-    return 1;
-#else
-    if (access(path, W_OK | X_OK) == 0)
+    if (rc == 0 && rename(tmp, dup->path) != 0)
     {
-        struct stat st;
-        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
-            return 1;
-        return 0;
+        unlink(tmp);
+        rc = -1;
     }
-    if (errno == ENOENT)
-        return 0;
-    return -1;
+
 #endif
+
+    fossil_cache_forget(dup->path, false);
+    free(tmp);
+    return rc;
 }
 
-int32_t fossil_io_filesys_dir_set_perms(const char *path, fossil_io_filesys_perms_t perms)
+int32_t fossil_io_filesys_deduplicate_ex(
+    const char *path,
+    bool recursive,
+    const fossil_io_filesys_dedup_opts_t *opts,
+    fossil_io_filesys_dedup_stats_t *stats)
 {
+    if (stats)
+        memset(stats, 0, sizeof(*stats));
+
     if (!path)
         return -1;
+
+    fossil_io_filesys_dedup_action_t action = opts ? opts->action : FOSSIL_FILESYS_DEDUP_DELETE;
+    size_t threads = (opts && opts->threads) ? opts->threads : fossil_cpu_count();
+
+    dedup_list_t list = {NULL, 0, 0};
+    if (dedup_collect(path, recursive, &list, threads) != 0 && list.count == 0)
+    {
+        dedup_list_free(&list);
+        return -1;
+    }
+
+    if (stats)
+        stats->files_scanned = list.count;
+
+    size_t *cand = malloc((list.count ? list.count : 1) * sizeof(*cand));
+    size_t *heads = NULL;
+    size_t head_count = 0;
+    if (!cand)
+    {
+        dedup_list_free(&list);
+        return -1;
+    }
+
+    /* stage 1: size */
+    for (size_t i = 0; i < list.count; ++i)
+        cand[i] = i;
+    size_t n = list.count;
+
+    static const dedup_stage_t stages[] = {DEDUP_STAGE_SIZE, DEDUP_STAGE_PARTIAL, DEDUP_STAGE_FULL};
+    for (size_t s = 0; s < sizeof(stages) / sizeof(stages[0]) && n > 1; ++s)
+    {
+        /* stage 2 and 3: hash only files that still share a group */
+        if (stages[s] != DEDUP_STAGE_SIZE)
+            dedup_run(&list, cand, n, stages[s], threads);
+
+        free(heads);
+        if (dedup_group(&list, cand, n, stages[s], &heads, &head_count) != 0)
+        {
+            free(cand);
+            dedup_list_free(&list);
+            return -1;
+        }
+        n = dedup_multi_members(&list, heads, head_count, cand);
+    }
+
+    /* stage 4: byte compare every member against its group leader */
+    size_t pairs = 0;
+    for (size_t h = 0; n > 1 && h < head_count; ++h)
+    {
+        size_t leader = heads[h];
+        size_t idx = list.files[leader].next;
+        while (idx != DEDUP_NONE)
+        {
+            size_t following = list.files[idx].next;
+            list.files[idx].next = leader;
+            cand[pairs++] = idx;
+            idx = following;
+        }
+    }
+    dedup_run(&list, cand, pairs, DEDUP_STAGE_COMPARE, threads);
+
+    int32_t handled = 0;
+    for (size_t p = 0; p < pairs; ++p)
+    {
+        dedup_file_t *dup = &list.files[cand[p]];
+        if (!dup->duplicate)
+            continue;
+
+        if (dedup_replace(&list.files[dup->next], dup, action) == 0)
+        {
+            handled++;
+            if (stats)
+            {
+                stats->duplicates++;
+                stats->bytes_reclaimed += dup->size;
+            }
+        }
+    }
+
+    free(heads);
+    free(cand);
+    dedup_list_free(&list);
+    return handled;
+}
+
+int32_t fossil_io_filesys_deduplicate(const char *path, bool recursive)
+{
+    return fossil_io_filesys_deduplicate_ex(path, recursive, NULL, NULL);
+}
+
+int32_t fossil_io_filesys_stat(const char *path, fossil_io_filesys_obj_t *obj)
+{
+    if (!path || !obj)
+        return -1;
+
+    // Always initialize with the given path, then refresh metadata.
+    if (fossil_io_filesys_init(obj, path) != 0)
+        return -1;
+
+    // Refresh to get up-to-date type and metadata.
+    if (fossil_io_filesys_refresh(obj) != 0)
+        return -1;
+
+    return 0;
+}
+
+int32_t fossil_io_filesys_file_format(const char *path, char *format_out, size_t max_len)
+{
+    if (!path || !format_out || max_len == 0)
+        return -1;
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return -1;
+
+    unsigned char magic[16];
+    size_t n = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+
+    if (n == 0)
+    {
+        strncpy(format_out, "empty", max_len - 1);
+        format_out[max_len - 1] = '\0';
+        return 0;
+    }
+
+    /* Check magic bytes */
+    if (n >= 4 && magic[0] == 0x50 && magic[1] == 0x4B && magic[2] == 0x03 && magic[3] == 0x04)
+    {
+        strncpy(format_out, "zip", max_len - 1);
+    }
+    else if (n >= 4 && magic[0] == 0x50 && magic[1] == 0x4B && magic[2] == 0x05 && magic[3] == 0x06)
+    {
+        strncpy(format_out, "zip", max_len - 1);
+    }
+    else if (n >= 4 && magic[0] == 0x50 && magic[1] == 0x4B && magic[2] == 0x07 && magic[3] == 0x08)
+    {
+        strncpy(format_out, "zip", max_len - 1);
+    }
+    else if (n >= 3 && magic[0] == 0x1F && magic[1] == 0x8B && magic[2] == 0x08)
+    {
+        strncpy(format_out, "gzip", max_len - 1);
+    }
+    else if (n >= 6 && magic[0] == 0x37 && magic[1] == 0x7A && magic[2] == 0x58 && magic[3] == 0x5A && magic[4] == 0x00)
+    {
+        strncpy(format_out, "xz", max_len - 1);
+    }
+    else if (n >= 2 && magic[0] == 0x42 && magic[1] == 0x5A)
+    {
+        strncpy(format_out, "bzip2", max_len - 1);
+    }
+    else if (n >= 4 && magic[0] == 0x89 && magic[1] == 0x50 && magic[2] == 0x4E && magic[3] == 0x47)
+    {
+        strncpy(format_out, "png", max_len - 1);
+    }
+    else if (n >= 3 && magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF)
+    {
+        strncpy(format_out, "jpeg", max_len - 1);
+    }
+    else if (n >= 4 && magic[0] == 0x47 && magic[1] == 0x49 && magic[2] == 0x46)
+    {
+        strncpy(format_out, "gif", max_len - 1);
+    }
+    else if (n >= 4 && magic[0] == 0x25 && magic[1] == 0x50 && magic[2] == 0x44 && magic[3] == 0x46)
+    {
+        strncpy(format_out, "pdf", max_len - 1);
+    }
+    else if (n >= 4 && magic[0] == 0x7F && magic[1] == 0x45 && magic[2] == 0x4C && magic[3] == 0x46)
+    {
+        strncpy(format_out, "elf", max_len - 1);
+    }
+    else if (n >= 2 && magic[0] == 0x4D && magic[1] == 0x5A)
+    {
+        strncpy(format_out, "pe", max_len - 1);
+    }
+    else if (n >= 2 && magic[0] == 0xFF && magic[1] == 0xFE)
+    {
+        strncpy(format_out, "utf16le", max_len - 1);
+    }
+    else if (n >= 2 && magic[0] == 0xFE && magic[1] == 0xFF)
+    {
+        strncpy(format_out, "utf16be", max_len - 1);
+    }
+    else if (n >= 3 && magic[0] == 0xEF && magic[1] == 0xBB && magic[2] == 0xBF)
+    {
+        strncpy(format_out, "utf8", max_len - 1);
+    }
+    else if (n >= 4 && magic[0] == 0xCA && magic[1] == 0xFE && magic[2] == 0xBA && magic[3] == 0xBE)
+    {
+        strncpy(format_out, "class", max_len - 1);
+    }
+    else
+    {
+        /* Fallback to extension */
+        const char *dot = strrchr(path, '.');
+        if (dot && *(dot + 1) != '\0')
+        {
+            strncpy(format_out, dot + 1, max_len - 1);
+        }
+        else
+        {
+            strncpy(format_out, "unknown", max_len - 1);
+        }
+    }
+
+    format_out[max_len - 1] = '\0';
+    return 0;
+}
+
+int32_t fossil_io_filesys_file_rewrite(const char *path, int (*transform)(void *buf, size_t *size, void *user_data), void *user_data)
+{
+    if (!path || !transform)
+        return -1;
+
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.rewrite", path);
+
+    /* Read original file */
+    FILE *in = fopen(path, "rb");
+    if (!in)
+        return -1;
+
+    fseek(in, 0, SEEK_END);
+    size_t file_size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+
+    unsigned char *buffer = malloc(file_size);
+    if (!buffer)
+    {
+        fclose(in);
+        return -1;
+    }
+
+    if (fread(buffer, 1, file_size, in) != file_size)
+    {
+        free(buffer);
+        fclose(in);
+        return -1;
+    }
+
+    fclose(in);
+
+    /* Apply transformation */
+    size_t new_size = file_size;
+    int rc = transform(buffer, &new_size, user_data);
+    if (rc != 0)
+    {
+        free(buffer);
+        return -1;
+    }
+
+    /* Write to temporary file */
+    FILE *out = fopen(tmp_path, "wb");
+    if (!out)
+    {
+        free(buffer);
+        return -1;
+    }
+
+    if (fwrite(buffer, 1, new_size, out) != new_size)
+    {
+        fclose(out);
+        free(buffer);
+        remove(tmp_path);
+        return -1;
+    }
+
+    fclose(out);
+    free(buffer);
+
+    /* Atomic swap */
+    if (fossil_io_filesys_move(tmp_path, path) != 0)
+    {
+        remove(tmp_path);
+        return -1;
+    }
+
+    fossil_cache_forget(path, false);
+    return 0;
+}
+
+/* File Operations */
+
+// feature from file stream preservide for filesys
+typedef struct
+{
+    const char *keyword;
+    const char *mode;
+} fossil_io_file_mode_entry_t;
+
+static const fossil_io_file_mode_entry_t fossil_io_file_mode_table[] = {
+    // Classic C modes (standard fopen strings)
+    {"r", "r"},
+    {"rb", "rb"},
+    {"w", "w"},
+    {"wb", "wb"},
+    {"a", "a"},
+    {"ab", "ab"},
+    {"r+", "r+"},
+    {"rb+", "r+b"},
+    {"r+b", "r+b"},
+    {"w+", "w+"},
+    {"wb+", "w+b"},
+    {"w+b", "w+b"},
+    {"a+", "a+"},
+    {"ab+", "a+b"},
+    {"a+b", "a+b"},
+
+    // Extended readable modes
+    {"read", "r"},
+    {"readb", "rb"},
+    {"write", "w"},
+    {"writeb", "wb"},
+    {"append", "a"},
+    {"appendb", "ab"},
+    {"read+write", "r+"},
+    {"read+writeb", "r+b"},
+    {"write+read", "w+"},
+    {"write+readb", "w+b"},
+    {"append+read", "a+"},
+    {"append+readb", "a+b"},
+    {"read+t", "rt"},
+    {"write+t", "wt"},
+    {"read+write+t", "r+t"},
+
+    {NULL, NULL}};
+
+/* Translate mode keyword to standard fopen mode */
+static const char *file_mode_resolve(const char *mode)
+{
+    for (size_t i = 0; fossil_io_file_mode_table[i].keyword != NULL; ++i)
+    {
+        if (strcmp(fossil_io_file_mode_table[i].keyword, mode) == 0)
+            return fossil_io_file_mode_table[i].mode;
+    }
+    return mode;
+}
+
+int32_t fossil_io_filesys_file_open(
+    fossil_io_filesys_file_t *f,
+    const char *path,
+    const char *mode)
+{
+    if (!f || !path || !mode)
+        return -1;
+
+    memset(f, 0, sizeof(*f));
+
+    const char *actual_mode = file_mode_resolve(mode);
+
+    /* init base object */
+    if (fossil_io_filesys_init(&f->base, path) != 0)
+        return -1;
+
+    fossil_mutex_lock(&f->base.lock);
+
+    FILE *fp = fopen(path, actual_mode);
+    if (!fp)
+    {
+        fossil_mutex_unlock(&f->base.lock);
+        return -1;
+    }
+
+    f->handle = fp;
+    f->fd = fileno(fp);
+    f->is_open = true;
+    f->append_mode = (strchr(actual_mode, 'a') != NULL);
+    f->position = 0;
+    f->flush_level = FOSSIL_FILESYS_FLUSH_FULL;
+
+    fossil_mutex_unlock(&f->base.lock);
+
+    if (strpbrk(actual_mode, "wa+"))
+        fossil_cache_forget(path, false);
+    return 0;
+}
+
+/* Default write buffer for owned streams. */
+#define FOSSIL_STREAM_BUFFER_SIZE (64 * 1024)
+
+/* Owned streams belong to a single thread and skip the object lock. */
+static void file_lock(fossil_io_filesys_file_t *f)
+{
+    if (f->stream_mode != FOSSIL_FILESYS_STREAM_OWNED)
+        fossil_mutex_lock(&f->base.lock);
+}
+
+static void file_unlock(fossil_io_filesys_file_t *f)
+{
+    if (f->stream_mode != FOSSIL_FILESYS_STREAM_OWNED)
+        fossil_mutex_unlock(&f->base.lock);
+}
+
+/* Hand any batched owned-mode bytes to stdio. */
+static int file_drain(fossil_io_filesys_file_t *f)
+{
+    if (f->buffer_used == 0)
+        return 0;
+
+    unsigned char *buf = (unsigned char *)f->buffer;
+    size_t n = fwrite(buf, 1, f->buffer_used, (FILE *)f->handle);
+    if (n != f->buffer_used)
+    {
+        memmove(buf, buf + n, f->buffer_used - n);
+        f->buffer_used -= n;
+        return -1;
+    }
+
+    f->buffer_used = 0;
+    return 0;
+}
+
+int32_t fossil_io_filesys_file_close(fossil_io_filesys_file_t *f)
+{
+    if (!file_ready(f))
+        return -1;
+
+    file_lock(f);
+
+    FILE *fp = (FILE *)f->handle;
+    int drained = file_drain(f);
+    int rc = fclose(fp);
+
+    f->handle = NULL;
+    f->is_open = false;
+
+    free(f->buffer);
+    f->buffer = NULL;
+    f->buffer_size = 0;
+    f->buffer_used = 0;
+
+    file_unlock(f);
+    fossil_cache_forget(f->base.path, false);
+    return (rc == 0 && drained == 0) ? 0 : -1;
+}
+
+size_t fossil_io_filesys_file_read(
+    fossil_io_filesys_file_t *f,
+    void *buf,
+    size_t size,
+    size_t count)
+{
+    if (!file_ready(f) || !buf)
+        return 0;
+
+    file_lock(f);
+
+    FILE *fp = (FILE *)f->handle;
+    if (file_drain(f) != 0)
+    {
+        file_unlock(f);
+        return 0;
+    }
+
+    size_t n = fread(buf, size, count, fp);
+
+    if (f->stream_mode != FOSSIL_FILESYS_STREAM_OWNED)
+        f->position = (uint64_t)fossil_ftell64(fp);
+
+    file_unlock(f);
+    return n;
+}
+
+size_t fossil_io_filesys_file_write(
+    fossil_io_filesys_file_t *f,
+    const void *buf,
+    size_t size,
+    size_t count)
+{
+    if (!file_ready(f) || !buf)
+        return 0;
+
+    if (f->stream_mode == FOSSIL_FILESYS_STREAM_OWNED)
+    {
+        if (size == 0 || count == 0)
+            return 0;
+        if (count > SIZE_MAX / size)
+            return 0;
+
+        size_t bytes = size * count;
+
+        if (bytes > f->buffer_size - f->buffer_used && file_drain(f) != 0)
+            return 0;
+
+        /* large writes bypass the batch buffer entirely */
+        if (bytes >= f->buffer_size)
+            return fwrite(buf, size, count, (FILE *)f->handle);
+
+        memcpy((unsigned char *)f->buffer + f->buffer_used, buf, bytes);
+        f->buffer_used += bytes;
+        return count;
+    }
+
+    fossil_mutex_lock(&f->base.lock);
+
+    FILE *fp = (FILE *)f->handle;
+
+    if (f->append_mode)
+        fseek(fp, 0, SEEK_END);
+
+    size_t n = fwrite(buf, size, count, fp);
+
+    f->position = (uint64_t)fossil_ftell64(fp);
+
+    fossil_mutex_unlock(&f->base.lock);
+    return n;
+}
+
+int32_t fossil_io_filesys_file_seek(
+    fossil_io_filesys_file_t *f,
+    int64_t offset,
+    int32_t origin)
+{
+    if (!file_ready(f))
+        return -1;
+
+    file_lock(f);
+
+    FILE *fp = (FILE *)f->handle;
+    if (file_drain(f) != 0)
+    {
+        file_unlock(f);
+        return -1;
+    }
+
+#if defined(_WIN32)
+    int rc = _fseeki64(fp, offset, origin);
+#else
+    int rc = fseeko(fp, offset, origin);
+#endif
+
+    if (rc == 0 && f->stream_mode != FOSSIL_FILESYS_STREAM_OWNED)
+        f->position = (uint64_t)fossil_ftell64(fp);
+
+    file_unlock(f);
+    return (rc == 0) ? 0 : -1;
+}
+
+int64_t fossil_io_filesys_file_tell(fossil_io_filesys_file_t *f)
+{
+    if (!file_ready(f))
+        return -1;
+
+    file_lock(f);
+
+    FILE *fp = (FILE *)f->handle;
+
+#if defined(_WIN32)
+    int64_t pos = _ftelli64(fp);
+#else
+    int64_t pos = ftello(fp);
+#endif
+
+    /* bytes still batched in user space are logically already written */
+    if (pos >= 0)
+        pos += (int64_t)f->buffer_used;
+
+    f->position = (uint64_t)pos;
+
+    file_unlock(f);
+    return pos;
+}
+
+/*
+ * Positional file I/O. POSIX pread/pwrite never touch the descriptor's
+ * offset, so these run without the object lock. On Windows a synchronous
+ * handle's pointer moves with OVERLAPPED I/O, so it is saved and restored
+ * under the lock there.
+ */
+#if defined(_WIN32)
+static bool file_positional_begin(fossil_io_filesys_file_t *f, fossil_native_t *h, LARGE_INTEGER *saved)
+{
+    *h = (HANDLE)_get_osfhandle(f->fd);
+    if (*h == INVALID_HANDLE_VALUE)
+        return false;
+    fossil_mutex_lock(&f->base.lock);
+    LARGE_INTEGER zero;
+    zero.QuadPart = 0;
+    SetFilePointerEx(*h, zero, saved, FILE_CURRENT);
+    return true;
+}
+
+static void file_positional_end(fossil_io_filesys_file_t *f, fossil_native_t h, const LARGE_INTEGER *saved)
+{
+    SetFilePointerEx(h, *saved, NULL, FILE_BEGIN);
+    fossil_mutex_unlock(&f->base.lock);
+}
+#else
+#define file_positional_begin(f, h, saved) ((*(h) = (f)->fd) >= 0)
+#define file_positional_end(f, h, saved) ((void)0)
+#endif
+
+/* Loop a positional transfer until len bytes moved, EOF, or an error. */
+static int64_t file_transfer_at(fossil_native_t h, unsigned char *buf, size_t len, uint64_t offset, bool write)
+{
+    size_t done = 0;
+    while (done < len)
+    {
+        int64_t n = write ? fossil_native_pwrite(h, buf + done, len - done, offset + done)
+                          : fossil_native_pread(h, buf + done, len - done, offset + done);
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        done += (size_t)n;
+    }
+    return (int64_t)done;
+}
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define FOSSIL_HAVE_PREADV 1
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+_Static_assert(sizeof(fossil_io_filesys_iovec_t) == sizeof(struct iovec) &&
+                   offsetof(fossil_io_filesys_iovec_t, len) == offsetof(struct iovec, iov_len),
+               "fossil_io_filesys_iovec_t must match struct iovec");
+#endif
+
+static int64_t file_transfer_vec(fossil_native_t h, const fossil_io_filesys_iovec_t *iov, size_t count,
+                                 uint64_t offset, bool write)
+{
+    int64_t total = 0;
+    size_t i = 0, skip = 0; /* skip: bytes of iov[i] already transferred */
+
+    while (i < count)
+    {
+        if (skip == iov[i].len)
+        {
+            i++;
+            skip = 0;
+            continue;
+        }
+
+        int64_t n;
+#ifdef FOSSIL_HAVE_PREADV
+        if (skip == 0)
+        {
+            int segs = (count - i > (size_t)IOV_MAX) ? IOV_MAX : (int)(count - i);
+            const struct iovec *v = (const struct iovec *)(const void *)(iov + i);
+            n = write ? pwritev(h, v, segs, (off_t)offset) : preadv(h, v, segs, (off_t)offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+        }
+        else
+#endif
+        {
+            /* finish a partially transferred segment on its own */
+            n = write ? fossil_native_pwrite(h, (unsigned char *)iov[i].base + skip, iov[i].len - skip, offset)
+                      : fossil_native_pread(h, (unsigned char *)iov[i].base + skip, iov[i].len - skip, offset);
+        }
+
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+
+        total += n;
+        offset += (uint64_t)n;
+        for (uint64_t left = (uint64_t)n; left > 0 && i < count;)
+        {
+            size_t room = iov[i].len - skip;
+            if (left >= room)
+            {
+                left -= room;
+                i++;
+                skip = 0;
+            }
+            else
+            {
+                skip += (size_t)left;
+                left = 0;
+            }
+        }
+    }
+    return total;
+}
+
+int64_t fossil_io_filesys_file_pread(
+    fossil_io_filesys_file_t *f,
+    void *buf,
+    size_t len,
+    uint64_t offset)
+{
+    fossil_native_t h;
+#if defined(_WIN32)
+    LARGE_INTEGER saved;
+#endif
+    if (!file_ready(f) || !buf || !file_positional_begin(f, &h, &saved))
+        return -1;
+
+    int64_t n = file_transfer_at(h, (unsigned char *)buf, len, offset, false);
+
+    file_positional_end(f, h, &saved);
+    return n;
+}
+
+int64_t fossil_io_filesys_file_pwrite(
+    fossil_io_filesys_file_t *f,
+    const void *buf,
+    size_t len,
+    uint64_t offset)
+{
+    fossil_native_t h;
+#if defined(_WIN32)
+    LARGE_INTEGER saved;
+#endif
+    if (!file_ready(f) || !buf || !file_positional_begin(f, &h, &saved))
+        return -1;
+
+    int64_t n = file_transfer_at(h, (unsigned char *)(uintptr_t)buf, len, offset, true);
+
+    file_positional_end(f, h, &saved);
+    return (n == (int64_t)len) ? n : -1;
+}
+
+int64_t fossil_io_filesys_file_preadv(
+    fossil_io_filesys_file_t *f,
+    const fossil_io_filesys_iovec_t *iov,
+    size_t count,
+    uint64_t offset)
+{
+    fossil_native_t h;
+#if defined(_WIN32)
+    LARGE_INTEGER saved;
+#endif
+    if (!file_ready(f) || (!iov && count) || !file_positional_begin(f, &h, &saved))
+        return -1;
+
+    int64_t n = file_transfer_vec(h, iov, count, offset, false);
+
+    file_positional_end(f, h, &saved);
+    return n;
+}
+
+int64_t fossil_io_filesys_file_pwritev(
+    fossil_io_filesys_file_t *f,
+    const fossil_io_filesys_iovec_t *iov,
+    size_t count,
+    uint64_t offset)
+{
+    fossil_native_t h;
+#if defined(_WIN32)
+    LARGE_INTEGER saved;
+#endif
+    if (!file_ready(f) || (!iov && count) || !file_positional_begin(f, &h, &saved))
+        return -1;
+
+    int64_t n = file_transfer_vec(h, iov, count, offset, true);
+
+    file_positional_end(f, h, &saved);
+
+    uint64_t want = 0;
+    for (size_t i = 0; i < count; ++i)
+        want += iov[i].len;
+    return (n >= 0 && (uint64_t)n == want) ? n : -1;
+}
+
+/* Most concurrent syncs issued by one group commit. */
+#define FOSSIL_SYNC_GROUP_MAX_THREADS 16
+
+/*
+ * Push a descriptor's data to stable storage. Descriptors that cannot be
+ * synchronised (pipes, terminals) have nothing to persist and succeed.
+ */
+static int fossil_fd_sync(int fd, fossil_io_filesys_flush_level_t level)
+{
+    if (level == FOSSIL_FILESYS_FLUSH_BUFFER)
+        return 0;
+
+#if defined(_WIN32)
+    if (GetFileType((HANDLE)_get_osfhandle(fd)) != FILE_TYPE_DISK)
+        return 0;
+    return (_commit(fd) == 0) ? 0 : -1;
+#else
+    int rc;
+#if defined(__APPLE__)
+    rc = fsync(fd); /* no fdatasync */
+#else
+    rc = (level == FOSSIL_FILESYS_FLUSH_DATA) ? fdatasync(fd) : fsync(fd);
+#endif
+    if (rc != 0 && (errno == EINVAL || errno == EROFS || errno == ENOTSUP))
+        return 0;
+    return (rc == 0) ? 0 : -1;
+#endif
+}
+
+static int32_t file_flush_to(fossil_io_filesys_file_t *f, fossil_io_filesys_flush_level_t level)
+{
+    file_lock(f);
+
+    FILE *fp = (FILE *)f->handle;
+    int drained = file_drain(f);
+    int rc = fflush(fp);
+    int synced = fossil_fd_sync(fileno(fp), level);
+
+    file_unlock(f);
+    return (rc == 0 && drained == 0 && synced == 0) ? 0 : -1;
+}
+
+int32_t fossil_io_filesys_file_flush(fossil_io_filesys_file_t *f)
+{
+    if (!file_ready(f))
+        return -1;
+
+    return file_flush_to(f, f->flush_level);
+}
+
+int32_t fossil_io_filesys_file_set_flush_level(
+    fossil_io_filesys_file_t *f,
+    fossil_io_filesys_flush_level_t level)
+{
+    if (!f || !f->is_open)
+        return -1;
+
+    if (level != FOSSIL_FILESYS_FLUSH_BUFFER &&
+        level != FOSSIL_FILESYS_FLUSH_DATA &&
+        level != FOSSIL_FILESYS_FLUSH_FULL)
+        return -1;
+
+    f->flush_level = level;
+    return 0;
+}
+
+int32_t fossil_io_filesys_file_sync(
+    fossil_io_filesys_file_t *f,
+    fossil_io_filesys_flush_level_t level)
+{
+    if (!file_ready(f))
+        return -1;
+
+    return file_flush_to(f, level);
+}
+
+typedef struct
+{
+    const int *fds;
+    size_t count;
+    fossil_io_filesys_flush_level_t level;
+    atomic_size_t cursor;
+    atomic_int failed;
+} sync_group_job_t;
+
+static void sync_group_worker(void *arg, size_t index)
+{
+    sync_group_job_t *job = (sync_group_job_t *)arg;
+    (void)index;
+
+    for (;;)
+    {
+        size_t i = atomic_fetch_add(&job->cursor, 1);
+        if (i >= job->count)
+            break;
+        if (fossil_fd_sync(job->fds[i], job->level) != 0)
+            atomic_store(&job->failed, 1);
+    }
+}
+
+static int fossil_int_cmp(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+int32_t fossil_io_filesys_file_sync_group(
+    fossil_io_filesys_file_t *const *files,
+    size_t count,
+    fossil_io_filesys_flush_level_t level)
+{
+    if (!files && count > 0)
+        return -1;
+
+    int *fds = malloc((count ? count : 1) * sizeof(*fds));
+    if (!fds)
+        return -1;
+
+    bool failed = false;
+    size_t n = 0;
+
+    /* phase 1: get every buffer into the kernel */
+    for (size_t i = 0; i < count; ++i)
+    {
+        fossil_io_filesys_file_t *f = files[i];
+        if (!f)
+            continue;
+        if (!file_ready(f))
+        {
+            failed = true;
+            continue;
+        }
+
+        file_lock(f);
+        FILE *fp = (FILE *)f->handle;
+        if (file_drain(f) != 0 || fflush(fp) != 0)
+            failed = true;
+        fds[n++] = fileno(fp);
+        file_unlock(f);
+    }
+
+    /* phase 2: one sync per distinct descriptor, issued concurrently */
+    qsort(fds, n, sizeof(*fds), fossil_int_cmp);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (unique == 0 || fds[unique - 1] != fds[i])
+            fds[unique++] = fds[i];
+
+    if (level != FOSSIL_FILESYS_FLUSH_BUFFER && unique > 0)
+    {
+        sync_group_job_t job;
+        job.fds = fds;
+        job.count = unique;
+        job.level = level;
+        atomic_init(&job.cursor, 0);
+        atomic_init(&job.failed, 0);
+
+        size_t threads = unique < FOSSIL_SYNC_GROUP_MAX_THREADS ? unique : FOSSIL_SYNC_GROUP_MAX_THREADS;
+        fossil_run_workers(threads, sync_group_worker, &job);
+
+        if (atomic_load(&job.failed))
+            failed = true;
+    }
+
+    free(fds);
+    return failed ? -1 : 0;
+}
+
+int32_t fossil_io_filesys_file_set_stream_mode(
+    fossil_io_filesys_file_t *f,
+    fossil_io_filesys_stream_mode_t mode,
+    size_t buffer_size)
+{
+    if (!file_ready(f))
+        return -1;
+
+    if (mode != FOSSIL_FILESYS_STREAM_LOCKED && mode != FOSSIL_FILESYS_STREAM_OWNED)
+        return -1;
+
+    /* whoever switches modes must already own the stream */
+    if (file_drain(f) != 0)
+        return -1;
+
+    if (mode == FOSSIL_FILESYS_STREAM_LOCKED)
+    {
+        free(f->buffer);
+        f->buffer = NULL;
+        f->buffer_size = 0;
+        f->stream_mode = mode;
+
+        fossil_mutex_lock(&f->base.lock);
+        f->position = (uint64_t)fossil_ftell64((FILE *)f->handle);
+        fossil_mutex_unlock(&f->base.lock);
+        return 0;
+    }
+
+    if (buffer_size == 0)
+        buffer_size = FOSSIL_STREAM_BUFFER_SIZE;
+
+    if (!f->buffer || f->buffer_size != buffer_size)
+    {
+        void *buf = realloc(f->buffer, buffer_size);
+        if (!buf)
+            return -1;
+        f->buffer = buf;
+        f->buffer_size = buffer_size;
+    }
+
+    f->stream_mode = mode;
+    return 0;
+}
+
+static int64_t file_size_uncached(const char *path)
+{
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+        return -1;
+
+    return (int64_t)(((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow);
+#else
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return -1;
+
+    return (int64_t)st.st_size;
+#endif
+}
+
+int64_t fossil_io_filesys_file_size64(const char *path)
+{
+    if (!path)
+        return -1;
+
+    return fossil_cache_query(path, CACHE_SIZE, file_size_uncached);
+}
+
+int32_t fossil_io_filesys_file_size(const char *path)
+{
+    int64_t size = fossil_io_filesys_file_size64(path);
+
+    /* refuse rather than wrap: callers size buffers from this */
+    if (size > INT32_MAX)
+        return -1;
+    return (int32_t)size;
+}
+
+int32_t fossil_io_filesys_file_truncate(const char *path, size_t size)
+{
+    if (!path)
+        return -1;
+
+#if defined(_WIN32)
+    HANDLE h = CreateFileA(path, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return -1;
+
+    LARGE_INTEGER li;
+    li.QuadPart = size;
+
+    if (!SetFilePointerEx(h, li, NULL, FILE_BEGIN) ||
+        !SetEndOfFile(h))
+    {
+        CloseHandle(h);
+        return -1;
+    }
+
+    CloseHandle(h);
+    fossil_cache_forget(path, false);
+    return 0;
+#else
+    int32_t rc = truncate(path, size);
+    fossil_cache_forget(path, false);
+    return rc;
+#endif
+}
+
+int32_t fossil_io_filesys_file_hash(
+    const char *path,
+    unsigned char *hash_out,
+    size_t hash_size,
+    const char *algorithm)
+{
+    if (!path || !hash_out || !algorithm)
+        return -1;
+
+    return fossil_io_filesys_file_hash_ex(path, algorithm, hash_out, hash_size, NULL);
+}
+
+int32_t fossil_io_filesys_file_merge(
+    const char *src1,
+    const char *src2,
+    const char *dest,
+    uint32_t strategy)
+{
+    FILE *a = fopen(src1, "rb");
+    FILE *b = fopen(src2, "rb");
+    FILE *out = fopen(dest, "wb");
+
+    if (!a || !b || !out)
+        return -1;
+
+    char buf1[4096], buf2[4096];
+
+    if (strategy == FOSSIL_MERGE_CONCAT)
+    {
+        size_t n;
+        while ((n = fread(buf1, 1, sizeof(buf1), a)) > 0)
+            fwrite(buf1, 1, n, out);
+
+        while ((n = fread(buf2, 1, sizeof(buf2), b)) > 0)
+            fwrite(buf2, 1, n, out);
+    }
+    else if (strategy == FOSSIL_MERGE_INTERLEAVE)
+    {
+        size_t n1, n2;
+        do
+        {
+            n1 = fread(buf1, 1, sizeof(buf1), a);
+            if (n1)
+                fwrite(buf1, 1, n1, out);
+
+            n2 = fread(buf2, 1, sizeof(buf2), b);
+            if (n2)
+                fwrite(buf2, 1, n2, out);
+
+        } while (n1 || n2);
+    }
+
+    fclose(a);
+    fclose(b);
+    fclose(out);
+    fossil_cache_forget(dest, false);
+    return 0;
+}
+
+/* Parallel Split and Join */
+
+#define SPLIT_MANIFEST_HEADER "fossil-split-manifest 1\n"
+
+typedef struct
+{
+    char path[FOSSIL_FILESYS_MAX_PATH];
+    uint64_t offset; /* position in the whole file */
+    uint64_t size;
+    unsigned char digest[32];
+} split_part_t;
+
+typedef struct
+{
+    fossil_native_t whole; /* source when splitting, destination when joining */
+    bool joining;
+    split_part_t *parts;
+    size_t count;
+    const hash_algo_t *algo; /* NULL: copy only */
+    atomic_size_t cursor;
+    atomic_int failed;
+} split_job_t;
+
+/* Preallocate where the filesystem supports it; always leaves the file at size. */
+static int fossil_native_preallocate(fossil_native_t h, uint64_t size)
+{
+#if defined(_WIN32)
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = (LONGLONG)size;
+    SetFileInformationByHandle(h, FileAllocationInfo, &info, sizeof(info));
+#elif defined(__linux__)
+    if (size > 0 && fallocate(h, 0, 0, (off_t)size) == 0)
+        return 0;
+#endif
+    return fossil_native_resize(h, size);
+}
+
+/*
+ * Copy one part while hashing it. Holes in the input are hashed as the zeros
+ * they read as but not written, so sparse ranges stay sparse.
+ */
+static int split_copy_hashed(fossil_native_t in, uint64_t in_off, fossil_native_t out, uint64_t out_off,
+                             uint64_t len, unsigned char *buf, const hash_algo_t *algo, void *state)
+{
+    uint64_t end = in_off + len, data, data_end;
+
+    for (uint64_t pos = in_off; pos < end; pos = data_end)
+    {
+        if (!fossil_native_next_data(in, pos, end, &data, &data_end))
+            data = data_end = end;
+
+        if (data > pos)
+        {
+            memset(buf, 0, FOSSIL_COPY_BUFFER_SIZE);
+            for (uint64_t z = data - pos; z > 0;)
+            {
+                size_t n = (z > FOSSIL_COPY_BUFFER_SIZE) ? FOSSIL_COPY_BUFFER_SIZE : (size_t)z;
+                algo->update(state, buf, n);
+                z -= n;
+            }
+        }
+
+        for (uint64_t at = data; at < data_end;)
+        {
+            size_t want = (data_end - at > FOSSIL_COPY_BUFFER_SIZE) ? FOSSIL_COPY_BUFFER_SIZE : (size_t)(data_end - at);
+            int64_t n = fossil_native_pread(in, buf, want, at);
+            if (n <= 0)
+                return -1;
+            algo->update(state, buf, (size_t)n);
+            if (file_transfer_at(out, buf, (size_t)n, out_off + (at - in_off), true) != n)
+                return -1;
+            at += (uint64_t)n;
+        }
+    }
+    return 0;
+}
+
+static void split_worker(void *arg, size_t index)
+{
+    split_job_t *job = (split_job_t *)arg;
+    unsigned char *buf = malloc(FOSSIL_COPY_BUFFER_SIZE);
+    (void)index;
+
+    if (!buf)
+        atomic_store(&job->failed, 1);
+
+    while (!atomic_load(&job->failed))
+    {
+        size_t i = atomic_fetch_add(&job->cursor, 1);
+        if (i >= job->count)
+            break;
+
+        split_part_t *p = &job->parts[i];
+        fossil_native_t part = fossil_native_open(p->path, !job->joining);
+        if (part == FOSSIL_NATIVE_INVALID)
+        {
+            atomic_store(&job->failed, 1);
+            break;
+        }
+
+        fossil_native_t in = job->joining ? part : job->whole;
+        fossil_native_t out = job->joining ? job->whole : part;
+        uint64_t in_off = job->joining ? 0 : p->offset;
+        uint64_t out_off = job->joining ? p->offset : 0;
+
+        /* parts are sized first so holes in the source stay holes */
+        int rc = job->joining ? 0 : fossil_native_resize(part, p->size);
+        if (rc == 0 && job->algo)
+        {
+            hash_state_t state;
+            unsigned char digest[32];
+            job->algo->init(&state);
+            rc = split_copy_hashed(in, in_off, out, out_off, p->size, buf, job->algo, &state);
+            if (rc == 0)
+            {
+                job->algo->final(&state, digest);
+                if (!job->joining)
+                    memcpy(p->digest, digest, job->algo->digest_size);
+                else if (memcmp(p->digest, digest, job->algo->digest_size) != 0)
+                    rc = -1; /* part does not match its manifest entry */
+            }
+        }
+        else if (rc == 0)
+        {
+            rc = fossil_native_copy_range(in, in_off, out, out_off, p->size, buf, FOSSIL_COPY_BUFFER_SIZE);
+        }
+
+        fossil_native_close(part);
+        if (rc != 0)
+            atomic_store(&job->failed, 1);
+    }
+
+    free(buf);
+}
+
+static int split_run(split_job_t *job, size_t threads)
+{
+    if (threads == 0)
+        threads = fossil_cpu_count();
+    atomic_init(&job->cursor, 0);
+    atomic_init(&job->failed, 0);
+    if (job->count > 0)
+        fossil_run_workers(threads < job->count ? threads : job->count, split_worker, job);
+    return atomic_load(&job->failed) ? -1 : 0;
+}
+
+static int split_manifest_save(const char *path, const split_job_t *job, uint64_t total, uint64_t part_size)
+{
+    char tmp[FOSSIL_FILESYS_MAX_PATH];
+    int n = snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (n < 0 || (size_t)n >= sizeof(tmp))
+        return -1;
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f)
+        return -1;
+
+    bool ok = fprintf(f, "%s%s %llu %llu %llu\n", SPLIT_MANIFEST_HEADER, job->algo->name,
+                      (unsigned long long)total, (unsigned long long)part_size, (unsigned long long)job->count) > 0;
+    for (size_t i = 0; ok && i < job->count; ++i)
+    {
+        const split_part_t *p = &job->parts[i];
+        const char *name = strrchr(p->path, '/');
+#if defined(_WIN32)
+        const char *bs = strrchr(p->path, '\\');
+        if (bs && (!name || bs > name))
+            name = bs;
+#endif
+        name = name ? name + 1 : p->path;
+
+        char hex[65];
+        for (size_t k = 0; k < job->algo->digest_size; ++k)
+            snprintf(hex + 2 * k, 3, "%02x", p->digest[k]);
+        ok = fprintf(f, "%llu %s %s\n", (unsigned long long)p->size, hex, name) > 0;
+    }
+    ok = (fflush(f) == 0) && ok;
+    if (fclose(f) != 0)
+        ok = false;
+
+#if defined(_WIN32)
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tmp, path) == 0;
+#endif
+    if (!ok)
+        remove(tmp);
+    return ok ? 0 : -1;
+}
+
+/* Parse a manifest into job->parts; part names resolve beside the manifest. */
+static int split_manifest_load(const char *path, split_job_t *job, uint64_t *total)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return -1;
+
+    char line[FOSSIL_FILESYS_MAX_PATH + 128];
+    char name[64];
+    unsigned long long tot, part_size, count;
+    int rc = -1;
+
+    if (!fgets(line, sizeof(line), f) || strcmp(line, SPLIT_MANIFEST_HEADER) != 0 ||
+        !fgets(line, sizeof(line), f) || sscanf(line, "%63s %llu %llu %llu", name, &tot, &part_size, &count) != 4 ||
+        !(job->algo = hash_find(name)) || count > tot / (part_size ? part_size : 1) + 1 ||
+        !(job->parts = calloc(count ? (size_t)count : 1, sizeof(*job->parts))))
+    {
+        fclose(f);
+        return -1;
+    }
+
+    size_t dir_len = 0;
+    for (size_t k = 0; path[k]; ++k)
+        if (path[k] == '/' || path[k] == '\\')
+            dir_len = k + 1;
+
+    uint64_t offset = 0;
+    job->count = 0;
+    while (job->count < count && fgets(line, sizeof(line), f))
+    {
+        split_part_t *p = &job->parts[job->count];
+        char *s = line, *hex;
+        p->size = strtoull(s, &s, 10);
+        if (*s != ' ')
+            break;
+        hex = s + 1;
+        s = strchr(hex, ' ');
+        if (!s || (size_t)(s - hex) != 2 * job->algo->digest_size)
+            break;
+        for (size_t k = 0; k < job->algo->digest_size; ++k)
+        {
+            char byte[3] = {hex[2 * k], hex[2 * k + 1], '\0'};
+            p->digest[k] = (unsigned char)strtoul(byte, NULL, 16);
+        }
+        s[strcspn(s, "\r\n")] = '\0';
+        int n = snprintf(p->path, sizeof(p->path), "%.*s%s", (int)dir_len, path, s + 1);
+        if (n < 0 || (size_t)n >= sizeof(p->path))
+            break;
+        p->offset = offset;
+        offset += p->size;
+        job->count++;
+    }
+    fclose(f);
+
+    if (job->count == count && offset == tot)
+        rc = 0;
+    *total = tot;
+    return rc;
+}
+
+static int64_t split_file(const char *path, uint64_t part_size, const char *prefix,
+                          const fossil_io_filesys_split_opts_t *opts, bool manifest)
+{
+    if (!path || !prefix || part_size == 0)
+        return -1;
+
+    split_job_t job;
+    memset(&job, 0, sizeof(job));
+    if (manifest)
+    {
+        job.algo = hash_find((opts && opts->algorithm) ? opts->algorithm : "xxh64");
+        if (!job.algo)
+            return -1;
+    }
+
+    job.whole = fossil_native_open(path, false);
+    if (job.whole == FOSSIL_NATIVE_INVALID)
+        return -1;
+
+    int64_t total = fossil_native_size(job.whole);
+    uint64_t count = (total > 0) ? ((uint64_t)total + part_size - 1) / part_size : 0;
+    if (total < 0 || count > SIZE_MAX / sizeof(split_part_t) ||
+        !(job.parts = calloc(count ? (size_t)count : 1, sizeof(*job.parts))))
+    {
+        fossil_native_close(job.whole);
+        return -1;
+    }
+    job.count = (size_t)count;
+
+    int rc = 0;
+    for (size_t i = 0; i < job.count && rc == 0; ++i)
+    {
+        split_part_t *p = &job.parts[i];
+        int n = snprintf(p->path, sizeof(p->path), "%s.part%03llu", prefix, (unsigned long long)i);
+        p->offset = (uint64_t)i * part_size;
+        p->size = ((uint64_t)total - p->offset < part_size) ? (uint64_t)total - p->offset : part_size;
+        if (n < 0 || (size_t)n >= sizeof(p->path))
+            rc = -1;
+    }
+
+    if (rc == 0)
+        rc = split_run(&job, opts ? opts->threads : 0);
+    fossil_native_close(job.whole);
+    for (size_t i = 0; i < job.count; ++i)
+        fossil_cache_forget(job.parts[i].path, false);
+
+    if (rc == 0 && manifest)
+    {
+        char mpath[FOSSIL_FILESYS_MAX_PATH];
+        int n = snprintf(mpath, sizeof(mpath), "%s.manifest", prefix);
+        rc = (n < 0 || (size_t)n >= sizeof(mpath)) ? -1 : split_manifest_save(mpath, &job, (uint64_t)total, part_size);
+        fossil_cache_forget(mpath, false);
+    }
+
+    free(job.parts);
+    return (rc == 0) ? (int64_t)count : -1;
+}
+
+static int32_t join_file(split_job_t *job, uint64_t total, const char *dest, size_t threads, bool preallocate)
+{
+    job->joining = true;
+    job->whole = fossil_native_open(dest, true);
+    if (job->whole == FOSSIL_NATIVE_INVALID)
+        return -1;
+
+    int rc = preallocate ? fossil_native_preallocate(job->whole, total) : fossil_native_resize(job->whole, total);
+    if (rc == 0)
+        rc = split_run(job, threads);
+
+    fossil_native_close(job->whole);
+    if (rc != 0)
+        remove(dest);
+    fossil_cache_forget(dest, false);
+    return rc;
+}
+
+int64_t fossil_io_filesys_file_split64(
+    const char *path,
+    uint64_t part_size,
+    const char *prefix)
+{
+    return split_file(path, part_size, prefix, NULL, false);
+}
+
+int64_t fossil_io_filesys_file_split_ex(
+    const char *path,
+    uint64_t part_size,
+    const char *prefix,
+    const fossil_io_filesys_split_opts_t *opts)
+{
+    return split_file(path, part_size, prefix, opts, true);
+}
+
+int32_t fossil_io_filesys_file_split(
+    const char *path,
+    size_t part_size,
+    const char *prefix)
+{
+    int64_t parts = fossil_io_filesys_file_split64(path, (uint64_t)part_size, prefix);
+    if (parts > INT32_MAX)
+        return -1;
+    return (int32_t)parts;
+}
+
+int32_t fossil_io_filesys_file_join(
+    const char **parts,
+    size_t count,
+    const char *dest)
+{
+    if (!parts || count == 0 || !dest)
+        return -1;
+
+    split_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.parts = calloc(count, sizeof(*job.parts));
+    job.count = count;
+    if (!job.parts)
+        return -1;
+
+    uint64_t total = 0;
+    int32_t rc = 0;
+    for (size_t i = 0; i < count && rc == 0; ++i)
+    {
+        int64_t size = parts[i] ? file_size_uncached(parts[i]) : -1;
+        int n = parts[i] ? snprintf(job.parts[i].path, sizeof(job.parts[i].path), "%s", parts[i]) : -1;
+        if (size < 0 || n < 0 || (size_t)n >= sizeof(job.parts[i].path))
+            rc = -1;
+        job.parts[i].offset = total;
+        job.parts[i].size = (uint64_t)size;
+        total += (uint64_t)size;
+    }
+
+    if (rc == 0)
+        rc = join_file(&job, total, dest, 0, false);
+    free(job.parts);
+    return rc;
+}
+
+int32_t fossil_io_filesys_file_join_manifest(
+    const char *manifest,
+    const char *dest,
+    const fossil_io_filesys_split_opts_t *opts)
+{
+    if (!manifest || !dest)
+        return -1;
+
+    split_job_t job;
+    uint64_t total = 0;
+    memset(&job, 0, sizeof(job));
+    int32_t rc = split_manifest_load(manifest, &job, &total);
+
+    /* a missing or resized part fails before anything is written */
+    for (size_t i = 0; i < job.count && rc == 0; ++i)
+        if (file_size_uncached(job.parts[i].path) != (int64_t)job.parts[i].size)
+            rc = -1;
+
+    if (rc == 0)
+        rc = join_file(&job, total, dest, opts ? opts->threads : 0, true);
+    free(job.parts);
+    return rc;
+}
+
+/* Compression Codecs */
+
+/*
+ * Block codecs behind file_compress. Everything except "rle" writes a framed
+ * file: a header, independently compressed blocks, then an index of
+ * (offset, sizes, crc32c) per block and a trailer. Blocks compress and
+ * decompress in parallel, and any byte range can be recovered by decoding
+ * only the blocks that cover it. "rle" keeps its original count/value
+ * stream so existing files still decode.
+ */
+
+#define FOSSIL_CODEC_BLOCK ((uint32_t)1024 * 1024)
+#define FOSSIL_CODEC_MAX_BLOCK ((uint32_t)64 * 1024 * 1024)
+#define FOSSIL_CODEC_HEADER 16
+#define FOSSIL_CODEC_ENTRY 24
+#define FOSSIL_CODEC_TRAILER 32
+#define FOSSIL_CODEC_STORED 1u
+
+static const unsigned char codec_magic[4] = {'F', 'O', 'S', 'Z'};
+static const unsigned char codec_tail_magic[8] = {'F', 'O', 'S', 'Z', 'I', 'D', 'X', '1'};
+
+/* -- LZ4 block format -- */
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MFLIMIT 12
+#define LZ4_HASH_BITS 16
+#define LZ4_MAX_OFFSET 65535
+
+static size_t lz4_bound(size_t n)
+{
+    return n + n / 255 + 16;
+}
+
+static inline uint32_t lz4_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+static unsigned char *lz4_put_length(unsigned char *op, size_t len)
+{
+    while (len >= 255)
+    {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+static unsigned char *lz4_put_literals(unsigned char *op, const unsigned char *lit, size_t len, unsigned char **token)
+{
+    *token = op++;
+    **token = (unsigned char)((len >= 15 ? 15 : len) << 4);
+    if (len >= 15)
+        op = lz4_put_length(op, len - 15);
+    memcpy(op, lit, len);
+    return op + len;
+}
+
+/* Greedy single-probe matcher; skips ahead faster through incompressible runs. */
+static int64_t lz4_compress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap)
+{
+    if (cap < lz4_bound(n))
+        return -1;
+
+    uint32_t *table = calloc((size_t)1 << LZ4_HASH_BITS, sizeof(uint32_t));
+    if (!table)
+        return -1;
+
+    const unsigned char *ip = src, *anchor = src, *end = src + n;
+    unsigned char *op = dst, *token;
+
+    if (n > LZ4_MFLIMIT)
+    {
+        const unsigned char *mflimit = end - LZ4_MFLIMIT;
+        const unsigned char *matchlimit = end - LZ4_LAST_LITERALS;
+
+        while (ip < mflimit)
+        {
+            uint32_t seq = hash_read32le(ip);
+            uint32_t h = lz4_hash(seq);
+            const unsigned char *cand = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+
+            if (cand >= ip || ip - cand > LZ4_MAX_OFFSET || hash_read32le(cand) != seq)
+            {
+                ip += 1 + ((size_t)(ip - anchor) >> 6);
+                continue;
+            }
+
+            while (ip > anchor && cand > src && ip[-1] == cand[-1])
+            {
+                ip--;
+                cand--;
+            }
+            const unsigned char *mp = ip + LZ4_MIN_MATCH, *cp = cand + LZ4_MIN_MATCH;
+            while (mp < matchlimit && *mp == *cp)
+            {
+                mp++;
+                cp++;
+            }
+
+            size_t offset = (size_t)(ip - cand);
+            size_t mlen = (size_t)(mp - ip) - LZ4_MIN_MATCH;
+            op = lz4_put_literals(op, anchor, (size_t)(ip - anchor), &token);
+            *op++ = (unsigned char)(offset & 0xFF);
+            *op++ = (unsigned char)(offset >> 8);
+            *token |= (unsigned char)(mlen >= 15 ? 15 : mlen);
+            if (mlen >= 15)
+                op = lz4_put_length(op, mlen - 15);
+
+            ip = anchor = mp;
+            if (ip < mflimit)
+                table[lz4_hash(hash_read32le(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+
+    op = lz4_put_literals(op, anchor, (size_t)(end - anchor), &token);
+    free(table);
+    return (int64_t)(op - dst);
+}
+
+static int lz4_get_length(const unsigned char **ip, const unsigned char *iend, size_t *len)
+{
+    unsigned int b;
+    do
+    {
+        if (*ip >= iend)
+            return -1;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+/* Bounds-checked decoder; the output must come out exactly out_len bytes. */
+static int lz4_decompress(const unsigned char *src, size_t n, unsigned char *dst, size_t out_len)
+{
+    const unsigned char *ip = src, *iend = src + n;
+    unsigned char *op = dst, *oend = dst + out_len;
+
+    while (ip < iend)
+    {
+        unsigned int token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15 && lz4_get_length(&ip, iend, &lit) != 0)
+            return -1;
+        if ((size_t)(iend - ip) < lit || (size_t)(oend - op) < lit)
+            return -1;
+        memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == iend)
+            break; /* the final sequence carries literals only */
+
+        if (iend - ip < 2)
+            return -1;
+        size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+            return -1;
+
+        size_t mlen = token & 15;
+        if (mlen == 15 && lz4_get_length(&ip, iend, &mlen) != 0)
+            return -1;
+        mlen += LZ4_MIN_MATCH;
+        if ((size_t)(oend - op) < mlen)
+            return -1;
+
+        const unsigned char *m = op - offset;
+        if (offset >= mlen)
+            memcpy(op, m, mlen);
+        else
+            for (size_t i = 0; i < mlen; ++i) /* overlapping copy repeats the pattern */
+                op[i] = m[i];
+        op += mlen;
+    }
+
+    return op == oend ? 0 : -1;
+}
+
+#if defined(FOSSIL_IO_HAVE_ZLIB)
+static size_t deflate_bound(size_t n)
+{
+    return (size_t)compressBound((uLong)n);
+}
+
+static int64_t deflate_compress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap)
+{
+    uLongf out = (uLongf)cap;
+    return compress2(dst, &out, src, (uLong)n, Z_DEFAULT_COMPRESSION) == Z_OK ? (int64_t)out : -1;
+}
+
+static int deflate_decompress(const unsigned char *src, size_t n, unsigned char *dst, size_t out_len)
+{
+    uLongf out = (uLongf)out_len;
+    return (uncompress(dst, &out, src, (uLong)n) == Z_OK && out == out_len) ? 0 : -1;
+}
+#endif
+
+#if defined(FOSSIL_IO_HAVE_ZSTD)
+static size_t zstd_bound(size_t n)
+{
+    return ZSTD_compressBound(n);
+}
+
+static int64_t zstd_compress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap)
+{
+    size_t out = ZSTD_compress(dst, cap, src, n, 3);
+    return ZSTD_isError(out) ? -1 : (int64_t)out;
+}
+
+static int zstd_decompress(const unsigned char *src, size_t n, unsigned char *dst, size_t out_len)
+{
+    size_t out = ZSTD_decompress(dst, out_len, src, n);
+    return (!ZSTD_isError(out) && out == out_len) ? 0 : -1;
+}
+#endif
+
+typedef struct
+{
+    const char *name;
+    uint8_t id; /* stored in the frame header; never reuse a value */
+    size_t (*bound)(size_t n);
+    int64_t (*compress)(const unsigned char *src, size_t n, unsigned char *dst, size_t cap);
+    int (*decompress)(const unsigned char *src, size_t n, unsigned char *dst, size_t out_len);
+} fossil_codec_t;
+
+static const fossil_codec_t fossil_codecs[] = {
+    {"lz4", 1, lz4_bound, lz4_compress, lz4_decompress},
+#if defined(FOSSIL_IO_HAVE_ZLIB)
+    {"deflate", 2, deflate_bound, deflate_compress, deflate_decompress},
+#endif
+#if defined(FOSSIL_IO_HAVE_ZSTD)
+    {"zstd", 3, zstd_bound, zstd_compress, zstd_decompress},
+#endif
+};
+
+static const fossil_codec_t *codec_by_name(const char *name)
+{
+    for (size_t i = 0; i < sizeof(fossil_codecs) / sizeof(fossil_codecs[0]); ++i)
+        if (strcmp(fossil_codecs[i].name, name) == 0)
+            return &fossil_codecs[i];
+    return NULL;
+}
+
+static const fossil_codec_t *codec_by_id(uint8_t id)
+{
+    for (size_t i = 0; i < sizeof(fossil_codecs) / sizeof(fossil_codecs[0]); ++i)
+        if (fossil_codecs[i].id == id)
+            return &fossil_codecs[i];
+    return NULL;
+}
+
+int32_t fossil_io_filesys_codec_available(const char *algorithm)
+{
+    if (!algorithm)
+        return 0;
+    return (strcmp(algorithm, "rle") == 0 || codec_by_name(algorithm)) ? 1 : 0;
+}
+
+static uint32_t codec_crc(const unsigned char *p, size_t len)
+{
+    hash_crc32c_t s;
+    hash_crc32c_init(&s);
+    hash_crc32c_update(&s, p, len);
+    return ~s.crc;
+}
+
+static void codec_put32(unsigned char *p, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void codec_put64(unsigned char *p, uint64_t v)
+{
+    codec_put32(p, (uint32_t)v);
+    codec_put32(p + 4, (uint32_t)(v >> 32));
+}
+
+typedef struct
+{
+    uint64_t offset;
+    uint32_t csize;
+    uint32_t usize;
+    uint32_t crc;
+    uint32_t flags;
+} codec_entry_t;
+
+static void codec_put_entry(unsigned char *p, const codec_entry_t *e)
+{
+    codec_put64(p, e->offset);
+    codec_put32(p + 8, e->csize);
+    codec_put32(p + 12, e->usize);
+    codec_put32(p + 16, e->crc);
+    codec_put32(p + 20, e->flags);
+}
+
+static void codec_get_entry(const unsigned char *p, codec_entry_t *e)
+{
+    e->offset = hash_read64le(p);
+    e->csize = hash_read32le(p + 8);
+    e->usize = hash_read32le(p + 12);
+    e->crc = hash_read32le(p + 16);
+    e->flags = hash_read32le(p + 20);
+}
+
+/* One batch of blocks, compressed by the worker pool. */
+typedef struct
+{
+    const fossil_codec_t *codec;
+    const unsigned char *in;
+    uint64_t in_len;
+    uint32_t block_size;
+    size_t blocks;
+    unsigned char **out;
+    codec_entry_t *entries;
+    atomic_size_t cursor;
+    atomic_int failed;
+} codec_batch_t;
+
+static void codec_compress_worker(void *arg, size_t index)
+{
+    codec_batch_t *b = (codec_batch_t *)arg;
+    (void)index;
+
+    for (;;)
+    {
+        size_t i = atomic_fetch_add(&b->cursor, 1);
+        if (i >= b->blocks)
+            break;
+
+        const unsigned char *src = b->in + (uint64_t)i * b->block_size;
+        uint64_t left = b->in_len - (uint64_t)i * b->block_size;
+        size_t len = left < b->block_size ? (size_t)left : b->block_size;
+        codec_entry_t *e = &b->entries[i];
+
+        e->usize = (uint32_t)len;
+        e->crc = codec_crc(src, len);
+        int64_t n = b->codec->compress(src, len, b->out[i], b->codec->bound(b->block_size));
+        if (n < 0)
+        {
+            atomic_store(&b->failed, 1);
+            break;
+        }
+        if ((uint64_t)n >= len)
+        {
+            /* incompressible: keep the raw bytes */
+            memcpy(b->out[i], src, len);
+            e->csize = (uint32_t)len;
+            e->flags = FOSSIL_CODEC_STORED;
+        }
+        else
+        {
+            e->csize = (uint32_t)n;
+            e->flags = 0;
+        }
+    }
+}
+
+static int32_t codec_compress_file(const char *src, const char *dest, const fossil_codec_t *codec)
+{
+    fossil_native_t in = fossil_native_open(src, false);
+    if (in == FOSSIL_NATIVE_INVALID)
+        return -1;
+    int64_t total = fossil_native_size(in);
+    fossil_native_t out = (total >= 0) ? fossil_native_open(dest, true) : FOSSIL_NATIVE_INVALID;
+    if (out == FOSSIL_NATIVE_INVALID)
+    {
+        fossil_native_close(in);
+        return -1;
+    }
+
+    const uint32_t bs = FOSSIL_CODEC_BLOCK;
+    size_t threads = fossil_cpu_count();
+    size_t batch = threads * 2 < 64 ? threads * 2 : 64; /* bounds memory to ~2 x 64 MiB */
+    uint64_t block_count = ((uint64_t)total + bs - 1) / bs;
+    size_t bound = codec->bound(bs);
+
+    unsigned char *inbuf = malloc((size_t)bs * batch);
+    unsigned char *outbuf = malloc(bound * batch);
+    unsigned char **outs = calloc(batch, sizeof(*outs));
+    codec_entry_t *entries = calloc(block_count ? (size_t)block_count : 1, sizeof(*entries));
+    unsigned char *index = malloc((size_t)(block_count ? block_count : 1) * FOSSIL_CODEC_ENTRY);
+    int32_t rc = (inbuf && outbuf && outs && entries && index) ? 0 : -1;
+
+    unsigned char header[FOSSIL_CODEC_HEADER] = {0};
+    memcpy(header, codec_magic, 4);
+    header[4] = 1; /* format version */
+    header[5] = codec->id;
+    codec_put32(header + 8, bs);
+    uint64_t pos = FOSSIL_CODEC_HEADER;
+    if (rc == 0 && file_transfer_at(out, header, sizeof(header), 0, true) != (int64_t)sizeof(header))
+        rc = -1;
+
+    for (uint64_t first = 0; rc == 0 && first < block_count; first += batch)
+    {
+        codec_batch_t b;
+        b.codec = codec;
+        b.in = inbuf;
+        b.block_size = bs;
+        b.blocks = (block_count - first < batch) ? (size_t)(block_count - first) : batch;
+        b.in_len = (uint64_t)total - first * bs;
+        if (b.in_len > (uint64_t)bs * b.blocks)
+            b.in_len = (uint64_t)bs * b.blocks;
+        b.out = outs;
+        b.entries = entries + first;
+        atomic_init(&b.cursor, 0);
+        atomic_init(&b.failed, 0);
+        for (size_t i = 0; i < b.blocks; ++i)
+            outs[i] = outbuf + i * bound;
+
+        if (file_transfer_at(in, inbuf, (size_t)b.in_len, first * bs, false) != (int64_t)b.in_len)
+        {
+            rc = -1;
+            break;
+        }
+        fossil_run_workers(threads < b.blocks ? threads : b.blocks, codec_compress_worker, &b);
+        if (atomic_load(&b.failed))
+        {
+            rc = -1;
+            break;
+        }
+
+        for (size_t i = 0; i < b.blocks && rc == 0; ++i)
+        {
+            b.entries[i].offset = pos;
+            if (file_transfer_at(out, outs[i], b.entries[i].csize, pos, true) != (int64_t)b.entries[i].csize)
+                rc = -1;
+            pos += b.entries[i].csize;
+        }
+    }
+
+    if (rc == 0)
+    {
+        unsigned char trailer[FOSSIL_CODEC_TRAILER];
+        size_t index_len = (size_t)block_count * FOSSIL_CODEC_ENTRY;
+        for (uint64_t i = 0; i < block_count; ++i)
+            codec_put_entry(index + i * FOSSIL_CODEC_ENTRY, &entries[i]);
+        codec_put64(trailer, (uint64_t)total);
+        codec_put64(trailer + 8, pos);
+        codec_put64(trailer + 16, block_count);
+        memcpy(trailer + 24, codec_tail_magic, 8);
+        if (file_transfer_at(out, index, index_len, pos, true) != (int64_t)index_len ||
+            file_transfer_at(out, trailer, sizeof(trailer), pos + index_len, true) != (int64_t)sizeof(trailer))
+            rc = -1;
+    }
+
+    free(index);
+    free(entries);
+    free(outs);
+    free(outbuf);
+    free(inbuf);
+    fossil_native_close(out);
+    fossil_native_close(in);
+    if (rc != 0)
+        remove(dest);
+    fossil_cache_forget(dest, false);
+    return rc;
+}
+
+/* An opened, validated frame: enough to locate and decode any block. */
+typedef struct
+{
+    fossil_native_t h;
+    const fossil_codec_t *codec;
+    uint32_t block_size;
+    uint64_t total;
+    uint64_t index_offset;
+    uint64_t blocks;
+} codec_frame_t;
+
+/* Returns 0 for a frame, 1 for something else (legacy RLE), -1 on error. */
+static int codec_frame_open(const char *path, codec_frame_t *fr)
+{
+    fr->h = fossil_native_open(path, false);
+    if (fr->h == FOSSIL_NATIVE_INVALID)
+        return -1;
+
+    unsigned char header[FOSSIL_CODEC_HEADER], trailer[FOSSIL_CODEC_TRAILER];
+    int64_t size = fossil_native_size(fr->h);
+    if (size < FOSSIL_CODEC_HEADER + FOSSIL_CODEC_TRAILER ||
+        file_transfer_at(fr->h, header, sizeof(header), 0, false) != (int64_t)sizeof(header) ||
+        file_transfer_at(fr->h, trailer, sizeof(trailer), (uint64_t)size - FOSSIL_CODEC_TRAILER, false) !=
+            (int64_t)sizeof(trailer) ||
+        memcmp(header, codec_magic, 4) != 0 || memcmp(trailer + 24, codec_tail_magic, 8) != 0)
+    {
+        fossil_native_close(fr->h);
+        return size < 0 ? -1 : 1;
+    }
+
+    fr->codec = codec_by_id(header[5]);
+    fr->block_size = hash_read32le(header + 8);
+    fr->total = hash_read64le(trailer);
+    fr->index_offset = hash_read64le(trailer + 8);
+    fr->blocks = hash_read64le(trailer + 16);
+
+    bool valid = header[4] == 1 && fr->codec && fr->block_size > 0 && fr->block_size <= FOSSIL_CODEC_MAX_BLOCK &&
+                 fr->blocks == (fr->total + fr->block_size - 1) / fr->block_size &&
+                 fr->blocks <= ((uint64_t)size - FOSSIL_CODEC_TRAILER) / FOSSIL_CODEC_ENTRY &&
+                 fr->index_offset + fr->blocks * FOSSIL_CODEC_ENTRY == (uint64_t)size - FOSSIL_CODEC_TRAILER;
+    if (!valid)
+    {
+        fossil_native_close(fr->h);
+        return -1;
+    }
+    return 0;
+}
+
+/* Decode block i of a frame into out (block_size bytes); returns its length or -1. */
+static int64_t codec_frame_block(const codec_frame_t *fr, uint64_t i, unsigned char *scratch, unsigned char *out)
+{
+    unsigned char raw[FOSSIL_CODEC_ENTRY];
+    codec_entry_t e;
+    if (file_transfer_at(fr->h, raw, sizeof(raw), fr->index_offset + i * FOSSIL_CODEC_ENTRY, false) !=
+        (int64_t)sizeof(raw))
+        return -1;
+    codec_get_entry(raw, &e);
+
+    uint64_t expect = fr->total - i * fr->block_size;
+    if (expect > fr->block_size)
+        expect = fr->block_size;
+    if (e.usize != expect || e.csize > fr->codec->bound(fr->block_size) ||
+        e.offset + e.csize > fr->index_offset)
+        return -1;
+
+    if (e.flags & FOSSIL_CODEC_STORED)
+    {
+        if (e.csize != e.usize || file_transfer_at(fr->h, out, e.csize, e.offset, false) != (int64_t)e.csize)
+            return -1;
+    }
+    else if (file_transfer_at(fr->h, scratch, e.csize, e.offset, false) != (int64_t)e.csize ||
+             fr->codec->decompress(scratch, e.csize, out, e.usize) != 0)
+        return -1;
+
+    return codec_crc(out, e.usize) == e.crc ? (int64_t)e.usize : -1;
+}
+
+typedef struct
+{
+    const codec_frame_t *frame;
+    fossil_native_t out;
+    atomic_uint_fast64_t cursor;
+    atomic_int failed;
+} codec_expand_t;
+
+static void codec_decompress_worker(void *arg, size_t index)
+{
+    codec_expand_t *x = (codec_expand_t *)arg;
+    const codec_frame_t *fr = x->frame;
+    unsigned char *scratch = malloc(fr->codec->bound(fr->block_size));
+    unsigned char *block = malloc(fr->block_size);
+    (void)index;
+
+    if (!scratch || !block)
+        atomic_store(&x->failed, 1);
+
+    while (!atomic_load(&x->failed))
+    {
+        uint64_t i = atomic_fetch_add(&x->cursor, 1);
+        if (i >= fr->blocks)
+            break;
+        int64_t n = codec_frame_block(fr, i, scratch, block);
+        if (n < 0 || file_transfer_at(x->out, block, (size_t)n, i * fr->block_size, true) != n)
+            atomic_store(&x->failed, 1);
+    }
+
+    free(block);
+    free(scratch);
+}
+
+static int32_t codec_decompress_file(const codec_frame_t *fr, const char *dest)
+{
+    codec_expand_t x;
+    x.frame = fr;
+    x.out = fossil_native_open(dest, true);
+    if (x.out == FOSSIL_NATIVE_INVALID)
+        return -1;
+    atomic_init(&x.cursor, 0);
+    atomic_init(&x.failed, fossil_native_resize(x.out, fr->total) != 0);
+
+    size_t threads = fossil_cpu_count();
+    if (!atomic_load(&x.failed) && fr->blocks > 0)
+        fossil_run_workers(threads < fr->blocks ? threads : (size_t)fr->blocks, codec_decompress_worker, &x);
+
+    fossil_native_close(x.out);
+    bool failed = atomic_load(&x.failed) != 0;
+    if (failed)
+        remove(dest);
+    fossil_cache_forget(dest, false);
+    return failed ? -1 : 0;
+}
+
+int64_t fossil_io_filesys_file_decompress_range(const char *src, uint64_t offset, void *buf, size_t len)
+{
+    if (!src || (!buf && len > 0))
+        return -1;
+
+    codec_frame_t fr;
+    if (codec_frame_open(src, &fr) != 0)
+        return -1;
+
+    if (offset >= fr.total || len == 0)
+    {
+        fossil_native_close(fr.h);
+        return 0;
+    }
+    if (len > fr.total - offset)
+        len = (size_t)(fr.total - offset);
+
+    unsigned char *scratch = malloc(fr.codec->bound(fr.block_size));
+    unsigned char *block = malloc(fr.block_size);
+    int64_t done = (scratch && block) ? 0 : -1;
+
+    while (done >= 0 && (size_t)done < len)
+    {
+        uint64_t at = offset + (uint64_t)done;
+        uint64_t i = at / fr.block_size;
+        size_t skip = (size_t)(at - i * fr.block_size);
+        int64_t n = codec_frame_block(&fr, i, scratch, block);
+        if (n < 0)
+        {
+            done = -1;
+            break;
+        }
+        size_t take = (size_t)n - skip;
+        if (take > len - (size_t)done)
+            take = len - (size_t)done;
+        memcpy((unsigned char *)buf + done, block + skip, take);
+        done += (int64_t)take;
+    }
+
+    free(block);
+    free(scratch);
+    fossil_native_close(fr.h);
+    return done;
+}
+
+/* -- rle: (count, value) byte pairs, count 1..255 -- */
+
+static int32_t rle_compress_stream(FILE *in, FILE *out)
+{
+    unsigned char *ibuf = malloc(FOSSIL_COPY_BUFFER_SIZE);
+    unsigned char *obuf = malloc((size_t)FOSSIL_COPY_BUFFER_SIZE * 2 + 2);
+    int32_t rc = (ibuf && obuf) ? 0 : -1;
+    int prev = -1;
+    unsigned int count = 0;
+    size_t n;
+
+    while (rc == 0 && (n = fread(ibuf, 1, FOSSIL_COPY_BUFFER_SIZE, in)) > 0)
+    {
+        size_t o = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (ibuf[i] == prev && count < 255)
+            {
+                count++;
+                continue;
+            }
+            if (prev >= 0)
+            {
+                obuf[o++] = (unsigned char)count;
+                obuf[o++] = (unsigned char)prev;
+            }
+            prev = ibuf[i];
+            count = 1;
+        }
+        if (fwrite(obuf, 1, o, out) != o)
+            rc = -1;
+    }
+
+    if (rc == 0 && prev >= 0)
+    {
+        obuf[0] = (unsigned char)count;
+        obuf[1] = (unsigned char)prev;
+        if (fwrite(obuf, 1, 2, out) != 2)
+            rc = -1;
+    }
+    if (ferror(in))
+        rc = -1;
+
+    free(obuf);
+    free(ibuf);
+    return rc;
+}
+
+static int32_t rle_decompress_stream(FILE *in, FILE *out)
+{
+    unsigned char *ibuf = malloc(FOSSIL_COPY_BUFFER_SIZE);
+    unsigned char *obuf = malloc(FOSSIL_COPY_BUFFER_SIZE);
+    int32_t rc = (ibuf && obuf) ? 0 : -1;
+    int count = -1; /* a count byte carried over from the previous chunk */
+    size_t o = 0, n;
+
+    while (rc == 0 && (n = fread(ibuf, 1, FOSSIL_COPY_BUFFER_SIZE, in)) > 0)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (count < 0)
+            {
+                count = ibuf[i];
+                continue;
+            }
+            if (o + (size_t)count > FOSSIL_COPY_BUFFER_SIZE)
+            {
+                if (fwrite(obuf, 1, o, out) != o)
+                    rc = -1;
+                o = 0;
+            }
+            memset(obuf + o, ibuf[i], (size_t)count);
+            o += (size_t)count;
+            count = -1;
+        }
+    }
+
+    if (rc == 0 && fwrite(obuf, 1, o, out) != o)
+        rc = -1;
+    if (ferror(in))
+        rc = -1;
+
+    free(obuf);
+    free(ibuf);
+    return rc;
+}
+
+int32_t fossil_io_filesys_file_compress(
+    const char *src,
+    const char *dest,
+    const char *algorithm)
+{
+    if (!src || !dest)
+        return -1;
+
+    if (algorithm && strcmp(algorithm, "rle") != 0)
+    {
+        const fossil_codec_t *codec = codec_by_name(algorithm);
+        return codec ? codec_compress_file(src, dest, codec) : -1;
+    }
+
+    FILE *in = fopen(src, "rb");
+    FILE *out = in ? fopen(dest, "wb") : NULL;
+    if (!in || !out)
+    {
+        if (in)
+            fclose(in);
+        return -1;
+    }
+
+    int32_t rc = rle_compress_stream(in, out);
+    fclose(in);
+    if (fclose(out) != 0)
+        rc = -1;
+    fossil_cache_forget(dest, false);
+    return rc;
+}
+
+int32_t fossil_io_filesys_file_decompress(
+    const char *src,
+    const char *dest)
+{
+    if (!src || !dest)
+        return -1;
+
+    codec_frame_t fr;
+    int kind = codec_frame_open(src, &fr);
+    if (kind < 0)
+        return -1;
+    if (kind == 0)
+    {
+        int32_t rc = codec_decompress_file(&fr, dest);
+        fossil_native_close(fr.h);
+        return rc;
+    }
+
+    /* not a frame: the legacy RLE stream */
+    FILE *in = fopen(src, "rb");
+    FILE *out = in ? fopen(dest, "wb") : NULL;
+    if (!in || !out)
+    {
+        if (in)
+            fclose(in);
+        return -1;
+    }
+
+    int32_t rc = rle_decompress_stream(in, out);
+    fclose(in);
+    if (fclose(out) != 0)
+        rc = -1;
+    fossil_cache_forget(dest, false);
+    return rc;
+}
+
+static int64_t file_is_readable_uncached(const char *path)
+{
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES || (attr & FILE_ATTRIBUTE_DIRECTORY))
+        return 0;
+    HANDLE h = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return 0;
+    CloseHandle(h);
+    return 1;
+#else
+    if (access(path, R_OK) == 0)
+    {
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode))
+            return 1;
+        return 0;
+    }
+    if (errno == ENOENT)
+        return 0;
+    return -1;
+#endif
+}
+
+int32_t fossil_io_filesys_file_is_readable(const char *path)
+{
+    if (!path)
+        return -1;
+
+    return (int32_t)fossil_cache_query(path, CACHE_READABLE, file_is_readable_uncached);
+}
+
+int32_t fossil_io_filesys_file_is_writable(const char *path)
+{
+    if (!path)
+        return -1;
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES || (attr & FILE_ATTRIBUTE_DIRECTORY))
+        return 0;
+    HANDLE h = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return 0;
+    CloseHandle(h);
+    return 1;
+#else
+    if (access(path, W_OK) == 0)
+    {
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode))
+            return 1;
+        return 0;
+    }
+    if (errno == ENOENT)
+        return 0;
+    return -1;
+#endif
+}
+
+int32_t fossil_io_filesys_file_set_perms(const char *path, fossil_io_filesys_perms_t perms)
+{
+    if (!path)
+        return -1;
+#if defined(_WIN32)
+    // Windows does not support POSIX permissions; no-op
+    (void)perms;
+    return 0;
+#else
+    mode_t mode = 0;
+    if (perms.read)
+        mode |= S_IRUSR | S_IRGRP | S_IROTH;
+    if (perms.write)
+        mode |= S_IWUSR | S_IWGRP | S_IWOTH;
+    if (perms.execute)
+        mode |= S_IXUSR | S_IXGRP | S_IXOTH;
+    int32_t rc = chmod(path, mode);
+    fossil_cache_forget(path, false);
+    return rc;
+#endif
+}
+
+int32_t fossil_io_filesys_file_set_owner(const char *path, const char *owner, const char *group)
+{
+    if (!path)
+        return -1;
+#if defined(_WIN32)
+    // Not supported on Windows
+    (void)owner;
+    (void)group;
+    return 0;
+#else
+    uid_t uid = (uid_t)-1;
+    gid_t gid = (gid_t)-1;
+    if (owner)
+    {
+        struct passwd *pw = getpwnam(owner);
+        if (pw)
+            uid = pw->pw_uid;
+        else
+        {
+            char *endptr;
+            uid = (uid_t)strtol(owner, &endptr, 10);
+            if (*endptr != '\0')
+                uid = (uid_t)-1;
+        }
+    }
+    if (group)
+    {
+        struct group *gr = getgrnam(group);
+        if (gr)
+            gid = gr->gr_gid;
+        else
+        {
+            char *endptr;
+            gid = (gid_t)strtol(group, &endptr, 10);
+            if (*endptr != '\0')
+                gid = (gid_t)-1;
+        }
+    }
+    if (uid == (uid_t)-1 && gid == (gid_t)-1)
+        return -1;
+    return chown(path, uid, gid);
+#endif
+}
+
+/* Memory-Mapped Views */
+
+static size_t fossil_map_granularity(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (size_t)si.dwAllocationGranularity;
+#else
+    long page = sysconf(_SC_PAGESIZE);
+    return (page > 0) ? (size_t)page : 4096;
+#endif
+}
+
+int32_t fossil_io_filesys_file_map(
+    fossil_io_filesys_file_t *f,
+    uint64_t offset,
+    size_t length,
+    fossil_io_filesys_view_t *view)
+{
+    if (!file_ready(f) || !view)
+        return -1;
+
+    memset(view, 0, sizeof(*view));
+
+    fossil_mutex_lock(&f->base.lock);
+
+    /* make buffered writes visible through the mapping */
+    file_drain(f);
+    fflush((FILE *)f->handle);
+
+#if defined(_WIN32)
+    HANDLE fh = (HANDLE)_get_osfhandle(f->fd);
+    LARGE_INTEGER li;
+    if (fh == INVALID_HANDLE_VALUE || !GetFileSizeEx(fh, &li))
+    {
+        fossil_mutex_unlock(&f->base.lock);
+        return -1;
+    }
+    uint64_t file_size = (uint64_t)li.QuadPart;
+#else
+    struct stat st;
+    if (fstat(f->fd, &st) != 0)
+    {
+        fossil_mutex_unlock(&f->base.lock);
+        return -1;
+    }
+    uint64_t file_size = (uint64_t)st.st_size;
+#endif
+
+    fossil_mutex_unlock(&f->base.lock);
+
+    if (offset > file_size)
+        return -1;
+
+    uint64_t avail = file_size - offset;
+    if (length == 0 || (uint64_t)length > avail)
+    {
+        if (avail > (uint64_t)SIZE_MAX)
+            return -1;
+        length = (size_t)avail;
+    }
+
+    view->offset = offset;
+
+    /* empty range: nothing to map */
+    if (length == 0)
+        return 0;
+
+    size_t gran = fossil_map_granularity();
+    uint64_t aligned = offset - (offset % gran);
+    size_t delta = (size_t)(offset - aligned);
+    size_t map_length = length + delta;
+
+#if defined(_WIN32)
+    HANDLE mapping = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+        return -1;
+
+    void *base = MapViewOfFile(mapping, FILE_MAP_READ,
+                               (DWORD)(aligned >> 32), (DWORD)(aligned & 0xFFFFFFFFu),
+                               map_length);
+    CloseHandle(mapping); /* the view keeps the section alive */
+    if (!base)
+        return -1;
+#else
+    void *base = mmap(NULL, map_length, PROT_READ, MAP_SHARED, f->fd, (off_t)aligned);
+    if (base == MAP_FAILED)
+        return -1;
+#endif
+
+    view->map_base = base;
+    view->map_length = map_length;
+    view->data = (const unsigned char *)base + delta;
+    view->length = length;
+    return 0;
+}
+
+int32_t fossil_io_filesys_file_unmap(fossil_io_filesys_view_t *view)
+{
+    if (!view)
+        return -1;
+
+    int rc = 0;
+    if (view->map_base)
+    {
+#if defined(_WIN32)
+        rc = UnmapViewOfFile(view->map_base) ? 0 : -1;
+#else
+        rc = munmap(view->map_base, view->map_length);
+#endif
+    }
+
+    memset(view, 0, sizeof(*view));
+    return (rc == 0) ? 0 : -1;
+}
+
+int32_t fossil_io_filesys_view_advise(fossil_io_filesys_view_t *view, fossil_io_filesys_advice_t advice)
+{
+    if (!view)
+        return -1;
+
+    if (!view->map_base)
+        return 0;
+
+#if defined(_WIN32)
+    (void)advice;
+    return 0;
+#else
+    int hint;
+    switch (advice)
+    {
+    case FOSSIL_FILESYS_ADVICE_SEQUENTIAL:
+        hint = POSIX_MADV_SEQUENTIAL;
+        break;
+    case FOSSIL_FILESYS_ADVICE_RANDOM:
+        hint = POSIX_MADV_RANDOM;
+        break;
+    case FOSSIL_FILESYS_ADVICE_WILLNEED:
+        hint = POSIX_MADV_WILLNEED;
+        break;
+    case FOSSIL_FILESYS_ADVICE_DONTNEED:
+        hint = POSIX_MADV_DONTNEED;
+        break;
+    case FOSSIL_FILESYS_ADVICE_NORMAL:
+        hint = POSIX_MADV_NORMAL;
+        break;
+    default:
+        return -1;
+    }
+
+    return (posix_madvise(view->map_base, view->map_length, hint) == 0) ? 0 : -1;
+#endif
+}
+
+/* ------------------------------------------------------------
+ * Streaming Rewrite
+ * ------------------------------------------------------------ */
+
+#define FOSSIL_REWRITE_CHUNK (1024 * 1024)
+#define FOSSIL_REWRITE_WINDOW ((size_t)64 * 1024 * 1024)
+
+struct fossil_io_filesys_sink
+{
+    fossil_native_t h;
+    uint64_t offset; /* bytes already written to h */
+    unsigned char *buf;
+    size_t len;
+    size_t cap;
+    bool failed;
+};
+
+static int sink_put(fossil_io_filesys_sink_t *sink, const unsigned char *p, size_t len)
+{
+    while (len > 0)
+    {
+        int64_t w = fossil_native_pwrite(sink->h, p, len, sink->offset);
+        if (w <= 0)
+        {
+            sink->failed = true;
+            return -1;
+        }
+        p += w;
+        len -= (size_t)w;
+        sink->offset += (uint64_t)w;
+    }
+    return 0;
+}
+
+static int sink_flush(fossil_io_filesys_sink_t *sink)
+{
+    int rc = sink_put(sink, sink->buf, sink->len);
+    sink->len = 0;
+    return rc;
+}
+
+int32_t fossil_io_filesys_sink_write(fossil_io_filesys_sink_t *sink, const void *data, size_t len)
+{
+    if (!sink || (!data && len > 0) || sink->failed)
+        return -1;
+
+    const unsigned char *p = (const unsigned char *)data;
+    while (len > 0)
+    {
+        /* A write at least a buffer long skips the copy. */
+        if (sink->len == 0 && len >= sink->cap)
+            return sink_put(sink, p, len);
+
+        size_t room = sink->cap - sink->len;
+        size_t n = (len < room) ? len : room;
+        memcpy(sink->buf + sink->len, p, n);
+        sink->len += n;
+        p += n;
+        len -= n;
+        if (sink->len == sink->cap && sink_flush(sink) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+#if !defined(_WIN32)
+static void rewrite_parent_dir(const char *path, char *dir, size_t dir_size)
+{
+    const char *slash = strrchr(path, '/');
+    if (!slash)
+        snprintf(dir, dir_size, ".");
+    else if (slash == path)
+        snprintf(dir, dir_size, "/");
+    else
+        snprintf(dir, dir_size, "%.*s", (int)(slash - path), path);
+}
+#endif
+
+/*
+ * Open a staging file beside `path` for its replacement. Where O_TMPFILE
+ * works the file has no name until commit, so a crash leaves nothing behind
+ * and *tmp_name is empty; otherwise a unique sibling name is used.
+ */
+static fossil_native_t rewrite_stage_open(const char *path, uint32_t mode, char *tmp_name, size_t tmp_size)
+{
+#if defined(_WIN32)
+    (void)mode;
+    snprintf(tmp_name, tmp_size, "%s.tmp.rewrite", path);
+    return CreateFileA(tmp_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+    tmp_name[0] = '\0';
+#if defined(O_TMPFILE)
+    if (access("/proc/self/fd", X_OK) == 0)
+    {
+        char dir[PATH_MAX];
+        rewrite_parent_dir(path, dir, sizeof(dir));
+        int fd = open(dir, O_TMPFILE | O_WRONLY | O_CLOEXEC, (mode_t)mode);
+        if (fd >= 0)
+        {
+            /* open() applies the umask; the original's bits must survive */
+            fchmod(fd, (mode_t)mode);
+            return fd;
+        }
+    }
+#endif
+    int n = snprintf(tmp_name, tmp_size, "%s.rewrite.XXXXXX", path);
+    if (n < 0 || (size_t)n >= tmp_size)
+        return FOSSIL_NATIVE_INVALID;
+    int fd = mkstemp(tmp_name);
+    if (fd < 0)
+        return FOSSIL_NATIVE_INVALID;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fchmod(fd, (mode_t)mode);
+    return fd;
+#endif
+}
+
+static void rewrite_stage_abort(fossil_native_t h, const char *tmp_name)
+{
+    fossil_native_close(h);
+    if (tmp_name[0])
+        remove(tmp_name);
+}
+
+/* Persist the staged file, move it over `path`, and persist the rename. Closes h. */
+static int rewrite_stage_commit(fossil_native_t h, char *tmp_name, size_t tmp_size, const char *path)
+{
+#if defined(_WIN32)
+    (void)tmp_size;
+    bool ok = FlushFileBuffers(h) != 0;
+    CloseHandle(h);
+    ok = ok && MoveFileExA(tmp_name, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    if (!ok)
+        remove(tmp_name);
+    return ok ? 0 : -1;
+#else
+    if (fossil_fd_sync(h, FOSSIL_FILESYS_FLUSH_FULL) != 0)
+    {
+        rewrite_stage_abort(h, tmp_name);
+        return -1;
+    }
+
+    if (!tmp_name[0])
+    {
+        /* linkat() cannot replace, so name the O_TMPFILE inode first. */
+        static atomic_uint seq;
+        char proc[64];
+        snprintf(proc, sizeof(proc), "/proc/self/fd/%d", h);
+        snprintf(tmp_name, tmp_size, "%s.rewrite.%ld.%u", path, (long)getpid(), atomic_fetch_add(&seq, 1));
+        if (linkat(AT_FDCWD, proc, AT_FDCWD, tmp_name, AT_SYMLINK_FOLLOW) != 0)
+        {
+            tmp_name[0] = '\0';
+            rewrite_stage_abort(h, tmp_name);
+            return -1;
+        }
+    }
+    close(h);
+
+    if (rename(tmp_name, path) != 0)
+    {
+        remove(tmp_name);
+        return -1;
+    }
+
+    char dir[PATH_MAX];
+    rewrite_parent_dir(path, dir, sizeof(dir));
+    int dfd = open(dir, O_RDONLY | O_CLOEXEC);
+    if (dfd >= 0)
+    {
+        fossil_fd_sync(dfd, FOSSIL_FILESYS_FLUSH_FULL);
+        close(dfd);
+    }
+    return 0;
+#endif
+}
+
+int32_t fossil_io_filesys_file_rewrite_stream(
+    const char *path,
+    size_t chunk_size,
+    int (*transform)(const void *chunk, size_t len, bool final, fossil_io_filesys_sink_t *out, void *user_data),
+    void *user_data)
+{
+    if (!path || !transform)
+        return -1;
+    if (chunk_size == 0)
+        chunk_size = FOSSIL_REWRITE_CHUNK;
+
+    fossil_native_t in = fossil_native_open(path, false);
+    if (in == FOSSIL_NATIVE_INVALID)
+        return -1;
+
+    uint32_t mode = 0644;
+#if !defined(_WIN32)
+    struct stat st;
+    if (fstat(in, &st) == 0)
+        mode = (uint32_t)(st.st_mode & 07777);
+#endif
+
+    char tmp_name[FOSSIL_FILESYS_MAX_PATH];
+    fossil_native_t out = rewrite_stage_open(path, mode, tmp_name, sizeof(tmp_name));
+    unsigned char *chunk = malloc(chunk_size);
+    unsigned char *staged = malloc(chunk_size);
+    if (out == FOSSIL_NATIVE_INVALID || !chunk || !staged)
+    {
+        if (out != FOSSIL_NATIVE_INVALID)
+            rewrite_stage_abort(out, tmp_name);
+        fossil_native_close(in);
+        free(chunk);
+        free(staged);
+        return -1;
+    }
+
+    fossil_io_filesys_sink_t sink = {out, 0, staged, 0, chunk_size, false};
+    int rc = 0;
+    uint64_t pos = 0;
+
+    for (;;)
+    {
+        int64_t n = fossil_native_pread(in, chunk, chunk_size, pos);
+        if (n < 0)
+            rc = -1;
+        if (n <= 0)
+            break;
+        pos += (uint64_t)n;
+        if (transform(chunk, (size_t)n, false, &sink, user_data) != 0 || sink.failed)
+        {
+            rc = -1;
+            break;
+        }
+    }
+
+    if (rc == 0 && (transform(NULL, 0, true, &sink, user_data) != 0 || sink.failed || sink_flush(&sink) != 0))
+        rc = -1;
+
+    fossil_native_close(in);
+    free(chunk);
+    free(staged);
+
+    if (rc != 0)
+    {
+        rewrite_stage_abort(out, tmp_name);
+        return -1;
+    }
+    rc = rewrite_stage_commit(out, tmp_name, sizeof(tmp_name), path);
+    fossil_cache_forget(path, false);
+    return rc;
+}
+
+int32_t fossil_io_filesys_file_rewrite_inplace(
+    const char *path,
+    size_t window,
+    int (*transform)(void *data, size_t len, uint64_t offset, void *user_data),
+    void *user_data)
+{
+    if (!path || !transform)
+        return -1;
+
+    size_t gran = fossil_map_granularity();
+    if (window == 0)
+        window = FOSSIL_REWRITE_WINDOW;
+    window = ((window + gran - 1) / gran) * gran;
+
+#if defined(_WIN32)
+    HANDLE h = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return -1;
+    HANDLE mapping = NULL;
+#else
+    int h = open(path, O_RDWR | O_CLOEXEC);
+    if (h < 0)
+        return -1;
+#endif
+
+    int64_t size = fossil_native_size(h);
+    if (size <= 0)
+    {
+        fossil_native_close(h);
+        return (size == 0) ? 0 : -1;
+    }
+
+#if defined(_WIN32)
+    mapping = CreateFileMappingA(h, NULL, PAGE_READWRITE, 0, 0, NULL);
+#endif
+
+    int rc = 0;
+    unsigned char *fallback = NULL; /* used where the file cannot be mapped */
+
+    for (uint64_t off = 0; rc == 0 && off < (uint64_t)size; off += window)
+    {
+        size_t len = ((uint64_t)size - off < window) ? (size_t)((uint64_t)size - off) : window;
+
+#if defined(_WIN32)
+        void *base = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(off >> 32),
+                                             (DWORD)(off & 0xFFFFFFFFu), len)
+                             : NULL;
+        if (base)
+        {
+            rc = transform(base, len, off, user_data) == 0 ? 0 : -1;
+            FlushViewOfFile(base, len);
+            UnmapViewOfFile(base);
+            continue;
+        }
+#else
+        void *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, h, (off_t)off);
+        if (base != MAP_FAILED)
+        {
+            posix_madvise(base, len, POSIX_MADV_SEQUENTIAL);
+            rc = transform(base, len, off, user_data) == 0 ? 0 : -1;
+            munmap(base, len);
+            continue;
+        }
+#endif
+
+        if (!fallback && !(fallback = malloc(window)))
+        {
+            rc = -1;
+            break;
+        }
+        for (size_t got = 0; rc == 0 && got < len;)
+        {
+            int64_t n = fossil_native_pread(h, fallback + got, len - got, off + got);
+            if (n <= 0)
+                rc = -1;
+            else
+                got += (size_t)n;
+        }
+        if (rc == 0)
+            rc = transform(fallback, len, off, user_data) == 0 ? 0 : -1;
+        for (size_t put = 0; rc == 0 && put < len;)
+        {
+            int64_t n = fossil_native_pwrite(h, fallback + put, len - put, off + put);
+            if (n <= 0)
+                rc = -1;
+            else
+                put += (size_t)n;
+        }
+    }
+
+    free(fallback);
+#if defined(_WIN32)
+    if (mapping)
+        CloseHandle(mapping);
+    if (!FlushFileBuffers(h))
+        rc = -1;
+#else
+    if (fossil_fd_sync(h, FOSSIL_FILESYS_FLUSH_DATA) != 0)
+        rc = -1;
+#endif
+    fossil_native_close(h);
+    return rc;
+}
+
+/* ------------------------------------------------------------
+ * Asynchronous I/O Engine
+ * ------------------------------------------------------------ */
+
+#define FOSSIL_AIO_DEFAULT_DEPTH 256
+#define FOSSIL_AIO_MAX_DEPTH 4096
+
+/*
+ * io_uring is driven through raw system calls so no liburing is needed.
+ * IORING_FEAT_CUR_PERSONALITY marks 5.6+ headers, the first to declare the
+ * openat/statx/close opcodes and the opcode probe.
+ */
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+    defined(__NR_io_uring_register) && defined(IORING_FEAT_CUR_PERSONALITY)
+#define FOSSIL_HAVE_URING 1
+#endif
+
+/* One request; the slot index travels through the ring as its identity. */
+typedef struct
+{
+    fossil_io_filesys_aio_op_t op;
+    uint64_t user_data;
+    int fd;
+    void *buf;
+    size_t len;
+    uint64_t offset;
+    const char *path;
+    int flags;
+    uint32_t mode;
+    fossil_io_filesys_aio_stat_t *stat_out;
+    int64_t result;
+#if defined(FOSSIL_HAVE_URING)
+    struct statx stx;
+#endif
+} aio_slot_t;
+
+#if defined(FOSSIL_HAVE_URING)
+typedef struct
+{
+    int fd;
+    unsigned entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    size_t sq_ring_len;
+    void *cq_ring;
+    size_t cq_ring_len;
+    size_t sqes_len;
+    unsigned sq_local_tail; /* next SQE to fill; published on submit */
+} aio_uring_t;
+#endif
+
+struct fossil_io_filesys_aio
+{
+    fossil_io_filesys_aio_backend_t backend;
+    uint32_t depth;
+    aio_slot_t *slots;
+    uint32_t *free_slots; /* stack of unused slot indices */
+    uint32_t free_count;
+    uint32_t *prepared; /* queued, not yet submitted */
+    uint32_t prepared_count;
+    size_t inflight;
+
+    /* Finished slots for the thread and sync backends, a ring of depth. */
+    uint32_t *done;
+    size_t done_head;
+    size_t done_count;
+
+#if defined(FOSSIL_HAVE_URING)
+    aio_uring_t ring;
+#endif
+#if !defined(_WIN32)
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    uint32_t *work; /* ring of depth, guarded by lock */
+    size_t work_head;
+    size_t work_count;
+    pthread_t *threads;
+    size_t thread_count;
+    bool stop;
+#endif
+};
+
+#if defined(FOSSIL_HAVE_URING)
+
+#define aio_load_acquire(p) atomic_load_explicit((_Atomic unsigned *)(p), memory_order_acquire)
+#define aio_store_release(p, v) atomic_store_explicit((_Atomic unsigned *)(p), (v), memory_order_release)
+
+static void aio_uring_teardown(aio_uring_t *r)
+{
+    if (r->sqes && r->sqes != MAP_FAILED)
+        munmap(r->sqes, r->sqes_len);
+    if (r->cq_ring && r->cq_ring != MAP_FAILED && r->cq_ring != r->sq_ring)
+        munmap(r->cq_ring, r->cq_ring_len);
+    if (r->sq_ring && r->sq_ring != MAP_FAILED)
+        munmap(r->sq_ring, r->sq_ring_len);
+    if (r->fd >= 0)
+        close(r->fd);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+/* True when the kernel reports every opcode the engine can queue. */
+static bool aio_uring_probe(int fd)
+{
+    static const unsigned char needed[] = {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC,
+                                           IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_CLOSE};
+    size_t len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, len);
+    if (!probe)
+        return false;
+
+    bool ok = (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0);
+    for (size_t i = 0; ok && i < sizeof(needed); ++i)
+        ok = (needed[i] <= probe->last_op) && (probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED);
+
+    free(probe);
+    return ok;
+}
+
+static int aio_uring_setup(aio_uring_t *r, unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+
+    /* Twice the depth of completion space, so the CQ can never overflow. */
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 2;
+
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0)
+    {
+        r->fd = -1;
+        return -1;
+    }
+
+    r->entries = p.sq_entries;
+    r->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && r->cq_ring_len > r->sq_ring_len)
+        r->sq_ring_len = r->cq_ring_len;
+
+    r->sq_ring = mmap(NULL, r->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED)
+        goto fail;
+    r->cq_ring = single ? r->sq_ring
+                        : mmap(NULL, r->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_ring == MAP_FAILED)
+        goto fail;
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED)
+        goto fail;
+
+    char *sq = (char *)r->sq_ring;
+    char *cq = (char *)r->cq_ring;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->sq_local_tail = *r->sq_tail;
+
+    if (!aio_uring_probe(r->fd))
+        goto fail;
+    return 0;
+
+fail:
+    aio_uring_teardown(r);
+    return -1;
+}
+
+/* The depth limit guarantees a free SQE for every queued request. */
+static struct io_uring_sqe *aio_uring_sqe(aio_uring_t *r, uint32_t slot)
+{
+    unsigned idx = r->sq_local_tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = slot;
+    r->sq_array[idx] = idx;
+    r->sq_local_tail++;
+    return sqe;
+}
+
+static void aio_uring_prepare(fossil_io_filesys_aio_t *aio, uint32_t slot_index)
+{
+    aio_slot_t *s = &aio->slots[slot_index];
+    struct io_uring_sqe *sqe = aio_uring_sqe(&aio->ring, slot_index);
+
+    switch (s->op)
+    {
+    case FOSSIL_FILESYS_AIO_READ:
+    case FOSSIL_FILESYS_AIO_WRITE:
+        sqe->opcode = (s->op == FOSSIL_FILESYS_AIO_READ) ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = s->fd;
+        sqe->addr = (uint64_t)(uintptr_t)s->buf;
+        sqe->len = (s->len > 0x7ffff000u) ? 0x7ffff000u : (unsigned)s->len;
+        sqe->off = s->offset;
+        break;
+    case FOSSIL_FILESYS_AIO_FSYNC:
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = s->fd;
+        sqe->fsync_flags = s->flags ? IORING_FSYNC_DATASYNC : 0;
+        break;
+    case FOSSIL_FILESYS_AIO_OPENAT:
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = s->fd;
+        sqe->addr = (uint64_t)(uintptr_t)s->path;
+        sqe->len = s->mode;
+        sqe->open_flags = (unsigned)s->flags;
+        break;
+    case FOSSIL_FILESYS_AIO_STATX:
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = s->fd;
+        sqe->addr = (uint64_t)(uintptr_t)s->path;
+        sqe->len = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME;
+        sqe->off = (uint64_t)(uintptr_t)&s->stx;
+        sqe->statx_flags = (unsigned)s->flags;
+        break;
+    case FOSSIL_FILESYS_AIO_CLOSE:
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = s->fd;
+        break;
+    }
+}
+
+static int aio_uring_enter(aio_uring_t *r, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    for (;;)
+    {
+        long n = syscall(__NR_io_uring_enter, r->fd, to_submit, min_complete, flags, NULL, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        return (int)n;
+    }
+}
+
+#endif /* FOSSIL_HAVE_URING */
+
+/* Run one request with blocking calls (thread and sync backends). */
+static void aio_execute(aio_slot_t *s)
+{
+#if defined(_WIN32)
+    HANDLE h = (s->op == FOSSIL_FILESYS_AIO_READ || s->op == FOSSIL_FILESYS_AIO_WRITE)
+                   ? (HANDLE)_get_osfhandle(s->fd)
+                   : INVALID_HANDLE_VALUE;
+    struct __stat64 st;
+    errno = 0;
+    switch (s->op)
+    {
+    case FOSSIL_FILESYS_AIO_READ:
+        s->result = fossil_native_pread(h, s->buf, s->len, s->offset);
+        break;
+    case FOSSIL_FILESYS_AIO_WRITE:
+        s->result = fossil_native_pwrite(h, s->buf, s->len, s->offset);
+        break;
+    case FOSSIL_FILESYS_AIO_FSYNC:
+        s->result = _commit(s->fd);
+        break;
+    case FOSSIL_FILESYS_AIO_OPENAT:
+        /* Only FOSSIL_FILESYS_AIO_CWD is accepted as dirfd here. */
+        s->result = _open(s->path, s->flags | _O_BINARY, (int)s->mode);
+        break;
+    case FOSSIL_FILESYS_AIO_STATX:
+        s->result = _stat64(s->path, &st);
+        if (s->result == 0)
+        {
+            s->stat_out->size = (uint64_t)st.st_size;
+            s->stat_out->mode = (uint32_t)st.st_mode;
+            s->stat_out->mtime = (time_t)st.st_mtime;
+        }
+        break;
+    case FOSSIL_FILESYS_AIO_CLOSE:
+        s->result = _close(s->fd);
+        break;
+    }
+    if (s->result < 0)
+        s->result = -(int64_t)(errno ? errno : EIO);
+#else
+    int dirfd = (s->fd == FOSSIL_FILESYS_AIO_CWD) ? AT_FDCWD : s->fd;
+    struct stat st;
+    int rc;
+
+    errno = 0;
+    switch (s->op)
+    {
+    case FOSSIL_FILESYS_AIO_READ:
+        s->result = fossil_native_pread(s->fd, s->buf, s->len, s->offset);
+        break;
+    case FOSSIL_FILESYS_AIO_WRITE:
+        s->result = fossil_native_pwrite(s->fd, s->buf, s->len, s->offset);
+        break;
+    case FOSSIL_FILESYS_AIO_FSYNC:
+#if defined(__linux__)
+        s->result = s->flags ? fdatasync(s->fd) : fsync(s->fd);
+#else
+        s->result = fsync(s->fd);
+#endif
+        break;
+    case FOSSIL_FILESYS_AIO_OPENAT:
+        do
+            rc = openat(dirfd, s->path, s->flags, (mode_t)s->mode);
+        while (rc < 0 && errno == EINTR);
+        s->result = rc;
+        break;
+    case FOSSIL_FILESYS_AIO_STATX:
+        s->result = fstatat(dirfd, s->path, &st, s->flags);
+        if (s->result == 0)
+        {
+            s->stat_out->size = (uint64_t)st.st_size;
+            s->stat_out->mode = (uint32_t)st.st_mode;
+            s->stat_out->mtime = st.st_mtime;
+        }
+        break;
+    case FOSSIL_FILESYS_AIO_CLOSE:
+        s->result = close(s->fd);
+        break;
+    }
+    if (s->result < 0)
+        s->result = -(int64_t)(errno ? errno : EIO);
+#endif
+}
+
+/* Release a finished slot into a completion record. */
+static void aio_complete(fossil_io_filesys_aio_t *aio, uint32_t slot_index, int64_t result,
+                         fossil_io_filesys_aio_completion_t *out)
+{
+    aio_slot_t *s = &aio->slots[slot_index];
+
+#if defined(FOSSIL_HAVE_URING)
+    if (aio->backend == FOSSIL_FILESYS_AIO_BACKEND_URING && s->op == FOSSIL_FILESYS_AIO_STATX && result == 0)
+    {
+        s->stat_out->size = s->stx.stx_size;
+        s->stat_out->mode = s->stx.stx_mode;
+        s->stat_out->mtime = (time_t)s->stx.stx_mtime.tv_sec;
+    }
+#endif
+
+    out->user_data = s->user_data;
+    out->op = s->op;
+    out->result = result;
+    aio->free_slots[aio->free_count++] = slot_index;
+    aio->inflight--;
+}
+
+#if !defined(_WIN32)
+static void *aio_worker(void *arg)
+{
+    fossil_io_filesys_aio_t *aio = (fossil_io_filesys_aio_t *)arg;
+
+    pthread_mutex_lock(&aio->lock);
+    for (;;)
+    {
+        while (!aio->stop && aio->work_count == 0)
+            pthread_cond_wait(&aio->work_cond, &aio->lock);
+        if (aio->work_count == 0)
+            break;
+
+        uint32_t slot = aio->work[aio->work_head];
+        aio->work_head = (aio->work_head + 1) % aio->depth;
+        aio->work_count--;
+        pthread_mutex_unlock(&aio->lock);
+
+        aio_execute(&aio->slots[slot]);
+
+        pthread_mutex_lock(&aio->lock);
+        aio->done[(aio->done_head + aio->done_count) % aio->depth] = slot;
+        aio->done_count++;
+        pthread_cond_signal(&aio->done_cond);
+    }
+    pthread_mutex_unlock(&aio->lock);
+    return NULL;
+}
+#endif
+
+fossil_io_filesys_aio_t *fossil_io_filesys_aio_create(const fossil_io_filesys_aio_opts_t *opts)
+{
+    uint32_t depth = (opts && opts->queue_depth) ? opts->queue_depth : FOSSIL_AIO_DEFAULT_DEPTH;
+    if (depth > FOSSIL_AIO_MAX_DEPTH)
+        depth = FOSSIL_AIO_MAX_DEPTH;
+
+    fossil_io_filesys_aio_t *aio = calloc(1, sizeof(*aio));
+    if (!aio)
+        return NULL;
+
+    aio->depth = depth;
+    aio->slots = calloc(depth, sizeof(*aio->slots));
+    aio->free_slots = malloc(depth * sizeof(*aio->free_slots));
+    aio->prepared = malloc(depth * sizeof(*aio->prepared));
+    aio->done = malloc(depth * sizeof(*aio->done));
+    if (!aio->slots || !aio->free_slots || !aio->prepared || !aio->done)
+    {
+        fossil_io_filesys_aio_destroy(aio);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < depth; ++i)
+        aio->free_slots[i] = depth - 1 - i;
+    aio->free_count = depth;
+
+#if defined(_WIN32)
+    aio->backend = FOSSIL_FILESYS_AIO_BACKEND_SYNC;
+    return aio;
+#else
+#if defined(FOSSIL_HAVE_URING)
+    aio->ring.fd = -1;
+    if (!(opts && opts->force_threads) && aio_uring_setup(&aio->ring, depth) == 0)
+    {
+        aio->backend = FOSSIL_FILESYS_AIO_BACKEND_URING;
+        return aio;
+    }
+#endif
+
+    aio->backend = FOSSIL_FILESYS_AIO_BACKEND_THREADS;
+    size_t threads = (opts && opts->threads) ? opts->threads : fossil_cpu_count();
+    if (threads > depth)
+        threads = depth;
+
+    aio->work = malloc(depth * sizeof(*aio->work));
+    aio->threads = malloc(threads * sizeof(*aio->threads));
+    if (!aio->work || !aio->threads)
+    {
+        fossil_io_filesys_aio_destroy(aio);
+        return NULL;
+    }
+
+    pthread_mutex_init(&aio->lock, NULL);
+    pthread_cond_init(&aio->work_cond, NULL);
+    pthread_cond_init(&aio->done_cond, NULL);
+    for (size_t i = 0; i < threads; ++i)
+    {
+        if (pthread_create(&aio->threads[aio->thread_count], NULL, aio_worker, aio) == 0)
+            aio->thread_count++;
+    }
+    if (aio->thread_count == 0)
+    {
+        fossil_io_filesys_aio_destroy(aio);
+        return NULL;
+    }
+    return aio;
+#endif
+}
+
+void fossil_io_filesys_aio_destroy(fossil_io_filesys_aio_t *aio)
+{
+    if (!aio)
+        return;
+
+    /* Buffers and stat targets belong to the caller; never abandon them mid-flight. */
+    if (aio->slots && aio->inflight > 0)
+    {
+        fossil_io_filesys_aio_completion_t sink[64];
+        while (aio->inflight > 0)
+        {
+            if (fossil_io_filesys_aio_wait(aio, sink, 64, 1) < 0)
+                break;
+        }
+    }
+
+#if defined(FOSSIL_HAVE_URING)
+    if (aio->backend == FOSSIL_FILESYS_AIO_BACKEND_URING)
+        aio_uring_teardown(&aio->ring);
+#endif
+#if !defined(_WIN32)
+    if (aio->thread_count > 0)
+    {
+        pthread_mutex_lock(&aio->lock);
+        aio->stop = true;
+        pthread_cond_broadcast(&aio->work_cond);
+        pthread_mutex_unlock(&aio->lock);
+        for (size_t i = 0; i < aio->thread_count; ++i)
+            pthread_join(aio->threads[i], NULL);
+    }
+    if (aio->backend == FOSSIL_FILESYS_AIO_BACKEND_THREADS && aio->threads && aio->work)
+    {
+        pthread_mutex_destroy(&aio->lock);
+        pthread_cond_destroy(&aio->work_cond);
+        pthread_cond_destroy(&aio->done_cond);
+    }
+    free(aio->threads);
+    free(aio->work);
+#endif
+    free(aio->slots);
+    free(aio->free_slots);
+    free(aio->prepared);
+    free(aio->done);
+    free(aio);
+}
+
+fossil_io_filesys_aio_backend_t fossil_io_filesys_aio_backend(const fossil_io_filesys_aio_t *aio)
+{
+#if defined(_WIN32)
+    return aio ? aio->backend : FOSSIL_FILESYS_AIO_BACKEND_SYNC;
+#else
+    return aio ? aio->backend : FOSSIL_FILESYS_AIO_BACKEND_THREADS;
+#endif
+}
+
+/* Claim a slot for a new request, or NULL when queued + in flight == depth. */
+static aio_slot_t *aio_claim(fossil_io_filesys_aio_t *aio, fossil_io_filesys_aio_op_t op, int fd, uint64_t user_data)
+{
+    if (!aio || aio->free_count == 0)
+        return NULL;
+
+    uint32_t index = aio->free_slots[--aio->free_count];
+    aio_slot_t *s = &aio->slots[index];
+    s->op = op;
+    s->user_data = user_data;
+    s->fd = fd;
+    s->buf = NULL;
+    s->len = 0;
+    s->offset = 0;
+    s->path = NULL;
+    s->flags = 0;
+    s->mode = 0;
+    s->stat_out = NULL;
+    s->result = 0;
+    aio->prepared[aio->prepared_count++] = index;
+    return s;
+}
+
+static int32_t aio_queued(fossil_io_filesys_aio_t *aio, aio_slot_t *s)
+{
+#if defined(FOSSIL_HAVE_URING)
+    if (aio->backend == FOSSIL_FILESYS_AIO_BACKEND_URING)
+        aio_uring_prepare(aio, (uint32_t)(s - aio->slots));
+#else
+    (void)aio;
+    (void)s;
+#endif
+    return 0;
+}
+
+int32_t fossil_io_filesys_aio_read(fossil_io_filesys_aio_t *aio, int fd, void *buf, size_t len, uint64_t offset, uint64_t user_data)
+{
+    if (!buf && len > 0)
+        return -1;
+    aio_slot_t *s = aio_claim(aio, FOSSIL_FILESYS_AIO_READ, fd, user_data);
+    if (!s)
+        return -1;
+    s->buf = buf;
+    s->len = len;
+    s->offset = offset;
+    return aio_queued(aio, s);
+}
+
+int32_t fossil_io_filesys_aio_write(fossil_io_filesys_aio_t *aio, int fd, const void *buf, size_t len, uint64_t offset, uint64_t user_data)
+{
+    if (!buf && len > 0)
+        return -1;
+    aio_slot_t *s = aio_claim(aio, FOSSIL_FILESYS_AIO_WRITE, fd, user_data);
+    if (!s)
+        return -1;
+    s->buf = (void *)buf;
+    s->len = len;
+    s->offset = offset;
+    return aio_queued(aio, s);
+}
+
+int32_t fossil_io_filesys_aio_fsync(fossil_io_filesys_aio_t *aio, int fd, bool datasync, uint64_t user_data)
+{
+    aio_slot_t *s = aio_claim(aio, FOSSIL_FILESYS_AIO_FSYNC, fd, user_data);
+    if (!s)
+        return -1;
+    s->flags = datasync ? 1 : 0;
+    return aio_queued(aio, s);
+}
+
+int32_t fossil_io_filesys_aio_openat(fossil_io_filesys_aio_t *aio, int dirfd, const char *path, int flags, uint32_t mode, uint64_t user_data)
+{
+    if (!path)
+        return -1;
+    aio_slot_t *s = aio_claim(aio, FOSSIL_FILESYS_AIO_OPENAT, dirfd, user_data);
+    if (!s)
+        return -1;
+    s->path = path;
+#if defined(_WIN32)
+    s->flags = flags;
+#else
+    s->fd = (dirfd == FOSSIL_FILESYS_AIO_CWD) ? AT_FDCWD : dirfd;
+    s->flags = flags | O_CLOEXEC;
+#endif
+    s->mode = mode;
+    return aio_queued(aio, s);
+}
+
+int32_t fossil_io_filesys_aio_statx(fossil_io_filesys_aio_t *aio, int dirfd, const char *path, bool follow_links,
+                                    fossil_io_filesys_aio_stat_t *out, uint64_t user_data)
+{
+    if (!path || !out)
+        return -1;
+    aio_slot_t *s = aio_claim(aio, FOSSIL_FILESYS_AIO_STATX, dirfd, user_data);
+    if (!s)
+        return -1;
+    s->path = path;
+    s->stat_out = out;
+#if defined(_WIN32)
+    (void)follow_links;
+#else
+    s->fd = (dirfd == FOSSIL_FILESYS_AIO_CWD) ? AT_FDCWD : dirfd;
+    s->flags = follow_links ? 0 : AT_SYMLINK_NOFOLLOW;
+#endif
+    return aio_queued(aio, s);
+}
+
+int32_t fossil_io_filesys_aio_close(fossil_io_filesys_aio_t *aio, int fd, uint64_t user_data)
+{
+    aio_slot_t *s = aio_claim(aio, FOSSIL_FILESYS_AIO_CLOSE, fd, user_data);
+    if (!s)
+        return -1;
+    return aio_queued(aio, s);
+}
+
+int32_t fossil_io_filesys_aio_submit(fossil_io_filesys_aio_t *aio)
+{
+    if (!aio)
+        return -1;
+    uint32_t count = aio->prepared_count;
+    if (count == 0)
+        return 0;
+
+#if defined(FOSSIL_HAVE_URING)
+    if (aio->backend == FOSSIL_FILESYS_AIO_BACKEND_URING)
+    {
+        aio_store_release(aio->ring.sq_tail, aio->ring.sq_local_tail);
+        int n = aio_uring_enter(&aio->ring, count, 0, 0);
+        if (n < 0)
+            return -1;
+        /* Entries the kernel did not take stay in the ring for the next call. */
+        aio->prepared_count -= (uint32_t)n;
+        aio->inflight += (size_t)n;
+        return n;
+    }
+#endif
+
+#if defined(_WIN32)
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t slot = aio->prepared[i];
+        aio_execute(&aio->slots[slot]);
+        aio->done[(aio->done_head + aio->done_count) % aio->depth] = slot;
+        aio->done_count++;
+    }
+#else
+    pthread_mutex_lock(&aio->lock);
+    for (uint32_t i = 0; i < count; ++i)
+        aio->work[(aio->work_head + aio->work_count + i) % aio->depth] = aio->prepared[i];
+    aio->work_count += count;
+    if (count == 1)
+        pthread_cond_signal(&aio->work_cond);
+    else
+        pthread_cond_broadcast(&aio->work_cond);
+    pthread_mutex_unlock(&aio->lock);
+#endif
+
+    aio->prepared_count = 0;
+    aio->inflight += count;
+    return (int32_t)count;
+}
+
+/* Move up to max finished requests into out; the caller holds any lock. */
+static size_t aio_drain_done(fossil_io_filesys_aio_t *aio, fossil_io_filesys_aio_completion_t *out, size_t max)
+{
+    size_t n = 0;
+    while (n < max && aio->done_count > 0)
+    {
+        uint32_t slot = aio->done[aio->done_head];
+        aio->done_head = (aio->done_head + 1) % aio->depth;
+        aio->done_count--;
+        aio_complete(aio, slot, aio->slots[slot].result, &out[n++]);
+    }
+    return n;
+}
+
+#if defined(FOSSIL_HAVE_URING)
+static size_t aio_uring_reap(fossil_io_filesys_aio_t *aio, fossil_io_filesys_aio_completion_t *out, size_t max)
+{
+    aio_uring_t *r = &aio->ring;
+    unsigned head = *r->cq_head;
+    unsigned tail = aio_load_acquire(r->cq_tail);
+    size_t n = 0;
+
+    while (head != tail && n < max)
+    {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        aio_complete(aio, (uint32_t)cqe->user_data, cqe->res, &out[n++]);
+        head++;
+    }
+    aio_store_release(r->cq_head, head);
+    return n;
+}
+#endif
+
+int32_t fossil_io_filesys_aio_poll(fossil_io_filesys_aio_t *aio, fossil_io_filesys_aio_completion_t *out, size_t max)
+{
+    return fossil_io_filesys_aio_wait(aio, out, max, 0);
+}
+
+int32_t fossil_io_filesys_aio_wait(fossil_io_filesys_aio_t *aio, fossil_io_filesys_aio_completion_t *out, size_t max, size_t min_count)
+{
+    if (!aio || (!out && max > 0))
+        return -1;
+    if (max > INT32_MAX)
+        max = INT32_MAX;
+    if (min_count > max)
+        min_count = max;
+
+    size_t n = 0;
+
+#if defined(FOSSIL_HAVE_URING)
+    if (aio->backend == FOSSIL_FILESYS_AIO_BACKEND_URING)
+    {
+        n = aio_uring_reap(aio, out, max);
+        while (n < min_count && aio->inflight > 0)
+        {
+            size_t want = min_count - n;
+            if (want > aio->inflight)
+                want = aio->inflight;
+            if (aio_uring_enter(&aio->ring, 0, (unsigned)want, IORING_ENTER_GETEVENTS) < 0)
+                return n ? (int32_t)n : -1;
+            n += aio_uring_reap(aio, out + n, max - n);
+        }
+        return (int32_t)n;
+    }
+#endif
+
+#if defined(_WIN32)
+    n = aio_drain_done(aio, out, max);
+#else
+    pthread_mutex_lock(&aio->lock);
+    for (;;)
+    {
+        n += aio_drain_done(aio, out + n, max - n);
+        if (n >= min_count || aio->inflight == 0)
+            break;
+        pthread_cond_wait(&aio->done_cond, &aio->lock);
+    }
+    pthread_mutex_unlock(&aio->lock);
+#endif
+    return (int32_t)n;
+}
+
+size_t fossil_io_filesys_aio_inflight(const fossil_io_filesys_aio_t *aio)
+{
+    return aio ? aio->inflight : 0;
+}
+
+/* Directory Operations */
+
+int32_t fossil_io_filesys_dir_create(const char *path, bool recursive)
+{
+    if (!path || !*path)
+        return -1;
+
+    if (!recursive)
+    {
+#if defined(_WIN32)
+        int32_t rc = (_mkdir(path) == 0) ? 0 : -1;
+#else
+        int32_t rc = (mkdir(path, 0755) == 0) ? 0 : -1;
+#endif
+        fossil_cache_forget(path, false);
+        return rc;
+    }
+
+    char tmp[PATH_MAX];
+    strncpy(tmp, path, sizeof(tmp) - 1);
+    tmp[sizeof(tmp) - 1] = '\0';
+
+    size_t len = strlen(tmp);
+    if (len == 0)
+        return -1;
+
+    /* strip trailing slash */
+    if (tmp[len - 1] == '/' || tmp[len - 1] == '\\')
+        tmp[len - 1] = '\0';
+
+    for (char *p = tmp + 1; *p; ++p)
+    {
+        if (*p == '/' || *p == '\\')
+        {
+            *p = '\0';
+#if defined(_WIN32)
+            _mkdir(tmp);
+#else
+            mkdir(tmp, 0755);
+#endif
+            fossil_cache_forget(tmp, false);
+            *p = PATH_SEP;
+        }
+    }
+
+#if defined(_WIN32)
+    int32_t rc = (_mkdir(tmp) == 0 || GetLastError() == ERROR_ALREADY_EXISTS) ? 0 : -1;
+#else
+    int32_t rc = (mkdir(tmp, 0755) == 0 || errno == EEXIST) ? 0 : -1;
+#endif
+    fossil_cache_forget(tmp, false);
+    return rc;
+}
+
+/*
+ * Fill an object from metadata a listing already has in hand. Unlike
+ * fossil_io_filesys_stat() this allocates nothing: the object carries no
+ * mutex and needs no further cleanup.
+ */
+static void fossil_obj_from_meta(fossil_io_filesys_obj_t *obj, const char *path, uint32_t mode, uint64_t size,
+                                 time_t created_at, time_t modified_at, time_t accessed_at)
+{
+    memset(obj, 0, sizeof(*obj));
+
+    strncpy(obj->path, path, FOSSIL_FILESYS_MAX_PATH - 1);
+    fossil_generate_id(path, obj->id, sizeof(obj->id));
+
+    obj->mode = mode;
+    obj->size = (size_t)size;
+    obj->created_at = created_at;
+    obj->modified_at = modified_at;
+    obj->accessed_at = accessed_at;
+
+#if defined(_WIN32)
+    if (mode & FILE_ATTRIBUTE_DIRECTORY)
+        obj->type = FOSSIL_FILESYS_TYPE_DIR;
+    else if (mode & FILE_ATTRIBUTE_REPARSE_POINT)
+        obj->type = FOSSIL_FILESYS_TYPE_LINK;
+    else
+        obj->type = fossil_has_archive_ext(path) ? FOSSIL_FILESYS_TYPE_ARCHIVE
+                                                 : FOSSIL_FILESYS_TYPE_FILE;
+
+    obj->perms.read = true;
+    obj->perms.write = (mode & FILE_ATTRIBUTE_READONLY) == 0;
+    obj->perms.execute = false;
+#else
+    if (S_ISREG(mode))
+        obj->type = fossil_has_archive_ext(path) ? FOSSIL_FILESYS_TYPE_ARCHIVE
+                                                 : FOSSIL_FILESYS_TYPE_FILE;
+    else if (S_ISDIR(mode))
+        obj->type = FOSSIL_FILESYS_TYPE_DIR;
+    else if (S_ISLNK(mode))
+        obj->type = FOSSIL_FILESYS_TYPE_LINK;
+    else
+        obj->type = FOSSIL_FILESYS_TYPE_UNKNOWN;
+
+    obj->perms.read = (mode & S_IRUSR) != 0;
+    obj->perms.write = (mode & S_IWUSR) != 0;
+    obj->perms.execute = (mode & S_IXUSR) != 0;
+#endif
+}
+
+#if defined(_WIN32)
+/* FILETIME counts 100ns ticks since 1601-01-01. */
+static time_t fossil_filetime_to_time(FILETIME ft)
+{
+    uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (time_t)(ticks / 10000000ULL) - (time_t)11644473600LL;
+}
+#endif
+
+int32_t fossil_io_filesys_dir_list(
+    const char *path,
+    fossil_io_filesys_obj_t *entries,
+    size_t max_entries,
+    size_t *out_count)
+{
+    if (!path || !entries || !out_count)
+        return -1;
+
+    *out_count = 0;
+
+#if defined(_WIN32)
+
+    WIN32_FIND_DATAA fd;
+    char search[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(search, sizeof(search), "%s\\*", path);
+
+    HANDLE h = FindFirstFileA(search, &fd);
+    if (h == INVALID_HANDLE_VALUE)
+        return -1;
+
+    do
+    {
+        if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
+            continue;
+
+        if (*out_count >= max_entries)
+            break;
+
+        char full[FOSSIL_FILESYS_MAX_PATH];
+        snprintf(full, sizeof(full), "%s\\%s", path, fd.cFileName);
+
+        // FindNextFile already returned the metadata; no second lookup.
+        fossil_obj_from_meta(&entries[*out_count], full, fd.dwFileAttributes,
+                             ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow,
+                             fossil_filetime_to_time(fd.ftCreationTime),
+                             fossil_filetime_to_time(fd.ftLastWriteTime),
+                             fossil_filetime_to_time(fd.ftLastAccessTime));
+        (*out_count)++;
+
+    } while (FindNextFileA(h, &fd));
+
+    FindClose(h);
+
+#else
+
+    DIR *dir = opendir(path);
+    if (!dir)
+        return -1;
+
+    struct dirent *entry;
+    int dfd = dirfd(dir);
+
+    while ((entry = readdir(dir)))
+    {
+        if (!strcmp(entry->d_name, ".") ||
+            !strcmp(entry->d_name, ".."))
+            continue;
+
+        if (*out_count >= max_entries)
+            break;
+
+        char full[FOSSIL_FILESYS_MAX_PATH];
+        snprintf(full, sizeof(full), "%s/%s", path, entry->d_name);
+
+        // One directory-relative lstat per entry instead of a full stat().
+        struct stat st;
+        if (fstatat(dfd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            memset(&st, 0, sizeof(st));
+        fossil_obj_from_meta(&entries[*out_count], full, st.st_mode, (uint64_t)st.st_size,
+                             st.st_ctime, st.st_mtime, st.st_atime);
+        (*out_count)++;
+    }
+
+    closedir(dir);
+
+#endif
+
+    return 0;
+}
+
+/* ------------------------------------------------------------
+ * Directory Handles
+ * ------------------------------------------------------------ */
+
+/*
+ * POSIX handles hold an O_DIRECTORY descriptor and resolve names with the
+ * *at calls. The path is kept only to label objects and invalidate the
+ * metadata cache. Windows has no public *at family, so there the path is
+ * the handle and names are joined onto it.
+ */
+struct fossil_io_filesys_dirhandle
+{
+    char *path;
+    size_t path_len;
+#if defined(_WIN32)
+    HANDLE find; /* INVALID_HANDLE_VALUE until the first read */
+    WIN32_FIND_DATAA data;
+    bool done;
+#else
+    int fd;
+    DIR *dir; /* created on the first read; owns fd from then on */
+#endif
+};
+
+/* What one directory-relative stat reports, before it becomes an object. */
+typedef struct
+{
+    fossil_io_filesys_type_t type;
+    uint32_t mode;
+    uint64_t size;
+    uint64_t inode;
+    time_t created_at;
+    time_t modified_at;
+    time_t accessed_at;
+    int64_t modified_ns; /* modified_at with sub-second precision */
+} dirhandle_meta_t;
+
+/* Growable path buffer, so deep trees are never cut at a fixed length. */
+typedef struct
+{
+    char *ptr;
+    size_t cap;
+} fossil_pathbuf_t;
+
+static const char *fossil_pathbuf_join(fossil_pathbuf_t *buf, const char *root, size_t root_len, const char *name)
+{
+    size_t name_len = strlen(name);
+    bool sep = root_len > 0 && name_len > 0 && root[root_len - 1] != '/' && root[root_len - 1] != PATH_SEP;
+    size_t need = root_len + sep + name_len + 1;
+
+    if (need > buf->cap)
+    {
+        char *grown = realloc(buf->ptr, need);
+        if (!grown)
+            return NULL;
+        buf->ptr = grown;
+        buf->cap = need;
+    }
+    memmove(buf->ptr, root, root_len);
+    if (sep)
+        buf->ptr[root_len] = PATH_SEP;
+    memcpy(buf->ptr + root_len + sep, name, name_len + 1);
+    return buf->ptr;
+}
+
+static char *dirhandle_join(const fossil_io_filesys_dirhandle_t *dir, const char *name)
+{
+    fossil_pathbuf_t buf = {NULL, 0};
+    return (char *)fossil_pathbuf_join(&buf, dir->path, dir->path_len, name);
+}
+
+static fossil_io_filesys_dirhandle_t *dirhandle_new(char *path)
+{
+    fossil_io_filesys_dirhandle_t *dir = calloc(1, sizeof(*dir));
+    if (!dir)
+    {
+        free(path);
+        return NULL;
+    }
+    dir->path = path;
+    dir->path_len = strlen(path);
+#if defined(_WIN32)
+    dir->find = INVALID_HANDLE_VALUE;
+#else
+    dir->fd = -1;
+#endif
+    return dir;
+}
+
+/* Changes made through a handle invalidate like their path-based twins. */
+static void dirhandle_forget(const fossil_io_filesys_dirhandle_t *dir, const char *name, bool tree)
+{
+    char path[FOSSIL_FILESYS_MAX_PATH];
+
+    if (!atomic_load_explicit(&fossil_cache.enabled, memory_order_acquire))
+        return;
+    int n = snprintf(path, sizeof(path), "%s%c%s", dir->path, PATH_SEP, name);
+    /* keys this long are never cached */
+    if (n > 0 && (size_t)n < sizeof(path))
+        fossil_cache_forget(path, tree);
+}
+
+static int dirhandle_meta(fossil_io_filesys_dirhandle_t *dir, const char *name, bool follow, dirhandle_meta_t *meta)
+{
+    memset(meta, 0, sizeof(*meta));
+
+#if defined(_WIN32)
+
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    /* the entry just read is answered from the listing */
+    if (name == dir->data.cFileName && dir->find != INVALID_HANDLE_VALUE)
+    {
+        attr.dwFileAttributes = dir->data.dwFileAttributes;
+        attr.ftCreationTime = dir->data.ftCreationTime;
+        attr.ftLastAccessTime = dir->data.ftLastAccessTime;
+        attr.ftLastWriteTime = dir->data.ftLastWriteTime;
+        attr.nFileSizeHigh = dir->data.nFileSizeHigh;
+        attr.nFileSizeLow = dir->data.nFileSizeLow;
+    }
+    else
+    {
+        char *path = dirhandle_join(dir, name);
+        BOOL ok = path && GetFileAttributesExA(path, GetFileExInfoStandard, &attr);
+        free(path);
+        if (!ok)
+            return -1;
+    }
+    (void)follow;
+
+    meta->mode = attr.dwFileAttributes;
+    meta->size = ((uint64_t)attr.nFileSizeHigh << 32) | attr.nFileSizeLow;
+    meta->created_at = fossil_filetime_to_time(attr.ftCreationTime);
+    meta->modified_at = fossil_filetime_to_time(attr.ftLastWriteTime);
+    meta->modified_ns = ((int64_t)(((uint64_t)attr.ftLastWriteTime.dwHighDateTime << 32) |
+                                   attr.ftLastWriteTime.dwLowDateTime) -
+                         116444736000000000LL) * 100;
+    meta->accessed_at = fossil_filetime_to_time(attr.ftLastAccessTime);
+    if (attr.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+        meta->type = FOSSIL_FILESYS_TYPE_LINK;
+    else if (attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        meta->type = FOSSIL_FILESYS_TYPE_DIR;
+    else
+        meta->type = FOSSIL_FILESYS_TYPE_FILE;
+
+#else
+
+    struct stat st;
+    if (fstatat(dir->fd, name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) != 0)
+        return -1;
+
+    meta->mode = (uint32_t)st.st_mode;
+    meta->size = (uint64_t)st.st_size;
+    meta->inode = (uint64_t)st.st_ino;
+    meta->created_at = st.st_ctime;
+    meta->modified_at = st.st_mtime;
+#if defined(__APPLE__)
+    meta->modified_ns = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    meta->modified_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    meta->accessed_at = st.st_atime;
+    if (S_ISREG(st.st_mode))
+        meta->type = FOSSIL_FILESYS_TYPE_FILE;
+    else if (S_ISDIR(st.st_mode))
+        meta->type = FOSSIL_FILESYS_TYPE_DIR;
+    else if (S_ISLNK(st.st_mode))
+        meta->type = FOSSIL_FILESYS_TYPE_LINK;
+    else
+        meta->type = FOSSIL_FILESYS_TYPE_UNKNOWN;
+
+#endif
+
+    return 0;
+}
+
+static int dirhandle_unlink_raw(fossil_io_filesys_dirhandle_t *dir, const char *name, bool is_dir)
+{
+#if defined(_WIN32)
+    char *path = dirhandle_join(dir, name);
+    if (!path)
+        return -1;
+    BOOL ok = is_dir ? RemoveDirectoryA(path) : DeleteFileA(path);
+    /* directory links and junctions go with RemoveDirectory */
+    if (!ok && !is_dir)
+    {
+        DWORD attr = GetFileAttributesA(path);
+        if (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY))
+            ok = RemoveDirectoryA(path);
+    }
+    free(path);
+    return ok ? 0 : -1;
+#else
+    return unlinkat(dir->fd, name, is_dir ? AT_REMOVEDIR : 0);
+#endif
+}
+
+fossil_io_filesys_dirhandle_t *fossil_io_filesys_dirhandle_open(const char *path)
+{
+    if (!path || !*path)
+        return NULL;
+
+    size_t len = strlen(path) + 1;
+    char *copy = malloc(len);
+    if (!copy)
+        return NULL;
+    memcpy(copy, path, len);
+
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        free(copy);
+        return NULL;
+    }
+    return dirhandle_new(copy);
+#else
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        free(copy);
+        return NULL;
+    }
+    fossil_io_filesys_dirhandle_t *dir = dirhandle_new(copy);
+    if (!dir)
+    {
+        close(fd);
+        return NULL;
+    }
+    dir->fd = fd;
+    return dir;
+#endif
+}
+
+fossil_io_filesys_dirhandle_t *fossil_io_filesys_dirhandle_open_dir(fossil_io_filesys_dirhandle_t *dir, const char *name)
+{
+    if (!dir || !name || !*name)
+        return NULL;
+
+    char *path = dirhandle_join(dir, name);
+    if (!path)
+        return NULL;
+
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY) ||
+        (attr & FILE_ATTRIBUTE_REPARSE_POINT))
+    {
+        free(path);
+        return NULL;
+    }
+    return dirhandle_new(path);
+#else
+    int fd = openat(dir->fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+    {
+        free(path);
+        return NULL;
+    }
+    fossil_io_filesys_dirhandle_t *sub = dirhandle_new(path);
+    if (!sub)
+    {
+        close(fd);
+        return NULL;
+    }
+    sub->fd = fd;
+    return sub;
+#endif
+}
+
+void fossil_io_filesys_dirhandle_close(fossil_io_filesys_dirhandle_t *dir)
+{
+    if (!dir)
+        return;
+
+#if defined(_WIN32)
+    if (dir->find != INVALID_HANDLE_VALUE)
+        FindClose(dir->find);
+#else
+    if (dir->dir)
+        closedir(dir->dir);
+    else if (dir->fd >= 0)
+        close(dir->fd);
+#endif
+    free(dir->path);
+    free(dir);
+}
+
+int fossil_io_filesys_dirhandle_fd(const fossil_io_filesys_dirhandle_t *dir)
+{
+#if defined(_WIN32)
+    (void)dir;
+    return -1;
+#else
+    return dir ? dir->fd : -1;
+#endif
+}
+
+const char *fossil_io_filesys_dirhandle_path(const fossil_io_filesys_dirhandle_t *dir)
+{
+    return dir ? dir->path : NULL;
+}
+
+int32_t fossil_io_filesys_dirhandle_read(fossil_io_filesys_dirhandle_t *dir, fossil_io_filesys_dirent_t *entry)
+{
+    if (!dir || !entry)
+        return -1;
+
+#if defined(_WIN32)
+
+    for (;;)
+    {
+        if (dir->done)
+            return 0;
+        if (dir->find == INVALID_HANDLE_VALUE)
+        {
+            char *search = dirhandle_join(dir, "*");
+            if (!search)
+                return -1;
+            dir->find = FindFirstFileA(search, &dir->data);
+            free(search);
+            if (dir->find == INVALID_HANDLE_VALUE)
+            {
+                dir->done = true;
+                return (GetLastError() == ERROR_FILE_NOT_FOUND) ? 0 : -1;
+            }
+        }
+        else if (!FindNextFileA(dir->find, &dir->data))
+        {
+            dir->done = true;
+            return (GetLastError() == ERROR_NO_MORE_FILES) ? 0 : -1;
+        }
+
+        const char *name = dir->data.cFileName;
+        if (!strcmp(name, ".") || !strcmp(name, ".."))
+            continue;
+
+        DWORD attr = dir->data.dwFileAttributes;
+        entry->name = name;
+        entry->type = (attr & FILE_ATTRIBUTE_REPARSE_POINT) ? FOSSIL_FILESYS_TYPE_LINK
+                      : (attr & FILE_ATTRIBUTE_DIRECTORY)   ? FOSSIL_FILESYS_TYPE_DIR
+                                                            : FOSSIL_FILESYS_TYPE_FILE;
+        return 1;
+    }
+
+#else
+
+    if (!dir->dir)
+    {
+        dir->dir = fdopendir(dir->fd);
+        if (!dir->dir)
+            return -1;
+    }
+
+    for (;;)
+    {
+        errno = 0;
+        struct dirent *ent = readdir(dir->dir);
+        if (!ent)
+            return errno ? -1 : 0;
+
+        const char *name = ent->d_name;
+        if (!strcmp(name, ".") || !strcmp(name, ".."))
+            continue;
+
+        entry->name = name;
+        switch (ent->d_type)
+        {
+        case DT_REG:
+            entry->type = FOSSIL_FILESYS_TYPE_FILE;
+            break;
+        case DT_DIR:
+            entry->type = FOSSIL_FILESYS_TYPE_DIR;
+            break;
+        case DT_LNK:
+            entry->type = FOSSIL_FILESYS_TYPE_LINK;
+            break;
+        case DT_UNKNOWN:
+        {
+            /* some filesystems leave d_type to a stat */
+            dirhandle_meta_t meta;
+            entry->type = (dirhandle_meta(dir, name, false, &meta) == 0) ? meta.type : FOSSIL_FILESYS_TYPE_UNKNOWN;
+            break;
+        }
+        default:
+            entry->type = FOSSIL_FILESYS_TYPE_UNKNOWN;
+            break;
+        }
+        return 1;
+    }
+
+#endif
+}
+
+int32_t fossil_io_filesys_dirhandle_open_file(fossil_io_filesys_dirhandle_t *dir, fossil_io_filesys_file_t *f,
+                                              const char *name, const char *mode)
+{
+    if (!dir || !f || !name || !mode)
+        return -1;
+
+    memset(f, 0, sizeof(*f));
+
+    const char *actual_mode = file_mode_resolve(mode);
+    char *path = dirhandle_join(dir, name);
+    if (!path)
+        return -1;
+
+    if (fossil_io_filesys_init(&f->base, path) != 0)
+    {
+        free(path);
+        return -1;
+    }
+
+#if defined(_WIN32)
+    FILE *fp = fopen(path, actual_mode);
+#else
+    int flags = O_RDONLY;
+    if (actual_mode[0] == 'w')
+        flags = O_WRONLY | O_CREAT | O_TRUNC;
+    else if (actual_mode[0] == 'a')
+        flags = O_WRONLY | O_CREAT | O_APPEND;
+    if (strchr(actual_mode, '+'))
+        flags = (flags & ~O_WRONLY) | O_RDWR;
+
+    int fd = openat(dir->fd, name, flags | O_CLOEXEC, 0666);
+    FILE *fp = (fd >= 0) ? fdopen(fd, actual_mode) : NULL;
+    if (!fp && fd >= 0)
+        close(fd);
+#endif
+
+    if (!fp)
+    {
+        free(path);
+        return -1;
+    }
+
+    f->handle = fp;
+    f->fd = fileno(fp);
+    f->is_open = true;
+    f->append_mode = (strchr(actual_mode, 'a') != NULL);
+    f->position = 0;
+    f->flush_level = FOSSIL_FILESYS_FLUSH_FULL;
+
+    if (strpbrk(actual_mode, "wa+"))
+        fossil_cache_forget(path, false);
+    free(path);
+    return 0;
+}
+
+int32_t fossil_io_filesys_dirhandle_stat(fossil_io_filesys_dirhandle_t *dir, const char *name,
+                                         fossil_io_filesys_obj_t *obj, bool follow)
+{
+    char path[FOSSIL_FILESYS_MAX_PATH];
+    dirhandle_meta_t meta;
+
+    if (!dir || !name || !obj)
+        return -1;
+    if (dirhandle_meta(dir, name, follow, &meta) != 0)
+        return -1;
+
+    /* objects hold a fixed-size path; the stat itself never depended on it */
+    snprintf(path, sizeof(path), "%s%c%s", dir->path, PATH_SEP, name);
+    fossil_obj_from_meta(obj, path, meta.mode, meta.size, meta.created_at, meta.modified_at, meta.accessed_at);
+    return 0;
+}
+
+int32_t fossil_io_filesys_dirhandle_unlink(fossil_io_filesys_dirhandle_t *dir, const char *name, bool is_dir)
+{
+    if (!dir || !name)
+        return -1;
+
+    int32_t rc = dirhandle_unlink_raw(dir, name, is_dir);
+    dirhandle_forget(dir, name, is_dir);
+    return rc;
+}
+
+int32_t fossil_io_filesys_dirhandle_mkdir(fossil_io_filesys_dirhandle_t *dir, const char *name, uint32_t mode)
+{
+    if (!dir || !name)
+        return -1;
+
+#if defined(_WIN32)
+    (void)mode;
+    char *path = dirhandle_join(dir, name);
+    int32_t rc = (path && CreateDirectoryA(path, NULL)) ? 0 : -1;
+    free(path);
+#else
+    int32_t rc = mkdirat(dir->fd, name, (mode_t)mode);
+#endif
+    dirhandle_forget(dir, name, false);
+    return rc;
+}
+
+int32_t fossil_io_filesys_dirhandle_rename(fossil_io_filesys_dirhandle_t *src_dir, const char *src_name,
+                                           fossil_io_filesys_dirhandle_t *dest_dir, const char *dest_name,
+                                           uint32_t flags)
+{
+    if (!src_dir || !src_name || !dest_dir || !dest_name)
+        return -1;
+    if ((flags & FOSSIL_FILESYS_RENAME_NOREPLACE) && (flags & FOSSIL_FILESYS_RENAME_EXCHANGE))
+        return -1;
+
+    int32_t rc = -1;
+
+#if defined(_WIN32)
+
+    char *src = dirhandle_join(src_dir, src_name);
+    char *dest = dirhandle_join(dest_dir, dest_name);
+    if (src && dest && !(flags & FOSSIL_FILESYS_RENAME_EXCHANGE))
+    {
+        DWORD how = (flags & FOSSIL_FILESYS_RENAME_NOREPLACE) ? 0 : MOVEFILE_REPLACE_EXISTING;
+        rc = MoveFileExA(src, dest, how) ? 0 : -1;
+    }
+    free(src);
+    free(dest);
+
+#else
+
+    if (flags == 0)
+    {
+        rc = renameat(src_dir->fd, src_name, dest_dir->fd, dest_name);
+    }
+    else
+    {
+#if defined(__linux__) && defined(SYS_renameat2)
+        unsigned int how = (flags & FOSSIL_FILESYS_RENAME_EXCHANGE) ? 2u /* RENAME_EXCHANGE */
+                                                                    : 1u /* RENAME_NOREPLACE */;
+        rc = (int32_t)syscall(SYS_renameat2, src_dir->fd, src_name, dest_dir->fd, dest_name, how);
+        bool unsupported = rc != 0 && (errno == ENOSYS || errno == EINVAL);
+#elif defined(__APPLE__)
+        unsigned int how = (flags & FOSSIL_FILESYS_RENAME_EXCHANGE) ? RENAME_SWAP : RENAME_EXCL;
+        rc = renameatx_np(src_dir->fd, src_name, dest_dir->fd, dest_name, how);
+        bool unsupported = rc != 0 && (errno == ENOTSUP || errno == EINVAL);
+#else
+        bool unsupported = true;
+#endif
+        if (unsupported && (flags & FOSSIL_FILESYS_RENAME_NOREPLACE))
+        {
+            struct stat st;
+            if (fstatat(dest_dir->fd, dest_name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+            {
+                errno = EEXIST;
+                rc = -1;
+            }
+            else
+            {
+                rc = renameat(src_dir->fd, src_name, dest_dir->fd, dest_name);
+            }
+        }
+    }
+
+#endif
+
+    dirhandle_forget(src_dir, src_name, true);
+    dirhandle_forget(dest_dir, dest_name, true);
+    return rc;
+}
+
+int32_t fossil_io_filesys_dirhandle_readlink(fossil_io_filesys_dirhandle_t *dir, const char *name,
+                                             char *target_out, size_t max_len)
+{
+    if (!dir || !name || !target_out || max_len == 0 || max_len > INT32_MAX)
+        return -1;
+
+#if defined(_WIN32)
+    char *path = dirhandle_join(dir, name);
+    int32_t rc = path ? fossil_io_filesys_link_read(path, target_out, max_len) : -1;
+    free(path);
+    return (rc == 0) ? (int32_t)strlen(target_out) : -1;
+#else
+    ssize_t len = readlinkat(dir->fd, name, target_out, max_len);
+    /* a full buffer may mean a longer target */
+    if (len < 0 || (size_t)len >= max_len)
+        return -1;
+    target_out[len] = '\0';
+    return (int32_t)len;
+#endif
+}
+
+/* Remove name from dir and, when it is a directory, everything below it. */
+static int remove_tree_at(fossil_io_filesys_dirhandle_t *dir, const char *name, fossil_io_filesys_type_t type);
+
+static int remove_contents(fossil_io_filesys_dirhandle_t *dir)
+{
+    fossil_io_filesys_dirent_t entry;
+    int32_t more;
+    int rc = 0;
+
+    while ((more = fossil_io_filesys_dirhandle_read(dir, &entry)) > 0)
+    {
+        if (remove_tree_at(dir, entry.name, entry.type) != 0)
+            rc = -1;
+    }
+    return (more < 0) ? -1 : rc;
+}
+
+static int remove_tree_at(fossil_io_filesys_dirhandle_t *dir, const char *name, fossil_io_filesys_type_t type)
+{
+    if (type != FOSSIL_FILESYS_TYPE_DIR)
+        return dirhandle_unlink_raw(dir, name, false);
+
+    fossil_io_filesys_dirhandle_t *sub = fossil_io_filesys_dirhandle_open_dir(dir, name);
+    if (!sub)
+        return -1;
+    int rc = remove_contents(sub);
+    fossil_io_filesys_dirhandle_close(sub);
+
+    if (dirhandle_unlink_raw(dir, name, true) != 0)
+        rc = -1;
+    return rc;
+}
+
+/*
+ * Parallel removal. Every directory is a node that holds its open handle until
+ * the subdirectories it found are gone: workers pop nodes off a shared stack,
+ * unlink plain entries by name as they are read, and push each subdirectory as
+ * a new node. Whichever thread drops a node's count to zero removes it from its
+ * parent and carries the count up, so directories go bottom-up as they empty.
+ * The stack is LIFO, which keeps the set of open directories close to the
+ * depth of the tree.
+ */
+#if defined(_WIN32)
+typedef SRWLOCK rmtree_mutex_t;
+typedef CONDITION_VARIABLE rmtree_cond_t;
+#define RMTREE_MUTEX_INIT SRWLOCK_INIT
+#define RMTREE_COND_INIT CONDITION_VARIABLE_INIT
+#define rmtree_lock(l) AcquireSRWLockExclusive(l)
+#define rmtree_unlock(l) ReleaseSRWLockExclusive(l)
+#define rmtree_wait(c, l) SleepConditionVariableSRW((c), (l), INFINITE, 0)
+#define rmtree_signal(c) WakeConditionVariable(c)
+#define rmtree_broadcast(c) WakeAllConditionVariable(c)
+#else
+typedef pthread_mutex_t rmtree_mutex_t;
+typedef pthread_cond_t rmtree_cond_t;
+#define RMTREE_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#define RMTREE_COND_INIT PTHREAD_COND_INITIALIZER
+#define rmtree_lock(l) pthread_mutex_lock(l)
+#define rmtree_unlock(l) pthread_mutex_unlock(l)
+#define rmtree_wait(c, l) pthread_cond_wait((c), (l))
+#define rmtree_signal(c) pthread_cond_signal(c)
+#define rmtree_broadcast(c) pthread_cond_broadcast(c)
+#endif
+
+typedef struct rmtree_node rmtree_node_t;
+
+struct rmtree_node
+{
+    rmtree_node_t *parent;              /* NULL for the root */
+    fossil_io_filesys_dirhandle_t *dir; /* open until the count drops to zero */
+    atomic_size_t pending;              /* live subdirectories, plus one for the scan */
+    char name[];                        /* entry name within the parent */
+};
+
+typedef struct
+{
+    rmtree_mutex_t lock;
+    rmtree_cond_t wake;
+    rmtree_node_t **stack;
+    size_t count;
+    size_t capacity;
+    bool done; /* the root is gone, so nothing can be pushed again */
+
+    const char *root_path;
+    atomic_int failed;
+} rmtree_ctx_t;
+
+static rmtree_node_t *rmtree_node_new(rmtree_node_t *parent, const char *name)
+{
+    size_t len = strlen(name) + 1;
+    rmtree_node_t *node = malloc(sizeof(*node) + len);
+    if (!node)
+        return NULL;
+    node->parent = parent;
+    node->dir = NULL;
+    atomic_init(&node->pending, 1);
+    memcpy(node->name, name, len);
+    return node;
+}
+
+static bool rmtree_push(rmtree_ctx_t *ctx, rmtree_node_t *node)
+{
+    rmtree_lock(&ctx->lock);
+    if (ctx->count == ctx->capacity)
+    {
+        size_t cap = ctx->capacity ? ctx->capacity * 2 : 64;
+        rmtree_node_t **grown = realloc(ctx->stack, cap * sizeof(*grown));
+        if (!grown)
+        {
+            rmtree_unlock(&ctx->lock);
+            return false;
+        }
+        ctx->stack = grown;
+        ctx->capacity = cap;
+    }
+    ctx->stack[ctx->count++] = node;
+    rmtree_signal(&ctx->wake);
+    rmtree_unlock(&ctx->lock);
+    return true;
+}
+
+/* Drop one reference; the last one removes the directory and moves up. */
+static void rmtree_release(rmtree_ctx_t *ctx, rmtree_node_t *node)
+{
+    while (node && atomic_fetch_sub(&node->pending, 1) == 1)
+    {
+        rmtree_node_t *parent = node->parent;
+        int rc;
+
+        fossil_io_filesys_dirhandle_close(node->dir);
+        if (parent)
+        {
+            rc = dirhandle_unlink_raw(parent->dir, node->name, true);
+        }
+        else
+        {
+#if defined(_WIN32)
+            rc = RemoveDirectoryA(ctx->root_path) ? 0 : -1;
+#else
+            rc = rmdir(ctx->root_path);
+#endif
+            rmtree_lock(&ctx->lock);
+            ctx->done = true;
+            rmtree_broadcast(&ctx->wake);
+            rmtree_unlock(&ctx->lock);
+        }
+        if (rc != 0)
+            atomic_store(&ctx->failed, 1);
+
+        free(node);
+        node = parent;
+    }
+}
+
+static void rmtree_scan(rmtree_ctx_t *ctx, rmtree_node_t *node)
+{
+    if (!node->dir)
+        node->dir = fossil_io_filesys_dirhandle_open_dir(node->parent->dir, node->name);
+
+    if (!node->dir)
+    {
+        atomic_store(&ctx->failed, 1);
+        rmtree_release(ctx, node);
+        return;
+    }
+
+    fossil_io_filesys_dirent_t entry;
+    int32_t more;
+
+    while ((more = fossil_io_filesys_dirhandle_read(node->dir, &entry)) > 0)
+    {
+        int rc;
+
+        if (entry.type != FOSSIL_FILESYS_TYPE_DIR)
+        {
+            rc = dirhandle_unlink_raw(node->dir, entry.name, false);
+        }
+        else
+        {
+            /* counted before it is visible, since another worker may finish it first */
+            rmtree_node_t *child = rmtree_node_new(node, entry.name);
+            atomic_fetch_add(&node->pending, 1);
+            if (child && rmtree_push(ctx, child))
+                continue;
+            atomic_fetch_sub(&node->pending, 1);
+            free(child);
+            rc = remove_tree_at(node->dir, entry.name, entry.type);
+        }
+        if (rc != 0)
+            atomic_store(&ctx->failed, 1);
+    }
+    if (more < 0)
+        atomic_store(&ctx->failed, 1);
+
+    rmtree_release(ctx, node);
+}
+
+static void rmtree_worker(void *arg, size_t index)
+{
+    rmtree_ctx_t *ctx = (rmtree_ctx_t *)arg;
+    (void)index;
+
+    for (;;)
+    {
+        rmtree_lock(&ctx->lock);
+        while (ctx->count == 0 && !ctx->done)
+            rmtree_wait(&ctx->wake, &ctx->lock);
+        rmtree_node_t *node = ctx->count ? ctx->stack[--ctx->count] : NULL;
+        rmtree_unlock(&ctx->lock);
+
+        if (!node)
+            break;
+        rmtree_scan(ctx, node);
+    }
+}
+
+/*
+ * Empty a directory and remove it, on up to `threads` workers (0 = one per
+ * CPU). The caller scans the top level first, so a directory without
+ * subdirectories never starts a thread.
+ */
+static int remove_recursive(const char *path, size_t threads)
+{
+    rmtree_node_t *root = rmtree_node_new(NULL, "");
+    if (!root)
+        return -1;
+    root->dir = fossil_io_filesys_dirhandle_open(path);
+    if (!root->dir)
+    {
+        free(root);
+        return -1;
+    }
+
+    rmtree_ctx_t ctx = {RMTREE_MUTEX_INIT, RMTREE_COND_INIT, NULL, 0, 0, false, path, 0};
+    atomic_init(&ctx.failed, 0);
+
+    rmtree_scan(&ctx, root);
+
+    if (!ctx.done)
+    {
+        if (!threads)
+            threads = fossil_cpu_count();
+        fossil_run_workers(threads, rmtree_worker, &ctx);
+    }
+
+    free(ctx.stack);
+#if !defined(_WIN32)
+    pthread_mutex_destroy(&ctx.lock);
+    pthread_cond_destroy(&ctx.wake);
+#endif
+    return atomic_load(&ctx.failed) ? -1 : 0;
+}
+
+static int remove_path(const char *path, size_t threads)
+{
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES)
+        return -1;
+
+    if ((attr & FILE_ATTRIBUTE_DIRECTORY) && !(attr & FILE_ATTRIBUTE_REPARSE_POINT))
+        return remove_recursive(path, threads);
+    if (attr & FILE_ATTRIBUTE_DIRECTORY)
+        return RemoveDirectoryA(path) ? 0 : -1;
+    return DeleteFileA(path) ? 0 : -1;
+#else
+    struct stat st;
+    if (lstat(path, &st) != 0)
+        return -1;
+
+    return S_ISDIR(st.st_mode) ? remove_recursive(path, threads) : unlink(path);
+#endif
+}
+
+/*
+ * Background removal: the tree is renamed to a hidden sibling, which is atomic
+ * and leaves the original name free at once, and a detached thread deletes it.
+ */
+typedef struct
+{
+    char *path;
+    size_t threads;
+} rmtree_job_t;
+
+static struct
+{
+    rmtree_mutex_t lock;
+    rmtree_cond_t idle;
+    size_t active;
+    bool failed; /* since the last wait */
+} rmtree_bg = {RMTREE_MUTEX_INIT, RMTREE_COND_INIT, 0, false};
+
+static void rmtree_job_run(rmtree_job_t *job)
+{
+    int rc = remove_path(job->path, job->threads);
+    free(job->path);
+    free(job);
+
+    rmtree_lock(&rmtree_bg.lock);
+    if (rc != 0)
+        rmtree_bg.failed = true;
+    if (--rmtree_bg.active == 0)
+        rmtree_broadcast(&rmtree_bg.idle);
+    rmtree_unlock(&rmtree_bg.lock);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI rmtree_job_entry(LPVOID p)
+{
+    rmtree_job_run((rmtree_job_t *)p);
+    return 0;
+}
+#else
+static void *rmtree_job_entry(void *p)
+{
+    rmtree_job_run((rmtree_job_t *)p);
+    return NULL;
+}
+#endif
+
+/* "dir/name" -> "dir/.name.rm-<pid>-<seq>", in the same directory so the rename stays atomic. */
+static char *rmtree_aside_name(const char *path)
+{
+    static atomic_uint seq;
+    fossil_io_filesys_pathview_t name = fossil_io_filesys_pathview_filename(fossil_io_filesys_pathview(path));
+
+    if (name.len == 0 || (name.ptr[0] == '.' && (name.len == 1 || (name.len == 2 && name.ptr[1] == '.'))))
+        return NULL;
+
+#if defined(_WIN32)
+    long pid = (long)GetCurrentProcessId();
+#else
+    long pid = (long)getpid();
+#endif
+    size_t prefix = (size_t)(name.ptr - path);
+    size_t cap = prefix + name.len + 48;
+    char *aside = malloc(cap);
+    if (aside)
+        snprintf(aside, cap, "%.*s.%.*s.rm-%ld-%u", (int)prefix, path, (int)name.len, name.ptr,
+                 pid, atomic_fetch_add(&seq, 1));
+    return aside;
+}
+
+/* 0 once the tree is out of the way and queued, -1 to remove it in place instead. */
+static int rmtree_background(const char *path, size_t threads)
+{
+    rmtree_job_t *job = malloc(sizeof(*job));
+    char *aside = rmtree_aside_name(path);
+    if (!job || !aside)
+    {
+        free(job);
+        free(aside);
+        return -1;
+    }
+
+#if defined(_WIN32)
+    bool moved = MoveFileExA(path, aside, 0) != 0;
+#else
+    bool moved = rename(path, aside) == 0;
+#endif
+    if (!moved)
+    {
+        free(job);
+        free(aside);
+        return -1;
+    }
+
+    job->path = aside;
+    job->threads = threads;
+
+    rmtree_lock(&rmtree_bg.lock);
+    rmtree_bg.active++;
+    rmtree_unlock(&rmtree_bg.lock);
+
+#if defined(_WIN32)
+    HANDLE thread = CreateThread(NULL, 0, rmtree_job_entry, job, 0, NULL);
+    bool started = thread != NULL;
+    if (started)
+        CloseHandle(thread);
+#else
+    pthread_t thread;
+    bool started = pthread_create(&thread, NULL, rmtree_job_entry, job) == 0;
+    if (started)
+        pthread_detach(thread);
+#endif
+    /* the name is already free, so finish the job here rather than fail */
+    if (!started)
+        rmtree_job_run(job);
+    return 0;
+}
+
+int32_t fossil_io_filesys_remove_tree(const char *path, const fossil_io_filesys_remove_opts_t *opts)
+{
+    if (!path)
+        return -1;
+
+    size_t threads = opts ? opts->threads : 0;
+    int32_t rc = -1;
+
+    if (opts && opts->background)
+        rc = rmtree_background(path, threads);
+    if (rc != 0)
+        rc = remove_path(path, threads);
+
+    fossil_cache_forget(path, true);
+    return rc;
+}
+
+int32_t fossil_io_filesys_remove_wait(void)
+{
+    rmtree_lock(&rmtree_bg.lock);
+    while (rmtree_bg.active > 0)
+        rmtree_wait(&rmtree_bg.idle, &rmtree_bg.lock);
+    bool failed = rmtree_bg.failed;
+    rmtree_bg.failed = false;
+    rmtree_unlock(&rmtree_bg.lock);
+    return failed ? -1 : 0;
+}
+
+static int dir_walk_at(
+    fossil_io_filesys_dirhandle_t *dir,
+    int (*callback)(const fossil_io_filesys_obj_t *, void *),
+    void *user_data)
+{
+    fossil_io_filesys_dirent_t entry;
+    fossil_io_filesys_obj_t obj;
+    int32_t more;
+
+    while ((more = fossil_io_filesys_dirhandle_read(dir, &entry)) > 0)
+    {
+        if (fossil_io_filesys_dirhandle_stat(dir, entry.name, &obj, false) != 0)
+            return -1;
+
+        /* invoke callback */
+        int rc = callback(&obj, user_data);
+        if (rc != 0)
+            return rc;
+
+        if (entry.type != FOSSIL_FILESYS_TYPE_DIR)
+            continue;
+
+        fossil_io_filesys_dirhandle_t *sub = fossil_io_filesys_dirhandle_open_dir(dir, entry.name);
+        if (!sub)
+            return -1;
+        rc = dir_walk_at(sub, callback, user_data);
+        fossil_io_filesys_dirhandle_close(sub);
+        if (rc != 0)
+            return rc;
+    }
+
+    return (more < 0) ? -1 : 0;
+}
+
+static int dir_walk_internal(
+    const char *path,
+    int (*callback)(const fossil_io_filesys_obj_t *, void *),
+    void *user_data)
+{
+    fossil_io_filesys_obj_t obj;
+    memset(&obj, 0, sizeof(obj));
+
+    if (fossil_io_filesys_stat(path, &obj) != 0)
+        return -1;
+
+    /* invoke callback */
+    int rc = callback(&obj, user_data);
+    if (rc != 0)
+        return rc;
+
+    if (obj.type != FOSSIL_FILESYS_TYPE_DIR)
+        return 0;
+
+    fossil_io_filesys_dirhandle_t *dir = fossil_io_filesys_dirhandle_open(path);
+    if (!dir)
+        return -1;
+    rc = dir_walk_at(dir, callback, user_data);
+    fossil_io_filesys_dirhandle_close(dir);
+    return rc;
+}
+
+int32_t fossil_io_filesys_dir_walk(
+    const char *path,
+    int (*callback)(const fossil_io_filesys_obj_t *, void *),
+    void *user_data)
+{
+    if (!path || !callback)
+        return -1;
+
+    return dir_walk_internal(path, callback, user_data);
+}
+
+/* ------------------------------------------------------------
+ * Parallel Directory Walk
+ * ------------------------------------------------------------ */
+
+#if !defined(_WIN32)
+
+/* Directories queued with an open fd; beyond this they are reopened by path. */
+#define FOSSIL_WALK_MAX_HELD_FDS 256
+
+/* Compact per-entry record; expanded into a full object only at emit time. */
+typedef struct
+{
+    char *path;
+    uint32_t mode;
+    uint64_t size;
+    time_t created_at;
+    time_t modified_at;
+    time_t accessed_at;
+} walk_record_t;
+
+typedef struct
+{
+    int fd; /* open directory fd, or -1 to open by path */
+    char *path;
+} walk_task_t;
+
+/* Per-worker deque: the owner pops from the tail, thieves steal from the head. */
+typedef struct
+{
+    pthread_mutex_t lock;
+    walk_task_t *items;
+    size_t head;
+    size_t count;
+    size_t capacity;
+} walk_deque_t;
+
+typedef struct
+{
+    int (*callback)(const fossil_io_filesys_obj_t *, void *);
+    int (*record_callback)(const walk_record_t *, void *); /* instead of callback */
+    void *user_data;
+    bool ordered;
+    bool skip_stat;
+
+    walk_deque_t *queues;
+    size_t queue_count;
+
+    atomic_size_t queued;  /* tasks sitting in deques */
+    atomic_size_t pending; /* tasks queued or being scanned */
+    atomic_int stop;       /* first non-zero callback result */
+    atomic_int failed;     /* a directory could not be read */
+
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+
+    pthread_mutex_t record_lock;
+    walk_record_t *records;
+    size_t record_count;
+    size_t record_capacity;
+} walk_ctx_t;
+
+static char *walk_path_dup(const char *path)
+{
+    size_t len = strlen(path) + 1;
+    char *copy = malloc(len);
+    if (copy)
+        memcpy(copy, path, len);
+    return copy;
+}
+
+static void walk_record_to_obj(const walk_record_t *rec, fossil_io_filesys_obj_t *obj)
+{
+    fossil_obj_from_meta(obj, rec->path, rec->mode, rec->size,
+                         rec->created_at, rec->modified_at, rec->accessed_at);
+}
+
+static uint32_t walk_mode_from_dtype(unsigned char d_type)
+{
+    switch (d_type)
+    {
+    case DT_REG:
+        return S_IFREG;
+    case DT_DIR:
+        return S_IFDIR;
+    case DT_LNK:
+        return S_IFLNK;
+    case DT_FIFO:
+        return S_IFIFO;
+    case DT_SOCK:
+        return S_IFSOCK;
+    case DT_CHR:
+        return S_IFCHR;
+    case DT_BLK:
+        return S_IFBLK;
+    default:
+        return 0;
+    }
+}
+
+static void walk_stop(walk_ctx_t *ctx, int rc)
+{
+    int expected = 0;
+    atomic_compare_exchange_strong(&ctx->stop, &expected, rc);
+
+    pthread_mutex_lock(&ctx->idle_lock);
+    pthread_cond_broadcast(&ctx->idle_cond);
+    pthread_mutex_unlock(&ctx->idle_lock);
+}
+
+/* Hand an entry to the callback, or stash it for the ordered pass. */
+static void walk_emit(walk_ctx_t *ctx, walk_record_t *rec)
+{
+    if (ctx->ordered)
+    {
+        pthread_mutex_lock(&ctx->record_lock);
+        if (ctx->record_count == ctx->record_capacity)
+        {
+            size_t cap = ctx->record_capacity ? ctx->record_capacity * 2 : 1024;
+            walk_record_t *grown = realloc(ctx->records, cap * sizeof(*grown));
+            if (!grown)
+            {
+                pthread_mutex_unlock(&ctx->record_lock);
+                free(rec->path);
+                atomic_store(&ctx->failed, 1);
+                return;
+            }
+            ctx->records = grown;
+            ctx->record_capacity = cap;
+        }
+        ctx->records[ctx->record_count++] = *rec;
+        pthread_mutex_unlock(&ctx->record_lock);
+        return;
+    }
+
+    int rc;
+    if (ctx->record_callback)
+    {
+        rc = ctx->record_callback(rec, ctx->user_data);
+    }
+    else
+    {
+        fossil_io_filesys_obj_t obj;
+        walk_record_to_obj(rec, &obj);
+        rc = ctx->callback(&obj, ctx->user_data);
+    }
+    free(rec->path);
+
+    if (rc != 0)
+        walk_stop(ctx, rc);
+}
+
+static void walk_push(walk_ctx_t *ctx, size_t worker, walk_task_t task)
+{
+    walk_deque_t *q = &ctx->queues[worker];
+
+    pthread_mutex_lock(&q->lock);
+    if (q->count == q->capacity)
+    {
+        size_t cap = q->capacity ? q->capacity * 2 : 64;
+        walk_task_t *items = malloc(cap * sizeof(*items));
+        if (!items)
+        {
+            pthread_mutex_unlock(&q->lock);
+            if (task.fd >= 0)
+                close(task.fd);
+            free(task.path);
+            atomic_store(&ctx->failed, 1);
+            return;
+        }
+        for (size_t i = 0; i < q->count; ++i)
+            items[i] = q->items[(q->head + i) % q->capacity];
+        free(q->items);
+        q->items = items;
+        q->head = 0;
+        q->capacity = cap;
+    }
+    q->items[(q->head + q->count) % q->capacity] = task;
+    q->count++;
+    atomic_fetch_add(&ctx->pending, 1);
+    atomic_fetch_add(&ctx->queued, 1);
+    pthread_mutex_unlock(&q->lock);
+
+    /* Sleepers re-check `queued` under idle_lock, so this cannot be missed. */
+    pthread_mutex_lock(&ctx->idle_lock);
+    pthread_cond_signal(&ctx->idle_cond);
+    pthread_mutex_unlock(&ctx->idle_lock);
+}
+
+static bool walk_take(walk_ctx_t *ctx, size_t index, bool steal, walk_task_t *out)
+{
+    walk_deque_t *q = &ctx->queues[index];
+    bool found = false;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->count > 0)
+    {
+        if (steal)
+        {
+            *out = q->items[q->head];
+            q->head = (q->head + 1) % q->capacity;
+        }
+        else
+        {
+            *out = q->items[(q->head + q->count - 1) % q->capacity];
+        }
+        q->count--;
+        atomic_fetch_sub(&ctx->queued, 1);
+        found = true;
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return found;
+}
+
+static void walk_scan(walk_ctx_t *ctx, size_t worker, walk_task_t task)
+{
+    int fd = task.fd;
+    if (fd < 0)
+        fd = open(task.path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    DIR *dir = (fd >= 0) ? fdopendir(fd) : NULL;
+    if (!dir)
+    {
+        if (fd >= 0)
+            close(fd);
+        free(task.path);
+        atomic_store(&ctx->failed, 1);
+        return;
+    }
+
+    size_t base_len = strlen(task.path);
+    int dfd = dirfd(dir);
+    struct dirent *entry;
+
+    while (atomic_load(&ctx->stop) == 0 && (entry = readdir(dir)))
+    {
+        const char *name = entry->d_name;
+        if (!strcmp(name, ".") || !strcmp(name, ".."))
+            continue;
+
+        size_t name_len = strlen(name);
+        walk_record_t rec;
+        memset(&rec, 0, sizeof(rec));
+
+        rec.path = malloc(base_len + name_len + 2);
+        if (!rec.path)
+        {
+            atomic_store(&ctx->failed, 1);
+            break;
+        }
+        memcpy(rec.path, task.path, base_len);
+        rec.path[base_len] = '/';
+        memcpy(rec.path + base_len + 1, name, name_len + 1);
+
+        rec.mode = walk_mode_from_dtype(entry->d_type);
+        if (!ctx->skip_stat || rec.mode == 0)
+        {
+            struct stat st;
+            if (fstatat(dfd, name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+            {
+                rec.mode = st.st_mode;
+                rec.size = (uint64_t)st.st_size;
+                rec.created_at = st.st_ctime;
+                rec.modified_at = st.st_mtime;
+                rec.accessed_at = st.st_atime;
+            }
+        }
+
+        bool is_dir = S_ISDIR(rec.mode);
+        walk_task_t child = {-1, NULL};
+
+        if (is_dir)
+        {
+            child.path = walk_path_dup(rec.path);
+            if (!child.path)
+                atomic_store(&ctx->failed, 1);
+
+            if (child.path && atomic_load(&ctx->queued) < FOSSIL_WALK_MAX_HELD_FDS)
+                child.fd = openat(dfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        }
+
+        walk_emit(ctx, &rec);
+
+        if (child.path)
+            walk_push(ctx, worker, child);
+    }
+
+    closedir(dir);
+    free(task.path);
+}
+
+static void walk_worker(void *arg, size_t index)
+{
+    walk_ctx_t *ctx = (walk_ctx_t *)arg;
+    size_t self = index % ctx->queue_count;
+
+    for (;;)
+    {
+        walk_task_t task;
+        bool found = walk_take(ctx, self, false, &task);
+
+        for (size_t i = 1; !found && i < ctx->queue_count; ++i)
+            found = walk_take(ctx, (self + i) % ctx->queue_count, true, &task);
+
+        if (found)
+        {
+            if (atomic_load(&ctx->stop) != 0)
+            {
+                if (task.fd >= 0)
+                    close(task.fd);
+                free(task.path);
+            }
+            else
+            {
+                walk_scan(ctx, self, task);
+            }
+
+            if (atomic_fetch_sub(&ctx->pending, 1) == 1)
+            {
+                pthread_mutex_lock(&ctx->idle_lock);
+                pthread_cond_broadcast(&ctx->idle_cond);
+                pthread_mutex_unlock(&ctx->idle_lock);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&ctx->idle_lock);
+        while (atomic_load(&ctx->queued) == 0 &&
+               atomic_load(&ctx->pending) != 0 &&
+               atomic_load(&ctx->stop) == 0)
+            pthread_cond_wait(&ctx->idle_cond, &ctx->idle_lock);
+        bool done = atomic_load(&ctx->pending) == 0 ||
+                    (atomic_load(&ctx->stop) != 0 && atomic_load(&ctx->queued) == 0);
+        pthread_mutex_unlock(&ctx->idle_lock);
+
+        if (done)
+            break;
+    }
+}
+
+/* Order so that a directory sorts directly before its own contents. */
+static int walk_record_cmp(const void *a, const void *b)
+{
+    const unsigned char *pa = (const unsigned char *)((const walk_record_t *)a)->path;
+    const unsigned char *pb = (const unsigned char *)((const walk_record_t *)b)->path;
+
+    while (*pa && *pa == *pb)
+    {
+        ++pa;
+        ++pb;
+    }
+
+    int ka = (*pa == '\0') ? 0 : (*pa == '/') ? 1 : *pa + 2;
+    int kb = (*pb == '\0') ? 0 : (*pb == '/') ? 1 : *pb + 2;
+    return ka - kb;
+}
+
+static int32_t walk_parallel_run(
+    const char *path,
+    int (*callback)(const fossil_io_filesys_obj_t *, void *),
+    int (*record_callback)(const walk_record_t *, void *),
+    void *user_data,
+    const fossil_io_filesys_walk_opts_t *opts)
+{
+    struct stat st;
+    if (lstat(path, &st) != 0)
+        return -1;
+
+    walk_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.callback = callback;
+    ctx.record_callback = record_callback;
+    ctx.user_data = user_data;
+    ctx.ordered = opts ? opts->ordered : false;
+    ctx.skip_stat = opts ? opts->skip_stat : false;
+    atomic_init(&ctx.queued, 0);
+    atomic_init(&ctx.pending, 0);
+    atomic_init(&ctx.stop, 0);
+    atomic_init(&ctx.failed, 0);
+
+    size_t threads = (opts && opts->threads) ? opts->threads : fossil_cpu_count();
+
+    ctx.queue_count = threads;
+    ctx.queues = calloc(threads, sizeof(*ctx.queues));
+    if (!ctx.queues)
+        return -1;
+    for (size_t i = 0; i < threads; ++i)
+        pthread_mutex_init(&ctx.queues[i].lock, NULL);
+    pthread_mutex_init(&ctx.idle_lock, NULL);
+    pthread_cond_init(&ctx.idle_cond, NULL);
+    pthread_mutex_init(&ctx.record_lock, NULL);
+
+    /* the root is always emitted first */
+    walk_record_t root;
+    root.path = walk_path_dup(path);
+    root.mode = st.st_mode;
+    root.size = (uint64_t)st.st_size;
+    root.created_at = st.st_ctime;
+    root.modified_at = st.st_mtime;
+    root.accessed_at = st.st_atime;
+
+    if (!root.path)
+    {
+        atomic_store(&ctx.failed, 1);
+    }
+    else if (S_ISDIR(st.st_mode))
+    {
+        walk_task_t task = {-1, walk_path_dup(path)};
+        walk_emit(&ctx, &root);
+        if (task.path && atomic_load(&ctx.stop) == 0)
+        {
+            walk_push(&ctx, 0, task);
+            fossil_run_workers(threads, walk_worker, &ctx);
+        }
+        else
+        {
+            free(task.path);
+        }
+    }
+    else
+    {
+        walk_emit(&ctx, &root);
+    }
+
+    int32_t rc = atomic_load(&ctx.stop);
+
+    if (ctx.ordered)
+    {
+        qsort(ctx.records, ctx.record_count, sizeof(*ctx.records), walk_record_cmp);
+
+        for (size_t i = 0; i < ctx.record_count; ++i)
+        {
+            if (rc == 0 && record_callback)
+            {
+                rc = record_callback(&ctx.records[i], user_data);
+            }
+            else if (rc == 0)
+            {
+                fossil_io_filesys_obj_t obj;
+                walk_record_to_obj(&ctx.records[i], &obj);
+                rc = callback(&obj, user_data);
+            }
+            free(ctx.records[i].path);
+        }
+        free(ctx.records);
+    }
+
+    for (size_t i = 0; i < threads; ++i)
+    {
+        walk_deque_t *q = &ctx.queues[i];
+        for (size_t j = 0; j < q->count; ++j)
+        {
+            walk_task_t *t = &q->items[(q->head + j) % q->capacity];
+            if (t->fd >= 0)
+                close(t->fd);
+            free(t->path);
+        }
+        free(q->items);
+        pthread_mutex_destroy(&q->lock);
+    }
+    free(ctx.queues);
+    pthread_mutex_destroy(&ctx.idle_lock);
+    pthread_cond_destroy(&ctx.idle_cond);
+    pthread_mutex_destroy(&ctx.record_lock);
+
+    if (rc != 0)
+        return rc;
+    return atomic_load(&ctx.failed) ? -1 : 0;
+}
+
+typedef struct
+{
+    int (*fn)(const char *, uint64_t, uint32_t, void *);
+    void *user_data;
+} walk_files_ctx_t;
+
+static int walk_files_record(const walk_record_t *rec, void *user_data)
+{
+    walk_files_ctx_t *files = (walk_files_ctx_t *)user_data;
+    if (!S_ISREG(rec->mode))
+        return 0;
+    return files->fn(rec->path, rec->size, rec->mode, files->user_data);
+}
+
+#else
+
+static int walk_files_at(fossil_io_filesys_dirhandle_t *dir,
+                         int (*fn)(const char *, uint64_t, uint32_t, void *), void *user_data)
+{
+    fossil_io_filesys_dirent_t entry;
+    fossil_pathbuf_t full = {NULL, 0};
+    int32_t more = 0;
+    int rc = 0;
+
+    while (rc == 0 && (more = fossil_io_filesys_dirhandle_read(dir, &entry)) > 0)
+    {
+        if (entry.type == FOSSIL_FILESYS_TYPE_DIR)
+        {
+            fossil_io_filesys_dirhandle_t *sub = fossil_io_filesys_dirhandle_open_dir(dir, entry.name);
+            rc = sub ? walk_files_at(sub, fn, user_data) : -1;
+            fossil_io_filesys_dirhandle_close(sub);
+            continue;
+        }
+
+        dirhandle_meta_t meta;
+        if (entry.type != FOSSIL_FILESYS_TYPE_FILE || dirhandle_meta(dir, entry.name, false, &meta) != 0)
+            continue;
+        if (!fossil_pathbuf_join(&full, dir->path, dir->path_len, entry.name))
+            rc = -1;
+        else
+            rc = fn(full.ptr, meta.size, meta.mode, user_data);
+    }
+
+    free(full.ptr);
+    return (rc == 0 && more < 0) ? -1 : rc;
+}
+
+#endif
+
+/*
+ * Hand every regular file below path to fn, one call at a time, with its
+ * full path. Objects cap their path at FOSSIL_FILESYS_MAX_PATH; this does not.
+ */
+static int walk_regular_files(const char *path, size_t threads,
+                              int (*fn)(const char *, uint64_t, uint32_t, void *), void *user_data)
+{
+#if defined(_WIN32)
+    (void)threads;
+    fossil_io_filesys_dirhandle_t *dir = fossil_io_filesys_dirhandle_open(path);
+    if (!dir)
+        return -1;
+    int rc = walk_files_at(dir, fn, user_data);
+    fossil_io_filesys_dirhandle_close(dir);
+    return rc;
+#else
+    /* ordered delivery serialises fn */
+    walk_files_ctx_t files = {fn, user_data};
+    fossil_io_filesys_walk_opts_t opts = {threads, true, false};
+    return walk_parallel_run(path, NULL, walk_files_record, &files, &opts);
+#endif
+}
+
+int32_t fossil_io_filesys_dir_walk_parallel(
+    const char *path,
+    int (*callback)(const fossil_io_filesys_obj_t *, void *),
+    void *user_data,
+    const fossil_io_filesys_walk_opts_t *opts)
+{
+    if (!path || !callback)
+        return -1;
+
+#if defined(_WIN32)
+    (void)opts;
+    return dir_walk_internal(path, callback, user_data);
+#else
+    return walk_parallel_run(path, callback, NULL, user_data, opts);
+#endif
+}
+
+/* ------------------------------------------------------------
+ * Directory Snapshot
+ * ------------------------------------------------------------ */
+
+/* Grow the per-entry columns so at least `need` entries fit. */
+static int snapshot_reserve(fossil_io_filesys_dir_snapshot_t *snap, size_t need)
+{
+    if (need <= snap->capacity)
+        return 0;
+
+    size_t cap = snap->capacity ? snap->capacity * 2 : 256;
+    while (cap < need)
+        cap *= 2;
+
+    size_t *offsets = realloc(snap->name_offsets, cap * sizeof(*offsets));
+    if (offsets)
+        snap->name_offsets = offsets;
+    uint8_t *types = realloc(snap->types, cap * sizeof(*types));
+    if (types)
+        snap->types = types;
+    uint64_t *sizes = realloc(snap->sizes, cap * sizeof(*sizes));
+    if (sizes)
+        snap->sizes = sizes;
+    uint32_t *modes = realloc(snap->modes, cap * sizeof(*modes));
+    if (modes)
+        snap->modes = modes;
+    time_t *mtimes = realloc(snap->mtimes, cap * sizeof(*mtimes));
+    if (mtimes)
+        snap->mtimes = mtimes;
+
+    if (!offsets || !types || !sizes || !modes || !mtimes)
+        return -1;
+    snap->capacity = cap;
+    return 0;
+}
+
+/* Append an entry's name to the arena and reserve its column slot. */
+static int snapshot_push_name(fossil_io_filesys_dir_snapshot_t *snap, const char *name, size_t len)
+{
+    if (snapshot_reserve(snap, snap->count + 1) != 0)
+        return -1;
+
+    if (snap->names_length + len + 1 > snap->names_capacity)
+    {
+        size_t cap = snap->names_capacity ? snap->names_capacity * 2 : 16384;
+        while (cap < snap->names_length + len + 1)
+            cap *= 2;
+        char *names = realloc(snap->names, cap);
+        if (!names)
+            return -1;
+        snap->names = names;
+        snap->names_capacity = cap;
+    }
+
+    snap->name_offsets[snap->count] = snap->names_length;
+    memcpy(snap->names + snap->names_length, name, len + 1);
+    snap->names_length += len + 1;
+    return 0;
+}
+
+static uint8_t snapshot_type(const char *name, uint32_t mode)
+{
+#if defined(_WIN32)
+    if (mode & FILE_ATTRIBUTE_DIRECTORY)
+        return FOSSIL_FILESYS_TYPE_DIR;
+    if (mode & FILE_ATTRIBUTE_REPARSE_POINT)
+        return FOSSIL_FILESYS_TYPE_LINK;
+#else
+    if (S_ISDIR(mode))
+        return FOSSIL_FILESYS_TYPE_DIR;
+    if (S_ISLNK(mode))
+        return FOSSIL_FILESYS_TYPE_LINK;
+    if (!S_ISREG(mode))
+        return FOSSIL_FILESYS_TYPE_UNKNOWN;
+#endif
+    return fossil_has_archive_ext(name) ? FOSSIL_FILESYS_TYPE_ARCHIVE : FOSSIL_FILESYS_TYPE_FILE;
+}
+
+static void snapshot_set(fossil_io_filesys_dir_snapshot_t *snap, uint32_t mode, uint64_t size, time_t mtime)
+{
+    size_t i = snap->count++;
+    snap->types[i] = snapshot_type(snap->names + snap->name_offsets[i], mode);
+    snap->sizes[i] = size;
+    snap->modes[i] = mode;
+    snap->mtimes[i] = mtime;
+}
+
+#if !defined(_WIN32)
+
+#if defined(__linux__) && defined(SYS_statx) && defined(STATX_BASIC_STATS)
+#define FOSSIL_HAVE_STATX 1
+/* Cleared once the kernel reports statx() as unsupported. */
+static atomic_bool fossil_statx_ok = true;
+#endif
+
+/* Metadata for one entry relative to dfd, without following links. */
+static void snapshot_stat_at(fossil_io_filesys_dir_snapshot_t *snap, int dfd, const char *name)
+{
+#ifdef FOSSIL_HAVE_STATX
+    if (atomic_load_explicit(&fossil_statx_ok, memory_order_relaxed))
+    {
+        struct statx stx;
+        unsigned int mask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME;
+        if (syscall(SYS_statx, dfd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_SYNC_AS_STAT, mask, &stx) == 0)
+        {
+            snapshot_set(snap, stx.stx_mode, stx.stx_size, (time_t)stx.stx_mtime.tv_sec);
+            return;
+        }
+        if (errno == ENOSYS)
+            atomic_store_explicit(&fossil_statx_ok, false, memory_order_relaxed);
+    }
+#endif
+
+    struct stat st;
+    if (fstatat(dfd, name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+        snapshot_set(snap, st.st_mode, (uint64_t)st.st_size, st.st_mtime);
+    else
+        snapshot_set(snap, 0, 0, 0);
+}
+
+#if defined(__linux__) && defined(SYS_getdents64)
+/* Kernel dirent64 layout; glibc only exposes getdents64() under _GNU_SOURCE. */
+typedef struct
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} snapshot_dirent64_t;
+#endif
+
+#endif
+
+int32_t fossil_io_filesys_dir_snapshot(const char *path, fossil_io_filesys_dir_snapshot_t *snap)
+{
+    if (!path || !snap)
+        return -1;
+
+    snap->count = 0;
+    snap->names_length = 0;
+
+#if defined(_WIN32)
+
+    char search[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(search, sizeof(search), "%s\\*", path);
+
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileExA(search, FindExInfoBasic, &fd, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (h == INVALID_HANDLE_VALUE)
+        return -1;
+
+    int32_t rc = 0;
+    do
+    {
+        if (!strcmp(fd.cFileName, ".") || !strcmp(fd.cFileName, ".."))
+            continue;
+
+        if (snapshot_push_name(snap, fd.cFileName, strlen(fd.cFileName)) != 0)
+        {
+            rc = -1;
+            break;
+        }
+        snapshot_set(snap, fd.dwFileAttributes, ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow,
+                     fossil_filetime_to_time(fd.ftLastWriteTime));
+    } while (FindNextFileA(h, &fd));
+
+    FindClose(h);
+    return rc;
+
+#elif defined(__linux__) && defined(SYS_getdents64)
+
+    int dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd < 0)
+        return -1;
+
+    /* One 64 KiB batch holds a few thousand entries per syscall. */
+    _Alignas(8) char buf[64 * 1024];
+    int32_t rc = 0;
+
+    for (;;)
+    {
+        long n = syscall(SYS_getdents64, dfd, buf, sizeof(buf));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            rc = -1;
+            break;
+        }
+        if (n == 0)
+            break;
+
+        for (long off = 0; off < n;)
+        {
+            const snapshot_dirent64_t *d = (const snapshot_dirent64_t *)(buf + off);
+            off += d->d_reclen;
+
+            const char *name = d->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+
+            if (snapshot_push_name(snap, name, strlen(name)) != 0)
+            {
+                close(dfd);
+                return -1;
+            }
+            snapshot_stat_at(snap, dfd, name);
+        }
+    }
+
+    close(dfd);
+    return rc;
+
+#else
+
+    DIR *dir = opendir(path);
+    if (!dir)
+        return -1;
+
+    int dfd = dirfd(dir);
+    struct dirent *entry;
+    int32_t rc = 0;
+
+    while ((entry = readdir(dir)))
+    {
+        const char *name = entry->d_name;
+        if (!strcmp(name, ".") || !strcmp(name, ".."))
+            continue;
+
+        if (snapshot_push_name(snap, name, strlen(name)) != 0)
+        {
+            rc = -1;
+            break;
+        }
+        snapshot_stat_at(snap, dfd, name);
+    }
+
+    closedir(dir);
+    return rc;
+
+#endif
+}
+
+const char *fossil_io_filesys_dir_snapshot_name(const fossil_io_filesys_dir_snapshot_t *snap, size_t index)
+{
+    if (!snap || index >= snap->count)
+        return NULL;
+    return snap->names + snap->name_offsets[index];
+}
+
+void fossil_io_filesys_dir_snapshot_free(fossil_io_filesys_dir_snapshot_t *snap)
+{
+    if (!snap)
+        return;
+
+    free(snap->names);
+    free(snap->name_offsets);
+    free(snap->types);
+    free(snap->sizes);
+    free(snap->modes);
+    free(snap->mtimes);
+    memset(snap, 0, sizeof(*snap));
+}
+
+static int dir_merge_at(
+    fossil_io_filesys_dirhandle_t *src,
+    fossil_io_filesys_dirhandle_t *dest,
+    bool overwrite,
+    bool recursive)
+{
+    fossil_pathbuf_t src_path = {NULL, 0};
+    fossil_pathbuf_t dest_path = {NULL, 0};
+    fossil_io_filesys_dirent_t entry;
+    int32_t more;
+
+    while ((more = fossil_io_filesys_dirhandle_read(src, &entry)) > 0)
+    {
+        if (entry.type == FOSSIL_FILESYS_TYPE_DIR)
+        {
+            if (!recursive)
+                continue;
+
+            fossil_io_filesys_dirhandle_mkdir(dest, entry.name, 0755);
+            fossil_io_filesys_dirhandle_t *from = fossil_io_filesys_dirhandle_open_dir(src, entry.name);
+            fossil_io_filesys_dirhandle_t *to = fossil_io_filesys_dirhandle_open_dir(dest, entry.name);
+            if (from && to)
+                dir_merge_at(from, to, overwrite, true);
+            fossil_io_filesys_dirhandle_close(from);
+            fossil_io_filesys_dirhandle_close(to);
+            continue;
+        }
+
+        dirhandle_meta_t meta;
+        if (!overwrite && dirhandle_meta(dest, entry.name, false, &meta) == 0)
+            continue;
+
+        if (fossil_pathbuf_join(&src_path, src->path, src->path_len, entry.name) &&
+            fossil_pathbuf_join(&dest_path, dest->path, dest->path_len, entry.name))
+            fossil_io_filesys_copy(src_path.ptr, dest_path.ptr, true);
+    }
+
+    free(src_path.ptr);
+    free(dest_path.ptr);
+    return (more < 0) ? -1 : 0;
+}
+
+int32_t fossil_io_filesys_dir_merge(
+    const char *src,
+    const char *dest,
+    bool overwrite,
+    bool recursive)
+{
+    if (!src || !dest)
+        return -1;
+
+    fossil_io_filesys_dirhandle_t *from = fossil_io_filesys_dirhandle_open(src);
+    fossil_io_filesys_dirhandle_t *to = from ? fossil_io_filesys_dirhandle_open(dest) : NULL;
+    int32_t rc = (from && to) ? dir_merge_at(from, to, overwrite, recursive) : -1;
+    fossil_io_filesys_dirhandle_close(from);
+    fossil_io_filesys_dirhandle_close(to);
+    return rc;
+}
+
+/* ------------------------------------------------------------
+ * Incremental Mirror
+ * ------------------------------------------------------------ */
+
+#define MIRROR_MANIFEST_HEADER "fossil-mirror-manifest 2\n" /* 2: mtimes in nanoseconds */
+#define MIRROR_NONE ((size_t)-1)
+
+/* One source entry, or one line of a manifest. */
+typedef struct
+{
+    char *rel; /* path below the mirror root */
+    uint64_t size;
+    int64_t mtime_ns; /* so a same-size edit within one second is still seen */
+    uint64_t inode;
+    uint64_t hash;     /* content hash, 0 when not computed */
+    uint64_t old_hash; /* manifest hash to verify against before copying */
+    bool is_dir;
+    bool seen;   /* manifest entry still present in the source */
+    bool verify; /* metadata moved but content may not have */
+    bool failed;
+} mirror_entry_t;
+
+typedef struct
+{
+    mirror_entry_t *items;
+    size_t count;
+    size_t capacity;
+} mirror_list_t;
+
+/* Open-addressing index of a list by relative path. */
+typedef struct
+{
+    size_t *slots;
+    size_t capacity;
+} mirror_index_t;
+
+static uint64_t mirror_path_hash(const char *s)
+{
+    uint64_t h = 14695981039346656037ULL;
+    while (*s)
+    {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static mirror_entry_t *mirror_list_add(mirror_list_t *list, const char *rel, size_t rel_len)
+{
+    if (list->count == list->capacity)
+    {
+        size_t cap = list->capacity ? list->capacity * 2 : 256;
+        mirror_entry_t *grown = realloc(list->items, cap * sizeof(*grown));
+        if (!grown)
+            return NULL;
+        list->items = grown;
+        list->capacity = cap;
+    }
+
+    char *copy = malloc(rel_len + 1);
+    if (!copy)
+        return NULL;
+    memcpy(copy, rel, rel_len);
+    copy[rel_len] = '\0';
+
+    mirror_entry_t *e = &list->items[list->count++];
+    memset(e, 0, sizeof(*e));
+    e->rel = copy;
+    return e;
+}
+
+static void mirror_list_free(mirror_list_t *list)
+{
+    for (size_t i = 0; i < list->count; ++i)
+        free(list->items[i].rel);
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+static int mirror_index_build(mirror_index_t *idx, const mirror_list_t *list)
+{
+    size_t cap = 16;
+    while (cap < list->count * 2)
+        cap <<= 1;
+
+    idx->slots = malloc(cap * sizeof(*idx->slots));
+    if (!idx->slots)
+        return -1;
+    idx->capacity = cap;
+    for (size_t i = 0; i < cap; ++i)
+        idx->slots[i] = MIRROR_NONE;
+
+    for (size_t i = 0; i < list->count; ++i)
+    {
+        size_t slot = (size_t)mirror_path_hash(list->items[i].rel) & (cap - 1);
+        while (idx->slots[slot] != MIRROR_NONE)
+            slot = (slot + 1) & (cap - 1);
+        idx->slots[slot] = i;
+    }
+    return 0;
+}
+
+static mirror_entry_t *mirror_index_find(const mirror_index_t *idx, mirror_list_t *list, const char *rel)
+{
+    if (!idx->slots)
+        return NULL;
+
+    size_t slot = (size_t)mirror_path_hash(rel) & (idx->capacity - 1);
+    while (idx->slots[slot] != MIRROR_NONE)
+    {
+        mirror_entry_t *e = &list->items[idx->slots[slot]];
+        if (strcmp(e->rel, rel) == 0)
+            return e;
+        slot = (slot + 1) & (idx->capacity - 1);
+    }
+    return NULL;
+}
+
+static const char *mirror_join(fossil_pathbuf_t *out, const char *root, const char *rel)
+{
+    return fossil_pathbuf_join(out, root, strlen(root), rel);
+}
+
+/*
+ * Record every directory and regular file below root, parents before their
+ * children. Only the source is examined: one fstatat per entry on POSIX,
+ * none on Windows where the directory listing already carries size and mtime.
+ */
+static int mirror_scan(fossil_io_filesys_dirhandle_t *root, const char *rel, mirror_list_t *out)
+{
+    fossil_io_filesys_dirhandle_t *dir = fossil_io_filesys_dirhandle_open_dir(root, *rel ? rel : ".");
+    if (!dir)
+        return -1;
+
+    fossil_pathbuf_t child = {NULL, 0};
+    fossil_io_filesys_dirent_t entry;
+    size_t rel_len = strlen(rel);
+    size_t first = out->count;
+    int32_t more;
+    int rc = 0;
+
+    while ((more = fossil_io_filesys_dirhandle_read(dir, &entry)) > 0)
+    {
+        /* links and special files are not mirrored */
+        if (entry.type != FOSSIL_FILESYS_TYPE_DIR && entry.type != FOSSIL_FILESYS_TYPE_FILE)
+            continue;
+
+        dirhandle_meta_t meta;
+        if (dirhandle_meta(dir, entry.name, false, &meta) != 0)
+            continue;
+        if (meta.type != FOSSIL_FILESYS_TYPE_DIR && meta.type != FOSSIL_FILESYS_TYPE_FILE)
+            continue;
+
+        mirror_entry_t *e = NULL;
+        if (fossil_pathbuf_join(&child, rel, rel_len, entry.name))
+            e = mirror_list_add(out, child.ptr, strlen(child.ptr));
+        if (!e)
+        {
+            rc = -1;
+            break;
+        }
+        e->is_dir = (meta.type == FOSSIL_FILESYS_TYPE_DIR);
+        e->size = e->is_dir ? 0 : meta.size;
+        e->mtime_ns = meta.modified_ns;
+        e->inode = meta.inode;
+    }
+
+    fossil_io_filesys_dirhandle_close(dir);
+    free(child.ptr);
+    if (rc != 0 || more < 0)
+        return -1;
+
+    /*
+     * Descend after closing, so depth never costs more than one open
+     * directory besides the root the relative paths are resolved against.
+     */
+    size_t last = out->count;
+    for (size_t i = first; i < last; ++i)
+    {
+        if (!out->items[i].is_dir)
+            continue;
+        const char *sub = out->items[i].rel; /* stable across list growth */
+        if (mirror_scan(root, sub, out) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * Manifest format: a header line, then one line per entry:
+ *   <f|d> <size> <mtime> <inode> <hash-hex> <relative path>
+ */
+/* A relative path with no ".." component, as mirror_scan produces. */
+static bool mirror_rel_safe(const char *rel)
+{
+    if (rel[0] == '/' || rel[0] == '\\')
+        return false;
+#if defined(_WIN32)
+    if (rel[0] && rel[1] == ':')
+        return false;
+#endif
+
+    for (const char *c = rel; *c;)
+    {
+        size_t n = strcspn(c, "/\\");
+        if (n == 2 && c[0] == '.' && c[1] == '.')
+            return false;
+        c += n;
+        if (*c)
+            ++c;
+    }
+    return true;
+}
+
+static int mirror_manifest_load(const char *path, mirror_list_t *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return -1;
+
+    char *data = NULL;
+    size_t len = 0, cap = 0;
+    for (;;)
+    {
+        if (len + 65536 > cap)
+        {
+            cap = cap ? cap * 2 : 262144;
+            char *grown = realloc(data, cap + 1);
+            if (!grown)
+            {
+                free(data);
+                fclose(f);
+                return -1;
+            }
+            data = grown;
+        }
+        size_t n = fread(data + len, 1, cap - len, f);
+        len += n;
+        if (n == 0)
+            break;
+    }
+    fclose(f);
+    data[len] = '\0';
+
+    size_t header = sizeof(MIRROR_MANIFEST_HEADER) - 1;
+    if (len < header || memcmp(data, MIRROR_MANIFEST_HEADER, header) != 0)
+    {
+        free(data);
+        return -1;
+    }
+
+    int rc = 0;
+    char *line = data + header;
+    while (*line)
+    {
+        char *eol = strchr(line, '\n');
+        if (!eol)
+            break; /* truncated tail: ignore the partial line */
+        *eol = '\0';
+
+        char type = line[0];
+        char *p = line + 1;
+        uint64_t size = strtoull(p, &p, 10);
+        int64_t mtime = strtoll(p, &p, 10);
+        uint64_t inode = strtoull(p, &p, 10);
+        uint64_t hash = strtoull(p, &p, 16);
+        if ((type == 'f' || type == 'd') && *p == ' ' && p[1])
+        {
+            /* names are joined onto dest and may be deleted: never let one leave it */
+            if (!mirror_rel_safe(p + 1))
+            {
+                rc = -1;
+                break;
+            }
+            mirror_entry_t *e = mirror_list_add(out, p + 1, strlen(p + 1));
+            if (!e)
+            {
+                rc = -1;
+                break;
+            }
+            e->is_dir = (type == 'd');
+            e->size = size;
+            e->mtime_ns = mtime;
+            e->inode = inode;
+            e->hash = hash;
+        }
+        line = eol + 1;
+    }
+
+    free(data);
+    return rc;
+}
+
+/* Write the manifest beside its final name, then rename it into place. */
+static int mirror_manifest_save(const char *path, const mirror_list_t *list)
+{
+    char tmp[FOSSIL_FILESYS_MAX_PATH];
+    int n = snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (n < 0 || (size_t)n >= sizeof(tmp))
+        return -1;
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f)
+        return -1;
+
+    /* per call: mirrors may run on several threads at once */
+    char *buffer = malloc(1 << 16);
+    if (buffer)
+        setvbuf(f, buffer, _IOFBF, 1 << 16);
+
+    bool ok = fputs(MIRROR_MANIFEST_HEADER, f) >= 0;
+    for (size_t i = 0; ok && i < list->count; ++i)
+    {
+        const mirror_entry_t *e = &list->items[i];
+        if (e->failed || strchr(e->rel, '\n'))
+            continue; /* re-examined on the next run */
+        ok = fprintf(f, "%c %llu %lld %llu %llx %s\n", e->is_dir ? 'd' : 'f', (unsigned long long)e->size,
+                     (long long)e->mtime_ns, (unsigned long long)e->inode, (unsigned long long)e->hash, e->rel) > 0;
+    }
+    ok = (fflush(f) == 0) && ok;
+    if (fclose(f) != 0)
+        ok = false;
+    free(buffer);
+
+#if defined(_WIN32)
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tmp, path) == 0;
+#endif
+    if (!ok)
+        remove(tmp);
+    fossil_cache_forget(path, false);
+    return ok ? 0 : -1;
+}
+
+/* Changed files are copied by a worker pool. */
+typedef struct
+{
+    const char *src;
+    const char *dest;
+    mirror_list_t *list;
+    const size_t *items;
+    size_t count;
+    bool hash_contents;
+    atomic_size_t cursor;
+    atomic_uint_fast64_t copied;
+    atomic_uint_fast64_t unchanged;
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t errors;
+} mirror_job_t;
+
+static void mirror_worker(void *arg, size_t index)
+{
+    mirror_job_t *job = (mirror_job_t *)arg;
+    fossil_pathbuf_t src = {NULL, 0};
+    fossil_pathbuf_t dest = {NULL, 0};
+    (void)index;
+
+    for (;;)
+    {
+        size_t i = atomic_fetch_add(&job->cursor, 1);
+        if (i >= job->count)
+            break;
+
+        mirror_entry_t *e = &job->list->items[job->items[i]];
+        const char *sp = mirror_join(&src, job->src, e->rel);
+        const char *dp = mirror_join(&dest, job->dest, e->rel);
+        if (!sp || !dp)
+        {
+            e->failed = true;
+            atomic_fetch_add(&job->errors, 1);
+            continue;
+        }
+
+        if (job->hash_contents)
+        {
+            e->hash = fossil_hash_file(sp);
+            if (e->verify && e->hash == e->old_hash)
+            {
+                atomic_fetch_add(&job->unchanged, 1);
+                continue;
+            }
+        }
+
+        fossil_io_filesys_copy_stats_t cs = {FOSSIL_FILESYS_COPY_NONE, 0};
+        int copied = fossil_copy_engine(sp, dp, &cs);
+        fossil_cache_forget(dp, false);
+        if (copied != 0)
+        {
+            e->failed = true;
+            atomic_fetch_add(&job->errors, 1);
+            continue;
+        }
+
+        /* Matching mtimes keep a manifest-less re-mirror from recopying. */
+        time_t mtime = (time_t)(e->mtime_ns / 1000000000);
+        fossil_io_filesys_set_times(dp, mtime, mtime);
+        atomic_fetch_add(&job->copied, 1);
+        atomic_fetch_add(&job->bytes, cs.bytes_copied);
+    }
+
+    free(src.ptr);
+    free(dest.ptr);
+}
+
+/* Without a manifest, remove destination entries absent from the source scan. */
+static void mirror_prune(fossil_io_filesys_dirhandle_t *root, const char *rel, const mirror_index_t *idx,
+                         mirror_list_t *now, fossil_io_filesys_mirror_stats_t *stats)
+{
+    fossil_io_filesys_dirhandle_t *dir = fossil_io_filesys_dirhandle_open_dir(root, *rel ? rel : ".");
+    if (!dir)
+        return;
+
+    fossil_pathbuf_t child = {NULL, 0};
+    fossil_io_filesys_dirent_t entry;
+    mirror_list_t subdirs = {NULL, 0, 0};
+    size_t rel_len = strlen(rel);
+
+    while (fossil_io_filesys_dirhandle_read(dir, &entry) > 0)
+    {
+        if (!fossil_pathbuf_join(&child, rel, rel_len, entry.name))
+        {
+            stats->errors++;
+            break;
+        }
+
+        mirror_entry_t *e = mirror_index_find(idx, now, child.ptr);
+        if (!e)
+        {
+            if (remove_tree_at(dir, entry.name, entry.type) == 0)
+                stats->files_deleted++;
+            dirhandle_forget(dir, entry.name, true);
+        }
+        else if (e->is_dir)
+        {
+            mirror_list_add(&subdirs, child.ptr, strlen(child.ptr));
+        }
+    }
+
+    fossil_io_filesys_dirhandle_close(dir);
+    free(child.ptr);
+
+    for (size_t i = 0; i < subdirs.count; ++i)
+        mirror_prune(root, subdirs.items[i].rel, idx, now, stats);
+    mirror_list_free(&subdirs);
+}
+
+int32_t fossil_io_filesys_dir_mirror_ex(
+    const char *src,
+    const char *dest,
+    const fossil_io_filesys_mirror_opts_t *opts,
+    fossil_io_filesys_mirror_stats_t *stats)
+{
+    fossil_io_filesys_mirror_stats_t local;
+    if (!stats)
+        stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    if (!src || !dest)
+        return -1;
+
+    bool delete_extras = opts && opts->delete_extras;
+    const char *manifest = (opts && opts->manifest_path && *opts->manifest_path) ? opts->manifest_path : NULL;
+    bool hash_contents = opts && opts->hash_contents;
+    size_t threads = (opts && opts->threads) ? opts->threads : fossil_cpu_count();
+
+    if (fossil_io_filesys_dir_create(dest, true) != 0)
+        return -1;
+
+    mirror_list_t now = {NULL, 0, 0};
+    mirror_list_t old = {NULL, 0, 0};
+    mirror_index_t old_idx = {NULL, 0};
+    size_t *copies = NULL;
+    size_t copy_count = 0;
+    fossil_pathbuf_t src_path = {NULL, 0};
+    fossil_pathbuf_t dest_path = {NULL, 0};
+    int32_t rc = -1;
+
+    fossil_io_filesys_dirhandle_t *src_dir = fossil_io_filesys_dirhandle_open(src);
+    int scanned = src_dir ? mirror_scan(src_dir, "", &now) : -1;
+    fossil_io_filesys_dirhandle_close(src_dir);
+    if (scanned != 0)
+        goto done;
+
+    /* A missing or unreadable manifest means a full comparison this time. */
+    bool have_manifest = manifest && mirror_manifest_load(manifest, &old) == 0;
+    if (have_manifest && mirror_index_build(&old_idx, &old) != 0)
+        goto done;
+
+    copies = malloc((now.count ? now.count : 1) * sizeof(*copies));
+    if (!copies)
+        goto done;
+
+    for (size_t i = 0; i < now.count; ++i)
+    {
+        mirror_entry_t *e = &now.items[i];
+        mirror_entry_t *prev = have_manifest ? mirror_index_find(&old_idx, &old, e->rel) : NULL;
+        if (prev)
+            prev->seen = true;
+
+        const char *dp = mirror_join(&dest_path, dest, e->rel);
+        if (!dp)
+        {
+            e->failed = true;
+            stats->errors++;
+            continue;
+        }
+
+        /* A path that changed kind is cleared before it is recreated. */
+        if (prev && prev->is_dir != e->is_dir)
+        {
+            remove_path(dp, 0);
+            fossil_cache_forget(dp, true);
+        }
+
+        if (e->is_dir)
+        {
+            if (prev && prev->is_dir)
+                continue;
+            if (fossil_io_filesys_dir_create(dp, false) == 0)
+                stats->dirs_created++;
+            else if (fossil_io_filesys_dir_exists(dp) != 1)
+            {
+                e->failed = true;
+                stats->errors++;
+            }
+            continue;
+        }
+
+        stats->files_scanned++;
+
+        bool unchanged;
+        if (have_manifest)
+        {
+            unchanged = prev && !prev->is_dir && prev->size == e->size && prev->mtime_ns == e->mtime_ns &&
+                        prev->inode == e->inode;
+
+            /* Same size and mtime under a new inode (a rename-over): the hash decides. */
+            if (!unchanged && hash_contents && prev && !prev->is_dir && prev->size == e->size &&
+                prev->mtime_ns == e->mtime_ns && prev->hash != 0)
+            {
+                e->verify = true;
+                e->old_hash = prev->hash;
+            }
+        }
+        else
+        {
+            const char *sp = mirror_join(&src_path, src, e->rel);
+            unchanged = sp && !file_needs_update(sp, dp);
+        }
+
+        if (unchanged)
+        {
+            e->hash = prev ? prev->hash : 0;
+            stats->files_unchanged++;
+        }
+        else
+        {
+            copies[copy_count++] = i;
+        }
+    }
+
+    if (copy_count > 0)
+    {
+        mirror_job_t job;
+        job.src = src;
+        job.dest = dest;
+        job.list = &now;
+        job.items = copies;
+        job.count = copy_count;
+        job.hash_contents = hash_contents;
+        atomic_init(&job.cursor, 0);
+        atomic_init(&job.copied, 0);
+        atomic_init(&job.unchanged, 0);
+        atomic_init(&job.bytes, 0);
+        atomic_init(&job.errors, 0);
+
+        fossil_run_workers(threads > copy_count ? copy_count : threads, mirror_worker, &job);
+
+        stats->files_copied += atomic_load(&job.copied);
+        stats->files_unchanged += atomic_load(&job.unchanged);
+        stats->bytes_copied += atomic_load(&job.bytes);
+        stats->errors += atomic_load(&job.errors);
+    }
+
+    if (delete_extras)
+    {
+        if (have_manifest)
+        {
+            /* Children sit after their parents, so walk backwards to empty directories first. */
+            for (size_t i = old.count; i-- > 0;)
+            {
+                if (old.items[i].seen)
+                    continue;
+                const char *dp = mirror_join(&dest_path, dest, old.items[i].rel);
+                if (!dp)
+                {
+                    stats->errors++;
+                    continue;
+                }
+                remove_path(dp, 0);
+                fossil_cache_forget(dp, true);
+                if (exists_uncached(dp) == 0)
+                    stats->files_deleted++;
+            }
+        }
+        else
+        {
+            mirror_index_t now_idx = {NULL, 0};
+            fossil_io_filesys_dirhandle_t *dest_dir = fossil_io_filesys_dirhandle_open(dest);
+            if (dest_dir && mirror_index_build(&now_idx, &now) == 0)
+                mirror_prune(dest_dir, "", &now_idx, &now, stats);
+            else
+                stats->errors++;
+            fossil_io_filesys_dirhandle_close(dest_dir);
+            free(now_idx.slots);
+        }
+    }
+
+    if (manifest && mirror_manifest_save(manifest, &now) != 0)
+        stats->errors++;
+
+    rc = (stats->errors == 0) ? 0 : -1;
+
+done:
+    free(src_path.ptr);
+    free(dest_path.ptr);
+    free(copies);
+    free(old_idx.slots);
+    mirror_list_free(&old);
+    mirror_list_free(&now);
+    return rc;
+}
+
+int32_t fossil_io_filesys_dir_mirror(
+    const char *src,
+    const char *dest,
+    bool delete_extras)
+{
+    if (!src || !dest)
+        return -1;
+
+    fossil_io_filesys_mirror_opts_t opts = {delete_extras, NULL, 0, false};
+    return fossil_io_filesys_dir_mirror_ex(src, dest, &opts, NULL);
+}
+
+static int64_t dir_exists_uncached(const char *path)
+{
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES)
+    {
+        if (GetLastError() == ERROR_FILE_NOT_FOUND ||
+            GetLastError() == ERROR_PATH_NOT_FOUND)
+            return 0;
+        return -1;
+    }
+    return (attr & FILE_ATTRIBUTE_DIRECTORY) ? 1 : 0;
+#else
+    struct stat st;
+    if (stat(path, &st) == 0)
+        return S_ISDIR(st.st_mode) ? 1 : 0;
+    if (errno == ENOENT)
+        return 0;
+    return -1;
+#endif
+}
+
+int32_t fossil_io_filesys_dir_exists(const char *path)
+{
+    if (!path)
+        return -1;
+
+    return (int32_t)fossil_cache_query(path, CACHE_DIR, dir_exists_uncached);
+}
+
+int32_t fossil_io_filesys_dir_is_readable(const char *path)
+{
+    if (!path)
+        return -1;
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY))
+        return 0;
+    HANDLE h = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return 0;
+    CloseHandle(h);
+    return 1;
+#else
+    if (access(path, R_OK | X_OK) == 0)
+    {
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+            return 1;
+        return 0;
+    }
+    if (errno == ENOENT)
+        return 0;
+    return -1;
+#endif
+}
+
+int32_t fossil_io_filesys_dir_is_writable(const char *path)
+{
+    if (!path)
+        return -1;
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY))
+        return 0;
+    HANDLE h = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return 0;
+    CloseHandle(h);
+    return 1;
+#else
+    if (access(path, W_OK | X_OK) == 0)
+    {
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+            return 1;
+        return 0;
+    }
+    if (errno == ENOENT)
+        return 0;
+    return -1;
+#endif
+}
+
+int32_t fossil_io_filesys_dir_set_perms(const char *path, fossil_io_filesys_perms_t perms)
+{
+    if (!path)
+        return -1;
+#if defined(_WIN32)
+    // Windows does not support POSIX permissions; no-op
+    (void)perms;
+    return 0;
+#else
+    mode_t mode = 0;
+    if (perms.read)
+        mode |= S_IRUSR | S_IRGRP | S_IROTH;
+    if (perms.write)
+        mode |= S_IWUSR | S_IWGRP | S_IWOTH;
+    if (perms.execute)
+        mode |= S_IXUSR | S_IXGRP | S_IXOTH;
+    int32_t rc = chmod(path, mode);
+    fossil_cache_forget(path, false);
+    return rc;
+#endif
+}
+
+int32_t fossil_io_filesys_dir_set_owner(const char *path, const char *owner, const char *group)
+{
+    if (!path)
+        return -1;
+#if defined(_WIN32)
+    // Not supported on Windows
+    (void)owner;
+    (void)group;
+    return 0;
+#else
+    uid_t uid = (uid_t)-1;
+    gid_t gid = (gid_t)-1;
+    if (owner)
+    {
+        struct passwd *pw = getpwnam(owner);
+        if (pw)
+            uid = pw->pw_uid;
+        else
+        {
+            char *endptr;
+            uid = (uid_t)strtol(owner, &endptr, 10);
+            if (*endptr != '\0')
+                uid = (uid_t)-1;
+        }
+    }
+    if (group)
+    {
+        struct group *gr = getgrnam(group);
+        if (gr)
+            gid = gr->gr_gid;
+        else
+        {
+            char *endptr;
+            gid = (gid_t)strtol(group, &endptr, 10);
+            if (*endptr != '\0')
+                gid = (gid_t)-1;
+        }
+    }
+    if (uid == (uid_t)-1 && gid == (gid_t)-1)
+        return -1;
+    return chown(path, uid, gid);
+#endif
+}
+
+/* Link Operations */
+
+int32_t fossil_io_filesys_link_create(
+    const char *target,
+    const char *link_path,
+    bool symbolic)
+{
+    if (!target || !link_path)
+        return -1;
+
+    int32_t rc;
+
+#if defined(_WIN32)
+
+    if (symbolic)
+    {
+        DWORD flags = 0;
+
+        /* detect directory target */
+        DWORD attr = GetFileAttributesA(target);
+        if (attr != INVALID_FILE_ATTRIBUTES &&
+            (attr & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            flags |= SYMBOLIC_LINK_FLAG_DIRECTORY;
+        }
+
+        /* allow unprivileged (Windows 10+) */
+#ifdef SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE
+        flags |= SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE;
+#endif
+
+        rc = CreateSymbolicLinkA(link_path, target, flags) ? 0 : -1;
+    }
+    else
+    {
+        rc = CreateHardLinkA(link_path, target, NULL) ? 0 : -1;
+    }
+
+#else
+
+    if (symbolic)
+        rc = symlink(target, link_path);
+    else
+        rc = link(target, link_path);
+
+#endif
+
+    fossil_cache_forget(link_path, false);
+    return rc;
+}
+
+int32_t fossil_io_filesys_link_read(
+    const char *link_path,
+    char *target_out,
+    size_t max_len)
+{
+    if (!link_path || !target_out || max_len == 0)
+        return -1;
+
+#if defined(_WIN32)
+
+    HANDLE h = CreateFileA(
+        link_path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS,
+        NULL);
+
+    if (h == INVALID_HANDLE_VALUE)
+        return -1;
+
+    DWORD len = GetFinalPathNameByHandleA(
+        h,
+        target_out,
+        (DWORD)max_len,
+        FILE_NAME_NORMALIZED);
+
+    CloseHandle(h);
+
+    if (len == 0 || len >= max_len)
+        return -1;
+
+    return 0;
+
+#else
+
+    ssize_t len = readlink(link_path, target_out, max_len - 1);
+    if (len < 0)
+        return -1;
+
+    target_out[len] = '\0';
+    return 0;
+
+#endif
+}
+
+int32_t fossil_io_filesys_link_resolve(
+    const char *link_path,
+    char *target_out,
+    size_t max_len)
+{
+    if (!link_path || !target_out || max_len == 0)
+        return -1;
+
+#if defined(_WIN32)
+
+    HANDLE h = CreateFileA(
+        link_path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS,
+        NULL);
+
+    if (h == INVALID_HANDLE_VALUE)
+        return -1;
+
+    DWORD len = GetFinalPathNameByHandleA(
+        h,
+        target_out,
+        (DWORD)max_len,
+        FILE_NAME_NORMALIZED);
+
+    CloseHandle(h);
+
+    if (len == 0 || len >= max_len)
+        return -1;
+
+    return 0;
+
+#else
+
+    char buf[PATH_MAX];
+
+    ssize_t len = readlink(link_path, buf, sizeof(buf) - 1);
+
+    if (len < 0)
+    {
+        // Not a symlink → fallback: just copy path
+        strncpy(target_out, link_path, max_len - 1);
+        target_out[max_len - 1] = '\0';
+        return 0;
+    }
+
+    buf[len] = '\0';
+
+    // If relative symlink → resolve against directory
+    if (buf[0] != '/')
+    {
+        char dir[PATH_MAX];
+        strncpy(dir, link_path, sizeof(dir) - 1);
+        dir[sizeof(dir) - 1] = '\0';
+
+        char *slash = strrchr(dir, '/');
+        if (slash)
+            *slash = '\0';
+        else
+            strcpy(dir, ".");
+
+        snprintf(target_out, max_len, "%s/%s", dir, buf);
+    }
+    else
+    {
+        // Absolute target
+        strncpy(target_out, buf, max_len - 1);
+        target_out[max_len - 1] = '\0';
+    }
+
+    return 0;
+
+#endif
+}
+
+int32_t fossil_io_filesys_link_is_symbolic(
+    const char *link_path,
+    bool *is_symbolic)
+{
+    if (!link_path || !is_symbolic)
+        return -1;
+
+#if defined(_WIN32)
+
+    DWORD attr = GetFileAttributesA(link_path);
+    if (attr == INVALID_FILE_ATTRIBUTES)
+        return -1;
+
+    *is_symbolic = (attr & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+    return 0;
+
+#else
+
+    struct stat st;
+    if (lstat(link_path, &st) != 0)
+        return -1;
+
+    *is_symbolic = S_ISLNK(st.st_mode);
+    return 0;
+
+#endif
+}
+
+int32_t fossil_io_filesys_link_remove(const char *link_path)
+{
+    if (!link_path)
+        return -1;
+#if defined(_WIN32)
+    // On Windows, DeleteFileA removes both files and links (symbolic/hard)
+    int32_t rc = DeleteFileA(link_path) ? 0 : -1;
+#else
+    // Use unlink to remove the link itself, not the target
+    int32_t rc = (unlink(link_path) == 0) ? 0 : -1;
+#endif
+    fossil_cache_forget(link_path, false);
+    return rc;
+}
+
+int32_t fossil_io_filesys_link_exists(const char *link_path)
+{
+    if (!link_path)
+        return -1;
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(link_path);
+    if (attr == INVALID_FILE_ATTRIBUTES)
+        return (GetLastError() == ERROR_FILE_NOT_FOUND ||
+                GetLastError() == ERROR_PATH_NOT_FOUND) ? 0 : -1;
+    // Check if it's a reparse point (symbolic link) or a file (hard link indistinguishable)
+    return (attr & FILE_ATTRIBUTE_REPARSE_POINT) ? 1 : 0;
+#else
+    struct stat st;
+    if (lstat(link_path, &st) == 0)
+        return (S_ISLNK(st.st_mode)) ? 1 : 0;
+    if (errno == ENOENT)
+        return 0;
+    return -1;
+#endif
+}
+
+int32_t fossil_io_filesys_link_set_perms(const char *link_path, fossil_io_filesys_perms_t perms)
+{
+    if (!link_path)
+        return -1;
+#if defined(_WIN32)
+    // Not supported on Windows
+    (void)perms;
+    return 0;
+#else
+# if defined(HAVE_LCHMOD)
+    mode_t mode = 0;
+    if (perms.read)
+        mode |= S_IRUSR | S_IRGRP | S_IROTH;
+    if (perms.write)
+        mode |= S_IWUSR | S_IWGRP | S_IWOTH;
+    if (perms.execute)
+        mode |= S_IXUSR | S_IXGRP | S_IXOTH;
+    return lchmod(link_path, mode);
+# else
+    // Most systems do not support changing symlink perms
+    (void)perms;
+    return 0;
+# endif
+#endif
+}
+
+int32_t fossil_io_filesys_link_set_owner(const char *link_path, const char *owner, const char *group)
+{
+    if (!link_path)
+        return -1;
+#if defined(_WIN32)
+    // Not supported on Windows
+    (void)owner;
+    (void)group;
+    return 0;
+#else
+    uid_t uid = (uid_t)-1;
+    gid_t gid = (gid_t)-1;
+    if (owner)
+    {
+        struct passwd *pw = getpwnam(owner);
+        if (pw)
+            uid = pw->pw_uid;
+        else
+        {
+            char *endptr;
+            uid = (uid_t)strtol(owner, &endptr, 10);
+            if (*endptr != '\0')
+                uid = (uid_t)-1;
+        }
+    }
+    if (group)
+    {
+        struct group *gr = getgrnam(group);
+        if (gr)
+            gid = gr->gr_gid;
+        else
+        {
+            char *endptr;
+            gid = (gid_t)strtol(group, &endptr, 10);
+            if (*endptr != '\0')
+                gid = (gid_t)-1;
+        }
+    }
+    if (uid == (uid_t)-1 && gid == (gid_t)-1)
+        return -1;
+# if defined(HAVE_LCHOWN)
+    return lchown(link_path, uid, gid);
+# else
+    // If lchown is not available, fallback is not possible
+    return -1;
+# endif
+#endif
+}
+
+/* Transaction Operations */
+
+/*
+ * A transaction stages its operations beside their targets and records them
+ * in a write-ahead journal; nothing visible changes until commit. Commit
+ * syncs the staged data as one group, makes the journal's commit record
+ * durable, then applies every operation by rename, parking whatever it
+ * replaces or removes under a backup name so a failure can be undone.
+ * Each path may appear in only one operation, which keeps every operation
+ * idempotent and lets recovery simply replay a committed journal.
+ */
+
+#define TX_JOURNAL_HEADER "fossil-tx-journal 1\n"
+#define TX_JOURNAL_PREFIX "fossil-tx-"
+
+#if defined(_MSC_VER)
+#define FOSSIL_THREAD_LOCAL __declspec(thread)
+#else
+#define FOSSIL_THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct
+{
+    char kind;    /* 'W' write/copy, 'R' remove, 'M' move */
+    char *a;      /* W: staged file, R: target, M: source */
+    char *b;      /* W: target, M: destination, R: NULL */
+    char *backup; /* where a replaced or removed entry is parked */
+    bool applied;
+    bool backed_up;
+} tx_op_t;
+
+struct fossil_io_filesys_tx
+{
+    char journal[FOSSIL_FILESYS_MAX_PATH];
+    FILE *log;
+    tx_op_t *ops;
+    size_t count;
+    size_t cap;
+    unsigned int id;
+    bool failed; /* the journal could not be written; commit refuses */
+};
+
+static atomic_uint tx_seq;
+static FOSSIL_THREAD_LOCAL fossil_io_filesys_tx_t *tx_current;
+
+static long tx_pid(void)
+{
+#if defined(_WIN32)
+    return (long)GetCurrentProcessId();
+#else
+    return (long)getpid();
+#endif
+}
+
+static bool tx_exists(const char *path)
+{
+    return exists_uncached(path) == 1;
+}
+
+static int tx_rename(const char *from, const char *to)
+{
+#if defined(_WIN32)
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
+static char *tx_strdup(const char *s)
+{
+    size_t n = strlen(s) + 1;
+    char *d = malloc(n);
+    if (d)
+        memcpy(d, s, n);
+    return d;
+}
+
+static bool tx_path_ok(const char *path)
+{
+    return path && path[0] && !strpbrk(path, "\t\n") && strlen(path) + 64 < FOSSIL_FILESYS_MAX_PATH;
+}
+
+/*
+ * Operations are kept and journaled with absolute paths, since recovery may
+ * run from another working directory. Only the cwd is prepended: resolving
+ * ".." lexically could name a different file than the kernel would.
+ */
+static bool tx_resolve(const char *path, char *out)
+{
+    if (!tx_path_ok(path))
+        return false;
+#if defined(_WIN32)
+    if (!_fullpath(out, path, FOSSIL_FILESYS_MAX_PATH))
+        return false;
+#else
+    if (path[0] == '/')
+    {
+        memcpy(out, path, strlen(path) + 1);
+    }
+    else
+    {
+        char cwd[FOSSIL_FILESYS_MAX_PATH];
+        if (!getcwd(cwd, sizeof(cwd)))
+            return false;
+        int n = snprintf(out, FOSSIL_FILESYS_MAX_PATH, "%s/%s", cwd, path);
+        if (n < 0 || n >= FOSSIL_FILESYS_MAX_PATH)
+            return false;
+    }
+#endif
+    return tx_path_ok(out);
+}
+
+/* A path may be touched by one operation per transaction. */
+static bool tx_path_taken(const fossil_io_filesys_tx_t *tx, const char *path)
+{
+    for (size_t i = 0; i < tx->count; ++i)
+    {
+        const tx_op_t *op = &tx->ops[i];
+        if ((op->kind != 'W' && strcmp(op->a, path) == 0) || (op->b && strcmp(op->b, path) == 0))
+            return true;
+    }
+    return false;
+}
+
+static void tx_op_free(tx_op_t *op)
+{
+    free(op->a);
+    free(op->b);
+    free(op->backup);
+}
+
+/* Record an operation in memory and in the (not yet synced) journal. */
+static int tx_add(fossil_io_filesys_tx_t *tx, char kind, const char *a, const char *b, const char *backup_of)
+{
+    if (tx->count == tx->cap)
+    {
+        size_t cap = tx->cap ? tx->cap * 2 : 16;
+        tx_op_t *grown = realloc(tx->ops, cap * sizeof(*grown));
+        if (!grown)
+            return -1;
+        tx->ops = grown;
+        tx->cap = cap;
+    }
+
+    char backup[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(backup, sizeof(backup), "%s.fossil-tx.%ld.%u.%zu.bak", backup_of, tx_pid(), tx->id, tx->count);
+
+    tx_op_t *op = &tx->ops[tx->count];
+    memset(op, 0, sizeof(*op));
+    op->kind = kind;
+    op->a = tx_strdup(a);
+    op->b = b ? tx_strdup(b) : NULL;
+    op->backup = tx_strdup(backup);
+    if (!op->a || (b && !op->b) || !op->backup)
+    {
+        tx_op_free(op);
+        return -1;
+    }
+
+    if (fprintf(tx->log, "%c\t%s\t%s\t%s\n", kind, a, b ? b : "-", backup) < 0)
+    {
+        tx_op_free(op);
+        tx->failed = true;
+        return -1;
+    }
+    tx->count++;
+    return 0;
+}
+
+/* Name for a staged file beside its target. */
+static bool tx_stage_name(const fossil_io_filesys_tx_t *tx, const char *target, char *out, size_t size)
+{
+    int n = snprintf(out, size, "%s.fossil-tx.%ld.%u.%zu", target, tx_pid(), tx->id, tx->count);
+    return n > 0 && (size_t)n < size;
+}
+
+/* Every name an operation may rename from or to. */
+static void tx_forget_op(const tx_op_t *op)
+{
+    fossil_cache_forget(op->a, true);
+    if (op->b)
+        fossil_cache_forget(op->b, true);
+    fossil_cache_forget(op->backup, true);
+}
+
+/*
+ * Apply one operation. Safe to repeat: an operation whose source is gone has
+ * already happened, so recovery can replay a journal from the start.
+ */
+static int tx_apply_renames(tx_op_t *op)
+{
+    if (!tx_exists(op->a))
+        return (op->kind == 'R') ? 0 : (op->applied ? 0 : -1);
+
+    if (op->kind == 'R')
+    {
+        if (tx_rename(op->a, op->backup) != 0)
+            return -1;
+        op->backed_up = true;
+    }
+    else
+    {
+        if (tx_exists(op->b) && !tx_exists(op->backup))
+        {
+            if (tx_rename(op->b, op->backup) != 0)
+                return -1;
+            op->backed_up = true;
+        }
+        if (tx_rename(op->a, op->b) != 0)
+            return -1;
+    }
+    op->applied = true;
+    return 0;
+}
+
+static int tx_apply_op(tx_op_t *op)
+{
+    int rc = tx_apply_renames(op);
+    tx_forget_op(op);
+    return rc;
+}
+
+static void tx_undo_op(tx_op_t *op)
+{
+    if (op->kind == 'R')
+    {
+        if (op->backed_up)
+            tx_rename(op->backup, op->a);
+    }
+    else
+    {
+        if (op->applied)
+            tx_rename(op->b, op->a);
+        if (op->backed_up)
+            tx_rename(op->backup, op->b);
+    }
+    tx_forget_op(op);
+}
+
+/* Sync a set of files, or their parent directories, as one concurrent group. */
+static int tx_sync_group(const char *const *paths, size_t count, bool parents, fossil_io_filesys_flush_level_t level)
+{
+#if defined(_WIN32)
+    if (parents)
+        return 0; /* NTFS journals directory updates itself */
+#endif
+    int *fds = malloc((count ? count : 1) * sizeof(*fds));
+    char (*seen)[FOSSIL_FILESYS_MAX_PATH] = parents ? malloc((count ? count : 1) * sizeof(*seen)) : NULL;
+    if (!fds || (parents && !seen))
+    {
+        free(fds);
+        free(seen);
+        return -1;
+    }
+
+    size_t n = 0, dirs = 0;
+    int rc = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const char *p = paths[i];
+#if !defined(_WIN32)
+        if (parents)
+        {
+            rewrite_parent_dir(paths[i], seen[dirs], sizeof(seen[dirs]));
+            bool dup = false;
+            for (size_t k = 0; k < dirs && !dup; ++k)
+                dup = strcmp(seen[k], seen[dirs]) == 0;
+            if (dup)
+                continue;
+            p = seen[dirs++];
+        }
+        int fd = open(p, O_RDONLY | O_CLOEXEC);
+#else
+        int fd = _open(p, _O_RDWR | _O_BINARY);
+#endif
+        if (fd < 0)
+            rc = -1;
+        else
+            fds[n++] = fd;
+    }
+
+    sync_group_job_t job;
+    job.fds = fds;
+    job.count = n;
+    job.level = level;
+    atomic_init(&job.cursor, 0);
+    atomic_init(&job.failed, 0);
+    if (n > 0)
+        fossil_run_workers(n < FOSSIL_SYNC_GROUP_MAX_THREADS ? n : FOSSIL_SYNC_GROUP_MAX_THREADS, sync_group_worker, &job);
+    if (atomic_load(&job.failed))
+        rc = -1;
+
+    for (size_t i = 0; i < n; ++i)
+#if defined(_WIN32)
+        _close(fds[i]);
+#else
+        close(fds[i]);
+#endif
+    free(seen);
+    free(fds);
+    return rc;
+}
+
+/*
+ * A journal is locked by its transaction from tx_open to tx_end, so recovery
+ * can tell a live transaction from a crashed one. The lock belongs to the
+ * open file, not the process, so it also holds against other threads.
+ */
+static bool tx_lock_journal(FILE *f, bool wait)
+{
+#if defined(_WIN32)
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    HANDLE h = (HANDLE)_get_osfhandle(_fileno(f));
+    DWORD flags = LOCKFILE_EXCLUSIVE_LOCK | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+    return h != INVALID_HANDLE_VALUE && LockFileEx(h, flags, 0, MAXDWORD, MAXDWORD, &ov);
+#else
+    int rc;
+    do
+        rc = flock(fileno(f), LOCK_EX | (wait ? 0 : LOCK_NB));
+    while (rc != 0 && errno == EINTR);
+    return rc == 0;
+#endif
+}
+
+static void tx_journal_dir(const char *journal_dir, char *out, size_t size)
+{
+    if (journal_dir)
+    {
+        snprintf(out, size, "%s", journal_dir);
+        return;
+    }
+#if defined(_WIN32)
+    DWORD n = GetTempPathA((DWORD)size, out);
+    if (n == 0 || n >= size)
+        snprintf(out, size, ".");
+    else if (n > 1 && (out[n - 1] == '\\' || out[n - 1] == '/'))
+        out[n - 1] = '\0';
+#else
+    const char *tmp = getenv("TMPDIR");
+    snprintf(out, size, "%s", (tmp && tmp[0]) ? tmp : "/tmp");
+#endif
+}
+
+fossil_io_filesys_tx_t *fossil_io_filesys_tx_open(const char *journal_dir)
+{
+    fossil_io_filesys_tx_t *tx = calloc(1, sizeof(*tx));
+    if (!tx)
+        return NULL;
+
+    char dir[FOSSIL_FILESYS_MAX_PATH];
+    tx_journal_dir(journal_dir, dir, sizeof(dir));
+    tx->id = atomic_fetch_add(&tx_seq, 1);
+    int n = snprintf(tx->journal, sizeof(tx->journal), "%s/" TX_JOURNAL_PREFIX "%ld-%u.wal", dir, tx_pid(), tx->id);
+
+    /* recovery waits for the header: a journal it cannot parse is skipped */
+    if (n < 0 || (size_t)n >= sizeof(tx->journal) || !(tx->log = fopen(tx->journal, "wb")) ||
+        !tx_lock_journal(tx->log, true) || fputs(TX_JOURNAL_HEADER, tx->log) < 0 || fflush(tx->log) != 0)
+    {
+        if (tx->log)
+        {
+            fclose(tx->log);
+            remove(tx->journal);
+        }
+        free(tx);
+        return NULL;
+    }
+    return tx;
+}
+
+int32_t fossil_io_filesys_tx_write(fossil_io_filesys_tx_t *tx, const char *target, const void *data, size_t len)
+{
+    char path[FOSSIL_FILESYS_MAX_PATH];
+    if (!tx || !tx_resolve(target, path) || (!data && len > 0) || tx_path_taken(tx, path))
+        return -1;
+
+    char staged[FOSSIL_FILESYS_MAX_PATH];
+    if (!tx_stage_name(tx, path, staged, sizeof(staged)))
+        return -1;
+    FILE *f = fopen(staged, "wb");
+    if (!f)
+        return -1;
+    bool ok = fwrite(data, 1, len, f) == len;
+#if !defined(_WIN32)
+    /* a replaced file keeps its permissions rather than the umask default */
+    struct stat st;
+    if (stat(path, &st) == 0 && fchmod(fileno(f), st.st_mode & 07777) != 0)
+        ok = false;
+#endif
+    if (fclose(f) != 0)
+        ok = false;
+
+    if (!ok || tx_add(tx, 'W', staged, path, path) != 0)
+    {
+        remove(staged);
+        return -1;
+    }
+    return 0;
+}
+
+int32_t fossil_io_filesys_tx_copy(fossil_io_filesys_tx_t *tx, const char *src, const char *target)
+{
+    char dest[FOSSIL_FILESYS_MAX_PATH];
+    if (!tx || !src || !tx_resolve(target, dest) || tx_path_taken(tx, dest))
+        return -1;
+
+    char staged[FOSSIL_FILESYS_MAX_PATH];
+    if (!tx_stage_name(tx, dest, staged, sizeof(staged)))
+        return -1;
+    if (fossil_copy_engine(src, staged, NULL) != 0 || tx_add(tx, 'W', staged, dest, dest) != 0)
+    {
+        remove(staged);
+        return -1;
+    }
+    return 0;
+}
+
+int32_t fossil_io_filesys_tx_move(fossil_io_filesys_tx_t *tx, const char *source, const char *target)
+{
+    char src[FOSSIL_FILESYS_MAX_PATH], dest[FOSSIL_FILESYS_MAX_PATH];
+    if (!tx || !tx_resolve(source, src) || !tx_resolve(target, dest) || strcmp(src, dest) == 0 ||
+        tx_path_taken(tx, src) || tx_path_taken(tx, dest) || !tx_exists(src))
+        return -1;
+
+    return tx_add(tx, 'M', src, dest, dest);
+}
+
+int32_t fossil_io_filesys_tx_remove(fossil_io_filesys_tx_t *tx, const char *target)
+{
+    char path[FOSSIL_FILESYS_MAX_PATH];
+    if (!tx || !tx_resolve(target, path) || tx_path_taken(tx, path) || !tx_exists(path))
+        return -1;
+
+    return tx_add(tx, 'R', path, NULL, path);
+}
+
+static void tx_free(fossil_io_filesys_tx_t *tx)
+{
+    for (size_t i = 0; i < tx->count; ++i)
+        tx_op_free(&tx->ops[i]);
+    free(tx->ops);
+    free(tx);
+}
+
+/* Drop staged files and the journal. */
+static void tx_discard(fossil_io_filesys_tx_t *tx)
+{
+    for (size_t i = 0; i < tx->count; ++i)
+        if (tx->ops[i].kind == 'W')
+            remove(tx->ops[i].a);
+#if defined(_WIN32)
+    if (tx->log)
+        fclose(tx->log);
+    tx->log = NULL;
+    remove(tx->journal);
+#else
+    /* unlink before closing drops the lock, so recovery never picks it up */
+    remove(tx->journal);
+    if (tx->log)
+        fclose(tx->log);
+    tx->log = NULL;
+#endif
+}
+
+static int tx_commit_ops(fossil_io_filesys_tx_t *tx)
+{
+    const char **paths = malloc((tx->count * 2 + 1) * sizeof(*paths));
+    if (!paths)
+        return -1;
+
+    /* 1: staged data, plus the directories holding staged names and the journal */
+    size_t n = 0, staged = 0;
+    for (size_t i = 0; i < tx->count; ++i)
+        if (tx->ops[i].kind == 'W')
+            paths[staged++] = tx->ops[i].a;
+    n = staged;
+    paths[n++] = tx->journal;
+    int rc = (fflush(tx->log) == 0) ? 0 : -1;
+    if (rc == 0)
+        rc = tx_sync_group(paths, staged, false, FOSSIL_FILESYS_FLUSH_DATA);
+    if (rc == 0)
+        rc = tx_sync_group(paths, n, true, FOSSIL_FILESYS_FLUSH_FULL);
+
+    /* 2: the commit point */
+    if (rc == 0 && (fputs("C\n", tx->log) < 0 || fflush(tx->log) != 0 ||
+                    fossil_fd_sync(fileno(tx->log), FOSSIL_FILESYS_FLUSH_FULL) != 0))
+        rc = -1;
+    if (rc != 0)
+    {
+        free(paths);
+        tx_discard(tx);
+        return -1;
+    }
+
+    /* 3: apply in order; on failure put everything back */
+    size_t applied = 0;
+    for (; applied < tx->count; ++applied)
+        if (tx_apply_op(&tx->ops[applied]) != 0)
+            break;
+    if (applied < tx->count)
+    {
+        for (size_t i = applied + 1; i-- > 0;)
+            tx_undo_op(&tx->ops[i]);
+        rc = -1;
+    }
+
+    /* 4: make the renames durable, then retire backups and the journal */
+    if (rc == 0)
+    {
+        n = 0;
+        for (size_t i = 0; i < tx->count; ++i)
+        {
+            paths[n++] = tx->ops[i].a;
+            if (tx->ops[i].b)
+                paths[n++] = tx->ops[i].b;
+        }
+        rc = tx_sync_group(paths, n, true, FOSSIL_FILESYS_FLUSH_FULL);
+        for (size_t i = 0; i < tx->count; ++i)
+            if (tx->ops[i].backed_up)
+                fossil_io_filesys_remove(tx->ops[i].backup, true);
+    }
+
+    free(paths);
+    tx_discard(tx);
+    return rc;
+}
+
+int32_t fossil_io_filesys_tx_end(fossil_io_filesys_tx_t *tx, bool commit)
+{
+    if (!tx)
+        return -1;
+
+    int32_t rc;
+    if (commit && !tx->failed)
+        rc = (tx->count > 0) ? tx_commit_ops(tx) : 0;
+    else
+        rc = commit ? -1 : 0;
+
+    tx_discard(tx);
+    if (tx_current == tx)
+        tx_current = NULL;
+    tx_free(tx);
+    return rc;
+}
+
+/*
+ * Finish one journal left by an interrupted process. Returns 1 without
+ * touching anything for a journal that is still locked by its transaction,
+ * already retired, or unreadable.
+ */
+static int tx_recover_journal(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return 1; /* retired since the directory was read */
+    if (!tx_lock_journal(f, false))
+    {
+        fclose(f);
+        return 1;
+    }
+#if !defined(_WIN32)
+    /* the owner unlinks before unlocking; a journal gone from the path is finished */
+    struct stat held, named;
+    if (fstat(fileno(f), &held) != 0 || stat(path, &named) != 0 || held.st_dev != named.st_dev ||
+        held.st_ino != named.st_ino)
+    {
+        fclose(f);
+        return 1;
+    }
+#endif
+
+    char line[3 * FOSSIL_FILESYS_MAX_PATH + 16];
+    fossil_io_filesys_tx_t tx;
+    memset(&tx, 0, sizeof(tx));
+    bool committed = false;
+    int rc = 0;
+
+    if (!fgets(line, sizeof(line), f) || strcmp(line, TX_JOURNAL_HEADER) != 0)
+    {
+        fclose(f);
+        return 1;
+    }
+    while (rc == 0 && fgets(line, sizeof(line), f))
+    {
+        if (strcmp(line, "C\n") == 0)
+        {
+            committed = true;
+            break;
+        }
+        char *eol = strchr(line, '\n');
+        if (!eol)
+            break; /* torn tail of an uncommitted journal */
+        *eol = '\0';
+
+        char *fields[4] = {line, NULL, NULL, NULL};
+        for (int k = 1; k < 4; ++k)
+        {
+            fields[k] = strchr(fields[k - 1], '\t');
+            if (!fields[k])
+                break;
+            *fields[k]++ = '\0';
+        }
+        if (!fields[3] || strlen(fields[0]) != 1)
+            break;
+
+        if (tx.count == tx.cap)
+        {
+            size_t cap = tx.cap ? tx.cap * 2 : 16;
+            tx_op_t *grown = realloc(tx.ops, cap * sizeof(*grown));
+            if (!grown)
+            {
+                rc = -1;
+                break;
+            }
+            tx.ops = grown;
+            tx.cap = cap;
+        }
+        tx_op_t *op = &tx.ops[tx.count];
+        memset(op, 0, sizeof(*op));
+        op->kind = fields[0][0];
+        op->a = tx_strdup(fields[1]);
+        op->b = (op->kind == 'R') ? NULL : tx_strdup(fields[2]);
+        op->backup = tx_strdup(fields[3]);
+        op->applied = true; /* a missing source means "already done" */
+        tx.count++;
+        if (!op->a || (op->kind != 'R' && !op->b) || !op->backup)
+            rc = -1;
+    }
+
+    /* keep the journal locked while replaying it */
+    for (size_t i = 0; rc == 0 && i < tx.count; ++i)
+    {
+        if (!committed)
+        {
+            if (tx.ops[i].kind == 'W')
+                remove(tx.ops[i].a);
+            continue;
+        }
+        if (tx_apply_op(&tx.ops[i]) != 0)
+            rc = -1;
+    }
+    for (size_t i = 0; rc == 0 && committed && i < tx.count; ++i)
+        if (tx_exists(tx.ops[i].backup))
+            fossil_io_filesys_remove(tx.ops[i].backup, true);
+
+    for (size_t i = 0; i < tx.count; ++i)
+        tx_op_free(&tx.ops[i]);
+    free(tx.ops);
 #if defined(_WIN32)
-    // Windows does not support POSIX permissions; no-op
-    (void)perms;
-    return 0;
+    fclose(f); /* an open file cannot be deleted */
+    if (rc == 0)
+        remove(path);
 #else
-    mode_t mode = 0;
-    if (perms.read)
-        mode |= S_IRUSR | S_IRGRP | S_IROTH;
-    if (perms.write)
-        mode |= S_IWUSR | S_IWGRP | S_IWOTH;
-    if (perms.execute)
-        mode |= S_IXUSR | S_IXGRP | S_IXOTH;
-    return chmod(path, mode);
+    if (rc == 0)
+        remove(path);
+    fclose(f);
 #endif
+    return rc;
 }
 
-int32_t fossil_io_filesys_dir_set_owner(const char *path, const char *owner, const char *group)
+static bool tx_is_journal_name(const char *name)
 {
-    if (!path)
-        return -1;
+    size_t len = strlen(name), prefix = strlen(TX_JOURNAL_PREFIX);
+    return len > prefix + 4 && strncmp(name, TX_JOURNAL_PREFIX, prefix) == 0 && strcmp(name + len - 4, ".wal") == 0;
+}
+
+int32_t fossil_io_filesys_tx_recover(const char *journal_dir)
+{
+    char dir[FOSSIL_FILESYS_MAX_PATH], path[FOSSIL_FILESYS_MAX_PATH];
+    tx_journal_dir(journal_dir, dir, sizeof(dir));
+    int32_t recovered = 0;
+
 #if defined(_WIN32)
-    // Not supported on Windows
-    (void)owner;
-    (void)group;
+    snprintf(path, sizeof(path), "%s\\" TX_JOURNAL_PREFIX "*.wal", dir);
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(path, &fd);
+    if (h == INVALID_HANDLE_VALUE)
+        return (GetLastError() == ERROR_FILE_NOT_FOUND) ? 0 : -1;
+    do
+    {
+        if (!tx_is_journal_name(fd.cFileName))
+            continue;
+        int n = snprintf(path, sizeof(path), "%s\\%s", dir, fd.cFileName);
+        int rc = (n < 0 || (size_t)n >= sizeof(path)) ? -1 : tx_recover_journal(path);
+        if (rc < 0)
+        {
+            recovered = -1;
+            break;
+        }
+        if (rc == 0)
+            recovered++;
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+#else
+    DIR *d = opendir(dir);
+    if (!d)
+        return -1;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL)
+    {
+        if (!tx_is_journal_name(ent->d_name))
+            continue;
+        int n = snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        int rc = (n < 0 || (size_t)n >= sizeof(path)) ? -1 : tx_recover_journal(path);
+        if (rc < 0)
+        {
+            recovered = -1;
+            break;
+        }
+        if (rc == 0)
+            recovered++;
+    }
+    closedir(d);
+#endif
+    return recovered;
+}
+
+/* The original begin/commit/rollback API drives one transaction per thread. */
+
+int32_t fossil_io_filesys_tx_init(void)
+{
     return 0;
+}
+
+fossil_io_filesys_tx_t *fossil_io_filesys_tx_current(void)
+{
+    return tx_current;
+}
+
+int32_t fossil_io_filesys_tx_begin(void)
+{
+    if (tx_current)
+        return -1;
+
+    tx_current = fossil_io_filesys_tx_open(NULL);
+    return tx_current ? 0 : -1;
+}
+
+int32_t fossil_io_filesys_tx_commit(void)
+{
+    if (!tx_current)
+        return -1;
+
+    return fossil_io_filesys_tx_end(tx_current, true);
+}
+
+int32_t fossil_io_filesys_tx_rollback(void)
+{
+    if (!tx_current)
+        return -1;
+
+    return fossil_io_filesys_tx_end(tx_current, false);
+}
+
+int32_t fossil_io_filesys_tx_is_active(void)
+{
+    return tx_current ? 1 : 0;
+}
+
+/* ------------------------------------------------------------
+ * Change Watching
+ * ------------------------------------------------------------ */
+
+/*
+ * A watcher runs one thread that reads kernel notifications, folds them into
+ * a table of pending paths, and publishes each path once it has been quiet
+ * for the debounce interval. Published events go through a single-producer,
+ * single-consumer ring, so the reader never takes a lock; a readiness
+ * descriptor (an eventfd, or an event object on Windows) wakes it.
+ *
+ * inotify is used rather than fanotify: fanotify needs CAP_SYS_ADMIN for
+ * anything but whole-mount marks and does not report names for them.
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+#define FOSSIL_HAVE_WATCH 1
+#endif
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+#define FOSSIL_WATCH_KINDS 0x3fu           /* CREATE..MOVED_TO */
+#define FOSSIL_WATCH_DEFAULT_CAPACITY 1024
+#define FOSSIL_WATCH_MAX_CAPACITY (1u << 20)
+#define FOSSIL_WATCH_MAX_PENDING 65536     /* beyond this, collapse to OVERFLOW */
+#define FOSSIL_WATCH_MAX_HOLD 8            /* debounce windows a busy path may wait */
+#define FOSSIL_WATCH_RETRY_MS 10           /* recheck interval while the ring is full */
+
+#if defined(FOSSIL_HAVE_WATCH)
+
+/* A path with changes not yet published; owned by the watcher thread. */
+typedef struct
+{
+    char *path;
+    uint32_t mask;
+    bool born; /* first event created it, so a removal cancels it outright */
+    uint64_t first;
+    uint64_t last;
+} watch_pending_t;
+
+#if defined(__linux__)
+#define FOSSIL_WATCH_IN_MASK \
+    (IN_CREATE | IN_MODIFY | IN_ATTRIB | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_EXCL_UNLINK)
+
+/* inotify watch descriptor to directory; wd 0 marks an empty slot. */
+typedef struct
+{
+    int wd;
+    bool recursive;
+    bool root;
+    char *path;
+} watch_dir_t;
+#elif defined(_WIN32)
+#define FOSSIL_WATCH_MAX_ROOTS (MAXIMUM_WAIT_OBJECTS - 1)
+#define FOSSIL_WATCH_WIN_FILTER                                                                 \
+    (FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_ATTRIBUTES | \
+     FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SECURITY)
+
+/* One ReadDirectoryChangesW subscription, armed and freed by the watcher thread. */
+typedef struct
+{
+    HANDLE dir;
+    OVERLAPPED ov;
+    bool recursive;
+    bool armed;
+    bool closing;
+    char path[FOSSIL_FILESYS_MAX_PATH];
+    DWORD buf[16384]; /* 64 KiB, the most a network share returns */
+} watch_root_t;
+#endif
+
+struct fossil_io_filesys_watch
+{
+    uint32_t events;
+    uint32_t debounce_ms;
+
+    /* Published events: the watcher thread advances tail, the reader head. */
+    fossil_io_filesys_watch_event_t *ring;
+    size_t ring_mask;
+    atomic_size_t head;
+    atomic_size_t tail;
+
+    /* Pending paths in arrival order, indexed by an open-addressed table. */
+    watch_pending_t *pending;
+    size_t pending_count;
+    size_t pending_cap;
+    uint32_t *pending_index; /* position + 1, 0 = empty */
+    size_t index_mask;
+    bool lost;
+
+#if defined(__linux__)
+    int ifd;
+    int ready_fd;
+    int stop_fd;
+    pthread_mutex_t lock; /* guards dirs */
+    watch_dir_t *dirs;
+    size_t dir_mask;
+    size_t dir_count;
+    pthread_t thread;
+    bool started;
 #else
-    uid_t uid = (uid_t)-1;
-    gid_t gid = (gid_t)-1;
-    if (owner)
+    HANDLE ready; /* manual reset, set while events may be waiting */
+    HANDLE wake;
+    CRITICAL_SECTION lock; /* guards roots */
+    watch_root_t *roots[FOSSIL_WATCH_MAX_ROOTS];
+    size_t root_count;
+    volatile LONG stop;
+    HANDLE thread;
+#endif
+};
+
+static bool watch_has_events(const fossil_io_filesys_watch_t *w)
+{
+    return atomic_load_explicit(&w->tail, memory_order_acquire) !=
+           atomic_load_explicit(&w->head, memory_order_relaxed);
+}
+
+static void watch_signal(fossil_io_filesys_watch_t *w)
+{
+#if defined(__linux__)
+    uint64_t one = 1;
+    ssize_t rc = write(w->ready_fd, &one, sizeof(one));
+    (void)rc;
+#else
+    SetEvent(w->ready);
+#endif
+}
+
+/* Copy a path without trailing separators; -1 if it does not fit. */
+static int watch_clean_path(const char *path, char out[FOSSIL_FILESYS_MAX_PATH])
+{
+    size_t len = strlen(path);
+    if (len == 0 || len >= FOSSIL_FILESYS_MAX_PATH)
+        return -1;
+    memcpy(out, path, len + 1);
+    while (len > 1 && (out[len - 1] == '/' || out[len - 1] == PATH_SEP))
+        out[--len] = '\0';
+    return 0;
+}
+
+static void watch_index_rebuild(fossil_io_filesys_watch_t *w)
+{
+    memset(w->pending_index, 0, (w->index_mask + 1) * sizeof(*w->pending_index));
+    for (size_t i = 0; i < w->pending_count; ++i)
     {
-        struct passwd *pw = getpwnam(owner);
-        if (pw)
-            uid = pw->pw_uid;
+        const char *p = w->pending[i].path;
+        size_t slot = (size_t)fossil_hash64_buffer(p, strlen(p)) & w->index_mask;
+        while (w->pending_index[slot])
+            slot = (slot + 1) & w->index_mask;
+        w->pending_index[slot] = (uint32_t)(i + 1);
+    }
+}
+
+static void watch_drop_pending(fossil_io_filesys_watch_t *w)
+{
+    for (size_t i = 0; i < w->pending_count; ++i)
+        free(w->pending[i].path);
+    w->pending_count = 0;
+    memset(w->pending_index, 0, (w->index_mask + 1) * sizeof(*w->pending_index));
+}
+
+static int watch_pending_grow(fossil_io_filesys_watch_t *w)
+{
+    size_t cap = w->pending_cap * 2;
+    watch_pending_t *pending = realloc(w->pending, cap * sizeof(*pending));
+    if (!pending)
+        return -1;
+    w->pending = pending;
+
+    uint32_t *index = calloc(cap * 2, sizeof(*index));
+    if (!index)
+        return -1;
+    free(w->pending_index);
+    w->pending_index = index;
+    w->index_mask = cap * 2 - 1;
+    w->pending_cap = cap;
+    watch_index_rebuild(w);
+    return 0;
+}
+
+/* Fold one change into the pending table (watcher thread only). */
+static void watch_note(fossil_io_filesys_watch_t *w, const char *path, uint32_t mask, uint64_t now)
+{
+    if (w->lost)
+        return; /* the coming OVERFLOW already tells the reader to rescan */
+
+    size_t len = strlen(path);
+    size_t slot = (size_t)fossil_hash64_buffer(path, len) & w->index_mask;
+    for (uint32_t pos; (pos = w->pending_index[slot]) != 0; slot = (slot + 1) & w->index_mask)
+    {
+        watch_pending_t *e = &w->pending[pos - 1];
+        if (strcmp(e->path, path) != 0)
+            continue;
+
+        if (e->born && (mask & (FOSSIL_FILESYS_WATCH_DELETE | FOSSIL_FILESYS_WATCH_MOVED_FROM)))
+        {
+            e->mask = 0; /* came and went within one window */
+            e->born = false;
+        }
         else
         {
-            char *endptr;
-            uid = (uid_t)strtol(owner, &endptr, 10);
-            if (*endptr != '\0')
-                uid = (uid_t)-1;
+            if (e->mask == 0)
+                e->born = (mask & (FOSSIL_FILESYS_WATCH_CREATE | FOSSIL_FILESYS_WATCH_MOVED_TO)) != 0;
+            e->mask = (e->mask & ~(uint32_t)FOSSIL_FILESYS_WATCH_IS_DIR) | mask;
+        }
+        e->last = now;
+        return;
+    }
+
+    if (w->pending_count == FOSSIL_WATCH_MAX_PENDING)
+    {
+        watch_drop_pending(w);
+        w->lost = true;
+        return;
+    }
+
+    char *copy = malloc(len + 1);
+    if (!copy || (w->pending_count == w->pending_cap && watch_pending_grow(w) != 0))
+    {
+        free(copy);
+        watch_drop_pending(w);
+        w->lost = true;
+        return;
+    }
+    memcpy(copy, path, len + 1);
+
+    watch_pending_t *e = &w->pending[w->pending_count++];
+    e->path = copy;
+    e->mask = mask;
+    e->born = (mask & (FOSSIL_FILESYS_WATCH_CREATE | FOSSIL_FILESYS_WATCH_MOVED_TO)) != 0;
+    e->first = now;
+    e->last = now;
+
+    slot = (size_t)fossil_hash64_buffer(copy, len) & w->index_mask;
+    while (w->pending_index[slot])
+        slot = (slot + 1) & w->index_mask;
+    w->pending_index[slot] = (uint32_t)w->pending_count;
+}
+
+/*
+ * Publish every pending path whose quiet period has passed, in arrival
+ * order, and return how long the watcher thread may sleep (-1 = until the
+ * next notification).
+ */
+static int watch_flush(fossil_io_filesys_watch_t *w, uint64_t now)
+{
+    size_t cap = w->ring_mask + 1;
+    size_t tail = atomic_load_explicit(&w->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&w->head, memory_order_acquire);
+    bool full = false;
+
+    if (w->lost)
+    {
+        if (tail - head < cap)
+        {
+            fossil_io_filesys_watch_event_t *ev = &w->ring[tail & w->ring_mask];
+            ev->mask = FOSSIL_FILESYS_WATCH_OVERFLOW;
+            ev->path[0] = '\0';
+            ++tail;
+            w->lost = false;
+        }
+        else
+        {
+            full = true;
+        }
+    }
+
+    uint64_t hold = (uint64_t)w->debounce_ms;
+    uint64_t next = UINT64_MAX;
+    size_t keep = 0;
+    for (size_t i = 0; i < w->pending_count; ++i)
+    {
+        watch_pending_t *e = &w->pending[i];
+        uint64_t due = e->last + hold;
+        if (e->first + hold * FOSSIL_WATCH_MAX_HOLD < due)
+            due = e->first + hold * FOSSIL_WATCH_MAX_HOLD;
+
+        if (due <= now)
+        {
+            uint32_t mask = e->mask & (w->events | FOSSIL_FILESYS_WATCH_IS_DIR);
+            if (!(mask & FOSSIL_WATCH_KINDS))
+            {
+                free(e->path);
+                continue;
+            }
+            if (!full && tail - head == cap)
+                head = atomic_load_explicit(&w->head, memory_order_acquire);
+            if (!full && tail - head < cap)
+            {
+                fossil_io_filesys_watch_event_t *ev = &w->ring[tail & w->ring_mask];
+                ev->mask = mask;
+                strcpy(ev->path, e->path);
+                ++tail;
+                free(e->path);
+                continue;
+            }
+            full = true;
+        }
+        else if (due < next)
+        {
+            next = due;
         }
+        w->pending[keep++] = *e;
+    }
+
+    if (keep != w->pending_count)
+    {
+        w->pending_count = keep;
+        watch_index_rebuild(w);
+    }
+
+    if (tail != atomic_load_explicit(&w->tail, memory_order_relaxed))
+    {
+        atomic_store_explicit(&w->tail, tail, memory_order_release);
+        watch_signal(w);
+    }
+
+    if (full)
+        return FOSSIL_WATCH_RETRY_MS;
+    if (next == UINT64_MAX)
+        return -1;
+    return (next - now > INT32_MAX) ? INT32_MAX : (int)(next - now);
+}
+
+static fossil_io_filesys_watch_t *watch_alloc(const fossil_io_filesys_watch_opts_t *opts)
+{
+    fossil_io_filesys_watch_t *w = calloc(1, sizeof(*w));
+    if (!w)
+        return NULL;
+
+    size_t want = (opts && opts->capacity) ? opts->capacity : FOSSIL_WATCH_DEFAULT_CAPACITY;
+    if (want > FOSSIL_WATCH_MAX_CAPACITY)
+        want = FOSSIL_WATCH_MAX_CAPACITY;
+    size_t cap = 1;
+    while (cap < want)
+        cap <<= 1;
+
+    w->events = (opts && opts->events) ? (opts->events & FOSSIL_WATCH_KINDS) : FOSSIL_WATCH_KINDS;
+    w->debounce_ms = opts ? opts->debounce_ms : 0;
+    w->ring = malloc(cap * sizeof(*w->ring));
+    w->ring_mask = cap - 1;
+    atomic_init(&w->head, 0);
+    atomic_init(&w->tail, 0);
+    w->pending_cap = 64;
+    w->pending = malloc(w->pending_cap * sizeof(*w->pending));
+    w->pending_index = calloc(w->pending_cap * 2, sizeof(*w->pending_index));
+    w->index_mask = w->pending_cap * 2 - 1;
+
+    if (!w->ring || !w->pending || !w->pending_index)
+    {
+        free(w->ring);
+        free(w->pending);
+        free(w->pending_index);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+static void watch_release(fossil_io_filesys_watch_t *w)
+{
+    watch_drop_pending(w);
+    free(w->pending);
+    free(w->pending_index);
+    free(w->ring);
+    free(w);
+}
+
+#if defined(__linux__)
+
+static watch_dir_t *watch_dir_find(fossil_io_filesys_watch_t *w, int wd)
+{
+    size_t slot = ((uint32_t)wd * 2654435761u) & w->dir_mask;
+    while (w->dirs[slot].wd)
+    {
+        if (w->dirs[slot].wd == wd)
+            return &w->dirs[slot];
+        slot = (slot + 1) & w->dir_mask;
     }
-    if (group)
+    return NULL;
+}
+
+/* Remove a slot, shifting later entries of its probe run back into place. */
+static void watch_dir_erase(fossil_io_filesys_watch_t *w, watch_dir_t *d)
+{
+    free(d->path);
+    size_t hole = (size_t)(d - w->dirs);
+    size_t slot = hole;
+    for (;;)
     {
-        struct group *gr = getgrnam(group);
-        if (gr)
-            gid = gr->gr_gid;
-        else
+        slot = (slot + 1) & w->dir_mask;
+        if (!w->dirs[slot].wd)
+            break;
+        size_t home = ((uint32_t)w->dirs[slot].wd * 2654435761u) & w->dir_mask;
+        if (((slot - home) & w->dir_mask) >= ((slot - hole) & w->dir_mask))
         {
-            char *endptr;
-            gid = (gid_t)strtol(group, &endptr, 10);
-            if (*endptr != '\0')
-                gid = (gid_t)-1;
+            w->dirs[hole] = w->dirs[slot];
+            hole = slot;
         }
     }
-    if (uid == (uid_t)-1 && gid == (gid_t)-1)
-        return -1;
-    return chown(path, uid, gid);
-#endif
+    w->dirs[hole].wd = 0;
+    w->dirs[hole].path = NULL;
+    --w->dir_count;
 }
 
-/* Link Operations */
-
-int32_t fossil_io_filesys_link_create(
-    const char *target,
-    const char *link_path,
-    bool symbolic)
+/* Record (or re-point, after a rename) a watch descriptor; caller holds lock. */
+static int watch_dir_put(fossil_io_filesys_watch_t *w, int wd, const char *path, bool recursive, bool root)
 {
-    if (!target || !link_path)
+    char *copy = malloc(strlen(path) + 1);
+    if (!copy)
         return -1;
+    strcpy(copy, path);
 
-#if defined(_WIN32)
-
-    if (symbolic)
+    watch_dir_t *d = watch_dir_find(w, wd);
+    if (d)
     {
-        DWORD flags = 0;
+        free(d->path);
+        d->path = copy;
+        d->recursive = d->recursive || recursive;
+        d->root = d->root || root;
+        return 0;
+    }
 
-        /* detect directory target */
-        DWORD attr = GetFileAttributesA(target);
-        if (attr != INVALID_FILE_ATTRIBUTES &&
-            (attr & FILE_ATTRIBUTE_DIRECTORY))
+    if ((w->dir_count + 1) * 2 > w->dir_mask + 1)
+    {
+        size_t old_cap = w->dir_mask + 1;
+        watch_dir_t *old = w->dirs;
+        watch_dir_t *dirs = calloc(old_cap * 2, sizeof(*dirs));
+        if (!dirs)
         {
-            flags |= SYMBOLIC_LINK_FLAG_DIRECTORY;
+            free(copy);
+            return -1;
+        }
+        w->dirs = dirs;
+        w->dir_mask = old_cap * 2 - 1;
+        for (size_t i = 0; i < old_cap; ++i)
+        {
+            if (!old[i].wd)
+                continue;
+            size_t slot = ((uint32_t)old[i].wd * 2654435761u) & w->dir_mask;
+            while (w->dirs[slot].wd)
+                slot = (slot + 1) & w->dir_mask;
+            w->dirs[slot] = old[i];
         }
+        free(old);
+    }
 
-        /* allow unprivileged (Windows 10+) */
-#ifdef SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE
-        flags |= SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE;
-#endif
+    size_t slot = ((uint32_t)wd * 2654435761u) & w->dir_mask;
+    while (w->dirs[slot].wd)
+        slot = (slot + 1) & w->dir_mask;
+    w->dirs[slot].wd = wd;
+    w->dirs[slot].recursive = recursive;
+    w->dirs[slot].root = root;
+    w->dirs[slot].path = copy;
+    ++w->dir_count;
+    return 0;
+}
+
+/* Drop the watches on path and everything below it; returns how many. */
+static size_t watch_forget(fossil_io_filesys_watch_t *w, const char *path)
+{
+    size_t len = strlen(path);
+    size_t removed = 0;
 
-        return CreateSymbolicLinkA(link_path, target, flags) ? 0 : -1;
+    pthread_mutex_lock(&w->lock);
+    for (size_t i = 0; i <= w->dir_mask;)
+    {
+        watch_dir_t *d = &w->dirs[i];
+        if (d->wd && strncmp(d->path, path, len) == 0 && (d->path[len] == '\0' || d->path[len] == '/'))
+        {
+            inotify_rm_watch(w->ifd, d->wd);
+            watch_dir_erase(w, d);
+            ++removed;
+            continue; /* the erase may have shifted another entry into slot i */
+        }
+        ++i;
     }
-    else
+    pthread_mutex_unlock(&w->lock);
+    return removed;
+}
+
+/*
+ * Watch path and, when recursive, every directory below it. A directory
+ * that appeared while watching is scanned with report set: its entries may
+ * predate the new watch, so they are noted as created.
+ */
+static int watch_add_tree(fossil_io_filesys_watch_t *w, const char *path, bool recursive, bool root, bool report,
+                          uint64_t now)
+{
+    uint32_t flags = FOSSIL_WATCH_IN_MASK | (root ? 0 : (IN_ONLYDIR | IN_DONT_FOLLOW));
+    int wd = inotify_add_watch(w->ifd, path, flags);
+    if (wd < 0)
+        return -1;
+
+    pthread_mutex_lock(&w->lock);
+    int rc = watch_dir_put(w, wd, path, recursive, root);
+    pthread_mutex_unlock(&w->lock);
+    if (rc != 0)
     {
-        return CreateHardLinkA(link_path, target, NULL) ? 0 : -1;
+        inotify_rm_watch(w->ifd, wd);
+        return -1;
     }
 
-#else
+    DIR *dir = recursive ? opendir(path) : NULL;
+    if (!dir)
+        return 0; /* a plain file, or nothing to descend into */
 
-    if (symbolic)
-        return symlink(target, link_path);
-    else
-        return link(target, link_path);
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL)
+    {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
 
-#endif
-}
+        char child[FOSSIL_FILESYS_MAX_PATH];
+        int n = snprintf(child, sizeof(child), "%s/%s", path, de->d_name);
+        if (n < 0 || (size_t)n >= sizeof(child))
+            continue;
 
-int32_t fossil_io_filesys_link_read(
-    const char *link_path,
-    char *target_out,
-    size_t max_len)
-{
-    if (!link_path || !target_out || max_len == 0)
-        return -1;
+        bool is_dir = (de->d_type == DT_DIR);
+        if (de->d_type == DT_UNKNOWN)
+        {
+            struct stat st;
+            is_dir = (lstat(child, &st) == 0 && S_ISDIR(st.st_mode));
+        }
 
-#if defined(_WIN32)
+        if (report)
+            watch_note(w, child, FOSSIL_FILESYS_WATCH_CREATE | (is_dir ? FOSSIL_FILESYS_WATCH_IS_DIR : 0), now);
+        if (is_dir)
+            watch_add_tree(w, child, true, false, report, now); /* vanished or unreadable subtrees are skipped */
+    }
+    closedir(dir);
+    return 0;
+}
 
-    HANDLE h = CreateFileA(
-        link_path,
-        GENERIC_READ,
-        FILE_SHARE_READ,
-        NULL,
-        OPEN_EXISTING,
-        FILE_FLAG_BACKUP_SEMANTICS,
-        NULL);
+static void watch_handle(fossil_io_filesys_watch_t *w, const struct inotify_event *ev, uint64_t now)
+{
+    if (ev->mask & IN_Q_OVERFLOW)
+    {
+        watch_drop_pending(w);
+        w->lost = true;
+        return;
+    }
 
-    if (h == INVALID_HANDLE_VALUE)
-        return -1;
+    char path[FOSSIL_FILESYS_MAX_PATH];
+    int n;
+    bool recursive, root;
 
-    DWORD len = GetFinalPathNameByHandleA(
-        h,
-        target_out,
-        (DWORD)max_len,
-        FILE_NAME_NORMALIZED);
+    pthread_mutex_lock(&w->lock);
+    watch_dir_t *d = watch_dir_find(w, ev->wd);
+    if (!d || (ev->mask & IN_IGNORED))
+    {
+        if (d)
+            watch_dir_erase(w, d);
+        pthread_mutex_unlock(&w->lock);
+        return;
+    }
+    n = ev->len ? snprintf(path, sizeof(path), "%s/%s", d->path, ev->name) : snprintf(path, sizeof(path), "%s", d->path);
+    recursive = d->recursive;
+    root = d->root;
+    pthread_mutex_unlock(&w->lock);
+    if (n < 0 || (size_t)n >= sizeof(path))
+        return;
+
+    uint32_t mask = 0;
+    if (ev->mask & IN_CREATE)
+        mask |= FOSSIL_FILESYS_WATCH_CREATE;
+    if (ev->mask & IN_MODIFY)
+        mask |= FOSSIL_FILESYS_WATCH_MODIFY;
+    if (ev->mask & IN_ATTRIB)
+        mask |= FOSSIL_FILESYS_WATCH_ATTRIB;
+    if (ev->mask & IN_DELETE)
+        mask |= FOSSIL_FILESYS_WATCH_DELETE;
+    if (ev->mask & IN_MOVED_FROM)
+        mask |= FOSSIL_FILESYS_WATCH_MOVED_FROM;
+    if (ev->mask & IN_MOVED_TO)
+        mask |= FOSSIL_FILESYS_WATCH_MOVED_TO;
+    if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+    {
+        /* A subdirectory's own removal was already reported by its parent. */
+        if (!root)
+            return;
+        mask |= (ev->mask & IN_DELETE_SELF) ? FOSSIL_FILESYS_WATCH_DELETE : FOSSIL_FILESYS_WATCH_MOVED_FROM;
+    }
+    if (!mask)
+        return;
+    if (ev->mask & IN_ISDIR)
+        mask |= FOSSIL_FILESYS_WATCH_IS_DIR;
 
-    CloseHandle(h);
+    watch_note(w, path, mask, now);
 
-    if (len == 0 || len >= max_len)
-        return -1;
+    if (recursive && (ev->mask & IN_ISDIR))
+    {
+        /* A directory leaving keeps its watches under a stale name; drop them. */
+        if (ev->mask & IN_MOVED_FROM)
+            watch_forget(w, path);
+        else if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+            watch_add_tree(w, path, true, false, true, now);
+    }
+}
 
-    return 0;
+static void *watch_thread(void *arg)
+{
+    fossil_io_filesys_watch_t *w = (fossil_io_filesys_watch_t *)arg;
+    union
+    {
+        struct inotify_event ev;
+        char bytes[64 * 1024];
+    } buf;
+    int timeout = -1;
 
-#else
+    for (;;)
+    {
+        struct pollfd pfd[2] = {{w->ifd, POLLIN, 0}, {w->stop_fd, POLLIN, 0}};
+        if (poll(pfd, 2, timeout) < 0 && errno != EINTR)
+            break;
+        if (pfd[1].revents)
+            break;
 
-    ssize_t len = readlink(link_path, target_out, max_len - 1);
-    if (len < 0)
-        return -1;
+        if (pfd[0].revents & POLLIN)
+        {
+            uint64_t now = fossil_now_ms();
+            ssize_t n;
+            while ((n = read(w->ifd, buf.bytes, sizeof(buf.bytes))) > 0)
+            {
+                for (ssize_t off = 0; off < n;)
+                {
+                    const struct inotify_event *ev = (const struct inotify_event *)(buf.bytes + off);
+                    watch_handle(w, ev, now);
+                    off += (ssize_t)(sizeof(*ev) + ev->len);
+                }
+            }
+        }
+        timeout = watch_flush(w, fossil_now_ms());
+    }
+    return NULL;
+}
 
-    target_out[len] = '\0';
-    return 0;
+#else /* _WIN32 */
 
-#endif
+static void watch_root_free(watch_root_t *r)
+{
+    if (r->armed)
+    {
+        DWORD bytes;
+        CancelIoEx(r->dir, &r->ov);
+        GetOverlappedResult(r->dir, &r->ov, &bytes, TRUE);
+    }
+    if (r->ov.hEvent)
+        CloseHandle(r->ov.hEvent);
+    if (r->dir != INVALID_HANDLE_VALUE)
+        CloseHandle(r->dir);
+    free(r);
 }
 
-int32_t fossil_io_filesys_link_resolve(
-    const char *link_path,
-    char *target_out,
-    size_t max_len)
+static void watch_parse(fossil_io_filesys_watch_t *w, watch_root_t *r, uint64_t now)
 {
-    if (!link_path || !target_out || max_len == 0)
-        return -1;
+    const char *p = (const char *)r->buf;
+    for (;;)
+    {
+        const FILE_NOTIFY_INFORMATION *fni = (const FILE_NOTIFY_INFORMATION *)p;
+        char name[FOSSIL_FILESYS_MAX_PATH];
+        char path[FOSSIL_FILESYS_MAX_PATH];
+        int len = WideCharToMultiByte(CP_ACP, 0, fni->FileName, (int)(fni->FileNameLength / sizeof(WCHAR)), name,
+                                      (int)sizeof(name) - 1, NULL, NULL);
+        int n = -1;
+        if (len > 0)
+        {
+            name[len] = '\0';
+            n = snprintf(path, sizeof(path), "%s\\%s", r->path, name);
+        }
 
-#if defined(_WIN32)
+        uint32_t mask = 0;
+        switch (fni->Action)
+        {
+        case FILE_ACTION_ADDED:
+            mask = FOSSIL_FILESYS_WATCH_CREATE;
+            break;
+        case FILE_ACTION_REMOVED:
+            mask = FOSSIL_FILESYS_WATCH_DELETE;
+            break;
+        case FILE_ACTION_MODIFIED:
+            mask = FOSSIL_FILESYS_WATCH_MODIFY;
+            break;
+        case FILE_ACTION_RENAMED_OLD_NAME:
+            mask = FOSSIL_FILESYS_WATCH_MOVED_FROM;
+            break;
+        case FILE_ACTION_RENAMED_NEW_NAME:
+            mask = FOSSIL_FILESYS_WATCH_MOVED_TO;
+            break;
+        }
 
-    HANDLE h = CreateFileA(
-        link_path,
-        GENERIC_READ,
-        FILE_SHARE_READ,
-        NULL,
-        OPEN_EXISTING,
-        FILE_FLAG_BACKUP_SEMANTICS,
-        NULL);
+        if (mask && n > 0 && (size_t)n < sizeof(path))
+        {
+            if (!(mask & (FOSSIL_FILESYS_WATCH_DELETE | FOSSIL_FILESYS_WATCH_MOVED_FROM)))
+            {
+                DWORD attr = GetFileAttributesA(path);
+                if (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY))
+                    mask |= FOSSIL_FILESYS_WATCH_IS_DIR;
+            }
+            /* Directories report MODIFIED whenever a child changes; skip that noise. */
+            if (mask != (FOSSIL_FILESYS_WATCH_MODIFY | FOSSIL_FILESYS_WATCH_IS_DIR))
+                watch_note(w, path, mask, now);
+        }
 
-    if (h == INVALID_HANDLE_VALUE)
-        return -1;
+        if (!fni->NextEntryOffset)
+            break;
+        p += fni->NextEntryOffset;
+    }
+}
 
-    DWORD len = GetFinalPathNameByHandleA(
-        h,
-        target_out,
-        (DWORD)max_len,
-        FILE_NAME_NORMALIZED);
+static DWORD WINAPI watch_thread(LPVOID arg)
+{
+    fossil_io_filesys_watch_t *w = (fossil_io_filesys_watch_t *)arg;
+    DWORD timeout = INFINITE;
 
-    CloseHandle(h);
+    for (;;)
+    {
+        HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+        watch_root_t *owners[MAXIMUM_WAIT_OBJECTS];
+        DWORD count = 0;
+        handles[count++] = w->wake;
 
-    if (len == 0 || len >= max_len)
-        return -1;
+        EnterCriticalSection(&w->lock);
+        for (size_t i = 0; i < w->root_count;)
+        {
+            watch_root_t *r = w->roots[i];
+            if (r->closing)
+            {
+                watch_root_free(r);
+                w->roots[i] = w->roots[--w->root_count];
+                continue;
+            }
+            if (!r->armed)
+                r->armed = ReadDirectoryChangesW(r->dir, r->buf, sizeof(r->buf), r->recursive,
+                                                 FOSSIL_WATCH_WIN_FILTER, NULL, &r->ov, NULL) != 0;
+            if (r->armed)
+            {
+                owners[count] = r;
+                handles[count++] = r->ov.hEvent;
+            }
+            ++i;
+        }
+        LeaveCriticalSection(&w->lock);
+
+        DWORD rc = WaitForMultipleObjects(count, handles, FALSE, timeout);
+        if (InterlockedCompareExchange(&w->stop, 0, 0))
+            break;
+
+        if (rc > WAIT_OBJECT_0 && rc < WAIT_OBJECT_0 + count)
+        {
+            watch_root_t *r = owners[rc - WAIT_OBJECT_0];
+            DWORD bytes = 0;
+            r->armed = false;
+            if (GetOverlappedResult(r->dir, &r->ov, &bytes, FALSE))
+            {
+                if (bytes == 0)
+                {
+                    watch_drop_pending(w); /* the change buffer overflowed */
+                    w->lost = true;
+                }
+                else
+                {
+                    watch_parse(w, r, fossil_now_ms());
+                }
+            }
+        }
 
+        int next = watch_flush(w, fossil_now_ms());
+        timeout = (next < 0) ? INFINITE : (DWORD)next;
+    }
     return 0;
+}
 
-#else
+#endif /* __linux__ */
 
-    char buf[PATH_MAX];
+#endif /* FOSSIL_HAVE_WATCH */
 
-    ssize_t len = readlink(link_path, buf, sizeof(buf) - 1);
+#if !defined(FOSSIL_HAVE_WATCH)
+static bool watch_has_events(const fossil_io_filesys_watch_t *w)
+{
+    (void)w;
+    return false;
+}
+#endif
 
-    if (len < 0)
+fossil_io_filesys_watch_t *fossil_io_filesys_watch_open(const fossil_io_filesys_watch_opts_t *opts)
+{
+#if !defined(FOSSIL_HAVE_WATCH)
+    (void)opts;
+    errno = ENOSYS;
+    return NULL;
+#else
+    fossil_io_filesys_watch_t *w = watch_alloc(opts);
+    if (!w)
+        return NULL;
+
+#if defined(__linux__)
+    w->ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    w->ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    w->stop_fd = eventfd(0, EFD_CLOEXEC);
+    w->dirs = calloc(64, sizeof(*w->dirs));
+    w->dir_mask = 63;
+    if (w->ifd >= 0 && w->ready_fd >= 0 && w->stop_fd >= 0 && w->dirs && pthread_mutex_init(&w->lock, NULL) == 0)
     {
-        // Not a symlink → fallback: just copy path
-        strncpy(target_out, link_path, max_len - 1);
-        target_out[max_len - 1] = '\0';
-        return 0;
+        w->started = (pthread_create(&w->thread, NULL, watch_thread, w) == 0);
+        if (!w->started)
+            pthread_mutex_destroy(&w->lock);
+    }
+    if (!w->started)
+    {
+        if (w->ifd >= 0)
+            close(w->ifd);
+        if (w->ready_fd >= 0)
+            close(w->ready_fd);
+        if (w->stop_fd >= 0)
+            close(w->stop_fd);
+        free(w->dirs);
+        watch_release(w);
+        return NULL;
+    }
+#else
+    InitializeCriticalSection(&w->lock);
+    w->ready = CreateEvent(NULL, TRUE, FALSE, NULL);
+    w->wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (w->ready && w->wake)
+        w->thread = CreateThread(NULL, 0, watch_thread, w, 0, NULL);
+    if (!w->thread)
+    {
+        if (w->ready)
+            CloseHandle(w->ready);
+        if (w->wake)
+            CloseHandle(w->wake);
+        DeleteCriticalSection(&w->lock);
+        watch_release(w);
+        return NULL;
     }
+#endif
+    return w;
+#endif
+}
 
-    buf[len] = '\0';
+void fossil_io_filesys_watch_close(fossil_io_filesys_watch_t *w)
+{
+#if defined(FOSSIL_HAVE_WATCH)
+    if (!w)
+        return;
+
+#if defined(__linux__)
+    uint64_t one = 1;
+    ssize_t rc = write(w->stop_fd, &one, sizeof(one));
+    (void)rc;
+    pthread_join(w->thread, NULL);
+    close(w->ifd); /* also drops every inotify watch */
+    close(w->ready_fd);
+    close(w->stop_fd);
+    for (size_t i = 0; i <= w->dir_mask; ++i)
+        free(w->dirs[i].path);
+    free(w->dirs);
+    pthread_mutex_destroy(&w->lock);
+#else
+    InterlockedExchange(&w->stop, 1);
+    SetEvent(w->wake);
+    WaitForSingleObject(w->thread, INFINITE);
+    CloseHandle(w->thread);
+    for (size_t i = 0; i < w->root_count; ++i)
+        watch_root_free(w->roots[i]);
+    CloseHandle(w->ready);
+    CloseHandle(w->wake);
+    DeleteCriticalSection(&w->lock);
+#endif
+    watch_release(w);
+#else
+    (void)w;
+#endif
+}
 
-    // If relative symlink → resolve against directory
-    if (buf[0] != '/')
-    {
-        char dir[PATH_MAX];
-        strncpy(dir, link_path, sizeof(dir) - 1);
-        dir[sizeof(dir) - 1] = '\0';
+int32_t fossil_io_filesys_watch_add(fossil_io_filesys_watch_t *w, const char *path, bool recursive)
+{
+#if !defined(FOSSIL_HAVE_WATCH)
+    (void)w;
+    (void)path;
+    (void)recursive;
+    return -1;
+#else
+    char clean[FOSSIL_FILESYS_MAX_PATH];
+    if (!w || !path || watch_clean_path(path, clean) != 0)
+        return -1;
 
-        char *slash = strrchr(dir, '/');
-        if (slash)
-            *slash = '\0';
-        else
-            strcpy(dir, ".");
+#if defined(__linux__)
+    return watch_add_tree(w, clean, recursive, true, false, 0);
+#else
+    DWORD attr = GetFileAttributesA(clean);
+    if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY))
+        return -1;
 
-        snprintf(target_out, max_len, "%s/%s", dir, buf);
+    watch_root_t *r = calloc(1, sizeof(*r));
+    if (!r)
+        return -1;
+    strcpy(r->path, clean);
+    r->recursive = recursive;
+    r->dir = CreateFileA(clean, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                         OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    r->ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (r->dir == INVALID_HANDLE_VALUE || !r->ov.hEvent)
+    {
+        watch_root_free(r);
+        return -1;
     }
-    else
+
+    EnterCriticalSection(&w->lock);
+    bool added = (w->root_count < FOSSIL_WATCH_MAX_ROOTS);
+    if (added)
+        w->roots[w->root_count++] = r;
+    LeaveCriticalSection(&w->lock);
+    if (!added)
     {
-        // Absolute target
-        strncpy(target_out, buf, max_len - 1);
-        target_out[max_len - 1] = '\0';
+        watch_root_free(r);
+        return -1;
     }
-
+    SetEvent(w->wake); /* the watcher thread arms it */
     return 0;
-
+#endif
 #endif
 }
 
-int32_t fossil_io_filesys_link_is_symbolic(
-    const char *link_path,
-    bool *is_symbolic)
+int32_t fossil_io_filesys_watch_remove(fossil_io_filesys_watch_t *w, const char *path)
 {
-    if (!link_path || !is_symbolic)
+#if !defined(FOSSIL_HAVE_WATCH)
+    (void)w;
+    (void)path;
+    return -1;
+#else
+    char clean[FOSSIL_FILESYS_MAX_PATH];
+    if (!w || !path || watch_clean_path(path, clean) != 0)
         return -1;
 
-#if defined(_WIN32)
+#if defined(__linux__)
+    return watch_forget(w, clean) ? 0 : -1;
+#else
+    bool found = false;
+    EnterCriticalSection(&w->lock);
+    for (size_t i = 0; i < w->root_count && !found; ++i)
+    {
+        if (!w->roots[i]->closing && strcmp(w->roots[i]->path, clean) == 0)
+        {
+            w->roots[i]->closing = true; /* freed by the watcher thread */
+            found = true;
+        }
+    }
+    LeaveCriticalSection(&w->lock);
+    if (found)
+        SetEvent(w->wake);
+    return found ? 0 : -1;
+#endif
+#endif
+}
 
-    DWORD attr = GetFileAttributesA(link_path);
-    if (attr == INVALID_FILE_ATTRIBUTES)
-        return -1;
+int fossil_io_filesys_watch_fd(const fossil_io_filesys_watch_t *w)
+{
+#if defined(__linux__)
+    return w ? w->ready_fd : -1;
+#else
+    (void)w;
+    return -1;
+#endif
+}
 
-    *is_symbolic = (attr & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
-    return 0;
+int32_t fossil_io_filesys_watch_read(fossil_io_filesys_watch_t *w, fossil_io_filesys_watch_event_t *events, size_t max)
+{
+#if !defined(FOSSIL_HAVE_WATCH)
+    (void)w;
+    (void)events;
+    (void)max;
+    return -1;
+#else
+    if (!w || (!events && max))
+        return -1;
 
+    /* Clear readiness first, so an event published after the drain re-arms it. */
+#if defined(__linux__)
+    uint64_t value;
+    ssize_t rc = read(w->ready_fd, &value, sizeof(value));
+    (void)rc;
 #else
+    ResetEvent(w->ready);
+#endif
 
-    struct stat st;
-    if (lstat(link_path, &st) != 0)
-        return -1;
+    size_t head = atomic_load_explicit(&w->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&w->tail, memory_order_acquire);
+    size_t n = tail - head;
+    if (n > max)
+        n = max;
+    if (n > INT32_MAX)
+        n = INT32_MAX;
 
-    *is_symbolic = S_ISLNK(st.st_mode);
-    return 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const fossil_io_filesys_watch_event_t *ev = &w->ring[(head + i) & w->ring_mask];
+        events[i].mask = ev->mask;
+        strcpy(events[i].path, ev->path);
+    }
+    atomic_store_explicit(&w->head, head + n, memory_order_release);
 
+    if (head + n != tail)
+        watch_signal(w);
+    return (int32_t)n;
 #endif
 }
 
-int32_t fossil_io_filesys_link_remove(const char *link_path)
+int32_t fossil_io_filesys_watch_wait(fossil_io_filesys_watch_t *w, fossil_io_filesys_watch_event_t *events, size_t max,
+                                     int32_t timeout_ms)
 {
-    if (!link_path)
+#if !defined(FOSSIL_HAVE_WATCH)
+    (void)w;
+    (void)events;
+    (void)max;
+    (void)timeout_ms;
+    return -1;
+#else
+    if (!w || !events || max == 0)
         return -1;
-#if defined(_WIN32)
-    // On Windows, DeleteFileA removes both files and links (symbolic/hard)
-    return DeleteFileA(link_path) ? 0 : -1;
+
+    uint64_t deadline = (timeout_ms >= 0) ? fossil_now_ms() + (uint64_t)timeout_ms : 0;
+    for (;;)
+    {
+        int32_t n = fossil_io_filesys_watch_read(w, events, max);
+        if (n != 0)
+            return n;
+
+        int remaining = -1;
+        if (timeout_ms >= 0)
+        {
+            uint64_t now = fossil_now_ms();
+            if (now >= deadline)
+                return 0;
+            remaining = (int)(deadline - now);
+        }
+
+#if defined(__linux__)
+        struct pollfd pfd = {w->ready_fd, POLLIN, 0};
+        if (poll(&pfd, 1, remaining) < 0 && errno != EINTR)
+            return -1;
 #else
-    // Use unlink to remove the link itself, not the target
-    return (unlink(link_path) == 0) ? 0 : -1;
+        WaitForSingleObject(w->ready, remaining < 0 ? INFINITE : (DWORD)remaining);
+#endif
+    }
 #endif
 }
 
-int32_t fossil_io_filesys_link_exists(const char *link_path)
-{
-    if (!link_path)
-        return -1;
+/* Path Views */
+
 #if defined(_WIN32)
-    DWORD attr = GetFileAttributesA(link_path);
-    if (attr == INVALID_FILE_ATTRIBUTES)
-        return (GetLastError() == ERROR_FILE_NOT_FOUND ||
-                GetLastError() == ERROR_PATH_NOT_FOUND) ? 0 : -1;
-    // Check if it's a reparse point (symbolic link) or a file (hard link indistinguishable)
-    return (attr & FILE_ATTRIBUTE_REPARSE_POINT) ? 1 : 0;
+#define PATHVIEW_IS_SEP(c) ((c) == '/' || (c) == '\\')
 #else
-    struct stat st;
-    if (lstat(link_path, &st) == 0)
-        return (S_ISLNK(st.st_mode)) ? 1 : 0;
-    if (errno == ENOENT)
-        return 0;
-    return -1;
+#define PATHVIEW_IS_SEP(c) ((c) == '/')
 #endif
+
+static fossil_io_filesys_pathview_t pathview_make(const char *ptr, size_t len)
+{
+    fossil_io_filesys_pathview_t v;
+    v.ptr = ptr;
+    v.len = len;
+    return v;
 }
 
-int32_t fossil_io_filesys_link_set_perms(const char *link_path, fossil_io_filesys_perms_t perms)
+static size_t pathview_root_len(fossil_io_filesys_pathview_t v)
 {
-    if (!link_path)
-        return -1;
+    size_t n = 0;
 #if defined(_WIN32)
-    // Not supported on Windows
-    (void)perms;
-    return 0;
-#else
-# if defined(HAVE_LCHMOD)
-    mode_t mode = 0;
-    if (perms.read)
-        mode |= S_IRUSR | S_IRGRP | S_IROTH;
-    if (perms.write)
-        mode |= S_IWUSR | S_IWGRP | S_IWOTH;
-    if (perms.execute)
-        mode |= S_IXUSR | S_IXGRP | S_IXOTH;
-    return lchmod(link_path, mode);
-# else
-    // Most systems do not support changing symlink perms
-    (void)perms;
-    return 0;
-# endif
+    if (v.len >= 2 && v.ptr[1] == ':' && (v.ptr[0] | 0x20) >= 'a' && (v.ptr[0] | 0x20) <= 'z')
+        n = 2;
 #endif
+    while (n < v.len && PATHVIEW_IS_SEP(v.ptr[n]))
+        ++n;
+    return n;
 }
 
-int32_t fossil_io_filesys_link_set_owner(const char *link_path, const char *owner, const char *group)
+/* End of the path once trailing separators above the root are dropped. */
+static size_t pathview_trim(fossil_io_filesys_pathview_t v, size_t root)
 {
-    if (!link_path)
-        return -1;
-#if defined(_WIN32)
-    // Not supported on Windows
-    (void)owner;
-    (void)group;
-    return 0;
-#else
-    uid_t uid = (uid_t)-1;
-    gid_t gid = (gid_t)-1;
-    if (owner)
-    {
-        struct passwd *pw = getpwnam(owner);
-        if (pw)
-            uid = pw->pw_uid;
-        else
-        {
-            char *endptr;
-            uid = (uid_t)strtol(owner, &endptr, 10);
-            if (*endptr != '\0')
-                uid = (uid_t)-1;
-        }
-    }
-    if (group)
+    size_t end = v.len;
+    while (end > root && PATHVIEW_IS_SEP(v.ptr[end - 1]))
+        --end;
+    return end;
+}
+
+/* Offset of the last component, given the trimmed end. */
+static size_t pathview_last(fossil_io_filesys_pathview_t v, size_t root, size_t end)
+{
+    size_t start = end;
+    while (start > root && !PATHVIEW_IS_SEP(v.ptr[start - 1]))
+        --start;
+    return start;
+}
+
+static bool pathview_put(char *out, size_t max_len, size_t *n, const char *src, size_t len)
+{
+    if (len >= max_len - *n)
+        return false;
+    memmove(out + *n, src, len);
+    *n += len;
+    return true;
+}
+
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview(const char *path)
+{
+    return path ? pathview_make(path, strlen(path)) : pathview_make("", 0);
+}
+
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_n(const char *path, size_t len)
+{
+    return path ? pathview_make(path, len) : pathview_make("", 0);
+}
+
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_root(fossil_io_filesys_pathview_t path)
+{
+    return pathview_make(path.ptr, pathview_root_len(path));
+}
+
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_parent(fossil_io_filesys_pathview_t path)
+{
+    size_t root = pathview_root_len(path);
+    size_t end = pathview_trim(path, root);
+    size_t start = pathview_last(path, root, end);
+
+    if (start == end)
+        return pathview_make(path.ptr, 0);
+    while (start > root && PATHVIEW_IS_SEP(path.ptr[start - 1]))
+        --start;
+    return pathview_make(path.ptr, start);
+}
+
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_filename(fossil_io_filesys_pathview_t path)
+{
+    size_t root = pathview_root_len(path);
+    size_t end = pathview_trim(path, root);
+    size_t start = pathview_last(path, root, end);
+    return pathview_make(path.ptr + start, end - start);
+}
+
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_extension(fossil_io_filesys_pathview_t path)
+{
+    fossil_io_filesys_pathview_t name = fossil_io_filesys_pathview_filename(path);
+    bool dots = (name.len == 1 && name.ptr[0] == '.') ||
+                (name.len == 2 && name.ptr[0] == '.' && name.ptr[1] == '.');
+
+    for (size_t i = name.len; !dots && i > 1; --i)
     {
-        struct group *gr = getgrnam(group);
-        if (gr)
-            gid = gr->gr_gid;
-        else
-        {
-            char *endptr;
-            gid = (gid_t)strtol(group, &endptr, 10);
-            if (*endptr != '\0')
-                gid = (gid_t)-1;
-        }
+        if (name.ptr[i - 1] == '.')
+            return pathview_make(name.ptr + i - 1, name.len - (i - 1));
     }
-    if (uid == (uid_t)-1 && gid == (gid_t)-1)
-        return -1;
-# if defined(HAVE_LCHOWN)
-    return lchown(link_path, uid, gid);
-# else
-    // If lchown is not available, fallback is not possible
-    return -1;
-# endif
-#endif
+    return pathview_make(name.ptr + name.len, 0);
 }
 
-/* Transaction Operations */
-
-static fossil_io_filesys_lock_t g_tx_lock;
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_stem(fossil_io_filesys_pathview_t path)
+{
+    fossil_io_filesys_pathview_t name = fossil_io_filesys_pathview_filename(path);
+    fossil_io_filesys_pathview_t ext = fossil_io_filesys_pathview_extension(path);
+    return pathview_make(name.ptr, name.len - ext.len);
+}
 
-int32_t fossil_io_filesys_tx_init(void)
+void fossil_io_filesys_pathiter_init(fossil_io_filesys_pathiter_t *it, fossil_io_filesys_pathview_t path)
 {
-    return fossil_mutex_init(&g_tx_lock);
+    if (!it)
+        return;
+    it->path = path;
+    it->pos = 0;
 }
 
-int32_t fossil_io_filesys_tx_begin(void)
+bool fossil_io_filesys_pathiter_next(fossil_io_filesys_pathiter_t *it, fossil_io_filesys_pathview_t *component)
 {
-    if (!g_tx_lock.handle)
-        return fossil_io_filesys_tx_init();
+    if (!it || !component)
+        return false;
 
-    return fossil_mutex_lock(&g_tx_lock);
+    const fossil_io_filesys_pathview_t v = it->path;
+    if (it->pos == 0)
+    {
+        size_t root = pathview_root_len(v);
+        if (root > 0)
+        {
+            it->pos = root;
+            *component = pathview_make(v.ptr, root);
+            return true;
+        }
+    }
+    while (it->pos < v.len && PATHVIEW_IS_SEP(v.ptr[it->pos]))
+        ++it->pos;
+    if (it->pos >= v.len)
+        return false;
+
+    size_t start = it->pos;
+    while (it->pos < v.len && !PATHVIEW_IS_SEP(v.ptr[it->pos]))
+        ++it->pos;
+    *component = pathview_make(v.ptr + start, it->pos - start);
+    return true;
 }
 
-int32_t fossil_io_filesys_tx_commit(void)
+int32_t fossil_io_filesys_pathview_copy(fossil_io_filesys_pathview_t path, char *out, size_t max_len)
 {
-    if (!g_tx_lock.handle || !g_tx_lock.locked)
-        return -1;
+    size_t n = 0;
 
-    return fossil_mutex_unlock(&g_tx_lock);
+    if (!out || max_len == 0 || max_len > INT32_MAX)
+        return -1;
+    if (!pathview_put(out, max_len, &n, path.ptr, path.len))
+        return -1;
+    out[n] = '\0';
+    return (int32_t)n;
 }
 
-int32_t fossil_io_filesys_tx_rollback(void)
+int32_t fossil_io_filesys_pathview_join(fossil_io_filesys_pathview_t base, fossil_io_filesys_pathview_t tail,
+                                        char *out, size_t max_len)
 {
-    if (!g_tx_lock.handle || !g_tx_lock.locked)
+    size_t n = 0;
+    char sep = PATH_SEP;
+
+    if (!out || max_len == 0 || max_len > INT32_MAX)
         return -1;
+    if (pathview_root_len(tail) > 0)
+        base.len = 0;
 
-    return fossil_mutex_unlock(&g_tx_lock);
+    if (!pathview_put(out, max_len, &n, base.ptr, base.len))
+        return -1;
+    if (n > 0 && tail.len > 0 && !PATHVIEW_IS_SEP(out[n - 1]) &&
+        !pathview_put(out, max_len, &n, &sep, 1))
+        return -1;
+    if (!pathview_put(out, max_len, &n, tail.ptr, tail.len))
+        return -1;
+    out[n] = '\0';
+    return (int32_t)n;
 }
 
-int32_t fossil_io_filesys_tx_is_active(void)
+int32_t fossil_io_filesys_pathview_normalize(fossil_io_filesys_pathview_t path, char *out, size_t max_len)
 {
-    return (g_tx_lock.locked) ? 1 : 0;
+    fossil_io_filesys_pathiter_t it;
+    fossil_io_filesys_pathview_t c;
+    char sep = PATH_SEP;
+    size_t root = pathview_root_len(path);
+    size_t floor = 0;
+    size_t n = 0;
+
+    if (!out || max_len == 0 || max_len > INT32_MAX)
+        return -1;
+
+    /*
+     * Every byte written lies at or before the input byte it came from, so
+     * copying forward with memmove is safe when out aliases path.
+     */
+    if (root > 0)
+    {
+        size_t drive = root;
+        while (drive > 0 && PATHVIEW_IS_SEP(path.ptr[drive - 1]))
+            --drive;
+        if (!pathview_put(out, max_len, &n, path.ptr, drive))
+            return -1;
+        if (drive < root && !pathview_put(out, max_len, &n, &sep, 1))
+            return -1;
+        floor = n;
+    }
+
+    fossil_io_filesys_pathiter_init(&it, pathview_make(path.ptr + root, path.len - root));
+    while (fossil_io_filesys_pathiter_next(&it, &c))
+    {
+        if (c.len == 1 && c.ptr[0] == '.')
+            continue;
+        if (c.len == 2 && c.ptr[0] == '.' && c.ptr[1] == '.')
+        {
+            size_t last = n;
+            while (last > floor && out[last - 1] != PATH_SEP)
+                --last;
+            if (n > last && !(n - last == 2 && out[last] == '.' && out[last + 1] == '.'))
+            {
+                n = (last > floor) ? last - 1 : floor;
+                continue;
+            }
+            if (root > 0)
+                continue;
+        }
+        if (n > floor && !pathview_put(out, max_len, &n, &sep, 1))
+            return -1;
+        if (!pathview_put(out, max_len, &n, c.ptr, c.len))
+            return -1;
+    }
+
+    if (n == 0 && !pathview_put(out, max_len, &n, ".", 1))
+        return -1;
+    out[n] = '\0';
+    return (int32_t)n;
 }
 
 /* Path / Utility Operations */
@@ -2729,10 +12145,14 @@ int32_t fossil_io_filesys_chdir(const char *path)
         return -1;
 
 #if defined(_WIN32)
-    return _chdir(path);
+    int32_t rc = _chdir(path);
 #else
-    return chdir(path);
+    int32_t rc = chdir(path);
 #endif
+    /* relative keys now name other files */
+    if (rc == 0)
+        fossil_cache_forget(NULL, true);
+    return rc;
 }
 
 int32_t fossil_io_filesys_abspath(const char *path, char *abs_path, size_t max_len)
@@ -2747,21 +12167,19 @@ int32_t fossil_io_filesys_abspath(const char *path, char *abs_path, size_t max_l
 
 #else
 
-    // Already absolute
-    if (path[0] == '/')
+    fossil_io_filesys_pathview_t view = fossil_io_filesys_pathview(path);
+
+    // Relative → prepend cwd; it is read every time, since any chdir() moves it
+    if (pathview_root_len(view) == 0)
     {
-        strncpy(abs_path, path, max_len - 1);
-        abs_path[max_len - 1] = '\0';
-        return 0;
+        if (!getcwd(abs_path, max_len))
+            return -1;
+        if (fossil_io_filesys_pathview_join(pathview_make(abs_path, strlen(abs_path)), view, abs_path, max_len) < 0)
+            return -1;
+        view = pathview_make(abs_path, strlen(abs_path));
     }
 
-    // Relative → prepend cwd
-    char cwd[PATH_MAX];
-    if (!getcwd(cwd, sizeof(cwd)))
-        return -1;
-
-    int written = snprintf(abs_path, max_len, "%s/%s", cwd, path);
-    if (written < 0 || (size_t)written >= max_len)
+    if (fossil_io_filesys_pathview_normalize(view, abs_path, max_len) < 0)
         return -1;
 
 #endif
@@ -2774,32 +12192,13 @@ int32_t fossil_io_filesys_dirname(const char *path, char *dir_out, size_t max_le
     if (!path || !dir_out || max_len == 0)
         return -1;
 
-    char tmp[PATH_MAX];
-    strncpy(tmp, path, sizeof(tmp) - 1);
-    tmp[sizeof(tmp) - 1] = '\0';
-
-#if defined(_WIN32)
-    char *last_sep = strrchr(tmp, '\\');
-#else
-    char *last_sep = strrchr(tmp, '/');
-#endif
-
-    if (!last_sep)
-    {
-        /* no separator, return "." */
-        strncpy(dir_out, ".", max_len);
-        dir_out[max_len - 1] = '\0';
-    }
-    else
-    {
-        size_t len = (size_t)(last_sep - tmp);
-        if (len >= max_len)
-            len = max_len - 1;
-        strncpy(dir_out, tmp, len);
-        dir_out[len] = '\0';
-    }
-
-    return 0;
+    fossil_io_filesys_pathview_t view = fossil_io_filesys_pathview(path);
+    fossil_io_filesys_pathview_t dir = fossil_io_filesys_pathview_parent(view);
+    if (dir.len == 0 && pathview_root_len(view) > 0)
+        dir = fossil_io_filesys_pathview_root(view); /* the root is its own parent */
+    else if (dir.len == 0)
+        dir = pathview_make(".", 1); /* no separator */
+    return fossil_io_filesys_pathview_copy(dir, dir_out, max_len) < 0 ? -1 : 0;
 }
 
 int32_t fossil_io_filesys_basename(const char *path, char *name_out, size_t max_len)
@@ -2807,19 +12206,8 @@ int32_t fossil_io_filesys_basename(const char *path, char *name_out, size_t max_
     if (!path || !name_out || max_len == 0)
         return -1;
 
-    const char *base = path;
-
-#if defined(_WIN32)
-    const char *last_sep = strrchr(path, '\\');
-#else
-    const char *last_sep = strrchr(path, '/');
-#endif
-    if (last_sep)
-        base = last_sep + 1;
-
-    strncpy(name_out, base, max_len);
-    name_out[max_len - 1] = '\0';
-    return 0;
+    fossil_io_filesys_pathview_t name = fossil_io_filesys_pathview_filename(fossil_io_filesys_pathview(path));
+    return fossil_io_filesys_pathview_copy(name, name_out, max_len) < 0 ? -1 : 0;
 }
 
 int32_t fossil_io_filesys_extension(const char *path, char *ext_out, size_t max_len)
@@ -2827,27 +12215,8 @@ int32_t fossil_io_filesys_extension(const char *path, char *ext_out, size_t max_
     if (!path || !ext_out || max_len == 0)
         return -1;
 
-    const char *base = path;
-#if defined(_WIN32)
-    const char *last_sep = strrchr(path, '\\');
-#else
-    const char *last_sep = strrchr(path, '/');
-#endif
-    if (last_sep)
-        base = last_sep + 1;
-
-    const char *dot = strrchr(base, '.');
-    if (!dot || dot == base)
-    {
-        ext_out[0] = '\0';
-    }
-    else
-    {
-        strncpy(ext_out, dot, max_len);
-        ext_out[max_len - 1] = '\0';
-    }
-
-    return 0;
+    fossil_io_filesys_pathview_t ext = fossil_io_filesys_pathview_extension(fossil_io_filesys_pathview(path));
+    return fossil_io_filesys_pathview_copy(ext, ext_out, max_len) < 0 ? -1 : 0;
 }
 
 char *fossil_io_filesys_path_normalize(const char *path)
@@ -2855,23 +12224,16 @@ char *fossil_io_filesys_path_normalize(const char *path)
     if (!path)
         return NULL;
 
-    char *normalized = malloc(PATH_MAX);
+    /* never longer than the input, except "" -> "." */
+    size_t len = strlen(path);
+    char *normalized = malloc(len + 2);
     if (!normalized)
         return NULL;
-#if defined(_WIN32)
-    char *p = normalized;
-    for (const char *s = path; *s; ++s)
+    if (fossil_io_filesys_pathview_normalize(pathview_make(path, len), normalized, len + 2) < 0)
     {
-        if (*s == '\\')
-            *p++ = '/';
-        else
-            *p++ = *s;
+        free(normalized);
+        return NULL;
     }
-    *p = '\0';
-#else
-    strncpy(normalized, path, PATH_MAX - 1);
-    normalized[PATH_MAX - 1] = '\0';
-#endif
     return normalized;
 }
 
@@ -137,6 +137,7 @@ typedef struct fossil_io_archive_stats
  * @return Pointer to initialized archive handle, or NULL on failure
  *
  * @note The caller is responsible for closing the archive with fossil_io_archive_close()
+ * @note Opening an existing ZIP reads only its central directory; entry data is read on extraction
  * @see fossil_io_archive_close()
  */
 fossil_io_archive_t *fossil_io_archive_open(const char *path, fossil_io_archive_type_t type, fossil_io_archive_mode_t mode, fossil_io_archive_compression_t compression);
@@ -206,9 +207,26 @@ bool fossil_io_archive_get_stats(fossil_io_archive_t *archive, fossil_io_archive
  * @note Caller must free the entries array using fossil_io_archive_free_entries()
  * @note The archive must be opened in a readable mode
  * @note Entry names use forward slashes as path separators regardless of platform
+ * @see fossil_io_archive_entries() for a copy-free view of the same table
  */
 ssize_t fossil_io_archive_list(fossil_io_archive_t *archive, fossil_io_archive_entry_t **entries);
 
+/**
+ * Borrow a read-only view of all entries in the archive.
+ *
+ * This function exposes the archive's internal entry table directly, without
+ * allocating or copying names. Entry names are unique, so the view holds the
+ * same entries, in the same order, as fossil_io_archive_list().
+ *
+ * @param archive Pointer to an opened archive handle
+ * @param entries Pointer to receive the first entry, or NULL when empty
+ * @return Number of entries in the view, or -1 on error
+ *
+ * @note Do not free the view or its names
+ * @note The view is invalidated by any add, remove, or close on the archive
+ */
+ssize_t fossil_io_archive_entries(fossil_io_archive_t *archive, const fossil_io_archive_entry_t **entries);
+
 /**
  * Free memory allocated for entries.
  *
@@ -261,10 +279,31 @@ bool fossil_io_archive_extract_file(fossil_io_archive_t *archive, const char *en
  *
  * @note The destination directory will be created if it doesn't exist
  * @note Existing files in dest_dir may be overwritten
+ * @note Entries with absolute paths or ".." components are rejected
  * @note The operation stops on the first error encountered
  */
 bool fossil_io_archive_extract_all(fossil_io_archive_t *archive, const char *dest_dir);
 
+/**
+ * Extract all files in the archive using a pool of worker threads.
+ *
+ * The directory tree is created first, with each directory made exactly
+ * once. Regular files are then written by up to `threads` workers, each
+ * reading the archive through its own handle and a single bounded copy
+ * buffer, so memory use does not grow with the archive size. Output files
+ * are preallocated where the file system supports it.
+ *
+ * @param archive Pointer to an opened archive handle (read mode)
+ * @param dest_dir The destination directory for extraction
+ * @param threads Number of workers, or 0 to use one per online CPU
+ * @return True if every entry was extracted successfully, false on any error
+ *
+ * @note Entries with absolute paths or ".." components are rejected before anything is written
+ * @note Workers stop claiming new entries after the first failure
+ * @note fossil_io_archive_extract_all() is this function with a single worker
+ */
+bool fossil_io_archive_extract_all_parallel(fossil_io_archive_t *archive, const char *dest_dir, size_t threads);
+
 // ======================================================
 // Creation / Modification
 // ======================================================
@@ -340,6 +379,7 @@ bool fossil_io_archive_add_directory(fossil_io_archive_t *archive, const char *s
  *
  * @note The archive must be opened in write or append mode
  * @note Some archive formats may require complete reconstruction
+ * @note TAR archives are compacted in place by sliding later entries down
  * @note Removing non-existent entries returns false
  */
 bool fossil_io_archive_remove(fossil_io_archive_t *archive, const char *entry_name);
@@ -609,22 +649,18 @@ namespace fossil::io
          *
          * @return Vector of archive entry structures, empty on error
          *
-         * @note Memory management is handled automatically by the vector
+         * @note Entry names point into the archive and stay valid until it is modified or closed
          * @note Entry paths use forward slashes regardless of platform
-         * @note Large archives may require significant memory for the entry list
-         * @see fossil_io_archive_entry_t, fossil_io_archive_list()
+         * @see fossil_io_archive_entry_t, fossil_io_archive_entries()
          */
         std::vector<fossil_io_archive_entry_t> list() const
         {
-            fossil_io_archive_entry_t *entries;
-            ssize_t count = fossil_io_archive_list(handle, &entries);
+            const fossil_io_archive_entry_t *entries = nullptr;
+            ssize_t count = fossil_io_archive_entries(handle, &entries);
 
             std::vector<fossil_io_archive_entry_t> result;
             if (count > 0)
-            {
                 result.assign(entries, entries + count);
-                fossil_io_archive_free_entries(entries, count);
-            }
             return result;
         }
 
@@ -670,6 +706,23 @@ namespace fossil::io
             return fossil_io_archive_extract_all(handle, dest_dir.c_str());
         }
 
+        /**
+         * @brief Extracts all files from the archive using a pool of worker threads.
+         *
+         * Creates the directory tree once up front, then writes regular files on
+         * up to `threads` workers with bounded per-worker memory.
+         *
+         * @param dest_dir The destination directory for extracting all archive contents
+         * @param threads Number of workers, or 0 to use one per online CPU
+         * @return True if all files were extracted successfully, false on any error
+         *
+         * @see fossil_io_archive_extract_all_parallel()
+         */
+        bool extract_all_parallel(const std::string &dest_dir, size_t threads = 0) const
+        {
+            return fossil_io_archive_extract_all_parallel(handle, dest_dir.c_str(), threads);
+        }
+
         /**
          * @brief Adds a file from the file system to the archive.
          *
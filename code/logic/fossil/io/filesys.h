@@ -139,6 +139,39 @@ typedef struct
     * File Object
     * ------------------------------------------------------------ */
 
+/**
+ * @brief Concurrency/buffering mode of a file object's write path.
+ *
+ *  - FOSSIL_FILESYS_STREAM_LOCKED: Default. Every call takes the object lock
+ *    and keeps `position` current.
+ *  - FOSSIL_FILESYS_STREAM_OWNED: The stream is owned by a single thread (or
+ *    is a thread-local object). Calls skip the lock and position tracking and
+ *    writes are batched in a user-space buffer until it fills, or until the
+ *    stream is flushed, seeked, read, or closed.
+ */
+typedef enum
+{
+    FOSSIL_FILESYS_STREAM_LOCKED,
+    FOSSIL_FILESYS_STREAM_OWNED
+} fossil_io_filesys_stream_mode_t;
+
+/**
+ * @brief How far fossil_io_filesys_file_flush() pushes buffered data.
+ *
+ *  - FOSSIL_FILESYS_FLUSH_BUFFER: Hand user-space buffers to the OS only.
+ *  - FOSSIL_FILESYS_FLUSH_DATA: Also persist file data (fdatasync).
+ *  - FOSSIL_FILESYS_FLUSH_FULL: Also persist metadata (fsync). Default for
+ *    files opened with fossil_io_filesys_file_open().
+ *
+ * FOSSIL_STDOUT and FOSSIL_STDERR default to FOSSIL_FILESYS_FLUSH_BUFFER.
+ */
+typedef enum
+{
+    FOSSIL_FILESYS_FLUSH_BUFFER,
+    FOSSIL_FILESYS_FLUSH_DATA,
+    FOSSIL_FILESYS_FLUSH_FULL
+} fossil_io_filesys_flush_level_t;
+
 typedef struct
 {
     fossil_io_filesys_obj_t base;
@@ -150,10 +183,14 @@ typedef struct
     bool append_mode;
     bool temporary;
 
-    size_t position;
+    uint64_t position;
 
     void *buffer;
     size_t buffer_size;
+    size_t buffer_used;
+
+    fossil_io_filesys_stream_mode_t stream_mode;
+    fossil_io_filesys_flush_level_t flush_level;
 
 } fossil_io_filesys_file_t;
 
@@ -233,12 +270,55 @@ int32_t fossil_io_filesys_exists(const char *path);
 /**
  * Remove a filesystem object (file, dir, link).
  *
+ * A recursive removal runs on fossil_io_filesys_remove_tree()'s worker pool.
+ *
  * @param path Path to remove
  * @param recursive Recursively remove contents if directory
  * @return 0 on success, negative on failure
  */
 int32_t fossil_io_filesys_remove(const char *path, bool recursive);
 
+/**
+ * Options for fossil_io_filesys_remove_tree().
+ *
+ *  - size_t threads: Worker count, 0 for one per CPU.
+ *  - bool background: Rename the tree to a hidden sibling and delete it on a
+ *    detached thread, returning as soon as the original name is free.
+ */
+typedef struct
+{
+    size_t threads;
+    bool background;
+} fossil_io_filesys_remove_opts_t;
+
+/**
+ * Remove a file, link or whole directory tree using a pool of workers.
+ *
+ * Directories are read through directory handles and every entry is removed by
+ * name relative to its parent, trusting the dirent type so plain entries are
+ * never stat()ed. Subtrees are spread across the workers and each directory is
+ * removed as soon as it empties. Symbolic links are removed, never followed.
+ * fossil_io_filesys_remove() with recursive set uses the same engine.
+ *
+ * In background mode the rename is atomic, so the path is gone when this
+ * returns; if it cannot be renamed (for instance a mount point) the tree is
+ * removed in place instead. Detached removals are lost if the process exits
+ * first, leaving the hidden ".<name>.rm-<pid>-<n>" sibling behind; call
+ * fossil_io_filesys_remove_wait() before exiting.
+ *
+ * @param path Path to remove
+ * @param opts Removal options, or NULL for defaults
+ * @return 0 on success, negative if anything could not be removed
+ */
+int32_t fossil_io_filesys_remove_tree(const char *path, const fossil_io_filesys_remove_opts_t *opts);
+
+/**
+ * Wait for every background removal started by fossil_io_filesys_remove_tree().
+ *
+ * @return 0 if all of them succeeded since the last wait, negative otherwise
+ */
+int32_t fossil_io_filesys_remove_wait(void);
+
 /**
  * Rename or move a filesystem object.
  *
@@ -262,6 +342,55 @@ int32_t fossil_io_filesys_move(const char *src, const char *dest);
  */
 int32_t fossil_io_filesys_copy(const char *src, const char *dest, bool preserve_meta);
 
+/**
+ * Data path used by the copy engine for a file copy.
+ */
+typedef enum
+{
+    FOSSIL_FILESYS_COPY_NONE = 0,  /* nothing copied yet */
+    FOSSIL_FILESYS_COPY_REFLINK,   /* FICLONE: blocks shared, no data moved */
+    FOSSIL_FILESYS_COPY_RANGE,     /* copy_file_range: in-kernel copy */
+    FOSSIL_FILESYS_COPY_SENDFILE,  /* sendfile: in-kernel copy */
+    FOSSIL_FILESYS_COPY_BUFFERED   /* userspace read/write loop */
+} fossil_io_filesys_copy_strategy_t;
+
+/**
+ * Outcome of a single file copy.
+ *
+ * Members:
+ *  - strategy: Data path that finished the copy.
+ *  - bytes_copied: Number of bytes transferred (or cloned) into dest.
+ */
+typedef struct
+{
+    fossil_io_filesys_copy_strategy_t strategy;
+    uint64_t bytes_copied;
+} fossil_io_filesys_copy_stats_t;
+
+/**
+ * Copy a file through the fastest available data path and report it.
+ *
+ * Tries a reflink clone first, then copy_file_range, then sendfile, and
+ * finally a large-buffer read/write loop. Each step falls through to the
+ * next when the kernel or filesystem does not support it (cross-device,
+ * unsupported fs, old kernel). Non-Linux platforms use the buffered loop.
+ *
+ * @param src Source path
+ * @param dest Destination path (created or truncated)
+ * @param preserve_meta Preserve permissions, timestamps
+ * @param stats Optional pointer receiving the strategy used and byte count
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_copy_ex(const char *src, const char *dest, bool preserve_meta, fossil_io_filesys_copy_stats_t *stats);
+
+/**
+ * Convert a copy strategy to a human-readable string ("reflink", "range", ...).
+ *
+ * @param strategy Strategy to convert
+ * @return Static string naming the strategy
+ */
+const char *fossil_io_filesys_copy_strategy_string(fossil_io_filesys_copy_strategy_t strategy);
+
 /**
  * Atomic swap of two filesystem objects.
  *
@@ -277,9 +406,66 @@ int32_t fossil_io_filesys_swap(const char *path1, const char *path2);
  * @param path Directory path
  * @param recursive Scan subdirectories
  * @return Number of duplicates removed, negative on failure
+ *
+ * Equivalent to fossil_io_filesys_deduplicate_ex() with default options.
  */
 int32_t fossil_io_filesys_deduplicate(const char *path, bool recursive);
 
+/**
+ * What to do with a file found to duplicate an earlier one.
+ *
+ *  - FOSSIL_FILESYS_DEDUP_DELETE: remove the duplicate.
+ *  - FOSSIL_FILESYS_DEDUP_HARDLINK: replace it with a hard link to the kept copy.
+ *  - FOSSIL_FILESYS_DEDUP_REFLINK: replace it with a copy-on-write clone of the
+ *    kept copy (Linux FICLONE; duplicates are left alone where unsupported).
+ */
+typedef enum
+{
+    FOSSIL_FILESYS_DEDUP_DELETE,
+    FOSSIL_FILESYS_DEDUP_HARDLINK,
+    FOSSIL_FILESYS_DEDUP_REFLINK
+} fossil_io_filesys_dedup_action_t;
+
+/**
+ * Options for fossil_io_filesys_deduplicate_ex().
+ *
+ * Members:
+ *  - action: How duplicates are resolved.
+ *  - threads: Hashing workers (0 = one per online CPU).
+ */
+typedef struct
+{
+    fossil_io_filesys_dedup_action_t action;
+    size_t threads;
+} fossil_io_filesys_dedup_opts_t;
+
+/**
+ * Results reported by fossil_io_filesys_deduplicate_ex().
+ */
+typedef struct
+{
+    uint64_t files_scanned;
+    uint64_t duplicates;
+    uint64_t bytes_reclaimed;
+} fossil_io_filesys_dedup_stats_t;
+
+/**
+ * Deduplicate files with a staged pipeline.
+ *
+ * Files are grouped by size, then by a hash of their first and last 4 KiB,
+ * then by a full-content hash, and finally byte-compared against the first
+ * file of their group, which is always kept. Only files that still share a
+ * group are read at each stage, and hashing runs on a worker pool. Empty
+ * files and existing hard links to the kept copy are ignored.
+ *
+ * @param path Directory path
+ * @param recursive Scan subdirectories
+ * @param opts Options, or NULL to delete duplicates using all CPUs
+ * @param stats Optional output statistics
+ * @return Number of duplicates resolved, negative on failure
+ */
+int32_t fossil_io_filesys_deduplicate_ex(const char *path, bool recursive, const fossil_io_filesys_dedup_opts_t *opts, fossil_io_filesys_dedup_stats_t *stats);
+
 /**
  * Get filesystem object info (type, size, permissions, timestamps).
  *
@@ -371,17 +557,147 @@ int32_t fossil_io_filesys_file_seek(fossil_io_filesys_file_t *f, int64_t offset,
  */
 int64_t fossil_io_filesys_file_tell(fossil_io_filesys_file_t *f);
 
+/**
+ * @brief One buffer segment for vectored I/O.
+ *
+ * Layout-compatible with POSIX struct iovec, so arrays are passed to the
+ * kernel as-is.
+ */
+typedef struct
+{
+    void *base;
+    size_t len;
+} fossil_io_filesys_iovec_t;
+
+/**
+ * @brief Read from an absolute offset without using the stream position.
+ *
+ * Works directly on the file descriptor and takes no object lock, so any
+ * number of threads may read ranges of the same file concurrently. The
+ * buffered stream position is left untouched. Short kernel reads are
+ * retried, so fewer than len bytes are returned only at end of file. Bytes
+ * still buffered by the stream are not visible; flush first if needed.
+ *
+ * @param f Pointer to the open file object
+ * @param buf Destination buffer
+ * @param len Number of bytes to read
+ * @param offset Absolute byte offset to read from
+ * @return Number of bytes read (0 at end of file), or -1 on failure
+ *
+ * @note On Windows a synchronous handle's file pointer moves with every read,
+ *       so there the call saves and restores it under the object lock.
+ */
+int64_t fossil_io_filesys_file_pread(fossil_io_filesys_file_t *f, void *buf, size_t len, uint64_t offset);
+
+/**
+ * @brief Write to an absolute offset without using the stream position.
+ *
+ * Same concurrency rules as fossil_io_filesys_file_pread(). The data bypasses
+ * the stream buffer, so a stream read of the same range that was buffered
+ * earlier may still return the old bytes.
+ *
+ * @param f Pointer to the open file object
+ * @param buf Source buffer
+ * @param len Number of bytes to write
+ * @param offset Absolute byte offset to write at
+ * @return Number of bytes written (len on success), or -1 on failure
+ */
+int64_t fossil_io_filesys_file_pwrite(fossil_io_filesys_file_t *f, const void *buf, size_t len, uint64_t offset);
+
+/**
+ * @brief Scatter-read consecutive bytes at an absolute offset into several buffers.
+ *
+ * Uses preadv() where available, so a whole batch costs one system call.
+ * Same concurrency rules as fossil_io_filesys_file_pread().
+ *
+ * @param f Pointer to the open file object
+ * @param iov Array of destination segments, filled in order
+ * @param count Number of segments
+ * @param offset Absolute byte offset of the first byte
+ * @return Total bytes read (short only at end of file), or -1 on failure
+ */
+int64_t fossil_io_filesys_file_preadv(fossil_io_filesys_file_t *f, const fossil_io_filesys_iovec_t *iov, size_t count, uint64_t offset);
+
+/**
+ * @brief Gather-write several buffers as consecutive bytes at an absolute offset.
+ *
+ * Uses pwritev() where available. Same concurrency rules as
+ * fossil_io_filesys_file_pwrite().
+ *
+ * @param f Pointer to the open file object
+ * @param iov Array of source segments, written in order
+ * @param count Number of segments
+ * @param offset Absolute byte offset of the first byte
+ * @return Total bytes written, or -1 on failure
+ */
+int64_t fossil_io_filesys_file_pwritev(fossil_io_filesys_file_t *f, const fossil_io_filesys_iovec_t *iov, size_t count, uint64_t offset);
+
 /**
  * @brief Flush buffered data to the file.
  *
- * Forces any pending buffered write operations on the file to be written to the
- * underlying storage medium, ensuring data durability.
+ * Writes out pending buffered data and then synchronises it as far as the
+ * file's flush level asks (see fossil_io_filesys_file_set_flush_level()).
+ * Files opened with fossil_io_filesys_file_open() default to a full fsync;
+ * the standard streams default to buffer-only.
  *
  * @param f Pointer to the open file object
  * @return 0 on success, negative error code on failure
  */
 int32_t fossil_io_filesys_file_flush(fossil_io_filesys_file_t *f);
 
+/**
+ * @brief Set the level used by fossil_io_filesys_file_flush() for a file.
+ *
+ * @param f Pointer to the open file object
+ * @param level Flush level
+ * @return 0 on success, negative error code on failure
+ */
+int32_t fossil_io_filesys_file_set_flush_level(fossil_io_filesys_file_t *f, fossil_io_filesys_flush_level_t level);
+
+/**
+ * @brief Flush a file to an explicit durability level.
+ *
+ * Like fossil_io_filesys_file_flush() but ignores the file's own level.
+ * Descriptors that cannot be synchronised (pipes, terminals) only have their
+ * buffers flushed.
+ *
+ * @param f Pointer to the open file object
+ * @param level Durability level to reach
+ * @return 0 on success, negative error code on failure
+ */
+int32_t fossil_io_filesys_file_sync(fossil_io_filesys_file_t *f, fossil_io_filesys_flush_level_t level);
+
+/**
+ * @brief Group-commit several files to the same durability level.
+ *
+ * Flushes every file's buffers first, then issues the fdatasync/fsync calls
+ * for all distinct descriptors concurrently so the storage stack can merge
+ * them, instead of paying one synchronous round trip per file. NULL entries
+ * are skipped.
+ *
+ * @param files Array of open file objects
+ * @param count Number of entries in files
+ * @param level Durability level to reach
+ * @return 0 if every file reached the level, negative error code otherwise
+ */
+int32_t fossil_io_filesys_file_sync_group(fossil_io_filesys_file_t *const *files, size_t count, fossil_io_filesys_flush_level_t level);
+
+/**
+ * @brief Switch a file between locked and owned stream mode.
+ *
+ * Owned mode removes the per-call mutex, append seek and ftell from
+ * fossil_io_filesys_file_write() and batches small writes in a buffer of
+ * buffer_size bytes (0 selects 64 KiB), so it must only be used from one
+ * thread at a time. Switching back to locked mode drains and releases the
+ * buffer. fossil_io_filesys_file_tell() stays accurate in either mode.
+ *
+ * @param f Pointer to the open file object
+ * @param mode New stream mode
+ * @param buffer_size Write buffer size for owned mode (ignored for locked)
+ * @return 0 on success, negative error code on failure
+ */
+int32_t fossil_io_filesys_file_set_stream_mode(fossil_io_filesys_file_t *f, fossil_io_filesys_stream_mode_t mode, size_t buffer_size);
+
 /**
  * @brief Get the size of a file.
  *
@@ -390,9 +706,19 @@ int32_t fossil_io_filesys_file_flush(fossil_io_filesys_file_t *f);
  *
  * @param path Path to the file
  * @return File size in bytes, or negative error code on failure
+ *
+ * @note Files of 2 GiB or more fail with -1; use fossil_io_filesys_file_size64()
  */
 int32_t fossil_io_filesys_file_size(const char *path);
 
+/**
+ * @brief Get the size of a file as a 64-bit value.
+ *
+ * @param path Path to the file
+ * @return File size in bytes, or -1 on failure
+ */
+int64_t fossil_io_filesys_file_size64(const char *path);
+
 /**
  * @brief Truncate or extend a file to a specific size.
  *
@@ -406,11 +732,13 @@ int32_t fossil_io_filesys_file_size(const char *path);
 int32_t fossil_io_filesys_file_truncate(const char *path, size_t size);
 
 /**
- * @brief Compute the cryptographic hash of a file.
+ * @brief Compute the hash of a file.
  *
  * Reads the entire contents of a file at the given path and computes its hash
  * using the specified algorithm. The resulting hash is stored in the provided
- * output buffer. Supported algorithms include "sha256", "md5", "sha1", etc.
+ * output buffer. Supported algorithms are "fnv1a" (8 bytes, native order),
+ * "xxh64" (8 bytes), "crc32c" (4 bytes) and "sha256" (32 bytes); use
+ * fossil_io_filesys_hash_digest_size() to size the buffer.
  *
  * @param path Path to the file to hash
  * @param hash_out Pointer to buffer where computed hash will be stored
@@ -420,6 +748,58 @@ int32_t fossil_io_filesys_file_truncate(const char *path, size_t size);
  */
 int32_t fossil_io_filesys_file_hash(const char *path, unsigned char *hash_out, size_t hash_size, const char *algorithm);
 
+/**
+ * @brief Options for fossil_io_filesys_file_hash_ex().
+ *
+ * In tree mode the file is cut into leaf_size pieces that are hashed in
+ * parallel; the result is the hash of the concatenated leaf digests followed
+ * by the file size as 8 little-endian bytes. A tree digest therefore differs
+ * from the flat digest of the same file, but is stable for a given leaf_size
+ * regardless of the thread count.
+ */
+typedef struct
+{
+    bool tree;          /**< Hash leaves in parallel and combine their digests */
+    size_t threads;     /**< Worker threads for tree mode (0 = one per CPU) */
+    uint64_t leaf_size; /**< Leaf size in bytes for tree mode (0 = 64 MiB) */
+} fossil_io_filesys_hash_opts_t;
+
+/**
+ * @brief Get the digest size of a hash algorithm.
+ *
+ * @param algorithm Algorithm name ("fnv1a", "xxh64", "crc32c", "sha256")
+ * @return Digest size in bytes, or 0 if the algorithm is unknown
+ */
+size_t fossil_io_filesys_hash_digest_size(const char *algorithm);
+
+/**
+ * @brief Hash an in-memory buffer with one of the file_hash algorithms.
+ *
+ * @param algorithm Algorithm name
+ * @param data Bytes to hash (may be NULL when len is 0)
+ * @param len Number of bytes
+ * @param hash_out Buffer receiving the digest
+ * @param hash_size Size of hash_out; must be at least the digest size
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_hash_buffer(const char *algorithm, const void *data, size_t len, unsigned char *hash_out, size_t hash_size);
+
+/**
+ * @brief Hash a file with options.
+ *
+ * Like fossil_io_filesys_file_hash(), reading through memory-mapped windows
+ * where possible. With opts->tree set, large files are hashed on several
+ * threads (see fossil_io_filesys_hash_opts_t).
+ *
+ * @param path Path to the file to hash
+ * @param algorithm Algorithm name
+ * @param hash_out Buffer receiving the digest
+ * @param hash_size Size of hash_out; must be at least the digest size
+ * @param opts Options, or NULL for a flat single-threaded hash
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_file_hash_ex(const char *path, const char *algorithm, unsigned char *hash_out, size_t hash_size, const fossil_io_filesys_hash_opts_t *opts);
+
 /**
  * @brief Merge two files into a single destination file.
  *
@@ -443,15 +823,33 @@ int32_t fossil_io_filesys_file_merge(const char *src1, const char *src2, const c
  * @param path Path to the file to split
  * @param part_size Size of each part in bytes
  * @param prefix Prefix for generated part file names
- * @return 0 on success, negative error code on failure
+ * @return Number of parts written, negative error code on failure
  */
 int32_t fossil_io_filesys_file_split(const char *path, size_t part_size, const char *prefix);
 
+/**
+ * @brief Split a file of any size into parts of a 64-bit part size.
+ *
+ * Parts are named "<prefix>.partNNN" and written in parallel, one worker per
+ * part, each copying its offset range in-kernel (copy_file_range) where
+ * possible and through a fixed 1 MiB buffer otherwise, so part_size may
+ * exceed memory. Holes in a sparse source are skipped where the platform
+ * reports them, leaving the corresponding ranges of each part sparse as well.
+ *
+ * @param path Path to the file to split
+ * @param part_size Size of each part in bytes (the last part may be shorter)
+ * @param prefix Prefix for generated part file names
+ * @return Number of parts written, or -1 on failure
+ */
+int64_t fossil_io_filesys_file_split64(const char *path, uint64_t part_size, const char *prefix);
+
 /**
  * @brief Join multiple file parts into a single file.
  *
  * Combines multiple file parts (typically created by file_split) into a single
- * destination file in the order specified by the parts array.
+ * destination file in the order specified by the parts array. Parts are
+ * written in parallel at 64-bit offsets with positional I/O, so any total
+ * size works and holes in sparse parts are preserved.
  *
  * @param parts Array of pointers to part file paths
  * @param count Number of parts in the array
@@ -460,15 +858,65 @@ int32_t fossil_io_filesys_file_split(const char *path, size_t part_size, const c
  */
 int32_t fossil_io_filesys_file_join(const char **parts, size_t count, const char *dest);
 
+/**
+ * @brief Options for fossil_io_filesys_file_split_ex() and
+ *        fossil_io_filesys_file_join_manifest().
+ */
+typedef struct
+{
+    size_t threads;        /**< Parts copied at once (0 = one per CPU) */
+    const char *algorithm; /**< Part hash for split: "xxh64" (NULL), "crc32c", "sha256", ... */
+} fossil_io_filesys_split_opts_t;
+
+/**
+ * @brief Split a file in parallel and record a checksummed manifest.
+ *
+ * Works like fossil_io_filesys_file_split64(), hashing each part as it is
+ * copied, then writes "<prefix>.manifest": a header, the algorithm, total
+ * size, part size and count, then one "<size> <hex digest> <name>" line per
+ * part. Part names are stored without their directory so the set can be
+ * moved as a whole.
+ *
+ * @param path Path to the file to split
+ * @param part_size Size of each part in bytes (the last part may be shorter)
+ * @param prefix Prefix for part and manifest file names
+ * @param opts Options, or NULL for defaults
+ * @return Number of parts written, or -1 on failure
+ */
+int64_t fossil_io_filesys_file_split_ex(const char *path, uint64_t part_size, const char *prefix, const fossil_io_filesys_split_opts_t *opts);
+
+/**
+ * @brief Rebuild a file from a split manifest, verifying every part.
+ *
+ * Parts are looked up beside the manifest. All part sizes are checked before
+ * anything is written; the output is then preallocated to its final size and
+ * the parts are copied in parallel, each hashed on the way through. Any
+ * missing, resized or corrupted part fails the join and removes dest.
+ *
+ * @param manifest Path to a manifest written by fossil_io_filesys_file_split_ex()
+ * @param dest Path to the destination file
+ * @param opts Options (only threads is used), or NULL for defaults
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_file_join_manifest(const char *manifest, const char *dest, const fossil_io_filesys_split_opts_t *opts);
+
 /**
  * @brief Compress a file using the specified algorithm.
  *
- * Compresses the source file using the provided compression algorithm (e.g., "gzip", "bzip2")
- * and writes the compressed data to the destination file.
+ * Compresses the source file using the named codec and writes the result to
+ * the destination file. "lz4" is always available; "deflate" and "zstd" are
+ * available when the library was built against zlib / libzstd (see
+ * fossil_io_filesys_codec_available()). These codecs write a framed file of
+ * independently compressed 1 MiB blocks with a CRC-32C per block and a block
+ * index, compressed in parallel and readable at random with
+ * fossil_io_filesys_file_decompress_range().
+ *
+ * "rle" (also used when algorithm is NULL) writes the original unframed
+ * (count, value) byte stream.
  *
  * @param src Path to the source file to compress
  * @param dest Path to the destination compressed file
- * @param algorithm Compression algorithm to use (e.g., "gzip", "bzip2")
+ * @param algorithm Compression algorithm to use ("lz4", "deflate", "zstd", "rle")
  * @return 0 on success, negative error code on failure
  */
 int32_t fossil_io_filesys_file_compress(const char *src, const char *dest, const char *algorithm);
@@ -477,7 +925,9 @@ int32_t fossil_io_filesys_file_compress(const char *src, const char *dest, const
  * @brief Decompress a file to its original form.
  *
  * Decompresses a previously compressed file and writes the decompressed data to the
- * destination file. The decompression algorithm is typically detected automatically.
+ * destination file. Framed files are recognised by their header and trailer and
+ * decoded in parallel, with every block checked against its CRC-32C; anything else
+ * is treated as an "rle" stream.
  *
  * @param src Path to the compressed source file
  * @param dest Path to the destination decompressed file
@@ -485,12 +935,37 @@ int32_t fossil_io_filesys_file_compress(const char *src, const char *dest, const
  */
 int32_t fossil_io_filesys_file_decompress(const char *src, const char *dest);
 
+/**
+ * @brief Read a range of a framed compressed file without decompressing the rest.
+ *
+ * Only the blocks covering [offset, offset + len) are read and decoded, so the
+ * cost is independent of where in the file the range lies. Not available for
+ * "rle" output, which has no block index.
+ *
+ * @param src Path to a file written by fossil_io_filesys_file_compress()
+ * @param offset Offset into the uncompressed data
+ * @param buf Buffer receiving the data
+ * @param len Number of bytes wanted
+ * @return Bytes copied (short at the end of the data, 0 past it), or -1 on error
+ */
+int64_t fossil_io_filesys_file_decompress_range(const char *src, uint64_t offset, void *buf, size_t len);
+
+/**
+ * @brief Check whether a compression algorithm is available in this build.
+ *
+ * @param algorithm Algorithm name
+ * @return 1 if fossil_io_filesys_file_compress() accepts it, 0 otherwise
+ */
+int32_t fossil_io_filesys_codec_available(const char *algorithm);
+
 /**
  * @brief Rewrite file contents by applying a transformation function.
  *
  * Opens a file, reads its contents, applies a transformation function to the data,
  * and writes the transformed contents back to the file. Operates atomically using
- * a temporary file to preserve the original if an error occurs.
+ * a temporary file to preserve the original if an error occurs. The whole file
+ * is held in memory; use fossil_io_filesys_file_rewrite_stream() for large files
+ * or output that changes size.
  *
  * @param path Path to the file to rewrite
  * @param transform Callback function that processes data (returns 0 on success, negative on failure)
@@ -499,6 +974,62 @@ int32_t fossil_io_filesys_file_decompress(const char *src, const char *dest);
  */
 int32_t fossil_io_filesys_file_rewrite(const char *path, int (*transform)(void *buf, size_t *size, void *user_data), void *user_data);
 
+/** Output side of a streaming rewrite; see fossil_io_filesys_file_rewrite_stream(). */
+typedef struct fossil_io_filesys_sink fossil_io_filesys_sink_t;
+
+/**
+ * @brief Append transformed bytes to a rewrite's output.
+ *
+ * Output is buffered and written at increasing offsets of the staged file,
+ * so a transform may emit more or less than it was given, in any number of
+ * calls.
+ *
+ * @param sink Sink passed to the transform
+ * @param data Bytes to append
+ * @param len Number of bytes
+ * @return 0 on success, negative on write failure
+ */
+int32_t fossil_io_filesys_sink_write(fossil_io_filesys_sink_t *sink, const void *data, size_t len);
+
+/**
+ * @brief Rewrite a file through a chunked transform with bounded memory.
+ *
+ * The file is read in chunks of at most chunk_size bytes and each is passed
+ * to transform, which writes its output through the sink. A last call with
+ * chunk NULL, len 0 and final set lets the transform flush state it carried
+ * across chunks. Memory use is two chunk buffers regardless of file size.
+ *
+ * Output goes to an unnamed O_TMPFILE in the same directory where supported
+ * (otherwise a unique sibling temp file), is fsynced, and then atomically
+ * renamed over the original, whose permission bits it keeps. If the
+ * transform or any I/O fails, the original is left untouched.
+ *
+ * @param path Path to the file to rewrite
+ * @param chunk_size Input chunk and output buffer size (0 = 1 MiB)
+ * @param transform Called per chunk; returns 0 to continue, non-zero to abort
+ * @param user_data Pointer passed through to the transform
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_file_rewrite_stream(const char *path, size_t chunk_size, int (*transform)(const void *chunk, size_t len, bool final, fossil_io_filesys_sink_t *out, void *user_data), void *user_data);
+
+/**
+ * @brief Transform a file in place when the output is the same size as the input.
+ *
+ * The file is mapped read-write one window at a time, and transform edits
+ * each window directly; offset is the window's position in the file. No copy
+ * is made, so this is the fast path for byte-for-byte transforms. It is not
+ * atomic: a failure or crash part way leaves earlier windows transformed.
+ * Where the file cannot be mapped, windows are read, transformed and written
+ * back instead. Data is synced before returning.
+ *
+ * @param path Path to the file to transform
+ * @param window Bytes mapped at a time, rounded up to the mapping granularity (0 = 64 MiB)
+ * @param transform Called per window; returns 0 to continue, non-zero to stop
+ * @param user_data Pointer passed through to the transform
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_file_rewrite_inplace(const char *path, size_t window, int (*transform)(void *data, size_t len, uint64_t offset, void *user_data), void *user_data);
+
 /**
  * @brief Detect the format of a file based on its magic bytes or extension.
  *
@@ -556,52 +1087,610 @@ int32_t fossil_io_filesys_file_set_perms(const char *path, fossil_io_filesys_per
 int32_t fossil_io_filesys_file_set_owner(const char *path, const char *owner, const char *group);
 
 /* ------------------------------------------------------------
-    * Directory-Specific Operations
+    * Memory-Mapped Views
     * ------------------------------------------------------------ */
 
 /**
- * @brief Create a directory at the specified path.
+ * Access pattern hints for a mapped view.
+ */
+typedef enum
+{
+    FOSSIL_FILESYS_ADVICE_NORMAL = 0,
+    FOSSIL_FILESYS_ADVICE_SEQUENTIAL,
+    FOSSIL_FILESYS_ADVICE_RANDOM,
+    FOSSIL_FILESYS_ADVICE_WILLNEED,
+    FOSSIL_FILESYS_ADVICE_DONTNEED
+} fossil_io_filesys_advice_t;
+
+/**
+ * @brief Read-only mapping of a byte range of an open file.
  *
- * Creates a new directory at the given path. If recursive is true, it will create any
- * necessary parent directories as well.
- * @param path Path to the directory to create
- * @param recursive Whether to create parent directories if they do not exist
- * @return 0 on success, negative error code on failure
+ * Members:
+ *  - data: First byte of the requested range (NULL for an empty view).
+ *  - length: Number of bytes addressable through data.
+ *  - offset: File offset the view starts at.
+ *  - map_base / map_length: Page-aligned region owned by the view (internal).
  */
-int32_t fossil_io_filesys_dir_create(const char *path, bool recursive);
+typedef struct
+{
+    const unsigned char *data;
+    size_t length;
+    uint64_t offset;
+
+    void *map_base;
+    size_t map_length;
+} fossil_io_filesys_view_t;
 
 /**
- * @brief List the contents of a directory.
+ * @brief Map a byte range of an open file into memory.
  *
- * Retrieves a list of entries in the specified directory, including their metadata.
+ * Creates a read-only, shared mapping so file contents can be scanned without
+ * copying them through the stream buffer. The offset does not need to be page
+ * aligned. Pending buffered writes on the stream are flushed first so the view
+ * observes them. Mapping an empty range yields an empty view, not an error.
  *
- * @param path Path to the directory to list
- * @param entries Array to store directory entries (caller-allocated)
- * @param max_entries Maximum number of entries to store in the array
- * @param out_count Pointer to store the actual number of entries found
- * @return 0 on success, negative error code on failure
+ * @param f Pointer to the open file object
+ * @param offset Byte offset of the first mapped byte
+ * @param length Number of bytes to map, or 0 to map through end of file
+ * @param view Pointer to the view to initialize
+ * @return 0 on success, negative error code on failure (offset past EOF, etc.)
  */
-int32_t fossil_io_filesys_dir_list(const char *path, fossil_io_filesys_obj_t *entries, size_t max_entries, size_t *out_count);
+int32_t fossil_io_filesys_file_map(fossil_io_filesys_file_t *f, uint64_t offset, size_t length, fossil_io_filesys_view_t *view);
 
 /**
- * @brief Walk a directory tree and apply a callback to each entry.
+ * @brief Release a mapped view.
  *
- * Recursively traverses a directory and its subdirectories, invoking the provided
- * callback function for each filesystem object encountered.
+ * Unmaps the region owned by the view and resets it to an empty state. Calling
+ * this on an empty or already released view is a no-op.
  *
- * @param path Path to the directory to walk
- * @param callback Function to call for each entry (returns 0 to continue, non-zero to stop)
- * @param user_data Pointer to user data to pass to the callback
+ * @param view Pointer to the view to release
  * @return 0 on success, negative error code on failure
  */
-int32_t fossil_io_filesys_dir_walk(const char *path, int (*callback)(const fossil_io_filesys_obj_t *, void *), void *user_data);
+int32_t fossil_io_filesys_file_unmap(fossil_io_filesys_view_t *view);
 
 /**
- * @brief Merge the contents of one directory into another.
+ * @brief Tell the kernel how a mapped view is going to be accessed.
  *
- * Merges the contents of the source directory into the destination directory. If
+ * Sequential advice enables aggressive read-ahead for linear scans, random
+ * advice disables it for point lookups. Platforms without an equivalent treat
+ * the hint as a no-op.
+ *
+ * @param view Pointer to the mapped view
+ * @param advice Expected access pattern
+ * @return 0 on success, negative error code on failure
+ */
+int32_t fossil_io_filesys_view_advise(fossil_io_filesys_view_t *view, fossil_io_filesys_advice_t advice);
+
+/* ------------------------------------------------------------
+    * Asynchronous I/O
+    * ------------------------------------------------------------ */
+
+/** Pass as dirfd to resolve paths against the current working directory. */
+#define FOSSIL_FILESYS_AIO_CWD (-100)
+
+/**
+ * Operation carried by an asynchronous request.
+ */
+typedef enum
+{
+    FOSSIL_FILESYS_AIO_READ,
+    FOSSIL_FILESYS_AIO_WRITE,
+    FOSSIL_FILESYS_AIO_FSYNC,
+    FOSSIL_FILESYS_AIO_OPENAT,
+    FOSSIL_FILESYS_AIO_STATX,
+    FOSSIL_FILESYS_AIO_CLOSE
+} fossil_io_filesys_aio_op_t;
+
+/**
+ * Mechanism an engine uses to run requests.
+ *
+ *  - FOSSIL_FILESYS_AIO_BACKEND_URING: Linux io_uring; requests run in the kernel.
+ *  - FOSSIL_FILESYS_AIO_BACKEND_THREADS: A pool of worker threads issuing
+ *    blocking calls, used when io_uring is unavailable or not permitted.
+ *  - FOSSIL_FILESYS_AIO_BACKEND_SYNC: Requests run on submit (Windows).
+ */
+typedef enum
+{
+    FOSSIL_FILESYS_AIO_BACKEND_URING,
+    FOSSIL_FILESYS_AIO_BACKEND_THREADS,
+    FOSSIL_FILESYS_AIO_BACKEND_SYNC
+} fossil_io_filesys_aio_backend_t;
+
+/**
+ * @brief Options for fossil_io_filesys_aio_create().
+ *
+ * Members:
+ *  - uint32_t queue_depth: Most requests queued or in flight at once
+ *    (0 = 256, capped at 4096).
+ *  - size_t threads: Worker count for the thread-pool backend (0 = one per
+ *    online CPU).
+ *  - bool force_threads: Use the thread pool even where io_uring works.
+ */
+typedef struct
+{
+    uint32_t queue_depth;
+    size_t threads;
+    bool force_threads;
+} fossil_io_filesys_aio_opts_t;
+
+/**
+ * @brief Metadata filled in by a completed FOSSIL_FILESYS_AIO_STATX request.
+ */
+typedef struct
+{
+    uint64_t size;
+    uint32_t mode;
+    time_t mtime;
+} fossil_io_filesys_aio_stat_t;
+
+/**
+ * @brief One finished request.
+ *
+ * Members:
+ *  - uint64_t user_data: Value given when the request was queued.
+ *  - fossil_io_filesys_aio_op_t op: Operation that finished.
+ *  - int64_t result: Bytes transferred (read/write), new descriptor (openat),
+ *    0 (fsync/statx/close), or a negated errno value on failure.
+ */
+typedef struct
+{
+    uint64_t user_data;
+    fossil_io_filesys_aio_op_t op;
+    int64_t result;
+} fossil_io_filesys_aio_completion_t;
+
+/** Opaque asynchronous I/O engine. */
+typedef struct fossil_io_filesys_aio fossil_io_filesys_aio_t;
+
+/**
+ * @brief Create an asynchronous I/O engine.
+ *
+ * On Linux an io_uring is set up and probed for every supported operation;
+ * if the kernel is too old, the syscall is blocked (containers, seccomp) or
+ * opts->force_threads is set, a worker pool is started instead. An engine is
+ * driven from one thread at a time: queue requests, submit them, then poll or
+ * wait for completions. Use one engine per thread for more parallel issuers.
+ *
+ * @param opts Engine options, or NULL for defaults
+ * @return New engine, or NULL on failure
+ */
+fossil_io_filesys_aio_t *fossil_io_filesys_aio_create(const fossil_io_filesys_aio_opts_t *opts);
+
+/**
+ * @brief Destroy an engine after waiting for all submitted requests.
+ *
+ * Requests queued but never submitted are dropped without completing.
+ *
+ * @param aio Engine to destroy (NULL is ignored)
+ */
+void fossil_io_filesys_aio_destroy(fossil_io_filesys_aio_t *aio);
+
+/**
+ * @brief Report which backend an engine runs on.
+ *
+ * @param aio Engine
+ * @return Backend in use
+ */
+fossil_io_filesys_aio_backend_t fossil_io_filesys_aio_backend(const fossil_io_filesys_aio_t *aio);
+
+/**
+ * @brief Queue a positional read of up to len bytes into buf.
+ *
+ * Like every queueing call, nothing starts until fossil_io_filesys_aio_submit(),
+ * and buf must stay valid until the request completes.
+ *
+ * @param aio Engine
+ * @param fd Open file descriptor
+ * @param buf Destination buffer
+ * @param len Number of bytes to read
+ * @param offset Absolute file offset
+ * @param user_data Value reported back in the completion
+ * @return 0 on success, -1 if the queue is full or arguments are invalid
+ */
+int32_t fossil_io_filesys_aio_read(fossil_io_filesys_aio_t *aio, int fd, void *buf, size_t len, uint64_t offset, uint64_t user_data);
+
+/**
+ * @brief Queue a positional write of len bytes from buf.
+ *
+ * @param aio Engine
+ * @param fd Open file descriptor
+ * @param buf Source buffer (must stay valid until completion)
+ * @param len Number of bytes to write
+ * @param offset Absolute file offset
+ * @param user_data Value reported back in the completion
+ * @return 0 on success, -1 if the queue is full or arguments are invalid
+ */
+int32_t fossil_io_filesys_aio_write(fossil_io_filesys_aio_t *aio, int fd, const void *buf, size_t len, uint64_t offset, uint64_t user_data);
+
+/**
+ * @brief Queue an fsync (or fdatasync when datasync is set) of a descriptor.
+ *
+ * @param aio Engine
+ * @param fd Open file descriptor
+ * @param datasync Persist data only, skipping metadata not needed to read it back
+ * @param user_data Value reported back in the completion
+ * @return 0 on success, -1 if the queue is full or arguments are invalid
+ */
+int32_t fossil_io_filesys_aio_fsync(fossil_io_filesys_aio_t *aio, int fd, bool datasync, uint64_t user_data);
+
+/**
+ * @brief Queue opening a file relative to a directory descriptor.
+ *
+ * @param aio Engine
+ * @param dirfd Directory descriptor, or FOSSIL_FILESYS_AIO_CWD
+ * @param path Path to open (must stay valid until completion)
+ * @param flags open() flags (O_RDONLY, O_CREAT, ...)
+ * @param mode Permission bits for newly created files
+ * @param user_data Value reported back in the completion
+ * @return 0 on success, -1 if the queue is full or arguments are invalid
+ */
+int32_t fossil_io_filesys_aio_openat(fossil_io_filesys_aio_t *aio, int dirfd, const char *path, int flags, uint32_t mode, uint64_t user_data);
+
+/**
+ * @brief Queue a metadata lookup; io_uring requests only size, mode and mtime.
+ *
+ * @param aio Engine
+ * @param dirfd Directory descriptor, or FOSSIL_FILESYS_AIO_CWD
+ * @param path Path to inspect (must stay valid until completion)
+ * @param follow_links Report the link target instead of a symbolic link itself
+ * @param out Filled on success (must stay valid until completion)
+ * @param user_data Value reported back in the completion
+ * @return 0 on success, -1 if the queue is full or arguments are invalid
+ */
+int32_t fossil_io_filesys_aio_statx(fossil_io_filesys_aio_t *aio, int dirfd, const char *path, bool follow_links, fossil_io_filesys_aio_stat_t *out, uint64_t user_data);
+
+/**
+ * @brief Queue closing a descriptor.
+ *
+ * @param aio Engine
+ * @param fd Descriptor to close
+ * @param user_data Value reported back in the completion
+ * @return 0 on success, -1 if the queue is full or arguments are invalid
+ */
+int32_t fossil_io_filesys_aio_close(fossil_io_filesys_aio_t *aio, int fd, uint64_t user_data);
+
+/**
+ * @brief Start every queued request with as few system calls as possible.
+ *
+ * @param aio Engine
+ * @return Number of requests started, or -1 on failure
+ */
+int32_t fossil_io_filesys_aio_submit(fossil_io_filesys_aio_t *aio);
+
+/**
+ * @brief Collect finished requests without blocking.
+ *
+ * @param aio Engine
+ * @param out Array receiving completions
+ * @param max Capacity of out
+ * @return Number of completions stored, or -1 on invalid arguments
+ */
+int32_t fossil_io_filesys_aio_poll(fossil_io_filesys_aio_t *aio, fossil_io_filesys_aio_completion_t *out, size_t max);
+
+/**
+ * @brief Block until at least min_count requests finish, then collect them.
+ *
+ * Returns early with fewer completions only when nothing else is in flight.
+ *
+ * @param aio Engine
+ * @param out Array receiving completions
+ * @param max Capacity of out
+ * @param min_count Completions to wait for (clamped to max)
+ * @return Number of completions stored, or -1 on failure
+ */
+int32_t fossil_io_filesys_aio_wait(fossil_io_filesys_aio_t *aio, fossil_io_filesys_aio_completion_t *out, size_t max, size_t min_count);
+
+/**
+ * @brief Number of submitted requests whose completions have not been collected.
+ *
+ * @param aio Engine
+ * @return In-flight request count
+ */
+size_t fossil_io_filesys_aio_inflight(const fossil_io_filesys_aio_t *aio);
+
+/* ------------------------------------------------------------
+    * Directory-Specific Operations
+    * ------------------------------------------------------------ */
+
+/**
+ * @brief Create a directory at the specified path.
+ *
+ * Creates a new directory at the given path. If recursive is true, it will create any
+ * necessary parent directories as well.
+ * @param path Path to the directory to create
+ * @param recursive Whether to create parent directories if they do not exist
+ * @return 0 on success, negative error code on failure
+ */
+int32_t fossil_io_filesys_dir_create(const char *path, bool recursive);
+
+/**
+ * @brief List the contents of a directory.
+ *
+ * Retrieves a list of entries in the specified directory, including their metadata.
+ *
+ * @param path Path to the directory to list
+ * @param entries Array to store directory entries (caller-allocated)
+ * @param max_entries Maximum number of entries to store in the array
+ * @param out_count Pointer to store the actual number of entries found
+ * @return 0 on success, negative error code on failure
+ */
+int32_t fossil_io_filesys_dir_list(const char *path, fossil_io_filesys_obj_t *entries, size_t max_entries, size_t *out_count);
+
+/**
+ * @brief Walk a directory tree and apply a callback to each entry.
+ *
+ * Recursively traverses a directory and its subdirectories, invoking the provided
+ * callback function for each filesystem object encountered. Subdirectories are
+ * opened relative to their parent and symbolic links are not followed.
+ *
+ * @param path Path to the directory to walk
+ * @param callback Function to call for each entry (returns 0 to continue, non-zero to stop)
+ * @param user_data Pointer to user data to pass to the callback
+ * @return 0 on success, negative error code on failure
+ */
+int32_t fossil_io_filesys_dir_walk(const char *path, int (*callback)(const fossil_io_filesys_obj_t *, void *), void *user_data);
+
+/**
+ * @brief Options for fossil_io_filesys_dir_walk_parallel().
+ *
+ * Members:
+ *  - size_t threads: Worker count (0 = one per online CPU).
+ *  - bool ordered: Deliver entries serially in pre-order with siblings sorted
+ *    by name, instead of concurrently as they are discovered.
+ *  - bool skip_stat: Trust dirent d_type and skip fstatat() where possible;
+ *    size and timestamps are then left zero for those entries.
+ */
+typedef struct
+{
+    size_t threads;
+    bool ordered;
+    bool skip_stat;
+} fossil_io_filesys_walk_opts_t;
+
+/**
+ * @brief Walk a directory tree using multiple worker threads.
+ *
+ * Directories are scanned by a pool of workers sharing a work-stealing queue,
+ * using directory-relative openat()/fstatat() and dirent d_type. The root is
+ * always delivered first and symbolic links are not followed. Unless
+ * opts->ordered is set, the callback runs concurrently from several threads and
+ * must be thread-safe. Unreadable subdirectories are skipped and reported via
+ * the return value once the walk completes. On Windows this falls back to
+ * fossil_io_filesys_dir_walk().
+ *
+ * @param path Path to the directory to walk
+ * @param callback Function to call for each entry (returns 0 to continue, non-zero to stop)
+ * @param user_data Pointer to user data to pass to the callback
+ * @param opts Walk options, or NULL for defaults
+ * @return 0 on success, the callback's non-zero result if it stopped the walk,
+ *         or -1 if any directory could not be read
+ */
+int32_t fossil_io_filesys_dir_walk_parallel(const char *path, int (*callback)(const fossil_io_filesys_obj_t *, void *), void *user_data, const fossil_io_filesys_walk_opts_t *opts);
+
+/* ------------------------------------------------------------
+    * Directory Handles
+    * ------------------------------------------------------------ */
+
+/**
+ * @brief An open directory that names are resolved against.
+ *
+ * On POSIX this wraps an O_DIRECTORY descriptor, so every operation is one
+ * openat-family call: the kernel looks up a single name instead of walking a
+ * full path again, no path string is built, and the directory cannot be swapped
+ * out from under a recursive operation by renaming one of its parents. On
+ * Windows the handle keeps the directory's path and joins names onto it.
+ *
+ * A handle may be used from several threads for the *at operations; reading
+ * entries belongs to one thread at a time.
+ */
+typedef struct fossil_io_filesys_dirhandle fossil_io_filesys_dirhandle_t;
+
+/**
+ * @brief One directory entry from fossil_io_filesys_dirhandle_read().
+ *
+ * Members:
+ *  - const char *name: Entry name; valid until the next read or close.
+ *  - fossil_io_filesys_type_t type: FILE, DIR or LINK (links are not followed),
+ *    or UNKNOWN for devices, sockets and pipes.
+ */
+typedef struct
+{
+    const char *name;
+    fossil_io_filesys_type_t type;
+} fossil_io_filesys_dirent_t;
+
+/**
+ * @brief Flags for fossil_io_filesys_dirhandle_rename().
+ *
+ *  - FOSSIL_FILESYS_RENAME_NOREPLACE: Fail if the destination exists.
+ *  - FOSSIL_FILESYS_RENAME_EXCHANGE: Atomically swap source and destination,
+ *    which must both exist.
+ */
+typedef enum
+{
+    FOSSIL_FILESYS_RENAME_NOREPLACE = 1 << 0,
+    FOSSIL_FILESYS_RENAME_EXCHANGE = 1 << 1
+} fossil_io_filesys_rename_flags_t;
+
+/**
+ * @brief Open a directory by path.
+ *
+ * @param path Directory to open
+ * @return Handle on success, NULL if path is not a readable directory
+ */
+fossil_io_filesys_dirhandle_t *fossil_io_filesys_dirhandle_open(const char *path);
+
+/**
+ * @brief Open a directory relative to another.
+ *
+ * name may hold several components. A symbolic link in the last component is
+ * not followed, so recursive operations never leave the tree they started in.
+ *
+ * @param dir Directory to resolve name against
+ * @param name Relative path of the subdirectory
+ * @return Handle on success, NULL on failure
+ */
+fossil_io_filesys_dirhandle_t *fossil_io_filesys_dirhandle_open_dir(fossil_io_filesys_dirhandle_t *dir, const char *name);
+
+/**
+ * @brief Close a handle; NULL is ignored.
+ */
+void fossil_io_filesys_dirhandle_close(fossil_io_filesys_dirhandle_t *dir);
+
+/**
+ * @brief The underlying descriptor, for calls this API does not cover; -1 on Windows.
+ */
+int fossil_io_filesys_dirhandle_fd(const fossil_io_filesys_dirhandle_t *dir);
+
+/**
+ * @brief The path the handle was opened with, joined with any open_dir() names.
+ */
+const char *fossil_io_filesys_dirhandle_path(const fossil_io_filesys_dirhandle_t *dir);
+
+/**
+ * @brief Read the next entry; "." and ".." are skipped.
+ *
+ * @param dir Directory to read
+ * @param entry Receives the entry
+ * @return 1 if an entry was read, 0 at the end, -1 on error
+ */
+int32_t fossil_io_filesys_dirhandle_read(fossil_io_filesys_dirhandle_t *dir, fossil_io_filesys_dirent_t *entry);
+
+/**
+ * @brief Open a file relative to a directory (openat).
+ *
+ * Accepts the same modes as fossil_io_filesys_file_open(); f->base.path is the
+ * directory path joined with name.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int32_t fossil_io_filesys_dirhandle_open_file(fossil_io_filesys_dirhandle_t *dir, fossil_io_filesys_file_t *f,
+                                              const char *name, const char *mode);
+
+/**
+ * @brief Read metadata of an entry relative to a directory (fstatat).
+ *
+ * Fills obj from a single call, like the listing functions do: owner and group
+ * are left empty and no lock is allocated.
+ *
+ * @param follow Follow a symbolic link in the last component
+ * @return 0 on success, -1 on failure
+ */
+int32_t fossil_io_filesys_dirhandle_stat(fossil_io_filesys_dirhandle_t *dir, const char *name,
+                                         fossil_io_filesys_obj_t *obj, bool follow);
+
+/**
+ * @brief Remove an entry relative to a directory (unlinkat).
+ *
+ * @param is_dir Remove an empty directory rather than a file or link
+ * @return 0 on success, -1 on failure
+ */
+int32_t fossil_io_filesys_dirhandle_unlink(fossil_io_filesys_dirhandle_t *dir, const char *name, bool is_dir);
+
+/**
+ * @brief Create a directory relative to a directory (mkdirat).
+ *
+ * @param mode Permission bits before the umask, e.g. 0755; ignored on Windows
+ * @return 0 on success, -1 on failure (including when it already exists)
+ */
+int32_t fossil_io_filesys_dirhandle_mkdir(fossil_io_filesys_dirhandle_t *dir, const char *name, uint32_t mode);
+
+/**
+ * @brief Rename an entry between two directories (renameat2).
+ *
+ * With no flags an existing destination is replaced. NOREPLACE and EXCHANGE
+ * are atomic where the kernel and filesystem support them. Otherwise NOREPLACE
+ * checks before renaming, which leaves a window for a racing writer, and
+ * EXCHANGE fails. Windows supports NOREPLACE but not EXCHANGE.
+ *
+ * @param flags Bitwise OR of fossil_io_filesys_rename_flags_t
+ * @return 0 on success, -1 on failure
+ */
+int32_t fossil_io_filesys_dirhandle_rename(fossil_io_filesys_dirhandle_t *src_dir, const char *src_name,
+                                           fossil_io_filesys_dirhandle_t *dest_dir, const char *dest_name,
+                                           uint32_t flags);
+
+/**
+ * @brief Read a symbolic link's target relative to a directory (readlinkat).
+ *
+ * @param target_out Receives the NUL-terminated target
+ * @return Length of the target, or -1 on failure or if it does not fit
+ */
+int32_t fossil_io_filesys_dirhandle_readlink(fossil_io_filesys_dirhandle_t *dir, const char *name,
+                                             char *target_out, size_t max_len);
+
+/**
+ * @brief Columnar metadata snapshot of a single directory.
+ *
+ * Entries are stored as parallel arrays indexed 0..count-1, with every name
+ * packed NUL-terminated into one string arena, so a listing costs a handful
+ * of allocations regardless of entry count. Zero-initialize before first use;
+ * a snapshot may be refilled repeatedly and keeps its buffers between calls.
+ *
+ * Members:
+ *  - size_t count: Number of entries ("." and ".." are excluded).
+ *  - char *names: String arena; entry i's name is names + name_offsets[i].
+ *  - size_t *name_offsets: Offset of each name within the arena.
+ *  - uint8_t *types: fossil_io_filesys_type_t of each entry (links not followed).
+ *  - uint64_t *sizes: Size in bytes.
+ *  - uint32_t *modes: Raw platform mode / attribute bits.
+ *  - time_t *mtimes: Last modification time.
+ *  - capacities: internal bookkeeping for buffer reuse.
+ */
+typedef struct
+{
+    size_t count;
+
+    char *names;
+    size_t *name_offsets;
+    uint8_t *types;
+    uint64_t *sizes;
+    uint32_t *modes;
+    time_t *mtimes;
+
+    size_t capacity;
+    size_t names_length;
+    size_t names_capacity;
+} fossil_io_filesys_dir_snapshot_t;
+
+/**
+ * @brief Capture name, type, size, mode and mtime of every entry in a directory.
+ *
+ * On Linux the directory is read with getdents64() in large batches and each
+ * entry is queried with statx() restricted to the needed fields, falling back
+ * to fstatat(AT_SYMLINK_NOFOLLOW). Other POSIX systems use readdir() with
+ * fstatat(); Windows takes the metadata straight from FindFirstFileEx().
+ * An entry that vanishes mid-scan is kept with zeroed metadata.
+ *
+ * @param path Path to the directory to scan
+ * @param snap Snapshot to fill (zero-initialized or previously filled)
+ * @return 0 on success, negative error code on failure
+ */
+int32_t fossil_io_filesys_dir_snapshot(const char *path, fossil_io_filesys_dir_snapshot_t *snap);
+
+/**
+ * @brief Get the name of a snapshot entry.
+ *
+ * @param snap Filled snapshot
+ * @param index Entry index (less than snap->count)
+ * @return Pointer into the snapshot's arena, or NULL if index is out of range
+ */
+const char *fossil_io_filesys_dir_snapshot_name(const fossil_io_filesys_dir_snapshot_t *snap, size_t index);
+
+/**
+ * @brief Release the buffers held by a snapshot and reset it to empty.
+ *
+ * @param snap Snapshot to release (NULL is ignored)
+ */
+void fossil_io_filesys_dir_snapshot_free(fossil_io_filesys_dir_snapshot_t *snap);
+
+/**
+ * @brief Merge the contents of one directory into another.
+ *
+ * Merges the contents of the source directory into the destination directory. If
  * overwrite is true, existing files in the destination will be overwritten. If
- * recursive is true, subdirectories will also be merged.
+ * recursive is true, subdirectories will also be merged. Both directories must
+ * exist. Symbolic links in the source are copied as files, never descended into.
  *
  * @param src Path to the source directory
  * @param dest Path to the destination directory
@@ -625,6 +1714,62 @@ int32_t fossil_io_filesys_dir_merge(const char *src, const char *dest, bool over
  */
 int32_t fossil_io_filesys_dir_mirror(const char *src, const char *dest, bool delete_extras);
 
+/**
+ * Options for fossil_io_filesys_dir_mirror_ex().
+ *
+ * Members:
+ *  - delete_extras: Remove destination entries that are not in the source.
+ *  - manifest_path: File recording what the last mirror copied (path, size,
+ *    mtime in nanoseconds, inode, content hash), or NULL to compare against
+ *    the destination.
+ *  - threads: Copy workers (0 = one per online CPU).
+ *  - hash_contents: Hash copied files into the manifest, and trust a matching
+ *    hash over a changed inode instead of recopying.
+ */
+typedef struct
+{
+    bool delete_extras;
+    const char *manifest_path;
+    size_t threads;
+    bool hash_contents;
+} fossil_io_filesys_mirror_opts_t;
+
+/**
+ * Results reported by fossil_io_filesys_dir_mirror_ex().
+ */
+typedef struct
+{
+    uint64_t files_scanned;
+    uint64_t files_copied;
+    uint64_t files_unchanged;
+    uint64_t files_deleted;
+    uint64_t dirs_created;
+    uint64_t bytes_copied;
+    uint64_t errors;
+} fossil_io_filesys_mirror_stats_t;
+
+/**
+ * Mirror a directory, copying only what changed since the last run.
+ *
+ * The source tree is scanned once. With a manifest, each file is compared in
+ * memory against the size, mtime and inode recorded by the previous run, so
+ * an unchanged tree costs one stat per source entry and nothing on the
+ * destination; extras are the manifest entries no longer in the source. The
+ * manifest assumes the destination is only changed by this call: edit it
+ * behind the mirror's back and those edits go unnoticed until the manifest
+ * is deleted. Without a manifest, or on the first run, files are compared
+ * against the destination instead. Changed files are copied in parallel, get
+ * the source mtime, and the manifest is rewritten atomically at the end;
+ * files that failed to copy are left out of it so the next run retries them.
+ *
+ * @param src Path to the source directory
+ * @param dest Path to the destination directory (created if missing)
+ * @param opts Options, or NULL to mirror without a manifest using all CPUs
+ * @param stats Optional output statistics
+ * @return 0 on success, negative if the scan failed or any entry failed
+ */
+int32_t fossil_io_filesys_dir_mirror_ex(const char *src, const char *dest, const fossil_io_filesys_mirror_opts_t *opts, fossil_io_filesys_mirror_stats_t *stats);
+
 /**
  * @brief Check if a directory exists at the given path.
  *
@@ -786,34 +1931,500 @@ int32_t fossil_io_filesys_link_set_owner(const char *link_path, const char *owne
     * ------------------------------------------------------------ */
 
 /**
- * @brief Begin a filesystem transaction.
+ * @brief Opaque journaled filesystem transaction.
  *
- * This function starts a new transaction, allowing multiple filesystem operations
- * to be performed atomically.
+ * Writes, copies, moves and removals staged in a transaction are written
+ * beside their targets and recorded in a write-ahead journal; nothing is
+ * visible until commit. Commit syncs the staged data as one concurrent
+ * group, makes the journal's commit record durable with a single fsync,
+ * then applies the operations in order by rename, keeping whatever they
+ * replace or remove until all have succeeded. If any step fails the applied
+ * operations are reverted. After a crash, fossil_io_filesys_tx_recover()
+ * finishes committed journals and discards the rest.
  *
- * @return 0 on success, negative error code on failure
+ * Operations act on the filesystem as it was when they were staged, and a
+ * path may appear in only one operation per transaction. Relative paths
+ * are resolved against the working directory when staged, so recovery does
+ * not depend on where it runs. Paths must not contain tabs or newlines.
+ * Independent transactions run concurrently; one transaction must not be
+ * used from two threads at once.
  */
-int32_t fossil_io_filesys_tx_begin(void);
+typedef struct fossil_io_filesys_tx fossil_io_filesys_tx_t;
+
+/**
+ * @brief Open a transaction.
+ *
+ * @param journal_dir Directory for the journal, or NULL for the system temp
+ *                    directory. Use the same directory for recovery.
+ * @return Transaction handle, or NULL on failure
+ */
+fossil_io_filesys_tx_t *fossil_io_filesys_tx_open(const char *journal_dir);
+
+/**
+ * @brief Stage replacing (or creating) a file with the given bytes.
+ *
+ * @param tx Transaction
+ * @param path Target file
+ * @param data New contents
+ * @param len Number of bytes
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_tx_write(fossil_io_filesys_tx_t *tx, const char *path, const void *data, size_t len);
+
+/**
+ * @brief Stage copying a file; the copy is taken now and appears at commit.
+ *
+ * @param tx Transaction
+ * @param src Source file
+ * @param dest Destination file
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_tx_copy(fossil_io_filesys_tx_t *tx, const char *src, const char *dest);
+
+/**
+ * @brief Stage a rename of a file or directory (on the same filesystem).
+ *
+ * @param tx Transaction
+ * @param src Existing path
+ * @param dest New path; an existing entry there is replaced
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_tx_move(fossil_io_filesys_tx_t *tx, const char *src, const char *dest);
+
+/**
+ * @brief Stage removing a file or directory tree.
+ *
+ * @param tx Transaction
+ * @param path Existing path
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_tx_remove(fossil_io_filesys_tx_t *tx, const char *path);
 
 /**
- * @brief Commit a filesystem transaction.
+ * @brief Commit or roll back a transaction and free it.
  *
- * This function commits the current transaction, making all changes permanent.
+ * Rolling back deletes the staged data and the journal; the filesystem is
+ * left exactly as it was. A failed commit is rolled back the same way.
+ *
+ * @param tx Transaction (freed on return)
+ * @param commit true to commit, false to roll back
+ * @return 0 on success, negative if the commit failed
+ */
+int32_t fossil_io_filesys_tx_end(fossil_io_filesys_tx_t *tx, bool commit);
+
+/**
+ * @brief Finish transactions interrupted by a crash.
+ *
+ * Committed journals in journal_dir are replayed and uncommitted ones are
+ * discarded along with their staged files. Each open transaction holds a
+ * lock on its journal, and journals that are locked or unreadable are
+ * skipped, so recovery is safe while other threads or processes have
+ * transactions in flight in the same directory.
+ *
+ * @param journal_dir Journal directory, or NULL for the system temp directory
+ * @return Number of journals processed (skipped ones are not counted), or -1
+ *         on failure
+ */
+int32_t fossil_io_filesys_tx_recover(const char *journal_dir);
+
+/**
+ * @brief Begin a filesystem transaction for the calling thread.
+ *
+ * Opens a transaction in the system temp directory and makes it the
+ * thread's current one (see fossil_io_filesys_tx_current()). Each thread
+ * has its own, so transactions on different threads do not wait on each
+ * other.
+ *
+ * @return 0 on success, negative if one is already active or on failure
+ */
+int32_t fossil_io_filesys_tx_begin(void);
+
+/**
+ * @brief Commit the calling thread's current transaction.
  *
  * @return 0 on success, negative error code on failure
  */
 int32_t fossil_io_filesys_tx_commit(void);
 
 /**
- * @brief Rollback a filesystem transaction.
+ * @brief Roll back the calling thread's current transaction.
  *
- * This function rolls back the current transaction, undoing all changes made
- * since the transaction began.
+ * Discards everything staged since fossil_io_filesys_tx_begin().
  *
  * @return 0 on success, negative error code on failure
  */
 int32_t fossil_io_filesys_tx_rollback(void);
 
+/**
+ * @brief Get the transaction begun on the calling thread.
+ *
+ * @return The current transaction, or NULL if none is active
+ */
+fossil_io_filesys_tx_t *fossil_io_filesys_tx_current(void);
+
+/* ------------------------------------------------------------
+    * Change Watching
+    * ------------------------------------------------------------ */
+
+/**
+ * Kinds of change reported by a watcher, combined as a bit mask.
+ *
+ *  - FOSSIL_FILESYS_WATCH_CREATE: An entry appeared.
+ *  - FOSSIL_FILESYS_WATCH_MODIFY: File contents were written.
+ *  - FOSSIL_FILESYS_WATCH_ATTRIB: Permissions, ownership or timestamps changed.
+ *  - FOSSIL_FILESYS_WATCH_DELETE: An entry was removed.
+ *  - FOSSIL_FILESYS_WATCH_MOVED_FROM: An entry was renamed away from the path.
+ *  - FOSSIL_FILESYS_WATCH_MOVED_TO: An entry was renamed onto the path.
+ *  - FOSSIL_FILESYS_WATCH_OVERFLOW: Events were lost because a queue filled
+ *    up; the path is empty and watched trees should be rescanned.
+ *  - FOSSIL_FILESYS_WATCH_IS_DIR: Flag set when the entry is a directory.
+ */
+typedef enum
+{
+    FOSSIL_FILESYS_WATCH_CREATE = 1u << 0,
+    FOSSIL_FILESYS_WATCH_MODIFY = 1u << 1,
+    FOSSIL_FILESYS_WATCH_ATTRIB = 1u << 2,
+    FOSSIL_FILESYS_WATCH_DELETE = 1u << 3,
+    FOSSIL_FILESYS_WATCH_MOVED_FROM = 1u << 4,
+    FOSSIL_FILESYS_WATCH_MOVED_TO = 1u << 5,
+    FOSSIL_FILESYS_WATCH_OVERFLOW = 1u << 6,
+    FOSSIL_FILESYS_WATCH_IS_DIR = 1u << 7
+} fossil_io_filesys_watch_kind_t;
+
+/**
+ * @brief Options for fossil_io_filesys_watch_open().
+ *
+ * Members:
+ *  - uint32_t events: Kinds to report (0 = all); overflow is always reported.
+ *  - uint32_t debounce_ms: Hold a path's events until it has been quiet this
+ *    long (but no longer than eight times this since its first event), so a
+ *    burst of writes arrives as one event. 0 delivers every batch read from
+ *    the kernel as soon as it is coalesced.
+ *  - size_t capacity: Delivered events buffered for the reader (0 = 1024,
+ *    rounded up to a power of two). When it is full, events wait in the
+ *    watcher and keep coalescing.
+ */
+typedef struct
+{
+    uint32_t events;
+    uint32_t debounce_ms;
+    size_t capacity;
+} fossil_io_filesys_watch_opts_t;
+
+/**
+ * @brief One delivered change.
+ *
+ * Members:
+ *  - uint32_t mask: Kinds seen since the path was last delivered, plus
+ *    FOSSIL_FILESYS_WATCH_IS_DIR. An entry created and removed again within
+ *    one debounce window is not reported at all.
+ *  - char path[]: Watched path joined with the name of the entry that changed.
+ */
+typedef struct
+{
+    uint32_t mask;
+    char path[FOSSIL_FILESYS_MAX_PATH];
+} fossil_io_filesys_watch_event_t;
+
+/** Opaque filesystem watcher. */
+typedef struct fossil_io_filesys_watch fossil_io_filesys_watch_t;
+
+/**
+ * @brief Create a watcher.
+ *
+ * A background thread reads kernel notifications (inotify on Linux,
+ * ReadDirectoryChangesW on Windows), coalesces them per path and, once a
+ * path has settled, publishes it to a single-producer ring the caller drains
+ * with fossil_io_filesys_watch_read() or fossil_io_filesys_watch_wait().
+ * Other platforms fail with ENOSYS.
+ *
+ * @param opts Watcher options, or NULL for defaults
+ * @return New watcher, or NULL on failure
+ */
+fossil_io_filesys_watch_t *fossil_io_filesys_watch_open(const fossil_io_filesys_watch_opts_t *opts);
+
+/**
+ * @brief Stop a watcher and free it; undelivered events are dropped.
+ *
+ * @param w Watcher to close (NULL is ignored)
+ */
+void fossil_io_filesys_watch_close(fossil_io_filesys_watch_t *w);
+
+/**
+ * @brief Start watching a directory, or on Linux also a single file.
+ *
+ * A recursive watch also covers every subdirectory, including those created
+ * or moved in later; entries already inside a new subdirectory when it is
+ * picked up are reported as created. Symbolic links below the path are not
+ * followed. Safe to call from any thread.
+ *
+ * @param w Watcher
+ * @param path Directory or file to watch
+ * @param recursive Watch the whole tree below path
+ * @return 0 on success, negative on failure
+ */
+int32_t fossil_io_filesys_watch_add(fossil_io_filesys_watch_t *w, const char *path, bool recursive);
+
+/**
+ * @brief Stop watching a path added with fossil_io_filesys_watch_add().
+ *
+ * @param w Watcher
+ * @param path Path exactly as it was added
+ * @return 0 on success, negative if the path is not watched
+ */
+int32_t fossil_io_filesys_watch_remove(fossil_io_filesys_watch_t *w, const char *path);
+
+/**
+ * @brief Descriptor that polls readable while events are waiting.
+ *
+ * Add it to an existing poll()/epoll loop and call
+ * fossil_io_filesys_watch_read() when it fires. Do not read from it directly.
+ *
+ * @param w Watcher
+ * @return Descriptor, or -1 where none exists (Windows)
+ */
+int fossil_io_filesys_watch_fd(const fossil_io_filesys_watch_t *w);
+
+/**
+ * @brief Take delivered events without blocking.
+ *
+ * Reading is single-consumer: call it (and fossil_io_filesys_watch_wait())
+ * from one thread at a time.
+ *
+ * @param w Watcher
+ * @param events Array receiving events
+ * @param max Capacity of events
+ * @return Number of events stored, or -1 on invalid arguments
+ */
+int32_t fossil_io_filesys_watch_read(fossil_io_filesys_watch_t *w, fossil_io_filesys_watch_event_t *events, size_t max);
+
+/**
+ * @brief Wait for events, then take them.
+ *
+ * @param w Watcher
+ * @param events Array receiving events
+ * @param max Capacity of events
+ * @param timeout_ms Longest wait in milliseconds, or -1 to wait indefinitely
+ * @return Number of events stored (0 on timeout), or -1 on failure
+ */
+int32_t fossil_io_filesys_watch_wait(fossil_io_filesys_watch_t *w, fossil_io_filesys_watch_event_t *events, size_t max, int32_t timeout_ms);
+
+/* ------------------------------------------------------------
+    * Metadata Cache
+    * ------------------------------------------------------------ */
+
+/**
+ * @brief Options for fossil_io_filesys_cache_enable().
+ *
+ * Members:
+ *  - uint32_t ttl_ms: How long an answer is reused (0 = 1000).
+ *  - size_t capacity: Most paths kept; the least recently used are evicted
+ *    first (0 = 4096).
+ *  - bool watch: Also drop answers as soon as a change watcher reports the
+ *    path changed, where watching is supported (see
+ *    fossil_io_filesys_watch_open()); the TTL still applies.
+ */
+typedef struct
+{
+    uint32_t ttl_ms;
+    size_t capacity;
+    bool watch;
+} fossil_io_filesys_cache_opts_t;
+
+/**
+ * @brief Counters reported by fossil_io_filesys_cache_stats().
+ *
+ * Members:
+ *  - uint64_t hits: Queries answered from the cache.
+ *  - uint64_t misses: Queries that went to the filesystem.
+ *  - uint64_t evictions: Entries pushed out by the capacity bound.
+ *  - uint64_t invalidations: Entries dropped because their path changed.
+ *  - size_t entries: Paths currently cached.
+ *  - bool watching: A change watcher is invalidating entries.
+ */
+typedef struct
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+    size_t entries;
+    bool watching;
+} fossil_io_filesys_cache_stats_t;
+
+/**
+ * @brief Turn on the metadata cache, or reconfigure and empty it.
+ *
+ * While enabled, fossil_io_filesys_exists(), fossil_io_filesys_dir_exists(),
+ * fossil_io_filesys_file_is_readable() and fossil_io_filesys_file_size()
+ * reuse answers for the same lexically normalized path. Changes made through
+ * this library invalidate immediately: remove, move, copy, dir_create,
+ * file_open for writing, file_close, truncate, chmod, links, file_rewrite and
+ * file_rewrite_stream, file_merge, file_compress and file_decompress, split and
+ * join outputs, deduplicate, dir_mirror, directory handle operations and
+ * committed or rolled back transactions. Other changes
+ * are seen when a watcher reports them or when the TTL expires. Relative
+ * paths are cached too, and fossil_io_filesys_chdir() clears the cache; call
+ * fossil_io_filesys_cache_invalidate(NULL) after changing directory any
+ * other way. "Not found" answers are cached; other errors are not.
+ *
+ * @param opts Cache options, or NULL for defaults
+ * @return 0 on success, -1 on allocation failure (the cache is then off)
+ */
+int32_t fossil_io_filesys_cache_enable(const fossil_io_filesys_cache_opts_t *opts);
+
+/**
+ * @brief Turn the metadata cache off and free it; queries go straight to the filesystem.
+ */
+void fossil_io_filesys_cache_disable(void);
+
+/**
+ * @brief Drop cached answers for a path and everything below it.
+ *
+ * @param path Path to forget, or NULL for everything
+ * @return Number of entries dropped, or -1 if the path is too long
+ */
+int32_t fossil_io_filesys_cache_invalidate(const char *path);
+
+/**
+ * @brief Read the cache counters accumulated since it was last enabled.
+ *
+ * @param out Filled with the counters
+ * @return 0 on success, -1 on invalid arguments
+ */
+int32_t fossil_io_filesys_cache_stats(fossil_io_filesys_cache_stats_t *out);
+
+/* ------------------------------------------------------------
+    * Path Views
+    * ------------------------------------------------------------ */
+
+/**
+ * @brief A borrowed slice of a path string.
+ *
+ * Views never own memory and need not be NUL-terminated, so parent, filename,
+ * stem and extension are pointer arithmetic over the caller's string with no
+ * copying or allocation. '/' separates components everywhere; '\\' does too
+ * on Windows, where a leading drive letter ("C:") is part of the root.
+ *
+ * Members:
+ *  - const char *ptr: First byte of the slice.
+ *  - size_t len: Length of the slice in bytes.
+ */
+typedef struct
+{
+    const char *ptr;
+    size_t len;
+} fossil_io_filesys_pathview_t;
+
+/**
+ * @brief Cursor over the components of a path view.
+ *
+ * Initialize with fossil_io_filesys_pathiter_init(); the members are private.
+ */
+typedef struct
+{
+    fossil_io_filesys_pathview_t path;
+    size_t pos;
+} fossil_io_filesys_pathiter_t;
+
+/**
+ * @brief View a NUL-terminated string; NULL gives an empty view.
+ */
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview(const char *path);
+
+/**
+ * @brief View the first len bytes of path; NULL gives an empty view.
+ */
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_n(const char *path, size_t len);
+
+/**
+ * @brief The root of a path: leading separators plus, on Windows, a drive letter.
+ *
+ * Empty for relative paths, so a non-empty root means the path is anchored.
+ */
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_root(fossil_io_filesys_pathview_t path);
+
+/**
+ * @brief The path without its last component, e.g. "/a/b/" gives "/a".
+ *
+ * Trailing separators are ignored. The parent of "/a" is "/", and the parent
+ * of a bare root or a single relative component is empty, so repeatedly taking
+ * the parent always ends with an empty view.
+ */
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_parent(fossil_io_filesys_pathview_t path);
+
+/**
+ * @brief The last component, ignoring trailing separators, e.g. "a/b.tar.gz/" gives "b.tar.gz".
+ */
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_filename(fossil_io_filesys_pathview_t path);
+
+/**
+ * @brief The last component without its extension, e.g. "b.tar.gz" gives "b.tar".
+ */
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_stem(fossil_io_filesys_pathview_t path);
+
+/**
+ * @brief The extension of the last component including its dot, e.g. ".gz".
+ *
+ * Empty when there is no dot, for dotfiles such as ".profile", and for "." and "..".
+ * The stem followed by the extension is always the filename.
+ */
+fossil_io_filesys_pathview_t fossil_io_filesys_pathview_extension(fossil_io_filesys_pathview_t path);
+
+/**
+ * @brief Start iterating over the components of a path.
+ *
+ * @param it Cursor to initialize
+ * @param path Path to walk; its memory must outlive the iteration
+ */
+void fossil_io_filesys_pathiter_init(fossil_io_filesys_pathiter_t *it, fossil_io_filesys_pathview_t path);
+
+/**
+ * @brief Step to the next component.
+ *
+ * The root, if any, comes first as one component (e.g. "/" or "C:\\"). Runs of
+ * separators are skipped; "." and ".." are returned as they appear.
+ *
+ * @param it Cursor from fossil_io_filesys_pathiter_init()
+ * @param component Receives the component
+ * @return true if a component was produced, false at the end of the path
+ */
+bool fossil_io_filesys_pathiter_next(fossil_io_filesys_pathiter_t *it, fossil_io_filesys_pathview_t *component);
+
+/**
+ * @brief Copy a view into a NUL-terminated buffer.
+ *
+ * @return Length written (excluding the terminator), or -1 if it does not fit
+ */
+int32_t fossil_io_filesys_pathview_copy(fossil_io_filesys_pathview_t path, char *out, size_t max_len);
+
+/**
+ * @brief Join two paths into a caller buffer with the platform separator.
+ *
+ * If tail has a root it replaces base, as it would when resolved from base.
+ * out may be the buffer base points into, to append in place; tail must not
+ * overlap out.
+ *
+ * @return Length written (excluding the terminator), or -1 if it does not fit
+ */
+int32_t fossil_io_filesys_pathview_join(fossil_io_filesys_pathview_t base, fossil_io_filesys_pathview_t tail,
+                                        char *out, size_t max_len);
+
+/**
+ * @brief Lexically normalize a path into a caller buffer.
+ *
+ * Separators become the platform separator and runs of them collapse, "."
+ * components are dropped and ".." removes the component before it. ".." at a
+ * root is dropped; at the start of a relative path it is kept. Trailing
+ * separators are removed and an empty result becomes ".". Symbolic links are
+ * not consulted, so "a/link/.." becomes "a" even where the filesystem would
+ * disagree. The output is never longer than the input (except "" to "."), so
+ * out may be the buffer path points into.
+ *
+ * @return Length written (excluding the terminator), or -1 if it does not fit
+ */
+int32_t fossil_io_filesys_pathview_normalize(fossil_io_filesys_pathview_t path, char *out, size_t max_len);
+
 /* ------------------------------------------------------------
     * Path / Utility Operations
     * ------------------------------------------------------------ */
@@ -844,8 +2455,9 @@ int32_t fossil_io_filesys_chdir(const char *path);
 /**
  * @brief Convert a path to its absolute form.
  *
- * Resolves relative paths to absolute paths, expanding any relative path components
- * (., .., ~) and removing redundant separators. Symbolic links are not followed.
+ * Prefixes relative paths with the working directory, then normalizes the result
+ * lexically as fossil_io_filesys_pathview_normalize() does. Symbolic links are not
+ * followed. The working directory is read on every call.
  *
  * @param path Input path (absolute or relative)
  * @param abs_path Buffer to store the resulting absolute path
@@ -858,7 +2470,9 @@ int32_t fossil_io_filesys_abspath(const char *path, char *abs_path, size_t max_l
  * @brief Extract the directory component from a path.
  *
  * Extracts the directory portion of a path string. For example, "/home/user/file.txt"
- * returns "/home/user". The trailing separator is not included in the output.
+ * returns "/home/user". The trailing separator is not included in the output, a
+ * root such as "/" is its own directory, and a path with no directory part gives ".".
+ * See fossil_io_filesys_pathview_parent().
  *
  * @param path Input path string
  * @param dir_out Buffer to store the extracted directory name
@@ -884,8 +2498,8 @@ int32_t fossil_io_filesys_basename(const char *path, char *name_out, size_t max_
  * @brief Extract the file extension from a path.
  *
  * Extracts the file extension (suffix) from a filename, including the leading dot.
- * For example, "/home/user/file.tar.gz" may return ".gz" depending on implementation.
- * If no extension is present, an empty string is returned.
+ * For example, "/home/user/file.tar.gz" returns ".gz". If no extension is present,
+ * an empty string is returned.
  *
  * @param path Input path string
  * @param ext_out Buffer to store the extracted file extension
@@ -900,7 +2514,8 @@ int32_t fossil_io_filesys_extension(const char *path, char *ext_out, size_t max_
  * This function takes an input path string and normalizes it by converting all path
  * separators to the platform-specific separator, removing redundant separators, and
  * resolving any relative path components (., ..) where possible. The resulting normalized
- * path is returned as a newly allocated string that must be freed by the caller.
+ * path is returned as a newly allocated string that must be freed by the caller. Use
+ * fossil_io_filesys_pathview_normalize() to normalize into a caller buffer instead.
  *
  * @param path Input path string to normalize
  * @return Normalized path string on success (caller must free), or NULL on failure (invalid input, memory allocation failure, etc.)
@@ -939,7 +2554,13 @@ const char *fossil_io_filesys_type_string(fossil_io_filesys_type_t type);
 #ifdef __cplusplus
 }
 
+#include <cerrno>
+#include <future>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace fossil::io
 {
@@ -1009,6 +2630,28 @@ namespace fossil::io
             return fossil_io_filesys_remove(path.c_str(), recursive);
         }
 
+        /**
+         * @brief Remove a file or directory tree in parallel, optionally in the background.
+         *
+         * @param path Path to the object to remove
+         * @param opts Worker count and background mode, or nullptr for defaults
+         * @return 0 on success, negative on failure
+         */
+        int32_t remove_tree(const std::string &path, const fossil_io_filesys_remove_opts_t *opts = nullptr)
+        {
+            return fossil_io_filesys_remove_tree(path.c_str(), opts);
+        }
+
+        /**
+         * @brief Wait for all background removals to finish.
+         *
+         * @return 0 if they all succeeded, negative otherwise
+         */
+        int32_t remove_wait()
+        {
+            return fossil_io_filesys_remove_wait();
+        }
+
         /**
          * @brief Rename or move a filesystem object to a new location.
          *
@@ -1025,19 +2668,47 @@ namespace fossil::io
         }
 
         /**
-         * @brief Copy a filesystem object to a new location.
+         * @brief Copy a filesystem object to a new location.
+         *
+         * Creates a copy of the file or directory at src to dest. If preserve_meta
+         * is true, retains permissions and timestamps from the source.
+         *
+         * @param src Source path of the object to copy
+         * @param dest Destination path for the copy
+         * @param preserve_meta If true, preserve permissions and timestamps
+         * @return 0 on success, negative on failure
+         */
+        int32_t copy(const std::string &src, const std::string &dest, bool preserve_meta = true)
+        {
+            return fossil_io_filesys_copy(src.c_str(), dest.c_str(), preserve_meta);
+        }
+
+        /**
+         * @brief Copy a file through the fastest available data path and report it.
          *
-         * Creates a copy of the file or directory at src to dest. If preserve_meta
-         * is true, retains permissions and timestamps from the source.
+         * Tries reflink, copy_file_range, sendfile and finally a large-buffer loop,
+         * filling stats with the strategy that finished the copy and the byte count.
          *
-         * @param src Source path of the object to copy
+         * @param src Source path of the file to copy
          * @param dest Destination path for the copy
          * @param preserve_meta If true, preserve permissions and timestamps
+         * @param stats Optional pointer receiving the strategy and byte count
          * @return 0 on success, negative on failure
          */
-        int32_t copy(const std::string &src, const std::string &dest, bool preserve_meta = true)
+        int32_t copy_ex(const std::string &src, const std::string &dest, bool preserve_meta, fossil_io_filesys_copy_stats_t *stats)
         {
-            return fossil_io_filesys_copy(src.c_str(), dest.c_str(), preserve_meta);
+            return fossil_io_filesys_copy_ex(src.c_str(), dest.c_str(), preserve_meta, stats);
+        }
+
+        /**
+         * @brief Convert a copy strategy to a human-readable string.
+         *
+         * @param strategy Strategy to convert
+         * @return Static string naming the strategy
+         */
+        const char *copy_strategy_string(fossil_io_filesys_copy_strategy_t strategy)
+        {
+            return fossil_io_filesys_copy_strategy_string(strategy);
         }
 
         /**
@@ -1070,6 +2741,20 @@ namespace fossil::io
             return fossil_io_filesys_deduplicate(path.c_str(), recursive);
         }
 
+        /**
+         * @brief Deduplicate files with the staged size/hash/compare pipeline.
+         *
+         * @param path Directory path to scan for duplicates
+         * @param recursive If true, scan subdirectories recursively
+         * @param opts Action and thread count, or nullptr for defaults
+         * @param stats Optional output statistics
+         * @return Number of duplicates resolved, or negative on failure
+         */
+        int32_t deduplicate_ex(const std::string &path, bool recursive, const fossil_io_filesys_dedup_opts_t *opts, fossil_io_filesys_dedup_stats_t *stats = nullptr)
+        {
+            return fossil_io_filesys_deduplicate_ex(path.c_str(), recursive, opts, stats);
+        }
+
         /**
          * @brief Get filesystem object metadata (type, size, permissions, timestamps).
          *
@@ -1118,6 +2803,34 @@ namespace fossil::io
             return fossil_io_filesys_file_rewrite(path.c_str(), transform, user_data);
         }
 
+        /**
+         * @brief Rewrite a file through a chunked transform writing to a sink.
+         *
+         * @param path Path to the file to rewrite
+         * @param chunk_size Input chunk and output buffer size (0 = 1 MiB)
+         * @param transform Called per chunk, then once with final set
+         * @param user_data Pointer passed through to the transform
+         * @return 0 on success, negative on failure (original untouched)
+         */
+        int32_t file_rewrite_stream(const std::string &path, size_t chunk_size, int (*transform)(const void *chunk, size_t len, bool final, fossil_io_filesys_sink_t *out, void *user_data), void *user_data)
+        {
+            return fossil_io_filesys_file_rewrite_stream(path.c_str(), chunk_size, transform, user_data);
+        }
+
+        /**
+         * @brief Transform a file in place through read-write mapped windows.
+         *
+         * @param path Path to the file to transform
+         * @param window Bytes mapped at a time (0 = 64 MiB)
+         * @param transform Called per window with its file offset
+         * @param user_data Pointer passed through to the transform
+         * @return 0 on success, negative on failure
+         */
+        int32_t file_rewrite_inplace(const std::string &path, size_t window, int (*transform)(void *data, size_t len, uint64_t offset, void *user_data), void *user_data)
+        {
+            return fossil_io_filesys_file_rewrite_inplace(path.c_str(), window, transform, user_data);
+        }
+
         /**
          * @brief Open a file and initialize a file object.
          *
@@ -1212,6 +2925,60 @@ namespace fossil::io
             return fossil_io_filesys_file_tell(f);
         }
 
+        /**
+         * @brief Read from an absolute offset without the object lock.
+         *
+         * @param f Pointer to the open file object
+         * @param buf Destination buffer
+         * @param len Number of bytes to read
+         * @param offset Absolute byte offset to read from
+         * @return Number of bytes read, or -1 on failure
+         */
+        int64_t file_pread(fossil_io_filesys_file_t *f, void *buf, size_t len, uint64_t offset)
+        {
+            return fossil_io_filesys_file_pread(f, buf, len, offset);
+        }
+
+        /**
+         * @brief Write to an absolute offset without the object lock.
+         *
+         * @param f Pointer to the open file object
+         * @param buf Source buffer
+         * @param len Number of bytes to write
+         * @param offset Absolute byte offset to write at
+         * @return Number of bytes written, or -1 on failure
+         */
+        int64_t file_pwrite(fossil_io_filesys_file_t *f, const void *buf, size_t len, uint64_t offset)
+        {
+            return fossil_io_filesys_file_pwrite(f, buf, len, offset);
+        }
+
+        /**
+         * @brief Scatter-read at an absolute offset into several buffers.
+         *
+         * @param f Pointer to the open file object
+         * @param iov Destination segments, filled in order
+         * @param offset Absolute byte offset of the first byte
+         * @return Total bytes read, or -1 on failure
+         */
+        int64_t file_preadv(fossil_io_filesys_file_t *f, const std::vector<fossil_io_filesys_iovec_t> &iov, uint64_t offset)
+        {
+            return fossil_io_filesys_file_preadv(f, iov.data(), iov.size(), offset);
+        }
+
+        /**
+         * @brief Gather-write several buffers at an absolute offset.
+         *
+         * @param f Pointer to the open file object
+         * @param iov Source segments, written in order
+         * @param offset Absolute byte offset of the first byte
+         * @return Total bytes written, or -1 on failure
+         */
+        int64_t file_pwritev(fossil_io_filesys_file_t *f, const std::vector<fossil_io_filesys_iovec_t> &iov, uint64_t offset)
+        {
+            return fossil_io_filesys_file_pwritev(f, iov.data(), iov.size(), offset);
+        }
+
         /**
          * @brief Flush buffered data to the file.
          *
@@ -1226,6 +2993,57 @@ namespace fossil::io
             return fossil_io_filesys_file_flush(f);
         }
 
+        /**
+         * @brief Set the level used by file_flush() for a file.
+         *
+         * @param f Pointer to the open file object
+         * @param level Flush level
+         * @return 0 on success, negative on failure
+         */
+        int32_t file_set_flush_level(fossil_io_filesys_file_t *f, fossil_io_filesys_flush_level_t level)
+        {
+            return fossil_io_filesys_file_set_flush_level(f, level);
+        }
+
+        /**
+         * @brief Flush a file to an explicit durability level.
+         *
+         * @param f Pointer to the open file object
+         * @param level Durability level to reach
+         * @return 0 on success, negative on failure
+         */
+        int32_t file_sync(fossil_io_filesys_file_t *f, fossil_io_filesys_flush_level_t level)
+        {
+            return fossil_io_filesys_file_sync(f, level);
+        }
+
+        /**
+         * @brief Group-commit several files to the same durability level.
+         *
+         * @param files Open file objects to synchronise
+         * @param level Durability level to reach (data by default)
+         * @return 0 on success, negative on failure
+         */
+        int32_t file_sync_group(const std::vector<fossil_io_filesys_file_t *> &files, fossil_io_filesys_flush_level_t level = FOSSIL_FILESYS_FLUSH_DATA)
+        {
+            return fossil_io_filesys_file_sync_group(files.data(), files.size(), level);
+        }
+
+        /**
+         * @brief Switch a file between locked and owned stream mode.
+         *
+         * Owned streams skip locking and batch writes; use them from one thread only.
+         *
+         * @param f Pointer to the open file object
+         * @param mode New stream mode
+         * @param buffer_size Write buffer size for owned mode (0 = 64 KiB)
+         * @return 0 on success, negative on failure
+         */
+        int32_t file_set_stream_mode(fossil_io_filesys_file_t *f, fossil_io_filesys_stream_mode_t mode, size_t buffer_size = 0)
+        {
+            return fossil_io_filesys_file_set_stream_mode(f, mode, buffer_size);
+        }
+
         /**
          * @brief Get the size of a file.
          *
@@ -1240,6 +3058,17 @@ namespace fossil::io
             return fossil_io_filesys_file_size(path.c_str());
         }
 
+        /**
+         * @brief Get the size of a file as a 64-bit value.
+         *
+         * @param path Path to the file
+         * @return File size in bytes, or -1 on failure
+         */
+        int64_t file_size64(const std::string &path)
+        {
+            return fossil_io_filesys_file_size64(path.c_str());
+        }
+
         /**
          * @brief Truncate or extend a file to a specific size.
          *
@@ -1256,10 +3085,10 @@ namespace fossil::io
         }
 
         /**
-         * @brief Compute the cryptographic hash of a file.
+         * @brief Compute the hash of a file.
          *
          * Reads the entire contents of a file and computes its hash using the
-         * specified algorithm (e.g., "sha256", "md5", "sha1").
+         * specified algorithm ("fnv1a", "xxh64", "crc32c" or "sha256").
          *
          * @param path Path to the file to hash
          * @param hash_out Pointer to buffer for the computed hash
@@ -1272,6 +3101,41 @@ namespace fossil::io
             return fossil_io_filesys_file_hash(path.c_str(), hash_out, hash_size, algorithm.c_str());
         }
 
+        /**
+         * @brief Hash a file and return the digest as bytes.
+         *
+         * @param path Path to the file to hash
+         * @param algorithm Algorithm name
+         * @param opts Options, or nullptr for a flat hash
+         * @return Digest bytes, empty on failure
+         */
+        std::vector<unsigned char> file_hash_ex(const std::string &path, const std::string &algorithm,
+                                                const fossil_io_filesys_hash_opts_t *opts = nullptr)
+        {
+            std::vector<unsigned char> out(fossil_io_filesys_hash_digest_size(algorithm.c_str()));
+            if (out.empty() ||
+                fossil_io_filesys_file_hash_ex(path.c_str(), algorithm.c_str(), out.data(), out.size(), opts) != 0)
+                out.clear();
+            return out;
+        }
+
+        /**
+         * @brief Hash a buffer and return the digest as bytes.
+         *
+         * @param algorithm Algorithm name
+         * @param data Bytes to hash
+         * @param len Number of bytes
+         * @return Digest bytes, empty on failure
+         */
+        std::vector<unsigned char> hash_buffer(const std::string &algorithm, const void *data, size_t len)
+        {
+            std::vector<unsigned char> out(fossil_io_filesys_hash_digest_size(algorithm.c_str()));
+            if (out.empty() ||
+                fossil_io_filesys_hash_buffer(algorithm.c_str(), data, len, out.data(), out.size()) != 0)
+                out.clear();
+            return out;
+        }
+
         /**
          * @brief Merge two files into a single destination file.
          *
@@ -1298,13 +3162,26 @@ namespace fossil::io
          * @param path Path to the file to split
          * @param part_size Size of each part in bytes
          * @param prefix Prefix for generated part file names
-         * @return 0 on success, negative on failure
+         * @return Number of parts written, negative on failure
          */
         int32_t file_split(const std::string &path, size_t part_size, const std::string &prefix)
         {
             return fossil_io_filesys_file_split(path.c_str(), part_size, prefix.c_str());
         }
 
+        /**
+         * @brief Split a file of any size into parts of a 64-bit part size.
+         *
+         * @param path Path to the file to split
+         * @param part_size Size of each part in bytes
+         * @param prefix Prefix for generated part file names
+         * @return Number of parts written, or -1 on failure
+         */
+        int64_t file_split64(const std::string &path, uint64_t part_size, const std::string &prefix)
+        {
+            return fossil_io_filesys_file_split64(path.c_str(), part_size, prefix.c_str());
+        }
+
         /**
          * @brief Join multiple file parts into a single file.
          *
@@ -1321,11 +3198,40 @@ namespace fossil::io
             return fossil_io_filesys_file_join(parts, count, dest.c_str());
         }
 
+        /**
+         * @brief Split a file in parallel and write "<prefix>.manifest".
+         *
+         * @param path Path to the file to split
+         * @param part_size Size of each part in bytes
+         * @param prefix Prefix for part and manifest file names
+         * @param opts Options, or nullptr for defaults
+         * @return Number of parts written, or -1 on failure
+         */
+        int64_t file_split_ex(const std::string &path, uint64_t part_size, const std::string &prefix,
+                              const fossil_io_filesys_split_opts_t *opts = nullptr)
+        {
+            return fossil_io_filesys_file_split_ex(path.c_str(), part_size, prefix.c_str(), opts);
+        }
+
+        /**
+         * @brief Rebuild a file from a split manifest, verifying every part.
+         *
+         * @param manifest Path to the manifest
+         * @param dest Path to the destination file
+         * @param opts Options, or nullptr for defaults
+         * @return 0 on success, negative on failure
+         */
+        int32_t file_join_manifest(const std::string &manifest, const std::string &dest,
+                                   const fossil_io_filesys_split_opts_t *opts = nullptr)
+        {
+            return fossil_io_filesys_file_join_manifest(manifest.c_str(), dest.c_str(), opts);
+        }
+
         /**
          * @brief Compress a file using the specified algorithm.
          *
-         * Compresses the source file using the provided compression algorithm
-         * (e.g., "gzip", "bzip2") and writes compressed data to the destination.
+         * Compresses the source file with the named codec ("lz4", "deflate",
+         * "zstd" or "rle") and writes compressed data to the destination.
          *
          * @param src Path to the source file to compress
          * @param dest Path to the destination compressed file
@@ -1352,6 +3258,31 @@ namespace fossil::io
             return fossil_io_filesys_file_decompress(src.c_str(), dest.c_str());
         }
 
+        /**
+         * @brief Read a range of a framed compressed file.
+         *
+         * @param src Path to the compressed file
+         * @param offset Offset into the uncompressed data
+         * @param buf Buffer receiving the data
+         * @param len Number of bytes wanted
+         * @return Bytes copied, or -1 on error
+         */
+        int64_t file_decompress_range(const std::string &src, uint64_t offset, void *buf, size_t len)
+        {
+            return fossil_io_filesys_file_decompress_range(src.c_str(), offset, buf, len);
+        }
+
+        /**
+         * @brief Check whether a compression algorithm is available.
+         *
+         * @param algorithm Algorithm name
+         * @return true if file_compress() accepts it
+         */
+        bool codec_available(const std::string &algorithm)
+        {
+            return fossil_io_filesys_codec_available(algorithm.c_str()) == 1;
+        }
+
         /**
          * @brief Check if a file is readable.
          *
@@ -1455,6 +3386,34 @@ namespace fossil::io
             return fossil_io_filesys_dir_walk(path.c_str(), callback, user_data);
         }
 
+        /**
+         * @brief Walk a directory tree using multiple worker threads.
+         *
+         * Callbacks run concurrently unless opts->ordered is set.
+         *
+         * @param path Path to the directory to walk
+         * @param callback Function to call for each entry (return 0 to continue, non-zero to stop)
+         * @param user_data Pointer to user data to pass to the callback
+         * @param opts Walk options, or nullptr for defaults
+         * @return 0 on success, callback result if stopped, -1 on read errors
+         */
+        int32_t dir_walk_parallel(const std::string &path, int (*callback)(const fossil_io_filesys_obj_t *, void *), void *user_data, const fossil_io_filesys_walk_opts_t *opts = nullptr)
+        {
+            return fossil_io_filesys_dir_walk_parallel(path.c_str(), callback, user_data, opts);
+        }
+
+        /**
+         * @brief Capture a columnar metadata snapshot of a directory.
+         *
+         * @param path Path to the directory to scan
+         * @param snap Snapshot to fill (zero-initialized or previously filled)
+         * @return 0 on success, negative on failure
+         */
+        int32_t dir_snapshot(const std::string &path, fossil_io_filesys_dir_snapshot_t *snap)
+        {
+            return fossil_io_filesys_dir_snapshot(path.c_str(), snap);
+        }
+
         /**
          * @brief Merge the contents of one directory into another.
          *
@@ -1490,6 +3449,20 @@ namespace fossil::io
             return fossil_io_filesys_dir_mirror(src.c_str(), dest.c_str(), delete_extras);
         }
 
+        /**
+         * @brief Mirror a directory incrementally, optionally tracked by a manifest.
+         *
+         * @param src Path to the source directory
+         * @param dest Path to the destination directory
+         * @param opts Manifest, deletion, hashing and thread options, or nullptr for defaults
+         * @param stats Optional output statistics
+         * @return 0 on success, negative on failure
+         */
+        int32_t dir_mirror_ex(const std::string &src, const std::string &dest, const fossil_io_filesys_mirror_opts_t *opts, fossil_io_filesys_mirror_stats_t *stats = nullptr)
+        {
+            return fossil_io_filesys_dir_mirror_ex(src.c_str(), dest.c_str(), opts, stats);
+        }
+
         /**
          * @brief Check if a directory exists at the given path.
          *
@@ -1679,10 +3652,11 @@ namespace fossil::io
         }
 
         /**
-         * @brief Begin a filesystem transaction.
+         * @brief Begin a filesystem transaction for the calling thread.
          *
-         * Starts a new transaction, allowing multiple filesystem operations
-         * to be performed atomically. Use commit() or rollback() to finalize.
+         * Starts the thread's current transaction; stage operations on
+         * fossil_io_filesys_tx_current() and finish with tx_commit() or
+         * tx_rollback(). See also the Transaction class.
          *
          * @return 0 on success, negative on failure
          */
@@ -1694,8 +3668,8 @@ namespace fossil::io
         /**
          * @brief Commit a filesystem transaction.
          *
-         * Commits the current transaction, making all changes permanent.
-         * All operations since tx_begin() are applied atomically.
+         * Commits the thread's current transaction, making all changes
+         * permanent. All operations since tx_begin() are applied atomically.
          *
          * @return 0 on success, negative on failure
          */
@@ -1707,8 +3681,8 @@ namespace fossil::io
         /**
          * @brief Rollback a filesystem transaction.
          *
-         * Rolls back the current transaction, undoing all changes made
-         * since tx_begin() was called.
+         * Rolls back the thread's current transaction, discarding all
+         * changes staged since tx_begin() was called.
          *
          * @return 0 on success, negative on failure
          */
@@ -1717,6 +3691,48 @@ namespace fossil::io
             return fossil_io_filesys_tx_rollback();
         }
 
+        /**
+         * @brief Turn on (or reconfigure and empty) the metadata cache.
+         *
+         * @param opts Cache options, or nullptr for defaults
+         * @return 0 on success, negative on failure
+         */
+        int32_t cache_enable(const fossil_io_filesys_cache_opts_t *opts = nullptr)
+        {
+            return fossil_io_filesys_cache_enable(opts);
+        }
+
+        /**
+         * @brief Turn the metadata cache off.
+         */
+        void cache_disable()
+        {
+            fossil_io_filesys_cache_disable();
+        }
+
+        /**
+         * @brief Drop cached answers for a path and everything below it.
+         *
+         * @param path Path to forget
+         * @return Number of entries dropped, or negative on failure
+         */
+        int32_t cache_invalidate(const std::string &path)
+        {
+            return fossil_io_filesys_cache_invalidate(path.c_str());
+        }
+
+        /**
+         * @brief Read the cache hit/miss counters.
+         *
+         * @return Counters accumulated since the cache was last enabled
+         */
+        fossil_io_filesys_cache_stats_t cache_stats()
+        {
+            fossil_io_filesys_cache_stats_t stats;
+            fossil_io_filesys_cache_stats(&stats);
+            return stats;
+        }
+
         /**
          * @brief Get the current working directory.
          *
@@ -1860,6 +3876,880 @@ namespace fossil::io
         {
             return fossil_io_filesys_type_string(type);
         }
+
+        /**
+         * @brief Map a byte range of an open file into memory.
+         *
+         * @param f Pointer to the open file object
+         * @param offset Byte offset of the first mapped byte
+         * @param length Number of bytes to map, or 0 to map through end of file
+         * @param view Pointer to the view to initialize
+         * @return 0 on success, negative error code on failure
+         */
+        int32_t file_map(fossil_io_filesys_file_t *f, uint64_t offset, size_t length, fossil_io_filesys_view_t *view)
+        {
+            return fossil_io_filesys_file_map(f, offset, length, view);
+        }
+
+        /**
+         * @brief Release a mapped view.
+         *
+         * @param view Pointer to the view to release
+         * @return 0 on success, negative error code on failure
+         */
+        int32_t file_unmap(fossil_io_filesys_view_t *view)
+        {
+            return fossil_io_filesys_file_unmap(view);
+        }
+
+        /**
+         * @class MappedView
+         * @brief RAII owner of a read-only mapped byte range.
+         *
+         * The mapping is released when the object goes out of scope. The class
+         * is movable but not copyable, so exactly one instance owns a mapping.
+         */
+        class MappedView
+        {
+        public:
+            MappedView() noexcept : view_{} {}
+
+            /**
+             * @brief Map a range of an open file, optionally applying an access hint.
+             *
+             * @param f Pointer to the open file object
+             * @param offset Byte offset of the first mapped byte
+             * @param length Number of bytes to map, or 0 to map through end of file
+             * @param advice Access pattern hint applied after mapping
+             */
+            MappedView(fossil_io_filesys_file_t *f, uint64_t offset = 0, size_t length = 0,
+                       fossil_io_filesys_advice_t advice = FOSSIL_FILESYS_ADVICE_NORMAL) noexcept
+                : view_{}
+            {
+                valid_ = fossil_io_filesys_file_map(f, offset, length, &view_) == 0;
+                if (valid_ && advice != FOSSIL_FILESYS_ADVICE_NORMAL)
+                    fossil_io_filesys_view_advise(&view_, advice);
+            }
+
+            ~MappedView()
+            {
+                fossil_io_filesys_file_unmap(&view_);
+            }
+
+            MappedView(const MappedView &) = delete;
+            MappedView &operator=(const MappedView &) = delete;
+
+            MappedView(MappedView &&other) noexcept : view_(other.view_), valid_(other.valid_)
+            {
+                other.view_ = fossil_io_filesys_view_t{};
+                other.valid_ = false;
+            }
+
+            MappedView &operator=(MappedView &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    fossil_io_filesys_file_unmap(&view_);
+                    view_ = other.view_;
+                    valid_ = other.valid_;
+                    other.view_ = fossil_io_filesys_view_t{};
+                    other.valid_ = false;
+                }
+                return *this;
+            }
+
+            /**
+             * @brief Change the access pattern hint for the mapped range.
+             *
+             * @param advice Expected access pattern
+             * @return 0 on success, negative error code on failure
+             */
+            int32_t advise(fossil_io_filesys_advice_t advice)
+            {
+                return fossil_io_filesys_view_advise(&view_, advice);
+            }
+
+            const unsigned char *data() const noexcept { return view_.data; }
+            size_t size() const noexcept { return view_.length; }
+            uint64_t offset() const noexcept { return view_.offset; }
+            const unsigned char *begin() const noexcept { return view_.data; }
+            const unsigned char *end() const noexcept { return view_.data + view_.length; }
+
+            /**
+             * @brief Check whether the mapping succeeded (an empty range is still valid).
+             */
+            bool is_valid() const noexcept { return valid_; }
+
+        private:
+            fossil_io_filesys_view_t view_;
+            bool valid_ = false;
+        };
+
+        /**
+         * @class DirSnapshot
+         * @brief RAII owner of a columnar directory snapshot.
+         *
+         * Buffers are kept across refill() calls and released on destruction.
+         * The class is movable but not copyable.
+         */
+        class DirSnapshot
+        {
+        public:
+            DirSnapshot() noexcept : snap_{} {}
+
+            /**
+             * @brief Scan a directory immediately; check is_valid() for the result.
+             *
+             * @param path Path to the directory to scan
+             */
+            explicit DirSnapshot(const std::string &path) noexcept : snap_{}
+            {
+                refill(path);
+            }
+
+            ~DirSnapshot()
+            {
+                fossil_io_filesys_dir_snapshot_free(&snap_);
+            }
+
+            DirSnapshot(const DirSnapshot &) = delete;
+            DirSnapshot &operator=(const DirSnapshot &) = delete;
+
+            DirSnapshot(DirSnapshot &&other) noexcept : snap_(other.snap_), valid_(other.valid_)
+            {
+                other.snap_ = fossil_io_filesys_dir_snapshot_t{};
+                other.valid_ = false;
+            }
+
+            DirSnapshot &operator=(DirSnapshot &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    fossil_io_filesys_dir_snapshot_free(&snap_);
+                    snap_ = other.snap_;
+                    valid_ = other.valid_;
+                    other.snap_ = fossil_io_filesys_dir_snapshot_t{};
+                    other.valid_ = false;
+                }
+                return *this;
+            }
+
+            /**
+             * @brief Rescan a directory, reusing the existing buffers.
+             *
+             * @param path Path to the directory to scan
+             * @return 0 on success, negative on failure
+             */
+            int32_t refill(const std::string &path) noexcept
+            {
+                int32_t rc = fossil_io_filesys_dir_snapshot(path.c_str(), &snap_);
+                valid_ = rc == 0;
+                return rc;
+            }
+
+            size_t size() const noexcept { return snap_.count; }
+            const char *name(size_t i) const noexcept { return fossil_io_filesys_dir_snapshot_name(&snap_, i); }
+            fossil_io_filesys_type_t type(size_t i) const noexcept { return (fossil_io_filesys_type_t)snap_.types[i]; }
+            uint64_t file_size(size_t i) const noexcept { return snap_.sizes[i]; }
+            uint32_t mode(size_t i) const noexcept { return snap_.modes[i]; }
+            time_t mtime(size_t i) const noexcept { return snap_.mtimes[i]; }
+            const fossil_io_filesys_dir_snapshot_t *raw() const noexcept { return &snap_; }
+
+            /**
+             * @brief Check whether the last scan succeeded.
+             */
+            bool is_valid() const noexcept { return valid_; }
+
+        private:
+            fossil_io_filesys_dir_snapshot_t snap_;
+            bool valid_ = false;
+        };
+
+        /**
+         * @class AsyncEngine
+         * @brief RAII wrapper around an asynchronous I/O engine that hands out futures.
+         *
+         * Each queueing call returns a std::future holding the request's result
+         * (bytes, descriptor, 0, or a negated errno). Futures are fulfilled by
+         * poll(), wait() or drain() on the owning thread, so do not block on a
+         * future before one of those has collected it. Destruction drains all
+         * outstanding requests. The class is movable but not copyable.
+         */
+        class AsyncEngine
+        {
+        public:
+            /**
+             * @brief Create an engine; check is_valid() for the result.
+             *
+             * @param opts Engine options, or NULL for defaults
+             */
+            explicit AsyncEngine(const fossil_io_filesys_aio_opts_t *opts = nullptr)
+                : aio_(fossil_io_filesys_aio_create(opts)) {}
+
+            ~AsyncEngine()
+            {
+                if (aio_)
+                {
+                    drain();
+                    fossil_io_filesys_aio_destroy(aio_);
+                }
+            }
+
+            AsyncEngine(const AsyncEngine &) = delete;
+            AsyncEngine &operator=(const AsyncEngine &) = delete;
+
+            AsyncEngine(AsyncEngine &&other) noexcept
+                : aio_(other.aio_), next_id_(other.next_id_), pending_(std::move(other.pending_))
+            {
+                other.aio_ = nullptr;
+            }
+
+            AsyncEngine &operator=(AsyncEngine &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    if (aio_)
+                    {
+                        drain();
+                        fossil_io_filesys_aio_destroy(aio_);
+                    }
+                    aio_ = other.aio_;
+                    next_id_ = other.next_id_;
+                    pending_ = std::move(other.pending_);
+                    other.aio_ = nullptr;
+                }
+                return *this;
+            }
+
+            std::future<int64_t> read(int fd, void *buf, size_t len, uint64_t offset)
+            {
+                return enqueue(fossil_io_filesys_aio_read(aio_, fd, buf, len, offset, next_id_));
+            }
+
+            std::future<int64_t> write(int fd, const void *buf, size_t len, uint64_t offset)
+            {
+                return enqueue(fossil_io_filesys_aio_write(aio_, fd, buf, len, offset, next_id_));
+            }
+
+            std::future<int64_t> fsync(int fd, bool datasync = false)
+            {
+                return enqueue(fossil_io_filesys_aio_fsync(aio_, fd, datasync, next_id_));
+            }
+
+            /**
+             * @brief Queue an open; path must outlive the request.
+             */
+            std::future<int64_t> openat(int dirfd, const char *path, int flags, uint32_t mode = 0644)
+            {
+                return enqueue(fossil_io_filesys_aio_openat(aio_, dirfd, path, flags, mode, next_id_));
+            }
+
+            /**
+             * @brief Queue a metadata lookup; path and out must outlive the request.
+             */
+            std::future<int64_t> statx(int dirfd, const char *path, fossil_io_filesys_aio_stat_t *out, bool follow_links = true)
+            {
+                return enqueue(fossil_io_filesys_aio_statx(aio_, dirfd, path, follow_links, out, next_id_));
+            }
+
+            std::future<int64_t> close(int fd)
+            {
+                return enqueue(fossil_io_filesys_aio_close(aio_, fd, next_id_));
+            }
+
+            /**
+             * @brief Start every queued request.
+             *
+             * @return Number of requests started, or -1 on failure
+             */
+            int32_t submit()
+            {
+                return fossil_io_filesys_aio_submit(aio_);
+            }
+
+            /**
+             * @brief Fulfil the futures of requests that have already finished.
+             *
+             * @return Number of futures fulfilled
+             */
+            size_t poll()
+            {
+                return collect(0);
+            }
+
+            /**
+             * @brief Block until at least min_count requests finish and fulfil their futures.
+             *
+             * @return Number of futures fulfilled
+             */
+            size_t wait(size_t min_count = 1)
+            {
+                return collect(min_count);
+            }
+
+            /**
+             * @brief Submit anything queued and wait until every future is fulfilled.
+             */
+            void drain()
+            {
+                submit();
+                while (fossil_io_filesys_aio_inflight(aio_) > 0)
+                {
+                    if (collect(1) == 0)
+                        break;
+                }
+            }
+
+            size_t in_flight() const noexcept { return fossil_io_filesys_aio_inflight(aio_); }
+            fossil_io_filesys_aio_backend_t backend() const noexcept { return fossil_io_filesys_aio_backend(aio_); }
+            fossil_io_filesys_aio_t *raw() const noexcept { return aio_; }
+
+            /**
+             * @brief Check whether the engine was created.
+             */
+            bool is_valid() const noexcept { return aio_ != nullptr; }
+
+        private:
+            std::future<int64_t> enqueue(int32_t rc)
+            {
+                std::promise<int64_t> promise;
+                std::future<int64_t> future = promise.get_future();
+                if (rc == 0)
+                    pending_.emplace(next_id_++, std::move(promise));
+                else
+                    promise.set_value(-EAGAIN);
+                return future;
+            }
+
+            size_t collect(size_t min_count)
+            {
+                fossil_io_filesys_aio_completion_t done[64];
+                size_t total = 0;
+                for (;;)
+                {
+                    size_t want = (min_count > total) ? min_count - total : 0;
+                    if (want > 64)
+                        want = 64;
+                    int32_t n = fossil_io_filesys_aio_wait(aio_, done, 64, want);
+                    if (n <= 0)
+                        break;
+                    for (int32_t i = 0; i < n; ++i)
+                    {
+                        auto it = pending_.find(done[i].user_data);
+                        if (it != pending_.end())
+                        {
+                            it->second.set_value(done[i].result);
+                            pending_.erase(it);
+                        }
+                    }
+                    total += (size_t)n;
+                    if (n < 64 && total >= min_count)
+                        break;
+                }
+                return total;
+            }
+
+            fossil_io_filesys_aio_t *aio_ = nullptr;
+            uint64_t next_id_ = 0;
+            std::unordered_map<uint64_t, std::promise<int64_t>> pending_;
+        };
+
+        /**
+         * @class Transaction
+         * @brief RAII journaled filesystem transaction.
+         *
+         * Stage operations, then call commit(); a transaction destroyed
+         * without commit() is rolled back. Movable, not copyable.
+         */
+        class Transaction
+        {
+        public:
+            /**
+             * @brief Open a transaction; check is_valid() for the result.
+             *
+             * @param journal_dir Journal directory, or nullptr for the system temp directory
+             */
+            explicit Transaction(const char *journal_dir = nullptr)
+                : tx_(fossil_io_filesys_tx_open(journal_dir)) {}
+
+            ~Transaction()
+            {
+                if (tx_)
+                    fossil_io_filesys_tx_end(tx_, false);
+            }
+
+            Transaction(const Transaction &) = delete;
+            Transaction &operator=(const Transaction &) = delete;
+
+            Transaction(Transaction &&other) noexcept : tx_(other.tx_) { other.tx_ = nullptr; }
+
+            Transaction &operator=(Transaction &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    if (tx_)
+                        fossil_io_filesys_tx_end(tx_, false);
+                    tx_ = other.tx_;
+                    other.tx_ = nullptr;
+                }
+                return *this;
+            }
+
+            bool is_valid() const noexcept { return tx_ != nullptr; }
+
+            int32_t write(const std::string &path, const void *data, size_t len)
+            {
+                return fossil_io_filesys_tx_write(tx_, path.c_str(), data, len);
+            }
+
+            int32_t write(const std::string &path, const std::string &data)
+            {
+                return fossil_io_filesys_tx_write(tx_, path.c_str(), data.data(), data.size());
+            }
+
+            int32_t copy(const std::string &src, const std::string &dest)
+            {
+                return fossil_io_filesys_tx_copy(tx_, src.c_str(), dest.c_str());
+            }
+
+            int32_t move(const std::string &src, const std::string &dest)
+            {
+                return fossil_io_filesys_tx_move(tx_, src.c_str(), dest.c_str());
+            }
+
+            int32_t remove(const std::string &path)
+            {
+                return fossil_io_filesys_tx_remove(tx_, path.c_str());
+            }
+
+            /**
+             * @brief Commit and release the transaction.
+             *
+             * @return 0 on success, negative if the commit failed (and was rolled back)
+             */
+            int32_t commit()
+            {
+                fossil_io_filesys_tx_t *tx = tx_;
+                tx_ = nullptr;
+                return fossil_io_filesys_tx_end(tx, true);
+            }
+
+            /**
+             * @brief Roll back and release the transaction.
+             */
+            int32_t rollback()
+            {
+                fossil_io_filesys_tx_t *tx = tx_;
+                tx_ = nullptr;
+                return fossil_io_filesys_tx_end(tx, false);
+            }
+
+        private:
+            fossil_io_filesys_tx_t *tx_ = nullptr;
+        };
+
+        /**
+         * @class DirHandle
+         * @brief RAII directory handle for directory-relative operations.
+         *
+         * Wraps fossil_io_filesys_dirhandle_*. Movable, not copyable.
+         */
+        class DirHandle
+        {
+        public:
+            /**
+             * @brief Open a directory; check is_valid() for the result.
+             */
+            explicit DirHandle(const std::string &path)
+                : dir_(fossil_io_filesys_dirhandle_open(path.c_str())) {}
+
+            ~DirHandle() { fossil_io_filesys_dirhandle_close(dir_); }
+
+            DirHandle(const DirHandle &) = delete;
+            DirHandle &operator=(const DirHandle &) = delete;
+
+            DirHandle(DirHandle &&other) noexcept : dir_(other.dir_) { other.dir_ = nullptr; }
+
+            DirHandle &operator=(DirHandle &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    fossil_io_filesys_dirhandle_close(dir_);
+                    dir_ = other.dir_;
+                    other.dir_ = nullptr;
+                }
+                return *this;
+            }
+
+            bool is_valid() const noexcept { return dir_ != nullptr; }
+            fossil_io_filesys_dirhandle_t *get() const noexcept { return dir_; }
+            int fd() const noexcept { return fossil_io_filesys_dirhandle_fd(dir_); }
+
+            std::string path() const
+            {
+                const char *p = fossil_io_filesys_dirhandle_path(dir_);
+                return p ? std::string(p) : std::string();
+            }
+
+            /**
+             * @brief Open a subdirectory without following a final symbolic link.
+             */
+            DirHandle open_dir(const std::string &name) const
+            {
+                return DirHandle(fossil_io_filesys_dirhandle_open_dir(dir_, name.c_str()));
+            }
+
+            /**
+             * @brief Names and types of the remaining entries, "." and ".." excluded.
+             */
+            std::vector<std::pair<std::string, fossil_io_filesys_type_t>> entries()
+            {
+                std::vector<std::pair<std::string, fossil_io_filesys_type_t>> out;
+                fossil_io_filesys_dirent_t entry;
+                while (fossil_io_filesys_dirhandle_read(dir_, &entry) > 0)
+                    out.emplace_back(entry.name, entry.type);
+                return out;
+            }
+
+            int32_t open_file(fossil_io_filesys_file_t *f, const std::string &name, const std::string &mode) const
+            {
+                return fossil_io_filesys_dirhandle_open_file(dir_, f, name.c_str(), mode.c_str());
+            }
+
+            int32_t stat(const std::string &name, fossil_io_filesys_obj_t *obj, bool follow = false) const
+            {
+                return fossil_io_filesys_dirhandle_stat(dir_, name.c_str(), obj, follow);
+            }
+
+            int32_t unlink(const std::string &name, bool is_dir = false) const
+            {
+                return fossil_io_filesys_dirhandle_unlink(dir_, name.c_str(), is_dir);
+            }
+
+            int32_t mkdir(const std::string &name, uint32_t mode = 0755) const
+            {
+                return fossil_io_filesys_dirhandle_mkdir(dir_, name.c_str(), mode);
+            }
+
+            int32_t rename(const std::string &name, const DirHandle &dest, const std::string &dest_name,
+                           uint32_t flags = 0) const
+            {
+                return fossil_io_filesys_dirhandle_rename(dir_, name.c_str(), dest.dir_, dest_name.c_str(), flags);
+            }
+
+            /**
+             * @brief A symbolic link's target, or an empty string on failure.
+             */
+            std::string readlink(const std::string &name) const
+            {
+                char target[FOSSIL_FILESYS_MAX_PATH];
+                int32_t n = fossil_io_filesys_dirhandle_readlink(dir_, name.c_str(), target, sizeof(target));
+                return n >= 0 ? std::string(target, (size_t)n) : std::string();
+            }
+
+        private:
+            explicit DirHandle(fossil_io_filesys_dirhandle_t *dir) noexcept : dir_(dir) {}
+
+            fossil_io_filesys_dirhandle_t *dir_ = nullptr;
+        };
+
+        /**
+         * @class Watcher
+         * @brief RAII filesystem change watcher.
+         *
+         * Wraps fossil_io_filesys_watch_*; events are read from one thread
+         * at a time. Movable, not copyable.
+         */
+        class Watcher
+        {
+        public:
+            /**
+             * @brief Start a watcher; check is_valid() for the result.
+             *
+             * @param opts Watcher options, or nullptr for defaults
+             */
+            explicit Watcher(const fossil_io_filesys_watch_opts_t *opts = nullptr)
+                : watch_(fossil_io_filesys_watch_open(opts)) {}
+
+            ~Watcher() { fossil_io_filesys_watch_close(watch_); }
+
+            Watcher(const Watcher &) = delete;
+            Watcher &operator=(const Watcher &) = delete;
+
+            Watcher(Watcher &&other) noexcept : watch_(other.watch_) { other.watch_ = nullptr; }
+
+            Watcher &operator=(Watcher &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    fossil_io_filesys_watch_close(watch_);
+                    watch_ = other.watch_;
+                    other.watch_ = nullptr;
+                }
+                return *this;
+            }
+
+            bool is_valid() const noexcept { return watch_ != nullptr; }
+
+            int32_t add(const std::string &path, bool recursive = true)
+            {
+                return fossil_io_filesys_watch_add(watch_, path.c_str(), recursive);
+            }
+
+            int32_t remove(const std::string &path)
+            {
+                return fossil_io_filesys_watch_remove(watch_, path.c_str());
+            }
+
+            /**
+             * @brief Descriptor for an external poll loop, or -1 where none exists.
+             */
+            int fd() const noexcept { return fossil_io_filesys_watch_fd(watch_); }
+
+            /**
+             * @brief Take up to max waiting events without blocking.
+             */
+            std::vector<fossil_io_filesys_watch_event_t> read(size_t max = 64)
+            {
+                std::vector<fossil_io_filesys_watch_event_t> events(max);
+                int32_t n = fossil_io_filesys_watch_read(watch_, events.data(), max);
+                events.resize(n > 0 ? (size_t)n : 0);
+                return events;
+            }
+
+            /**
+             * @brief Wait up to timeout_ms (-1 = indefinitely) for events, then take them.
+             */
+            std::vector<fossil_io_filesys_watch_event_t> wait(int32_t timeout_ms = -1, size_t max = 64)
+            {
+                std::vector<fossil_io_filesys_watch_event_t> events(max);
+                int32_t n = fossil_io_filesys_watch_wait(watch_, events.data(), max, timeout_ms);
+                events.resize(n > 0 ? (size_t)n : 0);
+                return events;
+            }
+
+        private:
+            fossil_io_filesys_watch_t *watch_ = nullptr;
+        };
+
+        /**
+         * @class PathView
+         * @brief Non-owning path slice over std::string_view.
+         *
+         * Mirrors fossil_io_filesys_pathview_*: root, parent, filename, stem,
+         * extension and component iteration are constexpr and never allocate.
+         * join() and normalize() go through the C implementation.
+         */
+        class PathView
+        {
+        public:
+            /**
+             * @brief Forward iterator over components; the root comes first.
+             */
+            class iterator
+            {
+            public:
+                using value_type = std::string_view;
+                using difference_type = std::ptrdiff_t;
+
+                constexpr iterator() noexcept = default;
+                constexpr iterator(std::string_view path, size_t pos) noexcept : path_(path), pos_(pos) { step(); }
+
+                constexpr std::string_view operator*() const noexcept { return path_.substr(begin_, pos_ - begin_); }
+                constexpr iterator &operator++() noexcept
+                {
+                    step();
+                    return *this;
+                }
+                constexpr iterator operator++(int) noexcept
+                {
+                    iterator old = *this;
+                    step();
+                    return old;
+                }
+                constexpr bool operator==(const iterator &other) const noexcept { return begin_ == other.begin_; }
+
+            private:
+                constexpr void step() noexcept
+                {
+                    if (begin_ == npos_ && pos_ == 0)
+                    {
+                        size_t root = root_length(path_);
+                        if (root > 0)
+                        {
+                            begin_ = 0;
+                            pos_ = root;
+                            return;
+                        }
+                    }
+                    while (pos_ < path_.size() && is_separator(path_[pos_]))
+                        ++pos_;
+                    if (pos_ >= path_.size())
+                    {
+                        begin_ = pos_ = path_.size() + 1;
+                        return;
+                    }
+                    begin_ = pos_;
+                    while (pos_ < path_.size() && !is_separator(path_[pos_]))
+                        ++pos_;
+                }
+
+                static constexpr size_t npos_ = static_cast<size_t>(-1);
+                std::string_view path_;
+                size_t pos_ = 0;
+                size_t begin_ = npos_;
+            };
+
+            constexpr PathView() noexcept = default;
+            constexpr PathView(std::string_view path) noexcept : path_(path) {}
+            constexpr PathView(const char *path) noexcept : path_(path ? std::string_view(path) : std::string_view()) {}
+            PathView(const std::string &path) noexcept : path_(path) {}
+
+            /**
+             * @brief True for '/' and, on Windows, '\\'.
+             */
+            static constexpr bool is_separator(char c) noexcept
+            {
+#if defined(_WIN32)
+                return c == '/' || c == '\\';
+#else
+                return c == '/';
+#endif
+            }
+
+            constexpr std::string_view str() const noexcept { return path_; }
+            constexpr bool empty() const noexcept { return path_.empty(); }
+
+            /**
+             * @brief Leading separators plus, on Windows, a drive letter; empty for relative paths.
+             */
+            constexpr std::string_view root() const noexcept { return path_.substr(0, root_length(path_)); }
+            constexpr bool has_root() const noexcept { return root_length(path_) > 0; }
+
+            /**
+             * @brief The path without its last component; empty once nothing but a root or one name is left.
+             */
+            constexpr PathView parent() const noexcept
+            {
+                size_t root = root_length(path_);
+                size_t end = trimmed(root);
+                size_t start = last(root, end);
+                if (start == end)
+                    return PathView(path_.substr(0, 0));
+                while (start > root && is_separator(path_[start - 1]))
+                    --start;
+                return PathView(path_.substr(0, start));
+            }
+
+            /**
+             * @brief The last component, ignoring trailing separators.
+             */
+            constexpr std::string_view filename() const noexcept
+            {
+                size_t root = root_length(path_);
+                size_t end = trimmed(root);
+                size_t start = last(root, end);
+                return path_.substr(start, end - start);
+            }
+
+            /**
+             * @brief The last component's extension including its dot; empty for dotfiles, "." and "..".
+             */
+            constexpr std::string_view extension() const noexcept
+            {
+                std::string_view name = filename();
+                if (name == "." || name == "..")
+                    return name.substr(name.size());
+                size_t dot = name.rfind('.');
+                if (dot == std::string_view::npos || dot == 0)
+                    return name.substr(name.size());
+                return name.substr(dot);
+            }
+
+            /**
+             * @brief The last component without its extension.
+             */
+            constexpr std::string_view stem() const noexcept
+            {
+                std::string_view name = filename();
+                return name.substr(0, name.size() - extension().size());
+            }
+
+            constexpr iterator begin() const noexcept { return iterator(path_, 0); }
+            constexpr iterator end() const noexcept { return iterator(path_, path_.size()); }
+
+            /**
+             * @brief Join tail onto this path into a caller buffer; see fossil_io_filesys_pathview_join().
+             * @return Length written, or -1 if it does not fit
+             */
+            int32_t join(PathView tail, char *out, size_t max_len) const noexcept
+            {
+                return fossil_io_filesys_pathview_join(*this, tail, out, max_len);
+            }
+
+            std::string join(PathView tail) const
+            {
+                std::string out(path_.size() + tail.path_.size() + 1, '\0');
+                int32_t n = join(tail, out.data(), out.size() + 1);
+                out.resize(n > 0 ? (size_t)n : 0);
+                return out;
+            }
+
+            /**
+             * @brief Lexically normalize into a caller buffer; see fossil_io_filesys_pathview_normalize().
+             * @return Length written, or -1 if it does not fit
+             */
+            int32_t normalize(char *out, size_t max_len) const noexcept
+            {
+                return fossil_io_filesys_pathview_normalize(*this, out, max_len);
+            }
+
+            std::string normalize() const
+            {
+                std::string out(path_.size() + 1, '\0');
+                int32_t n = normalize(out.data(), out.size() + 1);
+                out.resize(n > 0 ? (size_t)n : 0);
+                return out;
+            }
+
+            operator fossil_io_filesys_pathview_t() const noexcept
+            {
+                return fossil_io_filesys_pathview_n(path_.data(), path_.size());
+            }
+
+            constexpr bool operator==(const PathView &other) const noexcept { return path_ == other.path_; }
+
+        private:
+            static constexpr size_t root_length(std::string_view path) noexcept
+            {
+                size_t n = 0;
+#if defined(_WIN32)
+                if (path.size() >= 2 && path[1] == ':' && (path[0] | 0x20) >= 'a' && (path[0] | 0x20) <= 'z')
+                    n = 2;
+#endif
+                while (n < path.size() && is_separator(path[n]))
+                    ++n;
+                return n;
+            }
+
+            constexpr size_t trimmed(size_t root) const noexcept
+            {
+                size_t end = path_.size();
+                while (end > root && is_separator(path_[end - 1]))
+                    --end;
+                return end;
+            }
+
+            constexpr size_t last(size_t root, size_t end) const noexcept
+            {
+                size_t start = end;
+                while (start > root && !is_separator(path_[start - 1]))
+                    --start;
+                return start;
+            }
+
+            std::string_view path_;
+        };
     };
 
 } // namespace fossil
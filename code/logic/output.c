@@ -962,9 +962,14 @@ void fossil_io_draw_horizontal_line(int length, char ch)
 {
     if (!FOSSIL_IO_OUTPUT_ENABLE)
         return;
-    for (int i = 0; i < length; ++i)
+    // Emit the line in chunks rather than one write per character
+    char line[256];
+    memset(line, ch, sizeof(line));
+    for (int remaining = length; remaining > 0;)
     {
-        fossil_io_filesys_file_write(FOSSIL_STDOUT, &ch, 1, 1);
+        size_t n = (remaining < (int)sizeof(line)) ? (size_t)remaining : sizeof(line);
+        fossil_io_filesys_file_write(FOSSIL_STDOUT, line, 1, n);
+        remaining -= (int)n;
     }
     fossil_io_filesys_file_write(FOSSIL_STDOUT, "\n", 1, 1);
 }
@@ -973,10 +978,10 @@ void fossil_io_draw_vertical_line(int length, char ch)
 {
     if (!FOSSIL_IO_OUTPUT_ENABLE)
         return;
+    const char cell[2] = {ch, '\n'};
     for (int i = 0; i < length; ++i)
     {
-        fossil_io_filesys_file_write(FOSSIL_STDOUT, &ch, 1, 1);
-        fossil_io_filesys_file_write(FOSSIL_STDOUT, "\n", 1, 1);
+        fossil_io_filesys_file_write(FOSSIL_STDOUT, cell, 1, sizeof(cell));
     }
 }
 
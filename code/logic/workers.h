@@ -0,0 +1,45 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_IO_WORKERS_H
+#define FOSSIL_IO_WORKERS_H
+
+/*
+ * Worker threads shared by the library's parallel paths (filesys, archive).
+ * Private to the library: not part of the public fossil/io headers.
+ */
+
+#include <stddef.h>
+
+/* Number of online processors, at least 1. */
+size_t fossil_cpu_count(void);
+
+/*
+ * Run fn on `count` workers and wait for all of them. The calling thread is
+ * worker 0. If a thread cannot be spawned the job simply runs on fewer
+ * workers, so fn must not assume every index is alive.
+ */
+void fossil_run_workers(size_t count, void (*fn)(void *arg, size_t index), void *arg);
+
+#endif /* FOSSIL_IO_WORKERS_H */
@@ -184,6 +184,378 @@ FOSSIL_TEST(c_test_archive_compression_levels)
     fossil_io_archive_close(archive);
 }
 
+FOSSIL_TEST(c_test_archive_tar_round_trip)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *src = "C:\\temp\\fossil_tar_src.txt";
+    const char *tar_path = "C:\\temp\\fossil_round_trip.tar";
+    const char *out = "C:\\temp\\fossil_tar_out.txt";
+#else
+    const char *src = "/tmp/fossil_tar_src.txt";
+    const char *tar_path = "/tmp/fossil_round_trip.tar";
+    const char *out = "/tmp/fossil_tar_out.txt";
+#endif
+    const char *content = "tar payload that spans no more than one block";
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs(content, fp);
+    fclose(fp);
+
+    fossil_io_archive_t *archive = fossil_io_archive_create(tar_path, FOSSIL_IO_ARCHIVE_TAR, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_NOT_CNULL(archive);
+    ASSUME_ITS_TRUE(fossil_io_archive_add_file(archive, src, "dir/payload.txt"));
+    ASSUME_ITS_TRUE(fossil_io_archive_add_file(archive, src, "doomed.txt"));
+    fossil_io_archive_close(archive);
+
+    archive = fossil_io_archive_open(tar_path, FOSSIL_IO_ARCHIVE_TAR, FOSSIL_IO_ARCHIVE_APPEND, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_NOT_CNULL(archive);
+    ASSUME_ITS_TRUE(fossil_io_archive_remove(archive, "doomed.txt"));
+    fossil_io_archive_close(archive);
+
+    archive = fossil_io_archive_open(tar_path, FOSSIL_IO_ARCHIVE_TAR, FOSSIL_IO_ARCHIVE_READ, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_NOT_CNULL(archive);
+    ASSUME_ITS_EQUAL_I32((int32_t)strlen(content), (int32_t)fossil_io_archive_entry_size(archive, "dir/payload.txt"));
+    ASSUME_ITS_FALSE(fossil_io_archive_exists(archive, "doomed.txt"));
+    ASSUME_ITS_TRUE(fossil_io_archive_extract_file(archive, "dir/payload.txt", out));
+    fossil_io_archive_close(archive);
+
+    char buffer[128] = {0};
+    fp = fopen(out, "rb");
+    ASSUME_NOT_CNULL(fp);
+    size_t got = fread(buffer, 1, sizeof(buffer) - 1, fp);
+    fclose(fp);
+    ASSUME_ITS_EQUAL_SIZE(strlen(content), got);
+    ASSUME_ITS_TRUE(strcmp(buffer, content) == 0);
+
+    remove(src);
+    remove(out);
+    remove(tar_path);
+}
+
+FOSSIL_TEST(c_test_archive_entries_view_indexed)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *src = "C:\\temp\\fossil_view_src.txt";
+#else
+    const char *src = "/tmp/fossil_view_src.txt";
+#endif
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("view", fp);
+    fclose(fp);
+
+    fossil_io_archive_t *archive = fossil_io_archive_open("", FOSSIL_IO_ARCHIVE_ZIP, FOSSIL_IO_ARCHIVE_WRITE, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_NOT_CNULL(archive);
+
+    char name[32];
+    for (int i = 0; i < 2000; i++)
+    {
+        snprintf(name, sizeof(name), "entry_%d", i);
+        ASSUME_ITS_TRUE(fossil_io_archive_add_file(archive, src, name));
+    }
+    // Re-adding a name refreshes the entry rather than duplicating it
+    ASSUME_ITS_TRUE(fossil_io_archive_add_file(archive, src, "entry_5"));
+    ASSUME_ITS_TRUE(fossil_io_archive_remove(archive, "entry_10"));
+    ASSUME_ITS_FALSE(fossil_io_archive_remove(archive, "entry_10"));
+
+    const fossil_io_archive_entry_t *view = NULL;
+    ASSUME_ITS_EQUAL_I32(1999, (int32_t)fossil_io_archive_entries(archive, &view));
+    ASSUME_NOT_CNULL(view);
+    ASSUME_ITS_TRUE(strcmp(view[10].name, "entry_11") == 0);
+    ASSUME_ITS_TRUE(fossil_io_archive_exists(archive, "entry_1999"));
+    ASSUME_ITS_FALSE(fossil_io_archive_exists(archive, "entry_10"));
+    ASSUME_ITS_EQUAL_I32(4, (int32_t)fossil_io_archive_entry_size(archive, "entry_5"));
+    // Every other name is still reachable through the index after the removal
+    for (int i = 0; i < 2000; i++)
+    {
+        snprintf(name, sizeof(name), "entry_%d", i);
+        ASSUME_ITS_TRUE(fossil_io_archive_exists(archive, name) == (i != 10));
+    }
+
+    fossil_io_archive_entry_t *copy = NULL;
+    ASSUME_ITS_EQUAL_I32(1999, (int32_t)fossil_io_archive_list(archive, &copy));
+    ASSUME_ITS_TRUE(strcmp(copy[1998].name, view[1998].name) == 0);
+    fossil_io_archive_free_entries(copy, 1999);
+
+    fossil_io_archive_close(archive);
+    remove(src);
+}
+
+FOSSIL_TEST(c_test_archive_extract_all_parallel)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *src = "C:\\temp\\fossil_par_src.txt";
+    const char *tar_path = "C:\\temp\\fossil_par.tar";
+    const char *dest = "C:\\temp\\fossil_par_out";
+    const char *probe = "C:\\temp\\fossil_par_out\\d7\\sub\\file_47.txt";
+#else
+    const char *src = "/tmp/fossil_par_src.txt";
+    const char *tar_path = "/tmp/fossil_par.tar";
+    const char *dest = "/tmp/fossil_par_out";
+    const char *probe = "/tmp/fossil_par_out/d7/sub/file_47.txt";
+#endif
+    const char *content = "parallel extraction payload";
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs(content, fp);
+    fclose(fp);
+
+    fossil_io_archive_t *archive = fossil_io_archive_create(tar_path, FOSSIL_IO_ARCHIVE_TAR, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_NOT_CNULL(archive);
+    char name[64];
+    for (int i = 0; i < 64; i++)
+    {
+        snprintf(name, sizeof(name), "d%d/sub/file_%d.txt", i % 8, i);
+        ASSUME_ITS_TRUE(fossil_io_archive_add_file(archive, src, name));
+    }
+    fossil_io_archive_close(archive);
+
+    archive = fossil_io_archive_open(tar_path, FOSSIL_IO_ARCHIVE_TAR, FOSSIL_IO_ARCHIVE_READ, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_NOT_CNULL(archive);
+    ASSUME_ITS_TRUE(fossil_io_archive_extract_all_parallel(archive, dest, 4));
+    fossil_io_archive_close(archive);
+
+    char buffer[64] = {0};
+    fp = fopen(probe, "rb");
+    ASSUME_NOT_CNULL(fp);
+    size_t got = fread(buffer, 1, sizeof(buffer) - 1, fp);
+    fclose(fp);
+    ASSUME_ITS_EQUAL_SIZE(strlen(content), got);
+    ASSUME_ITS_TRUE(strcmp(buffer, content) == 0);
+
+    remove(src);
+    remove(tar_path);
+}
+
+FOSSIL_TEST(c_test_archive_zip_deflate_round_trip)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *src = "C:\\temp\\fossil_zip_src.txt";
+    const char *zip_path = "C:\\temp\\fossil_deflate.zip";
+    const char *out = "C:\\temp\\fossil_zip_out.txt";
+#else
+    const char *src = "/tmp/fossil_zip_src.txt";
+    const char *zip_path = "/tmp/fossil_deflate.zip";
+    const char *out = "/tmp/fossil_zip_out.txt";
+#endif
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    for (int i = 0; i < 4096; i++)
+        fprintf(fp, "line %d of a very repetitive zip payload\n", i % 97);
+    fclose(fp);
+    size_t src_size = (size_t)fossil_io_filesys_file_size(src);
+
+    fossil_io_archive_t *archive = fossil_io_archive_create(zip_path, FOSSIL_IO_ARCHIVE_ZIP, FOSSIL_IO_COMPRESSION_NORMAL);
+    ASSUME_NOT_CNULL(archive);
+    ASSUME_ITS_TRUE(fossil_io_archive_add_file(archive, src, "docs/payload.txt"));
+    fossil_io_archive_close(archive);
+
+    archive = fossil_io_archive_open(zip_path, FOSSIL_IO_ARCHIVE_ZIP, FOSSIL_IO_ARCHIVE_READ, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_NOT_CNULL(archive);
+    const fossil_io_archive_entry_t *entries = NULL;
+    ASSUME_ITS_EQUAL_I32(1, (int32_t)fossil_io_archive_entries(archive, &entries));
+    ASSUME_ITS_TRUE(strcmp(entries[0].name, "docs/payload.txt") == 0);
+    ASSUME_ITS_EQUAL_SIZE(src_size, entries[0].size);
+    ASSUME_ITS_TRUE(entries[0].compressed_size < entries[0].size);
+    ASSUME_ITS_TRUE(fossil_io_archive_extract_file(archive, "docs/payload.txt", out));
+    fossil_io_archive_close(archive);
+
+    ASSUME_ITS_EQUAL_SIZE(src_size, (size_t)fossil_io_filesys_file_size(out));
+    FILE *a = fopen(src, "rb");
+    FILE *b = fopen(out, "rb");
+    ASSUME_NOT_CNULL(a);
+    ASSUME_NOT_CNULL(b);
+    int ca, cb;
+    do
+    {
+        ca = fgetc(a);
+        cb = fgetc(b);
+    } while (ca == cb && ca != EOF);
+    fclose(a);
+    fclose(b);
+    ASSUME_ITS_EQUAL_I32(ca, cb);
+
+    remove(src);
+    remove(out);
+    remove(zip_path);
+}
+
+static unsigned char *c_zip_le(unsigned char *p, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        *p++ = (unsigned char)(v >> (8 * i));
+    return p;
+}
+
+// End of central directory: one entry, the given central directory size and offset.
+static unsigned char *c_zip_eocd(unsigned char *p, uint32_t cd_size, uint32_t cd_offset)
+{
+    p = c_zip_le(p, 0x06054b50, 4);
+    p = c_zip_le(p, 0, 4);
+    p = c_zip_le(p, 1, 2);
+    p = c_zip_le(p, 1, 2);
+    p = c_zip_le(p, cd_size, 4);
+    p = c_zip_le(p, cd_offset, 4);
+    return c_zip_le(p, 0, 2);
+}
+
+static unsigned char *c_zip64_locator(unsigned char *p, uint64_t z64)
+{
+    p = c_zip_le(p, 0x07064b50, 4);
+    p = c_zip_le(p, 0, 4);
+    p = c_zip_le(p, z64, 8);
+    return c_zip_le(p, 1, 4);
+}
+
+static bool c_zip_write(const char *path, const unsigned char *data, size_t len)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(data, 1, len, fp) == len;
+    return (fclose(fp) == 0) && ok;
+}
+
+FOSSIL_TEST(c_test_archive_zip64_malformed)
+{
+#ifdef _WIN32
+    const char *zip_path = "C:\\temp\\fossil_malformed.zip";
+    const char *out = "C:\\temp\\fossil_malformed.out";
+#else
+    const char *zip_path = "/tmp/fossil_malformed.zip";
+    const char *out = "/tmp/fossil_malformed.out";
+#endif
+    unsigned char buf[256];
+    unsigned char *p;
+
+    // ZIP64 locator pointing just short of 2^64.
+    memset(buf, 0, sizeof(buf));
+    p = c_zip64_locator(buf, 0xFFFFFFFFFFFFFFF0ull);
+    p = c_zip_eocd(p, 0, 0);
+    ASSUME_ITS_EQUAL_SIZE((size_t)(p - buf), 42);
+    ASSUME_ITS_TRUE(c_zip_write(zip_path, buf, (size_t)(p - buf)));
+    ASSUME_ITS_TRUE(fossil_io_archive_open(zip_path, FOSSIL_IO_ARCHIVE_ZIP, FOSSIL_IO_ARCHIVE_READ, FOSSIL_IO_COMPRESSION_NONE) == NULL);
+
+    // ZIP64 end record whose central directory offset + size wraps around.
+    memset(buf, 0, sizeof(buf));
+    p = buf + 16;
+    p = c_zip_le(p, 0x06064b50, 4);
+    p = c_zip_le(p, 44, 8);
+    p = c_zip_le(p, 45, 2);
+    p = c_zip_le(p, 45, 2);
+    p = c_zip_le(p, 0, 8);
+    p = c_zip_le(p, 1, 8);
+    p = c_zip_le(p, 1, 8);
+    p = c_zip_le(p, 16, 8);
+    p = c_zip_le(p, 0xFFFFFFFFFFFFFFF0ull, 8);
+    p = c_zip64_locator(p, 16);
+    p = c_zip_eocd(p, 0xFFFFFFFFu, 0xFFFFFFFFu);
+    ASSUME_ITS_TRUE(c_zip_write(zip_path, buf, (size_t)(p - buf)));
+    ASSUME_ITS_TRUE(fossil_io_archive_open(zip_path, FOSSIL_IO_ARCHIVE_ZIP, FOSSIL_IO_ARCHIVE_READ, FOSSIL_IO_COMPRESSION_NONE) == NULL);
+
+    // A central entry whose ZIP64 extra field puts its local header past the end.
+    memset(buf, 0, sizeof(buf));
+    p = buf + 8; // prepended data, so offsets are rebased
+    p = c_zip_le(p, 0x02014b50, 4);
+    p = c_zip_le(p, 45, 2);
+    p = c_zip_le(p, 45, 2);
+    p = c_zip_le(p, 0, 2);
+    p = c_zip_le(p, 0, 2);
+    p = c_zip_le(p, 0, 4);
+    p = c_zip_le(p, 0, 4);
+    p = c_zip_le(p, 4, 4);
+    p = c_zip_le(p, 4, 4);
+    p = c_zip_le(p, 5, 2);
+    p = c_zip_le(p, 12, 2);
+    p = c_zip_le(p, 0, 2);
+    p = c_zip_le(p, 0, 4);
+    p = c_zip_le(p, 0, 4);
+    p = c_zip_le(p, 0xFFFFFFFFu, 4);
+    memcpy(p, "a.txt", 5);
+    p += 5;
+    p = c_zip_le(p, 0x0001, 2);
+    p = c_zip_le(p, 8, 2);
+    p = c_zip_le(p, 0xFFFFFFFFFFFFFFFCull, 8);
+    p = c_zip_eocd(p, 63, 0);
+    ASSUME_ITS_TRUE(c_zip_write(zip_path, buf, (size_t)(p - buf)));
+
+    fossil_io_archive_t *archive = fossil_io_archive_open(zip_path, FOSSIL_IO_ARCHIVE_ZIP, FOSSIL_IO_ARCHIVE_READ, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_ITS_TRUE(archive != NULL);
+    ASSUME_ITS_FALSE(fossil_io_archive_extract_file(archive, "a.txt", out));
+    fossil_io_archive_close(archive);
+
+    remove(zip_path);
+    remove(out);
+}
+
+// One ustar record for a regular file of less than a block.
+static size_t c_tar_record(unsigned char *p, const char *name, const char *content)
+{
+    memset(p, 0, 1024);
+    memcpy(p, name, strlen(name));
+    snprintf((char *)p + 100, 8, "%07o", 0644u);
+    snprintf((char *)p + 124, 12, "%011o", (unsigned)strlen(content));
+    snprintf((char *)p + 136, 12, "%011o", 0u);
+    p[156] = '0';
+    memcpy(p + 257, "ustar", 6);
+    memcpy(p + 263, "00", 2);
+    memset(p + 148, ' ', 8);
+    unsigned sum = 0;
+    for (size_t i = 0; i < 512; i++)
+        sum += p[i];
+    snprintf((char *)p + 148, 8, "%06o", sum);
+    p[155] = ' ';
+    memcpy(p + 512, content, strlen(content));
+    return 1024;
+}
+
+FOSSIL_TEST(c_test_archive_tar_remove_duplicates)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *tar_path = "C:\\temp\\fossil_dup.tar";
+    const char *out = "C:\\temp\\fossil_dup.out";
+#else
+    const char *tar_path = "/tmp/fossil_dup.tar";
+    const char *out = "/tmp/fossil_dup.out";
+#endif
+    static unsigned char buf[6 * 1024];
+    size_t len = 0;
+    len += c_tar_record(buf + len, "dup.txt", "first");
+    len += c_tar_record(buf + len, "keep.txt", "kept");
+    len += c_tar_record(buf + len, "dup.txt", "second");
+    len += c_tar_record(buf + len, "dup.txt", "third");
+    memset(buf + len, 0, 1024);
+    len += 1024;
+    FILE *fp = fopen(tar_path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    ASSUME_ITS_EQUAL_SIZE(len, fwrite(buf, 1, len, fp));
+    fclose(fp);
+
+    // The last record wins; removing the name removes every record of it
+    fossil_io_archive_t *archive = fossil_io_archive_open(tar_path, FOSSIL_IO_ARCHIVE_TAR, FOSSIL_IO_ARCHIVE_APPEND, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_NOT_CNULL(archive);
+    ASSUME_ITS_EQUAL_I32(5, (int32_t)fossil_io_archive_entry_size(archive, "dup.txt"));
+    ASSUME_ITS_TRUE(fossil_io_archive_remove(archive, "dup.txt"));
+    ASSUME_ITS_FALSE(fossil_io_archive_exists(archive, "dup.txt"));
+    fossil_io_archive_close(archive);
+
+    archive = fossil_io_archive_open(tar_path, FOSSIL_IO_ARCHIVE_TAR, FOSSIL_IO_ARCHIVE_READ, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_NOT_CNULL(archive);
+    ASSUME_ITS_FALSE(fossil_io_archive_exists(archive, "dup.txt"));
+    ASSUME_ITS_TRUE(fossil_io_archive_extract_file(archive, "keep.txt", out));
+    fossil_io_archive_close(archive);
+
+    char got[16] = {0};
+    fp = fopen(out, "rb");
+    ASSUME_NOT_CNULL(fp);
+    fread(got, 1, sizeof(got) - 1, fp);
+    fclose(fp);
+    ASSUME_ITS_TRUE(strcmp(got, "kept") == 0);
+
+    remove(tar_path);
+    remove(out);
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -203,6 +575,12 @@ FOSSIL_TEST_GROUP(c_archive_tests)
     FOSSIL_ADD_TEST(c_archive_suite, c_test_archive_targz_type);
     FOSSIL_ADD_TEST(c_archive_suite, c_test_archive_tarbz2_type);
     FOSSIL_ADD_TEST(c_archive_suite, c_test_archive_compression_levels);
+    FOSSIL_ADD_TEST(c_archive_suite, c_test_archive_tar_round_trip);
+    FOSSIL_ADD_TEST(c_archive_suite, c_test_archive_entries_view_indexed);
+    FOSSIL_ADD_TEST(c_archive_suite, c_test_archive_extract_all_parallel);
+    FOSSIL_ADD_TEST(c_archive_suite, c_test_archive_zip_deflate_round_trip);
+    FOSSIL_ADD_TEST(c_archive_suite, c_test_archive_zip64_malformed);
+    FOSSIL_ADD_TEST(c_archive_suite, c_test_archive_tar_remove_duplicates);
 
     FOSSIL_ADD_SUITE(c_archive_suite);
 }
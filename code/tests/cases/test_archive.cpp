@@ -180,6 +180,90 @@ FOSSIL_TEST(cpp_test_archive_compression_levels)
     ASSUME_ITS_TRUE(archive_max.is_valid());
 }
 
+FOSSIL_TEST(cpp_test_archive_tar_round_trip)
+{
+#ifdef _WIN32
+    const std::string src = "C:\\temp\\fossil_cpp_tar_src.txt";
+    const std::string tar_path = "C:\\temp\\fossil_cpp_round_trip.tar";
+    const std::string out = "C:\\temp\\fossil_cpp_tar_out.txt";
+#else
+    const std::string src = "/tmp/fossil_cpp_tar_src.txt";
+    const std::string tar_path = "/tmp/fossil_cpp_round_trip.tar";
+    const std::string out = "/tmp/fossil_cpp_tar_out.txt";
+#endif
+    const std::string content = "streamed through the tar backend";
+    FILE *fp = fopen(src.c_str(), "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs(content.c_str(), fp);
+    fclose(fp);
+
+    {
+        fossil::io::Archive archive = fossil::io::Archive::create(tar_path, FOSSIL_IO_ARCHIVE_TAR, FOSSIL_IO_COMPRESSION_NONE);
+        ASSUME_ITS_TRUE(archive.is_valid());
+        ASSUME_ITS_TRUE(archive.add_file(src, "nested/entry.txt"));
+    }
+
+    fossil::io::Archive archive(tar_path, FOSSIL_IO_ARCHIVE_TAR, FOSSIL_IO_ARCHIVE_READ, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_ITS_TRUE(archive.is_valid());
+    ASSUME_ITS_EQUAL_SIZE(1, archive.list().size());
+    ASSUME_ITS_EQUAL_I32((int32_t)content.size(), (int32_t)archive.entry_size("nested/entry.txt"));
+    ASSUME_ITS_TRUE(archive.extract_file("nested/entry.txt", out));
+
+    char buffer[128] = {0};
+    fp = fopen(out.c_str(), "rb");
+    ASSUME_NOT_CNULL(fp);
+    size_t got = fread(buffer, 1, sizeof(buffer) - 1, fp);
+    fclose(fp);
+    ASSUME_ITS_EQUAL_SIZE(content.size(), got);
+    ASSUME_ITS_TRUE(content == buffer);
+
+    remove(src.c_str());
+    remove(out.c_str());
+    remove(tar_path.c_str());
+}
+
+FOSSIL_TEST(cpp_test_archive_zip_round_trip)
+{
+#ifdef _WIN32
+    const std::string src = "C:\\temp\\fossil_cpp_zip_src.txt";
+    const std::string zip_path = "C:\\temp\\fossil_cpp_round_trip.zip";
+    const std::string out = "C:\\temp\\fossil_cpp_zip_out.txt";
+#else
+    const std::string src = "/tmp/fossil_cpp_zip_src.txt";
+    const std::string zip_path = "/tmp/fossil_cpp_round_trip.zip";
+    const std::string out = "/tmp/fossil_cpp_zip_out.txt";
+#endif
+    const std::string content = "deflated deflated deflated deflated deflated through the zip backend";
+    FILE *fp = fopen(src.c_str(), "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs(content.c_str(), fp);
+    fclose(fp);
+
+    {
+        fossil::io::Archive archive = fossil::io::Archive::create(zip_path, FOSSIL_IO_ARCHIVE_ZIP, FOSSIL_IO_COMPRESSION_MAXIMUM);
+        ASSUME_ITS_TRUE(archive.is_valid());
+        ASSUME_ITS_TRUE(archive.add_file(src, "nested/entry.txt"));
+    }
+
+    fossil::io::Archive archive(zip_path, FOSSIL_IO_ARCHIVE_ZIP, FOSSIL_IO_ARCHIVE_READ, FOSSIL_IO_COMPRESSION_NONE);
+    ASSUME_ITS_TRUE(archive.is_valid());
+    ASSUME_ITS_EQUAL_SIZE(1, archive.list().size());
+    ASSUME_ITS_EQUAL_I32((int32_t)content.size(), (int32_t)archive.entry_size("nested/entry.txt"));
+    ASSUME_ITS_TRUE(archive.extract_file("nested/entry.txt", out));
+
+    char buffer[128] = {0};
+    fp = fopen(out.c_str(), "rb");
+    ASSUME_NOT_CNULL(fp);
+    size_t got = fread(buffer, 1, sizeof(buffer) - 1, fp);
+    fclose(fp);
+    ASSUME_ITS_EQUAL_SIZE(content.size(), got);
+    ASSUME_ITS_TRUE(content == buffer);
+
+    remove(src.c_str());
+    remove(out.c_str());
+    remove(zip_path.c_str());
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -199,6 +283,8 @@ FOSSIL_TEST_GROUP(cpp_archive_tests)
     FOSSIL_ADD_TEST(cpp_archive_suite, cpp_test_archive_targz_type);
     FOSSIL_ADD_TEST(cpp_archive_suite, cpp_test_archive_tarbz2_type);
     FOSSIL_ADD_TEST(cpp_archive_suite, cpp_test_archive_compression_levels);
+    FOSSIL_ADD_TEST(cpp_archive_suite, cpp_test_archive_tar_round_trip);
+    FOSSIL_ADD_TEST(cpp_archive_suite, cpp_test_archive_zip_round_trip);
 
     FOSSIL_ADD_SUITE(cpp_archive_suite);
 }
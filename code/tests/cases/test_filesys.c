@@ -26,7 +26,14 @@
 
 #include "fossil/io/framework.h"
 #include <stdio.h> // for fpos_t or fpos64_t if needed
+#include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Utilites
@@ -50,6 +57,17 @@ FOSSIL_TEARDOWN(c_filesys_suite)
     // Teardown code here
 }
 
+// Create or truncate a fixture file holding content.
+static void c_write_file(const char *path, const char *content)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp)
+    {
+        fputs(content, fp);
+        fclose(fp);
+    }
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Cases
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -967,6 +985,1571 @@ FOSSIL_TEST(c_test_filesys_link_set_owner)
     ASSUME_NOT_LESS_THAN_I32(result, -1);
 }
 
+FOSSIL_TEST(c_test_filesys_file_map_full)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *path = "C:\\temp\\test_map.txt";
+#else
+    const char *path = "/tmp/test_map.txt";
+#endif
+    FILE *fp = fopen(path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("Hello Mapped World", fp);
+    fclose(fp);
+
+    fossil_io_filesys_file_t file;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_open(&file, path, "rb"), 0);
+
+    fossil_io_filesys_view_t view;
+    int32_t result = fossil_io_filesys_file_map(&file, 0, 0, &view);
+    ASSUME_ITS_EQUAL_I32(result, 0);
+    ASSUME_ITS_EQUAL_SIZE(view.length, strlen("Hello Mapped World"));
+    ASSUME_ITS_TRUE(memcmp(view.data, "Hello Mapped World", view.length) == 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_view_advise(&view, FOSSIL_FILESYS_ADVICE_SEQUENTIAL), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_unmap(&view), 0);
+    ASSUME_ITS_CNULL(view.data);
+
+    fossil_io_filesys_file_close(&file);
+}
+
+FOSSIL_TEST(c_test_filesys_file_map_range)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *path = "C:\\temp\\test_map.txt";
+#else
+    const char *path = "/tmp/test_map.txt";
+#endif
+    FILE *fp = fopen(path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("Hello Mapped World", fp);
+    fclose(fp);
+
+    fossil_io_filesys_file_t file;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_open(&file, path, "rb"), 0);
+
+    fossil_io_filesys_view_t view;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_map(&file, 6, 6, &view), 0);
+    ASSUME_ITS_EQUAL_SIZE(view.length, 6);
+    ASSUME_ITS_TRUE(memcmp(view.data, "Mapped", 6) == 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_view_advise(&view, FOSSIL_FILESYS_ADVICE_RANDOM), 0);
+    fossil_io_filesys_file_unmap(&view);
+
+    /* past end of file is rejected */
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_file_map(&file, 4096, 1, &view), 0);
+
+    fossil_io_filesys_file_close(&file);
+}
+
+FOSSIL_TEST(c_test_filesys_copy_ex_reports_strategy)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *src = "C:\\temp\\test_copy_ex_src.bin";
+    const char *dst = "C:\\temp\\test_copy_ex_dst.bin";
+#else
+    const char *src = "/tmp/test_copy_ex_src.bin";
+    const char *dst = "/tmp/test_copy_ex_dst.bin";
+#endif
+    /* larger than the fallback buffer so every path loops at least once */
+    const size_t total = 3 * 1024 * 1024 + 17;
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    for (size_t i = 0; i < total; ++i)
+        fputc((int)(i * 31u % 251u), fp);
+    fclose(fp);
+
+    fossil_io_filesys_copy_stats_t stats;
+    int32_t result = fossil_io_filesys_copy_ex(src, dst, true, &stats);
+    ASSUME_ITS_EQUAL_I32(result, 0);
+    ASSUME_ITS_EQUAL_U64(stats.bytes_copied, total);
+    ASSUME_NOT_EQUAL_I32(stats.strategy, FOSSIL_FILESYS_COPY_NONE);
+    ASSUME_NOT_CNULL(fossil_io_filesys_copy_strategy_string(stats.strategy));
+
+    unsigned char a[4096], b[4096];
+    FILE *fa = fopen(src, "rb");
+    FILE *fb = fopen(dst, "rb");
+    ASSUME_NOT_CNULL(fa);
+    ASSUME_NOT_CNULL(fb);
+    bool same = true;
+    size_t na, nb;
+    do {
+        na = fread(a, 1, sizeof(a), fa);
+        nb = fread(b, 1, sizeof(b), fb);
+        if (na != nb || memcmp(a, b, na) != 0)
+            same = false;
+    } while (same && na > 0);
+    fclose(fa);
+    fclose(fb);
+    ASSUME_ITS_TRUE(same);
+
+    remove(src);
+    remove(dst);
+}
+
+FOSSIL_TEST(c_test_filesys_copy_ex_empty_file)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *src = "C:\\temp\\test_copy_ex_empty.bin";
+    const char *dst = "C:\\temp\\test_copy_ex_empty_dst.bin";
+#else
+    const char *src = "/tmp/test_copy_ex_empty.bin";
+    const char *dst = "/tmp/test_copy_ex_empty_dst.bin";
+#endif
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fclose(fp);
+
+    fossil_io_filesys_copy_stats_t stats;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_copy_ex(src, dst, false, &stats), 0);
+    ASSUME_ITS_EQUAL_U64(stats.bytes_copied, 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(dst), 1);
+
+    remove(src);
+    remove(dst);
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+#define WALK_ROOT "C:\\temp\\test_walk_par"
+#define WALK_SEP "\\"
+#else
+#define WALK_ROOT "/tmp/test_walk_par"
+#define WALK_SEP "/"
+#endif
+
+static void c_walk_make_tree(void)
+{
+    fossil_io_filesys_remove(WALK_ROOT, true);
+    fossil_io_filesys_dir_create(WALK_ROOT WALK_SEP "a" WALK_SEP "c", true);
+    fossil_io_filesys_dir_create(WALK_ROOT WALK_SEP "b", true);
+    c_write_file(WALK_ROOT WALK_SEP "a" WALK_SEP "1.txt", "walk");
+    c_write_file(WALK_ROOT WALK_SEP "a" WALK_SEP "2.txt", "walk");
+    c_write_file(WALK_ROOT WALK_SEP "a" WALK_SEP "c" WALK_SEP "3.txt", "walk");
+    c_write_file(WALK_ROOT WALK_SEP "b" WALK_SEP "4.txt", "walk");
+    c_write_file(WALK_ROOT WALK_SEP "z.txt", "walk");
+}
+
+static int c_walk_count_cb(const fossil_io_filesys_obj_t *obj, void *user_data)
+{
+    atomic_size_t *count = (atomic_size_t *)user_data;
+    atomic_fetch_add(count, 1);
+    return (obj->type == FOSSIL_FILESYS_TYPE_UNKNOWN) ? 1 : 0;
+}
+
+static int c_walk_order_cb(const fossil_io_filesys_obj_t *obj, void *user_data)
+{
+    char *out = (char *)user_data;
+    const char *base = obj->path;
+    for (const char *p = obj->path; *p; ++p)
+        if (*p == '/' || *p == '\\')
+            base = p + 1;
+    if (out[0])
+        strcat(out, ",");
+    strcat(out, base);
+    return 0;
+}
+
+static int c_walk_stop_cb(const fossil_io_filesys_obj_t *obj, void *user_data)
+{
+    (void)user_data;
+    return (obj->type == FOSSIL_FILESYS_TYPE_DIR) ? 0 : 7;
+}
+
+FOSSIL_TEST(c_test_filesys_dir_walk_parallel_count)
+{
+    c_walk_make_tree();
+
+    fossil_io_filesys_walk_opts_t opts = {4, false, true};
+    atomic_size_t count;
+    atomic_init(&count, 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_walk_parallel(WALK_ROOT, c_walk_count_cb, &count, &opts), 0);
+    ASSUME_ITS_EQUAL_SIZE(atomic_load(&count), 9);
+
+    atomic_init(&count, 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_walk_parallel(WALK_ROOT, c_walk_count_cb, &count, NULL), 0);
+    ASSUME_ITS_EQUAL_SIZE(atomic_load(&count), 9);
+
+    fossil_io_filesys_remove(WALK_ROOT, true);
+}
+
+FOSSIL_TEST(c_test_filesys_dir_walk_parallel_ordered)
+{
+    c_walk_make_tree();
+
+    fossil_io_filesys_walk_opts_t opts = {3, true, false};
+    char order[256] = {0};
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_walk_parallel(WALK_ROOT, c_walk_order_cb, order, &opts), 0);
+    ASSUME_ITS_TRUE(strcmp(order, "test_walk_par,a,1.txt,2.txt,c,3.txt,b,4.txt,z.txt") == 0);
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_walk_parallel(WALK_ROOT, c_walk_stop_cb, NULL, &opts), 7);
+
+    fossil_io_filesys_remove(WALK_ROOT, true);
+}
+
+FOSSIL_TEST(c_test_filesys_dir_snapshot)
+{
+    c_walk_make_tree();
+
+    fossil_io_filesys_dir_snapshot_t snap;
+    memset(&snap, 0, sizeof(snap));
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_snapshot(WALK_ROOT, &snap), 0);
+    ASSUME_ITS_EQUAL_SIZE(snap.count, 3);
+
+    size_t dirs = 0, files = 0;
+    for (size_t i = 0; i < snap.count; ++i)
+    {
+        const char *name = fossil_io_filesys_dir_snapshot_name(&snap, i);
+        ASSUME_NOT_CNULL(name);
+        if (snap.types[i] == FOSSIL_FILESYS_TYPE_DIR)
+            dirs++;
+        if (strcmp(name, "z.txt") == 0)
+        {
+            files++;
+            ASSUME_ITS_EQUAL_I32(snap.types[i], FOSSIL_FILESYS_TYPE_FILE);
+            ASSUME_ITS_EQUAL_SIZE((size_t)snap.sizes[i], 4);
+            ASSUME_ITS_TRUE(snap.mtimes[i] > 0);
+        }
+    }
+    ASSUME_ITS_EQUAL_SIZE(dirs, 2);
+    ASSUME_ITS_EQUAL_SIZE(files, 1);
+    ASSUME_ITS_TRUE(fossil_io_filesys_dir_snapshot_name(&snap, snap.count) == NULL);
+
+    // Refilling reuses the buffers and replaces the previous contents.
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_snapshot(WALK_ROOT WALK_SEP "a", &snap), 0);
+    ASSUME_ITS_EQUAL_SIZE(snap.count, 3);
+    ASSUME_ITS_TRUE(fossil_io_filesys_dir_snapshot(WALK_ROOT WALK_SEP "missing", &snap) != 0);
+
+    // dir_list entries are filled without per-entry init and can still be refreshed.
+    fossil_io_filesys_obj_t entries[8];
+    size_t count = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_list(WALK_ROOT, entries, 8, &count), 0);
+    ASSUME_ITS_EQUAL_SIZE(count, 3);
+    for (size_t i = 0; i < count; ++i)
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_refresh(&entries[i]), 0);
+
+    fossil_io_filesys_dir_snapshot_free(&snap);
+    ASSUME_ITS_EQUAL_SIZE(snap.count, 0);
+    fossil_io_filesys_remove(WALK_ROOT, true);
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+#define DEDUP_ROOT "C:\\temp\\test_dedup"
+#else
+#define DEDUP_ROOT "/tmp/test_dedup"
+#endif
+
+static bool c_dedup_exists(const char *name)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s%s%s", DEDUP_ROOT, WALK_SEP, name);
+    return fossil_io_filesys_exists(path) == 1;
+}
+
+FOSSIL_TEST(c_test_filesys_deduplicate_removes_all_duplicates)
+{
+    fossil_io_filesys_remove(DEDUP_ROOT, true);
+    fossil_io_filesys_dir_create(DEDUP_ROOT WALK_SEP "sub", true);
+    c_write_file(DEDUP_ROOT WALK_SEP "a.txt", "same bytes");
+    c_write_file(DEDUP_ROOT WALK_SEP "b.txt", "same bytes");
+    c_write_file(DEDUP_ROOT WALK_SEP "c.txt", "same bytes");
+    c_write_file(DEDUP_ROOT WALK_SEP "d.txt", "sane bytes");
+    c_write_file(DEDUP_ROOT WALK_SEP "e.txt", "other");
+    c_write_file(DEDUP_ROOT WALK_SEP "sub" WALK_SEP "f.txt", "same bytes");
+
+    /* non-recursive: two of a/b/c go, the same-size d and sub/f stay */
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_deduplicate(DEDUP_ROOT, false), 2);
+    int kept = c_dedup_exists("a.txt") + c_dedup_exists("b.txt") + c_dedup_exists("c.txt");
+    ASSUME_ITS_EQUAL_I32(kept, 1);
+    ASSUME_ITS_TRUE(c_dedup_exists("d.txt"));
+    ASSUME_ITS_TRUE(c_dedup_exists("e.txt"));
+    ASSUME_ITS_TRUE(c_dedup_exists("sub" WALK_SEP "f.txt"));
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_deduplicate(DEDUP_ROOT, true), 1);
+    ASSUME_ITS_FALSE(c_dedup_exists("sub" WALK_SEP "f.txt"));
+
+    fossil_io_filesys_remove(DEDUP_ROOT, true);
+}
+
+FOSSIL_TEST(c_test_filesys_deduplicate_ex_hardlink)
+{
+    fossil_io_filesys_remove(DEDUP_ROOT, true);
+    fossil_io_filesys_dir_create(DEDUP_ROOT WALK_SEP "sub", true);
+    c_write_file(DEDUP_ROOT WALK_SEP "a.txt", "linked content");
+    c_write_file(DEDUP_ROOT WALK_SEP "sub" WALK_SEP "b.txt", "linked content");
+    c_write_file(DEDUP_ROOT WALK_SEP "c.txt", "unique");
+
+    fossil_io_filesys_dedup_opts_t opts = {FOSSIL_FILESYS_DEDUP_HARDLINK, 2};
+    fossil_io_filesys_dedup_stats_t stats;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_deduplicate_ex(DEDUP_ROOT, true, &opts, &stats), 1);
+    ASSUME_ITS_EQUAL_U64(stats.files_scanned, 3);
+    ASSUME_ITS_EQUAL_U64(stats.duplicates, 1);
+    ASSUME_ITS_EQUAL_U64(stats.bytes_reclaimed, strlen("linked content"));
+    ASSUME_ITS_TRUE(c_dedup_exists("a.txt"));
+    ASSUME_ITS_TRUE(c_dedup_exists("sub" WALK_SEP "b.txt"));
+
+    /* already linked: nothing left to do */
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_deduplicate_ex(DEDUP_ROOT, true, &opts, &stats), 0);
+
+    fossil_io_filesys_remove(DEDUP_ROOT, true);
+}
+
+FOSSIL_TEST(c_test_filesys_file_owned_stream_batches_writes)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *path = "C:\\temp\\test_owned_stream.txt";
+#else
+    const char *path = "/tmp/test_owned_stream.txt";
+#endif
+    fossil_io_filesys_file_t file;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_open(&file, path, "wb+"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_set_stream_mode(&file, FOSSIL_FILESYS_STREAM_OWNED, 16), 0);
+
+    /* single bytes batch up; a write larger than the buffer goes straight through */
+    for (int i = 0; i < 100; ++i)
+    {
+        char c = (char)('a' + i % 26);
+        ASSUME_ITS_EQUAL_SIZE(fossil_io_filesys_file_write(&file, &c, 1, 1), 1);
+    }
+    ASSUME_ITS_EQUAL_SIZE(fossil_io_filesys_file_write(&file, "0123456789abcdefXYZ", 1, 19), 19);
+    ASSUME_ITS_EQUAL_I32((int32_t)fossil_io_filesys_file_tell(&file), 119);
+
+    char back[4] = {0};
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_seek(&file, 0, SEEK_SET), 0);
+    ASSUME_ITS_EQUAL_SIZE(fossil_io_filesys_file_read(&file, back, 1, 3), 3);
+    ASSUME_ITS_TRUE(strcmp(back, "abc") == 0);
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_set_stream_mode(&file, FOSSIL_FILESYS_STREAM_LOCKED, 0), 0);
+    ASSUME_ITS_CNULL(file.buffer);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_close(&file), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), 119);
+
+    remove(path);
+}
+
+FOSSIL_TEST(c_test_filesys_file_flush_levels)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *path = "C:\\temp\\test_flush_levels.txt";
+#else
+    const char *path = "/tmp/test_flush_levels.txt";
+#endif
+    ASSUME_ITS_EQUAL_I32(FOSSIL_STDOUT->flush_level, FOSSIL_FILESYS_FLUSH_BUFFER);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_flush(FOSSIL_STDOUT), 0);
+
+    fossil_io_filesys_file_t file;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_open(&file, path, "wb"), 0);
+    ASSUME_ITS_EQUAL_I32(file.flush_level, FOSSIL_FILESYS_FLUSH_FULL);
+    fossil_io_filesys_file_write(&file, "level", 1, 5);
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_set_flush_level(&file, FOSSIL_FILESYS_FLUSH_BUFFER), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_flush(&file), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), 5);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_sync(&file, FOSSIL_FILESYS_FLUSH_DATA), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_set_flush_level(&file, (fossil_io_filesys_flush_level_t)42), -1);
+
+    fossil_io_filesys_file_close(&file);
+    remove(path);
+}
+
+FOSSIL_TEST(c_test_filesys_file_sync_group)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *paths[3] = {"C:\\temp\\test_sync_group_0.txt", "C:\\temp\\test_sync_group_1.txt", "C:\\temp\\test_sync_group_2.txt"};
+#else
+    const char *paths[3] = {"/tmp/test_sync_group_0.txt", "/tmp/test_sync_group_1.txt", "/tmp/test_sync_group_2.txt"};
+#endif
+    fossil_io_filesys_file_t files[3];
+    fossil_io_filesys_file_t *group[4];
+
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_open(&files[i], paths[i], "wb"), 0);
+        fossil_io_filesys_file_set_stream_mode(&files[i], FOSSIL_FILESYS_STREAM_OWNED, 0);
+        fossil_io_filesys_file_write(&files[i], "group", 1, 5);
+        group[i] = &files[i];
+    }
+    group[3] = NULL;
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_sync_group(group, 4, FOSSIL_FILESYS_FLUSH_DATA), 0);
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(paths[i]), 5);
+        fossil_io_filesys_file_close(&files[i]);
+        remove(paths[i]);
+    }
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_sync_group(NULL, 0, FOSSIL_FILESYS_FLUSH_FULL), 0);
+}
+
+FOSSIL_TEST(c_test_filesys_file_pread_pwrite_vectored)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *path = "C:\\temp\\test_pread.bin";
+#else
+    const char *path = "/tmp/test_pread.bin";
+#endif
+    FILE *fp = fopen(path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("0123456789abcdefghijklmnopqrstuvwxyz", fp);
+    fclose(fp);
+
+    fossil_io_filesys_file_t file;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_open(&file, path, "r+b"), 0);
+
+    // Move the stream position first; positional calls must not disturb it.
+    char head[4] = {0};
+    ASSUME_ITS_EQUAL_SIZE(fossil_io_filesys_file_read(&file, head, 1, 3), 3);
+
+    char buf[8] = {0};
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_pread(&file, buf, 6, 10) == 6);
+    ASSUME_ITS_TRUE(memcmp(buf, "abcdef", 6) == 0);
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_pread(&file, buf, 8, 32) == 4);
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_pread(&file, buf, 8, 100) == 0);
+
+    char a[3], b[5], c[2];
+    fossil_io_filesys_iovec_t iov[3] = {{a, sizeof(a)}, {b, sizeof(b)}, {c, sizeof(c)}};
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_preadv(&file, iov, 3, 20) == 10);
+    ASSUME_ITS_TRUE(memcmp(a, "klm", 3) == 0 && memcmp(b, "nopqr", 5) == 0 && memcmp(c, "st", 2) == 0);
+
+    fossil_io_filesys_iovec_t out[2] = {{(void *)"XY", 2}, {(void *)"Z", 1}};
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_pwritev(&file, out, 2, 4) == 3);
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_pwrite(&file, "!", 1, 36) == 1);
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_pread(&file, buf, 5, 3) == 5);
+    ASSUME_ITS_TRUE(memcmp(buf, "3XYZ7", 5) == 0);
+
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_tell(&file) == 3);
+    ASSUME_ITS_EQUAL_SIZE(fossil_io_filesys_file_read(&file, head, 1, 1), 1);
+    ASSUME_ITS_TRUE(head[0] == '3');
+
+    fossil_io_filesys_file_close(&file);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), 37);
+    remove(path);
+}
+
+/* Open, write, sync, read back, stat and close one file through an engine. */
+static void c_aio_round_trip(fossil_io_filesys_aio_t *aio, const char *path)
+{
+    fossil_io_filesys_aio_completion_t done[4];
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_openat(aio, FOSSIL_FILESYS_AIO_CWD, path, O_RDWR | O_CREAT | O_TRUNC, 0644, 1), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_submit(aio), 1);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_wait(aio, done, 4, 1), 1);
+    ASSUME_ITS_TRUE(done[0].user_data == 1 && done[0].op == FOSSIL_FILESYS_AIO_OPENAT);
+    ASSUME_ITS_TRUE(done[0].result >= 0);
+    int fd = (int)done[0].result;
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_write(aio, fd, "hello ", 6, 0, 2), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_write(aio, fd, "world", 5, 6, 3), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_submit(aio), 2);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_wait(aio, done, 4, 2), 2);
+    ASSUME_ITS_TRUE(done[0].result + done[1].result == 11);
+    ASSUME_ITS_TRUE(fossil_io_filesys_aio_inflight(aio) == 0);
+
+    char buf[16] = {0};
+    fossil_io_filesys_aio_stat_t st = {0, 0, 0};
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_fsync(aio, fd, true, 4), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_read(aio, fd, buf, sizeof(buf), 0, 5), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_statx(aio, FOSSIL_FILESYS_AIO_CWD, path, true, &st, 6), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_submit(aio), 3);
+
+    size_t got = 0;
+    while (got < 3)
+        got += (size_t)fossil_io_filesys_aio_wait(aio, done + got, 4 - got, 1);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        if (done[i].op == FOSSIL_FILESYS_AIO_READ)
+            ASSUME_ITS_TRUE(done[i].user_data == 5 && done[i].result == 11);
+        else
+            ASSUME_ITS_TRUE(done[i].result == 0);
+    }
+    ASSUME_ITS_TRUE(memcmp(buf, "hello world", 11) == 0);
+    ASSUME_ITS_TRUE(st.size == 11);
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_close(aio, fd, 7), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_statx(aio, FOSSIL_FILESYS_AIO_CWD, "/nonexistent/aio", true, &st, 8), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_submit(aio), 2);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_wait(aio, done, 4, 2), 2);
+    for (size_t i = 0; i < 2; ++i)
+        ASSUME_ITS_TRUE(done[i].user_data == 7 ? done[i].result == 0 : done[i].result < 0);
+}
+
+FOSSIL_TEST(c_test_filesys_aio_round_trip)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *path = "C:\\temp\\test_aio.bin";
+#else
+    const char *path = "/tmp/test_aio.bin";
+#endif
+    fossil_io_filesys_aio_t *aio = fossil_io_filesys_aio_create(NULL);
+    ASSUME_NOT_CNULL(aio);
+    c_aio_round_trip(aio, path);
+    fossil_io_filesys_aio_destroy(aio);
+
+    // The worker-pool fallback must behave identically.
+    fossil_io_filesys_aio_opts_t opts = {4, 2, true};
+    aio = fossil_io_filesys_aio_create(&opts);
+    ASSUME_NOT_CNULL(aio);
+    ASSUME_ITS_TRUE(fossil_io_filesys_aio_backend(aio) != FOSSIL_FILESYS_AIO_BACKEND_URING);
+    c_aio_round_trip(aio, path);
+
+    // Queued plus in-flight requests are bounded by the depth.
+    char byte;
+    for (int i = 0; i < 4; ++i)
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_read(aio, -1, &byte, 1, 0, (uint64_t)i), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_aio_read(aio, -1, &byte, 1, 0, 4), -1);
+    fossil_io_filesys_aio_destroy(aio);
+    remove(path);
+}
+
+FOSSIL_TEST(c_test_filesys_dir_mirror_manifest)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *dest = "C:\\temp\\test_mirror_dst";
+    const char *manifest = "C:\\temp\\test_mirror.manifest";
+#else
+    const char *dest = "/tmp/test_mirror_dst";
+    const char *manifest = "/tmp/test_mirror.manifest";
+#endif
+    c_walk_make_tree();
+    fossil_io_filesys_remove(dest, true);
+    remove(manifest);
+
+    fossil_io_filesys_mirror_opts_t opts = {true, manifest, 2, true};
+    fossil_io_filesys_mirror_stats_t stats;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_mirror_ex(WALK_ROOT, dest, &opts, &stats), 0);
+    ASSUME_ITS_TRUE(stats.files_scanned == 5 && stats.files_copied == 5);
+    ASSUME_ITS_TRUE(stats.bytes_copied == 20 && stats.dirs_created == 3);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(manifest), 1);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s%sa%sc%s3.txt", dest, WALK_SEP, WALK_SEP, WALK_SEP);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), 4);
+
+    // Nothing changed: everything is settled from the manifest.
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_mirror_ex(WALK_ROOT, dest, &opts, &stats), 0);
+    ASSUME_ITS_TRUE(stats.files_copied == 0 && stats.files_unchanged == 5 && stats.dirs_created == 0);
+
+    // One file grows, one disappears.
+    FILE *fp = fopen(WALK_ROOT WALK_SEP "b" WALK_SEP "4.txt", "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("changed", fp);
+    fclose(fp);
+    remove(WALK_ROOT WALK_SEP "z.txt");
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_mirror_ex(WALK_ROOT, dest, &opts, &stats), 0);
+    ASSUME_ITS_TRUE(stats.files_copied == 1 && stats.bytes_copied == 7);
+    ASSUME_ITS_TRUE(stats.files_unchanged == 3 && stats.files_deleted == 1);
+    snprintf(path, sizeof(path), "%s%sz.txt", dest, WALK_SEP);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path), 0);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    // A same-size edit within the same second is still copied.
+    struct timespec times[2] = {{1700000000, 100}, {1700000000, 100}};
+    ASSUME_ITS_EQUAL_I32(utimensat(AT_FDCWD, WALK_ROOT "/a/1.txt", times, 0), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_mirror_ex(WALK_ROOT, dest, &opts, &stats), 0);
+    ASSUME_ITS_TRUE(stats.files_copied == 1);
+    fp = fopen(WALK_ROOT "/a/1.txt", "r+b");
+    ASSUME_NOT_CNULL(fp);
+    fputc('#', fp);
+    fclose(fp);
+    times[0].tv_nsec = times[1].tv_nsec = 900;
+    ASSUME_ITS_EQUAL_I32(utimensat(AT_FDCWD, WALK_ROOT "/a/1.txt", times, 0), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_mirror_ex(WALK_ROOT, dest, &opts, &stats), 0);
+    ASSUME_ITS_TRUE(stats.files_copied == 1 && stats.files_unchanged == 3);
+#endif
+
+    // Without a manifest the destination is compared and pruned directly.
+    snprintf(path, sizeof(path), "%s%sextra.txt", dest, WALK_SEP);
+    c_write_file(path, "walk");
+    fossil_io_filesys_mirror_opts_t plain = {true, NULL, 0, false};
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_mirror_ex(WALK_ROOT, dest, &plain, &stats), 0);
+    ASSUME_ITS_TRUE(stats.files_copied == 0 && stats.files_unchanged == 4 && stats.files_deleted == 1);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path), 0);
+
+    // A manifest naming a path outside dest is not trusted.
+#if defined(_WIN32) || defined(_WIN64)
+    const char *victim = "C:\\temp\\test_mirror_victim";
+    const char *escape = "d 0 0 0 0 ..\\test_mirror_victim\n";
+#else
+    const char *victim = "/tmp/test_mirror_victim";
+    const char *escape = "d 0 0 0 0 ../test_mirror_victim\n";
+#endif
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(victim, true), 0);
+    fp = fopen(manifest, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("fossil-mirror-manifest 2\n", fp);
+    fputs(escape, fp);
+    fclose(fp);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_mirror_ex(WALK_ROOT, dest, &opts, &stats), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_exists(victim), 1);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove(victim, true), 0);
+
+    fossil_io_filesys_remove(dest, true);
+    fossil_io_filesys_remove(WALK_ROOT, true);
+    remove(manifest);
+}
+
+/* Emit every byte twice, and a trailer once the input ends. */
+static int c_rewrite_double(const void *chunk, size_t len, bool final, fossil_io_filesys_sink_t *out, void *user_data)
+{
+    size_t *calls = (size_t *)user_data;
+    (*calls)++;
+    if (final)
+        return fossil_io_filesys_sink_write(out, "$", 1);
+    const char *p = (const char *)chunk;
+    for (size_t i = 0; i < len; ++i)
+    {
+        char pair[2] = {p[i], p[i]};
+        if (fossil_io_filesys_sink_write(out, pair, 2) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int c_rewrite_abort(const void *chunk, size_t len, bool final, fossil_io_filesys_sink_t *out, void *user_data)
+{
+    (void)chunk;
+    (void)len;
+    (void)final;
+    (void)user_data;
+    fossil_io_filesys_sink_write(out, "partial", 7);
+    return -1;
+}
+
+static int c_rewrite_upper(void *data, size_t len, uint64_t offset, void *user_data)
+{
+    uint64_t *covered = (uint64_t *)user_data;
+    if (offset != *covered)
+        return -1;
+    unsigned char *p = (unsigned char *)data;
+    for (size_t i = 0; i < len; ++i)
+        if (p[i] >= 'a' && p[i] <= 'z')
+            p[i] = (unsigned char)(p[i] - 'a' + 'A');
+    *covered += len;
+    return 0;
+}
+
+FOSSIL_TEST(c_test_filesys_file_rewrite_stream_and_inplace)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *path = "C:\\temp\\test_rewrite_stream.txt";
+#else
+    const char *path = "/tmp/test_rewrite_stream.txt";
+#endif
+    FILE *fp = fopen(path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("abcdefghij", fp);
+    fclose(fp);
+
+    // Output twice the input size, produced 3 bytes of input at a time.
+    size_t calls = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_rewrite_stream(path, 3, c_rewrite_double, &calls), 0);
+    ASSUME_ITS_EQUAL_SIZE(calls, 5);
+    char buf[64] = {0};
+    fp = fopen(path, "rb");
+    ASSUME_NOT_CNULL(fp);
+    size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    ASSUME_ITS_EQUAL_SIZE(n, 21);
+    ASSUME_ITS_TRUE(strcmp(buf, "aabbccddeeffgghhiijj$") == 0);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    // Mode bits outside the umask survive the rewrite.
+    struct stat st;
+    ASSUME_ITS_EQUAL_I32(chmod(path, 0666), 0);
+    calls = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_rewrite_stream(path, 0, c_rewrite_double, &calls), 0);
+    ASSUME_ITS_EQUAL_I32(stat(path, &st), 0);
+    ASSUME_ITS_EQUAL_I32((int32_t)(st.st_mode & 0777), 0666);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), 43);
+#endif
+
+    // A failing transform leaves the original in place.
+    size_t before = (size_t)fossil_io_filesys_file_size(path);
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_file_rewrite_stream(path, 0, c_rewrite_abort, NULL), 0);
+    ASSUME_ITS_EQUAL_SIZE((size_t)fossil_io_filesys_file_size(path), before);
+
+    // Same-size edit through mapped windows.
+    fp = fopen(path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    for (int i = 0; i < 10000; ++i)
+        fputc('a' + i % 26, fp);
+    fclose(fp);
+    uint64_t covered = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_rewrite_inplace(path, 1, c_rewrite_upper, &covered), 0);
+    ASSUME_ITS_TRUE(covered == 10000);
+    fp = fopen(path, "rb");
+    ASSUME_NOT_CNULL(fp);
+    int c, upper = 0;
+    while ((c = fgetc(fp)) != EOF)
+        upper += (c >= 'A' && c <= 'Z');
+    fclose(fp);
+    ASSUME_ITS_EQUAL_I32(upper, 10000);
+
+    remove(path);
+}
+
+FOSSIL_TEST(c_test_filesys_file_hash_algorithms)
+{
+    static const unsigned char xxh64_abc[8] = {0x44, 0xbc, 0x2c, 0xf5, 0xad, 0x77, 0x09, 0x99};
+    static const unsigned char crc32c_check[4] = {0xe3, 0x06, 0x92, 0x83};
+    static const unsigned char sha256_abc[32] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad};
+    unsigned char out[32];
+
+    ASSUME_ITS_EQUAL_SIZE(fossil_io_filesys_hash_digest_size("sha256"), 32);
+    ASSUME_ITS_EQUAL_SIZE(fossil_io_filesys_hash_digest_size("md5"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_hash_buffer("xxh64", "abc", 3, out, sizeof(out)), 0);
+    ASSUME_ITS_TRUE(memcmp(out, xxh64_abc, 8) == 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_hash_buffer("crc32c", "123456789", 9, out, sizeof(out)), 0);
+    ASSUME_ITS_TRUE(memcmp(out, crc32c_check, 4) == 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_hash_buffer("sha256", "abc", 3, out, sizeof(out)), 0);
+    ASSUME_ITS_TRUE(memcmp(out, sha256_abc, 32) == 0);
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_hash_buffer("sha256", "abc", 3, out, 16), 0);
+
+#if defined(_WIN32) || defined(_WIN64)
+    const char *path = "C:\\temp\\test_file_hash.bin";
+#else
+    const char *path = "/tmp/test_file_hash.bin";
+#endif
+    // 300 KiB of patterned data, enough to cross the CRC lane and SHA block paths.
+    static unsigned char data[300 * 1024];
+    size_t len = sizeof(data);
+    for (size_t i = 0; i < len; ++i)
+        data[i] = (unsigned char)(i * 31 + (i >> 8));
+    FILE *fp = fopen(path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fwrite(data, 1, len, fp);
+    fclose(fp);
+
+    const char *algos[] = {"fnv1a", "xxh64", "crc32c", "sha256"};
+    for (size_t a = 0; a < 4; ++a)
+    {
+        unsigned char expect[32], got[32];
+        size_t size = fossil_io_filesys_hash_digest_size(algos[a]);
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_hash_buffer(algos[a], data, len, expect, sizeof(expect)), 0);
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_hash(path, got, sizeof(got), algos[a]), 0);
+        ASSUME_ITS_TRUE(memcmp(expect, got, size) == 0);
+    }
+
+    // Tree mode is independent of the thread count.
+    fossil_io_filesys_hash_opts_t opts = {true, 1, 64 * 1024};
+    unsigned char one[32], many[32];
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_hash_ex(path, "sha256", one, sizeof(one), &opts), 0);
+    opts.threads = 4;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_hash_ex(path, "sha256", many, sizeof(many), &opts), 0);
+    ASSUME_ITS_TRUE(memcmp(one, many, 32) == 0);
+
+    remove(path);
+}
+
+FOSSIL_TEST(c_test_filesys_file_compress_codecs)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *src = "C:\\temp\\test_codec_src.bin";
+    const char *packed = "C:\\temp\\test_codec_packed.bin";
+    const char *back = "C:\\temp\\test_codec_back.bin";
+#else
+    const char *src = "/tmp/test_codec_src.bin";
+    const char *packed = "/tmp/test_codec_packed.bin";
+    const char *back = "/tmp/test_codec_back.bin";
+#endif
+    // Three and a half blocks of text-like data, so several frames and a short tail.
+    static unsigned char data[3 * 1024 * 1024 + 512 * 1024];
+    static unsigned char check[sizeof(data)];
+    for (size_t i = 0; i < sizeof(data); ++i)
+        data[i] = (unsigned char)("fossil logic filesys "[i % 21] ^ ((i / 4096) & 3));
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fwrite(data, 1, sizeof(data), fp);
+    fclose(fp);
+
+    const char *algos[] = {"lz4", "deflate", "zstd", "rle"};
+    for (size_t a = 0; a < 4; ++a)
+    {
+        if (!fossil_io_filesys_codec_available(algos[a]))
+            continue;
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_compress(src, packed, algos[a]), 0);
+        if (a < 3) // rle only wins on runs
+            ASSUME_ITS_TRUE(fossil_io_filesys_file_size(packed) < (int64_t)sizeof(data));
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_decompress(packed, back), 0);
+        fp = fopen(back, "rb");
+        ASSUME_NOT_CNULL(fp);
+        ASSUME_ITS_EQUAL_SIZE(fread(check, 1, sizeof(check), fp), sizeof(data));
+        fclose(fp);
+        ASSUME_ITS_TRUE(memcmp(data, check, sizeof(data)) == 0);
+    }
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_codec_available("lz4"), 1);
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_file_compress(src, packed, "bzip2"), 0);
+
+    // Random access across a block boundary, and a short read at the end.
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_compress(src, packed, "lz4"), 0);
+    unsigned char range[4096];
+    uint64_t at = 1024 * 1024 - 1000;
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_decompress_range(packed, at, range, sizeof(range)) == (int64_t)sizeof(range));
+    ASSUME_ITS_TRUE(memcmp(range, data + at, sizeof(range)) == 0);
+    at = sizeof(data) - 100;
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_decompress_range(packed, at, range, sizeof(range)) == 100);
+    ASSUME_ITS_TRUE(memcmp(range, data + at, 100) == 0);
+
+    // A damaged block is caught by its checksum.
+    fp = fopen(packed, "r+b");
+    ASSUME_NOT_CNULL(fp);
+    fseek(fp, 100, SEEK_SET);
+    int c = fgetc(fp);
+    fseek(fp, 100, SEEK_SET);
+    fputc(c ^ 0x55, fp);
+    fclose(fp);
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_file_decompress(packed, back), 0);
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_decompress_range(packed, 0, range, 16) < 0);
+
+    remove(src);
+    remove(packed);
+    remove(back);
+}
+
+FOSSIL_TEST(c_test_filesys_file_split_manifest)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    const char *src = "C:\\temp\\test_split_src.bin";
+    const char *prefix = "C:\\temp\\test_split";
+    const char *manifest = "C:\\temp\\test_split.manifest";
+    const char *part1 = "C:\\temp\\test_split.part001";
+    const char *joined = "C:\\temp\\test_split_joined.bin";
+#else
+    const char *src = "/tmp/test_split_src.bin";
+    const char *prefix = "/tmp/test_split";
+    const char *manifest = "/tmp/test_split.manifest";
+    const char *part1 = "/tmp/test_split.part001";
+    const char *joined = "/tmp/test_split_joined.bin";
+#endif
+    static unsigned char data[250000];
+    static unsigned char check[sizeof(data)];
+    for (size_t i = 0; i < sizeof(data); ++i)
+        data[i] = (unsigned char)(i * 7 + (i >> 10));
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fwrite(data, 1, sizeof(data), fp);
+    fclose(fp);
+
+    fossil_io_filesys_split_opts_t opts = {4, "sha256"};
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_split_ex(src, 100000, prefix, &opts) == 3);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(manifest), 1);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_join_manifest(manifest, joined, &opts), 0);
+    fp = fopen(joined, "rb");
+    ASSUME_NOT_CNULL(fp);
+    ASSUME_ITS_EQUAL_SIZE(fread(check, 1, sizeof(check), fp), sizeof(data));
+    fclose(fp);
+    ASSUME_ITS_TRUE(memcmp(data, check, sizeof(data)) == 0);
+
+    // A flipped byte in a part fails verification and leaves no output.
+    remove(joined);
+    fp = fopen(part1, "r+b");
+    ASSUME_NOT_CNULL(fp);
+    fseek(fp, 5000, SEEK_SET);
+    fputc(~data[105000] & 0xFF, fp);
+    fclose(fp);
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_file_join_manifest(manifest, joined, NULL), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(joined), 0);
+
+    // A missing part is caught before anything is written.
+    remove(part1);
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_file_join_manifest(manifest, joined, NULL), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(joined), 0);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        char part[64];
+        snprintf(part, sizeof(part), "%s.part%03d", prefix, i);
+        remove(part);
+    }
+    remove(manifest);
+    remove(src);
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+#define TX_ROOT "C:\\temp\\fossil_tx_test"
+#define TX_SEP "\\"
+#else
+#define TX_ROOT "/tmp/fossil_tx_test"
+#define TX_SEP "/"
+#endif
+
+static bool c_tx_is(const char *path, const char *content)
+{
+    char buf[64] = {0};
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    return n == strlen(content) && memcmp(buf, content, n) == 0;
+}
+
+static size_t c_tx_entries(void)
+{
+    size_t count = 0;
+    fossil_io_filesys_obj_t entries[16];
+    fossil_io_filesys_dir_list(TX_ROOT, entries, 16, &count);
+    return count;
+}
+
+FOSSIL_TEST(c_test_filesys_tx_journal_commit_rollback)
+{
+    fossil_io_filesys_remove(TX_ROOT, true);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(TX_ROOT, true), 0);
+    c_write_file(TX_ROOT TX_SEP "a.txt", "old-a");
+    c_write_file(TX_ROOT TX_SEP "b.txt", "old-b");
+    c_write_file(TX_ROOT TX_SEP "gone.txt", "bye");
+
+    fossil_io_filesys_tx_t *tx = fossil_io_filesys_tx_open(TX_ROOT);
+    ASSUME_NOT_CNULL(tx);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_write(tx, TX_ROOT TX_SEP "a.txt", "new-a", 5), 0);
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_tx_write(tx, TX_ROOT TX_SEP "a.txt", "again", 5), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_copy(tx, TX_ROOT TX_SEP "b.txt", TX_ROOT TX_SEP "c.txt"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_move(tx, TX_ROOT TX_SEP "b.txt", TX_ROOT TX_SEP "d.txt"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_remove(tx, TX_ROOT TX_SEP "gone.txt"), 0);
+
+    // Nothing is visible before commit.
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "a.txt", "old-a"));
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(TX_ROOT TX_SEP "c.txt"), 0);
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_end(tx, true), 0);
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "a.txt", "new-a"));
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "c.txt", "old-b"));
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "d.txt", "old-b"));
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(TX_ROOT TX_SEP "b.txt"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(TX_ROOT TX_SEP "gone.txt"), 0);
+    ASSUME_ITS_EQUAL_SIZE(c_tx_entries(), 3); // no staged files, backups or journal left
+
+    // Rollback leaves the tree untouched.
+    tx = fossil_io_filesys_tx_open(TX_ROOT);
+    ASSUME_NOT_CNULL(tx);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_write(tx, TX_ROOT TX_SEP "a.txt", "zzz", 3), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_remove(tx, TX_ROOT TX_SEP "d.txt"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_end(tx, false), 0);
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "a.txt", "new-a"));
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "d.txt", "old-b"));
+    ASSUME_ITS_EQUAL_SIZE(c_tx_entries(), 3);
+
+    // A commit that cannot apply every operation reverts the ones it did.
+    tx = fossil_io_filesys_tx_open(TX_ROOT);
+    ASSUME_NOT_CNULL(tx);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_write(tx, TX_ROOT TX_SEP "a.txt", "half", 4), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_move(tx, TX_ROOT TX_SEP "d.txt", TX_ROOT TX_SEP "e.txt"), 0);
+    remove(TX_ROOT TX_SEP "d.txt"); // source vanishes before commit
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_tx_end(tx, true), 0);
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "a.txt", "new-a"));
+    ASSUME_ITS_EQUAL_SIZE(c_tx_entries(), 2);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    // A replaced file keeps its permissions.
+    struct stat st;
+    ASSUME_ITS_EQUAL_I32(chmod(TX_ROOT TX_SEP "a.txt", 0600), 0);
+    tx = fossil_io_filesys_tx_open(TX_ROOT);
+    ASSUME_NOT_CNULL(tx);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_write(tx, TX_ROOT TX_SEP "a.txt", "private", 7), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_end(tx, true), 0);
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "a.txt", "private"));
+    ASSUME_ITS_EQUAL_I32(stat(TX_ROOT TX_SEP "a.txt", &st), 0);
+    ASSUME_ITS_TRUE((st.st_mode & 0777) == 0600);
+
+    // Relative paths stay bound to the directory they were staged in.
+    char cwd[512];
+    ASSUME_NOT_CNULL(getcwd(cwd, sizeof(cwd)));
+    ASSUME_ITS_EQUAL_I32(chdir(TX_ROOT), 0);
+    tx = fossil_io_filesys_tx_open(TX_ROOT);
+    ASSUME_NOT_CNULL(tx);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_write(tx, "rel.txt", "rel", 3), 0);
+    ASSUME_ITS_EQUAL_I32(chdir("/"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_end(tx, true), 0);
+    ASSUME_ITS_EQUAL_I32(chdir(cwd), 0);
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "rel.txt", "rel"));
+    remove(TX_ROOT TX_SEP "rel.txt");
+#endif
+
+    // The per-thread API.
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_begin(), 0);
+    ASSUME_NOT_EQUAL_I32(fossil_io_filesys_tx_begin(), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_write(fossil_io_filesys_tx_current(), TX_ROOT TX_SEP "f.txt", "f", 1), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_commit(), 0);
+    ASSUME_ITS_CNULL(fossil_io_filesys_tx_current());
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "f.txt", "f"));
+
+    fossil_io_filesys_remove(TX_ROOT, true);
+}
+
+FOSSIL_TEST(c_test_filesys_tx_journal_recover)
+{
+    fossil_io_filesys_remove(TX_ROOT, true);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(TX_ROOT, true), 0);
+    c_write_file(TX_ROOT TX_SEP "a.txt", "old-a");
+    c_write_file(TX_ROOT TX_SEP "b.txt", "old-b");
+
+    // A committed journal whose operations never ran is replayed...
+    c_write_file(TX_ROOT TX_SEP "a.staged", "recovered");
+    c_write_file(TX_ROOT TX_SEP "fossil-tx-1-1.wal",
+             "fossil-tx-journal 1\n"
+             "W\t" TX_ROOT TX_SEP "a.staged\t" TX_ROOT TX_SEP "a.txt\t" TX_ROOT TX_SEP "a.bak\n"
+             "C\n");
+    // ...and an uncommitted one is discarded with its staged data.
+    c_write_file(TX_ROOT TX_SEP "b.staged", "lost");
+    c_write_file(TX_ROOT TX_SEP "fossil-tx-1-2.wal",
+             "fossil-tx-journal 1\n"
+             "W\t" TX_ROOT TX_SEP "b.staged\t" TX_ROOT TX_SEP "b.txt\t" TX_ROOT TX_SEP "b.bak\n");
+
+    // A journal that does not parse is left alone without ending the scan.
+    c_write_file(TX_ROOT TX_SEP "fossil-tx-1-3.wal", "");
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_recover(TX_ROOT), 2);
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "a.txt", "recovered"));
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "b.txt", "old-b"));
+    ASSUME_ITS_EQUAL_SIZE(c_tx_entries(), 3);
+    remove(TX_ROOT TX_SEP "fossil-tx-1-3.wal");
+
+    // A transaction still in flight is not mistaken for a crashed one.
+    fossil_io_filesys_tx_t *tx = fossil_io_filesys_tx_open(TX_ROOT);
+    ASSUME_NOT_CNULL(tx);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_write(tx, TX_ROOT TX_SEP "b.txt", "live", 4), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_recover(TX_ROOT), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_end(tx, true), 0);
+    ASSUME_ITS_TRUE(c_tx_is(TX_ROOT TX_SEP "b.txt", "live"));
+    ASSUME_ITS_EQUAL_SIZE(c_tx_entries(), 2);
+
+    fossil_io_filesys_remove(TX_ROOT, true);
+}
+
+#if defined(__linux__) || defined(_WIN32) || defined(_WIN64)
+#if defined(_WIN32) || defined(_WIN64)
+#define WATCH_ROOT "C:\\temp\\fossil_watch_test"
+#define WATCH_SEP "\\"
+#else
+#define WATCH_ROOT "/tmp/fossil_watch_test"
+#define WATCH_SEP "/"
+#endif
+
+static fossil_io_filesys_watch_event_t c_watch_seen[64];
+static size_t c_watch_seen_count;
+
+/* Collect events until the watcher stays quiet for half a second. */
+static void c_watch_drain(fossil_io_filesys_watch_t *w)
+{
+    int32_t n;
+    c_watch_seen_count = 0;
+    while (c_watch_seen_count < 64 &&
+           (n = fossil_io_filesys_watch_wait(w, c_watch_seen + c_watch_seen_count, 64 - c_watch_seen_count, 500)) > 0)
+        c_watch_seen_count += (size_t)n;
+}
+
+/* Count drained events for path, OR-ing their masks. */
+static size_t c_watch_hits(const char *path, uint32_t *mask)
+{
+    size_t hits = 0;
+    *mask = 0;
+    for (size_t i = 0; i < c_watch_seen_count; ++i)
+    {
+        if (strcmp(c_watch_seen[i].path, path) == 0)
+        {
+            *mask |= c_watch_seen[i].mask;
+            ++hits;
+        }
+    }
+    return hits;
+}
+
+FOSSIL_TEST(c_test_filesys_watch_events)
+{
+    fossil_io_filesys_remove(WATCH_ROOT, true);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(WATCH_ROOT, true), 0);
+
+    fossil_io_filesys_watch_opts_t opts = {0, 100, 0};
+    fossil_io_filesys_watch_t *w = fossil_io_filesys_watch_open(&opts);
+    ASSUME_NOT_CNULL(w);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_watch_add(w, WATCH_ROOT, true), 0);
+#if !defined(_WIN32) && !defined(_WIN64)
+    ASSUME_ITS_TRUE(fossil_io_filesys_watch_fd(w) >= 0);
+#endif
+
+    // A new subdirectory is followed, and a burst of writes arrives as one event.
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(WATCH_ROOT WATCH_SEP "sub", false), 0);
+    for (int i = 0; i < 20; ++i)
+    {
+        FILE *fp = fopen(WATCH_ROOT WATCH_SEP "sub" WATCH_SEP "a.txt", "ab");
+        ASSUME_NOT_CNULL(fp);
+        fputs("line\n", fp);
+        fclose(fp);
+    }
+    // A file created and removed inside one debounce window is never reported.
+    c_write_file(WATCH_ROOT WATCH_SEP "tmp.txt", "x");
+    remove(WATCH_ROOT WATCH_SEP "tmp.txt");
+
+    uint32_t mask = 0;
+    c_watch_drain(w);
+    ASSUME_ITS_EQUAL_SIZE(c_watch_hits(WATCH_ROOT WATCH_SEP "sub", &mask), 1);
+    ASSUME_ITS_TRUE(mask == (FOSSIL_FILESYS_WATCH_CREATE | FOSSIL_FILESYS_WATCH_IS_DIR));
+    ASSUME_ITS_EQUAL_SIZE(c_watch_hits(WATCH_ROOT WATCH_SEP "sub" WATCH_SEP "a.txt", &mask), 1);
+    ASSUME_ITS_TRUE((mask & FOSSIL_FILESYS_WATCH_CREATE) != 0);
+    ASSUME_ITS_EQUAL_SIZE(c_watch_hits(WATCH_ROOT WATCH_SEP "tmp.txt", &mask), 0);
+
+    remove(WATCH_ROOT WATCH_SEP "sub" WATCH_SEP "a.txt");
+    c_watch_drain(w);
+    ASSUME_ITS_EQUAL_SIZE(c_watch_hits(WATCH_ROOT WATCH_SEP "sub" WATCH_SEP "a.txt", &mask), 1);
+    ASSUME_ITS_TRUE(mask == FOSSIL_FILESYS_WATCH_DELETE);
+
+    // After removal the tree is no longer reported.
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_watch_remove(w, WATCH_ROOT), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_watch_remove(w, WATCH_ROOT), -1);
+    c_write_file(WATCH_ROOT WATCH_SEP "late.txt", "x");
+    c_watch_drain(w);
+    ASSUME_ITS_EQUAL_SIZE(c_watch_seen_count, 0);
+
+    fossil_io_filesys_watch_close(w);
+    fossil_io_filesys_remove(WATCH_ROOT, true);
+}
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+#define CACHE_ROOT "C:\\temp\\fossil_cache_test"
+#define CACHE_SEP "\\"
+#else
+#define CACHE_ROOT "/tmp/fossil_cache_test"
+#define CACHE_SEP "/"
+#endif
+
+FOSSIL_TEST(c_test_filesys_metadata_cache)
+{
+    const char *path = CACHE_ROOT CACHE_SEP "probe.conf";
+    fossil_io_filesys_cache_stats_t stats;
+
+    fossil_io_filesys_remove(CACHE_ROOT, true);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(CACHE_ROOT, true), 0);
+
+    fossil_io_filesys_cache_opts_t opts = {60000, 32, false};
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_cache_enable(&opts), 0);
+
+    // Answers, including "not found", are reused until invalidated or expired.
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path), 0);
+    c_write_file(path, "12345");
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_cache_invalidate(path), 1);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path), 1);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), 5);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(CACHE_ROOT CACHE_SEP CACHE_SEP "." CACHE_SEP "probe.conf"), 5);
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_cache_stats(&stats), 0);
+    ASSUME_ITS_TRUE(stats.hits == 2);
+    ASSUME_ITS_TRUE(stats.misses == 3);
+    ASSUME_ITS_EQUAL_SIZE(stats.entries, 1);
+
+    // Changes made through the library are seen at once.
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove(path, false), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), -1);
+
+    const char *packed = CACHE_ROOT CACHE_SEP "probe.lz4";
+    const char *staged = CACHE_ROOT CACHE_SEP "probe.tx";
+    c_write_file(path, "0123456789");
+    fossil_io_filesys_cache_invalidate(path);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(packed), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_compress(path, packed, "lz4"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(packed), 1);
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(staged), 0);
+    fossil_io_filesys_tx_t *tx = fossil_io_filesys_tx_open(CACHE_ROOT);
+    ASSUME_NOT_CNULL(tx);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_write(tx, staged, "abc", 3), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_tx_end(tx, true), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(staged), 1);
+
+    size_t calls = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), 10);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_rewrite_stream(path, 0, c_rewrite_double, &calls), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), 21);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove(path, false), 0);
+
+    // The capacity bound evicts least recently used paths.
+    char name[FOSSIL_FILESYS_MAX_PATH];
+    for (int i = 0; i < 200; ++i)
+    {
+        snprintf(name, sizeof(name), CACHE_ROOT CACHE_SEP "missing-%d", i);
+        fossil_io_filesys_exists(name);
+    }
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_cache_stats(&stats), 0);
+    ASSUME_ITS_TRUE(stats.entries <= 32);
+    ASSUME_ITS_TRUE(stats.evictions >= 200 - 32);
+
+#if defined(__linux__) || defined(_WIN32) || defined(_WIN64)
+    // With a watcher, outside changes invalidate without waiting for the TTL.
+    opts.watch = true;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_cache_enable(&opts), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path), 0);
+    c_write_file(path, "x");
+    time_t give_up = time(NULL) + 5;
+    while (fossil_io_filesys_exists(path) == 0 && time(NULL) < give_up)
+        ;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path), 1);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_cache_stats(&stats), 0);
+    ASSUME_ITS_TRUE(stats.watching);
+    ASSUME_ITS_TRUE(stats.invalidations >= 1);
+#endif
+
+    fossil_io_filesys_cache_disable();
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_cache_invalidate(NULL), 0);
+    fossil_io_filesys_remove(CACHE_ROOT, true);
+}
+
+static bool c_view_is(fossil_io_filesys_pathview_t v, const char *expect)
+{
+    return v.len == strlen(expect) && memcmp(v.ptr, expect, v.len) == 0;
+}
+
+FOSSIL_TEST(c_test_filesys_path_views)
+{
+    fossil_io_filesys_pathview_t p = fossil_io_filesys_pathview("/srv/data//archive.tar.gz/");
+
+    ASSUME_ITS_TRUE(c_view_is(fossil_io_filesys_pathview_root(p), "/"));
+    ASSUME_ITS_TRUE(c_view_is(fossil_io_filesys_pathview_parent(p), "/srv/data"));
+    ASSUME_ITS_TRUE(c_view_is(fossil_io_filesys_pathview_filename(p), "archive.tar.gz"));
+    ASSUME_ITS_TRUE(c_view_is(fossil_io_filesys_pathview_stem(p), "archive.tar"));
+    ASSUME_ITS_TRUE(c_view_is(fossil_io_filesys_pathview_extension(p), ".gz"));
+    ASSUME_ITS_TRUE(c_view_is(fossil_io_filesys_pathview_extension(fossil_io_filesys_pathview("a/.profile")), ""));
+    ASSUME_ITS_TRUE(c_view_is(fossil_io_filesys_pathview_extension(fossil_io_filesys_pathview("a/..")), ""));
+
+    // Walking up ends with an empty view.
+    int steps = 0;
+    for (fossil_io_filesys_pathview_t v = p; v.len > 0; v = fossil_io_filesys_pathview_parent(v))
+        ++steps;
+    ASSUME_ITS_EQUAL_I32(steps, 4);
+
+    const char *expect[] = {"/", "srv", "data", "archive.tar.gz"};
+    fossil_io_filesys_pathiter_t it;
+    fossil_io_filesys_pathview_t c;
+    size_t n = 0;
+    fossil_io_filesys_pathiter_init(&it, p);
+    while (fossil_io_filesys_pathiter_next(&it, &c))
+    {
+        ASSUME_ITS_TRUE(n < 4 && c_view_is(c, expect[n]));
+        ++n;
+    }
+    ASSUME_ITS_EQUAL_SIZE(n, 4);
+
+#if defined(_WIN32) || defined(_WIN64)
+#define PV_SEP "\\"
+#else
+#define PV_SEP "/"
+#endif
+    char buf[64];
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_pathview_join(fossil_io_filesys_pathview("a/b"),
+                                                         fossil_io_filesys_pathview("c.txt"), buf, sizeof(buf)), 9);
+    ASSUME_ITS_EQUAL_CSTR(buf, "a/b" PV_SEP "c.txt");
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_pathview_join(fossil_io_filesys_pathview("a/b"),
+                                                         fossil_io_filesys_pathview("/etc"), buf, sizeof(buf)), 4);
+    ASSUME_ITS_EQUAL_CSTR(buf, "/etc");
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_pathview_join(fossil_io_filesys_pathview("a/b"),
+                                                         fossil_io_filesys_pathview("c.txt"), buf, 9), -1);
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_pathview_normalize(fossil_io_filesys_pathview("/a/./b//../c/"), buf, sizeof(buf)), 4);
+    ASSUME_ITS_EQUAL_CSTR(buf, PV_SEP "a" PV_SEP "c");
+    fossil_io_filesys_pathview_normalize(fossil_io_filesys_pathview("/../x"), buf, sizeof(buf));
+    ASSUME_ITS_EQUAL_CSTR(buf, PV_SEP "x");
+    fossil_io_filesys_pathview_normalize(fossil_io_filesys_pathview("../a/../../b"), buf, sizeof(buf));
+    ASSUME_ITS_EQUAL_CSTR(buf, ".." PV_SEP ".." PV_SEP "b");
+    fossil_io_filesys_pathview_normalize(fossil_io_filesys_pathview("a/.."), buf, sizeof(buf));
+    ASSUME_ITS_EQUAL_CSTR(buf, ".");
+
+    // In place, as the buffer's own contents.
+    strcpy(buf, "x//y/./z/..");
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_pathview_normalize(fossil_io_filesys_pathview(buf), buf, sizeof(buf)), 3);
+    ASSUME_ITS_EQUAL_CSTR(buf, "x" PV_SEP "y");
+
+    char *norm = fossil_io_filesys_path_normalize("./q/r/../s");
+    ASSUME_ITS_TRUE(norm != NULL);
+    ASSUME_ITS_EQUAL_CSTR(norm, "q" PV_SEP "s");
+    free(norm);
+#undef PV_SEP
+
+    // The copying wrappers reject short buffers instead of truncating.
+    char small[4];
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_basename("/x/file.txt", small, sizeof(small)), -1);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirname("file.txt", small, sizeof(small)), 0);
+    ASSUME_ITS_EQUAL_CSTR(small, ".");
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirname("/", small, sizeof(small)), 0);
+    ASSUME_ITS_EQUAL_CSTR(small, "/");
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirname("/x", small, sizeof(small)), 0);
+    ASSUME_ITS_EQUAL_CSTR(small, "/");
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    char cwd[512];
+    char abs[512];
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_getcwd(cwd, sizeof(cwd)), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_abspath("sub/../file", abs, sizeof(abs)), 0);
+    ASSUME_ITS_TRUE(strncmp(abs, cwd, strlen(cwd)) == 0);
+    ASSUME_ITS_EQUAL_CSTR(abs + strlen(abs) - 5, "/file");
+    ASSUME_ITS_TRUE(strstr(abs, "sub") == NULL);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_abspath("/a/b/..", abs, sizeof(abs)), 0);
+    ASSUME_ITS_EQUAL_CSTR(abs, "/a");
+
+    // A chdir() made outside the library is seen too.
+    ASSUME_ITS_EQUAL_I32(chdir("/"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_abspath("y", abs, sizeof(abs)), 0);
+    ASSUME_ITS_EQUAL_CSTR(abs, "/y");
+    ASSUME_ITS_EQUAL_I32(chdir(cwd), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_abspath("y", abs, sizeof(abs)), 0);
+    ASSUME_ITS_TRUE(strncmp(abs, cwd, strlen(cwd)) == 0);
+#endif
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+#define DH_ROOT "C:\\temp\\fossil_dirhandle_test"
+#define DH_SEP "\\"
+#else
+#define DH_ROOT "/tmp/fossil_dirhandle_test"
+#define DH_SEP "/"
+#endif
+
+static int c_dh_count(const fossil_io_filesys_obj_t *obj, void *user_data)
+{
+    (void)obj;
+    ++*(size_t *)user_data;
+    return 0;
+}
+
+FOSSIL_TEST(c_test_filesys_dirhandle_ops)
+{
+    fossil_io_filesys_remove(DH_ROOT, true);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(DH_ROOT, true), 0);
+
+    fossil_io_filesys_dirhandle_t *root = fossil_io_filesys_dirhandle_open(DH_ROOT);
+    ASSUME_ITS_TRUE(root != NULL);
+    ASSUME_ITS_EQUAL_CSTR(fossil_io_filesys_dirhandle_path(root), DH_ROOT);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_mkdir(root, "sub", 0755), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_mkdir(root, "sub", 0755), -1);
+
+    fossil_io_filesys_file_t f;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_open_file(root, &f, "a.txt", "w"), 0);
+    ASSUME_ITS_EQUAL_SIZE(fossil_io_filesys_file_write(&f, "alpha", 1, 5), 5);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_close(&f), 0);
+
+    fossil_io_filesys_obj_t obj;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_stat(root, "a.txt", &obj, false), 0);
+    ASSUME_ITS_EQUAL_SIZE(obj.size, 5);
+    ASSUME_ITS_TRUE(obj.type == FOSSIL_FILESYS_TYPE_FILE);
+    ASSUME_ITS_EQUAL_CSTR(obj.path, DH_ROOT DH_SEP "a.txt");
+
+    // Rename across handles, then refuse to clobber with NOREPLACE.
+    fossil_io_filesys_dirhandle_t *sub = fossil_io_filesys_dirhandle_open_dir(root, "sub");
+    ASSUME_ITS_TRUE(sub != NULL);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_rename(root, "a.txt", sub, "b.txt", 0), 0);
+    ASSUME_ITS_TRUE(c_tx_is(DH_ROOT DH_SEP "sub" DH_SEP "b.txt", "alpha"));
+    c_write_file(DH_ROOT DH_SEP "c.txt", "keep");
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_rename(sub, "b.txt", root, "c.txt",
+                                                            FOSSIL_FILESYS_RENAME_NOREPLACE), -1);
+    ASSUME_ITS_TRUE(c_tx_is(DH_ROOT DH_SEP "c.txt", "keep"));
+
+    fossil_io_filesys_dirent_t entry;
+    size_t dirs = 0, files = 0;
+    while (fossil_io_filesys_dirhandle_read(root, &entry) > 0)
+    {
+        dirs += (entry.type == FOSSIL_FILESYS_TYPE_DIR);
+        files += (entry.type == FOSSIL_FILESYS_TYPE_FILE);
+    }
+    ASSUME_ITS_EQUAL_SIZE(dirs, 1);
+    ASSUME_ITS_EQUAL_SIZE(files, 1);
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_unlink(sub, "b.txt", false), 0);
+    fossil_io_filesys_dirhandle_close(sub);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_unlink(root, "sub", true), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(DH_ROOT DH_SEP "sub"), 0);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    // Links are read, never followed into.
+    char target[64];
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_link_create("/tmp", DH_ROOT "/out", true), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_readlink(root, "out", target, sizeof(target)), 4);
+    ASSUME_ITS_EQUAL_CSTR(target, "/tmp");
+    ASSUME_ITS_TRUE(fossil_io_filesys_dirhandle_open_dir(root, "out") == NULL);
+
+    // A tree deeper than FOSSIL_FILESYS_MAX_PATH is walked and removed whole.
+    fossil_io_filesys_dirhandle_t *dir = fossil_io_filesys_dirhandle_open(DH_ROOT);
+    for (int i = 0; dir && i < 40; ++i)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "deep_directory_level_%02d", i);
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_mkdir(dir, name, 0755), 0);
+        fossil_io_filesys_dirhandle_t *next = fossil_io_filesys_dirhandle_open_dir(dir, name);
+        fossil_io_filesys_dirhandle_close(dir);
+        dir = next;
+    }
+    ASSUME_ITS_TRUE(dir != NULL);
+    ASSUME_ITS_TRUE(strlen(fossil_io_filesys_dirhandle_path(dir)) > FOSSIL_FILESYS_MAX_PATH);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dirhandle_open_file(dir, &f, "leaf.txt", "w"), 0);
+    fossil_io_filesys_file_close(&f);
+    fossil_io_filesys_dirhandle_close(dir);
+
+    size_t seen = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_walk(DH_ROOT, c_dh_count, &seen), 0);
+    ASSUME_ITS_EQUAL_SIZE(seen, 1 + 1 + 1 + 40 + 1); /* root, c.txt, out, levels, leaf */
+#endif
+
+    fossil_io_filesys_dirhandle_close(root);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove(DH_ROOT, true), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(DH_ROOT), 0);
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+#define RM_ROOT "C:\\temp\\fossil_rmtree_test"
+#define RM_SEP "\\"
+#else
+#define RM_ROOT "/tmp/fossil_rmtree_test"
+#define RM_SEP "/"
+#endif
+#define RM_TREE RM_ROOT RM_SEP "tree"
+
+/* A few levels of fan-out, so several workers find subtrees to take. */
+static void c_rm_build(const char *path, int depth)
+{
+    fossil_io_filesys_dirhandle_t *dir;
+    fossil_io_filesys_file_t f;
+
+    fossil_io_filesys_dir_create(path, true);
+    dir = fossil_io_filesys_dirhandle_open(path);
+    if (!dir)
+        return;
+    for (int i = 0; i < 4; ++i)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "file_%d.txt", i);
+        if (fossil_io_filesys_dirhandle_open_file(dir, &f, name, "w") == 0)
+            fossil_io_filesys_file_close(&f);
+        if (depth > 0)
+        {
+            char sub[FOSSIL_FILESYS_MAX_PATH];
+            snprintf(sub, sizeof(sub), "%s" RM_SEP "dir_%d", path, i);
+            c_rm_build(sub, depth - 1);
+        }
+    }
+    fossil_io_filesys_dirhandle_close(dir);
+}
+
+static size_t c_rm_entries(const char *path)
+{
+    fossil_io_filesys_dirhandle_t *dir = fossil_io_filesys_dirhandle_open(path);
+    fossil_io_filesys_dirent_t entry;
+    size_t n = 0;
+    while (dir && fossil_io_filesys_dirhandle_read(dir, &entry) > 0)
+        ++n;
+    fossil_io_filesys_dirhandle_close(dir);
+    return n;
+}
+
+FOSSIL_TEST(c_test_filesys_remove_tree)
+{
+    fossil_io_filesys_remove_opts_t opts = {4, false};
+
+    fossil_io_filesys_remove(RM_ROOT, true);
+    c_rm_build(RM_TREE, 3);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove_tree(RM_TREE, &opts), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(RM_TREE), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove_tree(RM_TREE, &opts), -1);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    // A link into another tree goes, the tree it points at stays.
+    c_rm_build(RM_ROOT "/kept", 0);
+    c_rm_build(RM_TREE, 1);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_link_create(RM_ROOT "/kept", RM_TREE "/dir_0/out", true), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove(RM_TREE, true), 0);
+    ASSUME_ITS_EQUAL_SIZE(c_rm_entries(RM_ROOT "/kept"), 4);
+#endif
+
+    // Background mode frees the name at once and leaves nothing behind.
+    opts.background = true;
+    c_rm_build(RM_TREE, 2);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove_tree(RM_TREE, &opts), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(RM_TREE), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(RM_TREE, false), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove_wait(), 0);
+#if !defined(_WIN32) && !defined(_WIN64)
+    ASSUME_ITS_EQUAL_SIZE(c_rm_entries(RM_ROOT), 2); /* kept, tree */
+#else
+    ASSUME_ITS_EQUAL_SIZE(c_rm_entries(RM_ROOT), 1);
+#endif
+
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_remove(RM_ROOT, true), 0);
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+/*
+ * Large-file fixture: a sparse file past 4 GiB with a few marker bytes, so
+ * 64-bit paths are exercised without writing gigabytes to disk.
+ */
+#define LARGE_ROOT "/tmp/test_large_file"
+#define LARGE_SIZE (4ULL * 1024 * 1024 * 1024 + 512ULL * 1024 * 1024)
+
+static const uint64_t c_large_marks[] = {0, 3ULL * 1024 * 1024 * 1024 + 5, LARGE_SIZE - 4};
+
+static bool c_large_fixture_create(const char *path)
+{
+    if (fossil_io_filesys_file_truncate(path, 0) != 0)
+    {
+        FILE *fp = fopen(path, "wb");
+        if (!fp)
+            return false;
+        fclose(fp);
+    }
+    if (fossil_io_filesys_file_truncate(path, (size_t)LARGE_SIZE) != 0)
+        return false;
+
+    fossil_io_filesys_file_t file;
+    if (fossil_io_filesys_file_open(&file, path, "r+b") != 0)
+        return false;
+    for (size_t i = 0; i < sizeof(c_large_marks) / sizeof(c_large_marks[0]); ++i)
+    {
+        fossil_io_filesys_file_seek(&file, (int64_t)c_large_marks[i], SEEK_SET);
+        fossil_io_filesys_file_write(&file, "MARK", 1, 4);
+    }
+    fossil_io_filesys_file_close(&file);
+    return true;
+}
+
+static bool c_large_fixture_check(const char *path)
+{
+    fossil_io_filesys_file_t file;
+    if (fossil_io_filesys_file_open(&file, path, "rb") != 0)
+        return false;
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(c_large_marks) / sizeof(c_large_marks[0]); ++i)
+    {
+        char mark[4] = {0};
+        ok = ok && fossil_io_filesys_file_seek(&file, (int64_t)c_large_marks[i], SEEK_SET) == 0 &&
+             fossil_io_filesys_file_read(&file, mark, 1, 4) == 4 && memcmp(mark, "MARK", 4) == 0 &&
+             file.position == c_large_marks[i] + 4;
+    }
+    fossil_io_filesys_file_close(&file);
+    return ok;
+}
+
+FOSSIL_TEST(c_test_filesys_large_file_size_split_join)
+{
+    fossil_io_filesys_remove(LARGE_ROOT, true);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(LARGE_ROOT, true), 0);
+    ASSUME_ITS_TRUE(c_large_fixture_create(LARGE_ROOT "/big.bin"));
+
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_size64(LARGE_ROOT "/big.bin") == (int64_t)LARGE_SIZE);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(LARGE_ROOT "/big.bin"), -1);
+
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_split64(LARGE_ROOT "/big.bin", 2ULL * 1024 * 1024 * 1024, LARGE_ROOT "/big") == 3);
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_size64(LARGE_ROOT "/big.part000") == (int64_t)(2ULL * 1024 * 1024 * 1024));
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_size64(LARGE_ROOT "/big.part002") == (int64_t)(512ULL * 1024 * 1024));
+
+    const char *parts[] = {LARGE_ROOT "/big.part000", LARGE_ROOT "/big.part001", LARGE_ROOT "/big.part002"};
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_join(parts, 3, LARGE_ROOT "/joined.bin"), 0);
+    ASSUME_ITS_TRUE(fossil_io_filesys_file_size64(LARGE_ROOT "/joined.bin") == (int64_t)LARGE_SIZE);
+    ASSUME_ITS_TRUE(c_large_fixture_check(LARGE_ROOT "/joined.bin"));
+
+    fossil_io_filesys_remove(LARGE_ROOT, true);
+}
+#endif
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -1047,6 +2630,37 @@ FOSSIL_TEST_GROUP(c_filesys_tests)
     FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_dir_set_owner);
     FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_link_set_perms);
     FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_link_set_owner);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_map_full);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_map_range);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_copy_ex_reports_strategy);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_copy_ex_empty_file);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_dir_walk_parallel_count);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_dir_walk_parallel_ordered);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_deduplicate_removes_all_duplicates);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_deduplicate_ex_hardlink);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_owned_stream_batches_writes);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_flush_levels);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_sync_group);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_dir_snapshot);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_pread_pwrite_vectored);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_aio_round_trip);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_dir_mirror_manifest);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_rewrite_stream_and_inplace);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_hash_algorithms);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_compress_codecs);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_file_split_manifest);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_tx_journal_commit_rollback);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_tx_journal_recover);
+#if defined(__linux__) || defined(_WIN32) || defined(_WIN64)
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_watch_events);
+#endif
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_metadata_cache);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_path_views);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_dirhandle_ops);
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_remove_tree);
+#if !defined(_WIN32) && !defined(_WIN64)
+    FOSSIL_ADD_TEST(c_filesys_suite, c_test_filesys_large_file_size_split_join);
+#endif
 
     FOSSIL_ADD_SUITE(c_filesys_suite);
 }
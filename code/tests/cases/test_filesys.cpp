@@ -27,6 +27,8 @@
 #include "fossil/io/framework.h"
 #include <stdio.h> // for fpos_t or fpos64_t if needed
 #include <string.h>
+#include <fcntl.h>
+#include <vector>
 
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Utilites
@@ -564,6 +566,506 @@ FOSSIL_TEST(cpp_test_filesys_chdir)
     ASSUME_ITS_EQUAL_I32(result, 0);
 }
 
+FOSSIL_TEST(cpp_test_filesys_mapped_view)
+{
+#ifdef _WIN32
+    const char *path = "C:\\temp\\test_map_cpp.txt";
+#else
+    const char *path = "/tmp/test_map_cpp.txt";
+#endif
+    FILE *fp = fopen(path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("0123456789", fp);
+    fclose(fp);
+
+    fossil::io::Filesys fs;
+    fossil_io_filesys_file_t file;
+    ASSUME_ITS_EQUAL_I32(fs.file_open(&file, path, "rb"), 0);
+    {
+        fossil::io::Filesys::MappedView view(&file, 2, 5, FOSSIL_FILESYS_ADVICE_SEQUENTIAL);
+        ASSUME_ITS_TRUE(view.is_valid());
+        ASSUME_ITS_EQUAL_SIZE(view.size(), 5);
+        ASSUME_ITS_TRUE(std::string(view.begin(), view.end()) == "23456");
+
+        fossil::io::Filesys::MappedView moved(std::move(view));
+        ASSUME_ITS_TRUE(moved.is_valid());
+        ASSUME_ITS_FALSE(view.is_valid());
+        ASSUME_ITS_EQUAL_I32(moved.advise(FOSSIL_FILESYS_ADVICE_RANDOM), 0);
+    }
+    fs.file_close(&file);
+}
+
+FOSSIL_TEST(cpp_test_filesys_copy_ex)
+{
+#ifdef _WIN32
+    const char *src = "C:\\temp\\test_copy_ex_cpp.txt";
+    const char *dst = "C:\\temp\\test_copy_ex_cpp_dst.txt";
+#else
+    const char *src = "/tmp/test_copy_ex_cpp.txt";
+    const char *dst = "/tmp/test_copy_ex_cpp_dst.txt";
+#endif
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("copy engine", fp);
+    fclose(fp);
+
+    fossil::io::Filesys fs;
+    fossil_io_filesys_copy_stats_t stats;
+    ASSUME_ITS_EQUAL_I32(fs.copy_ex(src, dst, true, &stats), 0);
+    ASSUME_ITS_EQUAL_U64(stats.bytes_copied, strlen("copy engine"));
+    ASSUME_ITS_TRUE(std::string(fs.copy_strategy_string(stats.strategy)) != "none");
+
+    fs.remove(src);
+    fs.remove(dst);
+}
+
+FOSSIL_TEST(cpp_test_filesys_dir_walk_parallel)
+{
+#ifdef _WIN32
+    const std::string root = "C:\\temp\\test_walk_par_cpp";
+    const std::string sub = root + "\\sub";
+#else
+    const std::string root = "/tmp/test_walk_par_cpp";
+    const std::string sub = root + "/sub";
+#endif
+    fossil::io::Filesys fs;
+    fs.remove(root, true);
+    ASSUME_ITS_EQUAL_I32(fs.dir_create(sub, true), 0);
+
+    fossil_io_filesys_walk_opts_t opts = {2, true, false};
+    std::vector<std::string> seen;
+    int32_t rc = fs.dir_walk_parallel(root, [](const fossil_io_filesys_obj_t *obj, void *ud) -> int {
+        static_cast<std::vector<std::string> *>(ud)->push_back(obj->path);
+        return 0;
+    }, &seen, &opts);
+    ASSUME_ITS_EQUAL_I32(rc, 0);
+    ASSUME_ITS_EQUAL_SIZE(seen.size(), 2);
+    ASSUME_ITS_TRUE(seen[0] == root);
+    ASSUME_ITS_TRUE(seen[1] == sub);
+
+    fs.remove(root, true);
+}
+
+FOSSIL_TEST(cpp_test_filesys_file_owned_stream)
+{
+#ifdef _WIN32
+    const char *path = "C:\\temp\\test_owned_stream_cpp.txt";
+#else
+    const char *path = "/tmp/test_owned_stream_cpp.txt";
+#endif
+    fossil::io::Filesys fs;
+    fossil_io_filesys_file_t file;
+    ASSUME_ITS_EQUAL_I32(fs.file_open(&file, path, "wb"), 0);
+    ASSUME_ITS_EQUAL_I32(fs.file_set_stream_mode(&file, FOSSIL_FILESYS_STREAM_OWNED), 0);
+    for (int i = 0; i < 1000; ++i)
+        fs.file_write(&file, "x", 1, 1);
+    ASSUME_ITS_EQUAL_I32(fs.file_flush(&file), 0);
+    ASSUME_ITS_EQUAL_I32(fs.file_size(path), 1000);
+    ASSUME_ITS_EQUAL_I32(fs.file_close(&file), 0);
+    fs.remove(path);
+}
+
+FOSSIL_TEST(cpp_test_filesys_file_sync_group)
+{
+#ifdef _WIN32
+    const char *path = "C:\\temp\\test_sync_group_cpp.txt";
+#else
+    const char *path = "/tmp/test_sync_group_cpp.txt";
+#endif
+    fossil::io::Filesys fs;
+    fossil_io_filesys_file_t file;
+    ASSUME_ITS_EQUAL_I32(fs.file_open(&file, path, "wb"), 0);
+    ASSUME_ITS_EQUAL_I32(fs.file_set_flush_level(&file, FOSSIL_FILESYS_FLUSH_DATA), 0);
+    fs.file_write(&file, "abc", 1, 3);
+    ASSUME_ITS_EQUAL_I32(fs.file_sync_group({&file, FOSSIL_STDOUT}), 0);
+    ASSUME_ITS_EQUAL_I32(fs.file_size(path), 3);
+    ASSUME_ITS_EQUAL_I32(fs.file_close(&file), 0);
+    fs.remove(path);
+}
+
+FOSSIL_TEST(cpp_test_filesys_dir_snapshot)
+{
+#ifdef _WIN32
+    const std::string root = "C:\\temp\\test_snapshot_cpp";
+    const std::string file = root + "\\data.bin";
+#else
+    const std::string root = "/tmp/test_snapshot_cpp";
+    const std::string file = root + "/data.bin";
+#endif
+    fossil::io::Filesys fs;
+    fs.remove(root, true);
+    ASSUME_ITS_EQUAL_I32(fs.dir_create(root, true), 0);
+    FILE *fp = fopen(file.c_str(), "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("snapshot", fp);
+    fclose(fp);
+
+    fossil::io::Filesys::DirSnapshot snap(root);
+    ASSUME_ITS_TRUE(snap.is_valid());
+    ASSUME_ITS_EQUAL_SIZE(snap.size(), 1);
+    ASSUME_ITS_TRUE(std::string(snap.name(0)) == "data.bin");
+    ASSUME_ITS_EQUAL_I32(snap.type(0), FOSSIL_FILESYS_TYPE_FILE);
+    ASSUME_ITS_EQUAL_SIZE((size_t)snap.file_size(0), 8);
+
+    fossil::io::Filesys::DirSnapshot moved(std::move(snap));
+    ASSUME_ITS_EQUAL_SIZE(moved.size(), 1);
+    ASSUME_ITS_TRUE(moved.refill(root + "_missing") != 0);
+    ASSUME_ITS_TRUE(!moved.is_valid());
+
+    fs.remove(root, true);
+}
+
+FOSSIL_TEST(cpp_test_filesys_file_preadv)
+{
+#ifdef _WIN32
+    const char *path = "C:\\temp\\test_preadv_cpp.bin";
+#else
+    const char *path = "/tmp/test_preadv_cpp.bin";
+#endif
+    fossil::io::Filesys fs;
+    fossil_io_filesys_file_t file;
+    ASSUME_ITS_EQUAL_I32(fs.file_open(&file, path, "w+b"), 0);
+    ASSUME_ITS_TRUE(fs.file_pwrite(&file, "hello world", 11, 0) == 11);
+
+    char first[5], second[6];
+    std::vector<fossil_io_filesys_iovec_t> iov = {{first, sizeof(first)}, {second, sizeof(second)}};
+    ASSUME_ITS_TRUE(fs.file_preadv(&file, iov, 0) == 11);
+    ASSUME_ITS_TRUE(std::string(first, 5) == "hello");
+    ASSUME_ITS_TRUE(std::string(second, 6) == " world");
+    ASSUME_ITS_TRUE(fs.file_tell(&file) == 0);
+
+    ASSUME_ITS_EQUAL_I32(fs.file_close(&file), 0);
+    fs.remove(path);
+}
+
+FOSSIL_TEST(cpp_test_filesys_async_engine_futures)
+{
+#ifdef _WIN32
+    const char *path = "C:\\temp\\test_aio_cpp.bin";
+#else
+    const char *path = "/tmp/test_aio_cpp.bin";
+#endif
+    fossil::io::Filesys::AsyncEngine engine;
+    ASSUME_ITS_TRUE(engine.is_valid());
+
+    std::future<int64_t> opened = engine.openat(FOSSIL_FILESYS_AIO_CWD, path, O_RDWR | O_CREAT | O_TRUNC);
+    engine.drain();
+    int64_t fd = opened.get();
+    ASSUME_ITS_TRUE(fd >= 0);
+
+    std::vector<std::future<int64_t>> writes;
+    for (int i = 0; i < 8; ++i)
+        writes.push_back(engine.write((int)fd, "abcd", 4, (uint64_t)i * 4));
+    ASSUME_ITS_EQUAL_I32(engine.submit(), 8);
+    engine.wait(8);
+    for (auto &w : writes)
+        ASSUME_ITS_TRUE(w.get() == 4);
+
+    char buf[32];
+    fossil_io_filesys_aio_stat_t st{};
+    std::future<int64_t> got = engine.read((int)fd, buf, sizeof(buf), 0);
+    std::future<int64_t> stat = engine.statx(FOSSIL_FILESYS_AIO_CWD, path, &st);
+    std::future<int64_t> closed = engine.close((int)fd);
+    engine.drain();
+    ASSUME_ITS_TRUE(got.get() == 32);
+    ASSUME_ITS_TRUE(std::string(buf + 28, 4) == "abcd");
+    ASSUME_ITS_TRUE(stat.get() == 0 && st.size == 32);
+    ASSUME_ITS_TRUE(closed.get() == 0);
+    ASSUME_ITS_TRUE(engine.in_flight() == 0);
+
+    fossil::io::Filesys fs;
+    fs.remove(path);
+}
+
+FOSSIL_TEST(cpp_test_filesys_dir_mirror_ex)
+{
+#ifdef _WIN32
+    const std::string src = "C:\\temp\\test_mirror_cpp_src";
+    const std::string dest = "C:\\temp\\test_mirror_cpp_dst";
+    const std::string manifest = "C:\\temp\\test_mirror_cpp.manifest";
+    const std::string file = src + "\\data.txt";
+#else
+    const std::string src = "/tmp/test_mirror_cpp_src";
+    const std::string dest = "/tmp/test_mirror_cpp_dst";
+    const std::string manifest = "/tmp/test_mirror_cpp.manifest";
+    const std::string file = src + "/data.txt";
+#endif
+    fossil::io::Filesys fs;
+    fs.remove(src, true);
+    fs.remove(dest, true);
+    fs.remove(manifest);
+    ASSUME_ITS_EQUAL_I32(fs.dir_create(src, true), 0);
+    FILE *fp = fopen(file.c_str(), "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("mirror", fp);
+    fclose(fp);
+
+    fossil_io_filesys_mirror_opts_t opts = {false, manifest.c_str(), 0, false};
+    fossil_io_filesys_mirror_stats_t stats;
+    ASSUME_ITS_EQUAL_I32(fs.dir_mirror_ex(src, dest, &opts, &stats), 0);
+    ASSUME_ITS_TRUE(stats.files_copied == 1 && stats.bytes_copied == 6);
+    ASSUME_ITS_EQUAL_I32(fs.dir_mirror_ex(src, dest, &opts, &stats), 0);
+    ASSUME_ITS_TRUE(stats.files_copied == 0 && stats.files_unchanged == 1);
+
+    fs.remove(src, true);
+    fs.remove(dest, true);
+    fs.remove(manifest);
+}
+
+static int cpp_rewrite_strip_spaces(const void *chunk, size_t len, bool final, fossil_io_filesys_sink_t *out, void *)
+{
+    if (final)
+        return 0;
+    std::string kept;
+    for (size_t i = 0; i < len; ++i)
+        if (static_cast<const char *>(chunk)[i] != ' ')
+            kept += static_cast<const char *>(chunk)[i];
+    return fossil_io_filesys_sink_write(out, kept.data(), kept.size());
+}
+
+FOSSIL_TEST(cpp_test_filesys_file_rewrite_stream)
+{
+#ifdef _WIN32
+    const char *path = "C:\\temp\\test_rewrite_stream_cpp.txt";
+#else
+    const char *path = "/tmp/test_rewrite_stream_cpp.txt";
+#endif
+    FILE *fp = fopen(path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("a b c d e f", fp);
+    fclose(fp);
+
+    fossil::io::Filesys fs;
+    ASSUME_ITS_EQUAL_I32(fs.file_rewrite_stream(path, 4, cpp_rewrite_strip_spaces, nullptr), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path), 6);
+    fs.remove(path);
+}
+
+FOSSIL_TEST(cpp_test_filesys_file_hash_ex)
+{
+#ifdef _WIN32
+    const char *path = "C:\\temp\\test_file_hash_cpp.txt";
+#else
+    const char *path = "/tmp/test_file_hash_cpp.txt";
+#endif
+    FILE *fp = fopen(path, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("abc", fp);
+    fclose(fp);
+
+    fossil::io::Filesys fs;
+    std::vector<unsigned char> digest = fs.file_hash_ex(path, "xxh64");
+    ASSUME_ITS_EQUAL_SIZE(digest.size(), 8);
+    ASSUME_ITS_TRUE(digest == fs.hash_buffer("xxh64", "abc", 3));
+    ASSUME_ITS_TRUE(fs.file_hash_ex(path, "md5").empty());
+    fs.remove(path);
+}
+
+FOSSIL_TEST(cpp_test_filesys_file_compress_lz4)
+{
+#ifdef _WIN32
+    const char *src = "C:\\temp\\test_codec_cpp.txt";
+    const char *packed = "C:\\temp\\test_codec_cpp.lz4";
+#else
+    const char *src = "/tmp/test_codec_cpp.txt";
+    const char *packed = "/tmp/test_codec_cpp.lz4";
+#endif
+    std::string text;
+    for (int i = 0; i < 1000; ++i)
+        text += "line " + std::to_string(i % 10) + "\n";
+    FILE *fp = fopen(src, "wb");
+    ASSUME_NOT_CNULL(fp);
+    fwrite(text.data(), 1, text.size(), fp);
+    fclose(fp);
+
+    fossil::io::Filesys fs;
+    ASSUME_ITS_TRUE(fs.codec_available("lz4"));
+    ASSUME_ITS_EQUAL_I32(fs.file_compress(src, packed, "lz4"), 0);
+    char buf[12] = {0};
+    ASSUME_ITS_TRUE(fs.file_decompress_range(packed, 7, buf, 11) == 11);
+    ASSUME_ITS_TRUE(text.compare(7, 11, buf) == 0);
+    fs.remove(src);
+    fs.remove(packed);
+}
+
+FOSSIL_TEST(cpp_test_filesys_file_split_ex)
+{
+#ifdef _WIN32
+    const std::string root = "C:\\temp\\test_split_cpp";
+#else
+    const std::string root = "/tmp/test_split_cpp";
+#endif
+    FILE *fp = fopen((root + ".txt").c_str(), "wb");
+    ASSUME_NOT_CNULL(fp);
+    fputs("0123456789abcdefghij", fp);
+    fclose(fp);
+
+    fossil::io::Filesys fs;
+    ASSUME_ITS_TRUE(fs.file_split_ex(root + ".txt", 8, root) == 3);
+    ASSUME_ITS_EQUAL_I32(fs.file_join_manifest(root + ".manifest", root + ".joined"), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size((root + ".joined").c_str()), 20);
+
+    for (const char *suffix : {".txt", ".manifest", ".joined", ".part000", ".part001", ".part002"})
+        fs.remove(root + suffix);
+}
+
+FOSSIL_TEST(cpp_test_filesys_transaction_raii)
+{
+#ifdef _WIN32
+    const std::string path = "C:\\temp\\test_tx_cpp.txt";
+#else
+    const std::string path = "/tmp/test_tx_cpp.txt";
+#endif
+    fossil::io::Filesys fs;
+    fs.remove(path);
+    {
+        fossil::io::Filesys::Transaction tx;
+        ASSUME_ITS_TRUE(tx.is_valid());
+        ASSUME_ITS_EQUAL_I32(tx.write(path, std::string("draft")), 0);
+    } // rolled back
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path.c_str()), 0);
+
+    fossil::io::Filesys::Transaction tx;
+    ASSUME_ITS_EQUAL_I32(tx.write(path, std::string("final")), 0);
+    ASSUME_ITS_EQUAL_I32(tx.commit(), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_file_size(path.c_str()), 5);
+    fs.remove(path);
+}
+
+FOSSIL_TEST(cpp_test_filesys_cache_counters)
+{
+#ifdef _WIN32
+    const std::string path = "C:\\temp\\test_cache_cpp.txt";
+#else
+    const std::string path = "/tmp/test_cache_cpp.txt";
+#endif
+    fossil::io::Filesys fs;
+    fs.remove(path);
+
+    ASSUME_ITS_EQUAL_I32(fs.cache_enable(), 0);
+    for (int i = 0; i < 10; ++i)
+        ASSUME_ITS_EQUAL_I32(fossil_io_filesys_exists(path.c_str()), 0);
+
+    fossil_io_filesys_cache_stats_t stats = fs.cache_stats();
+    ASSUME_ITS_TRUE(stats.misses == 1);
+    ASSUME_ITS_TRUE(stats.hits == 9);
+    ASSUME_ITS_EQUAL_I32(fs.cache_invalidate(path), 1);
+    fs.cache_disable();
+    ASSUME_ITS_EQUAL_SIZE(fs.cache_stats().entries, 0);
+}
+
+#if defined(__linux__) || defined(_WIN32)
+FOSSIL_TEST(cpp_test_filesys_watcher)
+{
+#ifdef _WIN32
+    const std::string dir = "C:\\temp\\test_watch_cpp";
+    const std::string file = dir + "\\note.txt";
+#else
+    const std::string dir = "/tmp/test_watch_cpp";
+    const std::string file = dir + "/note.txt";
+#endif
+    fossil_io_filesys_remove(dir.c_str(), true);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(dir.c_str(), true), 0);
+
+    fossil_io_filesys_watch_opts_t opts = {FOSSIL_FILESYS_WATCH_CREATE, 0, 0};
+    fossil::io::Filesys::Watcher watcher(&opts);
+    ASSUME_ITS_TRUE(watcher.is_valid());
+    ASSUME_ITS_EQUAL_I32(watcher.add(dir, false), 0);
+    ASSUME_ITS_TRUE(watcher.read().empty());
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    ASSUME_NOT_CNULL(fp);
+    fclose(fp);
+
+    auto events = watcher.wait(2000);
+    ASSUME_ITS_EQUAL_SIZE(events.size(), 1);
+    ASSUME_ITS_TRUE(events[0].mask == FOSSIL_FILESYS_WATCH_CREATE);
+    ASSUME_ITS_TRUE(file == events[0].path);
+
+    fossil::io::Filesys::Watcher moved(std::move(watcher));
+    ASSUME_ITS_TRUE(moved.is_valid());
+    ASSUME_ITS_TRUE(!watcher.is_valid());
+    fossil_io_filesys_remove(dir.c_str(), true);
+}
+#endif
+
+FOSSIL_TEST(cpp_test_filesys_path_view)
+{
+    using PathView = fossil::io::Filesys::PathView;
+    constexpr PathView p("/srv/data/archive.tar.gz");
+    static_assert(p.root() == "/");
+    static_assert(p.parent().str() == "/srv/data");
+    static_assert(p.filename() == "archive.tar.gz");
+    static_assert(p.stem() == "archive.tar");
+    static_assert(p.extension() == ".gz");
+    static_assert(PathView("name").parent().empty());
+
+    std::vector<std::string_view> parts;
+    for (std::string_view part : PathView("a//b/./c"))
+        parts.push_back(part);
+    ASSUME_ITS_EQUAL_SIZE(parts.size(), 4);
+    ASSUME_ITS_TRUE(parts[0] == "a" && parts[2] == "." && parts[3] == "c");
+
+#ifdef _WIN32
+    ASSUME_ITS_TRUE(PathView("a/b/../c").normalize() == "a\\c");
+    ASSUME_ITS_TRUE(PathView("dir").join("file") == "dir\\file");
+#else
+    ASSUME_ITS_TRUE(PathView("a/b/../c").normalize() == "a/c");
+    ASSUME_ITS_TRUE(PathView("dir").join("file") == "dir/file");
+#endif
+    ASSUME_ITS_TRUE(PathView("").normalize() == ".");
+}
+
+FOSSIL_TEST(cpp_test_filesys_dirhandle)
+{
+#ifdef _WIN32
+    const std::string root = "C:\\temp\\fossil_dirhandle_cpp";
+#else
+    const std::string root = "/tmp/fossil_dirhandle_cpp";
+#endif
+    fossil::io::Filesys fs;
+    fs.remove(root, true);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create(root.c_str(), true), 0);
+
+    fossil::io::Filesys::DirHandle dir(root);
+    ASSUME_ITS_TRUE(dir.is_valid());
+    ASSUME_ITS_EQUAL_I32(dir.mkdir("child"), 0);
+
+    fossil::io::Filesys::DirHandle child = dir.open_dir("child");
+    ASSUME_ITS_TRUE(child.is_valid());
+    ASSUME_ITS_EQUAL_I32(child.mkdir("grandchild"), 0);
+
+    auto entries = dir.entries();
+    ASSUME_ITS_EQUAL_SIZE(entries.size(), 1);
+    ASSUME_ITS_TRUE(entries[0].first == "child" && entries[0].second == FOSSIL_FILESYS_TYPE_DIR);
+
+    fossil::io::Filesys::DirHandle moved(std::move(child));
+    ASSUME_ITS_TRUE(moved.is_valid() && !child.is_valid());
+    ASSUME_ITS_EQUAL_I32(moved.unlink("grandchild", true), 0);
+    ASSUME_ITS_EQUAL_I32(fs.remove(root, true), 0);
+}
+
+FOSSIL_TEST(cpp_test_filesys_remove_tree)
+{
+#ifdef _WIN32
+    const std::string root = "C:\\temp\\fossil_rmtree_cpp";
+    const std::string sep = "\\";
+#else
+    const std::string root = "/tmp/fossil_rmtree_cpp";
+    const std::string sep = "/";
+#endif
+    fossil::io::Filesys fs;
+    fs.remove(root, true);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create((root + sep + "a" + sep + "b").c_str(), true), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_create((root + sep + "c").c_str(), true), 0);
+
+    fossil_io_filesys_remove_opts_t opts = {2, true};
+    ASSUME_ITS_EQUAL_I32(fs.remove_tree(root, &opts), 0);
+    ASSUME_ITS_EQUAL_I32(fs.exists(root), 0);
+    ASSUME_ITS_EQUAL_I32(fs.remove_wait(), 0);
+    ASSUME_ITS_EQUAL_I32(fs.remove_tree(root), -1);
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -608,6 +1110,27 @@ FOSSIL_TEST_GROUP(cpp_filesys_tests)
     FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_link_create_hard);
     FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_link_is_symbolic);
     FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_chdir);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_mapped_view);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_copy_ex);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_dir_walk_parallel);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_file_owned_stream);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_file_sync_group);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_dir_snapshot);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_file_preadv);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_async_engine_futures);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_dir_mirror_ex);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_file_rewrite_stream);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_file_hash_ex);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_file_compress_lz4);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_file_split_ex);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_transaction_raii);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_cache_counters);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_path_view);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_dirhandle);
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_remove_tree);
+#if defined(__linux__) || defined(_WIN32)
+    FOSSIL_ADD_TEST(cpp_filesys_suite, cpp_test_filesys_watcher);
+#endif
 
 
     FOSSIL_ADD_SUITE(cpp_filesys_suite);